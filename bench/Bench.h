@@ -0,0 +1,269 @@
+/**
+ * @file Bench.h
+ * @brief Benchmarks and reports on the cost of the game's subsystems.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+
+NS_CITY_BUILDER_BEGIN
+
+struct RoadDef;
+struct Router;
+struct Parcels;
+struct Buildings;
+struct Economy;
+struct Scheduler;
+struct TrafficSimulation;
+struct TrafficAssignment;
+struct PedestrianSimulation;
+struct VehicleBatch;
+struct BuildingBatch;
+
+namespace Bench {
+
+/// The benchmarks to run and the reports to print, chosen at launch.
+struct Options {
+  /// The number of jobs to time the job system with, if any.
+  int jobs = 0;
+
+  /// The number of lines of a lane definition to time parsing, if any.
+  int markup = 0;
+
+  /// The number of lane segments to time compiling into a lane graph, if
+  /// any.
+  int laneGraph = 0;
+
+  /// The number of lane segments to time routing through, if any.
+  int router = 0;
+
+  /// The number of vehicles to time simulating, if any.
+  int traffic = 0;
+
+  /// The number of links to time assigning traffic over, if any.
+  int assignment = 0;
+
+  /// The number of lots to time subdividing, if any.
+  int parcels = 0;
+
+  /// The number of buildings to time growing, if any.
+  int buildings = 0;
+
+  /// The number of lots to grow a city on at 1000 times real time, if any.
+  int economy = 0;
+
+  /// The number of pedestrians to time the pedestrian simulation with, if
+  /// any.
+  int pedestrians = 0;
+
+  /// Whether to print the GPU memory used by each texture.
+  bool vramReport = false;
+
+  /// Whether to print the GPU memory used by static meshes.
+  bool meshMemoryReport = false;
+
+  /// Whether to print the time spent recording each part of the frame.
+  bool recordReport = false;
+
+  /// Whether to print the cost of submitting each draw from draw lists.
+  bool drawListReport = false;
+
+  /// Whether to print the time spent meshing roads.
+  bool roadReport = false;
+
+  /// Whether to print the time spent simulating and drawing vehicles.
+  bool vehicleReport = false;
+
+  /// Whether to print the buildings grown and drawn.
+  bool buildingReport = false;
+
+  /// Whether to print the time simulated and the balance of the city.
+  bool simReport = false;
+
+  /// Whether to print the pedestrians simulated and drawn.
+  bool pedestrianReport = false;
+
+  /// Whether to print the jobs run and how busy every thread was.
+  bool jobReport = false;
+};
+
+/// Parse a benchmark or report option from the command line.
+/// \param[in,out] options
+///   The options to write the option to.
+/// \param[in] argc
+///   The number of command line arguments.
+/// \param[in] argv
+///   The command line arguments.
+/// \param[in,out] i
+///   The index of the argument to parse, moved past any value it takes.
+/// \returns
+///   Whether or not the argument is a benchmark or report option.
+bool parseOption(Options &options, int argc, char **argv, int &i);
+
+/// Print the usage of the benchmark and report options.
+void usage();
+
+/// Run every benchmark chosen.
+/// \param[in] options
+///   The benchmarks to run.
+/// \remarks
+///   Must be called after `Events::start`, once the road definitions are
+///   loaded.
+void run(const Options &options);
+
+/// Print every report chosen on the game as it stands.
+/// \param[in] options
+///   The reports to print.
+/// \param[in] frames
+///   The number of frames run.
+void report(const Options &options, size_t frames);
+
+
+
+// ===--- Benchmarks --------------------------------------------------------===
+
+/// Time scheduling empty jobs, splitting a loop at different grains,
+/// chaining jobs and handing jobs to the main thread, and print the results.
+/// \param[in] jobs
+///   The number of jobs to run of each kind.
+void jobs(size_t jobs);
+
+/// Time parsing a lane definition file of a number of lines from memory,
+/// then print the results.
+/// \param[in] lines
+///   The number of profile point and traffic lines in the file.
+void markup(size_t lines);
+
+/// Time compiling a grid of roads into a graph, then compiling it again
+/// after changing a single road and intersection and after removing a road,
+/// and print the results.
+/// \param[in] road
+///   The road definition to build the grid out of.
+/// \param[in] segments
+///   The number of segments to build, roughly.
+void laneGraph(RoadDef *road, size_t segments);
+
+/// Time building and querying a hierarchy over a grid of roads, checking
+/// its routes against Dijkstra's algorithm, and print the results.
+/// \param[in] road
+///   The road definition to build the grid out of.
+/// \param[in] segments
+///   The number of segments to build, roughly.
+/// \param[in] queries
+///   The number of random queries to time.
+void router(RoadDef *road, size_t segments, size_t queries);
+
+/// Time simulating vehicles wandering a grid of roads, on one thread and
+/// then on every core, and print the results.
+/// \param[in] road
+///   The road definition to build the grid out of.
+/// \param[in] vehicles
+///   The number of vehicles to simulate.
+void traffic(RoadDef *road, size_t vehicles);
+
+/// Time assigning traffic over a zoned grid of roads until it converges,
+/// and print the results.
+/// \param[in] road
+///   The road definition to build the grid out of.
+/// \param[in] links
+///   The number of links to build, roughly.
+void assignment(RoadDef *road, size_t links);
+
+/// Time subdividing a zoned grid of roads into lots, then updating them
+/// after a single edit, and print the results.
+/// \param[in] road
+///   The road definition to build the grid out of.
+/// \param[in] lots
+///   The number of lots to subdivide, roughly.
+void parcels(RoadDef *road, size_t lots);
+
+/// Time growing the buildings of a zoned grid of roads a frame at a time,
+/// then catching up with an edit, and print the results.
+/// \param[in] road
+///   The road definition to build the grid out of.
+/// \param[in] buildings
+///   The number of buildings to grow, roughly.
+void buildings(RoadDef *road, size_t buildings);
+
+/// Grow a zoned grid of roads on the simulation clock at a multiple of real
+/// time, printing the balance of the city as it grows.
+/// \param[in] road
+///   The road definition to build the grid out of.
+/// \param[in] lots
+///   The number of lots to zone, roughly.
+/// \param[in] multiplier
+///   How many times faster than real time to simulate, a frame of 60 Hz at
+///   a time.
+void economy(RoadDef *road, size_t lots, float multiplier);
+
+/// Time simulating pedestrians walking between the lots of a zoned grid of
+/// roads, on one thread and then on every core, and print the results.
+/// \param[in] road
+///   The road definition to build the grid out of, which must have
+///   sidewalks.
+/// \param[in] pedestrians
+///   The number of pedestrians to simulate, roughly.
+void pedestrians(RoadDef *road, size_t pedestrians);
+
+
+
+// ===--- Reports -----------------------------------------------------------===
+
+/// Print the jobs run by every thread and how busy it was.
+void printJobs();
+
+/// Print the size of a hierarchy and the time spent building it.
+void print(const Router &router);
+
+/// Print the number of lots and the time spent on them.
+void print(const Parcels &parcels);
+
+/// Print the number of buildings, the capacity of every zone and the time
+/// spent growing them.
+void print(const Buildings &buildings);
+
+/// Print the residents, jobs and demand of every zone, and the time spent.
+void print(const Economy &economy);
+
+/// Print the time simulated and how much faster than real time it was.
+void print(const Scheduler &scheduler);
+
+/// Print the number of vehicles and the time spent simulating them.
+void print(const TrafficSimulation &simulation);
+
+/// Print the size of the network, the state of the assignment and the time
+/// spent on it.
+void print(const TrafficAssignment &assignment);
+
+/// Print the number of pedestrians and the time spent simulating them.
+void print(const PedestrianSimulation &simulation);
+
+/// Print the GPU memory used by each loaded texture.
+void printTextures();
+
+/// Print the GPU memory used by loaded static meshes.
+void printMeshMemory();
+
+/// Print the mean time spent recording each task across every frame.
+void printRecording();
+
+/// Print the cost of the draw lists submitted since the last reset.
+/// \param[in] frames
+///   The number of frames that the lists were submitted over.
+void printDrawLists(size_t frames);
+
+/// Print the time spent meshing paths.
+void printRoadMeshing();
+
+/// Print the number of vehicles and the time spent uploading and drawing
+/// them.
+void print(const VehicleBatch &batch);
+
+/// Print the number of buildings and chunks, the size of the meshes and the
+/// time spent uploading and culling them.
+void print(const BuildingBatch &batch);
+
+} // namespace Bench
+NS_CITY_BUILDER_END
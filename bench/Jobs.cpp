@@ -0,0 +1,127 @@
+/**
+ * @file Jobs.cpp
+ * @brief Benchmarks and reports on the job system.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include "Bench.h"
+#include <CityBuilder/Jobs.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+}
+
+
+
+void Bench::jobs(size_t jobs) {
+  if (jobs == 0)
+    return;
+  printf("job benchmark: %d worker threads and the main thread\n", Jobs::threads());
+  Jobs::resetStats();
+
+  // The cost of adding, stealing and counting jobs that do nothing
+  {
+    Jobs::Counter counter;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < jobs; i++)
+      Jobs::run("empty", [] { }, &counter);
+    Jobs::wait(counter);
+    double elapsed = since(start);
+    printf("  %zu empty jobs             %10.3f ms, %8.1f ns/job\n",
+      jobs, elapsed / 1000, elapsed * 1000 / jobs);
+  }
+
+  // A loop of a little work for every index, split at different grains
+  {
+    size_t count = jobs * 64;
+    std::vector<float> values(count);
+    auto body = [&values](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        float x = (float)i;
+        for (int j = 0; j < 16; j++)
+          x = std::sqrt(x + (float)j);
+        values[i] = x;
+      }
+    };
+    Clock::time_point start = Clock::now();
+    body(0, count);
+    double serial = since(start);
+    printf("  loop of %zu serially       %10.3f ms\n", count, serial / 1000);
+    for (size_t grain : { (size_t)16, (size_t)256, (size_t)4096, (size_t)65536 }) {
+      start = Clock::now();
+      Jobs::parallelFor("loop", count, grain, body);
+      double elapsed = since(start);
+      printf("  loop at a grain of %-6zu %10.3f ms, %6.2fx\n",
+        grain, elapsed / 1000, serial / elapsed);
+    }
+  }
+
+  // A chain of jobs that each wait for the last, without any thread waiting
+  {
+    std::unique_ptr<Jobs::Counter[]> counters(new Jobs::Counter[jobs]);
+    Clock::time_point start = Clock::now();
+    Jobs::run("chain", [] { }, &counters[0]);
+    for (size_t i = 1; i < jobs; i++)
+      Jobs::after(counters[i - 1], "chain", [] { }, &counters[i]);
+    Jobs::wait(counters[jobs - 1]);
+    double elapsed = since(start);
+    for (size_t i = 0; i < jobs; i++)
+      Jobs::wait(counters[i]);
+    printf("  chain of %zu jobs          %10.3f ms, %8.1f ns/link\n",
+      jobs, elapsed / 1000, elapsed * 1000 / jobs);
+  }
+
+  // Jobs for the main thread added from the workers
+  {
+    Jobs::Counter counter, uploads;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < jobs; i++)
+      Jobs::run("worker", [&uploads] {
+        Jobs::runOnMain("upload", [] { }, &uploads);
+      }, &counter);
+    Jobs::wait(counter);
+    Jobs::wait(uploads);
+    double elapsed = since(start);
+    printf("  %zu jobs handing to main   %10.3f ms, %8.1f ns/job\n",
+      jobs, elapsed / 1000, elapsed * 1000 / jobs);
+  }
+
+  printJobs();
+}
+
+
+
+void Bench::printJobs() {
+  double elapsed = Jobs::elapsed();
+  Jobs::Stats total = Jobs::stats();
+  printf("jobs: %zu run on %d worker threads and the main thread, %zu stolen, %zu for bgfx\n",
+    total.jobs, Jobs::threads(), total.stolen, total.mainJobs);
+  printf("  %-14s %10s %10s %12s %8s\n", "thread", "jobs", "stolen", "busy ms", "busy");
+  int others = Jobs::threads() + 1;
+  for (int i = 0; i <= others; i++) {
+    Jobs::Stats stats = Jobs::stats(i);
+    if (stats.jobs == 0 && i != 0)
+      continue;
+    char name[32];
+    if (i == 0)
+      snprintf(name, sizeof(name), "main");
+    else if (i == others)
+      snprintf(name, sizeof(name), "other threads");
+    else
+      snprintf(name, sizeof(name), "worker %d", i);
+    printf("  %-14s %10zu %10zu %12.1f %7.1f%%\n", name, stats.jobs, stats.stolen,
+      stats.busy / 1000, elapsed > 0 ? stats.busy / elapsed * 100 : 0.0);
+  }
+}
@@ -0,0 +1,183 @@
+/**
+ * @file Options.cpp
+ * @brief The command line options that choose benchmarks and reports.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include "Bench.h"
+#include <CityBuilder/Game.h>
+#include <CityBuilder/Rendering/TextureLoader.h>
+#include <CityBuilder/Roads/RoadDef.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+USING_NS_CITY_BUILDER
+
+
+
+bool Bench::parseOption(Options &options, int argc, char **argv, int &i) {
+  const char *arg = argv[i];
+  bool hasValue = i + 1 < argc;
+
+  if (strcmp(arg, "--vram") == 0)
+    options.vramReport = true;
+  else if (strcmp(arg, "--mesh-memory") == 0)
+    options.meshMemoryReport = true;
+  else if (strcmp(arg, "--record-report") == 0)
+    options.recordReport = true;
+  else if (strcmp(arg, "--draw-list-report") == 0)
+    options.drawListReport = true;
+  else if (strcmp(arg, "--road-report") == 0)
+    options.roadReport = true;
+  else if (strcmp(arg, "--markup-benchmark") == 0 && hasValue)
+    options.markup = atoi(argv[++i]);
+  else if (strcmp(arg, "--lane-graph-benchmark") == 0 && hasValue)
+    options.laneGraph = atoi(argv[++i]);
+  else if (strcmp(arg, "--router-benchmark") == 0 && hasValue)
+    options.router = atoi(argv[++i]);
+  else if (strcmp(arg, "--traffic-benchmark") == 0 && hasValue)
+    options.traffic = atoi(argv[++i]);
+  else if (strcmp(arg, "--vehicle-report") == 0)
+    options.vehicleReport = true;
+  else if (strcmp(arg, "--assignment-benchmark") == 0 && hasValue)
+    options.assignment = atoi(argv[++i]);
+  else if (strcmp(arg, "--parcel-benchmark") == 0 && hasValue)
+    options.parcels = atoi(argv[++i]);
+  else if (strcmp(arg, "--building-benchmark") == 0 && hasValue)
+    options.buildings = atoi(argv[++i]);
+  else if (strcmp(arg, "--building-report") == 0)
+    options.buildingReport = true;
+  else if (strcmp(arg, "--economy-benchmark") == 0 && hasValue)
+    options.economy = atoi(argv[++i]);
+  else if (strcmp(arg, "--sim-report") == 0)
+    options.simReport = true;
+  else if (strcmp(arg, "--pedestrian-benchmark") == 0 && hasValue)
+    options.pedestrians = atoi(argv[++i]);
+  else if (strcmp(arg, "--pedestrian-report") == 0)
+    options.pedestrianReport = true;
+  else if (strcmp(arg, "--job-report") == 0)
+    options.jobReport = true;
+  else if (strcmp(arg, "--job-benchmark") == 0 && hasValue)
+    options.jobs = atoi(argv[++i]);
+  else
+    return false;
+  return true;
+}
+
+void Bench::usage() {
+  std::cout
+    << "  --vram              Print the GPU memory used by each texture.\n"
+    << "  --mesh-memory       Print the GPU memory used by static meshes.\n"
+    << "  --record-report     Print the time spent recording each part of\n"
+    << "                      the frame and the parallel speed-up.\n"
+    << "  --draw-list-report  Print the submit cost and bindings set per draw.\n"
+    << "  --road-report       Print the time spent meshing roads.\n"
+    << "  --vehicle-report    Print the time spent simulating and drawing\n"
+    << "                      vehicles.\n"
+    << "  --building-report   Print the buildings grown and the cost of\n"
+    << "                      drawing them.\n"
+    << "  --sim-report        Print the time simulated and the balance of\n"
+    << "                      the city.\n"
+    << "  --pedestrian-report Print the pedestrians simulated and drawn.\n"
+    << "  --job-report        Print the jobs run and how busy every thread\n"
+    << "                      was.\n"
+    << "  --markup-benchmark <n>\n"
+    << "                      Time parsing a lane definition of n lines.\n"
+    << "  --lane-graph-benchmark <n>\n"
+    << "                      Time compiling a grid of about n lane segments\n"
+    << "                      into a lane graph, in full and incrementally.\n"
+    << "  --router-benchmark <n>\n"
+    << "                      Time building a router over a grid of about n\n"
+    << "                      lane segments and querying routes through it.\n"
+    << "  --traffic-benchmark <n>\n"
+    << "                      Time simulating n vehicles on a grid of roads,\n"
+    << "                      on one thread and then on every core.\n"
+    << "  --assignment-benchmark <n>\n"
+    << "                      Time assigning traffic over a zoned grid of\n"
+    << "                      about n road links until it converges.\n"
+    << "  --parcel-benchmark <n>\n"
+    << "                      Time subdividing a zoned grid of about n lots,\n"
+    << "                      then updating them after single edits.\n"
+    << "  --building-benchmark <n>\n"
+    << "                      Time growing about n buildings on a zoned grid\n"
+    << "                      a frame at a time, then after a single edit.\n"
+    << "  --economy-benchmark <n>\n"
+    << "                      Grow a city on a zoned grid of about n lots at\n"
+    << "                      1000 times real time, printing its balance.\n"
+    << "  --pedestrian-benchmark <n>\n"
+    << "                      Time n pedestrians walking between the lots of\n"
+    << "                      a zoned grid, sampling agents near its middle.\n"
+    << "  --job-benchmark <n> Time scheduling, splitting and chaining n jobs.\n";
+}
+
+void Bench::run(const Options &options) {
+  RoadDef *road = &RoadDef::roads["Single-Lane Road"];
+
+  if (options.jobs > 0)
+    jobs(options.jobs);
+  if (options.markup > 0)
+    markup(options.markup);
+  if (options.laneGraph > 0)
+    laneGraph(road, options.laneGraph);
+  if (options.router > 0)
+    router(road, options.router, 10000);
+  if (options.traffic > 0)
+    traffic(road, options.traffic);
+  if (options.assignment > 0)
+    assignment(road, options.assignment);
+  if (options.parcels > 0)
+    parcels(road, options.parcels);
+  if (options.buildings > 0)
+    buildings(road, options.buildings);
+  if (options.economy > 0)
+    economy(road, options.economy, 1000);
+  if (options.pedestrians > 0)
+    pedestrians(road, options.pedestrians);
+}
+
+void Bench::report(const Options &options, size_t frames) {
+  Game &game = Game::instance();
+
+  if (options.vramReport) {
+    TextureLoader::flush();
+    printTextures();
+  }
+
+  if (options.meshMemoryReport)
+    printMeshMemory();
+
+  if (options.recordReport)
+    printRecording();
+
+  if (options.drawListReport)
+    printDrawLists(frames);
+
+  if (options.roadReport) {
+    printRoadMeshing();
+    print(game.roads().parcels());
+  }
+
+  if (options.vehicleReport) {
+    print(game.traffic());
+    print(game.vehicles());
+  }
+
+  if (options.buildingReport) {
+    print(game.buildings());
+    print(game.buildingBatch());
+  }
+
+  if (options.simReport) {
+    print(game.scheduler());
+    print(game.economy());
+  }
+
+  if (options.pedestrianReport) {
+    print(game.pedestrians());
+    print(game.walkers());
+  }
+
+  if (options.jobReport)
+    printJobs();
+}
@@ -0,0 +1,148 @@
+/**
+ * @file Rendering.cpp
+ * @brief Reports on the memory and time spent rendering.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include "Bench.h"
+#include <CityBuilder/Rendering/BuildingBatch.h>
+#include <CityBuilder/Rendering/CommandRecorder.h>
+#include <CityBuilder/Rendering/CurveExtrusion.h>
+#include <CityBuilder/Rendering/DrawList.h>
+#include <CityBuilder/Rendering/InstanceBatch.h>
+#include <CityBuilder/Rendering/TextureLoader.h>
+#include <CityBuilder/Rendering/VehicleBatch.h>
+#include <CityBuilder/Rendering/VertexPacking.h>
+#include <CityBuilder/Simulation/TrafficSimulation.h>
+#include <CityBuilder/Zones/Buildings.h>
+#include <cstdio>
+#include <thread>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// The name of a texture format.
+  const char *formatName(bgfx::TextureFormat::Enum format) {
+    switch (format) {
+    case bgfx::TextureFormat::BC1    : return "BC1";
+    case bgfx::TextureFormat::BC2    : return "BC2";
+    case bgfx::TextureFormat::BC3    : return "BC3";
+    case bgfx::TextureFormat::BC4    : return "BC4";
+    case bgfx::TextureFormat::BC5    : return "BC5";
+    case bgfx::TextureFormat::BC7    : return "BC7";
+    case bgfx::TextureFormat::ASTC4x4: return "ASTC4x4";
+    case bgfx::TextureFormat::ASTC6x6: return "ASTC6x6";
+    case bgfx::TextureFormat::ASTC8x8: return "ASTC8x8";
+    case bgfx::TextureFormat::RGBA8  : return "RGBA8";
+    case bgfx::TextureFormat::BGRA8  : return "BGRA8";
+    default                          : return "?";
+    }
+  }
+}
+
+
+
+void Bench::printTextures() {
+  List<TextureLoader::Resident> textures = TextureLoader::residents();
+  printf("%-32s %-8s %11s %6s %4s %10s\n",
+    "texture", "format", "size", "layers", "mips", "KiB");
+  for (const TextureLoader::Resident &texture : textures) {
+    char size[32];
+    snprintf(size, sizeof(size), "%dx%d", texture.info.width, texture.info.height);
+    printf("%-32s %-8s %11s %6d %4d %10.1f%s\n",
+      (const char *)texture.name, formatName(texture.info.format), size,
+      texture.info.layers, texture.info.mips, texture.bytes / 1024.0,
+      texture.skip > 0 ? " (reduced)" : "");
+  }
+  printf("%zu textures, %.1f KiB\n", textures.count(), TextureLoader::memoryUsed() / 1024.0);
+}
+
+void Bench::printMeshMemory() {
+  printf("%-10s %8s %10s %12s %12s %8s\n",
+    "layout", "meshes", "vertices", "vertex KiB", "index KiB", "B/vert");
+  for (bool packed : { false, true }) {
+    VertexPacking::Usage usage = VertexPacking::usage(packed);
+    if (usage.meshes == 0)
+      continue;
+    printf("%-10s %8zu %10zu %12.1f %12.1f %8.1f\n",
+      packed ? "packed" : "float",
+      usage.meshes, usage.vertices,
+      usage.vertexBytes / 1024.0, usage.indexBytes / 1024.0,
+      usage.vertices > 0 ? (double)usage.vertexBytes / usage.vertices : 0.0);
+  }
+}
+
+void Bench::printRecording() {
+  const CommandRecorder::Totals &totals = CommandRecorder::totals();
+  if (totals.frames == 0)
+    return;
+
+  double frames = (double)totals.frames;
+  printf("%-16s %8s %12s\n", "task", "count", "us/frame");
+  for (const CommandRecorder::Total &total : totals.tasks)
+    printf("%-16s %8.1f %12.1f\n",
+      total.name, total.count / frames, total.time / frames);
+  printf("recorded on %d threads: mean %.1f us, serial %.1f us (%.2fx)\n",
+    CommandRecorder::threads() + 1, totals.time / frames, totals.serial / frames,
+    totals.speedUp());
+
+  // Threads sharing a single core only take turns, so any speed-up measured
+  // there says nothing about recording in parallel
+  unsigned cores = std::thread::hardware_concurrency();
+  if (cores <= 1)
+    printf("only %u hardware thread%s: the parallel speed-up is unmeasured\n",
+      cores, cores == 1 ? "" : "s");
+}
+
+void Bench::printDrawLists(size_t frames) {
+  DrawList::Stats stats = DrawList::stats();
+  if (frames == 0 || stats.draws == 0)
+    return;
+
+  double draws = (double)stats.draws;
+  printf("draw lists (%s): %.1f draws/frame, %.1f us/frame, %.1f ns/draw\n",
+    DrawList::sorting() ? "sorted" : "unsorted",
+    draws / frames, stats.time / frames, stats.time * 1000.0 / draws);
+  printf("  per draw: %.2f textures, %.2f states, %.2f uniforms\n",
+    stats.samplers / draws, stats.states / draws, stats.uniforms / draws);
+}
+
+void Bench::printRoadMeshing() {
+  CurveExtrusion::Stats stats = CurveExtrusion::stats();
+  if (stats.paths == 0)
+    return;
+
+  printf("paths meshed on the %s: %zu, %.1f us/path\n",
+    CurveExtrusion::enabled() ? "GPU" : "CPU", stats.paths, stats.time / stats.paths);
+  if (stats.strips > 0)
+    printf("strips placed: %zu (%.1f KiB of instance data)\n",
+      stats.strips, stats.strips * sizeof(InstanceBatch::Instance) / 1024.0);
+}
+
+void Bench::print(const VehicleBatch &batch) {
+  const VehicleBatch::Stats &stats = batch.stats();
+  printf("%s: %zu instances (%.1f KiB), curves for %u rows of lanes\n",
+    batch.body() == VehicleBatch::Body::pedestrian ? "pedestrians" : "vehicles",
+    batch.count(), batch.count() * sizeof(TrafficSimulation::Snapshot) / 1024.0,
+    (unsigned)batch.curveRows());
+  if (stats.uploads > 0)
+    printf("  %zu uploads: %.1f us/upload\n", stats.uploads, stats.uploadTime / stats.uploads);
+  if (stats.curveUploads > 0)
+    printf("  %zu curve uploads: %.1f us/upload\n",
+      stats.curveUploads, stats.curveTime / stats.curveUploads);
+  if (stats.frames > 0)
+    printf("  %zu frames: %.2f us/frame\n", stats.frames, stats.drawTime / stats.frames);
+}
+
+void Bench::print(const BuildingBatch &batch) {
+  const BuildingBatch::Stats &stats = batch.stats();
+  printf("buildings: %zu instances (%.1f KiB) in %zu chunks, %zu shared triangles\n",
+    batch.count(), batch.count() * sizeof(Buildings::Instance) / 1024.0,
+    batch.chunks(), batch.meshTriangles());
+  printf("  last frame: %d draw calls, %zu triangles\n", batch.drawCalls(), batch.triangles());
+  if (stats.uploads > 0)
+    printf("  %zu chunk uploads: %.1f us/upload\n",
+      stats.uploads, stats.uploadTime / stats.uploads);
+  if (stats.frames > 0)
+    printf("  %zu frames: %.2f us/frame culling\n", stats.frames, stats.cullTime / stats.frames);
+}
@@ -0,0 +1,260 @@
+/**
+ * @file Roads.cpp
+ * @brief Benchmarks and reports on parsing, compiling and routing roads.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include "Bench.h"
+#include <CityBuilder/Jobs.h>
+#include <CityBuilder/Roads/LaneDef.h>
+#include <CityBuilder/Roads/LaneGraph.h>
+#include <CityBuilder/Roads/Router.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+}
+
+
+
+void Bench::markup(size_t lines) {
+  // Half profile points and half traffic lanes, like the stock lanes
+  std::string contents =
+    "[lane]\n"
+    "name \"Benchmark\"\n"
+    "[texture]\n"
+    "main \"pavement\"\n"
+    "[profile]\n";
+  for (size_t i = 0; i < lines / 2; i++)
+    contents += i % 2 ? "D 3,1 uv 0 normal 0,1 normal 1,0\n" : "M 0,0 uv 0 normal 0,1\n";
+  contents += "[traffic]\n";
+  for (size_t i = lines / 2; i < lines; i++)
+    contents += i % 2 ?
+      "D 3 - 10, 0 all.vehicle connect same-direction\n" :
+      "U 0 - 3, 0.2 all.peds connect nearest\n";
+
+  // Parse for at least half a second
+  Clock::time_point start = Clock::now();
+  size_t parses = 0;
+  double elapsed = 0;
+  bool success = true;
+  while (elapsed < 0.5 || parses < 3) {
+    LaneDef lane;
+    success &= LaneDef::parse("benchmark.lane", contents.data(), contents.size(), lane);
+    parses++;
+    elapsed = since(start) / 1e6;
+  }
+
+  printf("markup benchmark: %zu lines, %zu bytes%s\n",
+    lines, contents.size(), success ? "" : " (failed to parse)");
+  printf("  %zu parses: %.3f ms/parse, %.1f MB/s\n",
+    parses, elapsed * 1e3 / parses, contents.size() * parses / elapsed / 1e6);
+}
+
+void Bench::laneGraph(RoadDef *road, size_t segments) {
+  List<Road *> grid { };
+  List<Intersection *> intersections { };
+  LaneGraph::buildGrid(road, segments, grid, intersections);
+  if (grid.isEmpty())
+    return;
+
+  LaneGraph graph;
+  auto time = [&](const char *name, auto change) {
+    change();
+    Clock::time_point start = Clock::now();
+    size_t compiled = graph.stats().segments;
+    graph.update();
+    double elapsed = since(start) / 1000;
+    printf("  %-24s %10.3f ms (%zu segments compiled)\n",
+      name, elapsed, graph.stats().segments - compiled);
+  };
+
+  printf("lane graph benchmark: %zu roads, %zu intersections\n",
+    grid.count(), intersections.count());
+  time("full build", [&] {
+    for (Road *r : grid)
+      graph.invalidate(r);
+  });
+  printf("  %zu segments, %zu edges\n", graph.count(), graph.edges().count());
+
+  Road *middle = grid[grid.count() / 2];
+  time("change one road", [&] { graph.invalidate(middle); });
+  time("change one intersection", [&] {
+    graph.invalidate(middle->start.other.intersection);
+  });
+  time("remove one road", [&] { graph.remove(middle); });
+
+  for (Road *r : grid)
+    delete r;
+  for (Intersection *intersection : intersections)
+    delete intersection;
+}
+
+void Bench::router(RoadDef *road, size_t segments, size_t queries) {
+  List<Road *> grid { };
+  List<Intersection *> intersections { };
+  LaneGraph::buildGrid(road, segments, grid, intersections);
+  if (grid.isEmpty())
+    return;
+
+  LaneGraph graph;
+  for (Road *r : grid)
+    graph.invalidate(r);
+  graph.update();
+
+  Router router;
+  Clock::time_point start = Clock::now();
+  router.update(graph);
+  printf("router benchmark: %zu segments, %zu arcs, built in %.1f ms\n",
+    router.count(), router.arcs(), since(start) / 1000.0);
+
+  // Pick random routed segments to travel between
+  List<uint32_t> routed { };
+  for (uint32_t id = 0; id < graph.segments().count(); id++)
+    if (graph.segments()[id].road != nullptr &&
+        graph.segments()[id].category == router.category())
+      routed.append(id);
+  std::mt19937 random(1);
+  auto pick = [&] { return routed[random() % routed.count()]; };
+
+  // Dijkstra's algorithm over the lane graph, to check the router against
+  auto dijkstra = [&](uint32_t from, uint32_t to) {
+    const List<LaneGraph::Segment> &nodes = graph.segments();
+    std::vector<float> reached(nodes.count(), INFINITY);
+    using Item = std::pair<float, uint32_t>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> open;
+    reached[from] = nodes[from].cost;
+    open.push({ reached[from], from });
+    while (!open.empty()) {
+      auto [cost, id] = open.top();
+      open.pop();
+      if (id == to)
+        return cost;
+      if (cost > reached[id])
+        continue;
+      for (uint32_t i = graph.offsets()[id]; i < graph.offsets()[id + 1]; i++) {
+        const LaneGraph::Edge &edge = graph.edges()[i];
+        float next = cost + edge.cost + nodes[edge.target].cost;
+        if (next < reached[edge.target]) {
+          reached[edge.target] = next;
+          open.push({ next, edge.target });
+        }
+      }
+    }
+    return (float)INFINITY;
+  };
+  auto check = [&](const char *name, size_t count) {
+    size_t mismatches = 0;
+    double time = 0;
+    for (size_t i = 0; i < count; i++) {
+      uint32_t from = pick(), to = pick();
+      Clock::time_point start = Clock::now();
+      float expected = dijkstra(from, to);
+      time += since(start);
+      float cost = router.cost(from, to);
+      if (std::isinf(expected) != std::isinf(cost) ||
+          (!std::isinf(cost) && std::fabs(cost - expected) > 1e-3f * expected))
+        mismatches++;
+    }
+    printf("  %-28s %zu/%zu routes differ from Dijkstra (%.1f us/query)\n",
+      name, mismatches, count, time / count);
+  };
+  check("checked", 50);
+
+  // Time single queries
+  List<std::pair<uint32_t, uint32_t>> pairs { };
+  for (size_t i = 0; i < queries; i++)
+    pairs.append({ pick(), pick() });
+  start = Clock::now();
+  float sum = 0;
+  for (const auto &pair : pairs)
+    sum += std::min(router.cost(pair.first, pair.second), 1e6f);
+  printf("  %-28s %10.2f us/query\n", "cost queries", since(start) / queries);
+
+  List<uint32_t> path { };
+  start = Clock::now();
+  size_t length = 0;
+  for (const auto &pair : pairs) {
+    path.removeAll();
+    router.route(pair.first, pair.second, path);
+    length += path.count();
+  }
+  printf("  %-28s %10.2f us/query (%.0f segments/route)\n", "route queries",
+    since(start) / queries, (double)length / queries);
+
+  // Time a table of many to many
+  List<uint32_t> from { }, to { };
+  for (size_t i = 0; i < 256; i++) {
+    from.append(pick());
+    to.append(pick());
+  }
+  start = Clock::now();
+  List<float> table = router.costs(from, to);
+  double elapsed = since(start);
+  printf("  %-28s %10.2f ms (%.3f us/pair, %d threads)\n", "256x256 table",
+    elapsed / 1000.0, elapsed / table.count(), Jobs::threads() + 1);
+
+  // Bulldoze a road and build a new one
+  Road *middle = grid[grid.count() / 2];
+  start = Clock::now();
+  graph.remove(middle);
+  graph.update();
+  router.update(graph);
+  printf("  %-28s %10.2f ms\n", "remove one road", since(start) / 1000.0);
+  check("checked after removing", 50);
+
+  Intersection *corner = intersections[0];
+  Road *spur = new Road(road, new Line2(corner->center, corner->center - Real2(60, 0)));
+  corner->addRoad(spur);
+  grid.append(spur);
+  start = Clock::now();
+  graph.invalidate(spur);
+  graph.invalidate(corner);
+  graph.update();
+  router.update(graph);
+  printf("  %-28s %10.2f ms\n", "build one road", since(start) / 1000.0);
+  check("checked after building", 50);
+  print(router);
+
+  if (sum < 0)
+    // Keep the queries from being optimized away
+    printf("%f\n", sum);
+
+  for (Road *r : grid)
+    delete r;
+  for (Intersection *intersection : intersections)
+    delete intersection;
+}
+
+
+
+void Bench::print(const Router &router) {
+  const Router::Stats &stats = router.stats();
+  printf("router: %zu segments, %zu arcs (%.1f KiB)\n",
+    router.count(), router.arcs(), router.bytes() / 1024.0);
+  if (stats.orders > 0)
+    printf("  %zu orders: %.1f ms/order\n",
+      stats.orders, stats.orderTime / stats.orders / 1000.0);
+  if (stats.increments > 0)
+    printf("  %zu increments: %.1f ms/increment\n",
+      stats.increments, stats.incrementTime / stats.increments / 1000.0);
+  if (stats.orders + stats.increments > 0)
+    printf("  customized in %.1f ms (%.0f ranks)\n",
+      stats.customizeTime / (stats.orders + stats.increments) / 1000.0,
+      (double)stats.customized / (stats.orders + stats.increments));
+}
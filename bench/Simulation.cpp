@@ -0,0 +1,446 @@
+/**
+ * @file Simulation.cpp
+ * @brief Benchmarks and reports on the traffic, pedestrian and economic
+ *   simulations.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include "Bench.h"
+#include <CityBuilder/Jobs.h>
+#include <CityBuilder/Roads/LaneGraph.h>
+#include <CityBuilder/Simulation/Economy.h>
+#include <CityBuilder/Simulation/PedestrianSimulation.h>
+#include <CityBuilder/Simulation/Scheduler.h>
+#include <CityBuilder/Simulation/TrafficAssignment.h>
+#include <CityBuilder/Simulation/TrafficSimulation.h>
+#include <CityBuilder/Zones/Buildings.h>
+#include <CityBuilder/Zones/Parcels.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  /// Delete the roads and intersections of a grid.
+  void demolish(List<Road *> &grid, List<Intersection *> &intersections) {
+    for (Road *road : grid)
+      delete road;
+    for (Intersection *intersection : intersections)
+      delete intersection;
+  }
+}
+
+
+
+void Bench::traffic(RoadDef *road, size_t vehicles) {
+  // About two vehicles to each vehicle lane of a two-lane road, which flows
+  // steadily where denser traffic slowly locks up the grid
+  List<Road *> grid { };
+  List<Intersection *> intersections { };
+  LaneGraph::buildGrid(road, vehicles * 3 / 2, grid, intersections);
+  if (grid.isEmpty())
+    return;
+
+  LaneGraph graph;
+  for (Road *r : grid)
+    graph.invalidate(r);
+  graph.update();
+
+  TrafficSimulation simulation;
+  simulation.sync(graph);
+  if (simulation.lanes() == 0) {
+    printf("traffic benchmark: the road has no vehicle lanes\n");
+    demolish(grid, intersections);
+    return;
+  }
+
+  simulation.populate(vehicles);
+  printf("traffic benchmark: %zu vehicles on %zu lanes, %zu intersections\n",
+    simulation.count(), simulation.lanes(), intersections.count());
+
+  auto time = [&](int threads) {
+    simulation.setThreads(threads);
+    for (int i = 0; i < 20; i++)
+      simulation.step();
+    simulation.resetStats();
+
+    const int steps = 100;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < steps; i++)
+      simulation.step();
+    double perStep = since(start) / steps / 1000;
+    printf("  %2d threads %12.3f ms/step, %6.1fx real time at %.0f Hz, %.1f M vehicle updates/s\n",
+      simulation.threads() + 1, perStep, TrafficSimulation::timestep * 1000 / perStep,
+      1 / TrafficSimulation::timestep, simulation.count() / perStep / 1000);
+    print(simulation);
+  };
+
+  time(0);
+  if (Jobs::threads() > 0)
+    time(-1);
+
+  demolish(grid, intersections);
+}
+
+void Bench::assignment(RoadDef *road, size_t links) {
+  // Size the grid by the links and lane segments of each road
+  int forward = 0, backward = 0;
+  size_t segmentsPerRoad = 0;
+  for (const RoadDef::Lane &lane : road->lanes)
+    for (const LaneDef::Traffic &traffic : lane.definition->traffic) {
+      bool unordered =
+        lane.direction == RoadDef::Lane::Direction::unordered ||
+        traffic.type   == LaneDef::Traffic::Type::unordered;
+      segmentsPerRoad += unordered ? 2 : 1;
+      if (traffic.category != LaneDef::Traffic::Category::all_vehicles)
+        continue;
+      if (unordered || lane.direction == RoadDef::Lane::Direction::right)
+        forward++;
+      if (unordered || lane.direction == RoadDef::Lane::Direction::left)
+        backward++;
+    }
+  size_t linksPerRoad = (forward > 0) + (backward > 0);
+  if (linksPerRoad == 0)
+    return;
+
+  List<Road *> grid { };
+  List<Intersection *> intersections { };
+  LaneGraph::buildGrid(road, links / linksPerRoad * segmentsPerRoad, grid, intersections);
+  if (grid.isEmpty())
+    return;
+
+  // Zone both sides of every road at random
+  static ZoneDef residential, commercial, industrial;
+  residential.name = "Residential";
+  commercial .name = "Commercial";
+  industrial .name = "Industrial";
+  std::mt19937 random(1);
+  auto pick = [&]() -> ZoneDef * {
+    uint32_t roll = random() % 100;
+    return roll < 50 ? &residential : roll < 70 ? &commercial : roll < 80 ? &industrial : nullptr;
+  };
+  for (Road *r : grid) {
+    r->setLeftZone(pick());
+    r->setRightZone(pick());
+  }
+
+  // How congested the roads are at equilibrium, on one thread
+  size_t levels[TrafficAssignment::congestionLevels] = { 0 };
+  auto run = [&](int threads) {
+    TrafficAssignment assignment;
+    Clock::time_point start = Clock::now();
+    assignment.build(grid);
+    double built = since(start);
+    start = Clock::now();
+    assignment.solve(100, threads);
+    double solved = since(start);
+    printf("  %3d threads  built in %8.1f ms, %2zu iterations to a gap of %.4f in %8.1f ms\n",
+      threads, built / 1000.0, assignment.iterations(), assignment.gap(), solved / 1000.0);
+    if (threads == 1)
+      for (Road *r : grid) {
+        if (forward > 0)
+          levels[TrafficAssignment::level(assignment.congestion(r, true))]++;
+        if (backward > 0)
+          levels[TrafficAssignment::level(assignment.congestion(r, false))]++;
+      }
+  };
+
+  TrafficAssignment sizes;
+  sizes.build(grid);
+  printf("traffic assignment benchmark: %zu nodes, %zu links, %zu districts, %.0f trips/h\n",
+    sizes.nodes(), sizes.links(), sizes.districts(), sizes.trips());
+  run(1);
+  int cores = Jobs::threads() + 1;
+  if (cores > 1)
+    run(cores);
+
+  printf("  links by congestion level:");
+  for (int l = 0; l < TrafficAssignment::congestionLevels; l++)
+    printf(" %zu", levels[l]);
+  printf("\n");
+
+  demolish(grid, intersections);
+}
+
+void Bench::economy(RoadDef *road, size_t lots, float multiplier) {
+  // Size the grid as with `parcels`, about eight lots to a road
+  size_t segmentsPerRoad = 0;
+  for (const RoadDef::Lane &lane : road->lanes)
+    for (const LaneDef::Traffic &traffic : lane.definition->traffic)
+      segmentsPerRoad +=
+        lane.direction == RoadDef::Lane::Direction::unordered ||
+        traffic.type   == LaneDef::Traffic::Type::unordered ? 2 : 1;
+
+  List<Road *> grid { };
+  List<Intersection *> intersections { };
+  LaneGraph::buildGrid(road, std::max(lots / 8, (size_t)1) * segmentsPerRoad, grid, intersections);
+  if (grid.isEmpty())
+    return;
+
+  // Zone every side at random with the loaded zones, or stock zones like
+  // them when there are none
+  static ZoneDef residential, commercial, industrial;
+  residential.name = "Residential";
+  residential.use  = ZoneDef::Use::residential;
+  residential.demand = {
+    { ZoneDef::Demand::Source::base, 100 },
+    { ZoneDef::Demand::Source::frontage, 0.25 },
+    { ZoneDef::Demand::Source::commercial, 2 },
+    { ZoneDef::Demand::Source::industrial, 2 },
+  };
+  commercial.name = "Commercial";
+  commercial.use  = ZoneDef::Use::commercial;
+  commercial.demand = {
+    { ZoneDef::Demand::Source::base, 20 },
+    { ZoneDef::Demand::Source::frontage, 0.2 },
+    { ZoneDef::Demand::Source::residential, 0.3 },
+  };
+  industrial.name = "Industrial";
+  industrial.use  = ZoneDef::Use::industrial;
+  industrial.demand = {
+    { ZoneDef::Demand::Source::base, 20 },
+    { ZoneDef::Demand::Source::frontage, 0.05 },
+    { ZoneDef::Demand::Source::residential, 0.25 },
+  };
+  ZoneDef *zones[] = { &residential, &residential, &commercial, &industrial };
+  if (ZoneDef::zones.has("Residential") && ZoneDef::zones.has("Commercial") &&
+      ZoneDef::zones.has("Industrial")) {
+    zones[0] = zones[1] = &ZoneDef::zones["Residential"];
+    zones[2] = &ZoneDef::zones["Commercial"];
+    zones[3] = &ZoneDef::zones["Industrial"];
+  }
+  std::mt19937 random(1);
+  for (Road *r : grid) {
+    r->setLeftZone (zones[random() % 4]);
+    r->setRightZone(zones[random() % 4]);
+  }
+
+  Parcels parcels;
+  for (Road *r : grid)
+    parcels.invalidate(r);
+  parcels.update();
+
+  // Run the clock exactly, a frame at a time, until the city has stopped
+  // growing for an hour
+  Scheduler scheduler;
+  scheduler.setMultiplier(multiplier);
+  scheduler.setExact(true);
+  Economy economy;
+  Buildings city;
+  const Real frame = 1.0 / 60.0;
+  const double growthBudget = 2000;
+  const double maxTime = 30 * 86400;
+  printf("economy benchmark: %zu roads, %zu lots, %gx real time\n",
+    grid.count(), parcels.count(), (double)multiplier);
+  printf("  %10s %10s %10s %10s %8s %8s %8s %8s\n",
+    "time", "buildings", "residents", "jobs", "unempl.", "R", "C", "I");
+  Clock::time_point start = Clock::now();
+  double report = 0, stalled = 0;
+  size_t frames = 0;
+  while (stalled < 3600 && scheduler.time() < maxTime) {
+    size_t before = city.count();
+    economy.update(parcels);
+    int ticks = scheduler.advance(frame, [&](Real dt) {
+      economy.step(city, dt);
+    });
+    city.grow(parcels, economy, ticks * Scheduler::tick, growthBudget);
+    frames++;
+    stalled = city.count() == before ? stalled + ticks * Scheduler::tick : 0;
+
+    if (scheduler.time() >= report) {
+      printf("  %9.0fs %10zu %10.0f %10.0f %7.1f%% %+8.2f %+8.2f %+8.2f\n",
+        scheduler.time(), city.count(), economy.residents(), economy.jobs(),
+        economy.unemployment() * 100,
+        economy.demand(ZoneDef::Use::residential),
+        economy.demand(ZoneDef::Use::commercial),
+        economy.demand(ZoneDef::Use::industrial));
+      report += 1800;
+    }
+  }
+  double total = since(start) / 1e6;
+
+  printf("  settled after %.0f s simulated in %zu frames (%.2f s, %.0fx real time)\n",
+    scheduler.time(), frames, total, scheduler.time() / total);
+  print(economy);
+  print(scheduler);
+
+  demolish(grid, intersections);
+}
+
+void Bench::pedestrians(RoadDef *road, size_t pedestrians) {
+  // About ten pedestrians to every sidewalk segment
+  size_t segmentsPerRoad = 0, sidewalksPerRoad = 0;
+  for (const RoadDef::Lane &lane : road->lanes)
+    for (const LaneDef::Traffic &traffic : lane.definition->traffic) {
+      size_t segments =
+        lane.direction == RoadDef::Lane::Direction::unordered ||
+        traffic.type   == LaneDef::Traffic::Type::unordered ? 2 : 1;
+      segmentsPerRoad += segments;
+      if (traffic.category == LaneDef::Traffic::Category::all_peds)
+        sidewalksPerRoad += segments;
+    }
+  if (sidewalksPerRoad == 0) {
+    printf("pedestrian benchmark: the road has no sidewalks\n");
+    return;
+  }
+
+  List<Road *> grid { };
+  List<Intersection *> intersections { };
+  LaneGraph::buildGrid(road,
+    std::max(pedestrians / 10 / sidewalksPerRoad, (size_t)1) * segmentsPerRoad, grid, intersections);
+  if (grid.isEmpty())
+    return;
+
+  // Zone both sides of every road at random
+  static ZoneDef residential, commercial, industrial;
+  residential.name = "Residential";
+  residential.use  = ZoneDef::Use::residential;
+  commercial .name = "Commercial";
+  commercial .use  = ZoneDef::Use::commercial;
+  industrial .name = "Industrial";
+  industrial .use  = ZoneDef::Use::industrial;
+  std::mt19937 random(1);
+  auto pick = [&]() -> ZoneDef * {
+    uint32_t roll = random() % 100;
+    return roll < 50 ? &residential : roll < 70 ? &commercial : roll < 80 ? &industrial : nullptr;
+  };
+  for (Road *r : grid) {
+    r->setLeftZone(pick());
+    r->setRightZone(pick());
+  }
+
+  LaneGraph graph;
+  Parcels parcels;
+  for (Road *r : grid) {
+    graph.invalidate(r);
+    parcels.invalidate(r);
+  }
+  graph.update();
+  parcels.update();
+
+  PedestrianSimulation simulation;
+  simulation.sync(graph, parcels);
+  simulation.populate((double)pedestrians);
+  printf("pedestrian benchmark: %zu pedestrians on %zu cells, %zu intersections, %zu lots\n",
+    pedestrians, simulation.cells(), intersections.count(), parcels.count());
+  printf("  routes searched in %.1f ms\n", simulation.stats().routeTime / 1000);
+
+  // Sample the agents around the middle of the grid, as a camera would
+  Real2 center = Real2(0);
+  for (Intersection *intersection : intersections)
+    center = center + intersection->center;
+  center = center / Real2((Real)intersections.count());
+
+  auto time = [&](int threads) {
+    simulation.setThreads(threads);
+    for (int i = 0; i < 20; i++)
+      simulation.step();
+    simulation.resetStats();
+
+    // Sample every tick of the simulation clock, as the game does
+    const int steps = 100;
+    const int ticks = (int)std::lround(PedestrianSimulation::timestep / Scheduler::tick);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < steps * ticks; i++) {
+      simulation.advance(Scheduler::tick);
+      simulation.sample(center, 200);
+    }
+    double perStep = since(start) / steps / 1000;
+    printf("  %2d threads %12.3f ms/step with sampling, %6.1fx real time, %.1f M cell updates/s\n",
+      simulation.threads() + 1, perStep, PedestrianSimulation::timestep * 1000 / perStep,
+      simulation.cells() / perStep / 1000);
+    print(simulation);
+  };
+
+  time(0);
+  if (Jobs::threads() > 0)
+    time(-1);
+
+  demolish(grid, intersections);
+}
+
+
+
+void Bench::print(const TrafficSimulation &simulation) {
+  const TrafficSimulation::Stats &stats = simulation.stats();
+  printf("traffic: %zu vehicles on %zu lanes, %zu intersections giving way, %d worker threads\n",
+    simulation.count(), simulation.lanes(), simulation.signals(), simulation.threads());
+  if (stats.steps == 0)
+    return;
+  double steps = (double)stats.steps;
+  printf("  %zu steps: %.3f ms/step (lanes %.3f, intersections %.3f, transfers %.3f)\n",
+    stats.steps,
+    (stats.laneTime + stats.signalTime + stats.transferTime) / steps / 1000,
+    stats.laneTime / steps / 1000, stats.signalTime / steps / 1000,
+    stats.transferTime / steps / 1000);
+  printf("  %.1f vehicle transfers/step, %zu arrivals\n",
+    stats.transfers / steps, stats.arrivals);
+}
+
+void Bench::print(const TrafficAssignment &assignment) {
+  const TrafficAssignment::Stats &stats = assignment.stats();
+  printf("traffic assignment: %zu nodes, %zu links, %zu districts, %.0f trips/h\n",
+    assignment.nodes(), assignment.links(), assignment.districts(), assignment.trips());
+  printf("  %zu iterations, relative gap %.4f%s\n",
+    assignment.iterations(), assignment.gap(), assignment.converged() ? " (converged)" : "");
+  if (stats.builds > 0)
+    printf("  %zu builds: %.1f ms/build\n",
+      stats.builds, stats.buildTime / stats.builds / 1000.0);
+  if (stats.iterations > 0)
+    printf("  %zu iterations: %.1f ms searching, %.1f ms moving flows per iteration\n",
+      stats.iterations, stats.searchTime / stats.iterations / 1000.0,
+      stats.lineTime / stats.iterations / 1000.0);
+}
+
+void Bench::print(const Economy &economy) {
+  const Economy::Stats &stats = economy.stats();
+  printf("economy: %.0f residents, %.0f workers, %.0f jobs, %.1f%% unemployed, %.1f%% of jobs vacant\n",
+    economy.residents(), economy.workers(), economy.jobs(),
+    economy.unemployment() * 100, economy.vacancy() * 100);
+  for (const Economy::Zone &zone : economy.zones())
+    printf("  %-16s %8.0f m zoned, %10.0f capacity of %10.0f wanted, demand %+.2f\n",
+      (const char *)zone.zone->name, zone.frontage, zone.capacity, zone.wanted, zone.demand);
+  if (stats.steps > 0)
+    printf("  %zu steps, %zu lots counted: %.2f us/step\n",
+      stats.steps, stats.counted, stats.time / stats.steps);
+}
+
+void Bench::print(const Scheduler &scheduler) {
+  const Scheduler::Stats &stats = scheduler.stats();
+  printf("simulation: %.1f s simulated in %zu ticks over %zu frames, %gx speed\n",
+    stats.simulated, stats.ticks, stats.frames, (double)scheduler.multiplier());
+  if (stats.wall > 0)
+    printf("  %.1fx real time (%.2f s of frames)\n", stats.simulated / stats.wall, stats.wall);
+  if (stats.ticks > 0)
+    printf("  %.1f us/tick, %.1f us longest frame, %.1f s dropped\n",
+      stats.time / stats.ticks, stats.longest, stats.dropped);
+}
+
+void Bench::print(const PedestrianSimulation &simulation) {
+  const PedestrianSimulation::Stats &stats = simulation.stats();
+  printf("pedestrians: %.0f walking and %.0f shopping on %zu cells, %zu agents, %d worker threads\n",
+    simulation.count(), simulation.shopping(), simulation.cells(),
+    simulation.agents().count(), simulation.threads());
+  if (stats.routes > 0)
+    printf("  %zu route searches: %.1f ms/search\n",
+      stats.routes, stats.routeTime / stats.routes / 1000);
+  if (stats.steps > 0) {
+    double steps = (double)stats.steps;
+    printf("  %zu steps: %.3f ms/step, %.1f departures, %.1f arrivals and %.1f crossings/step\n",
+      stats.steps, stats.stepTime / steps / 1000, stats.departures / steps,
+      stats.arrivals / steps, stats.crossings / steps);
+  }
+  if (stats.samples > 0)
+    printf("  %zu samples: %.3f ms/sample\n",
+      stats.samples, stats.sampleTime / stats.samples / 1000);
+}
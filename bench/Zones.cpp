@@ -0,0 +1,237 @@
+/**
+ * @file Zones.cpp
+ * @brief Benchmarks and reports on subdividing lots and growing buildings.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include "Bench.h"
+#include <CityBuilder/Roads/LaneGraph.h>
+#include <CityBuilder/Simulation/Economy.h>
+#include <CityBuilder/Zones/Buildings.h>
+#include <CityBuilder/Zones/Parcels.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The time elapsed since a point in time, in milliseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  /// The lane segments that each road of a definition compiles into.
+  size_t segmentsPerRoad(const RoadDef *road) {
+    size_t segments = 0;
+    for (const RoadDef::Lane &lane : road->lanes)
+      for (const LaneDef::Traffic &traffic : lane.definition->traffic)
+        segments +=
+          lane.direction == RoadDef::Lane::Direction::unordered ||
+          traffic.type   == LaneDef::Traffic::Type::unordered ? 2 : 1;
+    return segments;
+  }
+}
+
+
+
+void Bench::parcels(RoadDef *road, size_t lots) {
+  // Size the grid by the lane segments of each road, with about eight lots
+  // to a road of the grid
+  List<Road *> grid { };
+  List<Intersection *> intersections { };
+  LaneGraph::buildGrid(road, std::max(lots / 8, (size_t)1) * segmentsPerRoad(road), grid, intersections);
+  if (grid.isEmpty())
+    return;
+
+  // Zone both sides of every road at random
+  static ZoneDef residential, commercial, industrial;
+  residential.name = "Residential";
+  commercial .name = "Commercial";
+  industrial .name = "Industrial";
+  ZoneDef *zones[] = { &residential, &commercial, &industrial };
+  std::mt19937 random(1);
+  for (Road *r : grid) {
+    r->setLeftZone (zones[random() % 3]);
+    r->setRightZone(zones[random() % 3]);
+  }
+
+  Parcels parcels;
+  auto time = [&](const char *name, auto change) {
+    Parcels::Stats before = parcels.stats();
+    Clock::time_point start = Clock::now();
+    change();
+    parcels.update();
+    double elapsed = since(start);
+    printf("  %-24s %10.3f ms (%zu placed, %zu clipped, %zu freed)\n", name, elapsed,
+      parcels.stats().placed  - before.placed,
+      parcels.stats().clipped - before.clipped,
+      parcels.stats().freed   - before.freed);
+  };
+
+  printf("parcel benchmark: %zu roads, %zu intersections\n",
+    grid.count(), intersections.count());
+  time("full subdivision", [&] {
+    for (Road *r : grid)
+      parcels.invalidate(r);
+  });
+  size_t buildable = 0;
+  for (const Parcels::Lot &lot : parcels.lots())
+    buildable += lot.buildable();
+  printf("  %zu lots, %zu buildable\n", parcels.count(), buildable);
+
+  // Edit a road in the middle of the city
+  intptr_t index = grid.count() / 2;
+  Road *middle = grid[index];
+  time("zone one side", [&] {
+    middle->setRightZone(middle->rightZone() == &residential ? &commercial : &residential);
+    parcels.invalidate(middle);
+  });
+
+  Road *first = nullptr, *second = nullptr;
+  time("split one road", [&] {
+    first  = new Road(road, middle->path.path().split(0, 0.5));
+    second = new Road(road, middle->path.path().split(0.5, 1));
+    for (Road *piece : { first, second }) {
+      piece->setLeftZone (middle->leftZone());
+      piece->setRightZone(middle->rightZone());
+    }
+    first ->start = middle->start;
+    second->end   = middle->end;
+    parcels.split(middle, { first, second });
+    parcels.remove(middle);
+    parcels.invalidate(first);
+    parcels.invalidate(second);
+  });
+  delete middle;
+  grid[index] = first;
+  grid.append(second);
+
+  time("remove one road", [&] { parcels.remove(second); });
+
+  for (Road *r : grid)
+    delete r;
+  for (Intersection *intersection : intersections)
+    delete intersection;
+}
+
+void Bench::buildings(RoadDef *road, size_t buildings) {
+  // Size the grid by the lane segments of each road, with about eight lots
+  // to a road of the grid as with `parcels`, half of which are corner lots
+  // too small to build on
+  List<Road *> grid { };
+  List<Intersection *> intersections { };
+  LaneGraph::buildGrid(road, std::max(buildings / 4, (size_t)1) * segmentsPerRoad(road), grid, intersections);
+  if (grid.isEmpty())
+    return;
+
+  // Zone every side at random, with the demand of the stock zones
+  static ZoneDef residential, commercial, industrial;
+  residential.name = "Residential";
+  residential.use  = ZoneDef::Use::residential;
+  residential.demand = {
+    { ZoneDef::Demand::Source::base, 100 },
+    { ZoneDef::Demand::Source::frontage, 0.25 },
+    { ZoneDef::Demand::Source::commercial, 2 },
+    { ZoneDef::Demand::Source::industrial, 2 },
+  };
+  commercial.name = "Commercial";
+  commercial.use  = ZoneDef::Use::commercial;
+  commercial.demand = {
+    { ZoneDef::Demand::Source::base, 20 },
+    { ZoneDef::Demand::Source::frontage, 0.2 },
+    { ZoneDef::Demand::Source::residential, 0.3 },
+  };
+  industrial.name = "Industrial";
+  industrial.use  = ZoneDef::Use::industrial;
+  industrial.demand = {
+    { ZoneDef::Demand::Source::base, 20 },
+    { ZoneDef::Demand::Source::frontage, 0.05 },
+    { ZoneDef::Demand::Source::residential, 0.25 },
+  };
+  ZoneDef *zones[] = { &residential, &residential, &commercial, &industrial };
+  std::mt19937 random(1);
+  for (Road *r : grid) {
+    r->setLeftZone (zones[random() % 4]);
+    r->setRightZone(zones[random() % 4]);
+  }
+
+  Parcels parcels;
+  for (Road *r : grid)
+    parcels.invalidate(r);
+  parcels.update();
+
+  // Grow a frame at a time, fast-forwarding so that only the budget holds
+  // the growth back
+  const double budget = 2000;
+  const Real elapsed = 60;
+  Economy economy;
+  Buildings city;
+  Clock::time_point start = Clock::now();
+  size_t frames = 0, stalled = 0;
+  while (stalled < 8) {
+    size_t before = city.count();
+    economy.update(parcels);
+    economy.step(city, elapsed);
+    city.grow(parcels, economy, elapsed, budget);
+    frames++;
+    stalled = city.count() == before && city.unchecked() == 0 ? stalled + 1 : 0;
+  }
+  double total = since(start);
+
+  printf("building benchmark: %zu roads, %zu lots\n", grid.count(), parcels.count());
+  printf("  grown                    %zu buildings in %zu frames (%.1f ms)\n",
+    city.count(), frames, total);
+  printf("  per frame                %.1f us mean, %.1f us longest, %.0f us budget\n",
+    city.stats().time / city.stats().ticks, city.stats().longest, budget);
+
+  // Remove a road in the middle of the city and catch up with it
+  city.resetStats();
+  Road *middle = grid[grid.count() / 2];
+  parcels.remove(middle);
+  parcels.update();
+  economy.update(parcels);
+  city.grow(parcels, economy, 0, budget);
+  printf("  remove one road          %.3f ms (%zu lots checked, %zu demolished)\n",
+    city.stats().time / 1000, city.stats().checked, city.stats().demolished);
+  print(city);
+
+  for (Road *r : grid)
+    delete r;
+  for (Intersection *intersection : intersections)
+    delete intersection;
+}
+
+
+
+void Bench::print(const Parcels &parcels) {
+  const Parcels::Stats &stats = parcels.stats();
+  size_t buildable = 0;
+  for (const Parcels::Lot &lot : parcels.lots())
+    buildable += lot.buildable();
+  printf("parcels: %zu lots (%zu buildable), %zu slots\n",
+    parcels.count(), buildable, parcels.lots().count());
+  if (stats.updates > 0)
+    printf("  %zu updates: %zu placed, %zu clipped, %zu freed, %.1f us/update\n",
+      stats.updates, stats.placed, stats.clipped, stats.freed,
+      stats.time / stats.updates);
+}
+
+void Bench::print(const Buildings &buildings) {
+  const Buildings::Stats &stats = buildings.stats();
+  printf("buildings: %zu standing on %zu lot slots, %.0f residents, %.0f commercial jobs, %.0f industrial jobs\n",
+    buildings.count(), buildings.buildings().count(),
+    buildings.capacity(ZoneDef::Use::residential),
+    buildings.capacity(ZoneDef::Use::commercial),
+    buildings.capacity(ZoneDef::Use::industrial));
+  for (const Buildings::Zone &zone : buildings.zones())
+    printf("  %-16s %10.0f capacity, %zu lots queued\n",
+      (const char *)zone.zone->name, zone.capacity, zone.vacant.count());
+  if (stats.ticks > 0)
+    printf("  %zu ticks: %zu built, %zu demolished, %zu lots checked, %.1f us/tick, %.1f us longest\n",
+      stats.ticks, stats.built, stats.demolished, stats.checked,
+      stats.time / stats.ticks, stats.longest);
+}
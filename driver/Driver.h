@@ -13,10 +13,69 @@ NS_CITY_BUILDER_BEGIN
 namespace Driver {
 
 /// A platform-specific main driver.
+/// \param[in] argc
+///   The number of command line arguments.
+/// \param[in] argv
+///   The command line arguments.
 /// \remarks
 ///   Call from your program's main to start the Renderer main loop.
-void main();
+void main(int argc, char **argv);
 
+/// The settings of the game chosen at launch, shared by every driver.
+struct Settings {
+  /// The number of top mip levels to hold back from streamed textures.
+  int mipBias = 0;
+
+  /// Whether to load static meshes with packed vertices.
+  bool packedVertices = false;
+
+  /// Whether to extrude roads on the GPU rather than the CPU.
+  bool gpuRoads = false;
+
+  /// The number of worker threads of the job system, or -1 for one less
+  /// than the number of cores.
+  int jobThreads = -1;
+
+  /// The number of worker threads to record draw calls with, or -1 for
+  /// every worker thread of the job system.
+  int recordThreads = -1;
+};
+
+/// Parse a setting from the command line.
+/// \param[in,out] settings
+///   The settings to write the setting to.
+/// \param[in] argc
+///   The number of command line arguments.
+/// \param[in] argv
+///   The command line arguments.
+/// \param[in,out] i
+///   The index of the argument to parse, moved past any value it takes.
+/// \returns
+///   Whether or not the argument is a setting.
+bool parseSetting(Settings &settings, int argc, char **argv, int &i);
+
+/// Apply the settings to the game.
+/// \param[in] settings
+///   The settings to apply.
+/// \remarks
+///   Must be called before `Events::start`.
+void applySettings(const Settings &settings);
+
+/// Load a resource file in its entirety.
+/// \param[in] name
+///   The resource name, relative to the resource root.
+/// \param[in] extension
+///   The file extension of the resource.
+/// \param[out] contents
+///   The null-terminated contents of the file, to be released with `free`.
+/// \param[out] length
+///   The length of the file, excluding the null-terminator.
+/// \returns
+///   Whether or not the resource could be loaded.
+/// \remarks
+///   Resources in the open asset archive (see `Archive`) are read from the
+///   archive, otherwise from their own file.
+///   Textures in the archive are stored without their file header.
 bool loadResource(
   const char  *name     ,
   const char  *extension,
@@ -0,0 +1,538 @@
+/**
+ * @file Headless.cpp
+ * @brief A headless program driver for automated performance runs.
+ * @date May 2, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include "Driver.h"
+#include "../bench/Bench.h"
+#include <CityBuilder/Game.h>
+#include <CityBuilder/Input.h>
+#include <CityBuilder/Jobs.h>
+#include <CityBuilder/Rendering/DrawList.h>
+#include <CityBuilder/Roads/LaneGraph.h>
+#include <CityBuilder/Simulation/Scheduler.h>
+#include <CityBuilder/Simulation/TrafficSimulation.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Tools/Archive.h>
+#include <bgfx/platform.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+USING_NS_CITY_BUILDER
+
+
+
+// ===--- Options -----------------------------------------------------------===
+
+namespace {
+
+  /// The options for a headless run.
+  struct Options {
+    /// The number of frames to run.
+    int frames = 600;
+
+    /// The fixed timestep to advance each frame by, in seconds.
+    double timestep = 1.0 / 60.0;
+
+    /// The width of the virtual back buffer, in pixels.
+    int width = 1280;
+
+    /// The height of the virtual back buffer, in pixels.
+    int height = 720;
+
+    /// The directory to load resources from.
+    const char *resources = "Resources";
+
+    /// The scripted input file to replay, if any.
+    const char *input = nullptr;
+
+    /// The file to write the per-frame timings to, if any.
+    const char *output = nullptr;
+
+    /// The settings of the game.
+    Driver::Settings settings;
+
+    /// Whether to submit draw lists in the order they were added, setting
+    /// every binding for every draw.
+    bool unsortedDraws = false;
+
+    /// The number of vehicles to spread over the roads once there are any.
+    int vehicles = 0;
+
+    /// Whether to assign traffic to the roads as a whole instead of
+    /// simulating vehicles.
+    bool macroscopic = false;
+
+    /// How many times faster than real time to simulate, if not 1;
+    /// `INFINITY` to simulate as fast as the budget allows.
+    float simSpeed = 1;
+
+    /// The file to write a trace of every job to, if any.
+    const char *jobTrace = nullptr;
+
+    /// The benchmarks to run and the reports to print.
+    Bench::Options bench;
+  } options;
+
+  void usage(const char *program) {
+    std::cout
+      << "Usage: " << program << " [options]\n"
+      << "  --frames <n>        The number of frames to run (default 600).\n"
+      << "  --timestep <s>      The fixed timestep in seconds (default 1/60).\n"
+      << "  --size <w> <h>      The virtual back buffer size (default 1280 720).\n"
+      << "  --resources <dir>   The resource directory (default Resources).\n"
+      << "  --input <file>      A scripted input file to replay.\n"
+      << "  --output <file>     Write per-frame CPU timings as CSV.\n"
+      << "  --mip-bias <n>      Hold back the top n mip levels of streamed\n"
+      << "                      textures until the camera is close.\n"
+      << "  --packed-vertices   Load static meshes with packed vertices.\n"
+      << "  --record-threads <n>\n"
+      << "                      Record draw calls on n worker threads as well\n"
+      << "                      as the main thread (default every job worker).\n"
+      << "  --unsorted-draws    Submit draw lists unsorted, binding everything\n"
+      << "                      for every draw.\n"
+      << "  --gpu-roads         Extrude roads along their curves on the GPU.\n"
+      << "  --vehicles <n>      Spread n vehicles over the roads once any are\n"
+      << "                      built, and draw them every frame.\n"
+      << "  --macroscopic       Assign traffic to the roads as a whole and\n"
+      << "                      show their congestion, printing the assignment\n"
+      << "                      at the end.\n"
+      << "  --sim-speed <n|max> Simulate n times faster than real time, every\n"
+      << "                      tick owed, or as fast as the budget allows.\n"
+      << "  --job-threads <n>   Run jobs on n worker threads as well as the main\n"
+      << "                      thread (default one per extra core).\n"
+      << "  --job-trace <file>  Write every job run as a Chrome trace.\n";
+    Bench::usage();
+  }
+
+  bool parseOptions(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+      const char *arg = argv[i];
+      bool hasValue = i + 1 < argc;
+
+      if (Driver::parseSetting(options.settings, argc, argv, i))
+        continue;
+      else if (Bench::parseOption(options.bench, argc, argv, i))
+        continue;
+      else if (strcmp(arg, "--frames") == 0 && hasValue)
+        options.frames = atoi(argv[++i]);
+      else if (strcmp(arg, "--timestep") == 0 && hasValue)
+        options.timestep = atof(argv[++i]);
+      else if (strcmp(arg, "--size") == 0 && i + 2 < argc) {
+        options.width  = atoi(argv[++i]);
+        options.height = atoi(argv[++i]);
+      } else if (strcmp(arg, "--resources") == 0 && hasValue)
+        options.resources = argv[++i];
+      else if (strcmp(arg, "--input") == 0 && hasValue)
+        options.input = argv[++i];
+      else if (strcmp(arg, "--output") == 0 && hasValue)
+        options.output = argv[++i];
+      else if (strcmp(arg, "--unsorted-draws") == 0)
+        options.unsortedDraws = true;
+      else if (strcmp(arg, "--vehicles") == 0 && hasValue)
+        options.vehicles = atoi(argv[++i]);
+      else if (strcmp(arg, "--macroscopic") == 0)
+        options.macroscopic = true;
+      else if (strcmp(arg, "--sim-speed") == 0 && hasValue) {
+        const char *speed = argv[++i];
+        options.simSpeed = strcmp(speed, "max") == 0 ? INFINITY : (float)atof(speed);
+      } else if (strcmp(arg, "--job-trace") == 0 && hasValue)
+        options.jobTrace = argv[++i];
+      else {
+        usage(argv[0]);
+        return false;
+      }
+    }
+
+    if (options.frames <= 0 || options.timestep <= 0 ||
+        options.width <= 0 || options.height <= 0) {
+      usage(argv[0]);
+      return false;
+    }
+
+    return true;
+  }
+
+}
+
+
+
+// ===--- Scripted Input ----------------------------------------------------===
+
+namespace {
+
+  /// A single input event replayed at a given frame.
+  struct ScriptedInput {
+    /// How the event is delivered to the driver.
+    enum class Action : uint8_t {
+      start , //< Delivered through `Events::inputStart`.
+      change, //< Delivered through `Events::inputChange`.
+      stop  , //< Delivered through `Events::inputStop`.
+    };
+
+    /// The frame on which the event is delivered.
+    int frame;
+
+    /// How the event is delivered.
+    Action action;
+
+    /// The event itself.
+    Events::Input input;
+  };
+
+  /// The names of the keys that can be used in an input script.
+  const struct {
+    const char *name;
+    KeyCode code;
+  } keyNames[] = {
+    { "q", KeyCode::q }, { "w", KeyCode::w }, { "e", KeyCode::e },
+    { "r", KeyCode::r }, { "t", KeyCode::t }, { "y", KeyCode::y },
+    { "u", KeyCode::u }, { "i", KeyCode::i }, { "o", KeyCode::o },
+    { "p", KeyCode::p }, { "a", KeyCode::a }, { "s", KeyCode::s },
+    { "d", KeyCode::d }, { "f", KeyCode::f }, { "g", KeyCode::g },
+    { "h", KeyCode::h }, { "j", KeyCode::j }, { "k", KeyCode::k },
+    { "l", KeyCode::l }, { "z", KeyCode::z }, { "x", KeyCode::x },
+    { "c", KeyCode::c }, { "v", KeyCode::v }, { "b", KeyCode::b },
+    { "n", KeyCode::n }, { "m", KeyCode::m },
+    { "0", KeyCode::_0 }, { "1", KeyCode::_1 }, { "2", KeyCode::_2 },
+    { "3", KeyCode::_3 }, { "4", KeyCode::_4 }, { "5", KeyCode::_5 },
+    { "6", KeyCode::_6 }, { "7", KeyCode::_7 }, { "8", KeyCode::_8 },
+    { "9", KeyCode::_9 },
+    { "space", KeyCode::space }, { "tab", KeyCode::tab },
+    { "enter", KeyCode::enter }, { "escape", KeyCode::escape },
+    { "backspace", KeyCode::backspace },
+    { "shift", KeyCode::leftShift }, { "control", KeyCode::leftControl },
+    { "option", KeyCode::leftOption }, { "command", KeyCode::leftCommand },
+    { "left", KeyCode::left }, { "right", KeyCode::right },
+    { "up", KeyCode::up }, { "down", KeyCode::down },
+  };
+
+  /// Load an input script.
+  /// \param[in] path
+  ///   The path of the script to load.
+  /// \param[out] script
+  ///   The events in the script, ordered by frame.
+  /// \returns
+  ///   Whether or not the script was loaded successfully.
+  /// \remarks
+  ///   Each line of a script is an event in the form `<frame> <event> [args]`
+  ///   where the event is one of:
+  ///     key-down <key>, key-up <key>,
+  ///     mouse-down <button>, mouse-up <button>,
+  ///     mouse-move <x> <y>, mouse-drag <x> <y> <button>,
+  ///     scroll <x> <y>, pinch <amount>.
+  ///   Blank lines and lines starting with `#` are ignored.
+  bool loadScript(const char *path, List<ScriptedInput> &script) {
+    std::ifstream file(path);
+    if (!file) {
+      std::cout << "Failed to load input script '" << path << "'." << std::endl;
+      return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+      lineNumber++;
+      std::istringstream stream(line);
+
+      std::string event;
+      ScriptedInput scripted = {};
+      if (!(stream >> scripted.frame))
+        // Comment or blank line
+        continue;
+      stream >> event;
+
+      Events::Input &input = scripted.input;
+      bool valid = true;
+
+      if (event == "key-down" || event == "key-up") {
+        std::string name;
+        stream >> name;
+        valid = false;
+        for (auto &key : keyNames)
+          if (name == key.name) {
+            input.keyboard.keyCode = (unsigned short)key.code;
+            valid = true;
+            break;
+          }
+        input.type = Events::Input::Type::keyboard;
+        scripted.action = event == "key-down" ?
+          ScriptedInput::Action::start : ScriptedInput::Action::stop;
+      } else if (event == "mouse-down" || event == "mouse-up") {
+        valid = (bool)(stream >> input.mouseButton.button);
+        input.type = Events::Input::Type::mouseButton;
+        scripted.action = event == "mouse-down" ?
+          ScriptedInput::Action::start : ScriptedInput::Action::stop;
+      } else if (event == "mouse-move") {
+        float x, y;
+        valid = (bool)(stream >> x >> y);
+        input.mousePosition = Real2(x, y);
+        input.type = Events::Input::Type::mouseMove;
+        scripted.action = ScriptedInput::Action::change;
+      } else if (event == "mouse-drag") {
+        float x, y;
+        valid = (bool)(stream >> x >> y >> input.mouseDrag.button);
+        input.mouseDrag.position = Real2(x, y);
+        input.type = Events::Input::Type::mouseDrag;
+        scripted.action = ScriptedInput::Action::change;
+      } else if (event == "scroll") {
+        float x, y;
+        valid = (bool)(stream >> x >> y);
+        input.mouseScroll = Real2(x, y);
+        input.type = Events::Input::Type::mouseScroll;
+        scripted.action = ScriptedInput::Action::change;
+      } else if (event == "pinch") {
+        float amount;
+        valid = (bool)(stream >> amount);
+        input.mousePinch = amount;
+        input.type = Events::Input::Type::mousePinch;
+        scripted.action = ScriptedInput::Action::change;
+      } else
+        valid = false;
+
+      if (!valid) {
+        std::cout << "Error in '" << path << "' at line " << lineNumber
+          << ": invalid event '" << line << "'." << std::endl;
+        return false;
+      }
+
+      script.append(scripted);
+    }
+
+    // Deliver events in frame order, keeping the order within a frame
+    std::stable_sort(script.begin(), script.end(),
+      [](const ScriptedInput &a, const ScriptedInput &b) {
+        return a.frame < b.frame;
+      }
+    );
+
+    return true;
+  }
+
+  /// Deliver a scripted event to the driver.
+  void replay(ScriptedInput &scripted) {
+    switch (scripted.action) {
+    case ScriptedInput::Action::start : Events::inputStart (scripted.input); break;
+    case ScriptedInput::Action::change: Events::inputChange(scripted.input); break;
+    case ScriptedInput::Action::stop  : Events::inputStop  (scripted.input); break;
+    }
+  }
+
+}
+
+
+
+// ===--- Timings -----------------------------------------------------------===
+
+namespace {
+
+  /// The CPU time spent in a single frame.
+  struct FrameTiming {
+    /// The time spent in `Events::update`, in microseconds.
+    double update;
+
+    /// The time spent submitting the frame to bgfx, in microseconds.
+    double submit;
+  };
+
+  /// Get a percentile of a sorted set of samples.
+  double percentile(const List<double> &sorted, double p) {
+    size_t index = (size_t)(p * (sorted.count() - 1) + 0.5);
+    return sorted[index];
+  }
+
+  /// Write the per-frame timings and print a summary.
+  void report(const List<FrameTiming> &timings) {
+    if (options.output != nullptr) {
+      FILE *file = fopen(options.output, "w");
+      if (file == NULL)
+        std::cout << "Failed to open '" << options.output << "'." << std::endl;
+      else {
+        fprintf(file, "frame,update_us,submit_us,total_us\n");
+        int frame = 0;
+        for (const FrameTiming &timing : timings)
+          fprintf(file, "%d,%.3f,%.3f,%.3f\n",
+            frame++, timing.update, timing.submit, timing.update + timing.submit);
+        fclose(file);
+      }
+    }
+
+    List<double> totals { };
+    double sum = 0;
+    for (const FrameTiming &timing : timings) {
+      totals.append(timing.update + timing.submit);
+      sum += timing.update + timing.submit;
+    }
+    if (totals.isEmpty())
+      return;
+    std::sort(totals.begin(), totals.end());
+
+    printf(
+      "%zu frames: mean %.1f us, p50 %.1f us, p95 %.1f us, p99 %.1f us, max %.1f us\n",
+      totals.count(), sum / totals.count(),
+      percentile(totals, 0.50), percentile(totals, 0.95),
+      percentile(totals, 0.99), totals.last()
+    );
+  }
+
+}
+
+
+
+// ===--- Program Driver ----------------------------------------------------===
+
+void Driver::main(int argc, char **argv) {
+  if (!parseOptions(argc, argv))
+    exit(1);
+
+  List<ScriptedInput> script { };
+  if (options.input != nullptr && !loadScript(options.input, script))
+    exit(1);
+
+
+
+  // Prefer the packed assets over loose resource files when they exist
+  Archive::open((std::string(options.resources) + "/assets.pack").c_str());
+
+
+
+  // Setup bgfx without a window or GPU, rendering on this thread
+  bgfx::renderFrame();
+
+  bgfx::Init init;
+  init.type = bgfx::RendererType::Noop;
+  init.resolution.width  = options.width;
+  init.resolution.height = options.height;
+  init.resolution.reset = BGFX_RESET_NONE;
+  if (!bgfx::init(init))
+    exit(1);
+
+  bgfx::setViewClear(0, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH);
+  bgfx::setViewRect(0, 0, 0, bgfx::BackbufferRatio::Equal);
+
+
+
+  // Setup the driver
+  Events::setFixedTimestep(options.timestep);
+  Driver::applySettings(options.settings);
+  Jobs::setTracing(options.jobTrace != nullptr);
+  DrawList::setSorting(!options.unsortedDraws);
+  Events::start();
+  Events::resize({ 0, 0, (Real)options.width, (Real)options.height });
+
+  Bench::run(options.bench);
+  if (options.macroscopic)
+    Game::instance().setMacroscopicTraffic(true);
+
+  // Run every tick owed at a fixed speed, so runs are reproducible
+  Scheduler &scheduler = Game::instance().scheduler();
+  scheduler.setMultiplier(options.simSpeed);
+  scheduler.setExact(!std::isinf(options.simSpeed));
+
+
+
+  // Main loop
+  using Clock = std::chrono::steady_clock;
+  auto micro = [](Clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  };
+
+  List<FrameTiming> timings { };
+  size_t next = 0;
+
+  for (int frame = 0; frame < options.frames; frame++) {
+    // Replay any input for this frame
+    while (next < script.count() && script[next].frame <= frame)
+      replay(script[next++]);
+
+    Clock::time_point start = Clock::now();
+
+    // Fill the roads with vehicles as soon as there are roads to fill
+    Game &game = Game::instance();
+    if (options.vehicles > 0 && game.roads().laneGraph().count() > 0) {
+      game.traffic().sync(game.roads().laneGraph());
+      game.traffic().populate(options.vehicles);
+      options.vehicles = 0;
+    }
+
+    // Let the driver do what it needs to do
+    bgfx::touch(0);
+    Events::update();
+
+    Clock::time_point updated = Clock::now();
+
+    // Submit the frame
+    bgfx::frame();
+
+    Clock::time_point end = Clock::now();
+    timings.append({ micro(updated - start), micro(end - updated) });
+  }
+
+  if (options.macroscopic) {
+    // Wait for the assignment to finish its iteration before reporting on it
+    Game::instance().setMacroscopicTraffic(false);
+    Bench::print(Game::instance().assignment());
+  }
+
+  Bench::report(options.bench, options.frames);
+
+  if (options.jobTrace && !Jobs::writeTrace(options.jobTrace))
+    std::cout << "Failed to write the job trace '" << options.jobTrace << "'." << std::endl;
+
+  Events::stop();
+  report(timings);
+}
+
+
+
+// ===--- Resource Handling -------------------------------------------------===
+
+bool Driver::loadResource(
+  const char  *name     ,
+  const char  *extension,
+        char **contents ,
+  size_t      *length
+) {
+  if (const Archive::Entry *entry = Archive::find(name, extension)) {
+    *length = entry->length;
+    *contents = (char *)malloc(*length + 1);
+    memcpy(*contents, Archive::data(entry), *length + 1);
+    return true;
+  }
+
+  std::string path = std::string(options.resources) + "/" + name + "." + extension;
+
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == NULL)
+    return false;
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (size < 0) {
+    fclose(file);
+    return false;
+  }
+  *length = size;
+
+  // Hand back nothing rather than a partly filled buffer
+  *contents = (char *)malloc(*length + 1);
+  if (fread((void *)*contents, 1, *length, file) != *length) {
+    free(*contents);
+    *contents = nullptr;
+    fclose(file);
+    return false;
+  }
+  (*contents)[*length] = 0;
+  fclose(file);
+
+  return true;
+}
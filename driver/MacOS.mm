@@ -8,6 +8,7 @@
 #include "Driver.h"
 #import <Foundation/Foundation.h>
 #import <AppKit/AppKit.h>
+#include <CityBuilder/Tools/Archive.h>
 #include <bgfx/platform.h>
 USING_NS_CITY_BUILDER
 
@@ -121,7 +122,7 @@ namespace {
 
 
 
-void Driver::main() {
+void Driver::main(int argc, char **argv) {
   @autoreleasepool {
     // Setup the main window
     NSRect mainDisplayRect = [[NSScreen mainScreen] frame];
@@ -151,6 +152,13 @@ void Driver::main() {
     
     
     
+    // Prefer the packed assets over loose resource files when they exist
+    NSString *pack = [[NSBundle mainBundle] pathForResource:@"assets" ofType:@"pack"];
+    if (pack != nil)
+      Archive::open([pack cStringUsingEncoding:NSUTF8StringEncoding]);
+    
+    
+    
     // Setup bgfx
     bgfx::renderFrame();
     
@@ -170,7 +178,12 @@ void Driver::main() {
     
     
     
-    // Setup the driver
+    // Setup the driver with any settings from the command line, ignoring the
+    // arguments that the system launches the program with
+    Driver::Settings settings;
+    for (int i = 1; i < argc; i++)
+      Driver::parseSetting(settings, argc, argv, i);
+    Driver::applySettings(settings);
     Events::start();
     Events::resize({
       windowRect.origin.x * window.backingScaleFactor,
@@ -380,6 +393,13 @@ bool Driver::loadResource(
         char **contents ,
   size_t      *length
 ) {
+  if (const Archive::Entry *entry = Archive::find(name, extension)) {
+    *length = entry->length;
+    *contents = (char *)malloc(*length + 1);
+    memcpy(*contents, Archive::data(entry), *length + 1);
+    return true;
+  }
+  
   @autoreleasepool {
     NSString *_name      = [NSString stringWithCString:name
                                               encoding:NSUTF8StringEncoding];
@@ -0,0 +1,45 @@
+/**
+ * @file Settings.cpp
+ * @brief The game settings shared by every program driver.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include "Driver.h"
+#include <CityBuilder/Jobs.h>
+#include <CityBuilder/Rendering/CommandRecorder.h>
+#include <CityBuilder/Rendering/CurveExtrusion.h>
+#include <CityBuilder/Rendering/TextureLoader.h>
+#include <CityBuilder/Rendering/VertexPacking.h>
+#include <cstdlib>
+#include <cstring>
+USING_NS_CITY_BUILDER
+
+
+
+bool Driver::parseSetting(Settings &settings, int argc, char **argv, int &i) {
+  const char *arg = argv[i];
+  bool hasValue = i + 1 < argc;
+
+  if (strcmp(arg, "--mip-bias") == 0 && hasValue)
+    settings.mipBias = atoi(argv[++i]);
+  else if (strcmp(arg, "--packed-vertices") == 0)
+    settings.packedVertices = true;
+  else if (strcmp(arg, "--gpu-roads") == 0)
+    settings.gpuRoads = true;
+  else if (strcmp(arg, "--job-threads") == 0 && hasValue)
+    settings.jobThreads = atoi(argv[++i]);
+  else if (strcmp(arg, "--record-threads") == 0 && hasValue)
+    settings.recordThreads = atoi(argv[++i]);
+  else
+    return false;
+  return true;
+}
+
+void Driver::applySettings(const Settings &settings) {
+  TextureLoader::setMipBias(settings.mipBias);
+  VertexPacking::setEnabled(settings.packedVertices);
+  CurveExtrusion::setEnabled(settings.gpuRoads);
+  Jobs::setThreads(settings.jobThreads);
+  CommandRecorder::setThreads(settings.recordThreads);
+}
@@ -8,6 +8,6 @@
 #include "Driver.h"
 
 int main(int argc, char** argv) {
-  NS_CITY_BUILDER Driver::main();
+  NS_CITY_BUILDER Driver::main(argc, argv);
   return 0;
 }
@@ -20,6 +20,14 @@ void start();
 ///   Should produce something to render.
 void update();
 
+/// Use a fixed timestep for every update instead of the measured frame time.
+/// \param dt
+///   The fixed timestep, in seconds, or zero to go back to the measured frame
+///   time.
+/// \remarks
+///   Used by the headless driver for reproducible runs.
+void setFixedTimestep(double dt);
+
 /// Called when the program is paused.
 /// \remarks.
 ///  Should produce a pause screen to render.
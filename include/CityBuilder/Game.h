@@ -10,9 +10,19 @@
 #include "Rendering/OrbitalCamera.h"
 #include "Rendering/DistanceLight.h"
 #include "Rendering/Object.h"
+#include "Rendering/Frustum.h"
 #include "Roads/RoadNetwork.h"
+#include "Simulation/TrafficSimulation.h"
+#include "Simulation/TrafficAssignment.h"
+#include "Simulation/PedestrianSimulation.h"
+#include "Simulation/Scheduler.h"
+#include "Simulation/Economy.h"
+#include "Rendering/VehicleBatch.h"
+#include "Rendering/BuildingBatch.h"
+#include "Zones/Buildings.h"
 #include "Geometry/Ray3.h"
 #include "Input.h"
+#include <future>
 
 NS_CITY_BUILDER_BEGIN
 
@@ -41,6 +51,64 @@ struct Game {
     return _roads;
   }
   
+  /// The vehicles on the roads.
+  inline TrafficSimulation &traffic() {
+    return _traffic;
+  }
+  
+  /// The vehicles drawn on the roads.
+  inline VehicleBatch &vehicles() {
+    return _vehicles;
+  }
+  
+  /// The pedestrians on the sidewalks.
+  inline PedestrianSimulation &pedestrians() {
+    return _pedestrians;
+  }
+  
+  /// The pedestrians drawn near the camera.
+  inline VehicleBatch &walkers() {
+    return _walkers;
+  }
+  
+  /// The buildings grown on the zoned lots.
+  inline Buildings &buildings() {
+    return _buildings;
+  }
+  
+  /// The buildings drawn on their lots.
+  inline BuildingBatch &buildingBatch() {
+    return _buildingBatch;
+  }
+  
+  /// The clock of the simulation.
+  inline Scheduler &scheduler() {
+    return _scheduler;
+  }
+  
+  /// The residents and jobs of the city and the demand for zones.
+  inline Economy &economy() {
+    return _economy;
+  }
+  
+  /// The traffic assigned to the roads as a whole, rather than vehicle by
+  /// vehicle.
+  inline TrafficAssignment &assignment() {
+    return _assignment;
+  }
+  
+  /// Whether traffic is assigned to the roads as a whole and shown as their
+  /// congestion, rather than simulated vehicle by vehicle.
+  inline bool macroscopicTraffic() const {
+    return _macroscopic;
+  }
+  
+  /// Switch between assigning traffic to the roads as a whole and simulating
+  /// it vehicle by vehicle.
+  /// \param[in] macroscopic
+  ///   Whether to assign traffic to the roads as a whole.
+  void setMacroscopicTraffic(bool macroscopic);
+  
   /// The current game instance.
   inline static Game &instance() {
     return *_instance;
@@ -56,11 +124,21 @@ struct Game {
   void update(Real elapsed);
   
   /// Draw the game scene.
+  /// \remarks
+  ///   The visible parts of the scene are added as `CommandRecorder` tasks,
+  ///   which are recorded once the rest of the frame has been added.
   void draw();
   
   /// Draw any hovers in the game scene.
+  /// \remarks
+  ///   The hovers are added as a `CommandRecorder` task.
   void drawHovers();
   
+  /// The culling statistics of the last `draw`.
+  inline const Frustum::Stats &cullStats() const {
+    return _cullStats;
+  }
+  
   /// A description of the action the user is currently performing.
   enum class Action {
     /// The user is not performing any actions, simply observing.
@@ -95,6 +173,52 @@ private:
   /// The road network.
   RoadNetwork _roads;
   
+  /// The vehicles on the roads.
+  TrafficSimulation _traffic;
+  
+  /// The vehicles drawn on the roads.
+  VehicleBatch _vehicles;
+  
+  /// The pedestrians on the sidewalks.
+  PedestrianSimulation _pedestrians;
+  
+  /// The pedestrians drawn near the camera.
+  VehicleBatch _walkers { VehicleBatch::Body::pedestrian };
+  
+  /// The buildings grown on the zoned lots.
+  Buildings _buildings;
+  
+  /// The buildings drawn on their lots.
+  BuildingBatch _buildingBatch;
+  
+  /// The clock of the simulation.
+  Scheduler _scheduler;
+  
+  /// The residents and jobs of the city and the demand for zones.
+  Economy _economy;
+  
+  /// The traffic assigned to the roads as a whole.
+  TrafficAssignment _assignment;
+  
+  /// Whether traffic is assigned to the roads as a whole.
+  bool _macroscopic = false;
+  
+  /// The version of the lane graph that the assignment was last built for.
+  uint64_t _assignedVersion = 0;
+  
+  /// The iteration of the assignment running in the background, if any.
+  std::future<bool> _assigning;
+  
+  /// The trips assigned as of the last iteration to finish, read while no
+  /// iteration was running.
+  float _assignedTrips = 0;
+  
+  /// The relative gap as of the last iteration to finish.
+  float _assignedGap = 1;
+  
+  /// The culling statistics of the last `draw`.
+  Frustum::Stats _cullStats;
+  
   /// The action the user is currently performing.
   Action _action = Action::none;
   
@@ -0,0 +1,64 @@
+/**
+ * @file Bounds3.h
+ * @brief A 3D axis-aligned bounding box.
+ * @date May 12, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// A 3D axis-aligned bounding box.
+struct Bounds3 {
+  /// The origin (minimum corner) of the bounding box.
+  Real3 origin;
+
+  /// The size of the bounding box.
+  Real3 size;
+
+
+  Bounds3() : origin(0, 0, 0), size(0, 0, 0) { }
+
+  Bounds3(const Real3 &origin) : origin(origin), size(0, 0, 0) { }
+
+  Bounds3(const Real3 &origin, const Real3 &size) :
+    origin(origin), size(size) { }
+
+
+
+  /// The center of the bounding box.
+  Real3 center() const {
+    return origin + size * Real3(0.5);
+  }
+
+  /// Half the size of the bounding box.
+  Real3 extent() const {
+    return size * Real3(0.5);
+  }
+
+  /// Fit the bounding box to encapsulate a point.
+  /// \param[in] point
+  ///   The point to encapsulate.
+  Bounds3 &fit(const Real3 &point) {
+    Real3 a = origin.min(point);
+    Real3 b = (origin + size).max(point);
+    origin = a;
+    size = b - a;
+    return *this;
+  }
+
+  /// Fit the bounding box to encapsulate another bounding box.
+  /// \param[in] other
+  ///   The bounding box to encapsulate.
+  Bounds3 &fit(const Bounds3 &other) {
+    Real3 a = origin.min(other.origin);
+    Real3 b = (origin + size).max(other.origin + other.size);
+    origin = a;
+    size = b - a;
+    return *this;
+  }
+};
+
+NS_CITY_BUILDER_END
@@ -104,7 +104,7 @@ protected:
   Path2(Type type) : _type(type) { }
   
   Path2(Type type, Real2 start, Real2 end)
-    : _type(type), start(start), end(end) { }
+    : start(start), end(end), _type(type) { }
   
   
   /// A generator for equidistant path points.
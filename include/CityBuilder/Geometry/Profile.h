@@ -82,6 +82,18 @@ struct ProfileMesh {
   /// \param points
   ///   The points to create the mesh from.
   ProfileMesh(const List<ProfilePoint> &points);
+  
+  
+  
+  /// Create a copy of the mesh without its small vertical details, for
+  /// distant levels of detail.
+  /// \param[in] height
+  ///   The tallest steep edge to remove, such as the side of a curb.
+  /// \returns
+  ///   The mesh without any steep edges up to the given height and the
+  ///   vertices only they used.
+  ///   The dimensions of the mesh are kept.
+  ProfileMesh collapsed(Real height) const;
 };
 
 NS_CITY_BUILDER_END
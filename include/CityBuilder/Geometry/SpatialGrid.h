@@ -0,0 +1,131 @@
+/**
+ * @file SpatialGrid.h
+ * @brief A uniform grid for finding the items near a region.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include "Bounds2.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+NS_CITY_BUILDER_BEGIN
+
+/// A uniform grid for finding the items near a region.
+/// \tparam T
+///   The type of the items, which must be cheap to copy and compare, such as
+///   a pointer or an index.
+/// \remarks
+///   Every item is kept in each square cell that its bounds overlap, and only
+///   the cells that hold items are stored, so the grid may cover any area.
+///   An item must be removed with the same bounds that it was inserted with.
+template <typename T>
+struct SpatialGrid {
+  /// Create an empty grid.
+  /// \param[in] cellSize
+  ///   The width of each cell, which should be around the size of the items.
+  SpatialGrid(float cellSize) : _cellSize(cellSize) { }
+
+
+
+  /// Add an item to the grid.
+  /// \param[in] item
+  ///   The item to add.
+  /// \param[in] bounds
+  ///   The bounds of the item.
+  void insert(const T &item, const Bounds2 &bounds) {
+    _forEachCell(bounds, [&](uint64_t cell) {
+      _cells[cell].append(item);
+    });
+    _count++;
+  }
+
+  /// Remove an item from the grid.
+  /// \param[in] item
+  ///   The item to remove.
+  /// \param[in] bounds
+  ///   The bounds that the item was inserted with.
+  void remove(const T &item, const Bounds2 &bounds) {
+    _forEachCell(bounds, [&](uint64_t cell) {
+      auto found = _cells.find(cell);
+      if (found == _cells.end())
+        return;
+      List<T> &items = found->second;
+      for (intptr_t i = 0; i < items.count(); i++)
+        if (items[i] == item) {
+          // Order within a cell does not matter
+          items[i] = items[items.count() - 1];
+          items.remove(items.count() - 1);
+          break;
+        }
+      if (items.isEmpty())
+        _cells.erase(found);
+    });
+    _count--;
+  }
+
+  /// Find every item whose cells overlap a region.
+  /// \param[in] bounds
+  ///   The region to search.
+  /// \param[out] items
+  ///   The list to append the items found to, each once.
+  /// \remarks
+  ///   The items found are only near the region; their own bounds should be
+  ///   checked if it matters.
+  void query(const Bounds2 &bounds, List<T> &items) const {
+    size_t first = items.count();
+    _forEachCell(bounds, [&](uint64_t cell) {
+      auto found = _cells.find(cell);
+      if (found != _cells.end())
+        for (const T &item : found->second)
+          items.append(item);
+    });
+    if (items.count() - first > 1) {
+      T *begin = items.begin() + first, *end = items.begin() + items.count();
+      std::sort(begin, end);
+      size_t unique = std::unique(begin, end) - begin;
+      while (items.count() > first + unique)
+        items.remove(items.count() - 1);
+    }
+  }
+
+  /// Remove every item from the grid.
+  void clear() {
+    _cells.clear();
+    _count = 0;
+  }
+
+  /// The number of items in the grid.
+  size_t count() const {
+    return _count;
+  }
+
+private:
+  /// The width of each cell.
+  float _cellSize;
+
+  /// The items of every cell that holds any, by the packed coordinates of
+  /// the cell.
+  std::unordered_map<uint64_t, List<T>> _cells { };
+
+  /// The number of items in the grid.
+  size_t _count = 0;
+
+  /// Call a function with every cell that a region overlaps.
+  template <typename Body>
+  void _forEachCell(const Bounds2 &bounds, Body body) const {
+    int32_t x0 = (int32_t)std::floor((float)bounds.origin.x / _cellSize);
+    int32_t y0 = (int32_t)std::floor((float)bounds.origin.y / _cellSize);
+    int32_t x1 = (int32_t)std::floor((float)(bounds.origin.x + bounds.size.x) / _cellSize);
+    int32_t y1 = (int32_t)std::floor((float)(bounds.origin.y + bounds.size.y) / _cellSize);
+    for (int32_t y = y0; y <= y1; y++)
+      for (int32_t x = x0; x <= x1; x++)
+        body((uint64_t)(uint32_t)x << 32 | (uint32_t)y);
+  }
+};
+
+NS_CITY_BUILDER_END
@@ -32,7 +32,23 @@ enum class KeyCode : int {
   leftOption = 0x3A, rightOption = 0x3D, leftCommand = 0x37, rightCommand = 0x36,
   
   left = 0x7B, right = 0x7C, up = 0x7E, down = 0x7D,
-  
+
+#else // Generic QWERTY keyboard (ASCII based, used by the headless driver)
+
+  q = 'q', w = 'w', e = 'e', r = 'r', t = 't', y = 'y', u = 'u', i = 'i', o = 'o', p = 'p',
+  a = 'a', s = 's', d = 'd', f = 'f', g = 'g', h = 'h', j = 'j', k = 'k', l = 'l',
+  z = 'z', x = 'x', c = 'c', v = 'v', b = 'b', n = 'n', m = 'm',
+
+  _0 = '0', _1 = '1', _2 = '2', _3 = '3', _4 = '4', _5 = '5', _6 = '6', _7 = '7',
+  _8 = '8', _9 = '9',
+
+  space = 0x20, tab = 0x09, enter = 0x0D, escape = 0x1B, backspace = 0x08,
+
+  leftShift = 0x80, rightShift = 0x81, leftControl = 0x82, rightControl = 0x83,
+  leftOption = 0x84, rightOption = 0x85, leftCommand = 0x86, rightCommand = 0x87,
+
+  left = 0x90, right = 0x91, up = 0x92, down = 0x93,
+
 #endif
 };
 
@@ -0,0 +1,231 @@
+/**
+ * @file Jobs.h
+ * @brief The shared pool of worker threads that every part of the game runs
+ * its parallel work on.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+NS_CITY_BUILDER_BEGIN
+
+/// The shared pool of worker threads that every part of the game runs its
+/// parallel work on.
+/// \remarks
+///   The main thread and every worker thread have their own deque of jobs.
+///   A thread adds and takes jobs at the back of its own deque, so the work
+///   it just split off is still in its cache, while idle workers steal the
+///   oldest, and so usually largest, jobs from the front of the others.
+///   Threads outside of the pool share one more deque that the workers steal
+///   from.
+///   Jobs are counted by a `Counter`: a thread that waits on a counter runs
+///   the jobs of that counter while it waits rather than blocking, and only
+///   those, so waiting on a short job never runs into a long one.
+///   A job can also be held back until a counter reaches zero, which chains
+///   jobs into graphs without any thread waiting in between.
+///   Jobs that call bgfx to create or destroy resources must run on the main
+///   thread, so they are queued apart and run by `update` once a frame, or by
+///   the main thread whenever it waits.
+///   Until `start` is called, or without any worker threads, every job runs
+///   on the thread that adds it, so everything built on the pool also works
+///   without it.
+struct Jobs {
+private:
+  /// A job that has been added.
+  struct _job;
+
+public:
+  /// A job to run.
+  typedef std::function<void()> Job;
+
+  /// Run a job over a range of indices.
+  /// \param[in] begin
+  ///   The first index of the range.
+  /// \param[in] end
+  ///   One past the last index of the range.
+  typedef std::function<void(size_t begin, size_t end)> Range;
+
+  /// Counts the jobs that have yet to finish.
+  /// \remarks
+  ///   Must be waited on with `wait` before it is destroyed, so that the last
+  ///   job has let go of it.
+  struct Counter {
+    Counter() { }
+
+    // Prevent counter transfer.
+    Counter(const Counter &other) = delete;
+
+    /// Whether every job counted has finished.
+    bool done() const {
+      return _pending.load() == 0;
+    }
+
+  private:
+    friend struct Jobs;
+
+    /// The number of jobs counted that have yet to finish.
+    std::atomic<int> _pending { 0 };
+
+    /// The lock for the jobs waiting on the counter.
+    std::mutex _lock;
+
+    /// The jobs waiting for the counter to reach zero, as a linked list.
+    _job *_waiting = nullptr;
+  };
+
+  /// The jobs run since the last `resetStats`.
+  struct Stats {
+    /// The number of jobs run.
+    size_t jobs = 0;
+
+    /// The number of jobs stolen from the deque of another thread.
+    size_t stolen = 0;
+
+    /// The number of jobs run on the main thread for bgfx.
+    size_t mainJobs = 0;
+
+    /// The time spent running jobs, in microseconds.
+    double busy = 0;
+  };
+
+
+
+  /// Set the number of worker threads.
+  /// \param[in] threads
+  ///   The number of worker threads alongside the main thread, or -1 for one
+  ///   less than the number of cores.
+  /// \remarks
+  ///   Must be called before `start`.
+  static void setThreads(int threads);
+
+  /// Start the worker threads.
+  /// \remarks
+  ///   Must be called from the main thread, which the jobs for bgfx then run
+  ///   on.
+  static void start();
+
+  /// Stop the worker threads, running any jobs left over on the calling
+  /// thread.
+  static void stop();
+
+  /// The number of worker threads that are running.
+  static int threads();
+
+  /// Whether the calling thread is the main thread.
+  static bool isMainThread();
+
+
+
+  /// Add a job to run on any thread.
+  /// \param[in] name
+  ///   The name of the job in the trace.
+  ///   Must be a string literal.
+  /// \param[in] job
+  ///   The job to run.
+  /// \param[in] counter
+  ///   The counter to count the job with, if any.
+  static void run(const char *name, Job job, Counter *counter = nullptr);
+
+  /// Add a job to run on the main thread.
+  /// \param[in] name
+  ///   The name of the job in the trace.
+  ///   Must be a string literal.
+  /// \param[in] job
+  ///   The job to run.
+  /// \param[in] counter
+  ///   The counter to count the job with, if any.
+  /// \remarks
+  ///   Runs at once when called from the main thread.
+  static void runOnMain(const char *name, Job job, Counter *counter = nullptr);
+
+  /// Add a job to run once every job of another counter has finished.
+  /// \param[in] dependency
+  ///   The counter to wait for.
+  /// \param[in] name
+  ///   The name of the job in the trace.
+  ///   Must be a string literal.
+  /// \param[in] job
+  ///   The job to run.
+  /// \param[in] counter
+  ///   The counter to count the job with, if any, counted from now.
+  /// \param[in] onMain
+  ///   Whether the job must run on the main thread.
+  static void after(Counter &dependency, const char *name, Job job,
+    Counter *counter = nullptr, bool onMain = false);
+
+  /// Wait for every job of a counter to finish, running them meanwhile.
+  /// \param[in] counter
+  ///   The counter to wait on.
+  /// \remarks
+  ///   The main thread also runs the jobs queued for it while it waits.
+  static void wait(Counter &counter);
+
+  /// Run a function over ranges of indices across the threads, returning once
+  /// it has finished.
+  /// \param[in] name
+  ///   The name of the jobs in the trace.
+  ///   Must be a string literal.
+  /// \param[in] count
+  ///   The number of indices.
+  /// \param[in] grain
+  ///   The fewest indices worth running as a job of their own.
+  /// \param[in] body
+  ///   The function to run with each range, which must be safe to run on many
+  ///   threads at once.
+  /// \remarks
+  ///   The range is halved until it is no larger than the grain, handing the
+  ///   back half of each split to be stolen, so idle threads take the largest
+  ///   pieces left.
+  static void parallelFor(const char *name, size_t count, size_t grain, const Range &body);
+
+  /// Run the jobs queued for the main thread.
+  /// \remarks
+  ///   Must be called from the main thread, once a frame.
+  static void update();
+
+
+
+  /// Record when every job runs and on which thread.
+  /// \param[in] tracing
+  ///   Whether to record the jobs.
+  static void setTracing(bool tracing);
+
+  /// Write the jobs recorded as a Chrome trace, viewable in
+  /// `chrome://tracing` or Perfetto.
+  /// \param[in] path
+  ///   The file to write.
+  /// \returns
+  ///   Whether the file could be written.
+  /// \remarks
+  ///   Should be called while no jobs are running.
+  static bool writeTrace(const char *path);
+
+  /// The jobs run by every thread since the last `resetStats`.
+  static Stats stats();
+
+  /// The jobs run by one thread since the last `resetStats`.
+  /// \param[in] thread
+  ///   0 for the main thread, 1 to `threads()` for the worker threads, or
+  ///   `threads() + 1` for every other thread.
+  static Stats stats(int thread);
+
+  /// The time since the last `resetStats`, in microseconds.
+  static double elapsed();
+
+  /// Forget the jobs run so far.
+  static void resetStats();
+
+private:
+  /// The threads, their deques and the jobs for the main thread.
+  struct _pool;
+
+  /// The pool shared by every thread.
+  static _pool &_instance();
+};
+
+NS_CITY_BUILDER_END
@@ -0,0 +1,244 @@
+/**
+ * @file BuildingBatch.h
+ * @brief The buildings of the city drawn with GPU instancing.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Zones/Buildings.h>
+#include "Frustum.h"
+#include <atomic>
+#include <unordered_map>
+
+NS_CITY_BUILDER_BEGIN
+
+/// The buildings of the city drawn with GPU instancing.
+/// \remarks
+///   Every archetype of `Buildings` has a shared mesh for each of three
+///   levels of detail, made procedurally by extruding its footprint, in a unit
+///   box that the `building` vertex shader scales to the size of each
+///   building and places on its lot.
+///   Past the levels of detail, buildings are drawn as impostors: a single
+///   quad for each building, turned to face the camera and sized to the
+///   building's outline from there by the `building.impostor` vertex shader.
+///   The buildings are kept in square chunks on the ground, each with the
+///   placements of its buildings in one GPU buffer, sorted by archetype.
+///   Each frame, the chunks are culled as a whole and each visible chunk
+///   draws its level of detail, one draw call for each archetype in it, or
+///   one for every building as impostors, so the CPU cost of a frame follows
+///   the number of chunks rather than of buildings.
+///   A chunk's placements are only uploaded again when its buildings change,
+///   as many chunks a frame as the time budget allows.
+struct BuildingBatch {
+  /// The width and depth of a chunk, in meters.
+  static constexpr float chunkSize = 256;
+
+  /// The number of levels of detail drawn as meshes.
+  static constexpr int levels = 3;
+
+  /// The distance from the camera past which chunks are drawn as impostors,
+  /// in meters.
+  /// \remarks
+  ///   Past the distances of `StaticBatch::levelDistances` for the meshes.
+  static constexpr float impostorDistance = 1600;
+
+  /// The number of visible chunks recorded by each task.
+  static constexpr size_t chunksPerTask = 64;
+
+  /// The cost of drawing the buildings since the last `resetStats`.
+  struct Stats {
+    /// The number of chunks uploaded.
+    size_t uploads = 0;
+
+    /// The number of frames drawn.
+    size_t frames = 0;
+
+    /// The time spent sorting buildings into chunks and uploading them, in
+    /// microseconds.
+    double uploadTime = 0;
+
+    /// The time spent culling chunks, in microseconds.
+    double cullTime = 0;
+  };
+
+
+
+  BuildingBatch() { }
+
+  ~BuildingBatch();
+
+  // Prevent batch transfer.
+  BuildingBatch(const BuildingBatch &other) = delete;
+
+
+
+  /// Sort the buildings that changed into their chunks, and upload the
+  /// chunks that changed.
+  /// \param[in] buildings
+  ///   The buildings to draw.
+  /// \param[in] budget
+  ///   The time that may be spent uploading, in microseconds; the chunks left
+  ///   over are uploaded by later updates.
+  /// \remarks
+  ///   Should be called after every `Buildings::grow` that changes anything.
+  void update(const Buildings &buildings, double budget);
+
+  /// Draw the buildings that are visible.
+  /// \param[in] frustum
+  ///   The frustum of the camera being drawn to.
+  /// \param[in] eye
+  ///   The position of the camera being drawn to.
+  /// \param[in,out] stats
+  ///   The culling statistics to add the visible and culled buildings to,
+  ///   culled a chunk at a time.
+  /// \remarks
+  ///   The buildings are recorded as `CommandRecorder` tasks of
+  ///   `chunksPerTask` chunks.
+  void draw(const Frustum &frustum, Real3 eye, Frustum::Stats &stats);
+
+  /// The number of buildings uploaded.
+  size_t count() const {
+    return _count;
+  }
+
+  /// The number of chunks holding any buildings.
+  size_t chunks() const {
+    return _chunks.count() - _emptyChunks;
+  }
+
+  /// The number of draw calls submitted by the last `draw`.
+  int drawCalls() const {
+    return _drawCalls;
+  }
+
+  /// The number of triangles drawn by the last `draw`.
+  size_t triangles() const {
+    return _triangles;
+  }
+
+  /// The number of triangles of the meshes shared by every building.
+  size_t meshTriangles() const {
+    size_t triangles = 0;
+    for (uint32_t mesh : _meshTriangles)
+      triangles += mesh;
+    return triangles;
+  }
+
+
+
+  /// The cost of drawing the buildings since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the cost of drawing the buildings so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+private:
+  /// The buildings in a square of the ground.
+  struct _chunk {
+    /// The lots of the buildings in the chunk.
+    List<uint32_t> buildings { };
+
+    /// The placements of the chunk's buildings, sorted by archetype.
+    bgfx::DynamicVertexBufferHandle instances = BGFX_INVALID_HANDLE;
+
+    /// The first uploaded placement of each archetype, with one more entry
+    /// at the end.
+    uint32_t ranges[Buildings::archetypes + 1] = { 0 };
+
+    /// The bounds of the uploaded buildings.
+    Bounds3 bounds { };
+
+    /// The level of detail the chunk is drawn at, `levels` for impostors.
+    int level = 0;
+
+    /// Whether the chunk is waiting to be uploaded.
+    bool dirty = false;
+  };
+
+  /// Sort a building into the chunk it stands in, or take it out of its
+  /// chunk if it was demolished.
+  /// \param[in] buildings
+  ///   The buildings to draw.
+  /// \param[in] lot
+  ///   The lot of the building.
+  void _place(const Buildings &buildings, uint32_t lot);
+
+  /// Upload the placements of a chunk.
+  /// \param[in] buildings
+  ///   The buildings to draw.
+  /// \param[in] chunk
+  ///   The index of the chunk.
+  void _upload(const Buildings &buildings, uint32_t chunk);
+
+  /// Draw a range of the visible chunks.
+  /// \param[in] encoder
+  ///   The encoder to record the draw calls with.
+  /// \param[in] first
+  ///   The first visible chunk to draw.
+  /// \param[in] count
+  ///   The most chunks to draw.
+  /// \returns
+  ///   The number of draw calls submitted.
+  int _draw(bgfx::Encoder *encoder, size_t first, size_t count) const;
+
+  /// Create the shared meshes of every archetype and the impostor.
+  void _createMeshes();
+
+  /// The shared mesh of every archetype at every level of detail, and the
+  /// impostor last.
+  bgfx::VertexBufferHandle _vertices[Buildings::archetypes * levels + 1];
+
+  /// The indices of every shared mesh.
+  bgfx::IndexBufferHandle _indices[Buildings::archetypes * levels + 1];
+
+  /// The number of triangles of every shared mesh.
+  uint32_t _meshTriangles[Buildings::archetypes * levels + 1] = { 0 };
+
+  /// Whether the shared meshes have been created.
+  bool _hasMeshes = false;
+
+  /// The chunks, including those emptied.
+  List<_chunk> _chunks { };
+
+  /// The index of every chunk by the packed coordinates of its square.
+  std::unordered_map<uint64_t, uint32_t> _chunkIndex { };
+
+  /// The number of chunks holding no buildings.
+  size_t _emptyChunks = 0;
+
+  /// The chunk of the building of every lot, or `UINT32_MAX`.
+  List<uint32_t> _chunkOf { };
+
+  /// The index of the building of every lot in its chunk.
+  List<uint32_t> _slotOf { };
+
+  /// The chunks waiting to be uploaded, in no order.
+  List<uint32_t> _dirty { };
+
+  /// The visible chunks found by the last `draw`.
+  List<uint32_t> _visible { };
+
+  /// The version of the buildings last sorted into chunks.
+  uint64_t _version = 0;
+
+  /// The number of buildings in the chunks.
+  size_t _count = 0;
+
+  /// The number of draw calls submitted by the last `draw`.
+  std::atomic<int> _drawCalls { 0 };
+
+  /// The number of triangles drawn by the last `draw`.
+  size_t _triangles = 0;
+
+  /// The cost of drawing the buildings since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
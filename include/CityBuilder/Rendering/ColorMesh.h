@@ -8,6 +8,9 @@
 #pragma once
 #include <CityBuilder/Common.h>
 #include <CityBuilder/Storage/List.h>
+#include "IndexList.h"
+#include "VertexPacking.h"
+#include <CityBuilder/Geometry/Bounds3.h>
 #include <CityBuilder/Geometry/Profile.h>
 #include <CityBuilder/Units/Angle.h>
 #include "Material.h"
@@ -65,22 +68,44 @@ struct ColorMesh {
   
   
   
+  /// The bounding box of the mesh, captured when it was loaded to the GPU.
+  /// \remarks
+  ///   Static meshes are drawn without a model transform, so this is also
+  ///   their bounding box in world space.
+  const Bounds3 &boundingBox() const {
+    return _boundingBox;
+  }
+  
   /// Load the mesh to the GPU.
+  /// \remarks
+  ///   The vertices are packed when `VertexPacking` is enabled.
   void load();
   
   
   
+  /// Set the buffers of the mesh, and the transform of packed meshes, on an
+  /// encoder without submitting a draw call.
+  /// \param[in] encoder
+  ///   The encoder to set the buffers on.
+  /// \returns
+  ///   Whether the mesh has been loaded and can be drawn.
+  bool setBuffers(bgfx::Encoder *encoder) const;
+  
   /// Submit the mesh to the GPU for rendering.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
   /// \param[in] shader
   ///   The shader to use for drawing the mesh.
   /// \remarks
   ///   A material should be set before calling this.
-  void draw(Resource<Program> shader) const;
+  void draw(bgfx::Encoder *encoder, const Resource<Program> &shader) const;
   
   /// Submit the mesh to the GPU for rendering.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
   /// \param[in] material
   ///   The material to use for drawing the mesh.
-  void draw(Resource<Material> material) const;
+  void draw(bgfx::Encoder *encoder, const Resource<Material> &material) const;
   
   
   
@@ -105,7 +130,27 @@ private:
   /// \remarks
   ///   Only stored while the mesh is being constructed.
   ///   Once the mesh has been uploaded to the GPU, this list is kept empty.
-  List<uint16_t> _indices { };
+  IndexList _indices { };
+  
+  /// The transform from packed vertex positions to mesh positions.
+  /// \remarks
+  ///   Only used when the mesh was loaded with packed vertices.
+  VertexPacking::Transform _transform;
+  
+  /// The bounding box of the vertices loaded to the GPU.
+  Bounds3 _boundingBox;
+  
+  /// The number of vertices loaded to the GPU.
+  uint32_t _loadedVertices = 0;
+  
+  /// The size of the vertex buffer on the GPU, in bytes.
+  uint32_t _vertexBytes = 0;
+  
+  /// The size of the index buffer on the GPU, in bytes.
+  uint32_t _indexBytes = 0;
+  
+  /// Whether or not the mesh was loaded with packed vertices.
+  bool _packed = false;
   
   /// Whether or not the mesh has been loaded to the GPU.
   bool loaded = false;
@@ -0,0 +1,151 @@
+/**
+ * @file CommandRecorder.h
+ * @brief Records the draw calls of a frame in parallel.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <functional>
+
+NS_CITY_BUILDER_BEGIN
+
+/// Records the draw calls of a frame in parallel.
+/// \remarks
+///   Each frame, independent parts of the scene (ranges of road chunks, the
+///   zones, the hovers, the UI) are added as tasks and then recorded together
+///   by `record`.
+///   Jobs on the worker threads of `Jobs` take tasks in the order they were
+///   added and record them into their own `bgfx::Encoder`, while the main
+///   thread records into the main encoder alongside them.
+///   bgfx sorts the draw calls of every encoder by view and state when the
+///   frame is submitted, so the order that tasks finish in doesn't matter.
+///   Tasks only read the scene, and must not copy any `Resource` since their
+///   reference counts are not atomic.
+///   Worker encoders need bgfx to be built with `BGFX_CONFIG_MULTITHREADED`;
+///   without it every task is recorded on the main thread.
+struct CommandRecorder {
+  /// Record part of a frame.
+  /// \param[in] encoder
+  ///   The encoder to record the draw calls with.
+  typedef std::function<void(bgfx::Encoder *encoder)> Task;
+
+  /// The time spent recording a task.
+  struct Timing {
+    /// The name of the task.
+    const char *name;
+
+    /// The time spent recording the task, in microseconds.
+    double time;
+  };
+
+  /// The time spent recording a frame.
+  struct Stats {
+    /// The number of threads that recorded the frame, including the main
+    /// thread.
+    int threads = 1;
+
+    /// The time from the start to the end of `record`, in microseconds.
+    double time = 0;
+
+    /// The total time spent recording every task, in microseconds.
+    /// \remarks
+    ///   This is roughly how long the frame would take to record on a
+    ///   single thread.
+    double serial = 0;
+
+    /// The time spent recording each task, in the order they were added.
+    List<Timing> tasks { };
+
+    /// How many times faster the frame was recorded than on a single thread.
+    double speedUp() const {
+      return time > 0 ? serial / time : 1;
+    }
+  };
+
+  /// The time spent recording a task across every frame.
+  struct Total {
+    /// The name of the task.
+    const char *name;
+
+    /// The total time, in microseconds.
+    double time;
+
+    /// The number of times the task was recorded.
+    size_t count;
+  };
+
+  /// The time spent recording every frame so far.
+  struct Totals {
+    /// The number of frames recorded.
+    size_t frames = 0;
+
+    /// The total time from the start to the end of `record`, in
+    /// microseconds.
+    double time = 0;
+
+    /// The total time spent recording every task, in microseconds.
+    double serial = 0;
+
+    /// The total time spent recording each task, in the order first seen.
+    List<Total> tasks { };
+
+    /// How many times faster the frames were recorded than on a single
+    /// thread.
+    double speedUp() const {
+      return time > 0 ? serial / time : 1;
+    }
+  };
+
+
+
+  /// Set the number of worker threads to record with.
+  /// \param[in] threads
+  ///   The number of worker threads, or -1 to use every worker thread of
+  ///   `Jobs`.
+  /// \remarks
+  ///   Must be called before `start`.
+  ///   The number of threads is limited by the worker threads of `Jobs` and
+  ///   the number of encoders that bgfx was built with.
+  static void setThreads(int threads);
+
+  /// Start recording with the worker threads.
+  /// \remarks
+  ///   Must be called after bgfx has been initialized and `Jobs` started.
+  static void start();
+
+  /// Stop recording with the worker threads.
+  static void stop();
+
+  /// The number of worker threads recorded with.
+  static int threads();
+
+
+
+  /// Add a task to the current frame.
+  /// \param[in] name
+  ///   The name of the task in the timing breakdown.
+  ///   Must be a string literal.
+  /// \param[in] task
+  ///   The task to record.
+  static void add(const char *name, Task task);
+
+  /// Record every task added since the last `record`, returning once they
+  /// have all finished.
+  /// \param[in] setup
+  ///   Sets up each encoder before its first task, such as with the
+  ///   per-frame uniforms.
+  /// \remarks
+  ///   Must be called from the main thread, before `bgfx::frame`.
+  static void record(const Task &setup);
+
+  /// The time spent recording the last frame.
+  static const Stats &stats();
+
+  /// The time spent recording every frame so far.
+  static const Totals &totals();
+};
+
+NS_CITY_BUILDER_END
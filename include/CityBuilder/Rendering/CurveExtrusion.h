@@ -0,0 +1,118 @@
+/**
+ * @file CurveExtrusion.h
+ * @brief Cross-sections extruded along paths on the GPU.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Geometry/Path2.h>
+#include <CityBuilder/Geometry/Profile.h>
+#include "InstanceBatch.h"
+#include "Mesh.h"
+
+NS_CITY_BUILDER_BEGIN
+
+/// Cross-sections extruded along paths on the GPU.
+/// \remarks
+///   Rather than extruding a cross-section along every path on the CPU (as
+///   `Mesh::extrude` does) and uploading the result, a short strip of the
+///   cross-section is built once and shared, then drawn instanced along each
+///   path with the `extruded` vertex shaders.
+///   Each instance carries the cubic Bézier control points of its path and
+///   the range of the curve that it covers, which the shader evaluates to
+///   place the rows of the strip:
+///   - `i_data0`: the start and first control point of the curve.
+///   - `i_data1`: the second control point and end of the curve.
+///   - `i_data2`: the curve parameters and texture V at the start and end of
+///     the strip.
+///   - `i_data3`: unused.
+///   Placing a path then only costs its instances, with nothing to upload
+///   until the visible instances are drawn.
+struct CurveExtrusion {
+  /// The number of rows of cross-sections in a strip, after the first.
+  static constexpr int rows = 8;
+
+  /// The time spent meshing paths since the last `resetStats`.
+  struct Stats {
+    /// The number of paths meshed, in either mode.
+    size_t paths = 0;
+
+    /// The number of strips placed on the GPU.
+    size_t strips = 0;
+
+    /// The time spent meshing paths, in microseconds.
+    double time = 0;
+  };
+
+
+
+  /// Set whether paths are extruded on the GPU.
+  /// \param[in] enabled
+  ///   Whether to extrude on the GPU rather than the CPU.
+  /// \remarks
+  ///   May be changed at any time; users such as `RoadNetwork` rebuild their
+  ///   meshes on their next update.
+  static void setEnabled(bool enabled);
+
+  /// Whether paths are extruded on the GPU.
+  /// \remarks
+  ///   Always false when bgfx does not support instancing.
+  static bool enabled();
+
+
+
+  /// Add a strip of a cross-section to a shared strip mesh.
+  /// \param[in,out] mesh
+  ///   The strip mesh to add to.
+  /// \param[in] profile
+  ///   The cross-section to add.
+  /// \param[in] offset
+  ///   The offset of the cross-section from the path.
+  /// \param[in] scale
+  ///   The scale of the cross-section.
+  /// \remarks
+  ///   The strip is laid out in extrusion space: X across the path, Y up, and
+  ///   how far along the strip a row is (0 to 1) in its texture V.
+  static void addStrip(Mesh &mesh, const ProfileMesh &profile, Real2 offset = { 0, 0 }, Real scale = 1);
+
+  /// Place strips along the whole of a path.
+  /// \param[in,out] batch
+  ///   The batch to place the strips in.
+  /// \param[in] owner
+  ///   The object that the strips belong to, used for removal.
+  /// \param[in] material
+  ///   The texture that the strips are drawn with.
+  /// \param[in] strip
+  ///   The loaded strip mesh to place.
+  /// \param[in] path
+  ///   The path to place the strips along.
+  /// \param[in] stride
+  ///   The number of path points to advance between rows, as with
+  ///   `Mesh::extrude`.
+  /// \param[in] level
+  ///   The level of detail of the strip.
+  /// \remarks
+  ///   As with `Mesh::extrude`, the texture V runs from 0 to 1 along the
+  ///   path, scaled by the length of the path.
+  static void place(InstanceBatch &batch, const void *owner, Texture *material, const Resource<Mesh> &strip, Path2 &path, int stride, int level);
+
+
+
+  /// Record the time spent meshing paths, whether they were extruded on the
+  /// CPU or placed on the GPU, so that the two can be compared.
+  /// \param[in] paths
+  ///   The number of paths meshed.
+  /// \param[in] time
+  ///   The time spent, in microseconds.
+  static void track(size_t paths, double time);
+
+  /// The time spent meshing paths since the last `resetStats`.
+  static Stats stats();
+
+  /// Forget the time spent meshing paths so far.
+  static void resetStats();
+};
+
+NS_CITY_BUILDER_END
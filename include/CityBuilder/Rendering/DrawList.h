@@ -0,0 +1,222 @@
+/**
+ * @file DrawList.h
+ * @brief Draw calls sorted by their bindings before they are submitted.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include "ColorMesh.h"
+#include "Mesh.h"
+#include "Program.h"
+
+NS_CITY_BUILDER_BEGIN
+
+/// Draw calls sorted by their bindings before they are submitted.
+/// \remarks
+///   Draws are added as records of their program, texture, uniform, render
+///   state and mesh, each given a 64-bit key that orders them the way bgfx
+///   sorts its own draw calls (by view, blending, then program) followed by
+///   texture, state and uniform.
+///   The records are radix sorted by their keys and submitted in order,
+///   keeping the bindings and state from one draw call to the next so that
+///   only what changes is set again.
+///   The order of the list is kept through bgfx's own sorting by submitting
+///   each draw with an increasing depth, reserved for the whole list at
+///   once, so that bgfx applies the uniforms of consecutive draws in order.
+///   Draw calls submitted directly to an encoder always have a depth of 0
+///   and are sorted before those of a list with the same program.
+///   A list keeps its storage when it is submitted, so a list kept from one
+///   frame to the next records and sorts without allocating.
+struct DrawList {
+  /// A texture bound to a draw.
+  struct Sampler {
+    /// The texture stage to bind to.
+    uint8_t stage = 0;
+
+    /// The sampler uniform to bind to, or invalid to bind no texture.
+    bgfx::UniformHandle uniform = BGFX_INVALID_HANDLE;
+
+    /// The texture to bind.
+    bgfx::TextureHandle texture = BGFX_INVALID_HANDLE;
+  };
+
+  /// A vector uniform set for a draw.
+  struct Uniform {
+    /// The uniform to set, or invalid to set none.
+    bgfx::UniformHandle handle = BGFX_INVALID_HANDLE;
+
+    /// The value of the uniform.
+    float value[4] = { 0, 0, 0, 0 };
+  };
+
+  /// How a draw is shaded.
+  struct Material {
+    /// The program to draw with.
+    /// \remarks
+    ///   Points at one of the long-lived programs, such as `Program::pbr`,
+    ///   so that no reference count is touched while recording.
+    const Resource<Program> *program;
+
+    /// The texture of the draw.
+    Sampler sampler { };
+
+    /// The uniform of the draw.
+    Uniform uniform { };
+
+    /// Bind the texture and uniform of the material to an encoder.
+    /// \param[in] encoder
+    ///   The encoder to bind to.
+    void apply(bgfx::Encoder *encoder) const;
+  };
+
+  /// The cost of the draw lists submitted since the last `resetStats`.
+  struct Stats {
+    /// The number of lists submitted.
+    uint64_t lists = 0;
+
+    /// The number of draw calls submitted.
+    uint64_t draws = 0;
+
+    /// The number of textures bound.
+    uint64_t samplers = 0;
+
+    /// The number of render states set.
+    uint64_t states = 0;
+
+    /// The number of uniforms set.
+    uint64_t uniforms = 0;
+
+    /// The time spent sorting and submitting, in microseconds.
+    double time = 0;
+  };
+
+
+
+  /// Create a new draw list.
+  /// \param[in] view
+  ///   The view that the list is drawn to.
+  DrawList(bgfx::ViewId view = 0) : _view(view) { }
+
+  // Prevent list transfer.
+  DrawList(const DrawList &other) = delete;
+
+
+
+  /// Add a draw of a static mesh.
+  /// \param[in] material
+  ///   How the mesh is shaded.
+  /// \param[in] state
+  ///   The render state to draw with.
+  /// \param[in] mesh
+  ///   The mesh to draw, which must outlive the list's next `submit`.
+  void add(const Material &material, uint64_t state, const Mesh *mesh);
+
+  /// Add a draw of a colored static mesh.
+  /// \param[in] material
+  ///   How the mesh is shaded.
+  /// \param[in] state
+  ///   The render state to draw with.
+  /// \param[in] mesh
+  ///   The mesh to draw, which must outlive the list's next `submit`.
+  void add(const Material &material, uint64_t state, const ColorMesh *mesh);
+
+  /// The number of draws in the list.
+  size_t count() const {
+    return _items.count();
+  }
+
+  /// Sort and submit every draw in the list, then empty it while keeping
+  /// its storage.
+  /// \param[in] encoder
+  ///   The encoder to record the draw calls with.
+  /// \returns
+  ///   The number of draw calls submitted.
+  int submit(bgfx::Encoder *encoder);
+
+
+
+  /// Restart the depths reserved by lists.
+  /// \remarks
+  ///   Must be called once per frame from the main thread, before any list
+  ///   is submitted.
+  static void startFrame();
+
+  /// Set whether lists are sorted and redundant bindings are skipped.
+  /// \param[in] enabled
+  ///   When disabled, draws are submitted in the order they were added and
+  ///   every binding is set for every draw, for comparison.
+  static void setSorting(bool enabled);
+
+  /// Whether lists are sorted and redundant bindings are skipped.
+  static bool sorting();
+
+  /// The cost of the lists submitted since the last `resetStats`.
+  static Stats stats();
+
+  /// Forget the cost of the lists submitted so far.
+  static void resetStats();
+
+
+
+private:
+  /// A draw in the list.
+  struct _item {
+    /// The sort key of the draw.
+    uint64_t key;
+
+    /// How the draw is shaded.
+    Material material;
+
+    /// The render state of the draw.
+    uint64_t state;
+
+    /// The static mesh to draw, if any.
+    const Mesh *mesh;
+
+    /// The colored static mesh to draw, if any.
+    const ColorMesh *colorMesh;
+  };
+
+  /// A draw to sort.
+  struct _sortEntry {
+    /// The sort key of the draw.
+    uint64_t key;
+
+    /// The index of the draw in the list.
+    uint32_t index;
+  };
+
+  /// Add a draw to the list.
+  /// \param[in] material
+  ///   How the mesh is shaded.
+  /// \param[in] state
+  ///   The render state to draw with.
+  /// \param[in] mesh
+  ///   The static mesh to draw, if any.
+  /// \param[in] colorMesh
+  ///   The colored static mesh to draw, if any.
+  void _add(const Material &material, uint64_t state, const Mesh *mesh, const ColorMesh *colorMesh);
+
+  /// The view that the list is drawn to.
+  bgfx::ViewId _view;
+
+  /// The draws in the list.
+  List<_item> _items { };
+
+  /// The distinct render states in the list.
+  List<uint64_t> _states { };
+
+  /// The distinct uniforms in the list.
+  List<Uniform> _uniforms { };
+
+  /// The draws in the order they are submitted.
+  List<_sortEntry> _order { };
+
+  /// The space used between the passes of sorting `_order`.
+  List<_sortEntry> _scratch { };
+};
+
+NS_CITY_BUILDER_END
@@ -8,12 +8,19 @@
 #pragma once
 #include <CityBuilder/Common.h>
 #include <CityBuilder/Storage/List.h>
+#include "IndexList.h"
 #include <CityBuilder/Geometry/Profile.h>
 #include "Material.h"
 
 NS_CITY_BUILDER_BEGIN
 
 /// A dynamic mesh description.
+/// \remarks
+///   Dynamic meshes are rebuilt while the user interacts with them, such as
+///   the placement previews of tools.
+///   The loaded geometry is kept on the CPU and written straight into bgfx
+///   transient buffers every time the mesh is drawn, so rebuilding a mesh
+///   never creates or destroys GPU buffers.
 struct DynamicMesh {
   /// A vertex.
   struct Vertex {
@@ -29,8 +36,6 @@ struct DynamicMesh {
   // Prevent mesh transfer.
   DynamicMesh(const DynamicMesh &other) = delete;
   
-  ~DynamicMesh();
-  
   
   
   /// Add a set of vertices and triangles connecting them to the mesh.
@@ -61,49 +66,55 @@ struct DynamicMesh {
   
   
   /// Load the mesh to the GPU.
+  /// \remarks
+  ///   Replaces the previously loaded geometry, and starts a new empty mesh
+  ///   for the next rebuild.
+  ///   The geometry is uploaded each time the mesh is drawn.
   void load();
   
   
   
   /// Submit the mesh to the GPU for rendering.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
   /// \param[in] shader
   ///   The shader to use for drawing the mesh.
   /// \remarks
   ///   A material should be set before calling this.
-  void draw(Resource<Program> shader) const;
+  ///   Nothing is drawn if the frame has run out of transient buffer space.
+  void draw(bgfx::Encoder *encoder, const Resource<Program> &shader) const;
   
   /// Submit the mesh to the GPU for rendering.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
   /// \param[in] material
   ///   The material to use for drawing the mesh.
-  void draw(Resource<Material> material) const;
+  void draw(bgfx::Encoder *encoder, const Resource<Material> &material) const;
   
   
   
 private:
-  /// The GPU vertex buffer of the mesh.
-  /// \remarks
-  ///   Should be freed once the mesh is no longer in use.
-  bgfx::DynamicVertexBufferHandle _vertexBuffer;
-  
-  /// The GPU index buffer of the mesh.
-  /// \remarks
-  ///   Should be freed once the mesh is no longer in use.
-  bgfx::DynamicIndexBufferHandle _indexBuffer;
-  
-  /// The vertices of the mesh.
+  /// Write the loaded geometry to transient buffers and set them on an
+  /// encoder.
+  /// \param[in] encoder
+  ///   The encoder to set the buffers on.
+  /// \returns
+  ///   Whether there was any geometry and it fit in this frame's transient
+  ///   buffers.
+  ///   If not, anything already set on the encoder is discarded.
+  bool _setBuffers(bgfx::Encoder *encoder) const;
+  
+  /// The vertices of the mesh being built.
   List<Vertex> _vertices { };
   
-  /// The indices of the mesh.
-  List<uint16_t> _indices { };
-  
-  /// The last uploaded vertex count.
-  int _vertexCount = 0;
+  /// The indices of the mesh being built.
+  IndexList _indices { };
   
-  /// The last uploaded index count.
-  int _indexCount = 0;
+  /// The vertices of the loaded mesh.
+  List<Vertex> _loadedVertices { };
   
-  /// Whether or not the mesh has been loaded to the GPU.
-  bool loaded = false;
+  /// The indices of the loaded mesh.
+  IndexList _loadedIndices { };
 };
 
 NS_CITY_BUILDER_END
@@ -0,0 +1,67 @@
+/**
+ * @file Frustum.h
+ * @brief The visible volume of a camera, for culling.
+ * @date May 12, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Geometry/Bounds3.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// The visible volume of a camera, for culling.
+/// \remarks
+///   The six planes are stored component-wise so that a bounding box is tested
+///   against four planes at once.
+struct Frustum {
+  /// The results of culling a set of meshes.
+  struct Stats {
+    /// The number of meshes that were visible.
+    int visible = 0;
+
+    /// The number of meshes that were culled.
+    int culled = 0;
+
+    /// The CPU time spent culling, in microseconds.
+    double time = 0;
+  };
+
+
+
+  /// Create a frustum that accepts everything.
+  Frustum();
+
+  /// Create the frustum of a view-projection matrix.
+  /// \param[in] viewProjection
+  ///   The view-projection matrix of the camera, as from
+  ///   `Camera::viewProjection`.
+  /// \param[in] homogeneousDepth
+  ///   Whether clip space depth ranges from -1 to 1 rather than 0 to 1, as
+  ///   given by `bgfx::Caps::homogeneousDepth`.
+  Frustum(const Real4x4 &viewProjection, bool homogeneousDepth);
+
+
+
+  /// Check if a bounding box is at least partly within the frustum.
+  /// \param[in] bounds
+  ///   The bounding box to check.
+  /// \remarks
+  ///   Conservative: a box outside the frustum near one of its corners may
+  ///   still be reported as visible.
+  bool intersects(const Bounds3 &bounds) const;
+
+
+
+private:
+  /// The x, y, z, and w coefficients of the planes, where the first four are
+  /// left, right, bottom, and top, and the last four are near, far, near,
+  /// and far.
+  Real4 _x[2], _y[2], _z[2], _w[2];
+
+  /// The absolute values of `_x`, `_y`, and `_z`.
+  Real4 _absX[2], _absY[2], _absZ[2];
+};
+
+NS_CITY_BUILDER_END
@@ -0,0 +1,103 @@
+/**
+ * @file IndexList.h
+ * @brief A list of mesh indices that picks its own index size.
+ * @date May 10, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// A list of mesh indices that picks its own index size.
+/// \remarks
+///   Indices are stored in 16 bits until one no longer fits, at which point
+///   the whole list is widened to 32 bits.
+///   Small meshes therefore keep small index buffers, while large merged
+///   meshes are still addressed correctly instead of silently wrapping.
+struct IndexList {
+  /// The largest index that is stored in 16 bits.
+  /// \remarks
+  ///   0xFFFF is left unused as some backends treat it as a strip restart.
+  static constexpr uint32_t max16 = 0xFFFE;
+
+
+
+  /// Add an index to the list.
+  /// \param[in] index
+  ///   The index to add.
+  void append(uint32_t index) {
+    if (!_wide && index > max16)
+      _widen();
+    if (_wide)
+      _indices32.append(index);
+    else
+      _indices16.append((uint16_t)index);
+  }
+
+  /// Get an index in the list.
+  /// \param[in] index
+  ///   The position of the index within the list.
+  uint32_t operator[](size_t index) const {
+    return _wide ? _indices32[index] : _indices16[index];
+  }
+
+  /// The number of indices in the list.
+  size_t count() const {
+    return _wide ? _indices32.count() : _indices16.count();
+  }
+
+  /// Whether or not the list is empty.
+  bool isEmpty() const {
+    return count() == 0;
+  }
+
+  /// Whether or not the indices are stored in 32 bits.
+  bool isWide() const {
+    return _wide;
+  }
+
+  /// The size of the indices, in bytes.
+  size_t bytes() const {
+    return _wide ? sizeof(uint32_t) * _indices32.count() : sizeof(uint16_t) * _indices16.count();
+  }
+
+  /// Remove every index from the list, returning it to 16-bit indices.
+  void removeAll();
+
+
+
+  /// Copy the indices to memory for a bgfx index buffer.
+  const bgfx::Memory *copy() const;
+
+  /// The indices, in 16 or 32 bits depending on `isWide`.
+  /// \remarks
+  ///   Holds `bytes()` bytes, for writing directly to a transient buffer.
+  const void *data() const {
+    return _wide ? (const void *)_indices32.begin() : (const void *)_indices16.begin();
+  }
+
+  /// The bgfx index buffer flags for the size of the indices.
+  uint16_t flags() const {
+    return _wide ? BGFX_BUFFER_INDEX32 : BGFX_BUFFER_NONE;
+  }
+
+
+
+private:
+  /// Convert the list to 32-bit indices.
+  void _widen();
+
+  /// The indices, while they fit in 16 bits.
+  List<uint16_t> _indices16 { };
+
+  /// The indices, once any of them needs 32 bits.
+  List<uint32_t> _indices32 { };
+
+  /// Whether or not the indices are stored in 32 bits.
+  bool _wide = false;
+};
+
+NS_CITY_BUILDER_END
@@ -0,0 +1,191 @@
+/**
+ * @file InstanceBatch.h
+ * @brief Shared meshes drawn many times with GPU instancing.
+ * @date May 13, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Storage/Map.h>
+#include <CityBuilder/Units/Angle.h>
+#include "DrawList.h"
+#include "Frustum.h"
+#include "Mesh.h"
+#include "Program.h"
+#include "Texture.h"
+
+NS_CITY_BUILDER_BEGIN
+
+/// Shared meshes drawn many times with GPU instancing.
+/// \remarks
+///   Every placement of a mesh with a material is kept in one instance list,
+///   which is added to and removed from as objects change rather than
+///   rebuilt.
+///   Each frame the visible placements of a list are copied into a
+///   `bgfx::InstanceDataBuffer`, so the whole list costs a single draw call
+///   however many times the mesh is placed.
+///   Meshes must be drawn with the `instanced` vertex shaders, which read the
+///   model matrix of each instance from `i_data0` to `i_data3`.
+///   GPUs without instancing can still draw model matrix placements one draw
+///   call at a time with the regular shaders.
+struct InstanceBatch {
+  /// Find how a material is drawn.
+  /// \param[in] material
+  ///   The material to draw.
+  /// \returns
+  ///   The instanced program, texture and uniform to draw the material with.
+  typedef DrawList::Material (*Bind)(Texture *material);
+
+  /// The placement of an instance.
+  struct Instance {
+    /// The model matrix of the instance, in the column-major layout of
+    /// `bgfx::setTransform`.
+    float transform[16];
+
+    /// Place an instance on the ground.
+    /// \param[in] position
+    ///   The position of the instance in world space.
+    /// \param[in] rotation
+    ///   The counter-clockwise rotation of the instance about the up (Y)
+    ///   axis, matching the angles of `Mesh::halfRevolve`.
+    static Instance at(Real3 position, Angle rotation);
+  };
+
+
+
+  /// Create a new instance batch.
+  InstanceBatch() { }
+
+  // Prevent batch transfer.
+  InstanceBatch(const InstanceBatch &other) = delete;
+
+
+
+  /// Place a mesh.
+  /// \param[in] owner
+  ///   The object that the instance belongs to, used for removal.
+  /// \param[in] material
+  ///   The texture that the mesh is drawn with.
+  /// \param[in] mesh
+  ///   The shared mesh to place.
+  ///   Must already be loaded to the GPU.
+  /// \param[in] instance
+  ///   The placement of the mesh.
+  /// \param[in] level
+  ///   The level of detail that the mesh is for, or -1 for every level.
+  ///   Levels are chosen by distance with `StaticBatch::levelAt`.
+  void add(const void *owner, Texture *material, Resource<Mesh> mesh, const Instance &instance, int level = -1);
+
+  /// Place a mesh with known bounds.
+  /// \param[in] owner
+  ///   The object that the instance belongs to, used for removal.
+  /// \param[in] material
+  ///   The texture that the mesh is drawn with.
+  /// \param[in] mesh
+  ///   The shared mesh to place.
+  ///   Must already be loaded to the GPU.
+  /// \param[in] instance
+  ///   The instance data of the mesh, which need not be a model matrix when
+  ///   the mesh is drawn with a shader that reads it differently.
+  /// \param[in] bounds
+  ///   The bounds of the instance in world space.
+  /// \param[in] level
+  ///   The level of detail that the mesh is for, or -1 for every level.
+  void add(const void *owner, Texture *material, Resource<Mesh> mesh, const Instance &instance, const Bounds3 &bounds, int level = -1);
+
+  /// Remove every instance that belongs to an owner from the batch.
+  /// \param[in] owner
+  ///   The owner of the instances to remove.
+  void remove(const void *owner);
+
+
+
+  /// Find the instances that are visible.
+  /// \param[in] frustum
+  ///   The frustum of the camera being drawn to.
+  /// \param[in] eye
+  ///   The position of the camera being drawn to.
+  /// \param[in,out] stats
+  ///   The culling statistics to add the visible and culled instances to.
+  void cull(const Frustum &frustum, Real3 eye, Frustum::Stats &stats);
+
+  /// Draw every instance found visible by the last `cull`.
+  /// \param[in] encoder
+  ///   The encoder to record the draw calls with.
+  /// \param[in] bind
+  ///   Finds how the material of each mesh is drawn.
+  /// \param[in] state
+  ///   The render state to draw with.
+  /// \param[in] unbatched
+  ///   Finds how the material of each mesh is drawn without instancing, for
+  ///   GPUs that don't support it, or `nullptr` to draw nothing on them.
+  ///   Each visible placement is then its own draw call, with its instance
+  ///   data as the model matrix.
+  /// \returns
+  ///   The number of draw calls submitted.
+  int draw(bgfx::Encoder *encoder, Bind bind, uint64_t state, Bind unbatched = nullptr) const;
+
+  /// The number of triangles in the instances found visible by the last
+  /// `cull`.
+  size_t triangles() const {
+    return _triangles;
+  }
+
+
+
+private:
+  /// A placed mesh.
+  struct _instance {
+    /// The object the instance belongs to.
+    const void *owner;
+
+    /// The placement of the instance.
+    Instance instance;
+
+    /// The bounds of the instance in world space.
+    Bounds3 bounds;
+
+    /// The level of detail that the instance was last found at.
+    /// \remarks
+    ///   Every copy of a placement sees the same distances, so the copies for
+    ///   each level agree on which of them is drawn.
+    int level = 0;
+  };
+
+  /// Every placement of a mesh with a material.
+  struct _group {
+    /// The material of the group.
+    Texture *material;
+
+    /// The shared mesh of the group.
+    Resource<Mesh> mesh;
+
+    /// The level of detail of the mesh, or -1 for every level.
+    int level;
+
+    /// The placements of the mesh.
+    List<_instance> instances { };
+
+    /// The first of the group's placements in `_visible`.
+    size_t visibleStart = 0;
+
+    /// The number of the group's placements in `_visible`.
+    size_t visibleCount = 0;
+  };
+
+  /// The instance lists of the batch.
+  List<_group> _groups { };
+
+  /// The groups that contain instances of each owner.
+  Map<const void *, List<int>> _owners;
+
+  /// The placements found visible by the last `cull`, in group order.
+  List<Instance> _visible { };
+
+  /// The number of triangles in `_visible`.
+  size_t _triangles = 0;
+};
+
+NS_CITY_BUILDER_END
@@ -8,7 +8,11 @@
 #pragma once
 #include <CityBuilder/Common.h>
 #include <CityBuilder/Storage/List.h>
+#include "IndexList.h"
+#include "VertexPacking.h"
 #include <CityBuilder/Geometry/Profile.h>
+#include <CityBuilder/Geometry/Bounds2.h>
+#include <CityBuilder/Geometry/Bounds3.h>
 #include <CityBuilder/Units/Angle.h>
 #include "Material.h"
 
@@ -45,6 +49,14 @@ struct Mesh {
   ///   vertex list of the mesh.
   Mesh &add(const List<Vertex> &vertices, const List<int> &indices);
   
+  /// Add the contents of another mesh to the mesh.
+  /// \param[in] other
+  ///   The mesh to add.
+  ///   Should not have been loaded to the GPU yet.
+  /// \param[in] tiling
+  ///   The scale to apply to the texture coordinates of the added vertices.
+  Mesh &add(const Mesh &other, Real2 tiling = { 1, 1 });
+  
   
   
   /// Extrude a cross-section along a path and add it as a sub-mesh.
@@ -57,7 +69,11 @@ struct Mesh {
   /// \param[in] scale
   ///   The scale of the cross-section.
   ///   Does not affect the path points.
-  Mesh &extrude(const ProfileMesh &profile, Path2 &path, Real2 offset = { 0, 0 }, Real scale = 1);
+  /// \param[in] stride
+  ///   The number of path points to advance between cross-sections, for
+  ///   coarser levels of detail.
+  ///   The first and last path points are always used.
+  Mesh &extrude(const ProfileMesh &profile, Path2 &path, Real2 offset = { 0, 0 }, Real scale = 1, int stride = 1);
   
   /// Revolve half of a cross-section around a center point counter-clockwise and add it to the mesh.
   /// \param[in] profile
@@ -74,26 +90,98 @@ struct Mesh {
   /// \param[in] scale
   ///   The scale of the cross-section.
   ///   Does not affect the center point.
-  Mesh &halfRevolve(const ProfileMesh &profile, Real2 center, Angle startAngle, Angle endAngle, Real2 offset = { 0, 0 }, Real scale = 1);
+  /// \param[in] step
+  ///   The largest angle between cross-sections.
+  Mesh &halfRevolve(const ProfileMesh &profile, Real2 center, Angle startAngle, Angle endAngle, Real2 offset = { 0, 0 }, Real scale = 1, Angle step = 5_deg);
+  
+  
+  
+  /// The number of vertices in the mesh.
+  /// \remarks
+  ///   Only valid while the mesh is being constructed.
+  size_t vertexCount() const {
+    return _vertices.count();
+  }
+  
+  /// The indices of the mesh.
+  /// \remarks
+  ///   Only valid while the mesh is being constructed.
+  const IndexList &indices() const {
+    return _indices;
+  }
   
+  /// Get the bounds of the mesh on the ground (XZ) plane.
+  /// \remarks
+  ///   Only valid while the mesh is being constructed.
+  Bounds2 bounds() const;
+  
+  
+  
+  /// The bounding box of the mesh, captured when it was loaded to the GPU.
+  /// \remarks
+  ///   Static meshes are drawn without a model transform, so this is also
+  ///   their bounding box in world space.
+  const Bounds3 &boundingBox() const {
+    return _boundingBox;
+  }
   
+  /// The number of triangles loaded to the GPU.
+  size_t triangleCount() const {
+    return _loadedIndices / 3;
+  }
   
   /// Load the mesh to the GPU.
+  /// \remarks
+  ///   The vertices are packed when `VertexPacking` is enabled.
   void load();
   
   
   
+  /// Set the buffers of the mesh, and the transform of packed meshes, on an
+  /// encoder without submitting a draw call.
+  /// \param[in] encoder
+  ///   The encoder to set the buffers on.
+  /// \returns
+  ///   Whether the mesh has been loaded and can be drawn.
+  bool setBuffers(bgfx::Encoder *encoder) const;
+  
   /// Submit the mesh to the GPU for rendering.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
+  /// \param[in] shader
+  ///   The shader to use for drawing the mesh.
+  /// \remarks
+  ///   A material should be set before calling this.
+  void draw(bgfx::Encoder *encoder, const Resource<Program> &shader) const;
+  
+  /// Submit many instances of the mesh to the GPU for rendering.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
+  /// \param[in] shader
+  ///   The instanced shader to use for drawing the mesh.
+  /// \param[in] instances
+  ///   The model matrices of the instances.
+  /// \remarks
+  ///   A material should be set before calling this.
+  void draw(bgfx::Encoder *encoder, const Resource<Program> &shader, const bgfx::InstanceDataBuffer &instances) const;
+  
+  /// Submit the mesh to the GPU for rendering at a placement.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
   /// \param[in] shader
   ///   The shader to use for drawing the mesh.
+  /// \param[in] transform
+  ///   The column-major model matrix of the placement.
   /// \remarks
   ///   A material should be set before calling this.
-  void draw(Resource<Program> shader) const;
+  void draw(bgfx::Encoder *encoder, const Resource<Program> &shader, const float *transform) const;
   
   /// Submit the mesh to the GPU for rendering.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
   /// \param[in] material
   ///   The material to use for drawing the mesh.
-  void draw(Resource<Material> material) const;
+  void draw(bgfx::Encoder *encoder, const Resource<Material> &material) const;
   
   
   
@@ -118,7 +206,30 @@ private:
   /// \remarks
   ///   Only stored while the mesh is being constructed.
   ///   Once the mesh has been uploaded to the GPU, this list is kept empty.
-  List<uint16_t> _indices { };
+  IndexList _indices { };
+  
+  /// The transform from packed vertex positions to mesh positions.
+  /// \remarks
+  ///   Only used when the mesh was loaded with packed vertices.
+  VertexPacking::Transform _transform;
+  
+  /// The bounding box of the vertices loaded to the GPU.
+  Bounds3 _boundingBox;
+  
+  /// The number of vertices loaded to the GPU.
+  uint32_t _loadedVertices = 0;
+  
+  /// The number of indices loaded to the GPU.
+  uint32_t _loadedIndices = 0;
+  
+  /// The size of the vertex buffer on the GPU, in bytes.
+  uint32_t _vertexBytes = 0;
+  
+  /// The size of the index buffer on the GPU, in bytes.
+  uint32_t _indexBytes = 0;
+  
+  /// Whether or not the mesh was loaded with packed vertices.
+  bool _packed = false;
   
   /// Whether or not the mesh has been loaded to the GPU.
   bool loaded = false;
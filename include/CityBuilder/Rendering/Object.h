@@ -40,8 +40,20 @@ struct Object {
   
   
   
+  /// The model matrix of the object.
+  Real4x4 modelMatrix() const;
+  
+  /// The bounding box of the object in world space.
+  /// \remarks
+  ///   The mesh must have been loaded.
+  Bounds3 bounds() const;
+  
+  
+  
   /// Render the object.
-  void draw() const;
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
+  void draw(bgfx::Encoder *encoder) const;
 };
 
 NS_CITY_BUILDER_END
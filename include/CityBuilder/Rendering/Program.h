@@ -27,15 +27,17 @@ struct Program {
   ~Program();
   
   /// Submit the program to the GPU.
-  inline void submit() {
-    bgfx::submit(0, _program);
-  }
-  
-  /// Submit the program to the GPU.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
   /// \param[in] view
   ///   The view to submit the program to.
-  inline void submit(bgfx::ViewId view) {
-    bgfx::submit(view, _program);
+  inline void submit(bgfx::Encoder *encoder, bgfx::ViewId view = 0) const {
+    encoder->submit(view, _program);
+  }
+  
+  /// The loaded program handle.
+  inline bgfx::ProgramHandle handle() const {
+    return _program;
   }
   
   /// The standard PBR shader.
@@ -50,6 +52,31 @@ struct Program {
   /// The standard zone shader.
   static Resource<Program> zone;
   
+  /// The road surface shader (samples the road texture array).
+  static Resource<Program> road;
+  
+  /// The standard PBR shader for instanced meshes.
+  static Resource<Program> pbrInstanced;
+  
+  /// The road surface shader for instanced meshes.
+  static Resource<Program> roadInstanced;
+  
+  /// The standard PBR shader for strips extruded on the GPU.
+  static Resource<Program> pbrExtruded;
+  
+  /// The road surface shader for strips extruded on the GPU.
+  static Resource<Program> roadExtruded;
+  
+  /// The instanced vehicle shader, placing vehicles along their lanes.
+  static Resource<Program> vehicle;
+  
+  /// The instanced building shader, scaling shared meshes onto their lots.
+  static Resource<Program> building;
+  
+  /// The instanced building impostor shader, turning a quad for each
+  /// building to face the camera.
+  static Resource<Program> buildingImpostor;
+  
 private:
   /// The loaded program handle.
   bgfx::ProgramHandle _program;
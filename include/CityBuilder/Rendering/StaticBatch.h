@@ -0,0 +1,222 @@
+/**
+ * @file StaticBatch.h
+ * @brief Static meshes merged into chunks by location and material.
+ * @date May 9, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Storage/Map.h>
+#include "DrawList.h"
+#include "Frustum.h"
+#include "Mesh.h"
+#include "Program.h"
+#include "Texture.h"
+
+NS_CITY_BUILDER_BEGIN
+
+/// Static meshes merged into chunks by location and material.
+/// \remarks
+///   Meshes are sorted into square cells on the ground plane by the center of
+///   their bounds, and every mesh in a cell that shares a material is merged
+///   into a single GPU mesh.
+///   Drawing then costs one draw call per cell and material rather than one
+///   per mesh, and a change only rebuilds the cells that it touches.
+///   The cells also form the top level of the culling hierarchy: a cell
+///   outside the view is skipped as a whole, and only the merged meshes of
+///   the remaining cells are tested individually.
+///   Meshes may be added for a single level of detail, in which case each
+///   cell draws the level chosen by its distance from the camera.
+struct StaticBatch {
+  /// The number of levels of detail.
+  static constexpr int levels = 3;
+
+  /// The distance from the camera at which each level of detail past the
+  /// first starts, in meters.
+  /// \remarks
+  ///   A cell only changes level once it is 10% past a boundary so that it
+  ///   doesn't flicker between levels while the camera moves along it.
+  static constexpr float levelDistances[levels - 1] = { 300, 800 };
+
+  /// Choose the level of detail at a distance from the camera.
+  /// \param[in] distance
+  ///   The distance from the camera, in meters.
+  /// \param[in] level
+  ///   The level of detail chosen last frame, which is kept until the
+  ///   distance is 10% past one of its boundaries.
+  /// \returns
+  ///   The level of detail to draw with.
+  static int levelAt(Real distance, int level);
+
+
+
+
+  /// Find how a material is drawn.
+  /// \param[in] material
+  ///   The material to draw.
+  /// \returns
+  ///   The program, texture and uniform to draw the material with.
+  typedef DrawList::Material (*Bind)(Texture *material);
+
+
+
+  /// Create a new static batch.
+  /// \param[in] cellSize
+  ///   The width and depth of a cell, in meters.
+  StaticBatch(Real cellSize = 128);
+
+  // Prevent batch transfer.
+  StaticBatch(const StaticBatch &other) = delete;
+
+
+
+  /// Add a mesh to the batch.
+  /// \param[in] owner
+  ///   The object that the mesh belongs to, used for removal.
+  /// \param[in] material
+  ///   The texture that the mesh is drawn with.
+  /// \param[in] mesh
+  ///   The mesh to add.
+  ///   Must not be loaded to the GPU, as the batch merges its vertices.
+  /// \param[in] tiling
+  ///   The texture tiling of the mesh.
+  ///   Baked into the texture coordinates of the merged mesh.
+  /// \param[in] level
+  ///   The level of detail that the mesh is for, or -1 for every level.
+  void add(const void *owner, Texture *material, Resource<Mesh> mesh, Real2 tiling, int level = -1);
+
+  /// Remove every mesh that belongs to an owner from the batch.
+  /// \param[in] owner
+  ///   The owner of the meshes to remove.
+  void remove(const void *owner);
+
+
+
+  /// Rebuild any cells that have changed.
+  void update();
+
+  /// Find the merged meshes that are visible and choose the level of detail
+  /// of every visible cell.
+  /// \param[in] frustum
+  ///   The frustum of the camera being drawn to.
+  /// \param[in] eye
+  ///   The position of the camera being drawn to.
+  /// \param[in,out] stats
+  ///   The culling statistics to add the visible and culled meshes to.
+  void cull(const Frustum &frustum, Real3 eye, Frustum::Stats &stats);
+
+  /// Add the merged meshes found visible by the last `cull` to a draw list.
+  /// \param[in] list
+  ///   The draw list to add the meshes to.
+  /// \param[in] bind
+  ///   Finds how the material of each mesh is drawn.
+  /// \param[in] state
+  ///   The render state to draw with.
+  /// \param[in] first
+  ///   The first visible mesh to draw.
+  /// \param[in] count
+  ///   The number of visible meshes to draw, clamped to those remaining.
+  /// \returns
+  ///   The number of draws added.
+  /// \remarks
+  ///   Separate ranges of the visible meshes may be added at the same time
+  ///   from different threads, each to its own list.
+  int draw(DrawList &list, Bind bind, uint64_t state, size_t first = 0, size_t count = SIZE_MAX) const;
+
+  /// The number of merged meshes found visible by the last `cull`.
+  size_t visibleCount() const {
+    return _visible.count();
+  }
+
+  /// The number of triangles in the merged meshes found visible by the last
+  /// `cull`.
+  size_t triangles() const {
+    return _triangles;
+  }
+
+
+
+private:
+  /// A mesh added to the batch.
+  struct _part {
+    /// The object the mesh belongs to.
+    const void *owner;
+
+    /// The mesh.
+    Resource<Mesh> mesh;
+
+    /// The texture tiling of the mesh.
+    Real2 tiling;
+
+    /// The level of detail of the mesh, or -1 for every level.
+    int level;
+  };
+
+  /// Every mesh in a cell that shares a material.
+  struct _chunk {
+    /// The material of the chunk.
+    Texture *material;
+
+    /// The meshes in the chunk.
+    List<_part> parts { };
+
+    /// The merged GPU meshes of the chunk for each level of detail.
+    /// \remarks
+    ///   A chunk is split into several meshes rather than needing 32-bit
+    ///   indices.
+    List<Resource<Mesh>> meshes[levels] { };
+  };
+
+  /// A square area of the ground plane.
+  struct _cell {
+    /// The chunks of the cell, one per material.
+    List<_chunk> chunks { };
+
+    /// The bounds of the merged meshes of the cell.
+    Bounds3 bounds;
+
+    /// The level of detail that the cell is drawn with.
+    int level = 0;
+
+    /// Whether or not the cell needs to be rebuilt.
+    bool dirty = false;
+  };
+
+  /// A merged mesh to draw.
+  struct _draw {
+    /// The material of the mesh.
+    Texture *material;
+
+    /// The merged mesh.
+    const Mesh *mesh;
+  };
+
+  /// Find or create the cell containing a point.
+  /// \param[in] point
+  ///   The point on the ground plane.
+  /// \returns
+  ///   The index of the cell.
+  int _cellAt(Real2 point);
+
+  /// The width and depth of a cell, in meters.
+  Real _cellSize;
+
+  /// The cells of the batch.
+  List<_cell> _cells { };
+
+  /// The merged meshes found visible by the last `cull`.
+  List<_draw> _visible { };
+
+  /// The number of triangles in `_visible`.
+  size_t _triangles = 0;
+
+  /// The index of every cell by its packed coordinates.
+  Map<uint32_t, int> _cellIndices;
+
+  /// The cells that contain meshes of each owner.
+  Map<const void *, List<int>> _owners;
+};
+
+NS_CITY_BUILDER_END
@@ -8,34 +8,54 @@
 #pragma once
 #include <CityBuilder/Common.h>
 #include <CityBuilder/Storage/String.h>
+#include "TextureLoader.h"
 
 NS_CITY_BUILDER_BEGIN
 
+struct TextureArray;
+
 /// A texture resource.
+/// \remarks
+///   Textures are loaded in the background by the `TextureLoader` and bind a
+///   placeholder until they are ready.
 struct Texture {
   /// Load a texture from a file.
   /// \param[in] name
   ///   The resource name of the texture to load.
-  /// \param[in] size
-  ///   The width/height of the texture.
-  /// \param[in] mipMaps
-  ///   Whether the texture has mip-maps generated for it.
   /// \remarks
-  ///   The texture must be square.
-  Texture(const String &name, int size = 128, bool mipMaps = true);
+  ///   The size, format and mip-maps of the texture are read from the texture
+  ///   itself.
+  Texture(const String &name);
   
   /// Load a texture from a file.
   /// \param[in] name
   ///   The resource name of the texture to load.
   /// \param[in] flags
   ///   The flags to use when creating the texture.
-  /// \param[in] size
-  ///   The width/height of the texture.
-  /// \param[in] mipMaps
-  ///   Whether the texture has mip-maps generated for it.
+  /// \param[in] streamMips
+  ///   Whether the top mip levels may be held back until the camera is close
+  ///   (see `TextureLoader::setMipBias`).
+  /// \remarks
+  ///   The size, format and mip-maps of the texture are read from the texture
+  ///   itself.
+  Texture(const String &name, uint64_t flags, bool streamMips = false);
+  
+  /// Load a texture as a layer of a texture array.
+  /// \param[in] array
+  ///   The array to add the texture to.
+  ///   Must not have started loading yet.
+  /// \param[in] name
+  ///   The resource name of the texture to load.
   /// \remarks
-  ///   The texture must be square.
-  Texture(const String &name, uint64_t flags, int size = 128, bool mipMaps = true);
+  ///   When texture arrays are not supported the texture is loaded on its own
+  ///   with the flags and mip streaming of the array.
+  Texture(TextureArray &array, const String &name);
+  
+  /// Load a texture assembled from several images (e.x. an atlas).
+  /// \param[in] request
+  ///   A description of the images and how to assemble them.
+  ///   The request's target is ignored.
+  Texture(TextureLoader::Request request);
   
   // Prevent texture transfer.
   Texture(const Texture &other) = delete;
@@ -45,22 +65,52 @@ struct Texture {
   
   
   /// Submit the texture to the GPU.
+  /// \param[in] encoder
+  ///   The encoder to record the texture with.
   /// \param[in] uniform
   ///   The uniform to write the texture to.
-  inline void load(bgfx::UniformHandle uniform) {
-    bgfx::setTexture(0, uniform, _handle);
+  inline void load(bgfx::Encoder *encoder, bgfx::UniformHandle uniform) const {
+    encoder->setTexture(0, uniform, _handle);
   }
   
   /// Submit the texture to the GPU.
+  /// \param[in] encoder
+  ///   The encoder to record the texture with.
+  /// \param[in] stage
+  ///   The texture stage to bind the texture to.
   /// \param[in] uniform
   ///   The uniform to write the texture to.
-  inline void load(uint8_t stage, bgfx::UniformHandle uniform) {
-    bgfx::setTexture(stage, uniform, _handle);
+  inline void load(bgfx::Encoder *encoder, uint8_t stage, bgfx::UniformHandle uniform) const {
+    encoder->setTexture(stage, uniform, _handle);
+  }
+  
+  /// Whether the texture has finished loading.
+  bool ready() const;
+  
+  /// The current texture handle, which is a placeholder until loaded.
+  inline bgfx::TextureHandle handle() const {
+    return _handle;
+  }
+  
+  /// The texture array that the texture is a layer of, if any.
+  inline TextureArray *array() const {
+    return _array;
+  }
+  
+  /// The index of the texture in its texture array.
+  inline int layer() const {
+    return _layer;
   }
   
 private:
   /// The internal texture handle.
   bgfx::TextureHandle _handle;
+  
+  /// The texture array that the texture is a layer of, if any.
+  TextureArray *_array = nullptr;
+  
+  /// The index of the texture in its texture array.
+  int _layer = 0;
 };
 
 NS_CITY_BUILDER_END
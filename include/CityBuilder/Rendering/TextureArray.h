@@ -0,0 +1,107 @@
+/**
+ * @file TextureArray.h
+ * @brief A set of textures packed into a single 2D texture array.
+ * @date May 4, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Storage/String.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// A set of equally sized textures packed into the layers of a single 2D
+/// texture array.
+/// \remarks
+///   Lets meshes with different textures be drawn with the same texture
+///   binding, selecting the layer with `Uniforms::u_textureLayer`.
+///   Every layer must have the same size, format and number of mip levels.
+struct TextureArray {
+  /// Create a new, empty texture array.
+  /// \param[in] flags
+  ///   The flags to use when creating the texture.
+  /// \param[in] streamMips
+  ///   Whether the top mip levels may be held back until the camera is close
+  ///   (see `TextureLoader::setMipBias`).
+  TextureArray(
+    uint64_t flags = BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE,
+    bool streamMips = false
+  );
+
+  // Prevent texture array transfer.
+  TextureArray(const TextureArray &other) = delete;
+
+  ~TextureArray();
+
+
+
+  /// Add a texture as a layer of the array.
+  /// \param[in] name
+  ///   The resource name of the texture to add.
+  /// \returns
+  ///   The index of the layer, or `-1` if texture arrays are not supported or
+  ///   the array has already started loading.
+  int add(const String &name);
+
+  /// Start loading all of the layers of the array in the background.
+  void stream();
+
+  /// Whether the array has finished loading.
+  bool ready() const;
+
+  /// Submit the texture array to the GPU.
+  /// \param[in] encoder
+  ///   The encoder to record the texture array with.
+  /// \param[in] stage
+  ///   The texture stage to bind the array to.
+  /// \param[in] uniform
+  ///   The uniform to write the texture array to.
+  inline void load(bgfx::Encoder *encoder, uint8_t stage, bgfx::UniformHandle uniform) const {
+    encoder->setTexture(stage, uniform, _handle);
+  }
+
+  /// The current texture handle, which is a placeholder until loaded.
+  inline bgfx::TextureHandle handle() const {
+    return _handle;
+  }
+
+
+
+  /// The number of layers in the array.
+  inline int count() const {
+    return (int)_layers.count();
+  }
+
+  /// The flags used to create the texture.
+  inline uint64_t flags() const {
+    return _flags;
+  }
+
+  /// Whether the top mip levels may be held back until they are needed.
+  inline bool streamMips() const {
+    return _streamMips;
+  }
+
+  /// Whether texture arrays are supported by the renderer.
+  static bool supported();
+
+private:
+  /// The internal texture handle.
+  bgfx::TextureHandle _handle = BGFX_INVALID_HANDLE;
+
+  /// The resource names of the layers.
+  List<String> _layers { };
+
+  /// The texture creation flags.
+  uint64_t _flags;
+
+  /// Whether the top mip levels may be held back until they are needed.
+  bool _streamMips;
+
+  /// Whether the array has started loading.
+  bool _streamed = false;
+};
+
+NS_CITY_BUILDER_END
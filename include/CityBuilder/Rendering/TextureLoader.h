@@ -0,0 +1,201 @@
+/**
+ * @file TextureLoader.h
+ * @brief A background texture loader.
+ * @date May 4, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Storage/String.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// A background texture loader.
+/// \remarks
+///   Texture files are read and assembled on a worker thread.
+///   The assembled textures are then uploaded to the GPU from the main thread
+///   in `update`, a few per frame, so that loading never stalls a frame.
+///   Until a texture has been uploaded its handle points at a placeholder.
+struct TextureLoader {
+  /// A single source image of a texture request.
+  struct Layer {
+    /// The resource name of the image.
+    String name;
+
+    /// The horizontal position of the image within the texture, in pixels.
+    /// \remarks
+    ///   Only used for atlases.
+    int x = 0;
+
+    /// The vertical position of the image within the texture, in pixels.
+    /// \remarks
+    ///   Only used for atlases.
+    int y = 0;
+
+    /// The width and height of the image, in pixels.
+    int size = 0;
+  };
+
+  /// The ways that source images can be combined into a texture.
+  enum class Kind : uint8_t {
+    /// A single image (one layer).
+    texture,
+    /// Every image is a layer of a 2D texture array.
+    array,
+    /// Every image is copied into a region of a single texture.
+    atlas,
+  };
+
+  /// A request to load a texture.
+  struct Request {
+    /// Where the texture handle is written once the texture is uploaded.
+    bgfx::TextureHandle *target;
+
+    /// How the layers are combined.
+    Kind kind = Kind::texture;
+
+    /// The source images of the texture.
+    List<Layer> layers { };
+
+    /// The width of the texture, in pixels.
+    /// \remarks
+    ///   Only used for atlases, otherwise read from the images.
+    int width = 0;
+
+    /// The height of the texture, in pixels.
+    /// \remarks
+    ///   Only used for atlases, otherwise read from the images.
+    int height = 0;
+
+    /// The texture creation flags.
+    uint64_t flags = BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE;
+
+    /// Whether the top mip levels may be held back until they are needed.
+    /// \remarks
+    ///   See `setMipBias`.
+    bool streamMips = false;
+  };
+
+  /// A description of a texture image.
+  struct Info {
+    /// The format of the image.
+    bgfx::TextureFormat::Enum format;
+
+    /// The width of the top mip level, in pixels.
+    int width;
+
+    /// The height of the top mip level, in pixels.
+    int height;
+
+    /// The number of array layers in the image.
+    int layers;
+
+    /// The number of mip levels in the image.
+    int mips;
+  };
+
+  /// A texture that has been uploaded to the GPU.
+  struct Resident {
+    /// The name of the texture.
+    String name;
+
+    /// The description of the uploaded texture.
+    Info info;
+
+    /// The number of bytes of GPU memory used by the texture.
+    size_t bytes;
+
+    /// The number of top mip levels that were left out.
+    int skip;
+  };
+
+
+
+  /// Start the background loader.
+  /// \remarks
+  ///   Must be called after bgfx has been initialized.
+  static void start();
+
+  /// Stop the background loader, discarding any queued requests.
+  static void stop();
+
+  /// Queue a texture to be loaded.
+  /// \param[in] request
+  ///   The texture to load.
+  /// \remarks
+  ///   The target handle is immediately set to a placeholder.
+  static void request(const Request &request);
+
+  /// Cancel any queued request for a target.
+  /// \param[in] target
+  ///   The target handle of the request to cancel.
+  /// \remarks
+  ///   Must be called before the target handle is freed.
+  static void cancel(bgfx::TextureHandle *target);
+
+  /// Cancel any queued request for a target and destroy its texture.
+  /// \param[in] target
+  ///   The target handle of the texture to release.
+  /// \remarks
+  ///   Must be called before the target handle is freed.
+  static void release(bgfx::TextureHandle *target);
+
+  /// Upload any loaded textures to the GPU.
+  /// \param[in] budget
+  ///   The maximum number of textures to upload.
+  /// \remarks
+  ///   Should be called once per frame from the main thread.
+  static void update(int budget = 4);
+
+  /// Block until every queued texture has been uploaded.
+  static void flush();
+
+  /// Read the description of a texture image.
+  /// \param[in] name
+  ///   The resource name of the image.
+  /// \param[out] info
+  ///   The description of the image.
+  /// \returns
+  ///   Whether or not the image could be read.
+  /// \remarks
+  ///   Reads the asset archive's metadata when the image is in the archive,
+  ///   otherwise reads the image's file header.
+  static bool describe(const String &name, Info &info);
+
+  /// Set how many of the top mip levels of streamed textures are held back
+  /// while the camera is far away.
+  /// \param[in] levels
+  ///   The number of mip levels to hold back, zero to always load every
+  ///   level.
+  /// \remarks
+  ///   Meant for memory-constrained systems: a texture with its top mip
+  ///   held back uses a quarter of the memory.
+  ///   Must be set before any textures are requested.
+  static void setMipBias(int levels);
+
+  /// Set whether streamed textures should have every mip level loaded.
+  /// \param[in] full
+  ///   Whether the camera is close enough for the top mip levels to be
+  ///   visible.
+  /// \remarks
+  ///   Streamed textures are reloaded in the background whenever this
+  ///   changes, keeping their current mip levels until the reload is ready.
+  ///   Has no effect without a mip bias.
+  static void setFullDetail(bool full);
+
+  /// The number of bytes of GPU memory used by all loaded textures.
+  static size_t memoryUsed();
+
+  /// Every texture uploaded to the GPU, largest first.
+  static List<Resident> residents();
+
+  /// Whether a handle is one of the placeholder textures.
+  static bool isPlaceholder(bgfx::TextureHandle handle);
+
+  /// The number of textures still waiting to be uploaded.
+  static size_t pending();
+};
+
+NS_CITY_BUILDER_END
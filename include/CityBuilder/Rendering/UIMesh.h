@@ -8,6 +8,7 @@
 #pragma once
 #include <CityBuilder/Common.h>
 #include <CityBuilder/Storage/List.h>
+#include "IndexList.h"
 #include <CityBuilder/Geometry/Profile.h>
 #include "Material.h"
 
@@ -44,6 +45,14 @@ struct UIMesh {
   ///   vertex list of the mesh.
   UIMesh &add(const List<Vertex> &vertices, const List<int> &indices);
   
+  /// Map the texture coordinates of every vertex into a region of a texture.
+  /// \param[in] region
+  ///   The region as (left, top, width, height) in texture coordinates.
+  /// \remarks
+  ///   Used to draw an image that is packed into a texture atlas.
+  ///   Must be called before the mesh is loaded.
+  UIMesh &mapTextureCoordinates(Real4 region);
+  
   
   
   /// Load the mesh to the GPU.
@@ -52,11 +61,13 @@ struct UIMesh {
   
   
   /// Submit the mesh to the GPU for rendering.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
   /// \param[in] shader
   ///   The shader to use for drawing the mesh.
   /// \remarks
   ///   A material should be set before calling this.
-  void draw(Resource<Program> shader) const;
+  void draw(bgfx::Encoder *encoder, const Resource<Program> &shader) const;
   
   
   
@@ -81,7 +92,7 @@ private:
   /// \remarks
   ///   Only stored while the mesh is being constructed.
   ///   Once the mesh has been uploaded to the GPU, this list is kept empty.
-  List<uint16_t> _indices { };
+  IndexList _indices { };
   
   /// Whether or not the mesh has been loaded to the GPU.
   bool loaded = false;
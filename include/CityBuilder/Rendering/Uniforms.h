@@ -23,6 +23,12 @@ extern bgfx::UniformHandle u_sunDirection;
 /// The global texture tile.
 extern bgfx::UniformHandle u_textureTile;
 
+/// The layer of the albedo texture array to sample (x).
+extern bgfx::UniformHandle u_textureLayer;
+
+/// The time since the last traffic simulation step, in seconds (x).
+extern bgfx::UniformHandle u_vehicleMotion;
+
 
 
 /// The albedo texture.
@@ -31,6 +37,12 @@ extern bgfx::UniformHandle s_albedo;
 /// The UI texture.
 extern bgfx::UniformHandle s_ui;
 
+/// The albedo texture array.
+extern bgfx::UniformHandle s_albedoArray;
+
+/// The curves of the lanes that vehicles drive along.
+extern bgfx::UniformHandle s_laneCurves;
+
 
 
 /// Create the global shader uniforms.
@@ -0,0 +1,187 @@
+/**
+ * @file VehicleBatch.h
+ * @brief The vehicles of the traffic simulation drawn with GPU instancing.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Roads/LaneGraph.h>
+#include <CityBuilder/Simulation/TrafficSimulation.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// The vehicles of the traffic simulation drawn with GPU instancing.
+/// \remarks
+///   Rather than placing every vehicle on the CPU each frame, the curve of
+///   every lane is kept in a texture, and each vehicle is only its lane,
+///   position along it, speed and acceleration as of the last simulation
+///   step, in one instance (`i_data0`) of a shared vehicle mesh.
+///   The `vehicle` vertex shader finds where each vehicle has got to since
+///   the last step from its speed and acceleration and places it on the
+///   curve of its lane, so vehicles move smoothly however much faster the
+///   frame rate is than the simulation.
+///   The instances are uploaded once per simulation step, and the lane
+///   curves only when the lane graph changes, leaving each frame a single
+///   draw call whatever the number of vehicles. Vehicles are not culled.
+///   Each lane takes `curveTexels` texels of the curve texture:
+///   - The start and first control point of the road's cubic Bézier curve.
+///   - The second control point and end of the curve.
+///   - The offset of the lane to the right of the curve, its elevation, its
+///     length, and whether traffic travels from the end of the curve to its
+///     start.
+///   - Two texels of the curve parameters at every eighth of the lane's
+///     length, from the first eighth to the seventh.
+///   The same batch draws the agents of the `PedestrianSimulation` with a
+///   pedestrian body, keeping to the right of their sidewalk so that those
+///   walking each way pass each other.
+struct VehicleBatch {
+  /// The number of texels of the curve texture taken by each lane.
+  static constexpr int curveTexels = 5;
+
+  /// The number of lanes in each row of the curve texture.
+  /// \remarks
+  ///   Must match `CURVES_PER_ROW` in `vehicle.vertex.sc`.
+  static constexpr int curvesPerRow = 204;
+
+  /// The body drawn for every instance.
+  enum class Body {
+    /// A car.
+    vehicle,
+
+    /// A person on foot.
+    pedestrian,
+  };
+
+  /// The cost of drawing the vehicles since the last `resetStats`.
+  struct Stats {
+    /// The number of times the instances were uploaded.
+    size_t uploads = 0;
+
+    /// The number of times the lane curves were uploaded.
+    size_t curveUploads = 0;
+
+    /// The number of frames drawn.
+    size_t frames = 0;
+
+    /// The time spent uploading instances, in microseconds.
+    double uploadTime = 0;
+
+    /// The time spent uploading lane curves, in microseconds.
+    double curveTime = 0;
+
+    /// The time spent recording draw calls, in microseconds.
+    double drawTime = 0;
+  };
+
+
+
+  /// Create a batch of vehicles or pedestrians.
+  /// \param[in] body
+  ///   The body drawn for every instance.
+  VehicleBatch(Body body = Body::vehicle) : _body(body) { }
+
+  ~VehicleBatch();
+
+  // Prevent batch transfer.
+  VehicleBatch(const VehicleBatch &other) = delete;
+
+
+
+  /// Upload the curve of every lane, if the lane graph has changed since the
+  /// last upload.
+  /// \param[in] graph
+  ///   The lane graph that the vehicles drive on.
+  /// \returns
+  ///   Whether the graph had changed since the last upload.
+  bool setCurves(const LaneGraph &graph);
+
+  /// Upload the state of every vehicle as of the last simulation step.
+  /// \param[in] traffic
+  ///   The simulation to draw the vehicles of.
+  void update(const TrafficSimulation &traffic);
+
+  /// Upload the state of every instance as of the last simulation step.
+  /// \param[in] snapshots
+  ///   The instances to draw, such as the agents of a
+  ///   `PedestrianSimulation`.
+  void update(const List<TrafficSimulation::Snapshot> &snapshots);
+
+  /// Draw every vehicle.
+  /// \param[in] encoder
+  ///   The encoder to record the draw call with.
+  /// \param[in] lag
+  ///   The time since the last simulation step, in seconds.
+  void draw(bgfx::Encoder *encoder, float lag);
+
+  /// The number of vehicles uploaded.
+  size_t count() const {
+    return _count;
+  }
+
+  /// What the batch draws.
+  Body body() const {
+    return _body;
+  }
+
+  /// The number of rows of lane curves uploaded.
+  size_t curveRows() const {
+    return _curveRows;
+  }
+
+
+
+  /// The cost of drawing the vehicles since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the cost of drawing the vehicles so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+private:
+  /// Create the shared vehicle mesh.
+  void _createMesh();
+
+  /// Upload the state of every instance.
+  /// \param[in] memory
+  ///   The state of every instance.
+  /// \param[in] count
+  ///   The number of instances.
+  void _upload(const bgfx::Memory *memory, size_t count);
+
+  /// The body drawn for every instance.
+  Body _body;
+
+  /// The shared vehicle mesh.
+  bgfx::VertexBufferHandle _vertices = BGFX_INVALID_HANDLE;
+
+  /// The indices of the shared vehicle mesh.
+  bgfx::IndexBufferHandle _indices = BGFX_INVALID_HANDLE;
+
+  /// The state of every vehicle.
+  bgfx::DynamicVertexBufferHandle _instances = BGFX_INVALID_HANDLE;
+
+  /// The curve of every lane.
+  bgfx::TextureHandle _curves = BGFX_INVALID_HANDLE;
+
+  /// The number of rows of the curve texture.
+  uint16_t _curveRows = 0;
+
+  /// The version of the lane graph that the curves were last uploaded for.
+  uint64_t _version = 0;
+
+  /// Whether the curves have been uploaded at all.
+  bool _hasCurves = false;
+
+  /// The number of vehicles uploaded.
+  size_t _count = 0;
+
+  /// The cost of drawing the vehicles since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
@@ -0,0 +1,145 @@
+/**
+ * @file VertexPacking.h
+ * @brief A compact, quantized vertex format for static meshes.
+ * @date May 11, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// A compact, quantized vertex format for static meshes.
+/// \remarks
+///   When enabled, `Mesh` and `ColorMesh` upload their vertices packed into
+///   16 (or 20 with a color) bytes rather than 32 (or 36):
+///   - Positions are 16-bit normalized integers relative to the bounds of the
+///     mesh, which are restored by the mesh's model transform.
+///   - Normals are octahedral-encoded into two 8-bit normalized integers.
+///   - Texture coordinates are half floats, with the whole number of tiles
+///     along the texture's V axis kept in two more 8-bit integers so that
+///     long roads with tiling baked in keep their precision.
+///   Packed meshes must be drawn with the `packed` vertex shaders.
+struct VertexPacking {
+  /// A packed vertex.
+  struct Vertex {
+    /// The position within the bounds of the mesh, from -1 to 1 (w unused).
+    int16_t position[4];
+    /// The texture coordinates, with only the fraction of V, as half floats.
+    uint16_t uv[2];
+    /// The octahedral-encoded normal (xy) and the whole number of tiles of V
+    /// as a 16-bit integer (zw).
+    uint8_t normalTile[4];
+  };
+
+  /// A packed vertex with a color.
+  struct ColorVertex : Vertex {
+    /// The color of the vertex.
+    Color4 color;
+  };
+
+  /// The transform from packed positions back to mesh positions.
+  struct Transform {
+    /// The center of the bounds of the mesh.
+    Real3 center;
+
+    /// Half the size of the bounds of the mesh.
+    Real3 extent;
+
+    /// Write the transform as a model matrix for `bgfx::setTransform`.
+    /// \param[out] matrix
+    ///   The 4x4 column-major matrix to write to.
+    void matrix(float *matrix) const;
+  };
+
+  /// The GPU memory used by a set of meshes.
+  struct Usage {
+    /// The number of meshes.
+    size_t meshes = 0;
+
+    /// The number of vertices.
+    size_t vertices = 0;
+
+    /// The size of the vertex buffers, in bytes.
+    size_t vertexBytes = 0;
+
+    /// The size of the index buffers, in bytes.
+    size_t indexBytes = 0;
+  };
+
+
+
+  /// Set whether static meshes are packed when they are loaded.
+  /// \param[in] enabled
+  ///   Whether to pack static meshes.
+  /// \remarks
+  ///   Must be set before any meshes are loaded or programs are created.
+  static void setEnabled(bool enabled);
+
+  /// Whether static meshes are packed when they are loaded.
+  static bool enabled();
+
+  /// The name of the vertex shader to use for static meshes.
+  /// \param[in] name
+  ///   The name of the unpacked vertex shader.
+  /// \returns
+  ///   The packed variant of the shader when packing is enabled, otherwise
+  ///   the given name.
+  static const char *vertexShader(const char *name);
+
+
+
+  /// Find the transform that fits a set of positions.
+  /// \param[in] positions
+  ///   The first position.
+  /// \param[in] count
+  ///   The number of positions.
+  /// \param[in] stride
+  ///   The distance between consecutive positions, in bytes.
+  static Transform fit(const Real3 *positions, size_t count, size_t stride);
+
+  /// Pack a vertex.
+  /// \param[out] vertex
+  ///   The packed vertex.
+  /// \param[in] transform
+  ///   The transform of the mesh, from `fit`.
+  /// \param[in] position
+  ///   The position of the vertex.
+  /// \param[in] normal
+  ///   The normal of the vertex.
+  /// \param[in] uv
+  ///   The texture coordinates of the vertex.
+  static void pack(Vertex &vertex, const Transform &transform, Real3 position, Real3 normal, Real2 uv);
+
+  /// The vertex layout of `Vertex`.
+  static const bgfx::VertexLayout &layout();
+
+  /// The vertex layout of `ColorVertex`.
+  static const bgfx::VertexLayout &colorLayout();
+
+
+
+  /// Record the GPU memory of a loaded static mesh.
+  /// \param[in] packed
+  ///   Whether the mesh was packed.
+  /// \param[in] vertices
+  ///   The number of vertices of the mesh.
+  /// \param[in] vertexBytes
+  ///   The size of the vertex buffer of the mesh, in bytes.
+  /// \param[in] indexBytes
+  ///   The size of the index buffer of the mesh, in bytes.
+  static void track(bool packed, size_t vertices, size_t vertexBytes, size_t indexBytes);
+
+  /// Forget the GPU memory of an unloaded static mesh.
+  /// \remarks
+  ///   Takes the same parameters as the matching `track`.
+  static void untrack(bool packed, size_t vertices, size_t vertexBytes, size_t indexBytes);
+
+  /// The GPU memory used by loaded static meshes.
+  /// \param[in] packed
+  ///   Whether to count the packed or unpacked meshes.
+  static Usage usage(bool packed);
+};
+
+NS_CITY_BUILDER_END
@@ -73,6 +73,7 @@ private:
   struct _mesh {
     Texture *texture;
     Resource<Mesh> mesh;
+    Real2 textureTiling;
   };
   
   /// The intersection's meshes.
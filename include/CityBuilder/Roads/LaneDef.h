@@ -12,6 +12,7 @@
 #include <CityBuilder/Geometry/Profile.h>
 #include <CityBuilder/Rendering/Resource.h>
 #include <CityBuilder/Rendering/Texture.h>
+#include <CityBuilder/Rendering/TextureArray.h>
 
 NS_CITY_BUILDER_BEGIN
 
@@ -80,6 +81,12 @@ struct LaneDef {
   /// A map of all of the loaded lanes.
   static Map<String, LaneDef> lanes;
   
+  /// The texture array that all road surface textures are packed into.
+  /// \remarks
+  ///   Created on first use, textures are only added to it before it is
+  ///   streamed by the road network.
+  static TextureArray &surfaces();
+  
   
   
   /// Attempt to load a road lane.
@@ -97,6 +104,20 @@ struct LaneDef {
   /// \returns
   ///   Whether or not all of the loading operations were successful.
   static bool loadBatch(const char *directory, ...);
+  
+  /// Parse a lane definition already in memory, without loading its texture
+  /// or saving it.
+  /// \param[in] path
+  ///   The path to the lane file, for errors.
+  /// \param[in] contents
+  ///   The contents of the lane file.
+  /// \param[in] length
+  ///   The length of the contents.
+  /// \param[out] lane
+  ///   The lane to parse into.
+  /// \returns
+  ///   Whether or not the lane was parsed successfully.
+  static bool parse(const String &path, const char *contents, size_t length, LaneDef &lane);
 };
 
 
@@ -0,0 +1,256 @@
+/**
+ * @file LaneGraph.h
+ * @brief A lane-level routing graph compiled from the road network.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include "Road.h"
+#include "Intersection.h"
+
+NS_CITY_BUILDER_BEGIN
+
+/// A lane-level routing graph compiled from the road network.
+/// \remarks
+///   Every lane of every road is compiled into directed segments, one per
+///   direction that traffic may travel along the lane: right lanes travel
+///   from the start of their road to its end, left lanes from its end to its
+///   start, and unordered lanes (sidewalks) both ways.
+///   The segments are connected by edges where one segment may continue onto
+///   another: across a joint between two roads, through an intersection as
+///   chosen by the `LaneDef::Traffic::Connection` of the lane, or by turning
+///   around at a dead end.
+///   The edges are stored in compressed sparse row form: the edges leaving a
+///   segment are `edges()[offsets()[segment]]` up to, but not including,
+///   `edges()[offsets()[segment + 1]]`, so that a search only ever walks two
+///   flat arrays.
+///   The graph is rebuilt incrementally: only the segments of the roads
+///   invalidated since the last `update`, and those of their neighbours, are
+///   compiled again. Their edges are overwritten where they are when their
+///   number does not change, as when a road is only reshaped, and otherwise
+///   the arrays are repacked once for all of them.
+struct LaneGraph {
+  /// A directed segment of a lane along a road.
+  struct Segment {
+    /// The road of the segment, or `nullptr` if the segment is unused.
+    Road *road;
+
+    /// The index of the lane in the road definition.
+    uint16_t lane;
+
+    /// The index of the traffic pattern in the lane definition.
+    uint8_t traffic;
+
+    /// Whether traffic travels from the start of the road to its end.
+    bool forward;
+
+    /// The category of traffic that may use the segment.
+    LaneDef::Traffic::Category category;
+
+    /// The length of the segment, in meters.
+    float length;
+
+    /// The speed that traffic travels along the segment, in meters per
+    /// second.
+    float speed;
+
+    /// The time taken to travel the segment, in seconds.
+    float cost;
+
+    /// The point at which traffic enters the segment.
+    Real2 start;
+
+    /// The point at which traffic leaves the segment.
+    Real2 end;
+  };
+
+  /// A movement from the end of one segment onto the start of another.
+  struct Edge {
+    /// The segment moved onto.
+    uint32_t target;
+
+    /// The length of the movement itself, in meters, which is zero across a
+    /// joint between roads.
+    float length;
+
+    /// The time taken by the movement itself, in seconds, not counting the
+    /// cost of the target segment.
+    float cost;
+
+    /// Whether the movement turns through an intersection or around at a
+    /// dead end.
+    bool turn;
+  };
+
+  /// The cost of the updates since the last `resetStats`.
+  struct Stats {
+    /// The number of updates that changed the graph.
+    size_t updates = 0;
+
+    /// The number of segments compiled again.
+    size_t segments = 0;
+
+    /// The time spent updating, in microseconds.
+    double time = 0;
+  };
+
+  /// The speed that pedestrians walk at, in meters per second.
+  static constexpr float walkingSpeed = 1.4f;
+
+  /// The speed of vehicle lanes without a speed limit, in miles per hour.
+  static constexpr int defaultSpeedLimit = 25;
+
+  /// How far apart the ends of two lanes may be and still join across a
+  /// joint between roads, in meters.
+  static constexpr float jointTolerance = 0.5f;
+
+
+
+  LaneGraph() { }
+
+  // Prevent graph transfer.
+  LaneGraph(const LaneGraph &other) = delete;
+
+
+
+  /// Compile a road again on the next `update`, along with its neighbours.
+  /// \param[in] road
+  ///   The road that was added or changed.
+  void invalidate(Road *road);
+
+  /// Compile every road of an intersection again on the next `update`.
+  /// \param[in] intersection
+  ///   The intersection that was added or changed.
+  void invalidate(Intersection *intersection);
+
+  /// Remove a road from the graph.
+  /// \param[in] road
+  ///   The road that was removed from the network.
+  /// \remarks
+  ///   The segments of the road are freed immediately and reused after the
+  ///   next `update`, which also removes any edge onto them.
+  void remove(Road *road);
+
+  /// Compile every invalidated road and repack the edges.
+  /// \returns
+  ///   Whether anything changed.
+  bool update();
+
+
+
+  /// The segments of the graph, indexed by segment, including unused ones.
+  const List<Segment> &segments() const {
+    return _segments;
+  }
+
+  /// The first edge of every segment, with one more entry at the end.
+  const List<uint32_t> &offsets() const {
+    return _offsets;
+  }
+
+  /// The edges of every segment, ordered by segment.
+  const List<Edge> &edges() const {
+    return _edges;
+  }
+
+  /// The segments of a road.
+  /// \param[in] road
+  ///   The road to get the segments of.
+  const List<uint32_t> &segments(const Road *road) const {
+    return road->_laneSegments;
+  }
+
+  /// The number of segments in use.
+  size_t count() const {
+    return _segments.count() - _free.count() - _released.count();
+  }
+
+  /// The number of updates that changed the graph so far, for users that
+  /// derive data from it to know when to update.
+  uint64_t version() const {
+    return _version;
+  }
+
+
+
+  /// The cost of the updates since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the cost of the updates so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+  /// Build a square grid of roads joined by intersections, for benchmarks.
+  /// \param[in] road
+  ///   The road definition to build the grid out of.
+  /// \param[in] segments
+  ///   The number of segments that the grid should compile into, roughly.
+  /// \param[out] roads
+  ///   The list to append the roads to, which the caller must delete.
+  /// \param[out] intersections
+  ///   The list to append the intersections to, which the caller must
+  ///   delete.
+  static void buildGrid(RoadDef *road, size_t segments, List<Road *> &roads, List<Intersection *> &intersections);
+
+private:
+  /// Queue a road to be compiled again.
+  /// \param[in] road
+  ///   The road to queue.
+  void _queue(Road *road);
+
+  /// Queue the neighbours of a road to be compiled again.
+  /// \param[in] road
+  ///   The road whose neighbours to queue.
+  void _queueNeighbours(Road *road);
+
+  /// Free the segments of a road.
+  /// \param[in] road
+  ///   The road to free the segments of.
+  void _release(Road *road);
+
+  /// Create the segments of a road, or update them in place if it already
+  /// has them.
+  /// \param[in] road
+  ///   The road to create the segments of.
+  void _build(Road *road);
+
+  /// Find the edges leaving a segment.
+  /// \param[in] id
+  ///   The segment to find the edges of.
+  /// \param[out] edges
+  ///   The list to append the edges to.
+  void _connect(uint32_t id, List<Edge> &edges) const;
+
+  /// The segments of the graph.
+  List<Segment> _segments { };
+
+  /// The first edge of every segment, with one more entry at the end.
+  List<uint32_t> _offsets { 0 };
+
+  /// The edges of every segment.
+  List<Edge> _edges { };
+
+  /// The unused segments that may be reused.
+  List<uint32_t> _free { };
+
+  /// The segments freed since the last update, which edges may still lead
+  /// onto.
+  List<uint32_t> _released { };
+
+  /// The roads to compile again on the next update.
+  List<Road *> _queued { };
+
+  /// The number of updates that changed the graph so far.
+  uint64_t _version = 0;
+
+  /// The cost of the updates since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
@@ -61,6 +61,8 @@ struct Road {
 private:
   friend struct RoadNetwork;
   friend struct Intersection;
+  friend struct LaneGraph;
+  friend struct Parcels;
   
   /// Whether or not the road needs to be redrawn.
   bool _dirty = true;
@@ -68,6 +70,8 @@ private:
   struct _mesh {
     Texture *texture;
     Resource<Mesh> mesh;
+    Real2 textureTiling;
+    int level;
   };
   
   /// The road's meshes.
@@ -81,6 +85,41 @@ private:
   
   /// The road's zone mesh.
   Resource<ColorMesh> _zoneMesh = nullptr;
+  
+  /// The road's congestion mesh.
+  Resource<ColorMesh> _congestionMesh = nullptr;
+  
+  /// The congestion levels that the congestion mesh shows, forwards and
+  /// backwards.
+  int _congestion[2] = { -1, -1 };
+  
+  /// The road's segments in the lane graph.
+  List<uint32_t> _laneSegments { };
+  
+  /// Whether or not the road is queued to be compiled into the lane graph.
+  bool _laneQueued = false;
+  
+  /// The road's building lots.
+  List<uint32_t> _lots { };
+  
+  /// Whether or not the road is queued to be subdivided into lots.
+  bool _lotsQueued = false;
+  
+  /// Whether or not the road is in the grid of roads of the lots.
+  bool _lotsPlaced = false;
+  
+  /// The bounds of the road in the grid of roads of the lots.
+  Bounds2 _lotBounds { };
+  
+  /// The start of the road when it was last subdivided into lots.
+  Real2 _lotStart { };
+  
+  /// The end of the road when it was last subdivided into lots.
+  Real2 _lotEnd { };
+  
+  /// The length of the road when it was last subdivided into lots, or 0 if
+  /// it never has been.
+  float _lotLength = 0;
 };
 
 NS_CITY_BUILDER_END
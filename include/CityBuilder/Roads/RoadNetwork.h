@@ -7,18 +7,29 @@
 
 #pragma once
 #include <CityBuilder/Common.h>
+#include <CityBuilder/Jobs.h>
 #include <CityBuilder/Rendering/Mesh.h>
+#include <CityBuilder/Rendering/StaticBatch.h>
+#include <CityBuilder/Rendering/InstanceBatch.h>
 #include <CityBuilder/Storage/BSTree.h>
+#include <CityBuilder/Zones/Parcels.h>
+#include <atomic>
 #include "Road.h"
 #include "Intersection.h"
+#include "LaneGraph.h"
+#include "Router.h"
 
 NS_CITY_BUILDER_BEGIN
 
+struct TrafficAssignment;
+
 /// Manages the road network.
 struct RoadNetwork {
   
   RoadNetwork();
   
+  ~RoadNetwork();
+  
   /// Add a road to the network.
   /// \param[inout] road
   ///   The road to add.
@@ -135,27 +146,99 @@ struct RoadNetwork {
   
   
   
+  /// Color every road by how congested it is.
+  /// \param[in] assignment
+  ///   The traffic assignment to find the congestion of the roads from.
+  /// \remarks
+  ///   Each direction of a road is colored by its `TrafficAssignment::level`.
+  ///   Only the roads whose levels have changed are meshed again.
+  void setCongestion(const TrafficAssignment &assignment);
+  
+  /// Stop coloring the roads by how congested they are.
+  void clearCongestion();
+  
+  
+  
   /// Update any roads in the network.
+  /// \remarks
+  ///   Roads are extruded on the CPU or the GPU as chosen by
+  ///   `CurveExtrusion::enabled`, and every road is meshed again when that
+  ///   changes.
   void update();
   
   
   
-  /// Draw the roads.
-  void draw();
+  /// Draw the roads that are visible.
+  /// \param[in] frustum
+  ///   The frustum of the camera being drawn to.
+  /// \param[in] eye
+  ///   The position of the camera being drawn to, for choosing the level of
+  ///   detail of the roads.
+  /// \param[in,out] stats
+  ///   The culling statistics to add to.
+  /// \remarks
+  ///   The visible chunks are split into `CommandRecorder` tasks that record
+  ///   the draw calls in parallel.
+  void draw(const Frustum &frustum, Real3 eye, Frustum::Stats &stats);
+  
+  /// Draw the zones that are visible.
+  /// \param[in] frustum
+  ///   The frustum of the camera being drawn to.
+  /// \param[in,out] stats
+  ///   The culling statistics to add to.
+  /// \remarks
+  ///   The zones are recorded by a single `CommandRecorder` task.
+  void drawZones(const Frustum &frustum, Frustum::Stats &stats);
+  
+  /// Draw the congestion of the roads that are visible.
+  /// \param[in] frustum
+  ///   The frustum of the camera being drawn to.
+  /// \param[in,out] stats
+  ///   The culling statistics to add to.
+  /// \remarks
+  ///   The congestion is recorded by a single `CommandRecorder` task.
+  void drawCongestion(const Frustum &frustum, Frustum::Stats &stats);
+  
+  /// The number of draw calls submitted by the last `draw`.
+  int drawCalls() const {
+    return _drawCalls;
+  }
   
-  /// Draw the zones.
-  void drawZones();
+  /// The number of triangles submitted by the last `draw`.
+  size_t triangles() const {
+    return _triangles;
+  }
   
-private:
-  /// A mesh in the road network.
-  struct _mesh {
-    /// The mesh.
-    Resource<Mesh> mesh;
-    
-    /// The scale of the texture.
-    Real2 textureTiling;
-  };
+  /// The roads in the network.
+  const List<Road *> &roads() const {
+    return _roads;
+  }
+  
+  /// The lane-level routing graph of the network.
+  /// \remarks
+  ///   Compiled again for whatever changed on every `update` that the router
+  ///   is not still busy with the last change.
+  const LaneGraph &laneGraph() const {
+    return _laneGraph;
+  }
+  
+  /// The router for vehicles through the lane graph.
+  /// \remarks
+  ///   Brought up to date with the lane graph in the background after every
+  ///   `update` that changed it, which this waits for.
+  Router &router() {
+    Jobs::wait(_routing);
+    return _router;
+  }
+  
+  /// The building lots along the zoned sides of the roads.
+  /// \remarks
+  ///   Subdivided again for whatever changed on every `update`.
+  Parcels &parcels() {
+    return _parcels;
+  }
   
+private:
   /// Add a mesh to a road for a given lane.
   /// \param[in] road
   ///   The road to add the lane to.
@@ -163,9 +246,11 @@ private:
   ///   The lane to add a mesh for.
   /// \param[in] lanes
   ///   The lane mesh store for the road.
+  /// \param[in] level
+  ///   The level of detail of the mesh.
   /// \returns
   ///   The mesh that was added or loaded, as applicable.
-  Resource<Mesh> _addMesh(Road *road, LaneDef *lane, BSTree<LaneDef *, int> &lanes);
+  Resource<Mesh> _addMesh(Road *road, LaneDef *lane, BSTree<LaneDef *, int> &lanes, int level);
   
   /// Add a mesh to an intersection for a given lane.
   /// \param[in] intersection
@@ -178,11 +263,87 @@ private:
   ///   The mesh that was added or loaded, as applicable.
   Resource<Mesh> _addMesh(Intersection *intersection, LaneDef *lane, BSTree<LaneDef *, int> &lanes);
   
-  /// The road meshes in the network.
-  Map<Texture *, List<_mesh>> _meshes;
+  /// Extrude the meshes of every level of detail of a road.
+  /// \param[in] road
+  ///   The road to extrude, whose meshes have been removed.
+  /// \remarks
+  ///   Only touches the road and its own meshes, so may run on many roads at
+  ///   once.
+  void _extrude(Road *road);
+  
+  /// Remove all the meshes of a road or intersection from the network.
+  /// \param[in] owner
+  ///   The road or intersection to remove the meshes of.
+  void _removeMeshes(const void *owner);
+  
+  /// Remove the congestion mesh of a road, if it has one.
+  /// \param[inout] road
+  ///   The road to remove the congestion mesh of.
+  void _removeCongestion(Road *road);
+  
+  /// A mesh shared by every road of a definition, for a texture and level of
+  /// detail.
+  struct _sharedMesh {
+    /// The texture of the mesh, or `nullptr` for markings.
+    Texture *texture;
+    
+    /// The shared mesh.
+    Resource<Mesh> mesh;
+    
+    /// The level of detail of the mesh.
+    int level;
+  };
+  
+  /// Get the shared end cap meshes of a road, creating them as needed.
+  /// \param[in] road
+  ///   The road definition to get the end caps of.
+  /// \returns
+  ///   The end caps, revolved from the x-axis counter-clockwise around the
+  ///   origin.
+  const List<_sharedMesh> &_caps(RoadDef *road);
+  
+  /// Get the shared cross-section strips of a road, for extruding it on the
+  /// GPU, creating them as needed.
+  /// \param[in] road
+  ///   The road definition to get the strips of.
+  /// \returns
+  ///   The strips, as built by `CurveExtrusion::addStrip`.
+  const List<_sharedMesh> &_strips(RoadDef *road);
+  
+  /// The road surface meshes in the network, chunked by location and texture.
+  StaticBatch _surfaces;
+  
+  /// The road marking meshes in the network, chunked by location.
+  StaticBatch _markings;
+  
+  /// The end caps of the roads in the network, instanced by texture.
+  InstanceBatch _capSurfaces;
+  
+  /// The end cap markings of the roads in the network.
+  InstanceBatch _capMarkings;
+  
+  /// The shared end cap meshes of every road definition.
+  Map<RoadDef *, List<_sharedMesh>> _capMeshes;
+  
+  /// The roads extruded on the GPU, instanced by texture.
+  InstanceBatch _stripSurfaces;
   
-  /// The road marking meshes in the network.
-  List<_mesh> _markings;
+  /// The road markings extruded on the GPU.
+  InstanceBatch _stripMarkings;
+  
+  /// The shared cross-section strips of every road definition.
+  Map<RoadDef *, List<_sharedMesh>> _stripMeshes;
+  
+  /// Whether the roads were last meshed on the GPU, with `CurveExtrusion`.
+  bool _extruded = false;
+  
+  /// The number of draw calls submitted by the last `draw`.
+  /// \remarks
+  ///   Added to by every task recording the roads.
+  std::atomic<int> _drawCalls { 0 };
+  
+  /// The number of triangles submitted by the last `draw`.
+  size_t _triangles = 0;
   
   /// The roads in the network.
   List<Road *> _roads;
@@ -190,9 +351,37 @@ private:
   /// The intersections in the network.
   List<Intersection *> _intersections;
   
+  /// The lane-level routing graph of the network.
+  LaneGraph _laneGraph;
+  
+  /// The router for vehicles through the lane graph.
+  Router _router;
+  
+  /// The background update of the router, which reads the lane graph.
+  Jobs::Counter _routing;
+  
+  /// The building lots along the zoned sides of the roads.
+  Parcels _parcels;
+  
   /// The zone meshes
   List<Resource<ColorMesh>> _zoneMeshes;
   
+  /// The zone meshes found visible by the last `drawZones`.
+  List<const ColorMesh *> _visibleZones;
+  
+  /// The congestion meshes
+  List<Resource<ColorMesh>> _congestionMeshes;
+  
+  /// The congestion meshes found visible by the last `drawCongestion`.
+  List<const ColorMesh *> _visibleCongestion;
+  
+  /// The draw lists of each road surface and marking task, kept between
+  /// frames so that recording reuses their storage.
+  List<Resource<DrawList>> _surfaceLists, _markingLists;
+  
+  /// The draw lists of the zones and congestion.
+  DrawList _zoneList, _congestionList;
+  
   /// The texture for road markings
   Resource<Texture> _markingTexture;
   
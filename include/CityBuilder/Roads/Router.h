@@ -0,0 +1,392 @@
+/**
+ * @file Router.h
+ * @brief Shortest routes through the lane graph with contraction hierarchies.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include "LaneGraph.h"
+
+NS_CITY_BUILDER_BEGIN
+
+/// Shortest routes through the lane graph with contraction hierarchies.
+/// \remarks
+///   The router is a customizable contraction hierarchy over the segments of
+///   a `LaneGraph` used by one category of traffic, in three steps:
+///   - Ordering: the segments are ranked by nested dissection of their
+///     positions, so that the segments separating the network into halves
+///     are ranked above the halves themselves.
+///   - Contraction: each segment is removed in order of rank, joining every
+///     pair of its higher ranked neighbours with a shortcut. This depends
+///     only on which segments are connected, not on how long they take.
+///   - Customization: the travel time of every shortcut is found from the
+///     segments it passes over, lowest ranked first.
+///   A route only ever goes up the hierarchy from its origin and down to its
+///   destination. Since the higher neighbours of a segment are all among its
+///   ancestors in the elimination tree (each segment's lowest ranked higher
+///   neighbour), a query simply walks the ancestors of both ends instead of
+///   searching with a priority queue, skipping any ancestor above where they
+///   meet that is reached too slowly to improve on the route found so far.
+///   A single query therefore takes time in the depth of the tree times the
+///   arcs of the separators along it: about half a millisecond on a grid of
+///   100k segments. Commuter demand should be routed in batches with
+///   `costs`, which searches up from each destination once and takes a few
+///   microseconds per pair.
+///   When the lane graph changes, the existing order is kept: new segments
+///   are ranked below the rest, new connections are contracted into the
+///   existing shortcuts, and only the arcs up from the changed segments and
+///   their ancestors are customized again, since no other arc passes over
+///   them. The order is only found again once the hierarchy has grown too
+///   much from it, or a change would add more shortcuts than finding it
+///   again costs.
+struct Router {
+  /// A search through the hierarchy, holding its own scratch space so that
+  /// searches may run on many threads at once.
+  struct Query {
+    /// Create a search through a router.
+    /// \param[in] router
+    ///   The router to search, which must outlive the search and not be
+    ///   updated while it is in use.
+    Query(const Router &router) : _router(router) { }
+
+    /// Find the time taken to travel from one segment to another.
+    /// \param[in] from
+    ///   The segment to start at.
+    /// \param[in] to
+    ///   The segment to end at.
+    /// \returns
+    ///   The time taken to travel from the start of the first segment to the
+    ///   end of the last, in seconds, or infinity if there is no route.
+    float cost(uint32_t from, uint32_t to);
+
+    /// Find the fastest route from one segment to another.
+    /// \param[in] from
+    ///   The segment to start at.
+    /// \param[in] to
+    ///   The segment to end at.
+    /// \param[out] path
+    ///   The segments of the route, from the first to the last.
+    /// \returns
+    ///   The time taken to travel the route, in seconds, or infinity if
+    ///   there is no route.
+    float route(uint32_t from, uint32_t to, List<uint32_t> &path);
+
+  private:
+    friend struct Router;
+
+    /// Search up the hierarchy from a segment.
+    /// \param[in] rank
+    ///   The rank of the segment to search from.
+    /// \param[in] forward
+    ///   Whether to search the way traffic travels, or against it.
+    void _search(uint32_t rank, bool forward);
+
+    /// Search up the hierarchy from both ends of a route until the searches
+    /// meet.
+    /// \param[in] source
+    ///   The rank to search forward from.
+    /// \param[in] target
+    ///   The rank to search backward from.
+    /// \param[out] meeting
+    ///   The rank at which the fastest route turns down the hierarchy.
+    /// \returns
+    ///   The time taken by the fastest route, not counting the segment
+    ///   started at.
+    float _join(uint32_t source, uint32_t target, uint32_t &meeting);
+
+    /// Relax the arcs up from a rank.
+    /// \param[in] rank
+    ///   The rank to relax the arcs of.
+    /// \param[in] forward
+    ///   Whether to relax the arcs the way traffic travels, or against it.
+    void _relax(uint32_t rank, bool forward);
+
+    /// Forget the last forward and backward searches.
+    void _reset();
+
+    /// Make sure the scratch space fits the router.
+    void _prepare();
+
+    /// The router searched.
+    const Router &_router;
+
+    /// The time taken to reach each rank from the origin.
+    List<float> _forward { };
+
+    /// The time taken to reach the destination from each rank.
+    List<float> _backward { };
+
+    /// The rank that each rank was reached from, by the forward search.
+    List<uint32_t> _forwardFrom { };
+
+    /// The rank that each rank was reached from, by the backward search.
+    List<uint32_t> _backwardFrom { };
+
+    /// The rank that the forward search started from, or `none`.
+    uint32_t _forwardStart = none;
+
+    /// The rank that the backward search started from, or `none`.
+    uint32_t _backwardStart = none;
+  };
+
+  /// The cost of the hierarchy since the last `resetStats`.
+  struct Stats {
+    /// The number of times the order was found.
+    size_t orders = 0;
+
+    /// The number of times the hierarchy was updated without finding the
+    /// order again.
+    size_t increments = 0;
+
+    /// The time spent finding the order and contracting, in microseconds.
+    double orderTime = 0;
+
+    /// The time spent contracting new connections into the hierarchy, in
+    /// microseconds.
+    double incrementTime = 0;
+
+    /// The time spent customizing the hierarchy, in microseconds.
+    double customizeTime = 0;
+
+    /// The number of ranks customized, by orders and increments.
+    size_t customized = 0;
+  };
+
+  /// An unreachable rank or segment.
+  static constexpr uint32_t none = UINT32_MAX;
+
+
+
+  /// Create a new router.
+  /// \param[in] category
+  ///   The category of traffic to route.
+  Router(LaneDef::Traffic::Category category = LaneDef::Traffic::Category::all_vehicles)
+    : _category(category), _query(*this) { }
+
+  // Prevent router transfer.
+  Router(const Router &other) = delete;
+
+
+
+  /// Bring the hierarchy up to date with a lane graph.
+  /// \param[in] graph
+  ///   The graph to route through.
+  /// \returns
+  ///   Whether the graph had changed since the last update.
+  bool update(const LaneGraph &graph);
+
+  /// Find the order and contract the hierarchy from scratch.
+  /// \param[in] graph
+  ///   The graph to route through.
+  void rebuild(const LaneGraph &graph);
+
+  /// The number of segments in the hierarchy.
+  size_t count() const {
+    return _order.count();
+  }
+
+  /// The number of arcs in the hierarchy, including shortcuts.
+  size_t arcs() const {
+    return _arcs.count();
+  }
+
+  /// The memory taken by the arcs of the hierarchy, in bytes.
+  size_t bytes() const {
+    return _arcs.count() * sizeof(_arc) + _first.count() * sizeof(uint32_t);
+  }
+
+  /// The category of traffic routed.
+  LaneDef::Traffic::Category category() const {
+    return _category;
+  }
+
+
+
+  /// Find the time taken to travel from one segment to another.
+  /// \remarks
+  ///   Uses the router's own search, so may only be called from one thread.
+  ///   See `Query::cost`.
+  float cost(uint32_t from, uint32_t to) {
+    return _query.cost(from, to);
+  }
+
+  /// Find the fastest route from one segment to another.
+  /// \remarks
+  ///   Uses the router's own search, so may only be called from one thread.
+  ///   See `Query::route`.
+  float route(uint32_t from, uint32_t to, List<uint32_t> &path) {
+    return _query.route(from, to, path);
+  }
+
+  /// Find the time taken to travel between every pair of segments of two
+  /// sets, in parallel.
+  /// \param[in] from
+  ///   The segments to start at.
+  /// \param[in] to
+  ///   The segments to end at.
+  /// \param[in] threads
+  ///   The number of threads to search on, the calling thread included, or -1
+  ///   for it and every worker thread of `Jobs`.
+  /// \returns
+  ///   The time taken from each segment of `from` to each of `to`, in
+  ///   seconds, in rows of `to.count()`. Unreachable pairs are infinite.
+  /// \remarks
+  ///   The searches up from every destination are done once and left in
+  ///   buckets at the ranks they reach, which the search up from each origin
+  ///   then scans.
+  List<float> costs(const List<uint32_t> &from, const List<uint32_t> &to, int threads = -1) const;
+
+
+
+  /// The cost of the hierarchy since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the cost of the hierarchy so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+private:
+  /// An arc up the hierarchy, from a lower ranked segment to a higher one.
+  struct _arc {
+    /// The rank of the higher segment.
+    uint32_t head;
+
+    /// The time taken to travel up the arc.
+    float up;
+
+    /// The time taken to travel down the arc.
+    float down;
+
+    /// The rank that the fastest route up the arc passes through, or `none`
+    /// if it is a connection of the lane graph.
+    uint32_t upVia;
+
+    /// The rank that the fastest route down the arc passes through, or
+    /// `none` if it is a connection of the lane graph.
+    uint32_t downVia;
+  };
+
+  /// Find the arc between two ranks.
+  /// \param[in] low
+  ///   The lower rank.
+  /// \param[in] high
+  ///   The higher rank.
+  /// \returns
+  ///   The index of the arc, or `none` if there is none.
+  uint32_t _find(uint32_t low, uint32_t high) const;
+
+  /// An arc into a rank from a lower one.
+  struct _lowerArc {
+    /// The rank of the lower segment.
+    uint32_t tail;
+
+    /// The index of the arc.
+    uint32_t arc;
+  };
+
+  /// Set the arcs of the hierarchy from the higher neighbours of every rank.
+  /// \param[in] first
+  ///   The first higher neighbour of every rank, with one more entry at the
+  ///   end.
+  /// \param[in] heads
+  ///   The higher neighbours of every rank, each sorted.
+  void _setArcs(const List<uint32_t> &first, const List<uint32_t> &heads);
+
+  /// Find the travel time of every segment and note which have changed
+  /// since the last update.
+  /// \param[in] graph
+  ///   The graph to route through.
+  /// \param[out] changed
+  ///   The list to append the ranks of the changed segments to.
+  void _weigh(const LaneGraph &graph, List<uint32_t> &changed);
+
+  /// Find the travel time of every arc.
+  /// \param[in] graph
+  ///   The graph to route through.
+  void _customize(const LaneGraph &graph);
+
+  /// Find the travel time of the arcs that pass over some ranks again.
+  /// \param[in] graph
+  ///   The graph to route through.
+  /// \param[in] changed
+  ///   The ranks whose segments or arcs have changed.
+  /// \remarks
+  ///   An arc is only shortened through the ranks below both of its ends,
+  ///   so those that can change are the arcs up from the changed ranks, from
+  ///   their lower neighbours, and from every ancestor of them.
+  void _customize(const LaneGraph &graph, const List<uint32_t> &changed);
+
+  /// Find the travel time of the arcs up from a rank, once every arc up from
+  /// the ranks below it is final.
+  /// \param[in] graph
+  ///   The graph to route through.
+  /// \param[in] rank
+  ///   The rank to customize the arcs of.
+  /// \param[in,out] slot
+  ///   The arc from the rank to every head, or `none`, for every rank.
+  void _customize(const LaneGraph &graph, uint32_t rank, uint32_t *slot);
+
+  /// Append the segments that an arc passes over, not counting the first.
+  /// \param[in] from
+  ///   The rank to travel from.
+  /// \param[in] to
+  ///   The rank to travel to.
+  /// \param[out] path
+  ///   The list to append the segments to.
+  void _unpack(uint32_t from, uint32_t to, List<uint32_t> &path) const;
+
+  /// The category of traffic routed.
+  LaneDef::Traffic::Category _category;
+
+  /// The version of the lane graph that the hierarchy was last updated to.
+  uint64_t _version = 0;
+
+  /// The rank of every segment.
+  List<uint32_t> _rank { };
+
+  /// The segment of every rank.
+  List<uint32_t> _order { };
+
+  /// The parent of every rank in the elimination tree.
+  List<uint32_t> _parent { };
+
+  /// The first arc of every rank, with one more entry at the end.
+  List<uint32_t> _first { 0 };
+
+  /// The arcs up from every rank, ordered by rank and then head.
+  List<_arc> _arcs { };
+
+  /// The first arc into every rank from below, with one more entry at the
+  /// end.
+  List<uint32_t> _lowerFirst { 0 };
+
+  /// The arcs into every rank from below, ordered by rank and then tail.
+  List<_lowerArc> _lower { };
+
+  /// A digest of the travel time and connections of every segment, as of
+  /// the last update.
+  List<uint64_t> _digests { };
+
+  /// The time taken to travel along the segment of every rank.
+  List<float> _costs { };
+
+  /// The number of arcs when the order was last found.
+  size_t _orderedArcs = 0;
+
+  /// The number of segments when the order was last found.
+  size_t _orderedCount = 0;
+
+  /// The router's own search.
+  Query _query;
+
+  /// The cost of the hierarchy since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
@@ -0,0 +1,203 @@
+/**
+ * @file Economy.h
+ * @brief The residents and jobs of the city and the demand for zones.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Zones/Buildings.h>
+#include <CityBuilder/Zones/Parcels.h>
+#include <CityBuilder/Zones/ZoneDef.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// The residents and jobs of the city and the demand for zones.
+/// \remarks
+///   Every tick, residents move into the homes built and out of those
+///   demolished over `moveInTime`, and a `workforce` share of them work.
+///   Each zone wants the capacity summed by its `ZoneDef::demand` rules, from
+///   the residents living in the city, the jobs its buildings offer and the
+///   frontage zoned for it, so residential zones grow to house workers for
+///   the jobs and job zones grow to serve and employ the residents.
+///   The demand of a zone is the capacity it wants but does not have, as a
+///   share of what it wants; commercial and industrial zones also lose
+///   demand while there are jobs without workers to fill them, so jobs do not
+///   run ahead of the residents.
+///   The demand follows these targets over `responseTime` rather than
+///   jumping, so it does not swing with every building.
+///   The frontage zoned for each zone is kept up to date with the lots of
+///   `Parcels`, only counting the lots that changed.
+struct Economy {
+  /// The balance of a zone.
+  struct Zone {
+    /// The zone.
+    ZoneDef *zone;
+
+    /// The frontage of the zone's buildable lots, in meters.
+    float frontage = 0;
+
+    /// The residents or jobs of the zone's buildings.
+    float capacity = 0;
+
+    /// The residents or jobs that the zone wants, following its rules.
+    float wanted = 0;
+
+    /// How much more capacity the zone wants than it has, from -1 to 1.
+    float demand = 0;
+  };
+
+  /// The cost of simulating the economy since the last `resetStats`.
+  struct Stats {
+    /// The number of ticks simulated.
+    size_t steps = 0;
+
+    /// The number of lots counted after changing.
+    size_t counted = 0;
+
+    /// The time spent, in microseconds.
+    double time = 0;
+  };
+
+  /// The share of residents who work.
+  static constexpr float workforce = 0.5f;
+
+  /// The time over which residents move into new homes, in seconds.
+  static constexpr float moveInTime = 30;
+
+  /// The time over which demand follows the balance of the city, in
+  /// seconds.
+  static constexpr float responseTime = 10;
+
+  /// The demand that commercial and industrial zones lose for every share of
+  /// the city's jobs without workers.
+  static constexpr float laborWeight = 2;
+
+
+
+  Economy() { }
+
+  // Prevent economy transfer.
+  Economy(const Economy &other) = delete;
+
+
+
+  /// Catch up with the frontage zoned on the lots.
+  /// \param[in] parcels
+  ///   The lots of the city.
+  /// \remarks
+  ///   Only the lots that changed are counted again, unless the parcels were
+  ///   updated more than once since the last call.
+  void update(const Parcels &parcels);
+
+  /// Simulate a tick: move residents in or out and update the demand of
+  /// every zone.
+  /// \param[in] buildings
+  ///   The buildings of the city.
+  /// \param[in] dt
+  ///   The time simulated, in seconds.
+  void step(const Buildings &buildings, Real dt);
+
+
+
+  /// How much more capacity a zone wants than it has.
+  /// \param[in] zone
+  ///   The zone to find the demand of.
+  /// \returns
+  ///   The demand from -1 to 1; zones without any demand rules always want
+  ///   more.
+  float demand(const ZoneDef *zone) const;
+
+  /// The demand of every zone with a use, weighed by their frontage.
+  /// \param[in] use
+  ///   The use of the zones.
+  float demand(ZoneDef::Use use) const;
+
+  /// The capacity that a zone wants.
+  /// \param[in] zone
+  ///   The zone to find the capacity wanted by.
+  /// \returns
+  ///   The residents or jobs wanted, or `INFINITY` for zones without any
+  ///   demand rules.
+  float wanted(const ZoneDef *zone) const;
+
+  /// The balance of every zone seen.
+  const List<Zone> &zones() const {
+    return _zones;
+  }
+
+  /// The residents living in the city.
+  float residents() const {
+    return _residents;
+  }
+
+  /// The residents who work.
+  float workers() const {
+    return _residents * workforce;
+  }
+
+  /// The jobs of every commercial and industrial building.
+  float jobs() const {
+    return _jobs;
+  }
+
+  /// The share of workers without a job, from 0 to 1.
+  float unemployment() const;
+
+  /// The share of jobs without a worker, from 0 to 1.
+  float vacancy() const;
+
+
+
+  /// The cost of simulating the economy since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the cost of simulating the economy so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+private:
+  /// The frontage that a lot counts for.
+  struct _lot {
+    /// The zone the lot was counted for, or `nullptr`.
+    ZoneDef *zone;
+
+    /// The frontage counted, in meters.
+    float frontage;
+  };
+
+  /// Count a lot that changed for its zone again.
+  /// \param[in] parcels
+  ///   The lots of the city.
+  /// \param[in] lot
+  ///   The lot that changed.
+  void _count(const Parcels &parcels, uint32_t lot);
+
+  /// The balance of a zone, added if it has none yet.
+  Zone &_zoneOf(ZoneDef *zone);
+
+  /// The balance of every zone seen.
+  List<Zone> _zones { };
+
+  /// The frontage that every lot slot counts for.
+  List<_lot> _lots { };
+
+  /// The version of the lots last caught up with.
+  uint64_t _parcelsVersion = 0;
+
+  /// The residents living in the city.
+  float _residents = 0;
+
+  /// The jobs of every commercial and industrial building.
+  float _jobs = 0;
+
+  /// The cost of simulating the economy since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
@@ -0,0 +1,436 @@
+/**
+ * @file PedestrianSimulation.h
+ * @brief A continuum simulation of the pedestrians on the sidewalks.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Roads/LaneGraph.h>
+#include <CityBuilder/Simulation/TrafficSimulation.h>
+#include <CityBuilder/Zones/Parcels.h>
+#include <random>
+
+NS_CITY_BUILDER_BEGIN
+
+/// A continuum simulation of the pedestrians on the sidewalks, for crowds far
+/// too large to simulate person by person.
+/// \remarks
+///   Every pedestrian segment of the `LaneGraph` is a cell of the simulation,
+///   joined to the others by the edges of the graph: along the sidewalk,
+///   across joints between roads and across the roads at intersections.
+///   Rather than individual pedestrians, each cell only holds how many are
+///   walking along it, apart for those walking to the shops and those
+///   walking home.
+///   Pedestrians leave the homes of the residential lots along a sidewalk
+///   (`Parcels`) at `tripsPerMeter` for every meter of frontage, and walk to
+///   the nearest commercial frontage, where they shop for `dwellTime` on
+///   average before walking to the nearest residential frontage. Fewer set
+///   out the further the shops are, and none where they are further than
+///   `maxWalk`. The nearest frontage of each kind is found for every cell at
+///   once by a search from every cell of that kind over the reversed
+///   sidewalks, which leaves every cell with the next cell on its shortest
+///   route; it is only run again when the lanes or the lots change.
+///   Each fixed step moves pedestrians between the cells as a cell
+///   transmission model: a cell sends as many pedestrians on as walk off its
+///   end at the free speed, up to the capacity of the sidewalk, and a cell
+///   receives as many as fit before it jams, shared between the cells
+///   sending onto it in proportion to what they send. Pedestrians slow down
+///   as the sidewalk fills up (Greenshields), from `LaneGraph::walkingSpeed`
+///   when empty to a standstill at `jamDensity`, and crossing a road only
+///   takes `crossingShare` of the capacity of the sidewalk, as pedestrians
+///   wait for gaps in the traffic.
+///   Every pass only writes to its own cells, so the passes are spread across
+///   the worker threads of `Jobs` in blocks of cells, and the totals are
+///   summed block by block, so every step is deterministic whatever the
+///   number of threads.
+///   Only near the camera are pedestrians drawn one by one: `sample` keeps a
+///   set of agents on every cell in view that walk along it at the speed of
+///   the cell and move on along its route, spawning and removing agents so
+///   that their number follows how many pedestrians the cell holds.
+struct PedestrianSimulation {
+  /// The cost of the simulation since the last `resetStats`.
+  struct Stats {
+    /// The number of steps simulated.
+    size_t steps = 0;
+
+    /// The number of times the routes were searched.
+    size_t routes = 0;
+
+    /// The number of times agents were sampled.
+    size_t samples = 0;
+
+    /// The pedestrians that set out from home.
+    double departures = 0;
+
+    /// The pedestrians that got back home.
+    double arrivals = 0;
+
+    /// The pedestrians that crossed a road.
+    double crossings = 0;
+
+    /// The time spent moving pedestrians between cells, in microseconds.
+    double stepTime = 0;
+
+    /// The time spent searching for routes, in microseconds.
+    double routeTime = 0;
+
+    /// The time spent sampling agents, in microseconds.
+    double sampleTime = 0;
+  };
+
+  /// Why a pedestrian is walking.
+  enum class Purpose {
+    /// Walking from home to the shops.
+    shopping,
+
+    /// Walking from the shops back home.
+    home,
+  };
+
+  /// The number of purposes.
+  static constexpr int purposes = 2;
+
+  /// The time simulated by each step, in seconds.
+  /// \remarks
+  ///   Far longer than a tick of the simulation clock, as crowds change
+  ///   slowly; the agents still walk on every tick.
+  static constexpr float timestep = 0.5f;
+
+  /// A cell that does not exist, or a route that ends.
+  static constexpr uint32_t none = UINT32_MAX;
+
+  /// The density at which pedestrians come to a standstill, per square
+  /// meter.
+  static constexpr float jamDensity = 5.4f;
+
+  /// The narrowest that a sidewalk is taken to be, in meters.
+  static constexpr float minimumWidth = 1.0f;
+
+  /// The share of a sidewalk's capacity that crosses a road at an
+  /// intersection.
+  static constexpr float crossingShare = 0.5f;
+
+  /// The distance that waiting to cross a road is worth to a pedestrian, in
+  /// meters.
+  static constexpr float crossingPenalty = 15.0f;
+
+  /// The pedestrians setting out in an hour for every meter of residential
+  /// frontage, when the shops are next door.
+  static constexpr float tripsPerMeter = 0.5f;
+
+  /// How quickly pedestrians are put off by the distance to the shops, per
+  /// meter.
+  static constexpr float impedance = 1.0f / 400;
+
+  /// The furthest that pedestrians walk to the shops, in meters.
+  static constexpr float maxWalk = 1500;
+
+  /// The time that pedestrians spend at the shops, on average, in seconds.
+  static constexpr float dwellTime = 900;
+
+  /// The most agents sampled at once.
+  static constexpr size_t maxAgents = 20000;
+
+
+
+  PedestrianSimulation() { }
+
+  // Prevent simulation transfer.
+  PedestrianSimulation(const PedestrianSimulation &other) = delete;
+
+
+
+  /// Set whether to simulate on the worker threads of `Jobs`.
+  /// \param[in] threads
+  ///   0 to simulate on the calling thread alone, or -1 to spread the passes
+  ///   across the worker threads of `Jobs`.
+  void setThreads(int threads);
+
+  /// The number of worker threads simulated on alongside the calling thread.
+  int threads() const;
+
+  /// Bring the cells up to date with a lane graph and the lots along it.
+  /// \param[in] graph
+  ///   The graph to simulate on, which must outlive the simulation or the
+  ///   next `sync`.
+  /// \param[in] parcels
+  ///   The lots that pedestrians walk between.
+  /// \remarks
+  ///   The routes are only searched again when either has changed.
+  ///   Pedestrians keep walking on the cells whose segment is unchanged, and
+  ///   those on removed cells are removed, as are every agent.
+  void sync(const LaneGraph &graph, const Parcels &parcels);
+
+  /// Spread pedestrians evenly over every cell with somewhere to go.
+  /// \param[in] pedestrians
+  ///   The number of pedestrians to add, split evenly between the purposes.
+  /// \remarks
+  ///   The cells must already be synced to a graph.
+  void populate(double pedestrians);
+
+  /// Simulate a single step of `timestep` seconds.
+  void step();
+
+  /// Simulate as many steps as fit into the time elapsed, carrying the rest
+  /// over to the next call.
+  /// \param[in] elapsed
+  ///   The time elapsed since the last call, in seconds.
+  /// \returns
+  ///   The number of steps simulated.
+  int advance(Real elapsed);
+
+  /// Sample agents on the cells near a point, moving those already sampled
+  /// on for the time advanced since the last call.
+  /// \param[in] center
+  ///   The point to sample around, such as where the camera looks.
+  /// \param[in] radius
+  ///   How far from the point to sample, in meters, or 0 for no agents.
+  void sample(Real2 center, Real radius);
+
+
+
+  /// The number of pedestrians walking.
+  double count() const {
+    return _walking;
+  }
+
+  /// The number of pedestrians at the shops.
+  double shopping() const {
+    return _shopping;
+  }
+
+  /// The number of cells simulated.
+  size_t cells() const {
+    return _cells.count();
+  }
+
+  /// The number of pedestrians on the segment of a lane graph.
+  /// \param[in] segment
+  ///   The segment of the lane graph that the simulation was last synced to.
+  /// \returns
+  ///   The pedestrians walking along the segment, or 0 if it is not a
+  ///   sidewalk.
+  float pedestrians(uint32_t segment) const;
+
+  /// The state of every agent as of the last `sample`, for drawing with a
+  /// `VehicleBatch`.
+  const List<TrafficSimulation::Snapshot> &agents() const {
+    return _snapshots;
+  }
+
+
+
+  /// The cost of the simulation since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the cost of the simulation so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+private:
+  /// A sidewalk segment of the lane graph.
+  struct _cell {
+    /// The segment of the cell.
+    uint32_t segment;
+
+    /// The road of the segment when the cell was last synced.
+    Road *road;
+
+    /// The index of the lane in the road definition.
+    uint16_t lane;
+
+    /// Whether pedestrians walk from the start of the road to its end.
+    bool forward;
+
+    /// Whether the cell is on the right side of its road.
+    bool right;
+
+    /// The length of the cell, in meters.
+    float length;
+
+    /// The width of the sidewalk, in meters.
+    float width;
+
+    /// The point halfway along the cell.
+    Real2 middle;
+  };
+
+  /// The route of every cell for one purpose.
+  struct _routes {
+    /// The cell that every cell continues onto, or `none` if the route ends
+    /// there.
+    List<uint32_t> next { };
+
+    /// Whether the move onto the next cell crosses a road.
+    List<uint8_t> crossing { };
+
+    /// Whether every cell is where the route ends, rather than a cell
+    /// without any route.
+    List<uint8_t> end { };
+
+    /// The walk from the start of every cell to the end of its route, in
+    /// meters.
+    List<float> distance { };
+
+    /// The cells that continue onto every cell, ordered by cell.
+    List<uint32_t> from { };
+
+    /// The first cell of every cell in `from`, with one more entry at the
+    /// end.
+    List<uint32_t> first { };
+  };
+
+  /// The totals of a block of cells after a step.
+  struct _sums {
+    /// The pedestrians walking.
+    double walking;
+
+    /// The pedestrians at the shops.
+    double shopping;
+
+    /// The pedestrians that set out from home.
+    double departures;
+
+    /// The pedestrians that got back home.
+    double arrivals;
+
+    /// The pedestrians that crossed a road.
+    double crossings;
+  };
+
+  /// A pedestrian drawn near the camera.
+  struct _agent {
+    /// The cell that the agent is walking along.
+    uint32_t cell;
+
+    /// The distance along the cell.
+    float position;
+
+    /// Why the agent is walking.
+    uint8_t purpose;
+  };
+
+  /// Run a function over ranges of cells across the threads.
+  /// \param[in] body
+  ///   The function to run with the first and one past the last cell of each
+  ///   range.
+  void _parallel(void (*body)(PedestrianSimulation &, size_t, size_t));
+
+  /// Search for the routes of a purpose from every cell where they end.
+  /// \param[in] purpose
+  ///   The purpose to route.
+  void _route(int purpose);
+
+  /// Find how much every cell sends on and can receive.
+  static void _send(PedestrianSimulation &self, size_t begin, size_t end);
+
+  /// Share what every cell can receive between the cells sending onto it.
+  static void _share(PedestrianSimulation &self, size_t begin, size_t end);
+
+  /// Move the pedestrians sent between the cells, and sum the totals of
+  /// every block of cells.
+  static void _move(PedestrianSimulation &self, size_t begin, size_t end);
+
+  /// The lane graph simulated on.
+  const LaneGraph *_graph = nullptr;
+
+  /// The version of the lane graph that the cells were last synced to.
+  uint64_t _version = 0;
+
+  /// The version of the lots that the routes were last searched for.
+  uint64_t _parcelsVersion = 0;
+
+  /// Whether the simulation has been synced at all.
+  bool _synced = false;
+
+  /// The cells.
+  List<_cell> _cells { };
+
+  /// The cell of every segment of the lane graph, or `none`.
+  List<uint32_t> _cellOf { };
+
+  /// The cells that every cell leads onto, ordered by cell, with whether the
+  /// move crosses a road in the top bit.
+  List<uint32_t> _edges { };
+
+  /// The length of the move along every edge, in meters.
+  List<float> _edgeLengths { };
+
+  /// The first edge of every cell, with one more entry at the end.
+  List<uint32_t> _firstEdge { };
+
+  /// The residential and commercial frontage of every cell, in meters.
+  List<float> _frontage[2] { };
+
+  /// The route of every cell, by purpose.
+  _routes _routesFor[purposes] { };
+
+  /// The pedestrians setting out from every cell, per second.
+  List<float> _departures { };
+
+  /// The pedestrians walking along every cell, by purpose.
+  List<float> _walkers[purposes] { };
+
+  /// The pedestrians at the shops of every cell.
+  List<float> _shoppers { };
+
+  /// The pedestrians that every cell sends on this step, by purpose.
+  List<float> _sent[purposes] { };
+
+  /// The pedestrians sent onto every cell this step, by purpose.
+  List<float> _incoming[purposes] { };
+
+  /// The pedestrians that every cell can receive this step.
+  List<float> _supply { };
+
+  /// The share of what every cell is sent that it receives this step.
+  List<float> _received { };
+
+  /// The totals of every block of cells after the last step.
+  List<_sums> _blockSums { };
+
+  /// The speed of the pedestrians of every cell, in meters per second.
+  List<float> _speed { };
+
+  /// The time elapsed but not yet simulated, in seconds.
+  float _carry = 0;
+
+  /// The number of pedestrians walking.
+  double _walking = 0;
+
+  /// The number of pedestrians at the shops.
+  double _shopping = 0;
+
+  /// The agents near the camera, ordered by cell.
+  List<_agent> _agents { };
+
+  /// The slot in `_agents` of the first agent of every cell in view, or
+  /// `none`.
+  List<uint32_t> _sampled { };
+
+  /// The cells in view at the last `sample`.
+  List<uint32_t> _inView { };
+
+  /// The state of every agent as of the last `sample`.
+  List<TrafficSimulation::Snapshot> _snapshots { };
+
+  /// The time advanced since the last `sample`, in seconds.
+  float _unsampled = 0;
+
+  /// The random choices of the agents.
+  std::mt19937 _random { 1 };
+
+  /// The number of threads requested by `setThreads`.
+  int _requestedThreads = -1;
+
+  /// The cost of the simulation since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
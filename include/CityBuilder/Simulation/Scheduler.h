@@ -0,0 +1,190 @@
+/**
+ * @file Scheduler.h
+ * @brief The clock of the simulation, ticking apart from drawing.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+NS_CITY_BUILDER_BEGIN
+
+/// The clock of the simulation, ticking apart from drawing.
+/// \remarks
+///   The simulation advances in fixed ticks of `tick` seconds, however long
+///   frames take: each frame, the time elapsed is scaled by the speed of the
+///   simulation and as many ticks are run as fit into it, carrying the rest
+///   over to the next frame.
+///   When the simulation falls behind, it catches up over the next frames a
+///   budget at a time rather than in one long frame, and when it is further
+///   behind than a whole `maxFrame` of real time, the rest is dropped so the
+///   simulation slows down rather than falling further behind.
+///   At the fastest speed, ticks are run for as long as the budget allows
+///   every frame.
+///   Exact scheduling skips both limits, running every tick owed however
+///   long it takes, for reproducible headless runs.
+struct Scheduler {
+  /// Simulate a single tick.
+  /// \param[in] dt
+  ///   The time simulated by the tick, in seconds.
+  typedef std::function<void(Real dt)> Tick;
+
+  /// The time simulated between frames since the last `resetStats`.
+  struct Stats {
+    /// The number of calls to `advance`.
+    size_t frames = 0;
+
+    /// The number of ticks run.
+    size_t ticks = 0;
+
+    /// The time simulated, in seconds.
+    double simulated = 0;
+
+    /// The time dropped by falling behind, in simulated seconds.
+    double dropped = 0;
+
+    /// The time spent running ticks, in microseconds.
+    double time = 0;
+
+    /// The longest time spent running ticks in one frame, in microseconds.
+    double longest = 0;
+
+    /// The real time from the start of the first frame to the end of the
+    /// last, in seconds.
+    double wall = 0;
+  };
+
+  /// The time simulated by each tick, in seconds.
+  /// \remarks
+  ///   The same as `TrafficSimulation::timestep`, so that vehicles step once
+  ///   a tick.
+  static constexpr float tick = 0.1f;
+
+  /// The preset speeds of the simulation, as multiples of real time, the
+  /// last running as fast as the budget allows.
+  static constexpr float speeds[] = { 1, 4, 16, INFINITY };
+
+  /// The number of preset speeds.
+  static constexpr int speedCount = 4;
+
+  /// The most real time that a frame catches up with, in seconds.
+  static constexpr float maxFrame = 0.25f;
+
+  /// The time that ticks may take each frame, in microseconds.
+  static constexpr double budget = 8000;
+
+
+
+  Scheduler() { }
+
+  // Prevent clock transfer.
+  Scheduler(const Scheduler &other) = delete;
+
+
+
+  /// Run the ticks owed for the time elapsed.
+  /// \param[in] elapsed
+  ///   The real time elapsed since the last call, in seconds.
+  /// \param[in] step
+  ///   The function to run every tick with.
+  /// \returns
+  ///   The number of ticks run.
+  int advance(Real elapsed, const Tick &step);
+
+
+
+  /// How many times faster than real time the simulation runs.
+  float multiplier() const {
+    return _multiplier;
+  }
+
+  /// Set how many times faster than real time the simulation runs.
+  /// \param[in] multiplier
+  ///   The multiple of real time, such as one of `speeds`, or `INFINITY` to
+  ///   run as fast as the budget allows.
+  void setMultiplier(float multiplier) {
+    _multiplier = multiplier;
+  }
+
+  /// Move on to the next preset speed, back to the first after the last.
+  void nextSpeed();
+
+  /// Whether the simulation is paused.
+  bool paused() const {
+    return _paused;
+  }
+
+  /// Pause or resume the simulation, keeping its speed.
+  void setPaused(bool paused) {
+    _paused = paused;
+  }
+
+  /// Whether every tick owed is run however long it takes.
+  bool exact() const {
+    return _exact;
+  }
+
+  /// Run every tick owed however long it takes, rather than catching up a
+  /// budget at a time and dropping what is too far behind.
+  /// \remarks
+  ///   The fastest speed still runs for a budget each frame.
+  void setExact(bool exact) {
+    _exact = exact;
+  }
+
+
+
+  /// The time simulated so far, in seconds.
+  double time() const {
+    return _time;
+  }
+
+  /// The time owed since the last tick, in simulated seconds, for drawing
+  /// things in between ticks.
+  /// \remarks
+  ///   At most a tick, even while catching up.
+  float lag() const {
+    return std::min(_carry, tick);
+  }
+
+
+
+  /// The time simulated between frames since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the time simulated so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+private:
+  /// How many times faster than real time the simulation runs.
+  float _multiplier = 1;
+
+  /// Whether the simulation is paused.
+  bool _paused = false;
+
+  /// Whether every tick owed is run however long it takes.
+  bool _exact = false;
+
+  /// The time simulated so far, in seconds.
+  double _time = 0;
+
+  /// The time owed and not yet run, in simulated seconds.
+  float _carry = 0;
+
+  /// When the first frame since the last `resetStats` started.
+  std::chrono::steady_clock::time_point _start { };
+
+  /// The time simulated between frames since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
@@ -0,0 +1,308 @@
+/**
+ * @file TrafficAssignment.h
+ * @brief Macroscopic traffic assignment over the road network.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Roads/Road.h>
+#include <CityBuilder/Roads/Intersection.h>
+#include <unordered_map>
+
+NS_CITY_BUILDER_BEGIN
+
+/// Macroscopic traffic assignment over the road network, for cities too
+/// large to simulate every vehicle.
+/// \remarks
+///   Rather than the lanes of the `LaneGraph`, the assignment works on the
+///   roads themselves:
+///   - Nodes: every intersection, and every end of a road that is not at
+///     one, with roads joined end to end sharing a node.
+///   - Links: each direction of a road that has vehicle lanes, taking as
+///     long as the road at its speed limit when empty, and carrying
+///     `laneCapacity` vehicles an hour for each of its lanes.
+///   The city is split into at most `maxDistricts` square districts. Each
+///   district produces trips in proportion to the residential frontage of
+///   its roads (`Road::leftZone`, `Road::rightZone`), which go to the other
+///   districts in proportion to their commercial and industrial frontage and
+///   fall off with the travel time to them (a gravity model).
+///   Trips are assigned to the links by the Frank-Wolfe algorithm, finding
+///   the user equilibrium where no trip can be made faster by changing its
+///   route. Each iteration assigns every trip to its fastest route given the
+///   current link costs (all-or-nothing), on many threads, one origin
+///   district at a time, and then moves the link flows part of the way
+///   towards a mix of that assignment and the last one moved towards
+///   (conjugate Frank-Wolfe), which takes far fewer iterations on congested
+///   networks. Link costs follow the Bureau of Public Roads
+///   function of the ratio of their flow to their capacity.
+///   The demand is found from the free-flow travel times during the first
+///   iteration.
+struct TrafficAssignment {
+  /// The cost of the assignment since the last `resetStats`.
+  struct Stats {
+    /// The number of times the network was built.
+    size_t builds = 0;
+
+    /// The number of iterations run.
+    size_t iterations = 0;
+
+    /// The time spent building the network, in microseconds.
+    double buildTime = 0;
+
+    /// The time spent on all-or-nothing assignments, in microseconds.
+    double searchTime = 0;
+
+    /// The time spent moving the flows towards the all-or-nothing
+    /// assignments, in microseconds.
+    double lineTime = 0;
+  };
+
+  /// The vehicles that a lane can carry in an hour.
+  static constexpr float laneCapacity = 1800;
+
+  /// How much slower a link at capacity is than an empty one, in the Bureau
+  /// of Public Roads cost function.
+  static constexpr float bprAlpha = 0.15f;
+
+  /// How sharply links slow down as they approach capacity, in the Bureau of
+  /// Public Roads cost function.
+  static constexpr int bprBeta = 4;
+
+  /// The trips produced in an hour by every meter of residential frontage.
+  static constexpr float tripsPerMeter = 0.1f;
+
+  /// How quickly trips fall off with travel time, per second.
+  static constexpr float impedance = 1.0f / 600;
+
+  /// The most districts that the city is split into.
+  static constexpr size_t maxDistricts = 128;
+
+  /// The smallest width of a district, in meters.
+  static constexpr float minimumDistrictSize = 250;
+
+  /// The relative gap below which the assignment has converged.
+  static constexpr float targetGap = 0.01f;
+
+  /// The number of congestion levels that `level` sorts links into.
+  static constexpr int congestionLevels = 5;
+
+  /// An unreachable node, or a missing link.
+  static constexpr uint32_t none = UINT32_MAX;
+
+
+
+  TrafficAssignment() { }
+
+  // Prevent assignment transfer.
+  TrafficAssignment(const TrafficAssignment &other) = delete;
+
+
+
+  /// Build the network and districts from scratch, forgetting any previous
+  /// assignment.
+  /// \param[in] roads
+  ///   The roads to assign traffic over, which must outlive the assignment
+  ///   or the next `build`.
+  void build(const List<Road *> &roads);
+
+  /// Run one iteration of the assignment, unless it has converged.
+  /// \param[in] threads
+  ///   The number of threads to search on, the calling thread included, or -1
+  ///   for it and every worker thread of `Jobs`.
+  /// \returns
+  ///   Whether the assignment has converged.
+  /// \remarks
+  ///   The flows are deterministic for a given number of threads.
+  bool iterate(int threads = -1);
+
+  /// Iterate until the assignment converges.
+  /// \param[in] iterations
+  ///   The most iterations to run.
+  /// \param[in] threads
+  ///   The number of threads to search on, the calling thread included, or -1
+  ///   for it and every worker thread of `Jobs`.
+  /// \returns
+  ///   The number of iterations run.
+  int solve(int iterations, int threads = -1);
+
+  /// Whether the relative gap has fallen below `targetGap`.
+  bool converged() const {
+    return _converged;
+  }
+
+  /// The relative gap of the last iteration: how much longer the trips take
+  /// than they would on their fastest routes, as a fraction.
+  float gap() const {
+    return _gap;
+  }
+
+  /// The number of iterations run since the last `build`.
+  size_t iterations() const {
+    return _iterations;
+  }
+
+
+
+  /// The number of nodes of the network.
+  size_t nodes() const {
+    return _first.count() - 1;
+  }
+
+  /// The number of links of the network.
+  size_t links() const {
+    return _links.count();
+  }
+
+  /// The number of districts that the city is split into.
+  size_t districts() const {
+    return _productions.count();
+  }
+
+  /// The number of trips assigned, in vehicles an hour.
+  float trips() const {
+    return _trips;
+  }
+
+  /// The ratio of flow to capacity of one direction of a road.
+  /// \param[in] road
+  ///   The road to find the congestion of.
+  /// \param[in] forward
+  ///   Whether to find the congestion of the direction from the start of the
+  ///   road to its end.
+  /// \returns
+  ///   The ratio of flow to capacity, or 0 if the road carries no vehicles
+  ///   that way or is not part of the network.
+  float congestion(const Road *road, bool forward) const;
+
+  /// Sort a ratio of flow to capacity into a congestion level.
+  /// \param[in] congestion
+  ///   The ratio of flow to capacity.
+  /// \returns
+  ///   The congestion level, from 0 for free-flowing to
+  ///   `congestionLevels - 1` for over capacity.
+  static int level(float congestion);
+
+
+
+  /// The cost of the assignment since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the cost of the assignment so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+private:
+  /// One direction of a road.
+  struct _link {
+    /// The node that the link leaves from.
+    uint32_t tail;
+
+    /// The node that the link arrives at.
+    uint32_t head;
+
+    /// The time taken to travel the link when it is empty, in seconds.
+    float time;
+
+    /// The vehicles that the link can carry in an hour.
+    float capacity;
+  };
+
+  /// A node that a district's trips end at.
+  struct _end {
+    /// The node.
+    uint32_t node;
+
+    /// The share of the district's trips that end at the node.
+    float weight;
+  };
+
+  /// The scratch space of one thread's all-or-nothing assignments.
+  struct _search;
+
+  /// Find the fastest routes from an origin district and load its trips onto
+  /// them.
+  /// \param[in] origin
+  ///   The district to assign the trips of.
+  /// \param[in,out] search
+  ///   The scratch space to search with.
+  /// \param[out] flows
+  ///   The flow of every link, to add the trips to.
+  void _assignOrigin(uint32_t origin, _search &search, float *flows);
+
+  /// The cost of every link for a set of flows.
+  /// \param[in] flows
+  ///   The flow of every link.
+  /// \param[out] costs
+  ///   The cost of every link.
+  void _costs(const List<float> &flows, List<float> &costs) const;
+
+  /// The roads of the network.
+  List<Road *> _roads { };
+
+  /// The index of every road of the network.
+  std::unordered_map<const Road *, uint32_t> _index { };
+
+  /// The forward and backward link of every road, or `none`.
+  List<uint32_t> _roadLinks { };
+
+  /// The links, ordered by their tail.
+  List<_link> _links { };
+
+  /// The first link leaving every node, with one more entry at the end.
+  List<uint32_t> _first { 0 };
+
+  /// The trips produced by every district, in vehicles an hour.
+  List<float> _productions { };
+
+  /// The attraction of every district.
+  List<float> _attractions { };
+
+  /// The nodes that every district's trips start from, by district.
+  List<uint32_t> _origins { };
+
+  /// The first origin of every district, with one more entry at the end.
+  List<uint32_t> _firstOrigin { };
+
+  /// The nodes that every district's trips end at, by district.
+  List<_end> _destinations { };
+
+  /// The first destination of every district, with one more entry at the
+  /// end.
+  List<uint32_t> _firstDestination { };
+
+  /// The trips between every pair of districts, in rows by origin, in
+  /// vehicles an hour.
+  List<float> _demand { };
+
+  /// The flow of every link, in vehicles an hour.
+  List<float> _flows { };
+
+  /// The flows that the last iteration moved towards.
+  List<float> _target { };
+
+  /// The cost of every link at the current flows, in seconds.
+  List<float> _linkCosts { };
+
+  /// The total trips assigned, in vehicles an hour.
+  float _trips = 0;
+
+  /// The relative gap of the last iteration.
+  float _gap = 1;
+
+  /// Whether the relative gap has fallen below `targetGap`.
+  bool _converged = false;
+
+  /// The number of iterations run since the last `build`.
+  size_t _iterations = 0;
+
+  /// The cost of the assignment since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
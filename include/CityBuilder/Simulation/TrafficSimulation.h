@@ -0,0 +1,418 @@
+/**
+ * @file TrafficSimulation.h
+ * @brief A microscopic simulation of the vehicles on the roads.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Roads/LaneGraph.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// A microscopic simulation of the vehicles on the roads.
+/// \remarks
+///   Every vehicle segment of the `LaneGraph` is a lane of the simulation.
+///   The vehicles of each lane are stored as structures of arrays, ordered
+///   from the back of the lane to the front, in slots sized for the most
+///   vehicles that fit on the lane. Each vehicle's position is its distance
+///   along the segment, which is negative while it is still crossing the
+///   intersection onto it.
+///   Each fixed step runs in four passes:
+///   - Every intersection with more than two arms gives way to one phase at
+///     a time, switching to the next phase with vehicles waiting once the
+///     current one is empty or has had its turn. Opposite arms of an
+///     intersection with an even number of arms share a phase, and otherwise
+///     every arm has its own.
+///   - Every vehicle accelerates by the intelligent driver model, following
+///     the vehicle ahead of it, or for the vehicle at the front of a lane,
+///     the back of the lane that it continues onto or the stop line.
+///   - Every vehicle moves at its new speed.
+///   - Vehicles that reached the end of their lane move onto their next one,
+///     or leave the simulation if their route ends there.
+///   The first three passes only write to their own lane or intersection, so
+///   they are spread across the worker threads of `Jobs`, which steal ranges
+///   of lanes from each other as they run out. The last pass is serial, which
+///   keeps every step deterministic whatever the number of threads.
+struct TrafficSimulation {
+  /// The cost of the simulation since the last `resetStats`.
+  struct Stats {
+    /// The number of steps simulated.
+    size_t steps = 0;
+
+    /// The number of vehicles that moved onto another lane.
+    size_t transfers = 0;
+
+    /// The number of vehicles that reached the end of their route.
+    size_t arrivals = 0;
+
+    /// The number of vehicle updates, one per vehicle per step.
+    size_t updates = 0;
+
+    /// The time spent accelerating and moving vehicles, in microseconds.
+    double laneTime = 0;
+
+    /// The time spent giving way at intersections, in microseconds.
+    double signalTime = 0;
+
+    /// The time spent moving vehicles between lanes, in microseconds.
+    double transferTime = 0;
+  };
+
+  /// The state of a vehicle as of the last step, for drawing.
+  struct Snapshot {
+    /// The segment that the vehicle is on.
+    float segment;
+
+    /// The distance along the segment of the front of the vehicle.
+    float position;
+
+    /// The speed of the vehicle, in meters per second.
+    float speed;
+
+    /// The acceleration of the vehicle, in meters per second squared.
+    float acceleration;
+  };
+
+  /// A vehicle or lane that does not exist.
+  static constexpr uint32_t none = UINT32_MAX;
+
+  /// The time simulated by each step, in seconds.
+  static constexpr float timestep = 0.1f;
+
+  /// The most steps simulated by one `advance` before falling behind.
+  static constexpr int maxSteps = 5;
+
+  /// The acceleration of a vehicle pulling away, in meters per second
+  /// squared.
+  static constexpr float acceleration = 1.5f;
+
+  /// The deceleration that a vehicle brakes at comfortably, in meters per
+  /// second squared.
+  static constexpr float deceleration = 2.0f;
+
+  /// The hardest that a vehicle may brake, in meters per second squared.
+  static constexpr float emergencyDeceleration = 9.0f;
+
+  /// The time that a vehicle keeps between itself and the one ahead, in
+  /// seconds.
+  static constexpr float headway = 1.5f;
+
+  /// The gap that a vehicle leaves behind a stopped vehicle, in meters.
+  static constexpr float minimumGap = 2.0f;
+
+  /// The length of a vehicle, in meters.
+  static constexpr float vehicleLength = 4.5f;
+
+  /// The shortest time that a phase keeps right of way while vehicles are
+  /// waiting on it, in seconds.
+  static constexpr float minimumGreen = 5.0f;
+
+  /// The longest time that a phase keeps right of way while vehicles are
+  /// waiting on another, in seconds.
+  static constexpr float maximumGreen = 30.0f;
+
+  /// The time between one phase losing right of way and the next gaining
+  /// it, in seconds.
+  static constexpr float clearance = 2.0f;
+
+  /// How close to the stop line a vehicle is waiting for right of way, in
+  /// meters.
+  static constexpr float waitingDistance = 40.0f;
+
+
+
+  TrafficSimulation() { }
+
+  // Prevent simulation transfer.
+  TrafficSimulation(const TrafficSimulation &other) = delete;
+
+
+
+  /// Set whether to simulate on the worker threads of `Jobs`.
+  /// \param[in] threads
+  ///   0 to simulate on the calling thread alone, or -1 to spread the passes
+  ///   across the worker threads of `Jobs`.
+  void setThreads(int threads);
+
+  /// The number of worker threads simulated on alongside the calling thread.
+  int threads() const;
+
+  /// Bring the lanes up to date with a lane graph.
+  /// \param[in] graph
+  ///   The graph to simulate on, which must outlive the simulation or the
+  ///   next `sync`.
+  /// \remarks
+  ///   Vehicles keep their place on lanes whose segment is unchanged. Those
+  ///   on removed lanes are removed, and those that no longer fit on a lane
+  ///   that got shorter are removed from its front.
+  void sync(const LaneGraph &graph);
+
+  /// Add a vehicle to the simulation.
+  /// \param[in] segment
+  ///   The segment to place the vehicle on.
+  /// \param[in] position
+  ///   The distance along the segment to place the vehicle at.
+  /// \param[in] route
+  ///   The segments that the vehicle should travel along after `segment`,
+  ///   or empty for the vehicle to wander the network at random.
+  /// \returns
+  ///   The vehicle, or `none` if the segment is full or carries no vehicles.
+  uint32_t spawn(uint32_t segment, float position, const List<uint32_t> &route = { });
+
+  /// Spread vehicles evenly over every lane, wandering the network.
+  /// \param[in] vehicles
+  ///   The number of vehicles to add.
+  /// \returns
+  ///   The number of vehicles added, which is fewer if the lanes fill up.
+  /// \remarks
+  ///   The lanes must already be synced to a graph.
+  size_t populate(size_t vehicles);
+
+  /// Remove a vehicle from the simulation.
+  /// \param[in] vehicle
+  ///   The vehicle to remove.
+  void despawn(uint32_t vehicle);
+
+  /// Simulate a single step of `timestep` seconds.
+  void step();
+
+  /// Simulate as many steps as fit into the time elapsed, carrying the rest
+  /// over to the next call.
+  /// \param[in] elapsed
+  ///   The time elapsed since the last call, in seconds.
+  /// \returns
+  ///   The number of steps simulated.
+  /// \remarks
+  ///   At most `maxSteps` steps are simulated, dropping any more time than
+  ///   that so that a slow frame doesn't make the next one slower.
+  int advance(float elapsed);
+
+
+
+  /// The number of vehicles in the simulation.
+  size_t count() const {
+    return _count;
+  }
+
+  /// The number of lanes carrying vehicles.
+  size_t lanes() const {
+    return _active.count();
+  }
+
+  /// The number of intersections where vehicles give way.
+  size_t signals() const {
+    return _signals.count();
+  }
+
+  /// The time simulated so far, in seconds.
+  double time() const {
+    return _time;
+  }
+
+  /// The time elapsed since the last step, in seconds, for drawing vehicles
+  /// in between steps.
+  float lag() const {
+    return _carry;
+  }
+
+  /// Write the state of every vehicle, lane by lane.
+  /// \param[out] snapshots
+  ///   Room for the state of `count()` vehicles.
+  void snapshot(Snapshot *snapshots) const;
+
+  /// The cost of the simulation since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the cost of the simulation so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+private:
+  /// A lane of vehicles, one per segment of the lane graph.
+  struct _lane {
+    /// The road of the segment when the lane was last synced, or `nullptr`
+    /// if the segment carries no vehicles.
+    Road *road;
+
+    /// The index of the lane in the road definition.
+    uint16_t index;
+
+    /// Whether traffic travels from the start of the road to its end.
+    bool forward;
+
+    /// Whether the front vehicle is waiting for right of way.
+    bool waiting;
+
+    /// The first slot of the lane.
+    uint32_t offset;
+
+    /// The number of slots of the lane.
+    uint32_t capacity;
+
+    /// The number of vehicles on the lane.
+    uint32_t count;
+
+    /// The length of the lane, in meters.
+    float length;
+
+    /// The speed limit of the lane, in meters per second.
+    float speed;
+
+    /// The intersection that the lane gives way at, or `none`.
+    uint32_t signal;
+
+    /// The phase of the intersection that the lane has right of way in.
+    uint32_t phase;
+  };
+
+  /// The right of way through an intersection.
+  struct _signal {
+    /// The first lane arriving at the intersection in `_approaches`.
+    uint32_t first;
+
+    /// The number of lanes arriving at the intersection.
+    uint32_t count;
+
+    /// The number of phases of the intersection.
+    uint32_t phases;
+
+    /// The phase with right of way, or the next one while clearing.
+    uint32_t green;
+
+    /// Whether every phase is held while the intersection clears.
+    bool clearing;
+
+    /// The time since right of way last changed, in seconds.
+    float timer;
+  };
+
+  /// A vehicle, as only needed when it changes lane.
+  struct _vehicle {
+    /// The segment that the vehicle is on, or `none` if it is unused.
+    uint32_t lane;
+
+    /// The segment that the vehicle continues onto, or `none` if its route
+    /// ends with its current one.
+    uint32_t next;
+
+    /// The length of the movement onto the next segment, in meters.
+    float nextGap;
+
+    /// The index in the route of the next segment.
+    uint32_t step;
+
+    /// The state of the vehicle's random choices while wandering.
+    uint32_t random;
+
+    /// The segments of the vehicle's route, or empty if it wanders.
+    List<uint32_t> route;
+  };
+
+  /// Run a function over ranges of indices across the threads.
+  /// \param[in] count
+  ///   The number of indices.
+  /// \param[in] body
+  ///   The function to run with the first and one past the last index of
+  ///   each range.
+  void _parallel(size_t count, void (*body)(TrafficSimulation &, size_t, size_t));
+
+  /// Accelerate the vehicles of a range of lanes.
+  static void _accelerate(TrafficSimulation &self, size_t begin, size_t end);
+
+  /// Move the vehicles of a range of lanes.
+  static void _move(TrafficSimulation &self, size_t begin, size_t end);
+
+  /// Update the right of way of a range of intersections.
+  static void _give(TrafficSimulation &self, size_t begin, size_t end);
+
+  /// Move the vehicles that reached the end of their lane onto the next.
+  void _transfer();
+
+  /// Choose the segment that a vehicle continues onto after its current one.
+  /// \param[in] vehicle
+  ///   The vehicle to choose for.
+  void _choose(uint32_t vehicle);
+
+  /// Insert a vehicle onto a lane, keeping the lane in order.
+  /// \param[in] lane
+  ///   The lane to insert onto, which must not be full.
+  /// \param[in] vehicle
+  ///   The vehicle to insert.
+  /// \param[in] position
+  ///   The distance along the lane of the vehicle.
+  /// \param[in] speed
+  ///   The speed of the vehicle.
+  void _insert(uint32_t lane, uint32_t vehicle, float position, float speed);
+
+  /// Free a vehicle that has left its lane.
+  /// \param[in] vehicle
+  ///   The vehicle to free.
+  void _release(uint32_t vehicle);
+
+  /// Remove the vehicle in a slot from its lane.
+  /// \param[in] lane
+  ///   The lane to remove from.
+  /// \param[in] slot
+  ///   The slot of the vehicle, relative to the lane.
+  void _erase(uint32_t lane, uint32_t slot);
+
+  /// The lane graph simulated on.
+  const LaneGraph *_graph = nullptr;
+
+  /// The version of the lane graph that the lanes were last synced to.
+  uint64_t _version = 0;
+
+  /// The lanes, indexed by segment.
+  List<_lane> _lanes { };
+
+  /// The segments of the lanes that carry vehicles.
+  List<uint32_t> _active { };
+
+  /// The right of way through every intersection with more than two arms.
+  List<_signal> _signals { };
+
+  /// The lanes arriving at every intersection, ordered by intersection.
+  List<uint32_t> _approaches { };
+
+  /// The distance along its lane of the vehicle in every slot.
+  List<float> _position { };
+
+  /// The speed of the vehicle in every slot, in meters per second.
+  List<float> _speed { };
+
+  /// The acceleration of the vehicle in every slot, in meters per second
+  /// squared.
+  List<float> _acceleration { };
+
+  /// The vehicle in every slot.
+  List<uint32_t> _slots { };
+
+  /// Every vehicle, including unused ones.
+  List<_vehicle> _vehicles { };
+
+  /// The unused vehicles that may be reused.
+  List<uint32_t> _free { };
+
+  /// The number of vehicles in the simulation.
+  size_t _count = 0;
+
+  /// The time simulated so far, in seconds.
+  double _time = 0;
+
+  /// The time elapsed but not yet simulated, in seconds.
+  float _carry = 0;
+
+  /// The requested number of worker threads.
+  int _requestedThreads = -1;
+
+  /// The cost of the simulation since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
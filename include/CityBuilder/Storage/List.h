@@ -312,6 +312,17 @@ public:
     return _data->contents[_data->count - 1];
   }
   
+  /// Make room for a number of elements in the list, so that appending up to
+  /// that many elements does not reallocate it.
+  /// \param[in] capacity
+  ///   The total number of elements to make room for.
+  void reserve(size_t capacity) {
+    if (capacity > count())
+      _expand(capacity - count());
+    else
+      _makeUnique();
+  }
+  
   /// Append an element to the list.
   /// \param[in] element
   ///   The element to append.
@@ -378,6 +389,21 @@ public:
     }
   }
   
+  /// Remove all elements from the list, keeping its storage so that it can
+  /// be refilled without reallocating.
+  void clear() {
+    if (_data == nullptr)
+      return;
+    if (_data->references > 1) {
+      // The storage belongs to another list too
+      removeAll();
+      return;
+    }
+    for (size_t i = 0; i < _data->count; i++)
+      _data->contents[i].~T();
+    _data->count = 0;
+  }
+  
   
   
   template<typename Lambda, typename U = typename Templates::Lambda1<decltype(&Lambda::operator())>::returns>
@@ -465,13 +491,13 @@ private:
     } else {
       // Divide
       size_t mid = count / 2;
-      _sort(list, mid);
-      _sort(list + mid, count - mid);
+      _sort(list, mid, comparison);
+      _sort(list + mid, count - mid, comparison);
       
       // Merge
       size_t i = 0, j = mid;
       while (i < j && j < count) {
-        if (list[j] < list[i]) {
+        if (comparison(list[j], list[i])) {
           // Rotate
           T t = std::move(list[j]);
           for (size_t k = j; k > i; k--)
@@ -157,18 +157,18 @@ public:
   }
   
   /// Create a map with a given bucket count.
-  template<int buckets>
+  template<int bucketCount>
   static Map buckets() {
-    return Map(new Data<buckets>());
+    return Map(new Data<bucketCount>());
   }
   
   /// Create a map with a given bucket count and initialize it with a set of
   /// key-value pairs.
   /// \param[in] pairs
   ///   The pairs to populate the map with.
-  template<int buckets>
+  template<int bucketCount>
   static Map buckets(std::initializer_list<Pair> pairs) {
-    Map map = Map(new Data<buckets>());
+    Map map = Map(new Data<bucketCount>());
     for (const Pair &pair : pairs)
       map.set(pair.key, pair.value);
     return map;
@@ -0,0 +1,154 @@
+/**
+ * @file Archive.h
+ * @brief A packed, indexed archive of game assets.
+ * @date May 6, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// A packed, indexed archive of game assets.
+/// \remarks
+///   The archive is produced offline by the asset packer
+///   (`tools/assetpack`) and memory mapped as a whole at runtime.
+///
+///   Layout:
+///     Header
+///     Entry[buckets]       (hash table, every entry in its home bucket)
+///     names                (null-terminated "name.extension" strings)
+///     payloads             (each aligned to `alignment`, null-terminated)
+///
+///   The packer grows the table until no two entries share a bucket, so a
+///   lookup is always a single table probe.
+struct Archive {
+  /// The types of resources in an archive.
+  enum class Type : uint16_t {
+    raw    , //< Stored as-is (e.x. markup).
+    texture, //< Texture data without its file header.
+    shader , //< A compiled shader.
+  };
+
+  /// The archive header.
+  struct Header {
+    /// The archive identifier, always `CBPK`.
+    char magic[4];
+
+    /// The archive format version.
+    uint32_t version;
+
+    /// The number of resources in the archive.
+    uint32_t count;
+
+    /// The number of buckets in the table (a power of two).
+    uint32_t buckets;
+  };
+
+  /// A resource in the archive table.
+  struct Entry {
+    /// The hash of the resource's "name.extension", zero for an empty bucket.
+    uint64_t hash;
+
+    /// The offset of the payload from the start of the archive.
+    uint64_t offset;
+
+    /// The length of the payload, excluding its null-terminator.
+    uint64_t length;
+
+    /// The offset of the resource's null-terminated "name.extension" from the
+    /// start of the archive.
+    uint32_t name;
+
+    /// The type of the resource.
+    Type type;
+
+    /// The texture format (a `bgfx::TextureFormat::Enum`).
+    uint16_t format;
+
+    /// The width of the texture's top mip level, in pixels.
+    uint16_t width;
+
+    /// The height of the texture's top mip level, in pixels.
+    uint16_t height;
+
+    /// The number of texture array layers.
+    uint16_t layers;
+
+    /// The number of mip levels in the texture.
+    uint8_t mips;
+
+    /// Unused.
+    uint8_t reserved;
+  };
+
+  /// The alignment of every payload in the archive.
+  static const uint32_t alignment = 64;
+
+  /// The current archive format version.
+  static const uint32_t version = 1;
+
+
+
+  /// Open an archive for lookups.
+  /// \param[in] path
+  ///   The path of the archive file.
+  /// \returns
+  ///   Whether or not the archive was opened.
+  /// \remarks
+  ///   Replaces any currently open archive.
+  static bool open(const char *path);
+
+  /// Close the open archive.
+  /// \remarks
+  ///   Any data pointers into the archive become invalid.
+  static void close();
+
+  /// Whether an archive is open.
+  static bool isOpen();
+
+  /// Find a resource in the open archive.
+  /// \param[in] name
+  ///   The resource name.
+  /// \param[in] extension
+  ///   The resource extension.
+  /// \returns
+  ///   The resource's entry, or null if there is no open archive or the
+  ///   resource is not in it.
+  static const Entry *find(const char *name, const char *extension);
+
+  /// Get the payload of a resource in the open archive.
+  /// \param[in] entry
+  ///   An entry returned by `find`.
+  /// \returns
+  ///   The null-terminated payload.
+  static const char *data(const Entry *entry);
+
+  /// Hash a resource name.
+  /// \param[in] name
+  ///   The resource name.
+  /// \param[in] extension
+  ///   The resource extension.
+  /// \returns
+  ///   A non-zero 64-bit FNV-1a hash of "name.extension".
+  static uint64_t hash(const char *name, const char *extension);
+
+  /// Read the metadata of a DDS texture file.
+  /// \param[in] file
+  ///   The contents of the file.
+  /// \param[in] length
+  ///   The length of the file.
+  /// \param[out] entry
+  ///   The entry to write the texture's type, format, size, layers and mips
+  ///   to.
+  /// \param[out] header
+  ///   The length of the file header preceding the texture data.
+  /// \returns
+  ///   Whether or not the file is a supported DDS texture.
+  static bool parseTexture(
+    const char *file, size_t length, Entry &entry, size_t &header
+  );
+};
+
+NS_CITY_BUILDER_END
@@ -0,0 +1,902 @@
+/**
+ * @file MarkupSchema.h
+ * @brief Compile-time schemas for custom markup files.
+ * @date May 8, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/String.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Storage/Map.h>
+#include <CityBuilder/Geometry/Profile.h>
+#include <tuple>
+#include <utility>
+
+NS_CITY_BUILDER_BEGIN
+
+namespace Internal { namespace Schema {
+
+  /// A markup file token.
+  /// \remarks
+  ///   The content of the token is not copied: it points into the contents
+  ///   of the loaded file.
+  struct Token {
+    /// The type of token.
+    enum class Type : uint8_t {
+      /// A section header, e.x. `[foo]`.
+      section,
+      /// An identifier (default type).
+      identifier,
+      /// A number (including decimals).
+      number,
+      /// A single comma.
+      comma,
+      /// A string.
+      string,
+      /// A line break.
+      lineBreak,
+    };
+
+    /// The text content of the token (not null-terminated).
+    const char *text;
+
+    /// The length of the text content of the token, in bytes.
+    uint32_t length;
+
+    /// The token content type.
+    Type type;
+
+    /// The line number of the token.
+    int line;
+
+    /// The column number of the token.
+    int column;
+  };
+
+  /// A single entry line of a markup file.
+  struct Entry {
+    /// The path to the markup file.
+    const char *path;
+
+    /// The leading identifier of the entry.
+    const Token *name;
+
+    /// The first value token of the entry.
+    const Token *begin;
+
+    /// The end of the value tokens of the entry.
+    const Token *end;
+  };
+
+  /// A receiver for the sections and entries of a markup file.
+  struct Visitor {
+    virtual ~Visitor() { }
+
+    /// Called for each section header.
+    virtual void section(const Token &token) = 0;
+
+    /// Called for each entry line under a section header.
+    virtual void entry(const Entry &entry) = 0;
+  };
+
+  /// A loaded markup file.
+  /// \remarks
+  ///   The file is tokenized on the fly rather than into a token list, so
+  ///   that parsing a file doesn't allocate memory in proportion to its size.
+  struct File {
+    /// The path to the markup file.
+    const char *path;
+
+    /// The contents of the file, which tokens point into.
+    char *contents = nullptr;
+
+    /// The length of the contents of the file.
+    size_t length = 0;
+
+    File(const char *path) : path(path) { }
+
+    File(const File &) = delete;
+
+    ~File();
+
+    /// Load and check the file.
+    /// \returns
+    ///   Whether or not the file could be loaded and is well-formed.
+    /// \remarks
+    ///   Prints any errors found.
+    bool load();
+
+    /// Check a file that is already in memory.
+    /// \param[in] contents
+    ///   The contents of the file, which are copied.
+    /// \param[in] length
+    ///   The length of the contents of the file.
+    /// \returns
+    ///   Whether or not the file is well-formed.
+    /// \remarks
+    ///   Prints any errors found.
+    bool load(const char *contents, size_t length);
+
+    /// Go through the sections and entries of a loaded file, in order.
+    void visit(Visitor &visitor) const;
+  };
+
+  /// The parsing state of a record.
+  struct Cursor {
+    /// The path to the markup file.
+    const char *path;
+
+    /// The next token to parse.
+    const Token *token;
+
+    /// The end of the tokens of the record.
+    const Token *end;
+
+    /// The line number of the record.
+    int line;
+
+    /// The selection index of the record (from its names).
+    int selection;
+  };
+
+  /// Print an error for an entry.
+  /// \param[in] path
+  ///   The path to the markup file.
+  /// \param[in] line
+  ///   The line number of the error.
+  /// \param[in] message
+  ///   The error message.
+  /// \param[in] value
+  ///   An optional token whose text follows the message.
+  /// \param[in] suffix
+  ///   The text following the token, if any.
+  void error(
+    const char *path, int line, const char *message,
+    const Token *value = nullptr, const char *suffix = nullptr
+  );
+
+  /// Print an error for a token of a record.
+  /// \param[in] cursor
+  ///   The record being parsed.
+  /// \param[in] token
+  ///   The offending token.
+  /// \param[in] message
+  ///   The error message.
+  /// \param[in] value
+  ///   Optional text that follows the message.
+  /// \param[in] length
+  ///   The length of the text that follows the message.
+  /// \param[in] suffix
+  ///   The text following the value, if any.
+  void error(
+    const Cursor &cursor, const Token &token, const char *message,
+    const char *value = nullptr, size_t length = 0, const char *suffix = nullptr
+  );
+
+  /// Print an error for a record that ended too early.
+  /// \param[in] cursor
+  ///   The record being parsed.
+  /// \param[in] expected
+  ///   A description of the missing value.
+  /// \param[in] identifier
+  ///   An optional identifier that follows the description, quoted.
+  void unexpected(const Cursor &cursor, const char *expected, const char *identifier = nullptr);
+
+  /// Print an error for a record with too many values.
+  /// \param[in] cursor
+  ///   The record being parsed, pointing at the first unused value.
+  void unused(const Cursor &cursor);
+
+  /// Parse a (positive) integer token.
+  bool parseInteger(const Token &token, int &integer);
+
+  /// Parse a (positive) real number token.
+  bool parseReal(const Token &token, float &real);
+
+  /// The length of a null-terminated string.
+  constexpr size_t length(const char *string) {
+    size_t length = 0;
+    while (string[length] != '\0')
+      length++;
+    return length;
+  }
+
+  /// Whether or not two strings of the same length are the same.
+  constexpr bool equal(const char *a, const char *b, size_t length) {
+    for (size_t i = 0; i < length; i++)
+      if (a[i] != b[i])
+        return false;
+    return true;
+  }
+
+  /// A seeded FNV-1a hash of a keyword.
+  constexpr uint32_t hash(const char *text, size_t length, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < length; i++)
+      hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+    return hash ^ hash >> 15;
+  }
+
+  /// The number of hash table slots for a number of keywords.
+  constexpr size_t slots(size_t count) {
+    size_t slots = 2;
+    while (slots < count * 2)
+      slots *= 2;
+    return slots;
+  }
+
+}}
+
+
+
+
+
+/// Compile-time schemas for custom markup files.
+/// \remarks
+///   A schema describes the sections, fields and records of a file as a
+///   single constant value.
+///   The parser for a schema is generated by the compiler, and every section,
+///   field, record and value name is found with a perfect hash built from the
+///   schema, rather than by comparing against each name in turn.
+///   Errors are printed to `stdout` with the path, line and column at fault.
+///
+///   Usage:
+///   ```
+///   static constexpr auto schema = Schema::document(
+///     Schema::section("item",
+///       Schema::field("name", &MyItem::name)),
+///     Schema::section("records",
+///       Schema::records(&MyItem::records, { "foo", "bar" },
+///         Schema::set(&MyRecord::type, {
+///           MyRecord::Type::foo,
+///           MyRecord::Type::bar
+///         }),
+///         Schema::point(&MyRecord::position),
+///         Schema::option("speed",
+///           Schema::integer(&MyRecord::speed))))
+///   );
+///
+///   MyItem item { };
+///   bool success = Schema::parse(path, item, schema);
+///   ```
+///   Schemas made only of literal types (member pointers, enumerations and
+///   strings) can be `constexpr`, in which case the hash tables are built at
+///   compile time; other schemas should be `static const` so that they are
+///   only built once.
+namespace Schema {
+
+  /// A perfect hash table of names.
+  template<size_t N>
+  struct Keywords {
+    static_assert(N < 255, "Too many keywords");
+
+    /// The number of slots in the table.
+    static constexpr size_t slots = Internal::Schema::slots(N);
+
+    /// The names in the table.
+    const char *names[N > 0 ? N : 1] = { };
+
+    /// The lengths of the names in the table.
+    size_t lengths[N > 0 ? N : 1] = { };
+
+    /// The index (plus one) of the name in each slot, zero if empty.
+    uint8_t table[slots] = { };
+
+    /// The hash seed that places every name in its own slot.
+    uint32_t seed = 0;
+
+    /// Find a hash seed for the names.
+    /// \remarks
+    ///   Throws if any name appears twice.
+    constexpr void build();
+
+    /// Find a name in the table.
+    /// \param[in] text
+    ///   The text of the name.
+    /// \param[in] length
+    ///   The length of the name, in bytes.
+    /// \returns
+    ///   The index of the name, or -1 if it is not in the table.
+    int find(const char *text, size_t length) const;
+  };
+
+  /// A named value.
+  template<typename V>
+  struct Keyword {
+    /// The name of the value.
+    const char *name;
+
+    /// The value.
+    V value;
+  };
+
+  /// A perfect hash table of named values.
+  template<typename V, size_t N>
+  struct Table {
+    /// The named values.
+    Keyword<V> values[N];
+
+    /// The names of the values.
+    Keywords<N> keywords { };
+
+    constexpr Table(const Keyword<V> (&values)[N])
+      : Table(values, std::make_index_sequence<N>()) { }
+
+    template<size_t... I>
+    constexpr Table(const Keyword<V> (&values)[N], std::index_sequence<I...>);
+
+    /// Find the value named by a token.
+    /// \returns
+    ///   The value, or null if the token doesn't name one.
+    const V *find(const Internal::Schema::Token &token) const;
+  };
+
+
+
+
+
+  /* ------------------------------------------------------------------------ *\
+  | Record values                                                              |
+  \* ------------------------------------------------------------------------ */
+
+  /// Set a member in accordance with the record name (see `set`).
+  template<typename C, typename V, size_t N>
+  struct Set {
+    /// The number of record names that the values correspond to.
+    static constexpr size_t selections = N;
+
+    /// The member to set.
+    V C::*member;
+
+    /// The value for each record name.
+    V values[N];
+
+    template<size_t... I>
+    constexpr Set(V C::*member, const V (&values)[N], std::index_sequence<I...>)
+      : member(member), values { values[I]... } { }
+
+    template<typename U>
+    bool parse(Internal::Schema::Cursor &cursor, U &value) const;
+  };
+
+  /// A (positive) integer value (see `integer`).
+  template<typename C>
+  struct Integer {
+    static constexpr size_t selections = 0;
+
+    /// The member to set.
+    int C::*member;
+
+    template<typename U>
+    bool parse(Internal::Schema::Cursor &cursor, U &value) const;
+  };
+
+  /// A (positive) real value (see `real`).
+  template<typename C>
+  struct Number {
+    static constexpr size_t selections = 0;
+
+    /// The member to set.
+    Real C::*member;
+
+    template<typename U>
+    bool parse(Internal::Schema::Cursor &cursor, U &value) const;
+  };
+
+  /// A (positive) point value (see `point`).
+  template<typename C>
+  struct Point {
+    static constexpr size_t selections = 0;
+
+    /// The member to set.
+    Real2 C::*member;
+
+    template<typename U>
+    bool parse(Internal::Schema::Cursor &cursor, U &value) const;
+  };
+
+  /// A signed vector value (see `vector`).
+  template<typename C>
+  struct Vector {
+    static constexpr size_t selections = 0;
+
+    /// The member to set.
+    Real2 C::*member;
+
+    template<typename U>
+    bool parse(Internal::Schema::Cursor &cursor, U &value) const;
+  };
+
+  /// A specific identifier (see `identifier`).
+  struct Identifier {
+    static constexpr size_t selections = 0;
+
+    /// The identifier to match.
+    const char *name;
+
+    /// The length of the identifier.
+    size_t length;
+
+    template<typename U>
+    bool parse(Internal::Schema::Cursor &cursor, U &value) const;
+  };
+
+  /// A single comma (see `comma`).
+  struct Comma {
+    static constexpr size_t selections = 0;
+
+    template<typename U>
+    bool parse(Internal::Schema::Cursor &cursor, U &value) const;
+  };
+
+  /// A named value, as an identifier or a string (see `match`).
+  template<typename C, typename V, size_t N, bool strings>
+  struct Match {
+    static constexpr size_t selections = 0;
+
+    /// The member to set.
+    V C::*member;
+
+    /// The values to match.
+    Table<V, N> table;
+
+    template<typename U>
+    bool parse(Internal::Schema::Cursor &cursor, U &value) const;
+  };
+
+  /// A value of a map, as an identifier or a string (see `match`).
+  template<typename C, typename M, typename V, bool strings>
+  struct MatchMap {
+    static constexpr size_t selections = 0;
+
+    /// The member to set, either a value or a pointer to a value.
+    M C::*member;
+
+    /// The values to match.
+    Map<String, V> *values;
+
+    template<typename U>
+    bool parse(Internal::Schema::Cursor &cursor, U &value) const;
+  };
+
+  /// A named option set (see `option`).
+  template<typename... Matchers>
+  struct Option {
+    static constexpr size_t selections = 0;
+
+    /// The name of the option set.
+    const char *name;
+
+    /// The length of the name.
+    size_t length;
+
+    /// The option set arguments.
+    std::tuple<Matchers...> matchers;
+
+    template<typename U>
+    bool parse(Internal::Schema::Cursor &cursor, U &value) const;
+  };
+
+
+
+
+
+  /* ------------------------------------------------------------------------ *\
+  | Section entries                                                            |
+  \* ------------------------------------------------------------------------ */
+
+  /// A string field (see `field`).
+  template<typename C>
+  struct Field {
+    /// The number of names of the entry.
+    static constexpr size_t keywords = 1;
+
+    /// The name of the field.
+    const char *name;
+
+    /// The member to set.
+    String C::*member;
+
+    constexpr const char *keyword(size_t) const { return name; }
+
+    template<typename T>
+    bool parse(const Internal::Schema::Entry &entry, T &item, int selection) const;
+  };
+
+  /// A named value field (see `field`).
+  template<typename C, typename V, size_t N>
+  struct Choice {
+    static constexpr size_t keywords = 1;
+
+    /// The name of the field.
+    const char *name;
+
+    /// The member to set.
+    V C::*member;
+
+    /// The values to match.
+    Table<V, N> table;
+
+    constexpr const char *keyword(size_t) const { return name; }
+
+    template<typename T>
+    bool parse(const Internal::Schema::Entry &entry, T &item, int selection) const;
+  };
+
+  /// A set of records (see `records`).
+  template<typename C, typename U, size_t N, typename... Matchers>
+  struct Records {
+    static constexpr size_t keywords = N;
+
+    static_assert(((Matchers::selections == 0 || Matchers::selections == N) && ...),
+      "The number of set values must match the number of record names");
+
+    /// The list to append parsed records to.
+    List<U> C::*list;
+
+    /// The names that the record can be identified by.
+    const char *names[N];
+
+    /// The record values.
+    std::tuple<Matchers...> matchers;
+
+    template<size_t... I>
+    constexpr Records(
+      List<U> C::*list, const char *const (&names)[N],
+      const Matchers &...matchers, std::index_sequence<I...>
+    ) : list(list), names { names[I]... }, matchers(matchers...) { }
+
+    constexpr const char *keyword(size_t index) const { return names[index]; }
+
+    template<typename T>
+    bool parse(const Internal::Schema::Entry &entry, T &item, int selection) const;
+  };
+
+  /// A section (see `section`).
+  template<typename... Items>
+  struct Section {
+    /// The number of entry names in the section.
+    static constexpr size_t count = (Items::keywords + ... + 0);
+
+    /// The name of the section.
+    const char *name;
+
+    /// The entries of the section.
+    std::tuple<Items...> items;
+
+    /// The entry names of the section.
+    Keywords<count> keywords { };
+
+    /// The entry that each name belongs to.
+    uint8_t owners[count > 0 ? count : 1] = { };
+
+    /// The selection index of each name within its entry.
+    uint8_t selections[count > 0 ? count : 1] = { };
+
+    constexpr Section(const char *name, const Items &...items);
+
+    /// Parse an entry of the section.
+    template<typename T>
+    bool parse(const Internal::Schema::Entry &entry, T &item) const;
+
+    template<typename Item>
+    constexpr void _add(const Item &item, uint8_t owner, size_t &index);
+
+    template<typename T, size_t... I>
+    bool _parse(
+      std::index_sequence<I...>, size_t owner,
+      const Internal::Schema::Entry &entry, T &item, int selection
+    ) const;
+  };
+
+  /// A complete file schema (see `document`).
+  template<typename... Sections>
+  struct Document {
+    /// The sections of the file.
+    std::tuple<Sections...> sections;
+
+    /// The names of the sections.
+    Keywords<sizeof...(Sections)> names { };
+
+    constexpr Document(const Sections &...sections);
+
+    /// Parse a loaded file.
+    template<typename T>
+    bool parse(const Internal::Schema::File &file, T &item) const;
+
+    template<typename T, size_t... I>
+    bool _parse(
+      std::index_sequence<I...>, size_t section,
+      const Internal::Schema::Entry &entry, T &item
+    ) const;
+  };
+
+
+
+
+
+  /* ------------------------------------------------------------------------ *\
+  | Schema construction                                                        |
+  \* ------------------------------------------------------------------------ */
+
+  /// Describe a file.
+  /// \param[in] sections
+  ///   The sections that the file may contain.
+  template<typename... Sections>
+  constexpr Document<Sections...> document(const Sections &...sections) {
+    return { sections... };
+  }
+
+  /// Describe a section of a file.
+  /// \param[in] name
+  ///   The name of the section.
+  /// \param[in] items
+  ///   The fields and records that the section may contain.
+  template<typename... Items>
+  constexpr Section<Items...> section(const char *name, const Items &...items) {
+    return { name, items... };
+  }
+
+  /// A string field.
+  /// \param[in] name
+  ///   The name of the field.
+  /// \param[in] member
+  ///   The member to set.
+  /// \remarks
+  ///   Usage:
+  ///   ```
+  ///   Schema::section("foo",
+  ///     Schema::field("bar", &MyItem::bar))
+  ///   ```
+  ///   When parsing a file with the above schema:
+  ///   ```
+  ///   [foo]
+  ///   bar "Hello, world!"    # -> { .bar = "Hello, world!", ... }
+  ///   ```
+  template<typename C>
+  constexpr Field<C> field(const char *name, String C::*member) {
+    return { name, member };
+  }
+
+  /// A field matching an identifier to a set of values.
+  /// \param[in] name
+  ///   The name of the field.
+  /// \param[in] member
+  ///   The member to set.
+  /// \param[in] values
+  ///   The named values to match.
+  /// \remarks
+  ///   Usage:
+  ///   ```
+  ///   Schema::section("colors",
+  ///     Schema::field("primary", &MyItem::primary, {
+  ///       { "red",   Color::red   },
+  ///       { "green", Color::green },
+  ///       { "blue",  Color::blue  },
+  ///     }))
+  ///   ```
+  ///   When parsing a file with the above schema:
+  ///   ```
+  ///   [colors]
+  ///   primary red    # -> { .primary = Color::red, ... }
+  ///   ```
+  template<typename C, typename V, size_t N>
+  constexpr Choice<C, V, N> field(
+    const char *name, V C::*member, const Keyword<V> (&values)[N]
+  ) {
+    return { name, member, values };
+  }
+
+  /// A set of records.
+  /// \param[in] list
+  ///   The list to append parsed records to.
+  /// \param[in] names
+  ///   The names that the record can be identified by.
+  /// \param[in] matchers
+  ///   The values of the record, in order.
+  /// \remarks
+  ///   Usage:
+  ///   ```
+  ///   Schema::section("geometry",
+  ///     Schema::records(&MyItem::shapes, { "box", "sphere" },
+  ///       Schema::set(&Shape::type, { Shape::Type::box, Shape::Type::sphere }),
+  ///       Schema::real(&Shape::radius)))
+  ///   ```
+  ///   When parsing a file with the above schema:
+  ///   ```
+  ///   [geometry]
+  ///   box 3         # -> shapes[0] = { .type = box, .radius = 3 }
+  ///   sphere 5.5    # -> shapes[1] = { .type = sphere, .radius = 5.5 }
+  ///   ```
+  template<typename C, typename U, size_t N, typename... Matchers>
+  constexpr Records<C, U, N, Matchers...> records(
+    List<U> C::*list, const char *const (&names)[N], const Matchers &...matchers
+  ) {
+    return { list, names, matchers..., std::make_index_sequence<N>() };
+  }
+
+  /// Set a member in accordance with the record name.
+  /// \remarks
+  ///   With the record names `{ "foo", "bar" }` and the values
+  ///   `{ Type::foo, Type::bar }`, a `bar` record sets the member to
+  ///   `Type::bar`.
+  ///   The number of values must match the number of record names.
+  template<typename C, typename V, size_t N>
+  constexpr Set<C, V, N> set(V C::*member, const V (&values)[N]) {
+    return { member, values, std::make_index_sequence<N>() };
+  }
+
+  /// Parse a (positive) integer value.
+  /// \remarks
+  ///   `1` is parsed, while `foo` and `-1` are errors.
+  template<typename C>
+  constexpr Integer<C> integer(int C::*member) {
+    return { member };
+  }
+
+  /// Parse a (positive) real value.
+  /// \remarks
+  ///   `1.5` is parsed, while `foo` and `-1.5` are errors.
+  template<typename C>
+  constexpr Number<C> real(Real C::*member) {
+    return { member };
+  }
+
+  /// Parse a (positive) point value.
+  /// \remarks
+  ///   `1.5,3` is parsed, while `foo` and `-1.5,-2` are errors.
+  ///   Use `vector` to allow negative axes.
+  template<typename C>
+  constexpr Point<C> point(Real2 C::*member) {
+    return { member };
+  }
+
+  /// Parse a vector value, which may have negative axes.
+  /// \remarks
+  ///   `1.5,-3` is parsed, while `foo` and `1.5 2` are errors.
+  template<typename C>
+  constexpr Vector<C> vector(Real2 C::*member) {
+    return { member };
+  }
+
+  /// Parse a specific identifier.
+  /// \remarks
+  ///   With the identifier `foo`, `foo` is parsed, while `foo-bar` and `2`
+  ///   are errors.
+  constexpr Identifier identifier(const char *name) {
+    return { name, Internal::Schema::length(name) };
+  }
+
+  /// Parse a comma.
+  constexpr Comma comma() {
+    return { };
+  }
+
+  /// Match an identifier to a set of values.
+  /// \remarks
+  ///   With the values `{ { "foo", Type::foo }, { "bar", Type::bar } }`,
+  ///   `bar` sets the member to `Type::bar`.
+  template<typename C, typename V, size_t N>
+  constexpr Match<C, V, N, false> match(V C::*member, const Keyword<V> (&values)[N]) {
+    return { member, values };
+  }
+
+  /// Match an identifier to the values of a map.
+  /// \param[in] member
+  ///   The member to set, either to the value or to a pointer to the value.
+  /// \param[in] values
+  ///   The map to look the identifier up in when parsing.
+  template<typename C, typename M, typename V>
+  constexpr MatchMap<C, M, V, false> match(M C::*member, Map<String, V> *values) {
+    return { member, values };
+  }
+
+  /// Match a string to a set of values.
+  /// \remarks
+  ///   With the values `{ { "foo", Type::foo }, { "bat baz", Type::batBaz } }`,
+  ///   `"bat baz"` sets the member to `Type::batBaz`.
+  template<typename C, typename V, size_t N>
+  constexpr Match<C, V, N, true> matchString(V C::*member, const Keyword<V> (&values)[N]) {
+    return { member, values };
+  }
+
+  /// Match a string to the values of a map.
+  /// \param[in] member
+  ///   The member to set, either to the value or to a pointer to the value.
+  /// \param[in] values
+  ///   The map to look the string up in when parsing.
+  template<typename C, typename M, typename V>
+  constexpr MatchMap<C, M, V, true> matchString(M C::*member, Map<String, V> *values) {
+    return { member, values };
+  }
+
+  /// A named option set.
+  /// \param[in] name
+  ///   The name of the option set.
+  /// \param[in] matchers
+  ///   The arguments of the option set.
+  /// \remarks
+  ///   With `option("foo", integer(&MyRecord::foo))`, `foo 3` sets the
+  ///   member to 3 and `foo ,` is an error, while a record without `foo`
+  ///   leaves the member untouched.
+  template<typename... Matchers>
+  constexpr Option<Matchers...> option(const char *name, const Matchers &...matchers) {
+    return { name, Internal::Schema::length(name), { matchers... } };
+  }
+
+  /// A set of profile point records.
+  /// \param[in] points
+  ///   The list to append the points to.
+  /// \remarks
+  ///   When parsing a file with `Schema::section("profile",
+  ///   Schema::profilePoints(&MyItem::profile))`:
+  ///   ```
+  ///   [profile]
+  ///   M 0,0 uv 0 normal 0,1
+  ///   D 3,1 uv 0 normal 0,1 normal 1,0
+  ///   M 3,0 uv 0 normal 1,0
+  ///   ```
+  ///   Becomes:
+  ///   ```
+  ///   [0] = { .type = move, .position = { 0, 0 }, ... }
+  ///   [1] = { .type = disjoint, .position = { 3, 1 }, ... }
+  ///   [2] = { .type = move, .position = { 3, 0 }, ... }
+  ///   ```
+  template<typename C>
+  constexpr auto profilePoints(List<ProfilePoint> C::*points) {
+    return records(points, { "M", "D", "C" },
+      set(&ProfilePoint::type, {
+        ProfilePoint::Type::move,
+        ProfilePoint::Type::disjoint,
+        ProfilePoint::Type::connected
+      }),
+      point(&ProfilePoint::position),
+      option("uv",
+        real(&ProfilePoint::uv0)),
+      option("normal",
+        vector(&ProfilePoint::normal0)),
+      option("normal",
+        vector(&ProfilePoint::normal1))
+    );
+  }
+
+
+
+  /// Parse a markup file with a schema.
+  /// \param[in] path
+  ///   The path to the markup file.
+  /// \param[out] item
+  ///   The item to parse into.
+  /// \param[in] schema
+  ///   The schema of the file.
+  /// \returns
+  ///   Whether or not the file was parsed successfully.
+  template<typename T, typename... Sections>
+  bool parse(const String &path, T &item, const Document<Sections...> &schema);
+
+  /// Parse the contents of a markup file already in memory with a schema.
+  /// \param[in] path
+  ///   The path to the markup file, for errors.
+  /// \param[in] contents
+  ///   The contents of the file.
+  /// \param[in] length
+  ///   The length of the contents of the file.
+  /// \param[out] item
+  ///   The item to parse into.
+  /// \param[in] schema
+  ///   The schema of the file.
+  /// \returns
+  ///   Whether or not the file was parsed successfully.
+  template<typename T, typename... Sections>
+  bool parse(
+    const String &path, const char *contents, size_t length,
+    T &item, const Document<Sections...> &schema
+  );
+
+}
+
+NS_CITY_BUILDER_END
+
+#include "MarkupSchema.ipp"
@@ -0,0 +1,573 @@
+/**
+ * @file MarkupSchema.ipp
+ * @brief Implementation of the markup schema parser.
+ * @date May 8, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include "MarkupSchema.h"
+#include <cstring>
+
+NS_CITY_BUILDER_BEGIN
+
+/* -------------------------------------------------------------------------- *\
+|                                                                              |
+| Keyword tables                                                               |
+|                                                                              |
+\* -------------------------------------------------------------------------- */
+
+template<size_t N>
+constexpr void Schema::Keywords<N>::build() {
+  // Reject duplicate names, which no seed can separate
+  for (size_t i = 0; i < N; i++) {
+    lengths[i] = Internal::Schema::length(names[i]);
+    for (size_t j = 0; j < i; j++)
+      if (lengths[i] == lengths[j] &&
+          Internal::Schema::equal(names[i], names[j], lengths[i]))
+        // Duplicate name
+        throw nullptr;
+  }
+
+  // Try seeds until every name has its own slot
+  for (seed = 0; seed < 65536; seed++) {
+    for (size_t i = 0; i < slots; i++)
+      table[i] = 0;
+
+    bool collision = false;
+    for (size_t i = 0; i < N && !collision; i++) {
+      size_t slot = Internal::Schema::hash(names[i], lengths[i], seed) & (slots - 1);
+      if (table[slot] != 0)
+        collision = true;
+      else
+        table[slot] = (uint8_t)(i + 1);
+    }
+
+    if (!collision)
+      return;
+  }
+
+  // No perfect hash found
+  throw nullptr;
+}
+
+template<size_t N>
+int Schema::Keywords<N>::find(const char *text, size_t length) const {
+  // Every name is in its own slot, so there is only one place to look
+  int index = (int)table[Internal::Schema::hash(text, length, seed) & (slots - 1)] - 1;
+  if (index < 0 || lengths[index] != length || memcmp(names[index], text, length) != 0)
+    return -1;
+  return index;
+}
+
+
+
+template<typename V, size_t N>
+template<size_t... I>
+constexpr Schema::Table<V, N>::Table(const Keyword<V> (&values)[N], std::index_sequence<I...>)
+  : values { values[I]... } {
+  for (size_t i = 0; i < N; i++)
+    keywords.names[i] = values[i].name;
+  keywords.build();
+}
+
+template<typename V, size_t N>
+const V *Schema::Table<V, N>::find(const Internal::Schema::Token &token) const {
+  int index = keywords.find(token.text, token.length);
+  return index < 0 ? nullptr : &values[index].value;
+}
+
+
+
+
+
+/* -------------------------------------------------------------------------- *\
+|                                                                              |
+| Record values                                                                |
+|                                                                              |
+\* -------------------------------------------------------------------------- */
+
+namespace Internal { namespace Schema {
+
+  /// Parse each value of a record in turn.
+  template<typename Tuple, typename U, size_t... I>
+  bool parseAll(const Tuple &matchers, Cursor &cursor, U &value, std::index_sequence<I...>) {
+    return (std::get<I>(matchers).parse(cursor, value) && ...);
+  }
+
+  /// Whether or not a token is a specific identifier.
+  inline bool isIdentifier(const Token &token, const char *name, size_t length) {
+    return token.type == Token::Type::identifier && token.length == length &&
+      memcmp(token.text, name, length) == 0;
+  }
+
+  /// Assign a matched value to a member.
+  template<typename V>
+  void assign(V &member, V &value) {
+    member = value;
+  }
+
+  /// Assign a pointer to a matched value to a member.
+  template<typename V>
+  void assign(V *&member, V &value) {
+    member = &value;
+  }
+
+}}
+
+
+
+template<typename C, typename V, size_t N>
+template<typename U>
+bool Schema::Set<C, V, N>::parse(Internal::Schema::Cursor &cursor, U &value) const {
+  value.*member = values[cursor.selection];
+  return true;
+}
+
+template<typename C>
+template<typename U>
+bool Schema::Integer<C>::parse(Internal::Schema::Cursor &cursor, U &value) const {
+  typedef Internal::Schema::Token Token;
+
+  // Check for a (positive) integer
+  if (cursor.token == cursor.end) {
+    Internal::Schema::unexpected(cursor, "an integer");
+    return false;
+  }
+  const Token &token = *cursor.token;
+  int integer;
+  if (token.type != Token::Type::number || memchr(token.text, '.', token.length) != nullptr) {
+    Internal::Schema::error(cursor, token, "Expected an integer.");
+    return false;
+  } else if (!Internal::Schema::parseInteger(token, integer)) {
+    Internal::Schema::error(cursor, token, "Unable to parse an integer.");
+    return false;
+  }
+
+  // Set the value
+  value.*member = integer;
+  cursor.token++;
+  return true;
+}
+
+template<typename C>
+template<typename U>
+bool Schema::Number<C>::parse(Internal::Schema::Cursor &cursor, U &value) const {
+  typedef Internal::Schema::Token Token;
+
+  // Check for a real number
+  if (cursor.token == cursor.end) {
+    Internal::Schema::unexpected(cursor, "a real number");
+    return false;
+  }
+  const Token &token = *cursor.token;
+  float real;
+  if (token.type != Token::Type::number) {
+    Internal::Schema::error(cursor, token, "Expected a real number.");
+    return false;
+  } else if (!Internal::Schema::parseReal(token, real)) {
+    Internal::Schema::error(cursor, token, "Unable to parse a real number.");
+    return false;
+  }
+
+  // Set the value
+  value.*member = Real(real);
+  cursor.token++;
+  return true;
+}
+
+template<typename C>
+template<typename U>
+bool Schema::Point<C>::parse(Internal::Schema::Cursor &cursor, U &value) const {
+  typedef Internal::Schema::Token Token;
+
+  // A point is a non-negative pair of numbers
+  if (cursor.end - cursor.token < 3) {
+    Internal::Schema::unexpected(cursor, "a point");
+    return false;
+  }
+  const Token &xToken = cursor.token[0];
+  const Token &comma  = cursor.token[1];
+  const Token &yToken = cursor.token[2];
+  float x, y;
+  if (xToken.type != Token::Type::number) {
+    Internal::Schema::error(cursor, xToken, "Expected a real number for the x-coordinate.");
+    return false;
+  } else if (!Internal::Schema::parseReal(xToken, x)) {
+    Internal::Schema::error(cursor, xToken, "Unable to parse a real number.");
+    return false;
+  } else if (comma.type != Token::Type::comma) {
+    Internal::Schema::error(cursor, comma, "Expected a comma.");
+    return false;
+  } else if (yToken.type != Token::Type::number) {
+    Internal::Schema::error(cursor, yToken, "Expected a real number for the y-coordinate.");
+    return false;
+  } else if (!Internal::Schema::parseReal(yToken, y)) {
+    Internal::Schema::error(cursor, yToken, "Unable to parse a real number.");
+    return false;
+  }
+
+  // Set the value
+  value.*member = { Real(x), Real(y) };
+  cursor.token += 3;
+  return true;
+}
+
+template<typename C>
+template<typename U>
+bool Schema::Vector<C>::parse(Internal::Schema::Cursor &cursor, U &value) const {
+  typedef Internal::Schema::Token Token;
+
+  // A vector is a pair of numbers with possible negative values
+  if (cursor.end - cursor.token < 3) {
+    Internal::Schema::unexpected(cursor, "a vector");
+    return false;
+  }
+
+  const Token *token = cursor.token;
+  bool xNegative = false, yNegative = false;
+  if (Internal::Schema::isIdentifier(*token, "-", 1)) {
+    // Leading negative
+    xNegative = true;
+    token++;
+  }
+  if (cursor.end - token < 3) {
+    Internal::Schema::unexpected(cursor, "a vector");
+    return false;
+  }
+  const Token &xToken = token[0];
+  const Token &comma  = token[1];
+  token += 2;
+  if (Internal::Schema::isIdentifier(*token, "-", 1)) {
+    // Leading negative
+    yNegative = true;
+    token++;
+    if (token == cursor.end) {
+      Internal::Schema::unexpected(cursor, "a vector");
+      return false;
+    }
+  }
+  const Token &yToken = *token++;
+
+  float x, y;
+  if (xToken.type != Token::Type::number) {
+    Internal::Schema::error(cursor, xToken, "Expected a real number for the x-coordinate.");
+    return false;
+  } else if (!Internal::Schema::parseReal(xToken, x)) {
+    Internal::Schema::error(cursor, xToken, "Unable to parse a real number.");
+    return false;
+  } else if (comma.type != Token::Type::comma) {
+    Internal::Schema::error(cursor, comma, "Expected a comma.");
+    return false;
+  } else if (yToken.type != Token::Type::number) {
+    Internal::Schema::error(cursor, yToken, "Expected a real number for the y-coordinate.");
+    return false;
+  } else if (!Internal::Schema::parseReal(yToken, y)) {
+    Internal::Schema::error(cursor, yToken, "Unable to parse a real number.");
+    return false;
+  }
+
+  // Set the value
+  value.*member = { Real(xNegative ? -x : x), Real(yNegative ? -y : y) };
+  cursor.token = token;
+  return true;
+}
+
+template<typename U>
+bool Schema::Identifier::parse(Internal::Schema::Cursor &cursor, U &) const {
+  // Match the exact identifier
+  if (cursor.token == cursor.end) {
+    Internal::Schema::unexpected(cursor, "'", name);
+    return false;
+  }
+  const Internal::Schema::Token &token = *cursor.token;
+  if (!Internal::Schema::isIdentifier(token, name, length)) {
+    Internal::Schema::error(cursor, token, "Expected '", name, length, "'.");
+    return false;
+  }
+  cursor.token++;
+  return true;
+}
+
+template<typename U>
+bool Schema::Comma::parse(Internal::Schema::Cursor &cursor, U &) const {
+  // Match a single comma
+  if (cursor.token == cursor.end) {
+    Internal::Schema::unexpected(cursor, "','");
+    return false;
+  }
+  const Internal::Schema::Token &token = *cursor.token;
+  if (token.type != Internal::Schema::Token::Type::comma) {
+    Internal::Schema::error(cursor, token, "Expected ','.");
+    return false;
+  }
+  cursor.token++;
+  return true;
+}
+
+template<typename C, typename V, size_t N, bool strings>
+template<typename U>
+bool Schema::Match<C, V, N, strings>::parse(Internal::Schema::Cursor &cursor, U &value) const {
+  typedef Internal::Schema::Token Token;
+
+  // Match one of the provided identifiers or strings
+  if (cursor.token == cursor.end) {
+    Internal::Schema::unexpected(cursor, strings ? "a string" : "an identifier");
+    return false;
+  }
+  const Token &token = *cursor.token;
+  if (token.type != (strings ? Token::Type::string : Token::Type::identifier)) {
+    Internal::Schema::error(cursor, token, strings ? "Expected a string." : "Expected an identifier.");
+    return false;
+  }
+  const V *result = table.find(token);
+  if (result == nullptr) {
+    Internal::Schema::error(cursor, token, "Unknown value '", token.text, token.length, "'.");
+    return false;
+  }
+
+  // Set the value
+  value.*member = *result;
+  cursor.token++;
+  return true;
+}
+
+template<typename C, typename M, typename V, bool strings>
+template<typename U>
+bool Schema::MatchMap<C, M, V, strings>::parse(Internal::Schema::Cursor &cursor, U &value) const {
+  typedef Internal::Schema::Token Token;
+
+  // Match one of the values of the map
+  if (cursor.token == cursor.end) {
+    Internal::Schema::unexpected(cursor, strings ? "a string" : "an identifier");
+    return false;
+  }
+  const Token &token = *cursor.token;
+  if (token.type != (strings ? Token::Type::string : Token::Type::identifier)) {
+    Internal::Schema::error(cursor, token, strings ? "Expected a string." : "Expected an identifier.");
+    return false;
+  }
+  Optional<V &> result = values->get(String(token.text, token.length));
+  if (!result) {
+    Internal::Schema::error(cursor, token, "Unknown value '", token.text, token.length, "'.");
+    return false;
+  }
+
+  // Set the value
+  Internal::Schema::assign(value.*member, *result);
+  cursor.token++;
+  return true;
+}
+
+template<typename... Matchers>
+template<typename U>
+bool Schema::Option<Matchers...>::parse(Internal::Schema::Cursor &cursor, U &value) const {
+  if (cursor.token == cursor.end ||
+      !Internal::Schema::isIdentifier(*cursor.token, name, length))
+    // Not a required option
+    return true;
+
+  // Match the options
+  cursor.token++;
+  return Internal::Schema::parseAll(
+    matchers, cursor, value, std::index_sequence_for<Matchers...>());
+}
+
+
+
+
+
+/* -------------------------------------------------------------------------- *\
+|                                                                              |
+| Section entries                                                              |
+|                                                                              |
+\* -------------------------------------------------------------------------- */
+
+template<typename C>
+template<typename T>
+bool Schema::Field<C>::parse(const Internal::Schema::Entry &entry, T &item, int) const {
+  // A field can only be a string
+  if (entry.end - entry.begin != 1 ||
+      entry.begin->type != Internal::Schema::Token::Type::string) {
+    Internal::Schema::error(entry.path, entry.name->line, "Expected a single string as input.");
+    return false;
+  }
+
+  // Set the value
+  item.*member = String(entry.begin->text, entry.begin->length);
+  return true;
+}
+
+template<typename C, typename V, size_t N>
+template<typename T>
+bool Schema::Choice<C, V, N>::parse(const Internal::Schema::Entry &entry, T &item, int) const {
+  if (entry.end - entry.begin != 1 ||
+      entry.begin->type != Internal::Schema::Token::Type::identifier) {
+    Internal::Schema::error(entry.path, entry.name->line, "Expected a single identifier as input.");
+    return false;
+  }
+
+  // Set the value
+  const V *result = table.find(*entry.begin);
+  if (result == nullptr) {
+    Internal::Schema::error(entry.path, entry.name->line, "Unknown value '", entry.begin, "'.");
+    return false;
+  }
+  item.*member = *result;
+  return true;
+}
+
+template<typename C, typename U, size_t N, typename... Matchers>
+template<typename T>
+bool Schema::Records<C, U, N, Matchers...>::parse(const Internal::Schema::Entry &entry, T &item, int selection) const {
+  U value { };
+  Internal::Schema::Cursor cursor { entry.path, entry.begin, entry.end, entry.name->line, selection };
+
+  // Parse the content
+  if (!Internal::Schema::parseAll(matchers, cursor, value, std::index_sequence_for<Matchers...>()))
+    return false;
+
+  if (cursor.token != cursor.end) {
+    // Not all tokens were consumed
+    Internal::Schema::unused(cursor);
+    return false;
+  }
+
+  // Save the result
+  (item.*list).append(value);
+  return true;
+}
+
+
+
+
+
+/* -------------------------------------------------------------------------- *\
+|                                                                              |
+| Sections and documents                                                       |
+|                                                                              |
+\* -------------------------------------------------------------------------- */
+
+template<typename... Items>
+constexpr Schema::Section<Items...>::Section(const char *name, const Items &...items)
+  : name(name), items(items...) {
+  size_t index = 0;
+  uint8_t owner = 0;
+  (_add(items, owner++, index), ...);
+  keywords.build();
+}
+
+template<typename... Items>
+template<typename Item>
+constexpr void Schema::Section<Items...>::_add(const Item &item, uint8_t owner, size_t &index) {
+  for (size_t i = 0; i < Item::keywords; i++) {
+    keywords.names[index] = item.keyword(i);
+    owners[index] = owner;
+    selections[index] = (uint8_t)i;
+    index++;
+  }
+}
+
+template<typename... Items>
+template<typename T>
+bool Schema::Section<Items...>::parse(const Internal::Schema::Entry &entry, T &item) const {
+  int keyword = keywords.find(entry.name->text, entry.name->length);
+  if (keyword < 0) {
+    // Nothing matched
+    Internal::Schema::error(entry.path, entry.name->line, "Unknown field '", entry.name, "'.");
+    return false;
+  }
+  return _parse(std::index_sequence_for<Items...>(), owners[keyword], entry, item, selections[keyword]);
+}
+
+template<typename... Items>
+template<typename T, size_t... I>
+bool Schema::Section<Items...>::_parse(
+  std::index_sequence<I...>, size_t owner,
+  const Internal::Schema::Entry &entry, T &item, int selection
+) const {
+  bool success = false;
+  ((I == owner && (success = std::get<I>(items).parse(entry, item, selection), true)) || ...);
+  return success;
+}
+
+
+
+template<typename... Sections>
+constexpr Schema::Document<Sections...>::Document(const Sections &...sections)
+  : sections(sections...) {
+  size_t index = 0;
+  ((names.names[index++] = sections.name), ...);
+  names.build();
+}
+
+template<typename... Sections>
+template<typename T>
+bool Schema::Document<Sections...>::parse(const Internal::Schema::File &file, T &item) const {
+  typedef Internal::Schema::Token Token;
+  typedef Internal::Schema::Entry Entry;
+
+  struct Visitor : Internal::Schema::Visitor {
+    const Document &schema;
+    const char *path;
+    T &item;
+    bool success = true;
+    int current = -1;
+
+    Visitor(const Document &schema, const char *path, T &item)
+      : schema(schema), path(path), item(item) { }
+
+    void section(const Token &token) override {
+      // Find the section
+      current = schema.names.find(token.text, token.length);
+      if (current < 0) {
+        Internal::Schema::error(path, token.line, "Unknown section '", &token, "'.");
+        success = false;
+      }
+    }
+
+    void entry(const Entry &entry) override {
+      // Parse the entry, unless it is in an unknown section
+      if (current >= 0)
+        success &= schema._parse(std::index_sequence_for<Sections...>(), current, entry, item);
+    }
+  };
+
+  Visitor visitor(*this, file.path, item);
+  file.visit(visitor);
+  return visitor.success;
+}
+
+template<typename... Sections>
+template<typename T, size_t... I>
+bool Schema::Document<Sections...>::_parse(
+  std::index_sequence<I...>, size_t section,
+  const Internal::Schema::Entry &entry, T &item
+) const {
+  bool success = false;
+  ((I == section && (success = std::get<I>(sections).parse(entry, item), true)) || ...);
+  return success;
+}
+
+
+
+template<typename T, typename... Sections>
+bool Schema::parse(const String &path, T &item, const Document<Sections...> &schema) {
+  Internal::Schema::File file((const char *)path);
+  if (!file.load())
+    return false;
+  return schema.parse(file, item);
+}
+
+template<typename T, typename... Sections>
+bool Schema::parse(
+  const String &path, const char *contents, size_t length,
+  T &item, const Document<Sections...> &schema
+) {
+  Internal::Schema::File file((const char *)path);
+  if (!file.load(contents, length))
+    return false;
+  return schema.parse(file, item);
+}
+
+NS_CITY_BUILDER_END
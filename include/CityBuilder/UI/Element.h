@@ -130,7 +130,9 @@ public:
   Real2 getBounds();
 
   /// @brief Draws the element.
-  virtual void draw(Real2 offset = { 0, 0 });
+  /// @param encoder the encoder to record the draw calls with
+  /// @param offset
+  virtual void draw(bgfx::Encoder *encoder, Real2 offset = { 0, 0 });
 
 private:
   // The representative node of this element.
@@ -62,8 +62,9 @@ public:
   virtual void setMesh(Real2 offset) = 0;
 
   /// @brief Draw the mesh.
+  /// @param encoder the encoder to record the draw call with
   /// @param offset 
-  virtual void drawMesh(Real2 offset);
+  virtual void drawMesh(bgfx::Encoder *encoder, Real2 offset);
 
 protected:
   bool _isDirty;
@@ -19,22 +19,32 @@ namespace UI {
 class System {
 public:
   /// @brief Add a texture to the UI system.
+  /// \remarks
+  ///   Square RGBA8 textures without mip-maps are packed into the atlas,
+  ///   anything else is loaded on its own.
   /// @param name texture key
   /// @param path 
-  /// @param size 
-  /// @param mipMaps 
-  static void addTexture(const String& name, const String& path, int size, bool mipMaps = false);
+  static void addTexture(const String& name, const String& path);
 
   /// @brief Gets the texture from a texture key
   /// @param name 
   /// @return texture
   static Resource<Texture>& getTexture(const String& name);
 
+  /// @brief Gets the region of its texture that a texture key occupies
+  /// \remarks
+  ///   UI textures are packed into a single atlas, so texture coordinates
+  ///   must be mapped into this region.
+  /// @param name texture key
+  /// @return region as (left, top, width, height) in texture coordinates
+  static Real4 getTextureRegion(const String& name);
+
   /// @brief Sends a texture to the GPU
+  /// @param encoder the encoder to record the texture with
   /// @param name texture key
-  static void loadTexture(const String& name);
+  static void loadTexture(bgfx::Encoder *encoder, const String& name);
 
-  /// @brief Sets up the UI program and texture atlas
+  /// @brief Sets up the UI program and packs the texture atlas
   static void start();
 
   /// @brief Fires on window resize to resize the UI
@@ -46,9 +56,14 @@ public:
   /// @param offset
   static void drawNode(Ref<Node &> root, Real2 offset = { 0, 0 });
 
-  /// @brief Sets up the UI projection and draws all the nodes
+  /// @brief Sets up the UI projection and view
   /// @param screen 
-  static void draw(const Real2& screen);
+  /// @remarks Must be called from the main thread, before `draw`
+  static void setView(const Real2& screen);
+
+  /// @brief Draws all the nodes
+  /// @param encoder the encoder to record the draw calls with
+  static void draw(bgfx::Encoder *encoder);
 };
 
 }
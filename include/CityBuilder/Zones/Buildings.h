@@ -0,0 +1,325 @@
+/**
+ * @file Buildings.h
+ * @brief The buildings that grow on the lots of zoned roads.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include "Parcels.h"
+#include "ZoneDef.h"
+
+NS_CITY_BUILDER_BEGIN
+
+struct Economy;
+
+/// The buildings that grow on the lots of zoned roads.
+/// \remarks
+///   Each buildable lot of `Parcels` can hold one building, kept in the slot
+///   of the same index, so a building lasts as long as its lot is unchanged.
+///   Buildings grow on vacant lots while the `Economy` has demand for their
+///   zone: residential capacity is in residents and commercial and
+///   industrial capacity in jobs.
+///   Every building is a rectangle set back from the front of its lot and
+///   clear of its sides, taking one of a few archetypes by the use of its
+///   zone and the size of its lot, with a number of floors and a color.
+///   Growth is amortized: each `grow` builds only as many buildings as the
+///   demand allows for the time elapsed, and stops once it has used its time
+///   budget, leaving the rest for the next frame.
+///   When a lot changes, its building is kept as long as it still fits, and
+///   is demolished otherwise, leaving the lot to grow again.
+struct Buildings {
+  /// The shapes that buildings take.
+  enum class Archetype : uint8_t {
+    /// A house with a gabled roof.
+    house,
+    /// An L-shaped block of apartments.
+    apartments,
+    /// A shop with an awning over its front.
+    shop,
+    /// An office tower on a podium.
+    tower,
+    /// A shed with a sawtooth roof.
+    shed,
+    /// A U-shaped factory with a chimney.
+    factory
+  };
+
+  /// The number of archetypes.
+  static constexpr int archetypes = 6;
+
+  /// The placement of a building as it is drawn, in the layout of the
+  /// `building` vertex shaders (`i_data0`, `i_data1`).
+  struct Instance {
+    /// The center of the building on the ground, in meters.
+    float x, z;
+
+    /// The direction of the building's width, along the front of its lot,
+    /// as a unit vector; its depth runs away from the road to the left of
+    /// it.
+    float cos, sin;
+
+    /// The size of the building, in meters.
+    float width, depth, height;
+
+    /// The color of the building's walls, as 8-bit red, green and blue
+    /// channels in the integer part (`r * 65536 + g * 256 + b`).
+    float color;
+  };
+
+  /// A building on a lot.
+  struct Building {
+    /// The zone of the building, or `nullptr` if the lot is vacant.
+    ZoneDef *zone;
+
+    /// The shape of the building.
+    Archetype archetype;
+
+    /// The number of floors of the building.
+    uint8_t floors;
+
+    /// The residents or jobs that the building holds.
+    float capacity;
+
+    /// The placement of the building.
+    Instance instance;
+  };
+
+  /// The buildings of a zone.
+  struct Zone {
+    /// The zone.
+    ZoneDef *zone;
+
+    /// The lots of the zone that may be vacant, in no order.
+    List<uint32_t> vacant { };
+
+    /// The residents or jobs of the zone's buildings.
+    float capacity = 0;
+
+    /// The buildings that the zone may still grow, carried over between
+    /// calls.
+    float allowance = 0;
+  };
+
+  /// The cost of growing the buildings since the last `resetStats`.
+  struct Stats {
+    /// The number of calls to `grow`.
+    size_t ticks = 0;
+
+    /// The number of buildings built.
+    size_t built = 0;
+
+    /// The number of buildings demolished.
+    size_t demolished = 0;
+
+    /// The number of lots checked after changing.
+    size_t checked = 0;
+
+    /// The time spent growing, in microseconds.
+    double time = 0;
+
+    /// The longest call to `grow`, in microseconds.
+    double longest = 0;
+  };
+
+  /// How far buildings are set back from the front of their lot, in meters.
+  static constexpr float frontSetback = 3;
+
+  /// How far buildings are kept from the sides of their lot, in meters.
+  static constexpr float sideSetback = 1;
+
+  /// How far buildings are kept from the back of their lot, in meters.
+  static constexpr float rearSetback = 2;
+
+  /// The narrowest and shallowest that a building may be, in meters.
+  static constexpr float minimumSize = 5;
+
+  /// The buildings that each zone grows every second at full demand.
+  static constexpr float growthRate = 20;
+
+
+
+  Buildings() { }
+
+  // Prevent building transfer.
+  Buildings(const Buildings &other) = delete;
+
+
+
+  /// Catch up with the changes to the lots, and grow buildings on vacant
+  /// lots for the time elapsed.
+  /// \param[in] parcels
+  ///   The lots to build on.
+  /// \param[in] economy
+  ///   The demand for every zone.
+  /// \param[in] elapsed
+  ///   The time simulated since the last call, in seconds.
+  /// \param[in] budget
+  ///   The time that may be spent, in microseconds.
+  /// \returns
+  ///   Whether any buildings changed.
+  /// \remarks
+  ///   The lots that changed are checked before any growth, a budget at a
+  ///   time. If the parcels were updated more than once since the last call,
+  ///   every lot is checked instead.
+  bool grow(const Parcels &parcels, const Economy &economy, Real elapsed, double budget);
+
+  /// The capacity of the buildings of a zone.
+  /// \param[in] zone
+  ///   The zone.
+  /// \returns
+  ///   The residents or jobs of the buildings.
+  float capacity(const ZoneDef *zone) const;
+
+  /// The capacity of the buildings of every zone with a use.
+  /// \param[in] use
+  ///   The use of the zones.
+  /// \returns
+  ///   The residents or jobs of the buildings.
+  float capacity(ZoneDef::Use use) const {
+    return _useCapacity[(int)use];
+  }
+
+
+
+  /// The building of every lot slot, vacant or not.
+  const List<Building> &buildings() const {
+    return _buildings;
+  }
+
+  /// The buildings of every zone built on.
+  const List<Zone> &zones() const {
+    return _zones;
+  }
+
+  /// The number of buildings standing.
+  size_t count() const {
+    return _count;
+  }
+
+  /// The lots that changed and have yet to be checked.
+  size_t unchecked() const {
+    return _unchecked.count() - _nextUnchecked;
+  }
+
+  /// The lots whose buildings were built or demolished by the last `grow`
+  /// that changed anything, sorted.
+  const List<uint32_t> &changed() const {
+    return _changed;
+  }
+
+  /// A number that changes whenever the buildings change.
+  uint64_t version() const {
+    return _version;
+  }
+
+
+
+  /// The cost of growing the buildings since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the cost of growing the buildings so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+private:
+  /// The space on a lot that a building may take.
+  struct _footprint {
+    /// The center of the space.
+    Real2 center;
+
+    /// The direction of the front of the lot, with the lot to its left.
+    Real2 axis;
+
+    /// The width of the space along the front of the lot.
+    float width;
+
+    /// The depth of the space back from the front of the lot.
+    float depth;
+  };
+
+  /// Find the space on a lot that a building may take.
+  /// \param[in] lot
+  ///   The lot to build on.
+  /// \param[out] footprint
+  ///   The space found.
+  /// \returns
+  ///   Whether a building fits on the lot at all.
+  static bool _fit(const Parcels::Lot &lot, _footprint &footprint);
+
+  /// Check the building of a lot that changed, and queue the lot to grow if
+  /// it is vacant.
+  /// \param[in] parcels
+  ///   The lots.
+  /// \param[in] lot
+  ///   The lot that changed.
+  void _check(const Parcels &parcels, uint32_t lot);
+
+  /// Build on a vacant lot.
+  /// \param[in] lot
+  ///   The lot to build on.
+  /// \param[in] zone
+  ///   The zone of the lot.
+  /// \param[in] footprint
+  ///   The space the building may take.
+  /// \param[in] demand
+  ///   The demand for the zone.
+  void _build(uint32_t lot, Zone &zone, const _footprint &footprint, float demand);
+
+  /// Demolish the building of a lot.
+  /// \param[in] lot
+  ///   The lot to clear.
+  void _demolish(uint32_t lot);
+
+  /// The buildings of a zone, added if it has none yet.
+  Zone &_zoneOf(ZoneDef *zone);
+
+  /// A random number from 0 to 1.
+  float _random();
+
+  /// The building of every lot slot.
+  List<Building> _buildings { };
+
+  /// Whether every lot slot is in the vacant lots of its zone.
+  List<uint8_t> _queued { };
+
+  /// The buildings of every zone built on.
+  List<Zone> _zones { };
+
+  /// The residents or jobs of every use.
+  float _useCapacity[3] = { 0, 0, 0 };
+
+  /// The number of buildings standing.
+  size_t _count = 0;
+
+  /// The version of the lots last caught up with.
+  uint64_t _parcelsVersion = 0;
+
+  /// The lots that changed and have yet to be checked, in order.
+  List<uint32_t> _unchecked { };
+
+  /// The first lot of `_unchecked` not yet checked.
+  size_t _nextUnchecked = 0;
+
+  /// The lots whose buildings changed in the last `grow` that changed any.
+  List<uint32_t> _changed { };
+
+  /// The lots whose buildings have changed in the current `grow`.
+  List<uint32_t> _changing { };
+
+  /// A number that changes whenever the buildings change.
+  uint64_t _version = 0;
+
+  /// The state of the random number generator.
+  uint32_t _seed = 1;
+
+  /// The cost of growing the buildings since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
@@ -0,0 +1,254 @@
+/**
+ * @file Parcels.h
+ * @brief The building lots of the zoned sides of roads.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#pragma once
+#include <CityBuilder/Common.h>
+#include <CityBuilder/Storage/List.h>
+#include <CityBuilder/Geometry/SpatialGrid.h>
+#include <CityBuilder/Roads/Road.h>
+#include <CityBuilder/Roads/Intersection.h>
+
+NS_CITY_BUILDER_BEGIN
+
+/// The building lots of the zoned sides of roads.
+/// \remarks
+///   Every zoned side of a road is subdivided into lots along its arc length,
+///   each reaching back `lotDepth` meters from the edge of the road. The lots
+///   are then clipped so that they never reach into another road or
+///   intersection, nor further from their own road than from another (so the
+///   lots of neighbouring roads meet without overlapping at corners), and so
+///   that their sides do not cross on the inside of curves. The neighbouring
+///   roads are found through a `SpatialGrid` of roads.
+///   Lots are kept in slots that are reused once freed, so the index of a lot
+///   never changes while it exists, and the lots are kept as stable as
+///   possible across edits:
+///   - Changing the zone of a side only changes the zone of its lots.
+///   - When a road is split, the lots clear of the splits are handed to the
+///     new roads as they are, and only the spans around the splits are
+///     subdivided again.
+///   - When a road is pushed back by an intersection, its lots are kept in
+///     place and only those pushed off its end are freed.
+///   - Building or removing a road only clips the lots near it again.
+struct Parcels {
+  /// A building lot along the side of a road.
+  struct Lot {
+    /// The road that the lot faces, or `nullptr` if the lot is unused.
+    Road *road;
+
+    /// The zone of the lot.
+    ZoneDef *zone;
+
+    /// Whether the lot is on the right side of its road.
+    bool right;
+
+    /// The distance along the road that the lot starts at, in meters.
+    float start;
+
+    /// The distance along the road that the lot ends at, in meters.
+    float end;
+
+    /// How far the lot reaches back from the road at its start and end, in
+    /// meters, once clipped.
+    float depth[2];
+
+    /// The corners of the lot: the front and back at its start, then the
+    /// back and front at its end.
+    Real2 corners[4];
+
+    /// The area that the lot could reach were it not clipped, by which it is
+    /// kept in the grid of lots.
+    Bounds2 extent;
+
+    /// Whether the lot is deep enough to build on, on average, as corner lots
+    /// taper off towards the road they meet.
+    bool buildable() const {
+      return road != nullptr && (depth[0] + depth[1]) * 0.5f >= minimumDepth;
+    }
+  };
+
+  /// The cost of keeping the lots since the last `resetStats`.
+  struct Stats {
+    /// The number of updates that changed anything.
+    size_t updates = 0;
+
+    /// The number of lots subdivided.
+    size_t placed = 0;
+
+    /// The number of lots clipped, including those just subdivided.
+    size_t clipped = 0;
+
+    /// The number of lots freed.
+    size_t freed = 0;
+
+    /// The time spent updating, in microseconds.
+    double time = 0;
+  };
+
+  /// The frontage that lots are subdivided to, in meters.
+  static constexpr float targetFrontage = 12;
+
+  /// The least frontage that a lot may have, in meters.
+  static constexpr float minimumFrontage = 8;
+
+  /// How far lots reach back from the edge of their road, in meters.
+  static constexpr float lotDepth = 24;
+
+  /// How far back a lot must reach on average to be built on, in meters.
+  static constexpr float minimumDepth = 6;
+
+  /// The width of the cells of the grids of roads and lots, in meters.
+  static constexpr float cellSize = 64;
+
+
+
+  Parcels() { }
+
+  // Prevent parcel transfer.
+  Parcels(const Parcels &other) = delete;
+
+
+
+  /// Subdivide the sides of a road again, as they have been built, zoned or
+  /// reshaped, at the next `update`.
+  /// \param[in] road
+  ///   The road to subdivide.
+  void invalidate(Road *road);
+
+  /// Hand the lots of a road over to the roads that it is being split into.
+  /// \param[in] road
+  ///   The road being split, which should be removed afterwards.
+  /// \param[in] pieces
+  ///   The roads that replace it, in order from its start to its end, whose
+  ///   paths should follow its own.
+  /// \remarks
+  ///   The lots that straddle a split stay with the road, and are freed when
+  ///   it is removed.
+  void split(Road *road, const List<Road *> &pieces);
+
+  /// Free the lots of a road as it is removed.
+  /// \param[in] road
+  ///   The road being removed.
+  void remove(Road *road);
+
+  /// Subdivide the roads invalidated since the last update, and clip the lots
+  /// near them again.
+  /// \returns
+  ///   Whether any lots changed.
+  bool update();
+
+
+
+  /// Every lot slot, including those unused.
+  const List<Lot> &lots() const {
+    return _lots;
+  }
+
+  /// The number of lots in use.
+  size_t count() const {
+    return _lots.count() - _free.count();
+  }
+
+  /// The lots that changed or were freed by the last `update` that changed
+  /// anything, or since the one before it, sorted.
+  const List<uint32_t> &changed() const {
+    return _changed;
+  }
+
+  /// Find the lots that could reach into a region.
+  /// \param[in] bounds
+  ///   The region to search.
+  /// \param[out] lots
+  ///   The list to append the lots found to.
+  void query(const Bounds2 &bounds, List<uint32_t> &lots) const {
+    _lotGrid.query(bounds, lots);
+  }
+
+  /// A number that changes whenever the lots change.
+  uint64_t version() const {
+    return _version;
+  }
+
+
+
+  /// The cost of keeping the lots since the last `resetStats`.
+  const Stats &stats() const {
+    return _stats;
+  }
+
+  /// Forget the cost of keeping the lots so far.
+  void resetStats() {
+    _stats = { };
+  }
+
+private:
+  /// Move a road's lots along with any change to its path, and subdivide the
+  /// spans of its sides that have no lots.
+  /// \param[in] road
+  ///   The road to subdivide.
+  void _subdivide(Road *road);
+
+  /// Subdivide a span of one side of a road into new lots.
+  /// \param[in] road
+  ///   The road to subdivide.
+  /// \param[in] right
+  ///   Whether to subdivide the right side.
+  /// \param[in] start
+  ///   The distance along the road that the span starts at.
+  /// \param[in] end
+  ///   The distance along the road that the span ends at.
+  void _fill(Road *road, bool right, float start, float end);
+
+  /// Clip a lot against the roads and intersections around it.
+  /// \param[in] lot
+  ///   The lot to clip.
+  void _clip(uint32_t lot);
+
+  /// Free a lot, leaving its road's list of lots to the caller.
+  /// \param[in] lot
+  ///   The lot to free.
+  void _release(uint32_t lot);
+
+  /// Place a lot in the grid of lots, and queue it to be clipped.
+  /// \param[in] lot
+  ///   The lot to place, whose road, side and span are set.
+  void _place(uint32_t lot);
+
+  /// Every lot slot.
+  List<Lot> _lots { };
+
+  /// The lot slots not in use.
+  List<uint32_t> _free { };
+
+  /// The roads to subdivide at the next update.
+  List<Road *> _queued { };
+
+  /// The regions whose lots should be clipped again at the next update.
+  List<Bounds2> _regions { };
+
+  /// The lots to clip at the next update.
+  List<uint32_t> _unclipped { };
+
+  /// The lots that changed or were freed during the last update.
+  List<uint32_t> _changed { };
+
+  /// The lots that have changed or been freed since the last update.
+  List<uint32_t> _changing { };
+
+  /// The roads, by their bounds.
+  SpatialGrid<Road *> _roadGrid { cellSize };
+
+  /// The lots, by their extents.
+  SpatialGrid<uint32_t> _lotGrid { cellSize };
+
+  /// A number that changes whenever the lots change.
+  uint64_t _version = 0;
+
+  /// The cost of keeping the lots since the last `resetStats`.
+  Stats _stats { };
+};
+
+NS_CITY_BUILDER_END
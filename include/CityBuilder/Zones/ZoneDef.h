@@ -9,6 +9,7 @@
 #include <CityBuilder/Common.h>
 #include <CityBuilder/Storage/String.h>
 #include <CityBuilder/Storage/Map.h>
+#include <CityBuilder/Storage/List.h>
 #include <CityBuilder/Geometry/Profile.h>
 #include <CityBuilder/Rendering/Resource.h>
 #include <CityBuilder/Rendering/Texture.h>
@@ -18,11 +19,54 @@ NS_CITY_BUILDER_BEGIN
 
 /// A building zone description.
 struct ZoneDef {
+  /// What the buildings of a zone are used for.
+  enum class Use {
+    /// Homes, whose capacity is in residents.
+    residential,
+    /// Shops and offices, whose capacity is in jobs.
+    commercial,
+    /// Sheds and factories, whose capacity is in jobs.
+    industrial
+  };
+  
+  /// A rule for how much building capacity a zone wants.
+  struct Demand {
+    /// What the capacity wanted follows.
+    enum class Source {
+      /// A fixed capacity, wanted however large the city is.
+      base,
+      /// The residents living in the city.
+      residential,
+      /// The jobs of every commercial zone.
+      commercial,
+      /// The jobs of every industrial zone.
+      industrial,
+      /// The frontage zoned for the zone itself, in meters.
+      frontage
+    };
+    
+    /// What the capacity wanted follows.
+    Source source;
+    
+    /// The capacity wanted, or wanted for every unit of the source.
+    Real weight;
+  };
+  
   /// The name of the zone.
   String name;
   
   Color3 color;
   
+  /// What the buildings of the zone are used for.
+  Use use = Use::residential;
+  
+  /// The rules for how much building capacity the zone wants, which are
+  /// summed.
+  /// \remarks
+  ///   Buildings only grow in the zone while it has less capacity than it
+  ///   wants (see `Economy`).
+  List<Demand> demand { };
+  
   
   
   /// A map of all of the loaded zones.
@@ -0,0 +1,32 @@
+$input a_position, a_normal, a_color0, i_data0, i_data1
+$output v_normal, v_color0
+
+#include "bgfx_shader.sh"
+#include "building.sh"
+
+void main() {
+  // The instance: center and direction across the front (i_data0), then
+  // width, depth, height and color (i_data1)
+  vec2 center = i_data0.xy;
+  vec2 across = i_data0.zw;
+  vec2 back = vec2(-across.y, across.x);
+  
+  // Turn the quad about the vertical to face the camera
+  vec3 eye = mul(u_invView, vec4(0.0, 0.0, 0.0, 1.0)).xyz;
+  vec2 toEye = eye.xz - center;
+  float range = length(toEye);
+  vec2 view = range > 0.001 ? toEye / range : -back;
+  vec2 side = vec2(view.y, -view.x);
+  
+  // Cover the outline of the building as seen from the camera
+  float width = abs(dot(across, side)) * i_data1.x + abs(dot(back, side)) * i_data1.y;
+  vec3 world = vec3(
+    center.x + side.x * a_position.x * width,
+    a_position.y * i_data1.z,
+    center.y + side.y * a_position.x * width);
+  gl_Position = mul(u_viewProj, vec4(world, 1.0));
+  
+  // Light the quad as the walls facing the camera, tipped up a little
+  v_normal = normalize(vec3(view.x, 0.3, view.y));
+  v_color0 = buildingColor(a_color0, i_data1.w);
+}
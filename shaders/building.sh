@@ -0,0 +1,16 @@
+// Placement of instanced buildings (see BuildingBatch.h)
+
+// Unpack the 8-bit red, green and blue channels of a building's color from
+// the integer part of a float (`r * 65536 + g * 256 + b`).
+vec3 unpackColor(float packed) {
+  float r = floor(packed / 65536.0);
+  float g = floor((packed - r * 65536.0) / 256.0);
+  float b = packed - r * 65536.0 - g * 256.0;
+  return vec3(r, g, b) / 255.0;
+}
+
+// The color of a vertex of a building: tinted by the building's color where
+// the vertex alpha is 1, or kept as it is where it is 0.
+vec4 buildingColor(vec4 vertex, float packed) {
+  return vec4(mix(vertex.rgb, vertex.rgb * unpackColor(packed), vertex.a), 1.0);
+}
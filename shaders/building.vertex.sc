@@ -0,0 +1,28 @@
+$input a_position, a_normal, a_color0, i_data0, i_data1
+$output v_normal, v_color0
+
+#include "bgfx_shader.sh"
+#include "building.sh"
+
+void main() {
+  // The instance: center and direction across the front (i_data0), then
+  // width, depth, height and color (i_data1)
+  vec2 across = i_data0.zw;
+  vec2 back = vec2(-across.y, across.x);
+  vec3 size = vec3(i_data1.x, i_data1.z, i_data1.y);
+  
+  vec3 local = a_position * size;
+  vec3 world = vec3(
+    i_data0.x + across.x * local.x + back.x * local.z,
+    local.y,
+    i_data0.y + across.y * local.x + back.y * local.z);
+  gl_Position = mul(u_viewProj, vec4(world, 1.0));
+  
+  // Scaling the mesh skews its normals by the inverse of the scale
+  vec3 normal = normalize(a_normal / size);
+  v_normal = vec3(
+    across.x * normal.x + back.x * normal.z,
+    normal.y,
+    across.y * normal.x + back.y * normal.z);
+  v_color0 = buildingColor(a_color0, i_data1.w);
+}
@@ -0,0 +1,32 @@
+// Extrusion of cross-section strips along cubic Bezier curves (see
+// CurveExtrusion.h)
+
+// Find the point and right-hand normal of an instance's curve at a row of its
+// strip.
+//   along: how far along the strip the row is, from 0 to 1
+//   data0: the start and first control point of the curve
+//   data1: the second control point and end of the curve
+//   data2: the curve parameters and texture V at the start and end of the strip
+void curveAt(float along, vec4 data0, vec4 data1, vec4 data2, out vec2 point, out vec2 normal) {
+  float t = mix(data2.x, data2.y, along);
+  float s = 1.0 - t;
+  vec2 p0 = data0.xy;
+  vec2 p1 = data0.zw;
+  vec2 p2 = data1.xy;
+  vec2 p3 = data1.zw;
+  
+  point = p0 * (s * s * s) + p1 * (3.0 * s * s * t) + p2 * (3.0 * s * t * t) + p3 * (t * t * t);
+  vec2 tangent = normalize(
+    (p1 - p0) * (3.0 * s * s) + (p2 - p1) * (6.0 * s * t) + (p3 - p2) * (3.0 * t * t));
+  normal = vec2(tangent.y, -tangent.x);
+}
+
+// Place a position of the cross-section (across the curve, up) on the ground.
+vec3 extrudePosition(vec2 section, vec2 point, vec2 normal) {
+  return vec3(point.x + normal.x * section.x, section.y, point.y + normal.y * section.x);
+}
+
+// Turn a normal of the cross-section (across the curve, up) to face the ground.
+vec3 extrudeNormal(vec2 section, vec2 normal) {
+  return vec3(normal.x * section.x, section.y, normal.y * section.x);
+}
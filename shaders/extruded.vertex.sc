@@ -0,0 +1,16 @@
+$input a_position, a_normal, a_texcoord0, i_data0, i_data1, i_data2
+$output v_normal, v_texcoord0
+
+#include "bgfx_shader.sh"
+#include "extruded.sh"
+
+void main() {
+  // The row of the strip is kept in the texture V
+  vec2 point, normal;
+  curveAt(a_texcoord0.y, i_data0, i_data1, i_data2, point, normal);
+  
+  vec3 world = extrudePosition(a_position.xy, point, normal);
+  gl_Position = mul(u_viewProj, vec4(world, 1.0));
+  v_normal = extrudeNormal(a_normal.xy, normal);
+  v_texcoord0 = vec2(a_texcoord0.x, mix(i_data2.z, i_data2.w, a_texcoord0.y));
+}
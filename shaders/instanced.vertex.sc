@@ -0,0 +1,12 @@
+$input a_position, a_normal, a_texcoord0, i_data0, i_data1, i_data2, i_data3
+$output v_normal, v_texcoord0
+
+#include "bgfx_shader.sh"
+
+void main() {
+  mat4 instance = mtxFromCols(i_data0, i_data1, i_data2, i_data3);
+  vec4 world = mul(instance, vec4(a_position, 1.0));
+  gl_Position = mul(u_viewProj, world);
+  v_normal = mul(instance, vec4(a_normal, 0.0)).xyz;
+  v_texcoord0 = a_texcoord0;
+}
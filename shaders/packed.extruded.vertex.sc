@@ -0,0 +1,20 @@
+$input a_position, a_texcoord0, a_texcoord1, i_data0, i_data1, i_data2
+$output v_normal, v_texcoord0
+
+#include "bgfx_shader.sh"
+#include "packed.sh"
+#include "extruded.sh"
+
+void main() {
+  // The packed strip is restored by the model transform, with the row of the
+  // strip kept in the texture V
+  vec3 section = mul(u_model[0], vec4(a_position, 1.0)).xyz;
+  vec2 uv = decodeTexture(a_texcoord0, a_texcoord1.zw);
+  vec2 point, normal;
+  curveAt(uv.y, i_data0, i_data1, i_data2, point, normal);
+  
+  vec3 world = extrudePosition(section.xy, point, normal);
+  gl_Position = mul(u_viewProj, vec4(world, 1.0));
+  v_normal = extrudeNormal(decodeNormal(a_texcoord1.xy).xy, normal);
+  v_texcoord0 = vec2(uv.x, mix(i_data2.z, i_data2.w, uv.y));
+}
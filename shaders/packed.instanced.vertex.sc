@@ -0,0 +1,15 @@
+$input a_position, a_texcoord0, a_texcoord1, i_data0, i_data1, i_data2, i_data3
+$output v_normal, v_texcoord0
+
+#include "bgfx_shader.sh"
+#include "packed.sh"
+
+void main() {
+  // The packed positions are restored by the model transform, then placed by
+  // the instance transform
+  mat4 instance = mtxFromCols(i_data0, i_data1, i_data2, i_data3);
+  vec4 world = mul(instance, mul(u_model[0], vec4(a_position, 1.0)));
+  gl_Position = mul(u_viewProj, world);
+  v_normal = mul(instance, vec4(decodeNormal(a_texcoord1.xy), 0.0)).xyz;
+  v_texcoord0 = decodeTexture(a_texcoord0, a_texcoord1.zw);
+}
@@ -0,0 +1,17 @@
+// Decoding for the packed static mesh vertices (see VertexPacking.h)
+
+// Decode an octahedral-encoded normal, folded around the up (Y) axis.
+vec3 decodeNormal(vec2 encoded) {
+  vec2 e = encoded * 2.0 - 1.0;
+  vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+  float t = max(-n.y, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.z += n.z >= 0.0 ? -t : t;
+  return normalize(n);
+}
+
+// Restore the whole tiles of V to packed texture coordinates.
+vec2 decodeTexture(vec2 uv, vec2 tile) {
+  vec2 bytes = floor(tile * 255.0 + 0.5);
+  return vec2(uv.x, uv.y + bytes.x + bytes.y * 256.0);
+}
@@ -0,0 +1,13 @@
+$input a_position, a_texcoord0, a_texcoord1, a_color0
+$output v_normal, v_texcoord0, v_color0
+
+#include "bgfx_shader.sh"
+#include "packed.sh"
+
+void main() {
+  // The packed positions are restored by the model transform
+  gl_Position = mul(u_modelViewProj, vec4(a_position, 1.0));
+  v_normal = decodeNormal(a_texcoord1.xy);
+  v_texcoord0 = decodeTexture(a_texcoord0, a_texcoord1.zw);
+  v_color0 = a_color0;
+}
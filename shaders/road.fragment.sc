@@ -0,0 +1,21 @@
+$input v_normal, v_texcoord0
+
+#include "bgfx_shader.sh"
+
+uniform vec4 u_ambient;
+uniform vec4 u_sunColor;
+uniform vec4 u_sunDirection;
+uniform vec4 u_textureLayer;
+
+SAMPLER2DARRAY(s_albedoArray, 0);
+
+void main() {
+  vec3 lightColor = vec3(u_sunColor);
+  vec3 lightDir = -normalize(vec3(u_sunDirection));
+  
+  float diff = max(dot(v_normal, lightDir), 0.0);
+  vec4 diffuse = vec4(diff * lightColor, 1.0);
+  
+  gl_FragColor = (u_ambient + diffuse) *
+    texture2DArray(s_albedoArray, vec3(v_texcoord0, u_textureLayer.x));
+}
@@ -0,0 +1,73 @@
+$input a_position, a_normal, a_color0, i_data0
+$output v_normal, v_color0
+
+#include "bgfx_shader.sh"
+#include "extruded.sh"
+
+// Must match VehicleBatch::curvesPerRow and VehicleBatch::curveTexels
+#define CURVES_PER_ROW 204
+#define CURVE_TEXELS 5
+
+// The time since the last simulation step (x)
+uniform vec4 u_vehicleMotion;
+
+// The curve of every lane (see VehicleBatch.h)
+SAMPLER2D(s_laneCurves, 0);
+
+vec4 laneTexel(float segment, int texel) {
+  int index = int(segment + 0.5);
+  int row = index / CURVES_PER_ROW;
+  int column = (index - row * CURVES_PER_ROW) * CURVE_TEXELS + texel;
+  return texelFetch(s_laneCurves, ivec2(column, row), 0);
+}
+
+// The curve parameter at one of the nine eighths of a lane's length, from the
+// seven in the table between the two ends.
+float eighth(float knot, vec4 table0, vec4 table1) {
+  vec4 low  = 1.0 - min(abs(vec4_splat(knot) - vec4(1.0, 2.0, 3.0, 4.0)), 1.0);
+  vec4 high = 1.0 - min(abs(vec4_splat(knot) - vec4(5.0, 6.0, 7.0, 8.0)), 1.0);
+  return dot(table0, low) + dot(vec4(table1.xyz, 1.0), high);
+}
+
+void main() {
+  // Move the vehicle on from the last step, stopping rather than reversing
+  float speed = i_data0.z, acceleration = i_data0.w;
+  float elapsed = u_vehicleMotion.x;
+  if (acceleration < 0.0)
+    elapsed = min(elapsed, speed / -acceleration);
+  float along = i_data0.y + speed * elapsed + 0.5 * acceleration * elapsed * elapsed;
+  
+  // The lane: offset to the right of the curve, elevation, length, reversed
+  vec4 lane = laneTexel(i_data0.x, 2);
+  
+  // Find the curve parameter from the distance along the lane
+  float clamped = clamp(along, 0.0, lane.z);
+  float fraction = clamped / max(lane.z, 0.001);
+  if (lane.w > 0.5)
+    fraction = 1.0 - fraction;
+  float scaled = fraction * 8.0;
+  float knot = min(floor(scaled), 7.0);
+  vec4 table0 = laneTexel(i_data0.x, 3);
+  vec4 table1 = laneTexel(i_data0.x, 4);
+  float t = mix(eighth(knot, table0, table1), eighth(knot + 1.0, table0, table1), scaled - knot);
+  
+  vec2 point, normal;
+  curveAt(t, laneTexel(i_data0.x, 0), laneTexel(i_data0.x, 1), vec4(0.0, 1.0, 0.0, 0.0), point, normal);
+  point += normal * lane.x;
+  
+  // Face the direction of travel, carrying on straight past either end
+  vec2 forward = lane.w > 0.5 ? vec2(normal.y, -normal.x) : vec2(-normal.y, normal.x);
+  vec2 right = vec2(forward.y, -forward.x);
+  point += forward * (along - clamped);
+  
+  vec3 world = vec3(
+    point.x + right.x * a_position.x + forward.x * a_position.z,
+    lane.y + a_position.y,
+    point.y + right.y * a_position.x + forward.y * a_position.z);
+  gl_Position = mul(u_viewProj, vec4(world, 1.0));
+  v_normal = vec3(
+    right.x * a_normal.x + forward.x * a_normal.z,
+    a_normal.y,
+    right.y * a_normal.x + forward.y * a_normal.z);
+  v_color0 = a_color0;
+}
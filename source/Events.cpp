@@ -7,10 +7,16 @@
 
 #include <CityBuilder/Events.h>
 #include <CityBuilder/Game.h>
+#include <CityBuilder/Jobs.h>
+#include <CityBuilder/Rendering/CommandRecorder.h>
+#include <CityBuilder/Rendering/DrawList.h>
 #include <CityBuilder/Rendering/Object.h>
 #include <CityBuilder/Rendering/Uniforms.h>
+#include <CityBuilder/Rendering/TextureLoader.h>
+#include <CityBuilder/Rendering/VertexPacking.h>
 #include <CityBuilder/UI/System.h>
 #include <CityBuilder/Storage/Ref.h>
+#include <algorithm>
 USING_NS_CITY_BUILDER
 
 namespace {
@@ -19,15 +25,41 @@ namespace {
   
   /// The current global frame number.
   uint64_t frame = 0;
+  
+  /// The fixed timestep to use, in seconds, or zero to use the frame time.
+  double fixedTimestep = 0;
+  
+  /// The lighting uniforms of the current frame.
+  Real4 ambient, sunColor;
+  
+  /// The direction of the sun in the current frame.
+  Real3 sunDirection;
 }
 
 void Events::start() {
+  // Start the worker threads shared by every part of the game
+  Jobs::start();
+  
+  // Load textures in the background
+  TextureLoader::start();
+  
+  // Record draw calls in parallel
+  CommandRecorder::start();
+  
   game = new Game();
   
   // Load the default shader
-  Program::pbr = new Program("vertex", "fragment"); 
+  Program::pbr = new Program(VertexPacking::vertexShader("vertex"), "fragment"); 
   Program::hover = new Program("hover.vertex", "hover.fragment");
-  Program::zone  = new Program( "zone.vertex",  "zone.fragment");
+  Program::zone  = new Program(VertexPacking::vertexShader("zone.vertex"), "zone.fragment");
+  Program::road  = new Program(VertexPacking::vertexShader("vertex"), "road.fragment");
+  Program::pbrInstanced  = new Program(VertexPacking::vertexShader("instanced.vertex"), "fragment");
+  Program::roadInstanced = new Program(VertexPacking::vertexShader("instanced.vertex"), "road.fragment");
+  Program::pbrExtruded   = new Program(VertexPacking::vertexShader("extruded.vertex"), "fragment");
+  Program::roadExtruded  = new Program(VertexPacking::vertexShader("extruded.vertex"), "road.fragment");
+  Program::vehicle = new Program("vehicle.vertex", "vehicle.fragment");
+  Program::building = new Program("building.vertex", "vehicle.fragment");
+  Program::buildingImpostor = new Program("building.impostor.vertex", "vehicle.fragment");
   
   // Create the shader uniforms
   Uniforms::create();
@@ -37,7 +69,9 @@ void Events::start() {
 }
 
 void Events::stop() {
-  
+  CommandRecorder::stop();
+  TextureLoader::stop();
+  Jobs::stop();
 }
 
 void Events::pause() {
@@ -47,8 +81,19 @@ void Events::pause() {
   bgfx::setDebug(BGFX_DEBUG_TEXT);
 }
 
+void Events::setFixedTimestep(double dt) {
+  fixedTimestep = dt;
+}
+
 void Events::update() {
-  Real dt = bgfx::getStats()->cpuTimeFrame / 1000000.0;
+  Real dt = fixedTimestep > 0 ?
+    fixedTimestep : bgfx::getStats()->cpuTimeFrame / 1000000.0;
+  
+  // Run the jobs that must run on the main thread
+  Jobs::update();
+  
+  // Upload any textures that finished loading
+  TextureLoader::update();
   
   // Update the camera
   {
@@ -60,13 +105,12 @@ void Events::update() {
   // Update the sun
   {
     // Normalize the colors before uploading them
-    Real4 ambient = {
+    ambient = {
       Real(game->sun().ambient.x) / Real(255),
       Real(game->sun().ambient.y) / Real(255),
       Real(game->sun().ambient.z) / Real(255),
       1, // Unused
     };
-    bgfx::setUniform(Uniforms::u_ambient, ambient);
     
     Real4 sun = {
       Real(game->sun().color.x) / Real(255),
@@ -74,9 +118,9 @@ void Events::update() {
       Real(game->sun().color.z) / Real(255),
       1, // Unused
     };
-    bgfx::setUniform(Uniforms::u_sunColor, sun - ambient * Real4(0.8));
+    sunColor = sun - ambient * Real4(0.8);
     
-    bgfx::setUniform(Uniforms::u_sunDirection, game->sun().direction);
+    sunDirection = game->sun().direction;
   }
   
   // Update the scene
@@ -85,7 +129,6 @@ void Events::update() {
   
   // Setup
   // bgfx::dbgTextClear();
-  bgfx::setState(BGFX_STATE_DEFAULT);
   Real2 screen;
   {
     Real4 viewport = game->mainCamera().camera().rect;
@@ -97,16 +140,19 @@ void Events::update() {
   game->draw();
   
   // Draw any hover components
-  bgfx::setState(
-    BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A |
-    BGFX_STATE_MSAA |
-    BGFX_STATE_BLEND_FUNC(
-      BGFX_STATE_BLEND_SRC_ALPHA, BGFX_STATE_BLEND_INV_SRC_ALPHA)
-  );
   game->drawHovers();
   
   // Draw the UI
-  UI::System::draw(screen);
+  UI::System::setView(screen);
+  CommandRecorder::add("ui", UI::System::draw);
+  
+  // Record everything, with the lighting set up on every encoder
+  DrawList::startFrame();
+  CommandRecorder::record([](bgfx::Encoder *encoder) {
+    encoder->setUniform(Uniforms::u_ambient, ambient);
+    encoder->setUniform(Uniforms::u_sunColor, sunColor);
+    encoder->setUniform(Uniforms::u_sunDirection, sunDirection);
+  });
   
   // Debug info
   {
@@ -114,13 +160,33 @@ void Events::update() {
       "frame %d : %d ns (%d FPS)",
       frame++,
       (int)bgfx::getStats()->cpuTimeFrame,
-      (int)(1000000ll / bgfx::getStats()->cpuTimeFrame)
+      (int)(1000000ll / std::max<int64_t>(bgfx::getStats()->cpuTimeFrame, 1))
     );
     bgfx::dbgTextPrintf(4, 3, 0x0f,
       "%dx%d",
       (int)screen.x,
       (int)screen.y
     );
+    bgfx::dbgTextPrintf(4, 4, 0x0f,
+      "textures: %.1f MiB",
+      TextureLoader::memoryUsed() / (1024.0 * 1024.0)
+    );
+    bgfx::dbgTextPrintf(4, 5, 0x0f,
+      "draw calls: %d (roads %d, %zu tris), meshes: %d visible, %d culled (%.1f us)",
+      (int)bgfx::getStats()->numDraw,
+      game->roads().drawCalls(),
+      game->roads().triangles(),
+      game->cullStats().visible,
+      game->cullStats().culled,
+      game->cullStats().time
+    );
+    bgfx::dbgTextPrintf(4, 7, 0x0f,
+      "recording: %.1f us on %d threads (%.1f us serial, %.2fx)",
+      CommandRecorder::stats().time,
+      CommandRecorder::stats().threads,
+      CommandRecorder::stats().serial,
+      CommandRecorder::stats().speedUp()
+    );
     bgfx::setDebug(BGFX_DEBUG_TEXT);
   }
 }
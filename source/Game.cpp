@@ -6,10 +6,58 @@
  */
 
 #include <CityBuilder/Game.h>
+#include <CityBuilder/Rendering/CommandRecorder.h>
+#include <CityBuilder/Rendering/DynamicMesh.h>
+#include <CityBuilder/Rendering/TextureLoader.h>
+#include <CityBuilder/Rendering/VertexPacking.h>
+#include <chrono>
+#include <cmath>
 USING_NS_CITY_BUILDER
 
 Game *Game::_instance = nullptr;
 
+namespace {
+  /// The camera distance below which streamed textures load every mip level.
+  const Real fullDetailDistance = 20;
+  
+  /// The camera distance above which streamed textures drop their top mip
+  /// levels again (further than `fullDetailDistance` to avoid reloading
+  /// back and forth around a single distance).
+  const Real reducedDetailDistance = 30;
+  
+  /// Whether streamed textures currently have every mip level loaded.
+  bool fullDetail = false;
+  
+  /// The time each frame that buildings may spend growing, in microseconds.
+  const double growthBudget = 1000;
+  
+  /// The time each frame that buildings may spend uploading, in microseconds.
+  const double buildingUploadBudget = 500;
+  
+  /// The camera distance below which pedestrians are drawn one by one.
+  const Real pedestrianDistance = 120;
+  
+  /// How far from where the camera looks pedestrians are drawn one by one,
+  /// in meters.
+  const Real pedestrianRadius = 150;
+  
+  /// Draw a hover over the scene.
+  /// \param[in] display
+  ///   The hover mesh to draw.
+  void drawHover(const Resource<DynamicMesh> &display) {
+    const DynamicMesh *mesh = display.address();
+    CommandRecorder::add("hovers", [mesh](bgfx::Encoder *encoder) {
+      encoder->setState(
+        BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A |
+        BGFX_STATE_MSAA |
+        BGFX_STATE_BLEND_FUNC(
+          BGFX_STATE_BLEND_SRC_ALPHA, BGFX_STATE_BLEND_INV_SRC_ALPHA)
+      );
+      mesh->draw(encoder, Program::hover);
+    });
+  }
+}
+
 Game::Game() {
   // Setup the scene
   _sun = DistanceLight({ -0.2, -1, -0.2 }, 1, { 255, 255, 200 }, { 150 });
@@ -36,10 +84,11 @@ Game::Game() {
       2, 3, 0,
     }).load();
     
-    Resource<Program> shader = new Program("vertex", "fragment");
+    Resource<Program> shader = new Program(VertexPacking::vertexShader("vertex"), "fragment");
     
     Resource<Material> material = new Material(shader);
-    material->texture = new Texture("grass", 256);
+    material->texture = new Texture("grass",
+      BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE, true);
     material->textureTile = { 200, 200 };
     
     _ground = new Object(mesh, material);
@@ -75,6 +124,21 @@ Game::Game() {
       // Zone industrial
       zone(&ZoneDef::zones["Industrial"]);
       break;
+    
+    case 6:
+      // Toggle the congestion view
+      setMacroscopicTraffic(!_macroscopic);
+      break;
+    
+    case 7:
+      // Change the speed of the simulation
+      _scheduler.nextSpeed();
+      break;
+    
+    case 0:
+      // Pause or resume the simulation
+      _scheduler.setPaused(!_scheduler.paused());
+      break;
     }
   };
   
@@ -132,6 +196,101 @@ Ray3 Game::rayFromMouse() {
 
 
 void Game::update(Real elapsed) {
+  // Stream in the top texture mip levels when the camera gets close
+  if (!fullDetail && _mainCamera.distance() < fullDetailDistance)
+    TextureLoader::setFullDetail(fullDetail = true);
+  else if (fullDetail && _mainCamera.distance() > reducedDetailDistance)
+    TextureLoader::setFullDetail(fullDetail = false);
+  
+  // Run the simulation in fixed ticks at its own speed, whatever the frame
+  // rate: the vehicles and pedestrians step and the demand for zones follows
+  // the city
+  _economy.update(_roads.parcels());
+  _pedestrians.sync(_roads.laneGraph(), _roads.parcels());
+  bool moved = false, walked = _walkers.setCurves(_roads.laneGraph());
+  if (!_macroscopic) {
+    _traffic.sync(_roads.laneGraph());
+    moved = _vehicles.setCurves(_roads.laneGraph());
+  }
+  int ticks = _scheduler.advance(elapsed, [this](Real dt) {
+    if (!_macroscopic)
+      _traffic.step();
+    _pedestrians.advance(dt);
+    _economy.step(_buildings, dt);
+  });
+  
+  // Draw the pedestrians near the camera one by one, walking on as the
+  // crowds around them do
+  if (ticks > 0 || walked) {
+    Real3 pivot = _mainCamera.pivot();
+    _pedestrians.sample({ pivot.x, pivot.z },
+      _mainCamera.distance() < pedestrianDistance ? pedestrianRadius : Real(0));
+    _walkers.update(_pedestrians.agents());
+  }
+  
+  if (_macroscopic) {
+    // Assign the traffic again whenever the roads or zones change, iterating
+    // in the background so that large cities do not hold up the frame, and
+    // show the congestion once it has settled. The assignment is only read
+    // between iterations, so what is shown comes from the last one finished
+    if (
+      _assigning.valid() &&
+      _assigning.wait_for(std::chrono::seconds(0)) == std::future_status::ready
+    ) {
+      bool settled = _assigning.get();
+      _assignedTrips = _assignment.trips();
+      _assignedGap = _assignment.gap();
+      if (settled && _assignedVersion == _roads.laneGraph().version())
+        _roads.setCongestion(_assignment);
+    }
+    if (!_assigning.valid()) {
+      uint64_t version = _roads.laneGraph().version();
+      if (version != _assignedVersion) {
+        _assignment.build(_roads.roads());
+        _assignedVersion = version;
+      }
+      if (!_assignment.converged())
+        _assigning = std::async(std::launch::async, [this]() {
+          return _assignment.iterate();
+        });
+    }
+    
+    bgfx::dbgTextPrintf(4, 8, 0x0f, "Traffic: %.0f trips/h, gap %.3f",
+      _assignedTrips, _assignedGap);
+  } else if (ticks > 0 || moved) {
+    // Move the vehicles on whatever the roads have become
+    _vehicles.update(_traffic);
+  }
+  
+  // Grow buildings on the zoned lots for the time simulated, a little at a
+  // time, and upload the chunks of buildings that changed, carrying on with
+  // any left over
+  _buildings.grow(_roads.parcels(), _economy, ticks * Scheduler::tick, growthBudget);
+  _buildingBatch.update(_buildings, buildingUploadBudget);
+  bgfx::dbgTextPrintf(4, 9, 0x0f,
+    "Buildings: %zu (%.0f residents, %.0f jobs), %d draw calls, %zu tris",
+    _buildings.count(),
+    _buildings.capacity(ZoneDef::Use::residential),
+    _buildings.capacity(ZoneDef::Use::commercial) +
+      _buildings.capacity(ZoneDef::Use::industrial),
+    _buildingBatch.drawCalls(),
+    _buildingBatch.triangles());
+  if (_scheduler.paused())
+    bgfx::dbgTextPrintf(4, 10, 0x0f, "Simulation: paused");
+  else if (std::isinf(_scheduler.multiplier()))
+    bgfx::dbgTextPrintf(4, 10, 0x0f, "Simulation: max speed");
+  else
+    bgfx::dbgTextPrintf(4, 10, 0x0f, "Simulation: %gx speed", _scheduler.multiplier());
+  bgfx::dbgTextPrintf(4, 11, 0x0f,
+    "Demand: R %+.2f C %+.2f I %+.2f, %.1f%% unemployed",
+    _economy.demand(ZoneDef::Use::residential),
+    _economy.demand(ZoneDef::Use::commercial),
+    _economy.demand(ZoneDef::Use::industrial),
+    _economy.unemployment() * 100);
+  bgfx::dbgTextPrintf(4, 12, 0x0f,
+    "Pedestrians: %.0f walking, %.0f shopping, %zu drawn",
+    _pedestrians.count(), _pedestrians.shopping(), _walkers.count());
+  
   // Perform the action item
   switch (_action) {
   case Action::road_building: {
@@ -189,15 +348,49 @@ void Game::update(Real elapsed) {
 }
 
 void Game::draw() {
-  _ground->draw();
+  // Find what the main camera can see
+  Frustum frustum(
+    _mainCamera.camera().viewProjection(), bgfx::getCaps()->homogeneousDepth);
+  _cullStats = { };
   
-  _roads.draw();
+  auto start = std::chrono::steady_clock::now();
+  bool groundVisible = frustum.intersects(_ground->bounds());
+  _cullStats.time += std::chrono::duration<double, std::micro>(
+    std::chrono::steady_clock::now() - start).count();
+  
+  if (groundVisible) {
+    CommandRecorder::add("ground", [this](bgfx::Encoder *encoder) {
+      _ground->draw(encoder);
+    });
+    _cullStats.visible++;
+  } else
+    _cullStats.culled++;
+  
+  _roads.draw(frustum, _mainCamera.camera().position, _cullStats);
+  _buildingBatch.draw(frustum, _mainCamera.camera().position, _cullStats);
+  
+  // Draw the congestion of the roads, or the vehicles where they have got to
+  // since the last step
+  if (_macroscopic)
+    _roads.drawCongestion(frustum, _cullStats);
+  else if (_vehicles.count() > 0) {
+    float lag = _scheduler.lag();
+    CommandRecorder::add("vehicles", [this, lag](bgfx::Encoder *encoder) {
+      _vehicles.draw(encoder, lag);
+    });
+  }
+  if (_walkers.count() > 0) {
+    float lag = _scheduler.lag();
+    CommandRecorder::add("pedestrians", [this, lag](bgfx::Encoder *encoder) {
+      _walkers.draw(encoder, lag);
+    });
+  }
   
   // Check what needs to be drawn for the current action
   switch (_action) {
   case Action::zoning: {
     // Draw all the zone areas
-    _roads.drawZones();
+    _roads.drawZones(frustum, _cullStats);
   } break;
   
   default:
@@ -214,7 +407,7 @@ void Game::drawHovers() {
     Road_Building *state = (Road_Building *)_actionState;
     
     if (state->displayVisible)
-      state->display->draw(Program::hover);
+      drawHover(state->display);
   } break;
   
   case Action::zoning: {
@@ -222,7 +415,7 @@ void Game::drawHovers() {
     Zoning *state = (Zoning *)_actionState;
     
     if (state->displayVisible)
-      state->display->draw(Program::hover);
+      drawHover(state->display);
   } break;
   
   default:
@@ -249,6 +442,22 @@ void Game::cancel() {
   _act(Action::none);
 }
 
+void Game::setMacroscopicTraffic(bool macroscopic) {
+  if (macroscopic == _macroscopic)
+    return;
+  _macroscopic = macroscopic;
+  
+  // Build the assignment again the next time it is needed, as the roads may
+  // well change in the meantime
+  if (!macroscopic) {
+    if (_assigning.valid())
+      _assigning.wait();
+    _assigning = { };
+    _roads.clearCongestion();
+    _assignedVersion = 0;
+  }
+}
+
 void Game::_act(Action action) {
   // Perform clean-up for the previous action, as necessary
   switch (_action) {
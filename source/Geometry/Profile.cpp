@@ -55,3 +55,43 @@ ProfileMesh::ProfileMesh(const List<ProfilePoint> &points) {
       dimensions.y = vertex.position.y;
   }
 }
+
+
+
+ProfileMesh ProfileMesh::collapsed(Real height) const {
+  ProfileMesh mesh;
+  mesh.dimensions = dimensions;
+  
+  // Check if an edge is steep and short, like the side of a curb
+  auto dropped = [&](intptr_t edge) {
+    Real2 size = (
+      vertices[triangles[edge + 1]].position -
+      vertices[triangles[edge    ]].position
+    ).abs();
+    return size.y > size.x && size.y <= height;
+  };
+  
+  // Find the vertices of the remaining edges
+  List<int> remap { };
+  for (intptr_t i = 0; i < vertices.count(); i++)
+    remap.append(-1);
+  for (intptr_t i = 0; i < triangles.count(); i += 2)
+    if (!dropped(i)) {
+      remap[triangles[i    ]] = 0;
+      remap[triangles[i + 1]] = 0;
+    }
+  
+  // Keep those vertices, in order
+  for (intptr_t i = 0; i < vertices.count(); i++)
+    if (remap[i] >= 0) {
+      remap[i] = (int)mesh.vertices.count();
+      mesh.vertices.append(vertices[i]);
+    }
+  
+  // Keep the remaining edges
+  for (intptr_t i = 0; i < triangles.count(); i += 2)
+    if (!dropped(i))
+      mesh.triangles.append(remap[triangles[i]]).append(remap[triangles[i + 1]]);
+  
+  return mesh;
+}
@@ -191,11 +191,7 @@ bool Input::secondaryMouseDown() {
 }
 
 bool Input::shiftDown() {
-#if (__APPLE__ && __MACH__) // MacOS
-  
   return _systemKeys[0] || _systemKeys[4];
-  
-#endif
 }
 
 
@@ -234,8 +230,6 @@ void Events::inputStart(Input &input) {
     }
     
     // Handle the system modifier keys
-#if (__APPLE__ && __MACH__) // MacOS
-    
     switch (key) {
     case (int)KeyCode:: leftShift  : NS_CITY_BUILDER Input::_systemKeys[0] = true; break;
     case (int)KeyCode:: leftCommand: NS_CITY_BUILDER Input::_systemKeys[1] = true; break;
@@ -249,8 +243,6 @@ void Events::inputStart(Input &input) {
     case (int)KeyCode::escape   : NS_CITY_BUILDER Input::onCancel(); break;
     case (int)KeyCode::backspace: NS_CITY_BUILDER Input::onCancel(); break;
     }
-      
-#endif
   } break;
   
   case Input::Type::mouseButton:
@@ -283,8 +275,6 @@ void Events::inputStop(Input &input) {
     }
     
     // Handle the system modifier keys
-#if (__APPLE__ && __MACH__) // MacOS
-    
     switch (key) {
     case (int)KeyCode:: leftShift  : NS_CITY_BUILDER Input::_systemKeys[0] = false; break;
     case (int)KeyCode:: leftCommand: NS_CITY_BUILDER Input::_systemKeys[1] = false; break;
@@ -295,8 +285,6 @@ void Events::inputStop(Input &input) {
     case (int)KeyCode::rightControl: NS_CITY_BUILDER Input::_systemKeys[6] = false; break;
     case (int)KeyCode::rightOption : NS_CITY_BUILDER Input::_systemKeys[7] = false; break;
     }
-      
-#endif
   } break;
   
   case Input::Type::mouseButton:
@@ -0,0 +1,585 @@
+/**
+ * @file Jobs.cpp
+ * @brief The implementation of the shared pool of worker threads.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Jobs.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  /// The number of times an idle worker looks for jobs before it sleeps.
+  constexpr int spins = 64;
+
+  /// A job run, for the trace.
+  struct Event {
+    /// The name of the job.
+    const char *name;
+
+    /// When the job started, in microseconds since tracing started.
+    double start;
+
+    /// The time the job took, in microseconds.
+    double duration;
+  };
+
+  /// The slot of the calling thread, or -1 outside of the pool.
+  thread_local int currentSlot = -1;
+}
+
+
+
+struct Jobs::_job {
+  /// The name of the job.
+  const char *name;
+
+  /// The job to run.
+  Job function;
+
+  /// The counter to count the job with, if any.
+  Counter *counter;
+
+  /// Whether the job must run on the main thread.
+  bool onMain;
+
+  /// The next job waiting on the same counter.
+  _job *next = nullptr;
+};
+
+/// The threads, their deques and the jobs for the main thread.
+/// \remarks
+///   The slots of the threads are the main thread first, then every worker,
+///   then the one shared by every thread outside of the pool.
+struct Jobs::_pool {
+  /// The jobs and timings of a thread.
+  struct alignas(64) Slot {
+    /// The lock for the deque, and for the timings of the shared slot.
+    std::mutex lock;
+
+    /// The jobs added by the thread and not yet taken.
+    std::deque<_job *> jobs;
+
+    /// The jobs run by the thread, when tracing.
+    std::vector<Event> events;
+
+    /// The jobs run by the thread since the last `resetStats`.
+    Stats stats;
+  };
+
+  /// The worker threads.
+  std::vector<std::thread> threads;
+
+  /// The slot of every thread.
+  std::unique_ptr<Slot[]> slots;
+
+  /// The number of slots.
+  size_t slotCount = 0;
+
+  /// The requested number of worker threads, or -1 for one less than the
+  /// number of cores.
+  int requestedThreads = -1;
+
+  /// Whether the worker threads are running.
+  std::atomic<bool> running { false };
+
+  /// The number of jobs in every deque.
+  std::atomic<size_t> queued { 0 };
+
+  /// The number of workers asleep.
+  std::atomic<int> sleeping { 0 };
+
+  /// The lock that workers sleep on.
+  std::mutex sleepLock;
+
+  /// Signalled when a job is added or the workers stop.
+  std::condition_variable wake;
+
+  /// The lock for the jobs of the main thread.
+  std::mutex mainLock;
+
+  /// The jobs waiting to run on the main thread, oldest first.
+  std::deque<_job *> mainJobs;
+
+  /// The main thread.
+  std::thread::id mainThread = std::this_thread::get_id();
+
+  /// Whether jobs are recorded for the trace.
+  bool tracing = false;
+
+  /// When tracing started.
+  Clock::time_point epoch = Clock::now();
+
+  /// When the stats were last reset.
+  Clock::time_point statsStart = Clock::now();
+
+
+
+  _pool() {
+    resize(0);
+  }
+
+  /// Stop the worker threads if `stop` was never called.
+  ~_pool() {
+    {
+      std::lock_guard<std::mutex> lock(sleepLock);
+      running = false;
+    }
+    wake.notify_all();
+    for (std::thread &thread : threads)
+      thread.join();
+  }
+
+  /// Create the slots for a number of workers.
+  void resize(size_t workers) {
+    slotCount = workers + 2;
+    slots.reset(new Slot[slotCount]);
+  }
+
+  /// The slot of the calling thread.
+  size_t self() const {
+    if (currentSlot >= 0)
+      return (size_t)currentSlot;
+    return std::this_thread::get_id() == mainThread ? 0 : slotCount - 1;
+  }
+
+  /// Whether jobs are handed to the workers rather than run at once.
+  bool parallel() const {
+    return running.load() && !threads.empty();
+  }
+
+
+
+  /// Run a job and let go of its counter.
+  /// \param[in] job
+  ///   The job to run, which is deleted.
+  /// \param[in] thread
+  ///   The slot of the calling thread.
+  void execute(_job *job, size_t thread) {
+    Clock::time_point start = Clock::now();
+    job->function();
+    record(thread, job->name, start, job->onMain);
+    Counter *counter = job->counter;
+    delete job;
+    finish(counter);
+  }
+
+  /// Record a job that was run.
+  /// \param[in] thread
+  ///   The slot of the thread that ran it.
+  /// \param[in] name
+  ///   The name of the job.
+  /// \param[in] start
+  ///   When the job started.
+  /// \param[in] onMain
+  ///   Whether the job was queued for the main thread.
+  void record(size_t thread, const char *name, Clock::time_point start, bool onMain) {
+    double duration = since(start);
+    Slot &slot = slots[thread];
+
+    // Threads outside of the pool share their slot
+    std::unique_lock<std::mutex> lock(slot.lock, std::defer_lock);
+    if (thread == slotCount - 1)
+      lock.lock();
+    slot.stats.jobs++;
+    slot.stats.mainJobs += onMain;
+    slot.stats.busy += duration;
+    if (tracing)
+      slot.events.push_back({ name,
+        std::chrono::duration<double, std::micro>(start - epoch).count(), duration });
+  }
+
+  /// Count a job of a counter as finished, adding the jobs waiting on it
+  /// once none are left.
+  void finish(Counter *counter) {
+    if (counter == nullptr)
+      return;
+
+    // Change the count under the lock so that a waiting thread cannot let go
+    // of the counter before this one does
+    _job *ready = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(counter->_lock);
+      if (--counter->_pending == 0) {
+        ready = counter->_waiting;
+        counter->_waiting = nullptr;
+      }
+    }
+    while (ready != nullptr) {
+      _job *next = ready->next;
+      ready->next = nullptr;
+      dispatch(ready);
+      ready = next;
+    }
+  }
+
+  /// Add a job to be run by the right thread.
+  void dispatch(_job *job) {
+    if (job->onMain) {
+      if (std::this_thread::get_id() == mainThread || !running.load())
+        execute(job, self());
+      else {
+        std::lock_guard<std::mutex> lock(mainLock);
+        mainJobs.push_back(job);
+      }
+      return;
+    }
+
+    if (!parallel()) {
+      execute(job, self());
+      return;
+    }
+    Slot &slot = slots[self()];
+    {
+      std::lock_guard<std::mutex> lock(slot.lock);
+      slot.jobs.push_back(job);
+    }
+    queued++;
+
+    // Taking the lock makes sure that a worker about to sleep sees the job
+    if (sleeping.load() > 0) {
+      { std::lock_guard<std::mutex> lock(sleepLock); }
+      wake.notify_one();
+    }
+  }
+
+  /// Take a job from a deque.
+  /// \param[in] slot
+  ///   The slot of the deque.
+  /// \param[in] counter
+  ///   The counter of the jobs to take, or `nullptr` for any job.
+  /// \param[in] back
+  ///   Whether to take the newest job rather than the oldest.
+  _job *take(Slot &slot, Counter *counter, bool back) {
+    std::lock_guard<std::mutex> lock(slot.lock);
+    if (slot.jobs.empty())
+      return nullptr;
+    if (counter == nullptr) {
+      _job *job;
+      if (back) {
+        job = slot.jobs.back();
+        slot.jobs.pop_back();
+      } else {
+        job = slot.jobs.front();
+        slot.jobs.pop_front();
+      }
+      return job;
+    }
+    if (back) {
+      for (auto i = slot.jobs.rbegin(); i != slot.jobs.rend(); i++)
+        if ((*i)->counter == counter) {
+          _job *job = *i;
+          slot.jobs.erase(std::next(i).base());
+          return job;
+        }
+    } else {
+      for (auto i = slot.jobs.begin(); i != slot.jobs.end(); i++)
+        if ((*i)->counter == counter) {
+          _job *job = *i;
+          slot.jobs.erase(i);
+          return job;
+        }
+    }
+    return nullptr;
+  }
+
+  /// Find a job to run: the newest of the thread's own, or else the oldest
+  /// of another thread's.
+  /// \param[in] thread
+  ///   The slot of the calling thread.
+  /// \param[in] counter
+  ///   The counter of the jobs to take, or `nullptr` for any job.
+  _job *find(size_t thread, Counter *counter) {
+    if (queued.load() == 0)
+      return nullptr;
+    _job *job = take(slots[thread], counter, true);
+    for (size_t i = 1; job == nullptr && i < slotCount; i++)
+      if ((job = take(slots[(thread + i) % slotCount], counter, false))) {
+        std::unique_lock<std::mutex> lock(slots[thread].lock, std::defer_lock);
+        if (thread == slotCount - 1)
+          lock.lock();
+        slots[thread].stats.stolen++;
+      }
+    if (job != nullptr)
+      queued--;
+    return job;
+  }
+
+  /// Run the oldest job waiting for the main thread, if any.
+  bool runMain() {
+    _job *job;
+    {
+      std::lock_guard<std::mutex> lock(mainLock);
+      if (mainJobs.empty())
+        return false;
+      job = mainJobs.front();
+      mainJobs.pop_front();
+    }
+    execute(job, 0);
+    return true;
+  }
+
+  /// Run jobs on a worker thread until the pool stops.
+  void work(size_t thread) {
+    currentSlot = (int)thread;
+    int idle = 0;
+    while (running.load()) {
+      if (_job *job = find(thread, nullptr)) {
+        execute(job, thread);
+        idle = 0;
+        continue;
+      }
+      if (++idle < spins) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(sleepLock);
+      sleeping++;
+      wake.wait(lock, [&] { return !running.load() || queued.load() > 0; });
+      sleeping--;
+      idle = 0;
+    }
+  }
+
+  /// Run a function over a range, handing the back half to be stolen until
+  /// the range is no larger than the grain.
+  /// \param[in] top
+  ///   Whether the range is run by the thread that called `parallelFor`
+  ///   rather than by a job, which is recorded when it finishes.
+  void split(const char *name, const Range &body, size_t begin, size_t end,
+      size_t grain, Counter &counter, bool top) {
+    while (end - begin > grain) {
+      size_t middle = begin + (end - begin) / 2;
+      counter._pending++;
+      dispatch(new _job { name, [this, name, &body, middle, end, grain, &counter] {
+        split(name, body, middle, end, grain, counter, false);
+      }, &counter, false });
+      end = middle;
+    }
+    Clock::time_point start = Clock::now();
+    body(begin, end);
+    if (top)
+      record(self(), name, start, false);
+  }
+};
+
+
+
+Jobs::_pool &Jobs::_instance() {
+  static _pool pool;
+  return pool;
+}
+
+void Jobs::setThreads(int threads) {
+  _instance().requestedThreads = threads;
+}
+
+void Jobs::start() {
+  _pool &pool = _instance();
+  if (pool.running.load())
+    return;
+
+  // Leave the main thread its own core
+  int threads = pool.requestedThreads;
+  if (threads < 0)
+    threads = std::max((int)std::thread::hardware_concurrency() - 1, 0);
+
+  pool.mainThread = std::this_thread::get_id();
+  currentSlot = 0;
+  pool.resize(threads);
+  pool.epoch = pool.statsStart = Clock::now();
+  pool.running = true;
+  for (int i = 0; i < threads; i++)
+    pool.threads.emplace_back([&pool, i] { pool.work(i + 1); });
+}
+
+void Jobs::stop() {
+  _pool &pool = _instance();
+  if (!pool.running.load())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(pool.sleepLock);
+    pool.running = false;
+  }
+  pool.wake.notify_all();
+  for (std::thread &thread : pool.threads)
+    thread.join();
+  pool.threads.clear();
+
+  // Run whatever was left, which now runs at once
+  size_t thread = pool.self();
+  for (size_t i = 0; i < pool.slotCount; i++)
+    while (_job *job = pool.take(pool.slots[i], nullptr, false)) {
+      pool.queued--;
+      pool.execute(job, thread);
+    }
+  while (pool.runMain());
+}
+
+int Jobs::threads() {
+  return (int)_instance().threads.size();
+}
+
+bool Jobs::isMainThread() {
+  return std::this_thread::get_id() == _instance().mainThread;
+}
+
+
+
+void Jobs::run(const char *name, Job job, Counter *counter) {
+  if (counter != nullptr)
+    counter->_pending++;
+  _instance().dispatch(new _job { name, std::move(job), counter, false });
+}
+
+void Jobs::runOnMain(const char *name, Job job, Counter *counter) {
+  if (counter != nullptr)
+    counter->_pending++;
+  _instance().dispatch(new _job { name, std::move(job), counter, true });
+}
+
+void Jobs::after(Counter &dependency, const char *name, Job job, Counter *counter, bool onMain) {
+  if (counter != nullptr)
+    counter->_pending++;
+  _job *waiting = new _job { name, std::move(job), counter, onMain };
+  {
+    std::lock_guard<std::mutex> lock(dependency._lock);
+    if (dependency._pending.load() > 0) {
+      waiting->next = dependency._waiting;
+      dependency._waiting = waiting;
+      return;
+    }
+  }
+  _instance().dispatch(waiting);
+}
+
+void Jobs::wait(Counter &counter) {
+  _pool &pool = _instance();
+  size_t thread = pool.self();
+  bool main = thread == 0;
+  while (counter._pending.load() > 0) {
+    if (main && pool.runMain())
+      continue;
+    if (_job *job = pool.find(thread, &counter))
+      pool.execute(job, thread);
+    else
+      std::this_thread::yield();
+  }
+
+  // Let the last job finish with the counter
+  std::lock_guard<std::mutex> lock(counter._lock);
+}
+
+void Jobs::parallelFor(const char *name, size_t count, size_t grain, const Range &body) {
+  if (count == 0)
+    return;
+  grain = std::max(grain, (size_t)1);
+  _pool &pool = _instance();
+
+  // Not worth handing out a single range
+  if (count <= grain || !pool.parallel()) {
+    Clock::time_point start = Clock::now();
+    body(0, count);
+    pool.record(pool.self(), name, start, false);
+    return;
+  }
+
+  Counter counter;
+  pool.split(name, body, 0, count, grain, counter, true);
+  wait(counter);
+}
+
+void Jobs::update() {
+  // Only run the jobs already queued, not those that they queue
+  _pool &pool = _instance();
+  size_t queued;
+  {
+    std::lock_guard<std::mutex> lock(pool.mainLock);
+    queued = pool.mainJobs.size();
+  }
+  for (size_t i = 0; i < queued && pool.runMain(); i++);
+}
+
+
+
+void Jobs::setTracing(bool tracing) {
+  _pool &pool = _instance();
+  pool.tracing = tracing;
+  pool.epoch = Clock::now();
+}
+
+bool Jobs::writeTrace(const char *path) {
+  _pool &pool = _instance();
+  FILE *file = fopen(path, "w");
+  if (file == nullptr)
+    return false;
+
+  fprintf(file, "{\"traceEvents\":[\n");
+  bool first = true;
+  for (size_t i = 0; i < pool.slotCount; i++) {
+    char name[32];
+    if (i == 0)
+      snprintf(name, sizeof(name), "main");
+    else if (i == pool.slotCount - 1)
+      snprintf(name, sizeof(name), "other threads");
+    else
+      snprintf(name, sizeof(name), "worker %zu", i);
+    fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+      first ? "" : ",\n", i, name);
+    first = false;
+
+    for (const Event &event : pool.slots[i].events)
+      fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"job\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+        event.name, i, event.start, event.duration);
+  }
+  fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  return fclose(file) == 0;
+}
+
+Jobs::Stats Jobs::stats() {
+  _pool &pool = _instance();
+  Stats total { };
+  for (size_t i = 0; i < pool.slotCount; i++) {
+    const Stats &stats = pool.slots[i].stats;
+    total.jobs     += stats.jobs;
+    total.stolen   += stats.stolen;
+    total.mainJobs += stats.mainJobs;
+    total.busy     += stats.busy;
+  }
+  return total;
+}
+
+Jobs::Stats Jobs::stats(int thread) {
+  _pool &pool = _instance();
+  if (thread < 0 || (size_t)thread >= pool.slotCount)
+    return { };
+  return pool.slots[thread].stats;
+}
+
+double Jobs::elapsed() {
+  return since(_instance().statsStart);
+}
+
+void Jobs::resetStats() {
+  _pool &pool = _instance();
+  for (size_t i = 0; i < pool.slotCount; i++)
+    pool.slots[i].stats = { };
+  pool.statsStart = Clock::now();
+}
@@ -0,0 +1,532 @@
+/**
+ * @file BuildingBatch.cpp
+ * @brief The implementation of instanced building drawing.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/BuildingBatch.h>
+#include <CityBuilder/Rendering/CommandRecorder.h>
+#include <CityBuilder/Rendering/Program.h>
+#include <CityBuilder/Rendering/StaticBatch.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+  typedef Buildings::Instance Instance;
+
+  /// How far past a level of detail boundary a chunk must be before it
+  /// changes level, as a fraction of the boundary distance.
+  const float hysteresis = 0.1f;
+
+  /// How far parts of a building may reach past its placement, such as
+  /// awnings and chimneys, as a fraction of its size.
+  const float overhang = 0.1f;
+
+  /// The colors of the shared meshes, as ABGR: an alpha of 255 tints the
+  /// color by the color of each building, an alpha of 0 keeps it as it is.
+  enum : uint32_t {
+    wall    = 0xffffffff,
+    trim    = 0xffc0c0c0,
+    roof    = 0x00303a8a,
+    flat    = 0x00505458,
+    glass   = 0x00705a40,
+    awning  = 0x003040b0,
+    brick   = 0x00304080,
+  };
+
+  /// A vertex of the shared building meshes.
+  struct Vertex {
+    float x, y, z;
+    float nx, ny, nz;
+    uint32_t color;
+  };
+
+  /// A point of the shared building meshes.
+  struct Point {
+    float x, y, z;
+  };
+
+  /// Builds a shared building mesh out of flat faces, in building space: X
+  /// across the front of the lot, Y up and Z back from the road, within the
+  /// unit box from -0.5 to 0.5 across and back and 0 to 1 up, with the front
+  /// of the building at Z = -0.5.
+  struct MeshBuilder {
+    List<Vertex> vertices { };
+    List<uint16_t> indices { };
+
+    /// Add a flat convex face, wound to face outwards.
+    /// \param[in] points
+    ///   The corners of the face, in order around it either way.
+    /// \param[in] count
+    ///   The number of corners.
+    /// \param[in] outward
+    ///   A direction that the face should face towards.
+    /// \param[in] color
+    ///   The color of the face.
+    void face(const Point *points, int count, Point outward, uint32_t color) {
+      Point a = points[0], b = points[1], c = points[2];
+      float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+      float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+      float nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+      bool reversed = nx * outward.x + ny * outward.y + nz * outward.z < 0;
+      float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+      if (reversed)
+        length = -length;
+      nx /= length; ny /= length; nz /= length;
+
+      // Counter-clockwise corners about the normal, wound as the rest of the
+      // meshes are
+      uint16_t first = (uint16_t)vertices.count();
+      for (int i = 0; i < count; i++) {
+        const Point &point = points[reversed ? count - 1 - i : i];
+        vertices.append({ point.x, point.y, point.z, nx, ny, nz, color });
+      }
+      for (int i = 1; i + 1 < count; i++) {
+        indices.append(first);
+        indices.append(first + i + 1);
+        indices.append(first + i);
+      }
+    }
+
+    /// Add a quad, wound to face outwards.
+    void quad(Point a, Point b, Point c, Point d, Point outward, uint32_t color) {
+      Point points[] = { a, b, c, d };
+      face(points, 4, outward, color);
+    }
+
+    /// Add a box standing on the ground or on another part, without its
+    /// bottom.
+    /// \param[in] min
+    ///   The lowest corner of the box.
+    /// \param[in] max
+    ///   The highest corner of the box.
+    /// \param[in] sides
+    ///   The color of the sides of the box.
+    /// \param[in] top
+    ///   The color of the top of the box.
+    void box(Point min, Point max, uint32_t sides, uint32_t top) {
+      float x0 = min.x, y0 = min.y, z0 = min.z, x1 = max.x, y1 = max.y, z1 = max.z;
+      quad({ x0, y0, z0 }, { x1, y0, z0 }, { x1, y1, z0 }, { x0, y1, z0 }, { 0, 0, -1 }, sides);
+      quad({ x0, y0, z1 }, { x1, y0, z1 }, { x1, y1, z1 }, { x0, y1, z1 }, { 0, 0,  1 }, sides);
+      quad({ x0, y0, z0 }, { x0, y0, z1 }, { x0, y1, z1 }, { x0, y1, z0 }, { -1, 0, 0 }, sides);
+      quad({ x1, y0, z0 }, { x1, y0, z1 }, { x1, y1, z1 }, { x1, y1, z0 }, {  1, 0, 0 }, sides);
+      quad({ x0, y1, z0 }, { x1, y1, z0 }, { x1, y1, z1 }, { x0, y1, z1 }, { 0, 1, 0 }, top);
+    }
+
+    /// Add walls with a gabled roof, its ridge running across the front.
+    /// \param[in] eaves
+    ///   The height of the walls.
+    /// \param[in] eave
+    ///   How far the roof reaches past the walls.
+    void gable(float eaves, float eave) {
+      box({ -0.5f, 0, -0.5f }, { 0.5f, eaves, 0.5f }, wall, roof);
+
+      // The gable ends, then the slopes reaching out past the walls
+      float rise = 1 - eaves, drop = rise * eave / 0.5f;
+      for (float x : { -0.5f, 0.5f }) {
+        Point points[] = { { x, eaves, -0.5f }, { x, eaves, 0.5f }, { x, 1, 0 } };
+        face(points, 3, { x, 0, 0 }, wall);
+      }
+      for (float z : { -0.5f, 0.5f }) {
+        float reach = z < 0 ? z - eave : z + eave;
+        quad({ -0.5f - eave, eaves - drop, reach }, { 0.5f + eave, eaves - drop, reach },
+          { 0.5f + eave, 1, 0 }, { -0.5f - eave, 1, 0 }, { 0, 0.5f, z }, roof);
+      }
+    }
+
+    /// Add a prism with a regular polygon for its base.
+    /// \param[in] x, z
+    ///   The center of the base.
+    /// \param[in] radius
+    ///   The distance from the center to the corners of the base.
+    /// \param[in] sides
+    ///   The number of sides of the base.
+    /// \param[in] y0, y1
+    ///   The bottom and top of the prism.
+    void prism(float x, float z, float radius, int sides, float y0, float y1, uint32_t color) {
+      Point top[16];
+      for (int i = 0; i < sides; i++) {
+        float angle = 6.2831853f * i / sides;
+        top[i] = { x + radius * std::cos(angle), y1, z + radius * std::sin(angle) };
+      }
+      for (int i = 0; i < sides; i++) {
+        Point a = top[i], b = top[(i + 1) % sides];
+        quad({ a.x, y0, a.z }, { b.x, y0, b.z }, b, a,
+          { (a.x + b.x) * 0.5f - x, 0, (a.z + b.z) * 0.5f - z }, color);
+      }
+      face(top, sides, { 0, 1, 0 }, flat);
+    }
+
+    /// Add a sawtooth roof over walls, its teeth running across the front
+    /// and its glazing facing away from the road.
+    /// \param[in] eaves
+    ///   The height of the walls.
+    /// \param[in] teeth
+    ///   The number of teeth.
+    void sawtooth(float eaves, int teeth) {
+      box({ -0.5f, 0, -0.5f }, { 0.5f, eaves, 0.5f }, wall, flat);
+      for (int i = 0; i < teeth; i++) {
+        float z0 = -0.5f + float(i) / teeth, z1 = -0.5f + float(i + 1) / teeth;
+        quad({ -0.5f, eaves, z0 }, { 0.5f, eaves, z0 }, { 0.5f, 1, z1 }, { -0.5f, 1, z1 },
+          { 0, 1, z0 - z1 }, roof);
+        quad({ -0.5f, eaves, z1 }, { 0.5f, eaves, z1 }, { 0.5f, 1, z1 }, { -0.5f, 1, z1 },
+          { 0, 0, 1 }, glass);
+        for (float x : { -0.5f, 0.5f }) {
+          Point points[] = { { x, eaves, z0 }, { x, eaves, z1 }, { x, 1, z1 } };
+          face(points, 3, { x, 0, 0 }, wall);
+        }
+      }
+    }
+  };
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  /// Whether instances can be drawn at all.
+  bool supported() {
+    return bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING;
+  }
+
+  /// The distance from the camera at which a chunk leaves a level of detail
+  /// for the next, the last being drawn as impostors.
+  float levelDistance(int level) {
+    return level < BuildingBatch::levels - 1 ?
+      StaticBatch::levelDistances[level] : BuildingBatch::impostorDistance;
+  }
+}
+
+
+
+BuildingBatch::~BuildingBatch() {
+  if (_hasMeshes)
+    for (int mesh = 0; mesh < Buildings::archetypes * levels + 1; mesh++) {
+      bgfx::destroy(_vertices[mesh]);
+      bgfx::destroy(_indices[mesh]);
+    }
+  for (const _chunk &chunk : _chunks)
+    if (bgfx::isValid(chunk.instances))
+      bgfx::destroy(chunk.instances);
+}
+
+
+
+void BuildingBatch::update(const Buildings &buildings, double budget) {
+  if (!supported())
+    return;
+  Clock::time_point start = Clock::now();
+
+  // Sort the buildings that changed into their chunks, or every building if
+  // any changes were missed
+  if (buildings.version() != _version) {
+    if (buildings.version() == _version + 1)
+      for (uint32_t lot : buildings.changed())
+        _place(buildings, lot);
+    else {
+      size_t slots = std::max(_chunkOf.count(), buildings.buildings().count());
+      for (size_t lot = 0; lot < slots; lot++)
+        _place(buildings, (uint32_t)lot);
+    }
+    _version = buildings.version();
+  }
+
+  // Upload the chunks that changed, at least one per update
+  while (!_dirty.isEmpty()) {
+    uint32_t chunk = _dirty[_dirty.count() - 1];
+    _dirty.remove(_dirty.count() - 1);
+    _upload(buildings, chunk);
+    if (since(start) >= budget)
+      break;
+  }
+
+  _stats.uploadTime += since(start);
+}
+
+void BuildingBatch::draw(const Frustum &frustum, Real3 eye, Frustum::Stats &stats) {
+  _drawCalls = 0;
+  _triangles = 0;
+  if (_count == 0 || !supported())
+    return;
+  if (!_hasMeshes)
+    _createMeshes();
+
+  // Find the visible chunks and their levels of detail
+  Clock::time_point start = Clock::now();
+  _visible.removeAll();
+  for (size_t id = 0; id < _chunks.count(); id++) {
+    _chunk &chunk = _chunks[id];
+    int uploaded = (int)chunk.ranges[Buildings::archetypes];
+    if (uploaded == 0)
+      continue;
+    if (!frustum.intersects(chunk.bounds)) {
+      stats.culled += uploaded;
+      continue;
+    }
+    stats.visible += uploaded;
+
+    // Choose the level of detail from the distance to the closest point of
+    // the chunk, only moving past a boundary once well clear of it
+    Real3 closest = eye.max(chunk.bounds.origin).min(chunk.bounds.origin + chunk.bounds.size);
+    float distance = (float)closest.distance(eye);
+    while (chunk.level < levels && distance > levelDistance(chunk.level) * (1 + hysteresis))
+      chunk.level++;
+    while (chunk.level > 0 && distance < levelDistance(chunk.level - 1) * (1 - hysteresis))
+      chunk.level--;
+
+    if (chunk.level == levels)
+      _triangles += (size_t)uploaded * _meshTriangles[Buildings::archetypes * levels];
+    else
+      for (int archetype = 0; archetype < Buildings::archetypes; archetype++)
+        _triangles += (size_t)(chunk.ranges[archetype + 1] - chunk.ranges[archetype]) *
+          _meshTriangles[archetype * levels + chunk.level];
+    _visible.append((uint32_t)id);
+  }
+  double culling = since(start);
+  stats.time += culling;
+  _stats.cullTime += culling;
+  _stats.frames++;
+
+  // Draw the visible chunks, a range of chunks per task
+  for (size_t first = 0; first < _visible.count(); first += chunksPerTask)
+    CommandRecorder::add("buildings", [this, first](bgfx::Encoder *encoder) {
+      _drawCalls += _draw(encoder, first, chunksPerTask);
+    });
+}
+
+
+
+void BuildingBatch::_place(const Buildings &buildings, uint32_t lot) {
+  while (_chunkOf.count() <= lot) {
+    _chunkOf.append(UINT32_MAX);
+    _slotOf.append(0);
+  }
+
+  // Take the lot out of its chunk, moving the last building of the chunk
+  // into its slot
+  uint32_t previous = _chunkOf[lot];
+  if (previous != UINT32_MAX) {
+    _chunk &chunk = _chunks[previous];
+    uint32_t slot = _slotOf[lot], last = chunk.buildings[chunk.buildings.count() - 1];
+    chunk.buildings[slot] = last;
+    _slotOf[last] = slot;
+    chunk.buildings.remove(chunk.buildings.count() - 1);
+    if (chunk.buildings.isEmpty())
+      _emptyChunks++;
+    if (!chunk.dirty) {
+      chunk.dirty = true;
+      _dirty.append(previous);
+    }
+    _chunkOf[lot] = UINT32_MAX;
+    _count--;
+  }
+
+  if (lot >= buildings.buildings().count())
+    return;
+  const Buildings::Building &building = buildings.buildings()[lot];
+  if (building.zone == nullptr)
+    return;
+
+  // Find the chunk that the building stands in, adding it if need be
+  int32_t x = (int32_t)std::floor(building.instance.x / chunkSize);
+  int32_t z = (int32_t)std::floor(building.instance.z / chunkSize);
+  uint64_t key = ((uint64_t)(uint32_t)x << 32) | (uint32_t)z;
+  auto found = _chunkIndex.find(key);
+  uint32_t id;
+  if (found == _chunkIndex.end()) {
+    id = (uint32_t)_chunks.count();
+    _chunks.append({ });
+    _chunkIndex[key] = id;
+    _emptyChunks++;
+  } else
+    id = found->second;
+
+  _chunk &chunk = _chunks[id];
+  if (chunk.buildings.isEmpty())
+    _emptyChunks--;
+  _slotOf[lot] = (uint32_t)chunk.buildings.count();
+  chunk.buildings.append(lot);
+  if (!chunk.dirty) {
+    chunk.dirty = true;
+    _dirty.append(id);
+  }
+  _chunkOf[lot] = id;
+  _count++;
+}
+
+void BuildingBatch::_upload(const Buildings &buildings, uint32_t id) {
+  _chunk &chunk = _chunks[id];
+  chunk.dirty = false;
+  const List<Buildings::Building> &all = buildings.buildings();
+
+  // Sort the placements by archetype, counting them first
+  uint32_t counts[Buildings::archetypes] = { 0 };
+  for (uint32_t lot : chunk.buildings)
+    counts[(int)all[lot].archetype]++;
+  chunk.ranges[0] = 0;
+  for (int archetype = 0; archetype < Buildings::archetypes; archetype++)
+    chunk.ranges[archetype + 1] = chunk.ranges[archetype] + counts[archetype];
+  if (chunk.buildings.isEmpty())
+    return;
+
+  const bgfx::Memory *memory = bgfx::alloc((uint32_t)(chunk.buildings.count() * sizeof(Instance)));
+  Instance *instances = (Instance *)memory->data;
+  uint32_t next[Buildings::archetypes];
+  for (int archetype = 0; archetype < Buildings::archetypes; archetype++)
+    next[archetype] = chunk.ranges[archetype];
+  float low[3] = { INFINITY, 0, INFINITY }, high[3] = { -INFINITY, 0, -INFINITY };
+  for (uint32_t lot : chunk.buildings) {
+    const Buildings::Building &building = all[lot];
+    const Instance &instance = building.instance;
+    instances[next[(int)building.archetype]++] = instance;
+
+    // Bound the building by its circle on the ground, reaching a little past
+    // its placement for its overhangs
+    float radius = (instance.width + instance.depth) * (0.5f + overhang);
+    low[0]  = std::min(low[0],  instance.x - radius);
+    low[2]  = std::min(low[2],  instance.z - radius);
+    high[0] = std::max(high[0], instance.x + radius);
+    high[2] = std::max(high[2], instance.z + radius);
+    high[1] = std::max(high[1], instance.height * (1 + overhang));
+  }
+  chunk.bounds = Bounds3(
+    Real3(low[0], low[1], low[2]), Real3(high[0] - low[0], high[1] - low[1], high[2] - low[2]));
+
+  if (!bgfx::isValid(chunk.instances)) {
+    bgfx::VertexLayout layout;
+    layout.begin()
+        .add(bgfx::Attrib::TexCoord7, 4, bgfx::AttribType::Float)
+        .add(bgfx::Attrib::TexCoord6, 4, bgfx::AttribType::Float)
+      .end();
+    chunk.instances = bgfx::createDynamicVertexBuffer(memory, layout, BGFX_BUFFER_ALLOW_RESIZE);
+  } else
+    bgfx::update(chunk.instances, 0, memory);
+  _stats.uploads++;
+}
+
+int BuildingBatch::_draw(bgfx::Encoder *encoder, size_t first, size_t count) const {
+  int calls = 0;
+  size_t last = std::min(first + count, _visible.count());
+  const int impostor = Buildings::archetypes * levels;
+  for (size_t i = first; i < last; i++) {
+    const _chunk &chunk = _chunks.begin()[_visible.begin()[i]];
+
+    if (chunk.level == levels) {
+      // Every building of the chunk as an impostor, seen from either side
+      encoder->setVertexBuffer(0, _vertices[impostor]);
+      encoder->setIndexBuffer(_indices[impostor]);
+      encoder->setInstanceDataBuffer(chunk.instances, 0, chunk.ranges[Buildings::archetypes]);
+      encoder->setState(BGFX_STATE_DEFAULT & ~BGFX_STATE_CULL_MASK);
+      Program::buildingImpostor->submit(encoder);
+      calls++;
+      continue;
+    }
+
+    // Each archetype with its mesh at the chunk's level of detail
+    for (int archetype = 0; archetype < Buildings::archetypes; archetype++) {
+      uint32_t start = chunk.ranges[archetype], end = chunk.ranges[archetype + 1];
+      if (start == end)
+        continue;
+      int mesh = archetype * levels + chunk.level;
+      encoder->setVertexBuffer(0, _vertices[mesh]);
+      encoder->setIndexBuffer(_indices[mesh]);
+      encoder->setInstanceDataBuffer(chunk.instances, start, end - start);
+      encoder->setState(BGFX_STATE_DEFAULT);
+      Program::building->submit(encoder);
+      calls++;
+    }
+  }
+  return calls;
+}
+
+void BuildingBatch::_createMeshes() {
+  MeshBuilder meshes[Buildings::archetypes * levels + 1];
+  auto mesh = [&](Buildings::Archetype archetype, int level) -> MeshBuilder & {
+    return meshes[(int)archetype * levels + level];
+  };
+
+  // A house with a gabled roof and a chimney, losing the eaves and then the
+  // roof with distance
+  mesh(Buildings::Archetype::house, 0).gable(0.6f, 0.06f);
+  mesh(Buildings::Archetype::house, 0).box({ 0.22f, 0.6f, 0.1f }, { 0.32f, 1, 0.22f }, brick, flat);
+  mesh(Buildings::Archetype::house, 1).gable(0.6f, 0);
+  mesh(Buildings::Archetype::house, 2).box({ -0.5f, 0, -0.5f }, { 0.5f, 0.75f, 0.5f }, wall, roof);
+
+  // An L-shaped block of apartments with plant on its roof
+  for (int level = 0; level < 2; level++) {
+    MeshBuilder &apartments = mesh(Buildings::Archetype::apartments, level);
+    apartments.box({ -0.5f, 0, -0.5f }, { 0.5f, 0.95f, 0 }, wall, flat);
+    apartments.box({ -0.5f, 0, 0 }, { -0.05f, 0.95f, 0.5f }, wall, flat);
+    if (level == 0) {
+      apartments.box({ -0.15f, 0.95f, -0.35f }, { 0.15f, 1, -0.15f }, trim, flat);
+      apartments.quad({ -0.1f, 0, -0.502f }, { 0.1f, 0, -0.502f }, { 0.1f, 0.08f, -0.502f },
+        { -0.1f, 0.08f, -0.502f }, { 0, 0, -1 }, glass);
+    }
+  }
+  mesh(Buildings::Archetype::apartments, 2).box({ -0.5f, 0, -0.5f }, { 0.5f, 0.95f, 0.5f }, wall, flat);
+
+  // A shop with a shop window and an awning over it
+  for (int level = 0; level < 2; level++) {
+    MeshBuilder &shop = mesh(Buildings::Archetype::shop, level);
+    shop.box({ -0.5f, 0, -0.5f }, { 0.5f, 1, 0.5f }, wall, flat);
+    shop.quad({ -0.4f, 0.05f, -0.502f }, { 0.4f, 0.05f, -0.502f }, { 0.4f, 0.55f, -0.502f },
+      { -0.4f, 0.55f, -0.502f }, { 0, 0, -1 }, glass);
+    if (level == 0)
+      shop.quad({ -0.45f, 0.62f, -0.5f }, { 0.45f, 0.62f, -0.5f }, { 0.45f, 0.52f, -0.6f },
+        { -0.45f, 0.52f, -0.6f }, { 0, 1, -1 }, awning);
+  }
+  mesh(Buildings::Archetype::shop, 2).box({ -0.5f, 0, -0.5f }, { 0.5f, 1, 0.5f }, wall, flat);
+
+  // An office tower on a podium with a crown on its roof
+  for (int level = 0; level < 2; level++) {
+    MeshBuilder &tower = mesh(Buildings::Archetype::tower, level);
+    tower.box({ -0.5f, 0, -0.5f }, { 0.5f, 0.12f, 0.5f }, trim, flat);
+    tower.box({ -0.32f, 0.12f, -0.32f }, { 0.32f, 0.95f, 0.32f }, wall, flat);
+    if (level == 0)
+      tower.box({ -0.2f, 0.95f, -0.2f }, { 0.2f, 1, 0.2f }, trim, flat);
+  }
+  mesh(Buildings::Archetype::tower, 2).box({ -0.4f, 0, -0.4f }, { 0.4f, 1, 0.4f }, wall, flat);
+
+  // A shed with a sawtooth roof, losing teeth with distance
+  mesh(Buildings::Archetype::shed, 0).sawtooth(0.7f, 4);
+  mesh(Buildings::Archetype::shed, 1).sawtooth(0.7f, 2);
+  mesh(Buildings::Archetype::shed, 2).box({ -0.5f, 0, -0.5f }, { 0.5f, 0.85f, 0.5f }, wall, roof);
+
+  // A U-shaped factory around a yard with a chimney, round and then square
+  for (int level = 0; level < 2; level++) {
+    MeshBuilder &factory = mesh(Buildings::Archetype::factory, level);
+    factory.box({ -0.5f, 0, 0.1f }, { 0.5f, 0.7f, 0.5f }, wall, flat);
+    factory.box({ -0.5f, 0, -0.5f }, { -0.2f, 0.6f, 0.1f }, wall, flat);
+    factory.box({ 0.2f, 0, -0.5f }, { 0.5f, 0.6f, 0.1f }, wall, flat);
+    if (level == 0)
+      factory.prism(0.3f, 0.3f, 0.06f, 8, 0.7f, 1, brick);
+    else
+      factory.box({ 0.25f, 0.7f, 0.25f }, { 0.35f, 1, 0.35f }, brick, flat);
+  }
+  mesh(Buildings::Archetype::factory, 2).box({ -0.5f, 0, -0.5f }, { 0.5f, 0.7f, 0.5f }, wall, flat);
+
+  // The impostor: a single quad that the impostor shader turns to face the
+  // camera and sizes to the building
+  meshes[Buildings::archetypes * levels].quad(
+    { -0.5f, 0, 0 }, { 0.5f, 0, 0 }, { 0.5f, 1, 0 }, { -0.5f, 1, 0 }, { 0, 0, -1 }, wall);
+
+  bgfx::VertexLayout layout;
+  layout.begin()
+      .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
+      .add(bgfx::Attrib::Normal  , 3, bgfx::AttribType::Float)
+      .add(bgfx::Attrib::Color0  , 4, bgfx::AttribType::Uint8, true)
+    .end();
+  for (int id = 0; id < Buildings::archetypes * levels + 1; id++) {
+    const MeshBuilder &builder = meshes[id];
+    _vertices[id] = bgfx::createVertexBuffer(bgfx::copy(builder.vertices.begin(),
+      (uint32_t)(builder.vertices.count() * sizeof(Vertex))), layout);
+    _indices[id] = bgfx::createIndexBuffer(bgfx::copy(builder.indices.begin(),
+      (uint32_t)(builder.indices.count() * sizeof(uint16_t))));
+    _meshTriangles[id] = (uint32_t)(builder.indices.count() / 3);
+  }
+  _hasMeshes = true;
+}
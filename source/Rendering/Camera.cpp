@@ -29,7 +29,7 @@ Real4x4 Camera::viewMatrix() const {
 }
 
 Real4x4 Camera::viewProjection() const {
-  return projectionMatrix.transpose() * viewMatrix();
+  return projectionMatrix * viewMatrix();
 }
 
 
@@ -14,6 +14,7 @@ ColorMesh::~ColorMesh() {
     // Unload the mesh from the GPU
     bgfx::destroy(_vertexBuffer);
     bgfx::destroy(_indexBuffer);
+    VertexPacking::untrack(_packed, _loadedVertices, _vertexBytes, _indexBytes);
     
     // Safety
     loaded = false;
@@ -22,14 +23,14 @@ ColorMesh::~ColorMesh() {
 
 ColorMesh &ColorMesh::add(const List<Vertex> &vertices, const List<int> &indices) {
   // Store the index offset
-  uint16_t offset = _vertices.count();
+  uint32_t offset = _vertices.count();
   
   // Add the vertices
   _vertices.appendList(vertices);
   
   // Add the offset indices
   for (int index : indices)
-    _indices.append((uint16_t)index + offset);
+    _indices.append((uint32_t)index + offset);
   
   return *this;
 }
@@ -37,7 +38,7 @@ ColorMesh &ColorMesh::add(const List<Vertex> &vertices, const List<int> &indices
 
 
 ColorMesh &ColorMesh::extrude(const ProfileMesh &profile, Path2 &path, Color4 color, Real2 offset, Real scale) {
-  uint16_t indexOffset = _vertices.count();
+  uint32_t indexOffset = _vertices.count();
   
   // Get the path points
   List<Real4> points = path.pointNormals();
@@ -100,20 +101,52 @@ void ColorMesh::load() {
     // Nothing to load
     return;
   
-  // Create the vertex buffer
-  bgfx::VertexLayout layout;
-  layout.begin()
-      .add(bgfx::Attrib::Position , 3, bgfx::AttribType::Float)
-      .add(bgfx::Attrib::Normal   , 3, bgfx::AttribType::Float)
-      .add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float)
-      .add(bgfx::Attrib::Color0   , 4, bgfx::AttribType::Uint8, true)
-  .end();
-  _vertexBuffer = bgfx::createVertexBuffer(
-    bgfx::copy(&_vertices[0], sizeof(Vertex) * _vertices.count()), layout);
+  // Capture the bounds for culling
+  _boundingBox = Bounds3(_vertices.first().position);
+  for (const Vertex &vertex : _vertices)
+    _boundingBox.fit(vertex.position);
+  
+  if (VertexPacking::enabled()) {
+    // Pack the vertices relative to the bounds of the mesh
+    _transform = VertexPacking::fit(
+      &_vertices[0].position, _vertices.count(), sizeof(Vertex));
+    
+    List<VertexPacking::ColorVertex> packed { };
+    for (const Vertex &vertex : _vertices) {
+      VertexPacking::ColorVertex packedVertex;
+      VertexPacking::pack(packedVertex, _transform,
+        vertex.position, vertex.normal, vertex.uv);
+      packedVertex.color = vertex.color;
+      packed.append(packedVertex);
+    }
+    
+    // Create the vertex buffer
+    _vertexBytes = sizeof(VertexPacking::ColorVertex) * packed.count();
+    _vertexBuffer = bgfx::createVertexBuffer(
+      bgfx::copy(&packed[0], _vertexBytes), VertexPacking::colorLayout());
+    _packed = true;
+  } else {
+    // Create the vertex buffer
+    _vertexBytes = sizeof(Vertex) * _vertices.count();
+    bgfx::VertexLayout layout;
+    layout.begin()
+        .add(bgfx::Attrib::Position , 3, bgfx::AttribType::Float)
+        .add(bgfx::Attrib::Normal   , 3, bgfx::AttribType::Float)
+        .add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float)
+        .add(bgfx::Attrib::Color0   , 4, bgfx::AttribType::Uint8, true)
+    .end();
+    _vertexBuffer = bgfx::createVertexBuffer(
+      bgfx::copy(&_vertices[0], _vertexBytes), layout);
+  }
   
   // Create the index buffer
   _indexBuffer = bgfx::createIndexBuffer(
-    bgfx::copy(&_indices[0], sizeof(uint16_t) * _indices.count()));
+    _indices.copy(), _indices.flags());
+  _indexBytes = _indices.bytes();
+  
+  // Account for the GPU memory
+  _loadedVertices = _vertices.count();
+  VertexPacking::track(_packed, _loadedVertices, _vertexBytes, _indexBytes);
   
   // Clear the user mesh data
   _vertices.removeAll();
@@ -122,27 +155,42 @@ void ColorMesh::load() {
   loaded = true;
 }
 
-void ColorMesh::draw(Resource<Program> shader) const {
+bool ColorMesh::setBuffers(bgfx::Encoder *encoder) const {
   if (!loaded)
     // Safety
-    return;
+    return false;
   
+  if (_packed) {
+    // Restore the packed positions
+    float transform[16];
+    _transform.matrix(transform);
+    encoder->setTransform(transform);
+  }
+  encoder->setVertexBuffer(0, _vertexBuffer);
+  encoder->setIndexBuffer(_indexBuffer);
+  return true;
+}
+
+void ColorMesh::draw(bgfx::Encoder *encoder, const Resource<Program> &shader) const {
   // Submit the mesh to the GPU for rendering
-  bgfx::setVertexBuffer(0, _vertexBuffer);
-  bgfx::setIndexBuffer(_indexBuffer);
-  shader->submit();
+  if (!setBuffers(encoder))
+    return;
+  shader->submit(encoder);
 }
 
-void ColorMesh::draw(Resource<Material> material) const {
+void ColorMesh::draw(bgfx::Encoder *encoder, const Resource<Material> &material) const {
   // Submit the material
-  bgfx::setUniform(Uniforms::u_textureTile, { material->textureTile });
+  encoder->setUniform(Uniforms::u_textureTile, { material->textureTile });
   if (material->texture)
-    material->texture->load(Uniforms::s_albedo);
+    material->texture->load(encoder, Uniforms::s_albedo);
   // TODO
   
   // Submit the mesh to the GPU for rendering
-  bgfx::setVertexBuffer(0, _vertexBuffer);
-  bgfx::setIndexBuffer(_indexBuffer);
-  bgfx::setState(BGFX_STATE_DEFAULT);
-  material->shader->submit();
+  if (!setBuffers(encoder)) {
+    // Don't leave the material bound to the next draw
+    encoder->discard();
+    return;
+  }
+  encoder->setState(BGFX_STATE_DEFAULT);
+  material->shader->submit(encoder);
 }
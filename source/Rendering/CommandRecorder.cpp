@@ -0,0 +1,176 @@
+/**
+ * @file CommandRecorder.cpp
+ * @brief The implementation of parallel draw call recording.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/CommandRecorder.h>
+#include <CityBuilder/Jobs.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// A task added to the current frame.
+  struct Job {
+    /// The name of the task.
+    const char *name;
+
+    /// The task to record.
+    CommandRecorder::Task task;
+
+    /// The time spent recording the task, in microseconds.
+    /// \remarks
+    ///   Only written by the thread that recorded the task.
+    double time = 0;
+  };
+
+  /// The requested number of worker threads, or -1 for every worker thread
+  /// of `Jobs`.
+  int requestedThreads = -1;
+
+  /// The tasks of the current frame.
+  /// \remarks
+  ///   Only changed by the main thread while no frame is being recorded.
+  std::vector<Job> jobs;
+
+  /// The next task to be taken.
+  std::atomic<size_t> nextJob { 0 };
+
+  /// The setup of each encoder for the frame being recorded.
+  const CommandRecorder::Task *frameSetup = nullptr;
+
+  /// The number of worker threads to record with.
+  int workers = 0;
+
+  /// The number of encoders that recorded the current frame alongside the
+  /// main encoder.
+  std::atomic<int> helped { 0 };
+
+  /// The time spent recording the last frame.
+  CommandRecorder::Stats lastStats;
+
+  /// The time spent recording every frame so far.
+  CommandRecorder::Totals allFrames;
+
+
+
+  /// Record tasks until none remain.
+  /// \param[in] encoder
+  ///   The encoder to record the tasks with.
+  void drain(bgfx::Encoder *encoder) {
+    bool setup = false;
+    for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+      Clock::time_point start = Clock::now();
+      if (!setup) {
+        (*frameSetup)(encoder);
+        setup = true;
+      }
+      jobs[i].task(encoder);
+      jobs[i].time = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+  }
+
+  /// Record tasks with a worker encoder, if any are left.
+  void help() {
+    // Tasks may all have been taken by the time the job runs
+    if (nextJob.load() >= jobs.size())
+      return;
+
+    // Encoders may run out, in which case the others take the tasks
+    if (bgfx::Encoder *encoder = bgfx::begin(true)) {
+      helped++;
+      drain(encoder);
+      bgfx::end(encoder);
+    }
+  }
+}
+
+
+
+void CommandRecorder::setThreads(int threads) {
+  requestedThreads = threads;
+}
+
+void CommandRecorder::start() {
+  // Leave the main encoder to the main thread
+  int threads = requestedThreads;
+  if (threads < 0 || threads > Jobs::threads())
+    threads = Jobs::threads();
+  workers = std::min(threads, (int)bgfx::getCaps()->limits.maxEncoders - 1);
+}
+
+void CommandRecorder::stop() {
+  workers = 0;
+  jobs.clear();
+}
+
+int CommandRecorder::threads() {
+  return workers;
+}
+
+
+
+void CommandRecorder::add(const char *name, Task task) {
+  jobs.push_back({ name, std::move(task) });
+}
+
+void CommandRecorder::record(const Task &setup) {
+  Clock::time_point start = Clock::now();
+  frameSetup = &setup;
+  nextJob = 0;
+
+  helped = 0;
+
+  // Add helpers only when there is more than one task to share
+  Jobs::Counter helpers;
+  if (jobs.size() > 1)
+    for (int i = 0; i < workers; i++)
+      Jobs::run("record", help, &helpers);
+
+  // Record alongside the workers
+  bgfx::Encoder *encoder = bgfx::begin();
+  drain(encoder);
+  bgfx::end(encoder);
+  Jobs::wait(helpers);
+
+  // Gather the timings
+  lastStats.threads = helped.load() + 1;
+  lastStats.time = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  lastStats.serial = 0;
+  lastStats.tasks.removeAll();
+  for (const Job &job : jobs) {
+    lastStats.serial += job.time;
+    lastStats.tasks.append({ job.name, job.time });
+
+    List<CommandRecorder::Total> &tasks = allFrames.tasks;
+    auto total = std::find_if(tasks.begin(), tasks.end(),
+      [&](const CommandRecorder::Total &total) { return strcmp(total.name, job.name) == 0; });
+    if (total == tasks.end())
+      tasks.append({ job.name, job.time, 1 });
+    else {
+      total->time += job.time;
+      total->count++;
+    }
+  }
+  allFrames.time   += lastStats.time;
+  allFrames.serial += lastStats.serial;
+  allFrames.frames++;
+
+  jobs.clear();
+  frameSetup = nullptr;
+}
+
+const CommandRecorder::Stats &CommandRecorder::stats() {
+  return lastStats;
+}
+
+const CommandRecorder::Totals &CommandRecorder::totals() {
+  return allFrames;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file CurveExtrusion.cpp
+ * @brief The implementation of cross-sections extruded on the GPU.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/CurveExtrusion.h>
+#include <algorithm>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// Whether paths are extruded on the GPU, when supported.
+  bool extrusionEnabled = false;
+
+  /// The time spent meshing paths since the last reset.
+  CurveExtrusion::Stats totals;
+}
+
+
+
+void CurveExtrusion::setEnabled(bool enabled) {
+  extrusionEnabled = enabled;
+}
+
+bool CurveExtrusion::enabled() {
+  return extrusionEnabled && (bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING);
+}
+
+
+
+void CurveExtrusion::addStrip(Mesh &mesh, const ProfileMesh &profile, Real2 offset, Real scale) {
+  List<Mesh::Vertex> vertices { };
+  List<int> indices { };
+
+  for (int row = 0; row <= rows; row++) {
+    Real along = Real(row) / Real(rows);
+
+    // Add the cross-section, placed along the path by the shader
+    for (const ProfileMesh::Vertex &vertex : profile.vertices)
+      vertices.append({
+        { (vertex.position.x + offset.x) * scale, (vertex.position.y + offset.y) * scale, 0 },
+        { vertex.normal.x, vertex.normal.y, 0 },
+        { vertex.uv, along }
+      });
+
+    if (row > 0) {
+      // Connect triangles with the previous row, as `Mesh::extrude` does
+      int prev = (row - 1) * (int)profile.vertices.count();
+      int curr = prev + (int)profile.vertices.count();
+      for (intptr_t j = 0; j < profile.triangles.count(); j += 2) {
+        indices.append(prev + profile.triangles[j    ]);
+        indices.append(prev + profile.triangles[j + 1]);
+        indices.append(curr + profile.triangles[j    ]);
+
+        indices.append(curr + profile.triangles[j    ]);
+        indices.append(prev + profile.triangles[j + 1]);
+        indices.append(curr + profile.triangles[j + 1]);
+      }
+    }
+  }
+
+  mesh.add(vertices, indices);
+}
+
+void CurveExtrusion::place(InstanceBatch &batch, const void *owner, Texture *material, const Resource<Mesh> &strip, Path2 &path, int stride, int level) {
+  List<Real4> points = path.pointNormals();
+  if (points.count() < 2)
+    // Nothing to extrude over
+    return;
+
+  // The control points of the path as a cubic Bézier curve
+  Real2 p0 = path.start, p1, p2, p3 = path.end;
+  if (path.type() == Path2::Type::bezier) {
+    Bezier2 &curve = static_cast<Bezier2 &>(path);
+    p1 = curve.control1;
+    p2 = curve.control2;
+  } else {
+    p1 = p0 + (p3 - p0) * Real2(1.0 / 3.0);
+    p2 = p0 + (p3 - p0) * Real2(2.0 / 3.0);
+  }
+
+  // How far the strip reaches across and above the path
+  const Bounds3 &section = strip->boundingBox();
+  Real reach = (Real(0) - section.origin.x).max(section.origin.x + section.size.x);
+
+  // Cover the path points with strips, each as long as `rows` rows would be
+  // when extruded on the CPU
+  int last = (int)points.count() - 1;
+  int span = rows * std::max(stride, 1);
+  Real length = path.length();
+  for (int first = 0; first < last; first += span) {
+    int end = std::min(first + span, last);
+
+    // Find the curve parameters of the ends of the strip, which are evenly
+    // spaced along the path rather than the curve
+    Real t0 = first == 0 ? Real(0) : path.inverse({ points[first].x, points[first].y });
+    Real t1 = end == last ? Real(1) : path.inverse({ points[end].x, points[end].y });
+
+    InstanceBatch::Instance instance;
+    float *data = instance.transform;
+    data[ 0] = p0.x; data[ 1] = p0.y; data[ 2] = p1.x; data[ 3] = p1.y;
+    data[ 4] = p2.x; data[ 5] = p2.y; data[ 6] = p3.x; data[ 7] = p3.y;
+    data[ 8] = t0;   data[ 9] = t1;
+    data[10] = Real(first) / Real(last) * length;
+    data[11] = Real(end  ) / Real(last) * length;
+    data[12] = data[13] = data[14] = data[15] = 0;
+
+    // Bound the path points that the strip covers, widened by the section
+    Bounds3 bounds;
+    for (int i = first; i <= end; i++) {
+      Real3 point = { points[i].x, section.origin.y, points[i].y };
+      if (i == first)
+        bounds = Bounds3(point);
+      else
+        bounds.fit(point);
+    }
+    bounds.origin = bounds.origin - Real3(reach, 0, reach);
+    bounds.size   = bounds.size + Real3(reach * Real(2), section.size.y, reach * Real(2));
+
+    batch.add(owner, material, strip, instance, bounds, level);
+    totals.strips++;
+  }
+}
+
+
+
+void CurveExtrusion::track(size_t paths, double time) {
+  totals.paths += paths;
+  totals.time += time;
+}
+
+CurveExtrusion::Stats CurveExtrusion::stats() {
+  return totals;
+}
+
+void CurveExtrusion::resetStats() {
+  totals = { };
+}
@@ -0,0 +1,262 @@
+/**
+ * @file DrawList.cpp
+ * @brief The implementation of sorted draw lists.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/DrawList.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <utility>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// The positions of the fields of a sort key, from the most significant.
+  /// \remarks
+  ///   The view, blending and program come first to match the order of
+  ///   bgfx's own sort keys.
+  enum : int {
+    viewShift    = 56,
+    blendShift   = 54,
+    programShift = 40,
+    textureShift = 24,
+    stateShift   = 12,
+    uniformShift = 0,
+  };
+
+  /// The largest interned state or uniform index that fits in a sort key.
+  constexpr uint64_t internLimit = 0xFFF;
+
+  /// The submit flags that keep the bindings and state of a draw call for
+  /// the next one.
+  constexpr uint8_t keepBindings =
+    BGFX_DISCARD_INDEX_BUFFER | BGFX_DISCARD_VERTEX_STREAMS |
+    BGFX_DISCARD_TRANSFORM    | BGFX_DISCARD_INSTANCE_DATA;
+
+  /// Whether lists are sorted and redundant bindings are skipped.
+  bool sortingEnabled = true;
+
+  /// The next depth to reserve for a list this frame.
+  std::atomic<uint32_t> nextDepth { 1 };
+
+  /// The lock for the statistics.
+  std::mutex statsMutex;
+
+  /// The cost of the lists submitted since the last reset.
+  DrawList::Stats totals;
+
+  /// Sort draws by their keys, keeping draws with equal keys in order.
+  /// \param[in] entries
+  ///   The draws to sort.
+  /// \param[in] scratch
+  ///   Space for as many draws, used between passes.
+  /// \param[in] count
+  ///   The number of draws.
+  /// \returns
+  ///   Whichever of `entries` and `scratch` holds the sorted draws.
+  /// \remarks
+  ///   A least significant digit radix sort over bytes, skipping any byte
+  ///   that is the same for every key (most of them, in practice).
+  template <typename Entry>
+  Entry *radixSort(Entry *entries, Entry *scratch, size_t count) {
+    for (int shift = 0; shift < 64; shift += 8) {
+      size_t histogram[256] = { };
+      for (size_t i = 0; i < count; i++)
+        histogram[(entries[i].key >> shift) & 0xFF]++;
+      if (histogram[(entries[0].key >> shift) & 0xFF] == count)
+        // Every key has the same byte here
+        continue;
+
+      size_t offset = 0;
+      for (size_t &bucket : histogram) {
+        size_t size = bucket;
+        bucket = offset;
+        offset += size;
+      }
+      for (size_t i = 0; i < count; i++)
+        scratch[histogram[(entries[i].key >> shift) & 0xFF]++] = entries[i];
+      std::swap(entries, scratch);
+    }
+    return entries;
+  }
+
+  /// Find the index of a value in a list, adding it if needed.
+  /// \param[in,out] values
+  ///   The values seen so far.
+  /// \param[in] value
+  ///   The value to find.
+  /// \param[in] equal
+  ///   Whether two values are the same.
+  /// \returns
+  ///   The index of the value, or `internLimit` once the list is full, in
+  ///   which case the value is sorted along with the other overflowing ones.
+  template <typename T, typename Equal>
+  uint64_t intern(List<T> &values, const T &value, Equal equal) {
+    for (size_t i = 0; i < values.count(); i++)
+      if (equal(values[i], value))
+        return i;
+    if (values.count() >= internLimit)
+      return internLimit;
+    values.append(value);
+    return values.count() - 1;
+  }
+
+  /// Whether two uniforms set the same value.
+  bool sameUniform(const DrawList::Uniform &a, const DrawList::Uniform &b) {
+    return a.handle.idx == b.handle.idx && memcmp(a.value, b.value, sizeof(a.value)) == 0;
+  }
+
+  /// Whether two samplers bind the same texture.
+  bool sameSampler(const DrawList::Sampler &a, const DrawList::Sampler &b) {
+    return a.stage == b.stage && a.uniform.idx == b.uniform.idx && a.texture.idx == b.texture.idx;
+  }
+}
+
+
+
+void DrawList::Material::apply(bgfx::Encoder *encoder) const {
+  if (bgfx::isValid(sampler.uniform))
+    encoder->setTexture(sampler.stage, sampler.uniform, sampler.texture);
+  if (bgfx::isValid(uniform.handle))
+    encoder->setUniform(uniform.handle, uniform.value);
+}
+
+
+
+void DrawList::add(const Material &material, uint64_t state, const Mesh *mesh) {
+  _add(material, state, mesh, nullptr);
+}
+
+void DrawList::add(const Material &material, uint64_t state, const ColorMesh *mesh) {
+  _add(material, state, nullptr, mesh);
+}
+
+void DrawList::_add(const Material &material, uint64_t state, const Mesh *mesh, const ColorMesh *colorMesh) {
+  uint64_t blend =
+    ((state & BGFX_STATE_BLEND_MASK) != 0 ? 1 : 0) |
+    ((state & BGFX_STATE_BLEND_ALPHA_TO_COVERAGE) != 0 ? 2 : 0);
+
+  uint64_t key =
+    (uint64_t)_view                                       << viewShift    |
+    blend                                                 << blendShift   |
+    (uint64_t)((*material.program)->handle().idx & 0x3FFF) << programShift |
+    (uint64_t)material.sampler.texture.idx                << textureShift |
+    intern(_states, state, [](uint64_t a, uint64_t b) { return a == b; }) << stateShift |
+    intern(_uniforms, material.uniform, sameUniform)      << uniformShift;
+
+  _items.append({ key, material, state, mesh, colorMesh });
+}
+
+int DrawList::submit(bgfx::Encoder *encoder) {
+  size_t count = _items.count();
+  if (count == 0)
+    return 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Sort the draws by their bindings, in storage kept from the last submit
+  _order.clear();
+  _scratch.clear();
+  _order.reserve(count);
+  _scratch.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    _order.append({ _items[i].key, (uint32_t)i });
+    _scratch.append(_order.last());
+  }
+  const _sortEntry *order = _order.begin();
+  if (sortingEnabled)
+    order = radixSort(_order.begin(), _scratch.begin(), count);
+
+  // Keep the draws in order through bgfx's sorting
+  uint32_t depth = sortingEnabled ? nextDepth.fetch_add((uint32_t)count) : 0;
+
+  Stats stats;
+  stats.lists = 1;
+  const _item *previous = nullptr;
+  for (size_t i = 0; i < count; i++) {
+    const _item &item = _items[order[i].index];
+
+    // bgfx applies the draws of other encoders and lists between those with
+    // a different view, blending or program, which may change any uniform
+    bool sameBucket = sortingEnabled && previous != nullptr &&
+      (previous->key >> programShift) == (item.key >> programShift);
+
+    // Bind only what changed since the previous draw
+    const Sampler &sampler = item.material.sampler;
+    if (!sortingEnabled || previous == nullptr || !sameSampler(previous->material.sampler, sampler)) {
+      if (previous != nullptr && bgfx::isValid(previous->material.sampler.uniform) &&
+          previous->material.sampler.stage != sampler.stage)
+        // Unbind the previous texture
+        encoder->setTexture(previous->material.sampler.stage, BGFX_INVALID_HANDLE, BGFX_INVALID_HANDLE);
+      encoder->setTexture(sampler.stage, sampler.uniform, sampler.texture);
+      stats.samplers++;
+    }
+    if (!sortingEnabled || previous == nullptr || previous->state != item.state) {
+      encoder->setState(item.state);
+      stats.states++;
+    }
+    const Uniform &uniform = item.material.uniform;
+    if (bgfx::isValid(uniform.handle) &&
+        (!sameBucket || !sameUniform(previous->material.uniform, uniform))) {
+      encoder->setUniform(uniform.handle, uniform.value);
+      stats.uniforms++;
+    }
+    previous = &item;
+
+    // Draw
+    bool loaded = item.mesh != nullptr ?
+      item.mesh->setBuffers(encoder) : item.colorMesh->setBuffers(encoder);
+    if (!loaded)
+      continue;
+    encoder->submit(_view, (*item.material.program)->handle(),
+      sortingEnabled ? depth++ : 0, sortingEnabled ? keepBindings : BGFX_DISCARD_ALL);
+    stats.draws++;
+  }
+
+  // Leave the encoder clean for the next draw
+  encoder->discard(BGFX_DISCARD_ALL);
+
+  _items.clear();
+  _states.clear();
+  _uniforms.clear();
+
+  stats.time = std::chrono::duration<double, std::micro>(
+    std::chrono::steady_clock::now() - start).count();
+  {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    totals.lists    += stats.lists;
+    totals.draws    += stats.draws;
+    totals.samplers += stats.samplers;
+    totals.states   += stats.states;
+    totals.uniforms += stats.uniforms;
+    totals.time     += stats.time;
+  }
+  return (int)stats.draws;
+}
+
+
+
+void DrawList::startFrame() {
+  nextDepth = 1;
+}
+
+void DrawList::setSorting(bool enabled) {
+  sortingEnabled = enabled;
+}
+
+bool DrawList::sorting() {
+  return sortingEnabled;
+}
+
+DrawList::Stats DrawList::stats() {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  return totals;
+}
+
+void DrawList::resetStats() {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  totals = { };
+}
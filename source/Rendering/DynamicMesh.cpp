@@ -7,29 +7,40 @@
 
 #include <CityBuilder/Rendering/DynamicMesh.h>
 #include <CityBuilder/Rendering/Uniforms.h>
+#include <cstring>
 USING_NS_CITY_BUILDER
 
-DynamicMesh::~DynamicMesh() {
-  if (loaded) {
-    // Unload the mesh from the GPU
-    bgfx::destroy(_vertexBuffer);
-    bgfx::destroy(_indexBuffer);
-    
-    // Safety
-    loaded = false;
+namespace {
+  /// The vertex layout of `DynamicMesh::Vertex`.
+  const bgfx::VertexLayout &vertexLayout() {
+    static bgfx::VertexLayout layout = [] {
+      bgfx::VertexLayout layout;
+      layout.begin()
+          .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
+          .add(bgfx::Attrib::Color0  , 4, bgfx::AttribType::Uint8, true)
+      .end();
+      return layout;
+    }();
+    return layout;
   }
 }
 
+
+
 DynamicMesh &DynamicMesh::add(const List<Vertex> &vertices, const List<int> &indices) {
   // Store the index offset
-  uint16_t offset = _vertices.count();
+  uint32_t offset = _vertices.count();
   
-  // Add the vertices
-  _vertices.appendList(vertices);
+  // Add the vertices, sharing the caller's list rather than copying it when
+  // it's the whole mesh
+  if (_vertices.isEmpty())
+    _vertices = vertices;
+  else
+    _vertices.appendList(vertices);
   
   // Add the offset indices
   for (int index : indices)
-    _indices.append((uint16_t)index + offset);
+    _indices.append((uint32_t)index + offset);
   
   return *this;
 }
@@ -37,7 +48,7 @@ DynamicMesh &DynamicMesh::add(const List<Vertex> &vertices, const List<int> &ind
 
 
 DynamicMesh &DynamicMesh::extrude(const ProfileMesh &profile, Path2 &path, Color4 color, Real2 offset, Real scale) {
-  uint16_t indexOffset = _vertices.count();
+  uint32_t indexOffset = _vertices.count();
   
   // Get the path points
   List<Real4> points = path.pointNormals();
@@ -90,76 +101,62 @@ DynamicMesh &DynamicMesh::extrude(const ProfileMesh &profile, Path2 &path, Color
 
 
 void DynamicMesh::load() {
-  if (loaded) {
-    // Re-upload the mesh to the GPU
-    if (_vertices.count() == _vertexCount)
-      bgfx::update(_vertexBuffer, 0,
-        bgfx::copy(&_vertices[0], sizeof(Vertex) * _vertices.count()));
-    else {
-      // Recreate the vertex buffer
-      bgfx::destroy(_vertexBuffer);
-      
-      bgfx::VertexLayout layout;
-      layout.begin()
-          .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
-          .add(bgfx::Attrib::Color0  , 4, bgfx::AttribType::Uint8, true)
-      .end();
-      _vertexBuffer = bgfx::createDynamicVertexBuffer(
-        bgfx::copy(&_vertices[0], sizeof(Vertex) * _vertices.count()), layout);
-    }
-    
-    if (_indices.count() == _indexCount)
-      bgfx::update(_indexBuffer, 0,
-        bgfx::copy(&_indices[0], sizeof(uint16_t) * _indices.count()));
-    else {
-      // Recreate the index buffer
-      bgfx::destroy(_indexBuffer);
-      _indexBuffer = bgfx::createDynamicIndexBuffer(
-        bgfx::copy(&_indices[0], sizeof(uint16_t) * _indices.count()));
-    }
-  } else {
-    // Create the vertex buffer
-    bgfx::VertexLayout layout;
-    layout.begin()
-        .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
-        .add(bgfx::Attrib::Color0  , 4, bgfx::AttribType::Uint8, true)
-    .end();
-    _vertexBuffer = bgfx::createDynamicVertexBuffer(
-      bgfx::copy(&_vertices[0], sizeof(Vertex) * _vertices.count()), layout);
-    
-    // Create the index buffer
-    _indexBuffer = bgfx::createDynamicIndexBuffer(
-      bgfx::copy(&_indices[0], sizeof(uint16_t) * _indices.count()));
-    
-    
-    loaded = true;
-  }
-  
-  _vertexCount = _vertices.count();
-  _indexCount  = _indices.count();
+  // Hand the built geometry over to drawing
+  _loadedVertices = std::move(_vertices);
+  _loadedIndices  = std::move(_indices);
   
-  // Clear the user mesh data
+  // Start the next rebuild from an empty mesh
   _vertices.removeAll();
   _indices.removeAll();
 }
 
-void DynamicMesh::draw(Resource<Program> shader) const {
+bool DynamicMesh::_setBuffers(bgfx::Encoder *encoder) const {
+  uint32_t vertexCount = (uint32_t)_loadedVertices.count();
+  uint32_t indexCount  = (uint32_t)_loadedIndices.count();
+  if (indexCount == 0) {
+    // Nothing to draw, don't leave the caller's state to the next draw
+    encoder->discard();
+    return false;
+  }
+  
+  // Transient buffers only last for this frame and may be allocated from any
+  // thread, so the geometry is written again each time it's drawn
+  bgfx::TransientVertexBuffer vertices;
+  bgfx::TransientIndexBuffer  indices;
+  if (!bgfx::allocTransientBuffers(
+    &vertices, vertexLayout(), vertexCount,
+    &indices, indexCount, _loadedIndices.isWide()
+  )) {
+    // Out of transient space for this frame
+    encoder->discard();
+    return false;
+  }
+  
+  memcpy(vertices.data, &_loadedVertices[0], sizeof(Vertex) * vertexCount);
+  memcpy(indices.data, _loadedIndices.data(), _loadedIndices.bytes());
+  
+  encoder->setVertexBuffer(0, &vertices);
+  encoder->setIndexBuffer(&indices);
+  return true;
+}
+
+void DynamicMesh::draw(bgfx::Encoder *encoder, const Resource<Program> &shader) const {
   // Submit the mesh to the GPU for rendering
-  bgfx::setVertexBuffer(0, _vertexBuffer);
-  bgfx::setIndexBuffer(_indexBuffer);
-  shader->submit();
+  if (!_setBuffers(encoder))
+    return;
+  shader->submit(encoder);
 }
 
-void DynamicMesh::draw(Resource<Material> material) const {
+void DynamicMesh::draw(bgfx::Encoder *encoder, const Resource<Material> &material) const {
   // Submit the material
-  bgfx::setUniform(Uniforms::u_textureTile, { material->textureTile });
+  encoder->setUniform(Uniforms::u_textureTile, { material->textureTile });
   if (material->texture)
-    material->texture->load(Uniforms::s_albedo);
+    material->texture->load(encoder, Uniforms::s_albedo);
   // TODO
   
   // Submit the mesh to the GPU for rendering
-  bgfx::setVertexBuffer(0, _vertexBuffer);
-  bgfx::setIndexBuffer(_indexBuffer);
-  bgfx::setState(BGFX_STATE_DEFAULT);
-  material->shader->submit();
+  if (!_setBuffers(encoder))
+    return;
+  encoder->setState(BGFX_STATE_DEFAULT);
+  material->shader->submit(encoder);
 }
@@ -0,0 +1,63 @@
+/**
+ * @file Frustum.cpp
+ * @brief The implementation of frustum culling.
+ * @date May 12, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/Frustum.h>
+USING_NS_CITY_BUILDER
+
+Frustum::Frustum() {
+  // Planes that every point is in front of
+  for (int i = 0; i < 2; i++) {
+    _x[i] = _y[i] = _z[i] = Real4(0);
+    _w[i] = Real4(1);
+    _absX[i] = _absY[i] = _absZ[i] = Real4(0);
+  }
+}
+
+Frustum::Frustum(const Real4x4 &viewProjection, bool homogeneousDepth) {
+  // Every plane is a sum of rows of the matrix (Gribb & Hartmann), so
+  // gather each column of the matrix to build one coefficient of every plane
+  Real4 columns[4] = {
+    viewProjection * Real4(1, 0, 0, 0),
+    viewProjection * Real4(0, 1, 0, 0),
+    viewProjection * Real4(0, 0, 1, 0),
+    viewProjection * Real4(0, 0, 0, 1)
+  };
+
+  Real4 *coefficients[4] = { _x, _y, _z, _w };
+  for (int i = 0; i < 4; i++) {
+    Real4 c = columns[i];
+    Real near = homogeneousDepth ? c.w + c.z : c.z;
+    coefficients[i][0] = { c.w + c.x, c.w - c.x, c.w + c.y, c.w - c.y };
+    coefficients[i][1] = { near, c.w - c.z, near, c.w - c.z };
+  }
+
+  for (int i = 0; i < 2; i++) {
+    _absX[i] = _x[i].abs();
+    _absY[i] = _y[i].abs();
+    _absZ[i] = _z[i].abs();
+  }
+}
+
+
+
+bool Frustum::intersects(const Bounds3 &bounds) const {
+  Real3 center = bounds.center();
+  Real3 extent = bounds.extent();
+  Real4 cx = Real4(center.x), cy = Real4(center.y), cz = Real4(center.z);
+  Real4 ex = Real4(extent.x), ey = Real4(extent.y), ez = Real4(extent.z);
+
+  for (int i = 0; i < 2; i++) {
+    // The distance of the corner of the box furthest along each plane's
+    // normal, which is behind the plane only if the whole box is
+    Real4 distance =
+      _x[i] * cx + _y[i] * cy + _z[i] * cz + _w[i] +
+      _absX[i] * ex + _absY[i] * ey + _absZ[i] * ez;
+    if (distance.exactlyLess(Real4(0)).verticalOr())
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,29 @@
+/**
+ * @file IndexList.cpp
+ * @brief The implementation of self-sizing mesh index lists.
+ * @date May 10, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/IndexList.h>
+USING_NS_CITY_BUILDER
+
+void IndexList::removeAll() {
+  _indices16.removeAll();
+  _indices32.removeAll();
+  _wide = false;
+}
+
+const bgfx::Memory *IndexList::copy() const {
+  if (_wide)
+    return bgfx::copy(&_indices32[0], sizeof(uint32_t) * _indices32.count());
+  else
+    return bgfx::copy(&_indices16[0], sizeof(uint16_t) * _indices16.count());
+}
+
+void IndexList::_widen() {
+  for (uint16_t index : _indices16)
+    _indices32.append(index);
+  _indices16.removeAll();
+  _wide = true;
+}
@@ -0,0 +1,180 @@
+/**
+ * @file InstanceBatch.cpp
+ * @brief The implementation of instanced mesh drawing.
+ * @date May 13, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/InstanceBatch.h>
+#include <CityBuilder/Rendering/StaticBatch.h>
+#include <cstring>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// The size of the data of an instance, in bytes.
+  const uint16_t instanceStride = sizeof(InstanceBatch::Instance);
+}
+
+static_assert(sizeof(InstanceBatch::Instance) == 64, "Instances must be a 4x4 float matrix");
+
+
+
+InstanceBatch::Instance InstanceBatch::Instance::at(Real3 position, Angle rotation) {
+  Real2 cosSin = rotation.cosSin();
+  float cos = cosSin.x, sin = cosSin.y;
+
+  Instance instance;
+  memset(instance.transform, 0, sizeof(instance.transform));
+  instance.transform[ 0] =  cos;
+  instance.transform[ 2] =  sin;
+  instance.transform[ 5] =  1;
+  instance.transform[ 8] = -sin;
+  instance.transform[10] =  cos;
+  instance.transform[12] = position.x;
+  instance.transform[13] = position.y;
+  instance.transform[14] = position.z;
+  instance.transform[15] =  1;
+  return instance;
+}
+
+
+
+void InstanceBatch::add(const void *owner, Texture *material, Resource<Mesh> mesh, const Instance &instance, int level) {
+  // Find the bounds of the instance from the corners of the mesh bounds
+  const Bounds3 &local = mesh->boundingBox();
+  const float *m = instance.transform;
+  Bounds3 bounds;
+  for (int i = 0; i < 8; i++) {
+    Real3 p = local.origin + local.size * Real3(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+    Real3 corner = {
+      p.x * Real(m[0]) + p.y * Real(m[4]) + p.z * Real(m[ 8]) + Real(m[12]),
+      p.x * Real(m[1]) + p.y * Real(m[5]) + p.z * Real(m[ 9]) + Real(m[13]),
+      p.x * Real(m[2]) + p.y * Real(m[6]) + p.z * Real(m[10]) + Real(m[14])
+    };
+    if (i == 0)
+      bounds = Bounds3(corner);
+    else
+      bounds.fit(corner);
+  }
+
+  add(owner, material, mesh, instance, bounds, level);
+}
+
+void InstanceBatch::add(const void *owner, Texture *material, Resource<Mesh> mesh, const Instance &instance, const Bounds3 &bounds, int level) {
+  // Find the group of the mesh
+  int index = -1;
+  for (intptr_t i = 0; i < _groups.count(); i++)
+    if (_groups[i].material == material &&
+        _groups[i].mesh.address() == mesh.address() &&
+        _groups[i].level == level) {
+      index = (int)i;
+      break;
+    }
+  if (index == -1) {
+    _groups.append({ material, mesh, level });
+    index = (int)_groups.count() - 1;
+  }
+
+  _groups[index].instances.append({ owner, instance, bounds });
+
+  // Remember where the owner's instances are
+  if (!_owners.has(owner))
+    _owners.set(owner, { });
+  List<int> &groups = _owners[owner];
+  for (int existing : groups)
+    if (existing == index)
+      return;
+  groups.append(index);
+}
+
+void InstanceBatch::remove(const void *owner) {
+  if (!_owners.has(owner))
+    return;
+
+  List<int> &groups = _owners[owner];
+  for (int index : groups) {
+    List<_instance> &instances = _groups[index].instances;
+    for (intptr_t i = 0; i < instances.count(); i++)
+      if (instances[i].owner == owner)
+        instances.remove(i--);
+  }
+  groups.removeAll();
+}
+
+
+
+void InstanceBatch::cull(const Frustum &frustum, Real3 eye, Frustum::Stats &stats) {
+  _visible.removeAll();
+  _triangles = 0;
+
+  for (_group &group : _groups) {
+    group.visibleStart = _visible.count();
+
+    for (_instance &instance : group.instances) {
+      if (group.level != -1) {
+        // Skip instances drawn at another level of detail, which only
+        // changes once well clear of a boundary
+        Real3 center = instance.bounds.center();
+        instance.level = StaticBatch::levelAt(center.distance(eye), instance.level);
+        if (instance.level != group.level)
+          continue;
+      }
+
+      if (!frustum.intersects(instance.bounds)) {
+        stats.culled++;
+        continue;
+      }
+
+      _visible.append(instance.instance);
+      stats.visible++;
+    }
+
+    group.visibleCount = _visible.count() - group.visibleStart;
+    _triangles += group.visibleCount * group.mesh->triangleCount();
+  }
+}
+
+int InstanceBatch::draw(bgfx::Encoder *encoder, Bind bind, uint64_t state, Bind unbatched) const {
+  bool instancing = bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING;
+  if (!instancing && unbatched == nullptr)
+    // Nothing can be drawn
+    return 0;
+
+  int calls = 0;
+  for (const _group &group : _groups) {
+    if (group.visibleCount == 0)
+      continue;
+
+    if (!instancing) {
+      // Draw each placement by itself, since submitting clears the material
+      DrawList::Material material = unbatched(group.material);
+      for (size_t i = 0; i < group.visibleCount; i++) {
+        material.apply(encoder);
+        encoder->setState(state);
+        group.mesh->draw(encoder, *material.program,
+          _visible[group.visibleStart + i].transform);
+        calls++;
+      }
+      continue;
+    }
+
+    // Copy the visible placements to the GPU, as many as fit this frame
+    uint32_t count = bgfx::getAvailInstanceDataBuffer(
+      (uint32_t)group.visibleCount, instanceStride);
+    if (count == 0)
+      break;
+    bgfx::InstanceDataBuffer instances;
+    bgfx::allocInstanceDataBuffer(&instances, count, instanceStride);
+    memcpy(instances.data, &_visible[group.visibleStart], count * instanceStride);
+
+    // Setup the material
+    DrawList::Material material = bind(group.material);
+    material.apply(encoder);
+
+    // Draw
+    encoder->setState(state);
+    group.mesh->draw(encoder, *material.program, instances);
+    calls++;
+  }
+  return calls;
+}
@@ -7,6 +7,9 @@
 
 #include <CityBuilder/Rendering/Mesh.h>
 #include <CityBuilder/Rendering/Uniforms.h>
+#include <bx/math.h>
+#include <algorithm>
+#include <cstring>
 USING_NS_CITY_BUILDER
 
 Mesh::~Mesh() {
@@ -14,6 +17,7 @@ Mesh::~Mesh() {
     // Unload the mesh from the GPU
     bgfx::destroy(_vertexBuffer);
     bgfx::destroy(_indexBuffer);
+    VertexPacking::untrack(_packed, _loadedVertices, _vertexBytes, _indexBytes);
     
     // Safety
     loaded = false;
@@ -22,22 +26,37 @@ Mesh::~Mesh() {
 
 Mesh &Mesh::add(const List<Vertex> &vertices, const List<int> &indices) {
   // Store the index offset
-  uint16_t offset = _vertices.count();
+  uint32_t offset = _vertices.count();
   
   // Add the vertices
   _vertices.appendList(vertices);
   
   // Add the offset indices
   for (int index : indices)
-    _indices.append((uint16_t)index + offset);
+    _indices.append((uint32_t)index + offset);
+  
+  return *this;
+}
+
+Mesh &Mesh::add(const Mesh &other, Real2 tiling) {
+  // Store the index offset
+  uint32_t offset = _vertices.count();
+  
+  // Add the vertices with their texture coordinates scaled
+  for (const Vertex &vertex : other._vertices)
+    _vertices.append({ vertex.position, vertex.normal, vertex.uv * tiling });
+  
+  // Add the offset indices
+  for (size_t i = 0; i < other._indices.count(); i++)
+    _indices.append(other._indices[i] + offset);
   
   return *this;
 }
 
 
 
-Mesh &Mesh::extrude(const ProfileMesh &profile, Path2 &path, Real2 offset, Real scale) {
-  uint16_t indexOffset = _vertices.count();
+Mesh &Mesh::extrude(const ProfileMesh &profile, Path2 &path, Real2 offset, Real scale, int stride) {
+  uint32_t indexOffset = _vertices.count();
   
   // Get the path points
   List<Real4> points = path.pointNormals();
@@ -47,7 +66,8 @@ Mesh &Mesh::extrude(const ProfileMesh &profile, Path2 &path, Real2 offset, Real
     return *this;
   
   // Extrude the profile
-  for (int i = 0; i < points.count(); i++) {
+  int last = (int)points.count() - 1;
+  for (int i = 0, ring = 0; ; i = std::min(i + std::max(stride, 1), last), ring++) {
     // Get the current point data
     const Real4 &pointNormal = points[i];
     Real2 point  = { pointNormal.x, pointNormal.y };
@@ -65,13 +85,13 @@ Mesh &Mesh::extrude(const ProfileMesh &profile, Path2 &path, Real2 offset, Real
         Real3(normal.x, 0, normal.y) *
         Real3((vertex.position.x + offset.x) * scale),
         { norm.x, vertex.normal.y, norm.y },
-        { vertex.uv, Real(i) / Real((int)points.count() - 1) }
+        { vertex.uv, Real(i) / Real(last) }
       });
     }
     
-    if (i > 0) {
+    if (ring > 0) {
       // Connect triangles with the previous extrusion
-      int prev = indexOffset + (i - 1) * profile.vertices.count();
+      int prev = indexOffset + (ring - 1) * profile.vertices.count();
       int curr = prev + profile.vertices.count();
       for (intptr_t j = 0; j < profile.triangles.count(); j += 2) {
         _indices.append(prev + profile.triangles[j    ]);
@@ -83,17 +103,20 @@ Mesh &Mesh::extrude(const ProfileMesh &profile, Path2 &path, Real2 offset, Real
         _indices.append(curr + profile.triangles[j + 1]);
       }
     }
+    
+    if (i == last)
+      break;
   }
   
   return *this;
 }
 
-Mesh &Mesh::halfRevolve(const ProfileMesh &profile, Real2 center, Angle startAngle, Angle endAngle, Real2 offset, Real scale) {
-  uint16_t indexOffset = _vertices.count();
+Mesh &Mesh::halfRevolve(const ProfileMesh &profile, Real2 center, Angle startAngle, Angle endAngle, Real2 offset, Real scale, Angle step) {
+  uint32_t indexOffset = _vertices.count();
   
   // Get the path points
   Angle angle = Angle::span(startAngle, endAngle);
-  int points = (angle.radians / Real(5_deg)).ceil().max(2);
+  int points = (angle.radians / Real(step)).ceil().max(2);
   
   // Extrude the profile
   for (int i = 0; i < points; i++) {
@@ -153,6 +176,18 @@ Mesh &Mesh::halfRevolve(const ProfileMesh &profile, Real2 center, Angle startAng
 
 
 
+Bounds2 Mesh::bounds() const {
+  if (_vertices.isEmpty())
+    return Bounds2(Real2(0));
+  
+  Bounds2 bounds { { _vertices.first().position.x, _vertices.first().position.z } };
+  for (const Vertex &vertex : _vertices)
+    bounds.fit({ vertex.position.x, vertex.position.z });
+  return bounds;
+}
+
+
+
 void Mesh::load() {
   if (loaded)
     // Safety
@@ -162,19 +197,51 @@ void Mesh::load() {
     // Nothing to load
     return;
   
-  // Create the vertex buffer
-  bgfx::VertexLayout layout;
-  layout.begin()
-      .add(bgfx::Attrib::Position , 3, bgfx::AttribType::Float)
-      .add(bgfx::Attrib::Normal   , 3, bgfx::AttribType::Float)
-      .add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float)
-  .end();
-  _vertexBuffer = bgfx::createVertexBuffer(
-    bgfx::copy(&_vertices[0], sizeof(Vertex) * _vertices.count()), layout);
+  // Capture the bounds for culling
+  _boundingBox = Bounds3(_vertices.first().position);
+  for (const Vertex &vertex : _vertices)
+    _boundingBox.fit(vertex.position);
+  
+  if (VertexPacking::enabled()) {
+    // Pack the vertices relative to the bounds of the mesh
+    _transform = VertexPacking::fit(
+      &_vertices[0].position, _vertices.count(), sizeof(Vertex));
+    
+    List<VertexPacking::Vertex> packed { };
+    for (const Vertex &vertex : _vertices) {
+      VertexPacking::Vertex packedVertex;
+      VertexPacking::pack(packedVertex, _transform,
+        vertex.position, vertex.normal, vertex.uv);
+      packed.append(packedVertex);
+    }
+    
+    // Create the vertex buffer
+    _vertexBytes = sizeof(VertexPacking::Vertex) * packed.count();
+    _vertexBuffer = bgfx::createVertexBuffer(
+      bgfx::copy(&packed[0], _vertexBytes), VertexPacking::layout());
+    _packed = true;
+  } else {
+    // Create the vertex buffer
+    _vertexBytes = sizeof(Vertex) * _vertices.count();
+    bgfx::VertexLayout layout;
+    layout.begin()
+        .add(bgfx::Attrib::Position , 3, bgfx::AttribType::Float)
+        .add(bgfx::Attrib::Normal   , 3, bgfx::AttribType::Float)
+        .add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float)
+    .end();
+    _vertexBuffer = bgfx::createVertexBuffer(
+      bgfx::copy(&_vertices[0], _vertexBytes), layout);
+  }
   
   // Create the index buffer
   _indexBuffer = bgfx::createIndexBuffer(
-    bgfx::copy(&_indices[0], sizeof(uint16_t) * _indices.count()));
+    _indices.copy(), _indices.flags());
+  _indexBytes = _indices.bytes();
+  
+  // Account for the GPU memory
+  _loadedVertices = _vertices.count();
+  _loadedIndices  = _indices.count();
+  VertexPacking::track(_packed, _loadedVertices, _vertexBytes, _indexBytes);
   
   // Clear the user mesh data
   _vertices.removeAll();
@@ -183,27 +250,73 @@ void Mesh::load() {
   loaded = true;
 }
 
-void Mesh::draw(Resource<Program> shader) const {
+bool Mesh::setBuffers(bgfx::Encoder *encoder) const {
+  if (!loaded)
+    // Safety
+    return false;
+  
+  if (_packed) {
+    // Restore the packed positions
+    float transform[16];
+    _transform.matrix(transform);
+    encoder->setTransform(transform);
+  }
+  encoder->setVertexBuffer(0, _vertexBuffer);
+  encoder->setIndexBuffer(_indexBuffer);
+  return true;
+}
+
+void Mesh::draw(bgfx::Encoder *encoder, const Resource<Program> &shader) const {
+  // Submit the mesh to the GPU for rendering
+  if (!setBuffers(encoder))
+    return;
+  shader->submit(encoder);
+}
+
+void Mesh::draw(bgfx::Encoder *encoder, const Resource<Program> &shader, const bgfx::InstanceDataBuffer &instances) const {
+  // Submit the instances to the GPU for rendering, with any packed positions
+  // restored before the instance transforms
+  if (!setBuffers(encoder))
+    return;
+  encoder->setInstanceDataBuffer(&instances);
+  shader->submit(encoder);
+}
+
+void Mesh::draw(bgfx::Encoder *encoder, const Resource<Program> &shader, const float *transform) const {
   if (!loaded)
     // Safety
     return;
   
+  // Place the mesh, with any packed positions restored before the model
+  // matrix
+  float model[16];
+  if (_packed) {
+    float packing[16];
+    _transform.matrix(packing);
+    bx::mtxMul(model, packing, transform);
+  } else
+    memcpy(model, transform, sizeof(model));
+  encoder->setTransform(model);
+  
   // Submit the mesh to the GPU for rendering
-  bgfx::setVertexBuffer(0, _vertexBuffer);
-  bgfx::setIndexBuffer(_indexBuffer);
-  shader->submit();
+  encoder->setVertexBuffer(0, _vertexBuffer);
+  encoder->setIndexBuffer(_indexBuffer);
+  shader->submit(encoder);
 }
 
-void Mesh::draw(Resource<Material> material) const {
+void Mesh::draw(bgfx::Encoder *encoder, const Resource<Material> &material) const {
   // Submit the material
-  bgfx::setUniform(Uniforms::u_textureTile, { material->textureTile });
+  encoder->setUniform(Uniforms::u_textureTile, { material->textureTile });
   if (material->texture)
-    material->texture->load(Uniforms::s_albedo);
+    material->texture->load(encoder, Uniforms::s_albedo);
   // TODO
   
   // Submit the mesh to the GPU for rendering
-  bgfx::setVertexBuffer(0, _vertexBuffer);
-  bgfx::setIndexBuffer(_indexBuffer);
-  bgfx::setState(BGFX_STATE_DEFAULT);
-  material->shader->submit();
+  if (!setBuffers(encoder)) {
+    // Don't leave the material bound to the next draw
+    encoder->discard();
+    return;
+  }
+  encoder->setState(BGFX_STATE_DEFAULT);
+  material->shader->submit(encoder);
 }
@@ -14,16 +14,40 @@ Object::Object(Resource<Mesh> mesh, Resource<Material> material)
 
 
 
-void Object::draw() const {
-  // Set the model matrix
+Real4x4 Object::modelMatrix() const {
   Real4x4 matrix;
   bx::mtxTranslate(matrix, position.x, position.y, position.z);
   Real4x4 rotationMatrix;
   bx::mtxFromQuaternion(rotationMatrix, rotation);
   matrix *= rotationMatrix;
   bx::mtxScale(matrix, scale.x, scale.y, scale.z);
-  bgfx::setTransform(matrix);
+  return matrix;
+}
+
+Bounds3 Object::bounds() const {
+  Real4x4 matrix = modelMatrix();
+  const Bounds3 &local = mesh->boundingBox();
+  
+  // Fit every transformed corner of the mesh bounds
+  Bounds3 bounds;
+  for (int i = 0; i < 8; i++) {
+    Real3 corner = local.origin + local.size * Real3(i & 1, (i >> 1) & 1, (i >> 2) & 1);
+    bx::Vec3 point = bx::mul(bx::Vec3(corner.x, corner.y, corner.z), matrix);
+    if (i == 0)
+      bounds = Bounds3({ point.x, point.y, point.z });
+    else
+      bounds.fit({ point.x, point.y, point.z });
+  }
+  return bounds;
+}
+
+
+
+void Object::draw(bgfx::Encoder *encoder) const {
+  // Set the model matrix
+  Real4x4 matrix = modelMatrix();
+  encoder->setTransform(matrix);
   
   // Submit the mesh
-  mesh->draw(material);
+  mesh->draw(encoder, material);
 }
@@ -6,7 +6,9 @@
  */
 
 #include <CityBuilder/Rendering/Program.h>
+#include <CityBuilder/Tools/Archive.h>
 #include <CityBuilder/../../driver/Driver.h>
+#include <iostream>
 USING_NS_CITY_BUILDER
 
 Resource<Program> Program::pbr = nullptr;
@@ -17,10 +19,35 @@ Resource<Program> Program::ui = nullptr;
 
 Resource<Program> Program::zone = nullptr;
 
+Resource<Program> Program::road = nullptr;
+
+Resource<Program> Program::pbrInstanced = nullptr;
+
+Resource<Program> Program::roadInstanced = nullptr;
+
+Resource<Program> Program::pbrExtruded = nullptr;
+
+Resource<Program> Program::roadExtruded = nullptr;
+
+Resource<Program> Program::vehicle = nullptr;
+
+Resource<Program> Program::building = nullptr;
+
+Resource<Program> Program::buildingImpostor = nullptr;
+
 bgfx::ShaderHandle loadShader(const char *name, const char *extension) {
+  if (const Archive::Entry *entry = Archive::find(name, extension))
+    // Reference the shader in place, the archive outlives the renderer
+    return bgfx::createShader(
+      bgfx::makeRef(Archive::data(entry), (uint32_t)entry->length + 1)
+    );
+  
   char *contents;
   size_t length;
-  Driver::loadResource(name, extension, &contents, &length);
+  if (!Driver::loadResource(name, extension, &contents, &length)) {
+    std::cout << "Failed to load shader '" << name << "'." << std::endl;
+    return BGFX_INVALID_HANDLE;
+  }
   
   const bgfx::Memory *memory = bgfx::copy(contents, length + 1);
   free(contents);
@@ -39,7 +66,10 @@ Program::Program(const String &vertex, const String &fragment) {
 
 Program::~Program() {
   // Destroy the program and shaders
-  bgfx::destroy(_program);
-  bgfx::destroy(_vertex);
-  bgfx::destroy(_fragment);
+  if (bgfx::isValid(_program))
+    bgfx::destroy(_program);
+  if (bgfx::isValid(_vertex))
+    bgfx::destroy(_vertex);
+  if (bgfx::isValid(_fragment))
+    bgfx::destroy(_fragment);
 }
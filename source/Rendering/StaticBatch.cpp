@@ -0,0 +1,196 @@
+/**
+ * @file StaticBatch.cpp
+ * @brief The implementation of chunked static mesh batching.
+ * @date May 9, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/StaticBatch.h>
+#include <algorithm>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// The most vertices that a chunk mesh can have while keeping 16-bit
+  /// indices.
+  const size_t maxVertices = IndexList::max16 + 1;
+
+  /// How far past a level of detail boundary a cell must be before it
+  /// changes level, as a fraction of the boundary distance.
+  const Real hysteresis = 0.1;
+}
+
+StaticBatch::StaticBatch(Real cellSize) : _cellSize(cellSize) { }
+
+
+
+int StaticBatch::levelAt(Real distance, int level) {
+  while (level < levels - 1 &&
+      distance > Real(levelDistances[level]) * (Real(1) + hysteresis))
+    level++;
+  while (level > 0 &&
+      distance < Real(levelDistances[level - 1]) * (Real(1) - hysteresis))
+    level--;
+  return level;
+}
+
+
+
+void StaticBatch::add(const void *owner, Texture *material, Resource<Mesh> mesh, Real2 tiling, int level) {
+  // Find the cell of the mesh
+  Bounds2 bounds = mesh->bounds();
+  int index = _cellAt(bounds.origin + bounds.size * Real2(0.5));
+  _cell &cell = _cells[index];
+
+  // Find the chunk of the material
+  _chunk *chunk = nullptr;
+  for (_chunk &existing : cell.chunks)
+    if (existing.material == material) {
+      chunk = &existing;
+      break;
+    }
+  if (chunk == nullptr) {
+    _chunk added;
+    added.material = material;
+    cell.chunks.append(added);
+    chunk = &cell.chunks.setLast();
+  }
+
+  chunk->parts.append({ owner, mesh, tiling, level });
+  cell.dirty = true;
+
+  // Remember where the owner's meshes are
+  if (!_owners.has(owner))
+    _owners.set(owner, { });
+  List<int> &cells = _owners[owner];
+  for (int existing : cells)
+    if (existing == index)
+      return;
+  cells.append(index);
+}
+
+void StaticBatch::remove(const void *owner) {
+  if (!_owners.has(owner))
+    return;
+
+  List<int> &cells = _owners[owner];
+  for (int index : cells) {
+    _cell &cell = _cells[index];
+    for (_chunk &chunk : cell.chunks)
+      for (intptr_t i = chunk.parts.count() - 1; i >= 0; i--)
+        if (chunk.parts[i].owner == owner)
+          chunk.parts.remove(i);
+    cell.dirty = true;
+  }
+  cells.removeAll();
+}
+
+
+
+void StaticBatch::update() {
+  for (_cell &cell : _cells) {
+    if (!cell.dirty)
+      continue;
+
+    // Drop any chunks that are now empty
+    for (intptr_t i = cell.chunks.count() - 1; i >= 0; i--)
+      if (cell.chunks[i].parts.isEmpty())
+        cell.chunks.remove(i);
+
+    // Merge the meshes of each chunk and level
+    for (_chunk &chunk : cell.chunks)
+      for (int level = 0; level < levels; level++) {
+        List<Resource<Mesh>> &meshes = chunk.meshes[level];
+        meshes.removeAll();
+
+        Resource<Mesh> merged = new Mesh();
+        for (const _part &part : chunk.parts) {
+          if (part.level != -1 && part.level != level)
+            continue;
+          if (merged->vertexCount() > 0 &&
+              merged->vertexCount() + part.mesh->vertexCount() > maxVertices) {
+            // Start a new mesh rather than widen the indices to 32 bits
+            merged->load();
+            meshes.append(merged);
+            merged = new Mesh();
+          }
+          merged->add(*part.mesh, part.tiling);
+        }
+        if (merged->vertexCount() > 0) {
+          merged->load();
+          meshes.append(merged);
+        }
+      }
+
+    // Fit the cell around its merged meshes
+    bool first = true;
+    for (const _chunk &chunk : cell.chunks)
+      for (const List<Resource<Mesh>> &meshes : chunk.meshes)
+        for (const Resource<Mesh> &mesh : meshes) {
+          if (first)
+            cell.bounds = mesh->boundingBox();
+          else
+            cell.bounds.fit(mesh->boundingBox());
+          first = false;
+        }
+
+    cell.dirty = false;
+  }
+}
+
+void StaticBatch::cull(const Frustum &frustum, Real3 eye, Frustum::Stats &stats) {
+  _visible.removeAll();
+  _triangles = 0;
+
+  for (_cell &cell : _cells) {
+    if (!frustum.intersects(cell.bounds)) {
+      // Skip the whole cell
+      for (const _chunk &chunk : cell.chunks)
+        stats.culled += (int)chunk.meshes[cell.level].count();
+      continue;
+    }
+
+    // Choose the level of detail from the distance to the closest point of
+    // the cell, only moving past a boundary once well clear of it
+    Real3 closest = eye.max(cell.bounds.origin).min(cell.bounds.origin + cell.bounds.size);
+    cell.level = levelAt(closest.distance(eye), cell.level);
+
+    for (const _chunk &chunk : cell.chunks)
+      for (const Resource<Mesh> &mesh : chunk.meshes[cell.level]) {
+        if (!frustum.intersects(mesh->boundingBox())) {
+          stats.culled++;
+          continue;
+        }
+
+        _visible.append({ chunk.material, mesh.address() });
+        _triangles += mesh->triangleCount();
+        stats.visible++;
+      }
+  }
+}
+
+int StaticBatch::draw(DrawList &list, Bind bind, uint64_t state, size_t first, size_t count) const {
+  first = std::min(first, _visible.count());
+  size_t last = first + std::min(count, _visible.count() - first);
+  for (size_t i = first; i < last; i++) {
+    const _draw &draw = _visible[i];
+    list.add(bind(draw.material), state, draw.mesh);
+  }
+  return (int)(last - first);
+}
+
+
+
+int StaticBatch::_cellAt(Real2 point) {
+  // Pack the cell coordinates into a key
+  int x = (int)(point.x / _cellSize).floor();
+  int y = (int)(point.y / _cellSize).floor();
+  uint32_t key = ((uint32_t)(uint16_t)x << 16) | (uint32_t)(uint16_t)y;
+
+  if (_cellIndices.has(key))
+    return _cellIndices[key];
+
+  // Create a new cell
+  _cells.append({ });
+  _cellIndices.set(key, (int)_cells.count() - 1);
+  return (int)_cells.count() - 1;
+}
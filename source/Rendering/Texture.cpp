@@ -6,50 +6,59 @@
  */
 
 #include <CityBuilder/Rendering/Texture.h>
-#include <CityBuilder/../../driver/Driver.h>
+#include <CityBuilder/Rendering/TextureArray.h>
+#include <CityBuilder/Rendering/TextureLoader.h>
 USING_NS_CITY_BUILDER
 
-Texture::Texture(const String &name, int size, bool mipMaps) {
-  // Load the texture
-  char *contents;
-  size_t length;
-  Driver::loadResource((const char *)name, "texture", &contents, &length);
-  
-  // Ignore the DDS header
-  contents += 128;
-  
-  // Create the texture
-  _handle = bgfx::createTexture2D(
-    size, size, mipMaps, 1, bgfx::TextureFormat::RGBA8,
-    BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE,
-    bgfx::copy(contents, length - 128)
-  );
-  
-  // Free the texture data
-  free(contents - 128);
+namespace {
+  /// Queue a single texture to be loaded into a handle.
+  void stream(bgfx::TextureHandle *handle, const String &name, uint64_t flags, bool streamMips) {
+    TextureLoader::Request request;
+    request.target     = handle;
+    request.layers.append({ name });
+    request.flags      = flags;
+    request.streamMips = streamMips;
+    TextureLoader::request(request);
+  }
 }
 
-Texture::Texture(const String &name, uint64_t flags, int size, bool mipMaps) {
-  // Load the texture
-  char *contents;
-  size_t length;
-  Driver::loadResource((const char *)name, "texture", &contents, &length);
-  
-  // Ignore the DDS header
-  contents += 128;
-  
-  // Create the texture
-  _handle = bgfx::createTexture2D(
-    size, size, mipMaps, 1, bgfx::TextureFormat::RGBA8,
-    flags,
-    bgfx::copy(contents, length - 128)
-  );
-  
-  // Free the texture data
-  free(contents - 128);
+Texture::Texture(const String &name) {
+  stream(&_handle, name, BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE, false);
+}
+
+Texture::Texture(const String &name, uint64_t flags, bool streamMips) {
+  stream(&_handle, name, flags, streamMips);
+}
+
+Texture::Texture(TextureArray &array, const String &name) {
+  _layer = array.add(name);
+  if (_layer >= 0) {
+    // The texture is loaded as part of the array
+    _array = &array;
+    _handle = BGFX_INVALID_HANDLE;
+  } else {
+    // Fallback to a standalone texture
+    _layer = 0;
+    stream(&_handle, name, array.flags(), array.streamMips());
+  }
+}
+
+Texture::Texture(TextureLoader::Request request) {
+  request.target = &_handle;
+  TextureLoader::request(request);
 }
 
 Texture::~Texture() {
+  if (_array != nullptr)
+    // Owned by the array
+    return;
+
   // Destroy the texture
-  bgfx::destroy(_handle);
+  TextureLoader::release(&_handle);
+}
+
+bool Texture::ready() const {
+  if (_array != nullptr)
+    return _array->ready();
+  return bgfx::isValid(_handle) && !TextureLoader::isPlaceholder(_handle);
 }
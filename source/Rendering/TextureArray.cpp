@@ -0,0 +1,54 @@
+/**
+ * @file TextureArray.cpp
+ * @brief Implement texture array loading.
+ * @date May 4, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/TextureArray.h>
+#include <CityBuilder/Rendering/TextureLoader.h>
+USING_NS_CITY_BUILDER
+
+TextureArray::TextureArray(uint64_t flags, bool streamMips)
+  : _flags(flags), _streamMips(streamMips) { }
+
+TextureArray::~TextureArray() {
+  // Destroy the texture
+  TextureLoader::release(&_handle);
+}
+
+int TextureArray::add(const String &name) {
+  if (_streamed || !supported())
+    return -1;
+
+  // Share layers between identical textures
+  for (size_t i = 0; i < _layers.count(); i++)
+    if (_layers[i] == name)
+      return (int)i;
+
+  _layers.append(name);
+  return (int)_layers.count() - 1;
+}
+
+void TextureArray::stream() {
+  if (_streamed || _layers.isEmpty())
+    return;
+  _streamed = true;
+
+  TextureLoader::Request request;
+  request.target     = &_handle;
+  request.kind       = TextureLoader::Kind::array;
+  request.flags      = _flags;
+  request.streamMips = _streamMips;
+  for (const String &name : _layers)
+    request.layers.append({ name });
+  TextureLoader::request(request);
+}
+
+bool TextureArray::ready() const {
+  return bgfx::isValid(_handle) && !TextureLoader::isPlaceholder(_handle);
+}
+
+bool TextureArray::supported() {
+  return (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_2D_ARRAY) != 0;
+}
@@ -0,0 +1,594 @@
+/**
+ * @file TextureLoader.cpp
+ * @brief The implementation of the background texture loader.
+ * @date May 4, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/TextureLoader.h>
+#include <CityBuilder/Tools/Archive.h>
+#include <CityBuilder/../../driver/Driver.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// A source image of a queued request.
+  /// \remarks
+  ///   The storage types are not shared between threads so that the worker
+  ///   never touches reference counts owned by the main thread.
+  struct Source {
+    std::string name;
+    int x, y, size;
+  };
+
+  /// A queued request.
+  struct Job {
+    bgfx::TextureHandle *target;
+    TextureLoader::Kind kind;
+    std::vector<Source> layers;
+    uint64_t flags;
+
+    /// Whether the top mip levels may be held back.
+    bool streamMips = false;
+
+    /// The number of top mip levels to leave out.
+    int skip = 0;
+
+    /// The description of the assembled texture.
+    TextureLoader::Info info;
+
+    /// The assembled texture data.
+    const char *data = nullptr;
+
+    /// The length of the assembled texture data.
+    size_t length = 0;
+
+    /// The allocation backing the texture data, if it is not in the archive.
+    char *owned = nullptr;
+  };
+
+  /// A texture image read from the archive or from its own file.
+  struct Image {
+    /// The description of the image.
+    Archive::Entry metadata = { };
+
+    /// The texture data of the image.
+    const char *pixels = nullptr;
+
+    /// The length of the texture data.
+    size_t length = 0;
+
+    /// The file contents backing the texture data, if it is not in the
+    /// archive.
+    char *file = nullptr;
+  };
+
+  /// The queue of jobs waiting to be loaded.
+  std::deque<Job> queued;
+
+  /// The queue of jobs waiting to be uploaded.
+  std::deque<Job> loaded;
+
+  /// Guards both queues.
+  std::mutex mutex;
+
+  /// Signalled when a job is queued or the loader stops.
+  std::condition_variable wake;
+
+  /// Signalled when a job finishes loading.
+  std::condition_variable done;
+
+  /// The worker thread.
+  std::thread worker;
+
+  /// Whether the worker thread is running.
+  bool running = false;
+
+  /// The target of the job currently being loaded by the worker, if any.
+  bgfx::TextureHandle *current = nullptr;
+
+  /// The placeholder for 2D textures.
+  bgfx::TextureHandle placeholder = BGFX_INVALID_HANDLE;
+
+  /// The placeholder for 2D texture arrays.
+  bgfx::TextureHandle placeholderArray = BGFX_INVALID_HANDLE;
+
+  /// The uploaded textures, by target.
+  /// \remarks
+  ///   Only used from the main thread.
+  std::unordered_map<bgfx::TextureHandle *, TextureLoader::Resident> resident;
+
+  /// The requests of textures with streamed mip levels, by target.
+  /// \remarks
+  ///   Only used from the main thread.
+  std::unordered_map<bgfx::TextureHandle *, Job> streamed;
+
+  /// The number of top mip levels held back from streamed textures.
+  int mipBias = 0;
+
+  /// Whether streamed textures should have every mip level loaded.
+  bool fullDetail = false;
+
+
+
+  /// The number of bytes in a single mip level of a texture.
+  size_t mipLength(bgfx::TextureFormat::Enum format, int width, int height) {
+    // Block compressed formats store every block in full, even at the
+    // smallest mip levels
+    int block = 1;
+    size_t bytes = 4;
+    switch (format) {
+    case bgfx::TextureFormat::BC1:
+    case bgfx::TextureFormat::BC4:
+      block = 4; bytes =  8; break;
+    case bgfx::TextureFormat::BC2:
+    case bgfx::TextureFormat::BC3:
+    case bgfx::TextureFormat::BC5:
+    case bgfx::TextureFormat::BC7:
+    case bgfx::TextureFormat::ASTC4x4:
+      block = 4; bytes = 16; break;
+    case bgfx::TextureFormat::ASTC6x6:
+      block = 6; bytes = 16; break;
+    case bgfx::TextureFormat::ASTC8x8:
+      block = 8; bytes = 16; break;
+    default:
+      break;
+    }
+    return (size_t)((width + block - 1) / block) *
+                   ((height + block - 1) / block) * bytes;
+  }
+
+  /// The number of bytes in the first mip levels of a single texture layer.
+  size_t chainLength(const TextureLoader::Info &info, int levels) {
+    size_t length = 0;
+    for (int mip = 0; mip < levels; mip++)
+      length += mipLength(info.format,
+        std::max(info.width >> mip, 1), std::max(info.height >> mip, 1));
+    return length;
+  }
+
+  /// The number of top mip levels that a job should currently leave out.
+  int desiredSkip(const Job &job) {
+    return job.streamMips && !fullDetail ? mipBias : 0;
+  }
+
+
+
+  /// Read a texture image, preferring the asset archive.
+  bool readImage(const char *name, Image &image) {
+    if (const Archive::Entry *entry = Archive::find(name, "texture")) {
+      if (entry->type != Archive::Type::texture)
+        return false;
+      image.metadata = *entry;
+      image.pixels = Archive::data(entry);
+      image.length = entry->length;
+      return true;
+    }
+
+    size_t length, header;
+    if (!Driver::loadResource(name, "texture", &image.file, &length))
+      return false;
+    if (!Archive::parseTexture(image.file, length, image.metadata, header)) {
+      free(image.file);
+      image.file = nullptr;
+      return false;
+    }
+    image.pixels = image.file + header;
+    image.length = length - header;
+    return true;
+  }
+
+  /// Describe a texture from its metadata.
+  TextureLoader::Info describe(const Archive::Entry &metadata) {
+    return {
+      (bgfx::TextureFormat::Enum)metadata.format,
+      metadata.width, metadata.height, metadata.layers, metadata.mips
+    };
+  }
+
+  /// Read and assemble the data of a job.
+  /// \returns
+  ///   Whether or not every layer could be read.
+  bool assemble(Job &job) {
+    size_t atlasLength = 0;
+    if (job.kind == TextureLoader::Kind::atlas) {
+      // Atlases are assembled into a cleared image
+      atlasLength = (size_t)job.info.width * job.info.height * 4;
+      job.owned = (char *)calloc(atlasLength, 1);
+    }
+
+    bool success = true;
+    size_t index = 0;
+    for (Source &layer : job.layers) {
+      Image image;
+      if (!readImage(layer.name.c_str(), image)) {
+        std::cout << "Failed to load texture '" << layer.name << "'." << std::endl;
+        success = false;
+        break;
+      }
+
+      TextureLoader::Info info = describe(image.metadata);
+      switch (job.kind) {
+      case TextureLoader::Kind::texture:
+        // Use the image directly, without copying it out of the archive
+        job.info   = info;
+        job.data   = image.pixels;
+        job.length = image.length;
+        job.owned  = image.file;
+        image.file = nullptr;
+        break;
+
+      case TextureLoader::Kind::array:
+        if (index == 0) {
+          job.info = info;
+          job.info.layers = 0;
+        } else if (info.format != job.info.format ||
+            info.width != job.info.width || info.height != job.info.height ||
+            info.mips != job.info.mips) {
+          std::cout << "Texture '" << layer.name
+            << "' does not match the other layers of its texture array." << std::endl;
+          success = false;
+          break;
+        }
+
+        // Layers (with their mip chains) are stored back to back
+        job.owned = (char *)realloc(job.owned, job.length + image.length);
+        memcpy(job.owned + job.length, image.pixels, image.length);
+        job.length += image.length;
+        job.info.layers += info.layers;
+        break;
+
+      case TextureLoader::Kind::atlas: {
+        if (info.format != bgfx::TextureFormat::RGBA8 ||
+            layer.x + info.width > job.info.width ||
+            layer.y + info.height > job.info.height) {
+          std::cout << "Texture '" << layer.name
+            << "' cannot be packed into an atlas." << std::endl;
+          break;
+        }
+
+        // Copy the top mip level row by row
+        size_t row = (size_t)info.width * 4;
+        for (int y = 0; y < info.height; y++)
+          memcpy(
+            job.owned + ((size_t)(layer.y + y) * job.info.width + layer.x) * 4,
+            image.pixels + row * y,
+            row
+          );
+      } break;
+      }
+
+      free(image.file);
+      index++;
+      if (!success)
+        break;
+    }
+
+    if (job.kind != TextureLoader::Kind::texture) {
+      job.data = job.owned;
+      if (job.kind == TextureLoader::Kind::atlas)
+        job.length = atlasLength;
+    }
+
+    if (!success) {
+      free(job.owned);
+      job.owned = nullptr;
+      job.data = nullptr;
+      return false;
+    }
+
+    // Leave out the top mip levels (but always keep the last one)
+    int skip = std::min(job.skip, job.info.mips - 1);
+    if (skip > 0 && job.kind != TextureLoader::Kind::atlas) {
+      size_t layer  = chainLength(job.info, job.info.mips);
+      size_t offset = chainLength(job.info, skip);
+      if (job.info.layers == 1) {
+        // Point past the top levels, the data stays where it is
+        job.data   += offset;
+        job.length -= offset;
+      } else {
+        // Every layer has its own mip chain
+        char *data = (char *)malloc((layer - offset) * job.info.layers);
+        for (int i = 0; i < job.info.layers; i++)
+          memcpy(data + (layer - offset) * i,
+            job.data + layer * i + offset, layer - offset);
+        free(job.owned);
+        job.owned  = data;
+        job.data   = data;
+        job.length = (layer - offset) * job.info.layers;
+      }
+      job.info.width  = std::max(job.info.width  >> skip, 1);
+      job.info.height = std::max(job.info.height >> skip, 1);
+      job.info.mips  -= skip;
+    }
+    job.skip = skip;
+    return true;
+  }
+
+  /// Upload a loaded job to the GPU.
+  void upload(Job &job) {
+    if (job.data == nullptr)
+      // Failed to load, keep the placeholder
+      return;
+
+    // Hand the data over to bgfx, releasing any copy once it has been consumed
+    const bgfx::Memory *memory = job.owned == nullptr ?
+      bgfx::makeRef(job.data, (uint32_t)job.length) :
+      bgfx::makeRef(job.data, (uint32_t)job.length,
+        [](void *, void *owned) { free(owned); }, job.owned);
+    job.data  = nullptr;
+    job.owned = nullptr;
+
+    // Replace any texture that is being reloaded at a different detail
+    if (bgfx::isValid(*job.target) && !TextureLoader::isPlaceholder(*job.target))
+      bgfx::destroy(*job.target);
+
+    *job.target = bgfx::createTexture2D(
+      job.info.width, job.info.height, job.info.mips > 1,
+      job.info.layers > 1 || job.kind == TextureLoader::Kind::array ?
+        job.info.layers : 1,
+      job.info.format, job.flags, memory
+    );
+
+    // Account for the memory used, renderers decode formats that they do not
+    // support to BGRA8
+    TextureLoader::Info info = job.info;
+    if (!(bgfx::getCaps()->formats[info.format] & BGFX_CAPS_FORMAT_TEXTURE_2D))
+      info.format = bgfx::TextureFormat::BGRA8;
+    std::string name = job.kind == TextureLoader::Kind::atlas || job.layers.empty() ?
+      "(atlas)" : job.layers.front().name;
+    if (job.layers.size() > 1)
+      name += " +" + std::to_string(job.layers.size() - 1);
+    resident[job.target] = {
+      String(name.c_str()), job.info, chainLength(info, info.mips) * info.layers, job.skip
+    };
+  }
+
+  /// Queue a job to be loaded in the background.
+  void enqueue(Job job);
+
+  /// Upload a loaded job, reloading it if its detail changed while it loaded.
+  void deliver(Job &job) {
+    upload(job);
+    if (job.streamMips && job.skip != desiredSkip(job) &&
+        streamed.count(job.target)) {
+      Job reload = streamed[job.target];
+      reload.skip = desiredSkip(reload);
+      enqueue(std::move(reload));
+    }
+  }
+
+  void enqueue(Job job) {
+    if (!running) {
+      // No background loader, load immediately
+      assemble(job);
+      deliver(job);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queued.push_back(std::move(job));
+    }
+    wake.notify_one();
+  }
+
+  /// The worker thread loop.
+  void work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      wake.wait(lock, [] { return !running || !queued.empty(); });
+      if (!running)
+        return;
+
+      Job job = std::move(queued.front());
+      queued.pop_front();
+      current = job.target;
+
+      // Load without holding the lock
+      lock.unlock();
+      assemble(job);
+      lock.lock();
+
+      current = nullptr;
+      loaded.push_back(std::move(job));
+      done.notify_all();
+    }
+  }
+}
+
+
+
+void TextureLoader::start() {
+  if (running)
+    return;
+
+  // Create the placeholders (opaque white)
+  const uint32_t white[2] = { 0xFFFFFFFF, 0xFFFFFFFF };
+  placeholder = bgfx::createTexture2D(
+    1, 1, false, 1, bgfx::TextureFormat::RGBA8,
+    BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE,
+    bgfx::copy(white, sizeof(uint32_t))
+  );
+  if (bgfx::getCaps()->supported & BGFX_CAPS_TEXTURE_2D_ARRAY)
+    placeholderArray = bgfx::createTexture2D(
+      1, 1, false, 2, bgfx::TextureFormat::RGBA8,
+      BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE,
+      bgfx::copy(white, sizeof(white))
+    );
+
+  running = true;
+  worker = std::thread(work);
+}
+
+void TextureLoader::stop() {
+  if (!running)
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+    queued.clear();
+  }
+  wake.notify_all();
+  worker.join();
+
+  // Release anything that was loaded but never uploaded
+  for (Job &job : loaded)
+    free(job.owned);
+  loaded.clear();
+}
+
+void TextureLoader::request(const Request &request) {
+  // Convert the request into thread-independent storage
+  Job job;
+  job.target     = request.target;
+  job.kind       = request.kind;
+  job.flags      = request.flags;
+  job.streamMips = request.streamMips && request.kind != Kind::atlas;
+  job.info   = {
+    bgfx::TextureFormat::RGBA8, request.width, request.height, 1, 1
+  };
+  for (const Layer &layer : request.layers)
+    job.layers.push_back({
+      std::string((const char *)layer.name), layer.x, layer.y, layer.size
+    });
+
+  // Bind the placeholder until the texture is ready
+  *job.target = request.kind == Kind::array ? placeholderArray : placeholder;
+
+  if (job.streamMips)
+    // Remember the request so that it can be reloaded at a different detail
+    streamed[job.target] = job;
+  job.skip = desiredSkip(job);
+
+  enqueue(std::move(job));
+}
+
+void TextureLoader::cancel(bgfx::TextureHandle *target) {
+  std::unique_lock<std::mutex> lock(mutex);
+
+  // The job may currently be loading, wait for it to be delivered
+  done.wait(lock, [target] { return current != target; });
+
+  for (auto i = queued.begin(); i != queued.end();)
+    if (i->target == target)
+      i = queued.erase(i);
+    else
+      i++;
+
+  for (auto i = loaded.begin(); i != loaded.end();)
+    if (i->target == target) {
+      free(i->owned);
+      i = loaded.erase(i);
+    } else
+      i++;
+}
+
+void TextureLoader::release(bgfx::TextureHandle *target) {
+  cancel(target);
+  streamed.erase(target);
+  resident.erase(target);
+  if (bgfx::isValid(*target) && !isPlaceholder(*target))
+    bgfx::destroy(*target);
+  *target = BGFX_INVALID_HANDLE;
+}
+
+void TextureLoader::update(int budget) {
+  for (int i = 0; i < budget; i++) {
+    Job job;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (loaded.empty())
+        return;
+      job = std::move(loaded.front());
+      loaded.pop_front();
+    }
+    deliver(job);
+  }
+}
+
+void TextureLoader::flush() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      done.wait(lock, [] {
+        return queued.empty() && current == nullptr;
+      });
+      if (loaded.empty())
+        return;
+    }
+    update((int)pending());
+  }
+}
+
+bool TextureLoader::describe(const String &name, Info &info) {
+  Image image;
+  if (!readImage((const char *)name, image))
+    return false;
+  info = ::describe(image.metadata);
+  free(image.file);
+  return true;
+}
+
+void TextureLoader::setMipBias(int levels) {
+  mipBias = std::max(levels, 0);
+}
+
+void TextureLoader::setFullDetail(bool full) {
+  if (full == fullDetail)
+    return;
+  fullDetail = full;
+
+  // Reload everything that has finished loading at the other detail, anything
+  // still loading is reloaded once it is delivered
+  for (auto &pair : streamed) {
+    auto texture = resident.find(pair.first);
+    if (texture == resident.end() || texture->second.skip == desiredSkip(pair.second))
+      continue;
+    Job reload = pair.second;
+    reload.skip = desiredSkip(reload);
+    enqueue(std::move(reload));
+  }
+}
+
+size_t TextureLoader::memoryUsed() {
+  size_t total = 0;
+  for (auto &pair : resident)
+    total += pair.second.bytes;
+  return total;
+}
+
+List<TextureLoader::Resident> TextureLoader::residents() {
+  std::vector<const Resident *> textures;
+  for (auto &pair : resident)
+    textures.push_back(&pair.second);
+  std::sort(textures.begin(), textures.end(),
+    [](const Resident *a, const Resident *b) { return a->bytes > b->bytes; });
+
+  List<Resident> residents { };
+  for (const Resident *texture : textures)
+    residents.append(*texture);
+  return residents;
+}
+
+bool TextureLoader::isPlaceholder(bgfx::TextureHandle handle) {
+  // Without texture arrays there is no array placeholder, and its invalid
+  // handle must not match any other invalid handle
+  return (bgfx::isValid(placeholder) && handle.idx == placeholder.idx) ||
+    (bgfx::isValid(placeholderArray) && handle.idx == placeholderArray.idx);
+}
+
+size_t TextureLoader::pending() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return queued.size() + loaded.size() + (current != nullptr ? 1 : 0);
+}
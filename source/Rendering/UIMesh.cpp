@@ -22,14 +22,24 @@ UIMesh::~UIMesh() {
 
 UIMesh &UIMesh::add(const List<Vertex> &vertices, const List<int> &indices) {
   // Store the index offset
-  uint16_t offset = _vertices.count();
+  uint32_t offset = _vertices.count();
   
   // Add the vertices
   _vertices.appendList(vertices);
   
   // Add the offset indices
   for (int index : indices)
-    _indices.append((uint16_t)index + offset);
+    _indices.append((uint32_t)index + offset);
+  
+  return *this;
+}
+
+
+UIMesh &UIMesh::mapTextureCoordinates(Real4 region) {
+  Real2 origin = { region.x, region.y };
+  Real2 size   = { region.z, region.w };
+  for (Vertex &vertex : _vertices)
+    vertex.uv = origin + vertex.uv * size;
   
   return *this;
 }
@@ -53,7 +63,7 @@ void UIMesh::load() {
   
   // Create the index buffer
   _indexBuffer = bgfx::createIndexBuffer(
-    bgfx::copy(&_indices[0], sizeof(uint16_t) * _indices.count()));
+    _indices.copy(), _indices.flags());
   
   // Clear the user mesh data
   _vertices.removeAll();
@@ -62,9 +72,9 @@ void UIMesh::load() {
   loaded = true;
 }
 
-void UIMesh::draw(Resource<Program> shader) const {
+void UIMesh::draw(bgfx::Encoder *encoder, const Resource<Program> &shader) const {
   // Submit the mesh to the GPU for rendering
-  bgfx::setVertexBuffer(0, _vertexBuffer);
-  bgfx::setIndexBuffer(_indexBuffer);
-  shader->submit(1);
+  encoder->setVertexBuffer(0, _vertexBuffer);
+  encoder->setIndexBuffer(_indexBuffer);
+  shader->submit(encoder, 1);
 }
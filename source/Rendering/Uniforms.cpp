@@ -14,9 +14,13 @@ namespace Uniforms {
   bgfx::UniformHandle u_sunColor;
   bgfx::UniformHandle u_sunDirection;
   bgfx::UniformHandle u_textureTile;
+  bgfx::UniformHandle u_textureLayer;
+  bgfx::UniformHandle u_vehicleMotion;
   
   bgfx::UniformHandle s_albedo;
   bgfx::UniformHandle s_ui;
+  bgfx::UniformHandle s_albedoArray;
+  bgfx::UniformHandle s_laneCurves;
   
 } // namespace Uniforms
 NS_CITY_BUILDER_END
@@ -28,7 +32,11 @@ void Uniforms::create() {
   u_sunColor     = bgfx::createUniform("u_sunColor"    , bgfx::UniformType::Vec4);
   u_sunDirection = bgfx::createUniform("u_sunDirection", bgfx::UniformType::Vec4);
   u_textureTile  = bgfx::createUniform("u_textureTile" , bgfx::UniformType::Vec4);
+  u_textureLayer = bgfx::createUniform("u_textureLayer", bgfx::UniformType::Vec4);
+  u_vehicleMotion = bgfx::createUniform("u_vehicleMotion", bgfx::UniformType::Vec4);
   
   s_albedo = bgfx::createUniform("s_albedo", bgfx::UniformType::Sampler);
   s_ui     = bgfx::createUniform("s_ui"    , bgfx::UniformType::Sampler);
+  s_albedoArray = bgfx::createUniform("s_albedoArray", bgfx::UniformType::Sampler);
+  s_laneCurves  = bgfx::createUniform("s_laneCurves" , bgfx::UniformType::Sampler);
 }
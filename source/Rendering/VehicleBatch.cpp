@@ -0,0 +1,254 @@
+/**
+ * @file VehicleBatch.cpp
+ * @brief The implementation of instanced vehicle drawing.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/VehicleBatch.h>
+#include <CityBuilder/Rendering/Program.h>
+#include <CityBuilder/Rendering/Uniforms.h>
+#include <chrono>
+#include <cstring>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The number of pieces that each lane's curve is measured in to find its
+  /// length.
+  constexpr int measureSteps = 32;
+
+  /// The scale of road cross sections, as they are meshed.
+  const Real scale = 0.333333333333;
+
+  /// A vertex of the shared vehicle mesh.
+  struct Vertex {
+    float x, y, z;
+    float nx, ny, nz;
+    uint32_t color;
+  };
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  /// Whether instances can be drawn at all.
+  bool supported() {
+    return bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING;
+  }
+}
+
+
+
+VehicleBatch::~VehicleBatch() {
+  if (bgfx::isValid(_vertices))
+    bgfx::destroy(_vertices);
+  if (bgfx::isValid(_indices))
+    bgfx::destroy(_indices);
+  if (bgfx::isValid(_instances))
+    bgfx::destroy(_instances);
+  if (bgfx::isValid(_curves))
+    bgfx::destroy(_curves);
+}
+
+
+
+bool VehicleBatch::setCurves(const LaneGraph &graph) {
+  if ((_hasCurves && _version == graph.version()) || !supported())
+    return false;
+  Clock::time_point start = Clock::now();
+  _version = graph.version();
+  _hasCurves = true;
+
+  // Grow the texture in powers of two so that it is rarely recreated
+  const List<LaneGraph::Segment> &segments = graph.segments();
+  uint16_t width = curvesPerRow * curveTexels;
+  size_t rows = (segments.count() + curvesPerRow - 1) / curvesPerRow;
+  if (rows > _curveRows || !bgfx::isValid(_curves)) {
+    uint16_t grown = 1;
+    while (grown < rows)
+      grown *= 2;
+    if (bgfx::isValid(_curves))
+      bgfx::destroy(_curves);
+    _curves = bgfx::createTexture2D(width, grown, false, 1,
+      bgfx::TextureFormat::RGBA32F, BGFX_SAMPLER_POINT | BGFX_SAMPLER_UVW_CLAMP);
+    _curveRows = grown;
+  }
+  if (rows == 0)
+    return true;
+
+  const bgfx::Memory *memory = bgfx::alloc((uint32_t)(width * rows * 4 * sizeof(float)));
+  memset(memory->data, 0, memory->size);
+  float *texels = (float *)memory->data;
+
+  for (size_t id = 0; id < segments.count(); id++) {
+    const LaneGraph::Segment &segment = segments[id];
+    if (segment.road == nullptr)
+      continue;
+    float *curve = texels + id * curveTexels * 4;
+
+    // The control points of the road as a cubic Bézier curve, as with
+    // `CurveExtrusion::place`
+    Path2 &path = segment.road->path.path();
+    Real2 p0 = path.start, p1, p2, p3 = path.end;
+    if (path.type() == Path2::Type::bezier) {
+      Bezier2 &bezier = static_cast<Bezier2 &>(path);
+      p1 = bezier.control1;
+      p2 = bezier.control2;
+    } else {
+      p1 = p0 + (p3 - p0) * Real2(1.0 / 3.0);
+      p2 = p0 + (p3 - p0) * Real2(2.0 / 3.0);
+    }
+    curve[0] = p0.x; curve[1] = p0.y; curve[2] = p1.x; curve[3] = p1.y;
+    curve[4] = p2.x; curve[5] = p2.y; curve[6] = p3.x; curve[7] = p3.y;
+
+    // Follow the middle of the traffic pattern, as the lane graph does
+    const RoadDef::Lane &lane = segment.road->definition->lanes[segment.lane];
+    const LaneDef::Traffic &traffic = lane.definition->traffic[segment.traffic];
+    curve[ 8] = (lane.position.x + (traffic.start + traffic.end) * Real(0.5) -
+      segment.road->definition->dimensions.x * Real(0.5)) * scale;
+    if (_body == Body::pedestrian)
+      curve[8] += (traffic.end - traffic.start) * scale * (segment.forward ? 0.25f : -0.25f);
+    curve[ 9] = (lane.position.y + traffic.elevation) * scale;
+    curve[10] = segment.length;
+    curve[11] = segment.forward ? 0 : 1;
+
+    // Measure the curve to find the parameters at every eighth of its length
+    float lengths[measureSteps + 1] = { 0 };
+    Real2 previous = p0;
+    for (int i = 1; i <= measureSteps; i++) {
+      Real2 point = path.point(Real(i) / Real(measureSteps));
+      lengths[i] = lengths[i - 1] + (float)point.distance(previous);
+      previous = point;
+    }
+    int step = 0;
+    for (int k = 1; k < 8; k++) {
+      float target = lengths[measureSteps] * k / 8;
+      while (step < measureSteps - 1 && lengths[step + 1] < target)
+        step++;
+      float piece = lengths[step + 1] - lengths[step];
+      float within = piece > 0 ? (target - lengths[step]) / piece : 0;
+      curve[11 + k] = (step + within) / measureSteps;
+    }
+  }
+
+  bgfx::updateTexture2D(_curves, 0, 0, 0, 0, width, (uint16_t)rows, memory);
+  _stats.curveUploads++;
+  _stats.curveTime += since(start);
+  return true;
+}
+
+void VehicleBatch::update(const TrafficSimulation &traffic) {
+  _count = 0;
+  if (traffic.count() == 0 || !supported())
+    return;
+  Clock::time_point start = Clock::now();
+
+  const bgfx::Memory *memory =
+    bgfx::alloc((uint32_t)(traffic.count() * sizeof(TrafficSimulation::Snapshot)));
+  traffic.snapshot((TrafficSimulation::Snapshot *)memory->data);
+  _upload(memory, traffic.count());
+  _stats.uploadTime += since(start);
+}
+
+void VehicleBatch::update(const List<TrafficSimulation::Snapshot> &snapshots) {
+  _count = 0;
+  if (snapshots.isEmpty() || !supported())
+    return;
+  Clock::time_point start = Clock::now();
+  _upload(bgfx::copy(snapshots.begin(),
+    (uint32_t)(snapshots.count() * sizeof(TrafficSimulation::Snapshot))), snapshots.count());
+  _stats.uploadTime += since(start);
+}
+
+void VehicleBatch::draw(bgfx::Encoder *encoder, float lag) {
+  if (_count == 0 || !_hasCurves)
+    return;
+  Clock::time_point start = Clock::now();
+  if (!bgfx::isValid(_vertices))
+    _createMesh();
+
+  float motion[4] = { lag, 0, 0, 0 };
+  encoder->setVertexBuffer(0, _vertices);
+  encoder->setIndexBuffer(_indices);
+  encoder->setInstanceDataBuffer(_instances, 0, (uint32_t)_count);
+  encoder->setTexture(0, Uniforms::s_laneCurves, _curves);
+  encoder->setUniform(Uniforms::u_vehicleMotion, motion);
+  encoder->setState(BGFX_STATE_DEFAULT);
+  Program::vehicle->submit(encoder);
+
+  _stats.frames++;
+  _stats.drawTime += since(start);
+}
+
+
+
+void VehicleBatch::_createMesh() {
+  // A body with a cabin on top, or a person with a head on top, in vehicle
+  // space: X across to the right, Y up and Z forward, with the front of the
+  // vehicle at the origin
+  struct Box {
+    float min[3], max[3];
+    uint32_t color;
+  };
+  const Box vehicle[] = {
+    { { -0.9f, 0.2f, -TrafficSimulation::vehicleLength }, { 0.9f, 1.0f, 0 }, 0xff8a4a2a },
+    { { -0.8f, 1.0f, -3.4f }, { 0.8f, 1.5f, -1.2f }, 0xff3a3026 },
+  };
+  const Box pedestrian[] = {
+    { { -0.22f, 0, -0.3f }, { 0.22f, 1.45f, 0 }, 0xff6a5a8a },
+    { { -0.11f, 1.45f, -0.22f }, { 0.11f, 1.72f, -0.06f }, 0xff8cb4e0 },
+  };
+  const Box *boxes = _body == Body::pedestrian ? pedestrian : vehicle;
+
+  Vertex vertices[2 * 24];
+  uint16_t indices[2 * 36];
+  int vertex = 0, index = 0;
+  for (int b = 0; b < 2; b++) {
+    const Box &box = boxes[b];
+    for (int axis = 0; axis < 3; axis++)
+      for (int side = 0; side < 2; side++) {
+        // The two axes across the face, wound as the rest of the meshes are
+        int u = (axis + (side ? 1 : 2)) % 3, v = (axis + (side ? 2 : 1)) % 3;
+        uint16_t first = (uint16_t)vertex;
+        for (int corner = 0; corner < 4; corner++) {
+          float point[3], normal[3] = { 0, 0, 0 };
+          point[axis] = side ? box.max[axis] : box.min[axis];
+          point[u] = (corner == 1 || corner == 2) ? box.max[u] : box.min[u];
+          point[v] = corner >= 2 ? box.max[v] : box.min[v];
+          normal[axis] = side ? 1.0f : -1.0f;
+          vertices[vertex++] = {
+            point[0], point[1], point[2], normal[0], normal[1], normal[2], box.color
+          };
+        }
+        const uint16_t quad[] = { 0, 2, 1, 0, 3, 2 };
+        for (uint16_t corner : quad)
+          indices[index++] = first + corner;
+      }
+  }
+
+  bgfx::VertexLayout layout;
+  layout.begin()
+      .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
+      .add(bgfx::Attrib::Normal  , 3, bgfx::AttribType::Float)
+      .add(bgfx::Attrib::Color0  , 4, bgfx::AttribType::Uint8, true)
+    .end();
+  _vertices = bgfx::createVertexBuffer(bgfx::copy(vertices, sizeof(vertices)), layout);
+  _indices  = bgfx::createIndexBuffer(bgfx::copy(indices, sizeof(indices)));
+}
+
+void VehicleBatch::_upload(const bgfx::Memory *memory, size_t count) {
+  if (!bgfx::isValid(_instances)) {
+    bgfx::VertexLayout layout;
+    layout.begin()
+        .add(bgfx::Attrib::TexCoord7, 4, bgfx::AttribType::Float)
+      .end();
+    _instances = bgfx::createDynamicVertexBuffer(memory, layout, BGFX_BUFFER_ALLOW_RESIZE);
+  } else
+    bgfx::update(_instances, 0, memory);
+
+  _count = count;
+  _stats.uploads++;
+}
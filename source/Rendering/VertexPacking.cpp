@@ -0,0 +1,201 @@
+/**
+ * @file VertexPacking.cpp
+ * @brief The implementation of the compact static mesh vertex format.
+ * @date May 11, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Rendering/VertexPacking.h>
+#include <cmath>
+#include <cstring>
+USING_NS_CITY_BUILDER
+
+static_assert(sizeof(VertexPacking::Vertex) == 16, "Packed vertices must be 16 bytes");
+
+namespace {
+  /// Whether static meshes are packed when they are loaded.
+  bool packingEnabled = false;
+
+  /// The GPU memory used by unpacked and packed static meshes.
+  VertexPacking::Usage usages[2];
+
+  /// Convert a float to a half float, rounding to the nearest value.
+  /// \remarks
+  ///   Values too small for a normal half float are flushed to zero and
+  ///   values too large become infinity.
+  uint16_t toHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (exponent <= 0)
+      return sign;
+    if (exponent >= 31)
+      return sign | 0x7C00;
+
+    uint16_t half = sign | (uint16_t)(exponent << 10) | (uint16_t)(mantissa >> 13);
+    if (mantissa & 0x1000)
+      // Round up, carrying into the exponent as needed
+      half++;
+    return half;
+  }
+
+  /// Convert a value from -1 to 1 to an 8-bit normalized integer.
+  uint8_t toUnorm8(float value) {
+    float scaled = (value * 0.5f + 0.5f) * 255.0f + 0.5f;
+    return (uint8_t)(scaled < 0 ? 0 : scaled > 255 ? 255 : scaled);
+  }
+
+  /// Convert a value from -1 to 1 to a 16-bit normalized integer.
+  int16_t toSnorm16(float value) {
+    float scaled = value * 32767.0f;
+    scaled = scaled < -32767 ? -32767 : scaled > 32767 ? 32767 : scaled;
+    return (int16_t)std::lround(scaled);
+  }
+}
+
+
+
+void VertexPacking::Transform::matrix(float *matrix) const {
+  memset(matrix, 0, sizeof(float) * 16);
+  matrix[ 0] = extent.x;
+  matrix[ 5] = extent.y;
+  matrix[10] = extent.z;
+  matrix[12] = center.x;
+  matrix[13] = center.y;
+  matrix[14] = center.z;
+  matrix[15] = 1;
+}
+
+
+
+void VertexPacking::setEnabled(bool enabled) {
+  packingEnabled = enabled;
+}
+
+bool VertexPacking::enabled() {
+  return packingEnabled;
+}
+
+const char *VertexPacking::vertexShader(const char *name) {
+  if (!packingEnabled)
+    return name;
+  if (strcmp(name, "zone.vertex") == 0)
+    return "packed.zone.vertex";
+  if (strcmp(name, "instanced.vertex") == 0)
+    return "packed.instanced.vertex";
+  if (strcmp(name, "extruded.vertex") == 0)
+    return "packed.extruded.vertex";
+  return "packed.vertex";
+}
+
+
+
+VertexPacking::Transform VertexPacking::fit(const Real3 *positions, size_t count, size_t stride) {
+  if (count == 0)
+    return { Real3(0), Real3(0) };
+
+  // Find the bounds of the positions
+  const uint8_t *data = (const uint8_t *)positions;
+  Real3 min = *positions, max = *positions;
+  for (size_t i = 1; i < count; i++) {
+    const Real3 &position = *(const Real3 *)(data + i * stride);
+    min = min.min(position);
+    max = max.max(position);
+  }
+
+  return { (min + max) * Real3(0.5), (max - min) * Real3(0.5) };
+}
+
+void VertexPacking::pack(Vertex &vertex, const Transform &transform, Real3 position, Real3 normal, Real2 uv) {
+  // Position, relative to the bounds
+  auto axis = [](float relative, float extent) {
+    return toSnorm16(extent > 0 ? relative / extent : 0.0f);
+  };
+  Real3 relative = position - transform.center;
+  vertex.position[0] = axis(relative.x, transform.extent.x);
+  vertex.position[1] = axis(relative.y, transform.extent.y);
+  vertex.position[2] = axis(relative.z, transform.extent.z);
+  vertex.position[3] = 0;
+
+  // Octahedral normal, folded around the up (Y) axis
+  float a = normal.x, b = normal.z, c = normal.y;
+  float length = std::fabs(a) + std::fabs(b) + std::fabs(c);
+  if (length > 0) {
+    a /= length;
+    b /= length;
+  } else {
+    // Degenerate, point up
+    a = b = 0;
+    c = 1;
+  }
+  if (c < 0) {
+    float folded = (1 - std::fabs(b)) * (a >= 0 ? 1 : -1);
+    b = (1 - std::fabs(a)) * (b >= 0 ? 1 : -1);
+    a = folded;
+  }
+  vertex.normalTile[0] = toUnorm8(a);
+  vertex.normalTile[1] = toUnorm8(b);
+
+  // Texture coordinates, with the whole tiles of V kept separately
+  float v = uv.y;
+  float tiles = std::floor(v);
+  tiles = tiles < 0 ? 0 : tiles > 65535 ? 65535 : tiles;
+  uint16_t tile = (uint16_t)tiles;
+  vertex.uv[0] = toHalf(uv.x);
+  vertex.uv[1] = toHalf(v - tiles);
+  vertex.normalTile[2] = tile & 0xFF;
+  vertex.normalTile[3] = tile >> 8;
+}
+
+const bgfx::VertexLayout &VertexPacking::layout() {
+  static bgfx::VertexLayout layout = [] {
+    bgfx::VertexLayout layout;
+    layout.begin()
+        .add(bgfx::Attrib::Position , 4, bgfx::AttribType::Int16, true)
+        .add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Half)
+        .add(bgfx::Attrib::TexCoord1, 4, bgfx::AttribType::Uint8, true)
+    .end();
+    return layout;
+  }();
+  return layout;
+}
+
+const bgfx::VertexLayout &VertexPacking::colorLayout() {
+  static bgfx::VertexLayout layout = [] {
+    bgfx::VertexLayout layout;
+    layout.begin()
+        .add(bgfx::Attrib::Position , 4, bgfx::AttribType::Int16, true)
+        .add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Half)
+        .add(bgfx::Attrib::TexCoord1, 4, bgfx::AttribType::Uint8, true)
+        .add(bgfx::Attrib::Color0   , 4, bgfx::AttribType::Uint8, true)
+    .end();
+    return layout;
+  }();
+  return layout;
+}
+
+
+
+void VertexPacking::track(bool packed, size_t vertices, size_t vertexBytes, size_t indexBytes) {
+  Usage &usage = usages[packed];
+  usage.meshes++;
+  usage.vertices    += vertices;
+  usage.vertexBytes += vertexBytes;
+  usage.indexBytes  += indexBytes;
+}
+
+void VertexPacking::untrack(bool packed, size_t vertices, size_t vertexBytes, size_t indexBytes) {
+  Usage &usage = usages[packed];
+  usage.meshes--;
+  usage.vertices    -= vertices;
+  usage.vertexBytes -= vertexBytes;
+  usage.indexBytes  -= indexBytes;
+}
+
+VertexPacking::Usage VertexPacking::usage(bool packed) {
+  return usages[packed];
+}
@@ -6,78 +6,147 @@
  */
 
 #include <CityBuilder/Roads/LaneDef.h>
-#include <CityBuilder/Tools/Markup.h>
+#include <CityBuilder/Tools/MarkupSchema.h>
+#include <CityBuilder/Jobs.h>
 #include <iostream>
+#include <memory>
+#include <vector>
 USING_NS_CITY_BUILDER
 
 Map<String, LaneDef> LaneDef::lanes { };
 
-bool LaneDef::load(const String &path) {
-  // Aliases
-  typedef LaneDef::Traffic Traffic;
+TextureArray &LaneDef::surfaces() {
+  static TextureArray *surfaces = new TextureArray(
+    BGFX_TEXTURE_NONE | BGFX_SAMPLER_NONE, true
+  );
+  return *surfaces;
+}
+
+namespace {
+  /// The contents of a lane definition file.
+  struct LaneFile : LaneDef {
+    /// The points of the lane profile.
+    List<ProfilePoint> points { };
+    
+    /// The name of the main texture.
+    String texture;
+  };
   
-  LaneDef lane { };
+  typedef LaneDef::Traffic Traffic;
   
-  List<ProfilePoint> profile { };
-  String texture;
-  bool success = parseMarkup(path, lane)
-    .section("lane")
-      .field("name", lane.name)
-    .section("texture")
-      .field("main", texture)
-    .section("profile")
-      .profilePoints(profile)
-    .section("traffic")
-      .records({ "U", "D" }, lane.traffic)
-        .set(&Traffic::type, {
+  /// The layout of a lane definition file.
+  constexpr auto laneSchema = Schema::document(
+    Schema::section("lane",
+      Schema::field("name", &LaneFile::name)),
+    Schema::section("texture",
+      Schema::field("main", &LaneFile::texture)),
+    Schema::section("profile",
+      Schema::profilePoints(&LaneFile::points)),
+    Schema::section("traffic",
+      Schema::records(&LaneFile::traffic, { "U", "D" },
+        Schema::set(&Traffic::type, {
           Traffic::Type::unordered,
           Traffic::Type::directional
-        })
-        .real(&Traffic::start)
-        .identifier("-")
-        .real(&Traffic::end)
-        .comma()
-        .real(&Traffic::elevation)
-        .match(&Traffic::category, {
+        }),
+        Schema::real(&Traffic::start),
+        Schema::identifier("-"),
+        Schema::real(&Traffic::end),
+        Schema::comma(),
+        Schema::real(&Traffic::elevation),
+        Schema::match(&Traffic::category, {
           { "all.peds", Traffic::Category::all_peds },
           { "all.vehicle", Traffic::Category::all_vehicles },
-        })
-        .option("connect")
-          .match(&Traffic::connection, {
+        }),
+        Schema::option("connect",
+          Schema::match(&Traffic::connection, {
             { "none", Traffic::Connection::none },
             { "same-direction", Traffic::Connection::sameDirection },
             { "nearest", Traffic::Connection::nearest }
-          })
-      .end()
-  ;
-  if (!success)
-    return false;
+          }))))
+  );
   
-  // Compute the profile mesh
-  lane.profile = profile;
-  
-  // Load the texture
-  if (!texture.isEmpty())
-    lane.mainTexture = new Texture("textures/" + texture);
+  /// Parse a lane definition file and compute its profile.
+  /// \param[in] path
+  ///   The path to the lane file.
+  /// \param[out] file
+  ///   The lane to parse into.
+  /// \remarks
+  ///   Only touches the file, so may run on many files at once.
+  bool parseFile(const String &path, LaneFile &file) {
+    if (!Schema::parse(path, file, laneSchema))
+      return false;
+    LaneDef &lane = file;
+    
+    // Compute the profile mesh
+    lane.profile = file.points;
+    
+    return true;
+  }
   
-  // Save
-  LaneDef::lanes.set(lane.name, lane);
+  /// Load the texture of a parsed lane and save it.
+  /// \param[in] file
+  ///   The parsed lane.
+  /// \remarks
+  ///   Creates the texture, so must be called from the main thread.
+  void save(LaneFile &file) {
+    LaneDef &lane = file;
+    
+    // Load the texture
+    if (!file.texture.isEmpty())
+      lane.mainTexture = new Texture(LaneDef::surfaces(), "textures/" + file.texture);
+    
+    // Save
+    LaneDef::lanes.set(lane.name, lane);
+  }
+}
+
+bool LaneDef::load(const String &path) {
+  LaneFile file { };
+  if (!parseFile(path, file))
+    return false;
+  save(file);
   
   return true;
 }
 
 bool LaneDef::loadBatch(const char *directory, ...) {
-  bool success = true;
-  
   String dir = directory;
   
+  List<String> paths { };
   const char *path;
   va_list args;
   va_start(args, directory);
   while ((path = va_arg(args, const char *))) {
-    success &= LaneDef::load(dir + path + ".lane");
+    paths.append(dir + path + ".lane");
   }
   va_end(args);
   
+  // Parse the files on every thread, then save them here in order
+  std::vector<LaneFile> files(paths.count());
+  std::unique_ptr<bool[]> parsed(new bool[paths.count()]);
+  const String *names = paths.begin();
+  Jobs::parallelFor("lane definitions", paths.count(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      parsed[i] = parseFile(names[i], files[i]);
+  });
+  
+  bool success = true;
+  for (size_t i = 0; i < files.size(); i++)
+    if (parsed[i])
+      save(files[i]);
+    else
+      success = false;
+  
   return success;
 }
+
+
+bool LaneDef::parse(const String &path, const char *contents, size_t length, LaneDef &lane) {
+  LaneFile file { };
+  if (!Schema::parse(path, contents, length, file, laneSchema))
+    return false;
+  file.profile = file.points;
+  lane = file;
+  
+  return true;
+}
@@ -0,0 +1,384 @@
+/**
+ * @file LaneGraph.cpp
+ * @brief The implementation of the lane-level routing graph.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Roads/LaneGraph.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// Meters per second in a mile per hour.
+  constexpr float milesPerHour = 0.44704f;
+
+  /// The scale of road cross sections, as they are meshed.
+  const Real scale = 0.333333333333;
+
+  /// Call a function with every road connected to a road, through a joint or
+  /// an intersection.
+  /// \param[in] road
+  ///   The road to find the neighbours of.
+  /// \param[in] body
+  ///   The function to call with each neighbour.
+  template <typename Body>
+  void forEachNeighbour(Road *road, Body body) {
+    for (const Connection *connection : { &road->start, &road->end })
+      switch (connection->type) {
+      case Connection::road:
+        body(connection->other.road);
+        break;
+      case Connection::intersection:
+        for (const Intersection::Arm &arm : connection->other.intersection->arms)
+          if (arm.road != road)
+            body(arm.road);
+        break;
+      case Connection::none:
+        break;
+      }
+  }
+
+  /// The number of directed segments that a road definition compiles into.
+  size_t segmentsPerRoad(RoadDef *road) {
+    size_t count = 0;
+    for (const RoadDef::Lane &lane : road->lanes)
+      for (const LaneDef::Traffic &traffic : lane.definition->traffic)
+        count +=
+          lane.direction == RoadDef::Lane::Direction::unordered ||
+          traffic.type   == LaneDef::Traffic::Type::unordered ? 2 : 1;
+    return count;
+  }
+}
+
+
+
+void LaneGraph::invalidate(Road *road) {
+  _queue(road);
+}
+
+void LaneGraph::invalidate(Intersection *intersection) {
+  for (const Intersection::Arm &arm : intersection->arms)
+    _queue(arm.road);
+}
+
+void LaneGraph::remove(Road *road) {
+  _release(road);
+
+  if (road->_laneQueued) {
+    for (size_t i = 0; i < _queued.count(); i++)
+      if (_queued[i] == road) {
+        _queued.remove(i);
+        break;
+      }
+    road->_laneQueued = false;
+  }
+
+  // Anything that led onto the road must be compiled again
+  _queueNeighbours(road);
+}
+
+bool LaneGraph::update() {
+  if (_queued.isEmpty() && _released.isEmpty())
+    return false;
+
+  Clock::time_point start = Clock::now();
+
+  // Create the segments of every queued road again, in place for roads that
+  // already have them
+  List<Road *> queued = _queued;
+  _queued.removeAll();
+  for (Road *road : queued) {
+    road->_laneQueued = false;
+    _build(road);
+  }
+
+  // Find every segment whose edges must be found again: those of the
+  // queued roads and their neighbours, and any that led onto a freed segment
+  size_t count = _segments.count();
+  size_t packed = _offsets.count() - 1;
+  const Segment *segments = _segments.begin();
+  const uint32_t *oldOffsets = _offsets.begin();
+  const Edge *oldEdges = _edges.begin();
+
+  std::vector<bool> stale(count, false);
+  auto markRoad = [&](Road *road) {
+    for (uint32_t id : road->_laneSegments)
+      stale[id] = true;
+  };
+  for (Road *road : queued) {
+    markRoad(road);
+    forEachNeighbour(road, markRoad);
+  }
+  if (!_released.isEmpty()) {
+    std::vector<bool> released(count, false);
+    for (uint32_t id : _released)
+      released[id] = true;
+    for (size_t id = 0; id < packed; id++)
+      for (uint32_t i = oldOffsets[id]; i < oldOffsets[id + 1] && !stale[id]; i++)
+        if (released[oldEdges[i].target])
+          stale[id] = true;
+  }
+
+  // Find the edges of the stale segments, noting whether each has as many
+  // edges as before
+  List<uint32_t> compiled { };
+  List<uint32_t> ranges { 0 };
+  List<Edge> found { };
+  bool inPlace = count == packed && _released.isEmpty();
+  for (size_t id = 0; id < count; id++)
+    if (segments[id].road != nullptr && (id >= packed || stale[id])) {
+      _connect((uint32_t)id, found);
+      compiled.append((uint32_t)id);
+      ranges.append((uint32_t)found.count());
+      inPlace = inPlace &&
+        ranges.last() - ranges[ranges.count() - 2] == oldOffsets[id + 1] - oldOffsets[id];
+    }
+
+  if (inPlace) {
+    // Overwrite the edges where they are
+    for (size_t i = 0; i < compiled.count(); i++)
+      for (uint32_t j = ranges[i], k = _offsets[compiled[i]]; j < ranges[i + 1]; j++, k++)
+        _edges[k] = found[j];
+  } else {
+    // Repack the edges, copying those of the segments that did not change
+    List<uint32_t> offsets { };
+    List<Edge> edges { };
+    offsets.reserve(count + 1);
+    edges.reserve(_edges.count() + found.count());
+    size_t next = 0;
+    for (size_t id = 0; id < count; id++) {
+      offsets.append((uint32_t)edges.count());
+      if (segments[id].road == nullptr)
+        continue;
+
+      if (next < compiled.count() && compiled[next] == id) {
+        for (uint32_t j = ranges[next]; j < ranges[next + 1]; j++)
+          edges.append(found[j]);
+        next++;
+      } else
+        for (uint32_t i = oldOffsets[id]; i < oldOffsets[id + 1]; i++)
+          edges.append(oldEdges[i]);
+    }
+    offsets.append((uint32_t)edges.count());
+    _offsets = offsets;
+    _edges = edges;
+  }
+
+  // Nothing leads onto the freed segments any more
+  _free.appendList(_released);
+  _released.removeAll();
+
+  _version++;
+  _stats.updates++;
+  _stats.segments += compiled.count();
+  _stats.time += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  return true;
+}
+
+
+
+void LaneGraph::_queue(Road *road) {
+  if (road->_laneQueued)
+    return;
+  road->_laneQueued = true;
+  _queued.append(road);
+}
+
+void LaneGraph::_queueNeighbours(Road *road) {
+  forEachNeighbour(road, [&](Road *neighbour) {
+    // Removed roads keep no segments, but may still be referenced by a
+    // stale connection
+    if (!neighbour->_laneSegments.isEmpty())
+      _queue(neighbour);
+  });
+}
+
+void LaneGraph::_release(Road *road) {
+  for (uint32_t id : road->_laneSegments) {
+    _segments[id].road = nullptr;
+    _released.append(id);
+  }
+  road->_laneSegments.removeAll();
+}
+
+void LaneGraph::_build(Road *road) {
+  RoadDef *definition = road->definition;
+  Real half = definition->dimensions.x * Real(0.5);
+  Real2 startPoint  = road->path.start(), endPoint  = road->path.end();
+  Real2 startNormal = road->path.normal(0), endNormal = road->path.normal(1);
+  float length = road->path.length();
+  size_t index = 0;
+
+  for (size_t l = 0; l < definition->lanes.count(); l++) {
+    const RoadDef::Lane &lane = definition->lanes[l];
+    for (size_t t = 0; t < lane.definition->traffic.count(); t++) {
+      const LaneDef::Traffic &traffic = lane.definition->traffic[t];
+
+      // Follow the middle of the traffic pattern
+      Real2 across = Real2(
+        (lane.position.x + (traffic.start + traffic.end) * Real(0.5) - half) * scale);
+      Real2 first = startPoint + startNormal * across;
+      Real2 last  = endPoint   + endNormal   * across;
+
+      float speed = traffic.category == LaneDef::Traffic::Category::all_peds ?
+        walkingSpeed :
+        (lane.speedLimit > 0 ? lane.speedLimit : defaultSpeedLimit) * milesPerHour;
+
+      Segment segment = {
+        road, (uint16_t)l, (uint8_t)t, true, traffic.category,
+        length, speed, length / speed, first, last
+      };
+
+      bool unordered =
+        lane.direction == RoadDef::Lane::Direction::unordered ||
+        traffic.type   == LaneDef::Traffic::Type::unordered;
+      for (int direction = 0; direction < (unordered ? 2 : 1); direction++) {
+        segment.forward = unordered ?
+          direction == 0 : lane.direction == RoadDef::Lane::Direction::right;
+        segment.start = segment.forward ? first : last;
+        segment.end   = segment.forward ? last  : first;
+
+        if (index < road->_laneSegments.count()) {
+          // Update the segment in place, as the lanes of a road never change
+          _segments[road->_laneSegments[index++]] = segment;
+          continue;
+        }
+
+        // Reuse a free segment if there is one
+        uint32_t id;
+        if (!_free.isEmpty()) {
+          id = _free.remove(_free.count() - 1);
+          _segments[id] = segment;
+        } else {
+          id = (uint32_t)_segments.count();
+          _segments.append(segment);
+        }
+        road->_laneSegments.append(id);
+        index++;
+      }
+    }
+  }
+}
+
+void LaneGraph::_connect(uint32_t id, List<Edge> &edges) const {
+  const Segment &segment = _segments[id];
+  const Connection &exit = segment.forward ? segment.road->end : segment.road->start;
+
+  // Find the nearest segment of a list that is allowed to follow this one
+  auto nearest = [&](const List<uint32_t> &candidates, auto allowed, float limit) {
+    uint32_t best = UINT32_MAX;
+    float distance = limit;
+    for (uint32_t candidate : candidates) {
+      const Segment &target = _segments[candidate];
+      if (target.category != segment.category || !allowed(target))
+        continue;
+      float d = segment.end.distance(target.start);
+      if (d <= distance) {
+        best = candidate;
+        distance = d;
+      }
+    }
+    return best;
+  };
+
+  switch (exit.type) {
+  case Connection::road: {
+    // Continue across the joint onto the lane that lines up with this one
+    uint32_t target = nearest(exit.other.road->_laneSegments,
+      [](const Segment &) { return true; }, jointTolerance);
+    if (target != UINT32_MAX)
+      edges.append({ target, 0, 0, false });
+    break;
+  }
+
+  case Connection::intersection: {
+    const RoadDef::Lane &lane = segment.road->definition->lanes[segment.lane];
+    LaneDef::Traffic::Connection rule = lane.definition->traffic[segment.traffic].connection;
+    if (rule == LaneDef::Traffic::Connection::none)
+      break;
+
+    auto turn = [&](uint32_t target) {
+      float length = segment.end.distance(_segments[target].start);
+      edges.append({ target, length, length / segment.speed, true });
+    };
+
+    for (const Intersection::Arm &arm : exit.other.intersection->arms) {
+      if (arm.road == segment.road && arm.start != segment.forward)
+        // The arm that the segment arrives from
+        continue;
+
+      // Only segments leaving the intersection along the arm
+      auto leaving = [&](const Segment &target) {
+        return target.forward == arm.start;
+      };
+
+      if (rule == LaneDef::Traffic::Connection::sameDirection) {
+        for (uint32_t target : arm.road->_laneSegments) {
+          const Segment &other = _segments[target];
+          const RoadDef::Lane &otherLane = other.road->definition->lanes[other.lane];
+          if (other.category == segment.category && leaving(other) &&
+              otherLane.definition->traffic[other.traffic].connection == rule)
+            turn(target);
+        }
+      } else {
+        uint32_t target = nearest(arm.road->_laneSegments, leaving, INFINITY);
+        if (target != UINT32_MAX)
+          turn(target);
+      }
+    }
+    break;
+  }
+
+  case Connection::none: {
+    // Turn around at the dead end onto the nearest lane going the other way
+    uint32_t target = nearest(segment.road->_laneSegments,
+      [&](const Segment &other) { return other.forward != segment.forward; }, INFINITY);
+    if (target != UINT32_MAX) {
+      float length = segment.end.distance(_segments[target].start);
+      edges.append({ target, length, length / segment.speed, true });
+    }
+    break;
+  }
+  }
+}
+
+
+
+void LaneGraph::buildGrid(RoadDef *definition, size_t segments, List<Road *> &roads, List<Intersection *> &intersections) {
+  size_t perRoad = segmentsPerRoad(definition);
+  if (perRoad == 0)
+    return;
+
+  // A square grid of n by n intersections has 2n(n - 1) roads
+  size_t count = std::max(segments / perRoad, (size_t)1);
+  size_t n = 2;
+  while (2 * n * (n - 1) < count)
+    n++;
+
+  const Real spacing = 60;
+  size_t first = intersections.count();
+  for (size_t y = 0; y < n; y++)
+    for (size_t x = 0; x < n; x++)
+      intersections.append(new Intersection({ Real(x) * spacing, Real(y) * spacing }));
+
+  auto connect = [&](size_t a, size_t b) {
+    Intersection *start = intersections[first + a], *end = intersections[first + b];
+    Road *road = new Road(definition, new Line2(start->center, end->center));
+    start->addRoad(road);
+    end->addRoad(road);
+    roads.append(road);
+  };
+  for (size_t y = 0; y < n; y++)
+    for (size_t x = 0; x < n; x++) {
+      if (x + 1 < n)
+        connect(y * n + x, y * n + x + 1);
+      if (y + 1 < n)
+        connect(y * n + x, (y + 1) * n + x);
+    }
+}
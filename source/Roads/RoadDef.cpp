@@ -6,118 +6,173 @@
  */
 
 #include <CityBuilder/Roads/RoadDef.h>
-#include <CityBuilder/Tools/Markup.h>
+#include <CityBuilder/Tools/MarkupSchema.h>
 #include <CityBuilder/Storage/Map.h>
+#include <CityBuilder/Jobs.h>
 #include <iostream>
+#include <memory>
+#include <vector>
 USING_NS_CITY_BUILDER
 
 Map<String, RoadDef> RoadDef::roads { };
 
-bool RoadDef::load(const String &path) {
+namespace {
+  /// The contents of a road definition file.
+  struct RoadFile : RoadDef {
+    /// The points of the decorations profile.
+    List<ProfilePoint> points { };
+    
+    /// The name of the decorations texture.
+    String texture;
+  };
+  
   // Aliases
   typedef RoadDef::Lane Lane;
   typedef RoadDef::Divider Divider;
   
-  RoadDef road { };
-  
-  List<ProfilePoint> decorations { };
-  String texture;
-  bool success = parseMarkup(path, road)
-    .section("road")
-      .field("name", road.name)
-      .field("allow-buildings", road.allowBuildings, {
+  /// The layout of a road definition file.
+  /// \remarks
+  ///   Lanes are matched against `LaneDef::lanes` when parsing, so lanes must
+  ///   be loaded before the roads that use them.
+  constexpr auto roadSchema = Schema::document(
+    Schema::section("road",
+      Schema::field("name", &RoadFile::name),
+      Schema::field("allow-buildings", &RoadFile::allowBuildings, {
         { "none" , RoadDef::Buildings::none  },
         { "left" , RoadDef::Buildings::left  },
         { "right", RoadDef::Buildings::right },
         { "all"  , RoadDef::Buildings::all   }
-      })
-    .section("texture")
-      .field("decorations", texture)
-    .section("decorations")
-      .field("extend", road.decorationsExtent, {
+      })),
+    Schema::section("texture",
+      Schema::field("decorations", &RoadFile::texture)),
+    Schema::section("decorations",
+      Schema::field("extend", &RoadFile::decorationsExtent, {
         { "none"  , RoadDef::DecorExtent::none   },
         { "center", RoadDef::DecorExtent::center }
-      })
-      .profilePoints(decorations)
-    .section("lanes")
-      .records({ "U", "L", "R" }, road.lanes)
-        .set(&Lane::direction, {
+      }),
+      Schema::profilePoints(&RoadFile::points)),
+    Schema::section("lanes",
+      Schema::records(&RoadFile::lanes, { "U", "L", "R" },
+        Schema::set(&Lane::direction, {
           Lane::Direction::unordered,
           Lane::Direction::left,
           Lane::Direction::right
-        })
-        .matchString(&Lane::definition, LaneDef::lanes)
-        .point(&Lane::position)
-        .option("speed")
-          .integer(&Lane::speedLimit)
-          .identifier("mph")
-      .end()
-    .section("dividers")
-      .records({ "cross-traffic", "cross-edge", "lane", "edge" }, road.dividers)
-        .set(&Divider::type, {
+        }),
+        Schema::matchString(&Lane::definition, &LaneDef::lanes),
+        Schema::point(&Lane::position),
+        Schema::option("speed",
+          Schema::integer(&Lane::speedLimit),
+          Schema::identifier("mph")))),
+    Schema::section("dividers",
+      Schema::records(&RoadFile::dividers, { "cross-traffic", "cross-edge", "lane", "edge" },
+        Schema::set(&Divider::type, {
           Divider::Type::crossTraffic,
           Divider::Type::crossEdge,
           Divider::Type::lane,
           Divider::Type::edge
-        })
-        .point(&Divider::position)
-      .end()
-  ;
-  if (!success)
-    return false;
-  
-  road.decorations = decorations;
+        }),
+        Schema::point(&Divider::position)))
+  );
   
-  // Load the texture
-  if (!texture.isEmpty())
-    road.decorationsTexture = new Texture("textures/" + texture);
-  
-  // Compute the bounds
-  road.dimensions = { 0, 0 };
-  for (const Lane &lane : road.lanes) {
-    Real2 bound = lane.position + lane.definition->profile.dimensions;
-    if (bound.x > road.dimensions.x) road.dimensions.x = bound.x;
-    if (bound.y > road.dimensions.y) road.dimensions.y = bound.y;
+  /// Parse a road definition file and compute its bounds.
+  /// \param[in] path
+  ///   The path to the road file.
+  /// \param[out] file
+  ///   The road to parse into.
+  /// \remarks
+  ///   Only touches the file and reads the loaded lanes, so may run on many
+  ///   files at once.
+  bool parse(const String &path, RoadFile &file) {
+    if (!Schema::parse(path, file, roadSchema))
+      return false;
+    RoadDef &road = file;
+    
+    road.decorations = file.points;
+    
+    // Compute the bounds
+    road.dimensions = { 0, 0 };
+    for (const Lane &lane : road.lanes) {
+      Real2 bound = lane.position + lane.definition->profile.dimensions;
+      if (bound.x > road.dimensions.x) road.dimensions.x = bound.x;
+      if (bound.y > road.dimensions.y) road.dimensions.y = bound.y;
+    }
+    if (road.decorations.dimensions.x > road.dimensions.x)
+      road.dimensions.x = road.decorations.dimensions.x;
+    if (road.decorations.dimensions.y > road.dimensions.y)
+      road.dimensions.y = road.decorations.dimensions.y;
+    
+    // Generate the end cap
+    // road.endCap = new SharedMesh();
+    // for (const Lane &lane : road.lanes)
+    //   if ((lane.position.x + lane.definition->profile.dimensions.x * Real(0.5)).approxLessEqual(road.dimensions.x * Real(0.5))) {
+    //     road.endCap->addRevolution(
+    //       {
+    //         lane.definition->profile,
+    //         lane.position,
+    //         0.1
+    //       },
+    //       lane.definition->mainTexture,
+    //       { 1, 1 }
+    //     );
+    //   }
+    // road.endCap->finish();
+    
+    return true;
   }
-  if (road.decorations.dimensions.x > road.dimensions.x)
-    road.dimensions.x = road.decorations.dimensions.x;
-  if (road.decorations.dimensions.y > road.dimensions.y)
-    road.dimensions.y = road.decorations.dimensions.y;
-  
-  // Generate the end cap
-  // road.endCap = new SharedMesh();
-  // for (const Lane &lane : road.lanes)
-  //   if ((lane.position.x + lane.definition->profile.dimensions.x * Real(0.5)).approxLessEqual(road.dimensions.x * Real(0.5))) {
-  //     road.endCap->addRevolution(
-  //       {
-  //         lane.definition->profile,
-  //         lane.position,
-  //         0.1
-  //       },
-  //       lane.definition->mainTexture,
-  //       { 1, 1 }
-  //     );
-  //   }
-  // road.endCap->finish();
   
-  // Save
-  RoadDef::roads.set(road.name, road);
+  /// Load the texture of a parsed road and save it.
+  /// \param[in] file
+  ///   The parsed road.
+  /// \remarks
+  ///   Creates the texture, so must be called from the main thread.
+  void save(RoadFile &file) {
+    RoadDef &road = file;
+    
+    // Load the texture
+    if (!file.texture.isEmpty())
+      road.decorationsTexture = new Texture(LaneDef::surfaces(), "textures/" + file.texture);
+    
+    // Save
+    RoadDef::roads.set(road.name, road);
+  }
+}
+
+bool RoadDef::load(const String &path) {
+  RoadFile file { };
+  if (!parse(path, file))
+    return false;
+  save(file);
   
   return true;
 }
 
 bool RoadDef::loadBatch(const char *directory, ...) {
-  bool success = true;
-  
   String dir = directory;
   
+  List<String> paths { };
   const char *path;
   va_list args;
   va_start(args, directory);
   while ((path = va_arg(args, const char *))) {
-    success &= RoadDef::load(dir + path + ".road");
+    paths.append(dir + path + ".road");
   }
   va_end(args);
   
+  // Parse the files on every thread, then save them here in order
+  std::vector<RoadFile> files(paths.count());
+  std::unique_ptr<bool[]> parsed(new bool[paths.count()]);
+  const String *names = paths.begin();
+  Jobs::parallelFor("road definitions", paths.count(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      parsed[i] = parse(names[i], files[i]);
+  });
+  
+  bool success = true;
+  for (size_t i = 0; i < files.size(); i++)
+    if (parsed[i])
+      save(files[i]);
+    else
+      success = false;
+  
   return success;
 }
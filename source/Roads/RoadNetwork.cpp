@@ -6,7 +6,13 @@
  */
 
 #include <CityBuilder/Roads/RoadNetwork.h>
+#include <CityBuilder/Jobs.h>
+#include <CityBuilder/Rendering/CommandRecorder.h>
+#include <CityBuilder/Rendering/CurveExtrusion.h>
+#include <CityBuilder/Rendering/DrawList.h>
 #include <CityBuilder/Rendering/Uniforms.h>
+#include <CityBuilder/Simulation/TrafficAssignment.h>
+#include <chrono>
 USING_NS_CITY_BUILDER
 
 namespace {
@@ -77,6 +83,91 @@ namespace {
     &dividerCrossEdgeMesh,
   };
   
+  /// Find how a road surface texture is drawn, preferring the shared texture
+  /// array so that every surface is drawn with the same binding (texture
+  /// tiling is baked into the texture coordinates of the chunks).
+  /// \param[in] texture
+  ///   The texture to draw.
+  /// \param[in] road
+  ///   The shader to draw with when the texture is in the array.
+  /// \param[in] pbr
+  ///   The shader to draw with otherwise.
+  /// \returns
+  ///   The shader, texture and uniform to draw the texture with.
+  DrawList::Material roadMaterial(Texture *texture, const Resource<Program> *road, const Resource<Program> *pbr) {
+    DrawList::Material material;
+    if (texture->array() != nullptr) {
+      float layer = (float)texture->layer();
+      material.program = road;
+      material.sampler = { 0, Uniforms::s_albedoArray, texture->array()->handle() };
+      material.uniform = { Uniforms::u_textureLayer, { layer, layer, layer, layer } };
+      return material;
+    }
+    
+    material.program = pbr;
+    material.sampler = { 0, Uniforms::s_albedo, texture->handle() };
+    material.uniform = { Uniforms::u_textureTile, { 1, 1, 1, 1 } };
+    return material;
+  }
+  
+  /// Find how a road texture is drawn for a chunk.
+  DrawList::Material chunkMaterial(Texture *texture) {
+    return roadMaterial(texture, &Program::road, &Program::pbr);
+  }
+  
+  /// Find how a road texture is drawn for an instanced end cap.
+  DrawList::Material instancedMaterial(Texture *texture) {
+    return roadMaterial(texture, &Program::roadInstanced, &Program::pbrInstanced);
+  }
+  
+  /// Find how a road texture is drawn for a strip extruded on the GPU.
+  DrawList::Material extrudedMaterial(Texture *texture) {
+    return roadMaterial(texture, &Program::roadExtruded, &Program::pbrExtruded);
+  }
+  
+  /// The number of visible chunks recorded by each task.
+  /// \remarks
+  ///   Large enough that a task outweighs the cost of handing it to a
+  ///   thread, small enough that a busy view is shared between every thread.
+  constexpr size_t chunksPerTask = 64;
+  
+  /// Find the draw list of a task, adding lists as needed.
+  /// \param[in,out] lists
+  ///   The draw lists of the tasks, kept between frames.
+  /// \param[in] task
+  ///   The index of the task.
+  /// \returns
+  ///   The draw list that the task records into.
+  /// \remarks
+  ///   Must be called from the main thread, before the tasks are recorded.
+  DrawList *taskList(List<Resource<DrawList>> &lists, size_t task) {
+    while (lists.count() <= task)
+      lists.append(new DrawList());
+    return lists[task].address();
+  }
+  
+  /// The road geometry of a level of detail.
+  struct RoadDetail {
+    /// The number of path points to advance between cross-sections.
+    int pathStride;
+    
+    /// The largest angle between the cross-sections of end caps.
+    Angle capStep;
+    
+    /// The tallest steep edge to drop from lane profiles, such as a curb.
+    Real collapseHeight;
+    
+    /// Whether or not dividers are drawn.
+    bool dividers;
+  };
+  
+  /// The road geometry of every level of detail.
+  const RoadDetail roadDetails[StaticBatch::levels] {
+    { 1,  5_deg, 0.0, true  },
+    { 2, 15_deg, 0.5, true  },
+    { 4, 30_deg, 0.5, false },
+  };
+  
   
   ProfileMesh zoneProfile = {{
     ProfilePoint {
@@ -112,6 +203,15 @@ namespace {
   
   /// The scale of road cross sections.
   const Real scale = 0.333333333333;
+  
+  /// The color of every congestion level, from free-flowing to over capacity.
+  const Color4 congestionColors[TrafficAssignment::congestionLevels] = {
+    Color4( 40, 200,  60, 255),
+    Color4(150, 210,  50, 255),
+    Color4(240, 210,  40, 255),
+    Color4(245, 130,  30, 255),
+    Color4(220,  40,  30, 255),
+  };
 }
 
 RoadNetwork::RoadNetwork() {
@@ -134,8 +234,15 @@ RoadNetwork::RoadNetwork() {
     )
   ) exit(1);
   
-  _markingTexture = new Texture("textures/lane-markers");
+  _markingTexture = new Texture(LaneDef::surfaces(), "textures/lane-markers");
   _zoneTexture = new Texture("textures/zone", (uint64_t) BGFX_SAMPLER_U_CLAMP);
+  
+  // Load all of the road surfaces as one texture array
+  LaneDef::surfaces().stream();
+}
+
+RoadNetwork::~RoadNetwork() {
+  Jobs::wait(_routing);
 }
 
 Road *RoadNetwork::add(Road *road) {
@@ -145,27 +252,15 @@ Road *RoadNetwork::add(Road *road) {
 }
 
 void RoadNetwork::remove(Road *road) {
+  // Remove the road from the lane graph and free its lots, once the router
+  // is done reading it
+  Jobs::wait(_routing);
+  _laneGraph.remove(road);
+  _parcels.remove(road);
+  
   // Remove the meshes
   if (!road->_meshes.isEmpty()) {
-    // Remove all the previous meshes
-    for (Road::_mesh &mesh : road->_meshes) {
-      if (mesh.texture == nullptr) {
-        // Remove from the divider meshes
-        for (intptr_t i = 0; i < _markings.count(); i++)
-          if (_markings[i].mesh.address() == mesh.mesh.address()) {
-            _markings.remove(i);
-            break;
-          }
-      } else {
-        // Remove from the standard meshes
-        auto &meshes = _meshes[mesh.texture];
-        for (intptr_t i = 0; i < meshes.count(); i++)
-          if (meshes[i].mesh.address() == mesh.mesh.address()) {
-            meshes.remove(i);
-            break;
-          }
-      }
-    }
+    _removeMeshes(road);
     road->_meshes.removeAll();
   }
   
@@ -179,6 +274,9 @@ void RoadNetwork::remove(Road *road) {
     road->_zoneMesh = nullptr;
   }
   
+  // Remove the congestion mesh
+  _removeCongestion(road);
+  
   for (intptr_t i = 0; i < _roads.count(); i++)
     if (_roads[i] == road) {
       _roads.remove(i);
@@ -381,6 +479,8 @@ namespace {
         r->setRightZone(road->rightZone());
       }
       
+      // Keep the lots clear of the splits where they are
+      network->parcels().split(road, roads);
       network->remove(road);
     } else
       roads.append(road);
@@ -790,32 +890,102 @@ void RoadNetwork::setZone(Road *road, bool side, ZoneDef *zone) {
   road->_dirty = true;
 }
 
+void RoadNetwork::setCongestion(const TrafficAssignment &assignment) {
+  for (Road *road : _roads) {
+    int levels[2] = {
+      TrafficAssignment::level(assignment.congestion(road, true )),
+      TrafficAssignment::level(assignment.congestion(road, false)),
+    };
+    if (levels[0] == road->_congestion[0] && levels[1] == road->_congestion[1])
+      continue;
+    _removeCongestion(road);
+    road->_congestion[0] = levels[0];
+    road->_congestion[1] = levels[1];
+    
+    // Cover every vehicle lane in the color of the direction it travels in
+    Resource<ColorMesh> mesh = nullptr;
+    for (const RoadDef::Lane &lane : road->definition->lanes)
+      for (const LaneDef::Traffic &traffic : lane.definition->traffic) {
+        if (traffic.category != LaneDef::Traffic::Category::all_vehicles)
+          continue;
+        int level;
+        if (
+          lane.direction == RoadDef::Lane::Direction::unordered ||
+          traffic.type   == LaneDef::Traffic::Type::unordered
+        )
+          level = std::max(levels[0], levels[1]);
+        else
+          level = levels[lane.direction == RoadDef::Lane::Direction::right ? 0 : 1];
+        
+        ProfileMesh profile = {{
+          ProfilePoint {
+            .position = { traffic.start, traffic.elevation },
+            .normal0 = { 0, 1 },
+            .uv0 = 0,
+            .type = ProfilePoint::Type::move
+          },
+          ProfilePoint {
+            .position = { traffic.end, traffic.elevation },
+            .normal0 = { 0, 1 },
+            .uv0 = 0,
+            .type = ProfilePoint::Type::move
+          },
+        }};
+        if (!mesh)
+          mesh = new ColorMesh();
+        mesh->extrude(profile, road->path.path(), congestionColors[level],
+          lane.position + Real2 { -road->definition->dimensions.x * Real(0.5), 0.15 }, scale);
+      }
+    
+    if (mesh) {
+      road->_congestionMesh = mesh;
+      _congestionMeshes.append(mesh);
+      mesh->load();
+    }
+  }
+}
+
+void RoadNetwork::clearCongestion() {
+  for (Road *road : _roads) {
+    road->_congestionMesh = nullptr;
+    road->_congestion[0] = road->_congestion[1] = -1;
+  }
+  _congestionMeshes.removeAll();
+  _visibleCongestion.removeAll();
+}
+
+
+
 void RoadNetwork::update() {
+  // Compile any changed roads into the lane graph and lots, before the
+  // extrusion mode marks every road as dirty
+  for (Road *road : _roads)
+    if (road->_dirty) {
+      _laneGraph.invalidate(road);
+      _parcels.invalidate(road);
+    }
+  for (Intersection *intersection : _intersections)
+    if (intersection->_dirty)
+      _laneGraph.invalidate(intersection);
+  
+  // Mesh every road again when the extrusion mode changes
+  bool extruded = CurveExtrusion::enabled();
+  if (extruded != _extruded) {
+    _extruded = extruded;
+    for (Road *road : _roads)
+      road->_dirty = true;
+  }
+  
   // Update the roads
+  auto start = std::chrono::steady_clock::now();
+  size_t meshed = 0;
+  List<Road *> dirty { };
   for (Road *road : _roads)
     if (road->_dirty) {
-      if (!road->_meshes.isEmpty()) {
-        // Remove all the previous meshes
-        for (Road::_mesh &mesh : road->_meshes) {
-          if (mesh.texture == nullptr) {
-            // Remove from the divider meshes
-            for (intptr_t i = 0; i < _markings.count(); i++)
-              if (_markings[i].mesh.address() == mesh.mesh.address()) {
-                _markings.remove(i);
-                break;
-              }
-          } else {
-            // Remove from the standard meshes
-            auto &meshes = _meshes[mesh.texture];
-            for (intptr_t i = 0; i < meshes.count(); i++)
-              if (meshes[i].mesh.address() == mesh.mesh.address()) {
-                meshes.remove(i);
-                break;
-              }
-          }
-        }
-        road->_meshes.removeAll();
-      }
+      // Remove all the previous meshes
+      _removeMeshes(road);
+      road->_meshes.removeAll();
+      meshed++;
       
       if (road->_zoneMesh) {
         // Remove the zone mesh
@@ -827,158 +997,95 @@ void RoadNetwork::update() {
         road->_zoneMesh = nullptr;
       }
       
-      
-      
-      // Create a new mesh
-      BSTree<LaneDef *, int> lanes;
-      
-      Real2 half = { -road->definition->dimensions.x * Real(0.5), 0 };
-      
-      // Add caps as appropriate
-      Angle startStart, startEnd;
-      bool startCap = false;
-      if (road->start.type == Connection::none) {
-        // Add an end cap
-        Real4 pointNormal = road->path.pointNormals().first();
-        Real2 point = { pointNormal.z, pointNormal.w };
-        startStart =  Angle(point);
-        startEnd   = -Angle(point);
-        startCap = true;
-      }
-      
-      Angle endStart, endEnd;
-      bool endCap = false;
-      if (road->end.type == Connection::none) {
-        // Add an end cap
-        Real4 pointNormal = road->path.pointNormals().last();
-        Real2 point = { pointNormal.z, pointNormal.w };
-        endStart = -Angle(point);
-        endEnd   =  Angle(point);
-        endCap = true;
-      }
+      // The congestion follows the old path until it is next set
+      _removeCongestion(road);
       
       
       
-      // Add a decorator if one exists
-      if (!road->definition->decorations.triangles.isEmpty()) {
-        if (!_meshes.has(road->definition->decorationsTexture.address()))
-          _meshes.set(road->definition->decorationsTexture.address(), { });
-        
-        Resource<Mesh> mesh = new Mesh();
-        road->_meshes.append({
-          road->definition->decorationsTexture.address(), mesh
-        });
-        _meshes[road->definition->decorationsTexture.address()]
-          .append({ mesh, { 1, road->path.length() } });
-        
-        // Extrude
-        mesh->extrude(road->definition->decorations,
-          road->path.path(), half, scale);
+      // Place the shared end caps as appropriate
+      if (road->start.type == Connection::none ||
+          road->end.type   == Connection::none) {
+        Real4 startNormal = road->path.pointNormals().first();
+        Real4   endNormal = road->path.pointNormals(). last();
+        Real3 start = { road->path.start().x, 0, road->path.start().y };
+        Real3   end = { road->path.  end().x, 0, road->path.  end().y };
         
-        // Add caps as appropriate
-        if (startCap)
-          mesh->halfRevolve(road->definition->decorations,
-            road->path.start(), startStart, startEnd, half, scale);
-        if (endCap)
-          mesh->halfRevolve(road->definition->decorations,
-            road->path.end(), endStart, endEnd, half, scale);
+        for (const _sharedMesh &cap : _caps(road->definition)) {
+          InstanceBatch &batch = cap.texture ? _capSurfaces : _capMarkings;
+          Texture *texture = cap.texture ? cap.texture : _markingTexture.address();
+          if (road->start.type == Connection::none)
+            batch.add(road, texture, cap.mesh, InstanceBatch::Instance::at(
+              start, Angle(Real2 { startNormal.z, startNormal.w })), cap.level);
+          if (road->end.type == Connection::none)
+            batch.add(road, texture, cap.mesh, InstanceBatch::Instance::at(
+              end, -Angle(Real2 { endNormal.z, endNormal.w })), cap.level);
+        }
       }
       
-      // Add the lanes
-      for (const RoadDef::Lane &lane : road->definition->lanes) {
-        Resource<Mesh> mesh = _addMesh(road, lane.definition, lanes);
-        mesh->extrude(lane.definition->profile,
-          road->path.path(), lane.position + half, scale);
-        
-        if (startCap)
-          mesh->halfRevolve(lane.definition->profile,
-            road->path.start(), startStart, startEnd,
-            lane.position + half, scale);
-        if (endCap)
-          mesh->halfRevolve(lane.definition->profile,
-            road->path.end(), endStart, endEnd,
-            lane.position + half, scale);
-      }
       
-      // Add any markings
-      if (!road->definition->dividers.isEmpty()) {
-        // Update where the markings are drawn
-        half.y += 0.01;
-        half.x -= 0.1;
-        
-        // Create the divider mesh
-        Resource<Mesh> dividers = new Mesh();
-        _markings.append({ dividers, { 1, road->path.length() } });
-        road->_meshes.append({ nullptr, dividers });
-        
-        // Extrude the dividers
-        for (const RoadDef::Divider &divider : road->definition->dividers) {
-          dividers->extrude(
-            *dividerMeshes[(int)divider.type],
-            road->path.path(), divider.position + half, scale
-          );
-          
-          // Add caps as appropriate
-          if (startCap)
-            dividers->halfRevolve(*dividerMeshes[(int)divider.type],
-              road->path.start(), startStart, startEnd,
-              divider.position + half, scale);
-          if (endCap)
-            dividers->halfRevolve(*dividerMeshes[(int)divider.type],
-              road->path.end(), endStart, endEnd,
-              divider.position + half, scale);
+      
+      if (_extruded) {
+        // Place the shared cross-sections along the road, to be extruded on
+        // the GPU
+        for (const _sharedMesh &strip : _strips(road->definition)) {
+          InstanceBatch &batch = strip.texture ? _stripSurfaces : _stripMarkings;
+          Texture *texture = strip.texture ? strip.texture : _markingTexture.address();
+          CurveExtrusion::place(batch, road, texture, strip.mesh, road->path.path(),
+            roadDetails[strip.level].pathStride, strip.level);
         }
       }
       
-      // Push all the created meshes to the GPU
+      dirty.append(road);
+    }
+  
+  // Extrude the roads on every thread, since each only touches its own meshes
+  if (!_extruded) {
+    Road *const *roads = dirty.begin();
+    Jobs::parallelFor("road meshes", dirty.count(), 1, [this, roads](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++)
+        _extrude(roads[i]);
+    });
+  }
+  
+  for (Road *road : dirty) {
+    // Hand all the created meshes to their chunks
+    if (!_extruded)
       for (Road::_mesh &mesh : road->_meshes)
-        mesh.mesh->load();
+        if (mesh.texture == nullptr)
+          _markings.add(road, _markingTexture.address(), mesh.mesh, mesh.textureTiling, mesh.level);
+        else
+          _surfaces.add(road, mesh.texture, mesh.mesh, mesh.textureTiling, mesh.level);
+    
+    // Create a zone mesh
+    if (road->definition->allowBuildings != RoadDef::Buildings::none) {
+      Resource<ColorMesh> mesh = new ColorMesh();
       
-      // Create a zone mesh
-      if (road->definition->allowBuildings != RoadDef::Buildings::none) {
-        Resource<ColorMesh> mesh = new ColorMesh();
-        
-        // Extrude the zone
-        mesh->extrude(zoneProfile, road->path.path(), Color4(
-          road->_rightZone ? road->_rightZone->color : Color3(255, 255, 255),
-          255
-        ), { road->definition->dimensions.x * Real(0.5), 0.1 }, scale);
-        mesh->extrude(inverseZoneProfile, road->path.path(), Color4(
-          road->_leftZone ? road->_leftZone->color : Color3(255, 255, 255),
-          255
-        ), { -road->definition->dimensions.x * Real(0.5) - Real(9), 0.1 }, scale);
-        
-        road->_zoneMesh = mesh;
-        _zoneMeshes.append(mesh);
-        mesh->load();
-      }
+      // Extrude the zone
+      mesh->extrude(zoneProfile, road->path.path(), Color4(
+        road->_rightZone ? road->_rightZone->color : Color3(255, 255, 255),
+        255
+      ), { road->definition->dimensions.x * Real(0.5), 0.1 }, scale);
+      mesh->extrude(inverseZoneProfile, road->path.path(), Color4(
+        road->_leftZone ? road->_leftZone->color : Color3(255, 255, 255),
+        255
+      ), { -road->definition->dimensions.x * Real(0.5) - Real(9), 0.1 }, scale);
       
-      road->_dirty = false;
+      road->_zoneMesh = mesh;
+      _zoneMeshes.append(mesh);
+      mesh->load();
     }
+    
+    road->_dirty = false;
+  }
+  
+  auto roadsMeshed = std::chrono::steady_clock::now();
   
   // Update the intersections
   for (Intersection *intersection : _intersections)
     if (intersection->_dirty) {
       if (!intersection->_meshes.isEmpty()) {
         // Remove all the previous meshes
-        for (Intersection::_mesh &mesh : intersection->_meshes) {
-          if (mesh.texture == nullptr) {
-            // Remove from the divider meshes
-            for (intptr_t i = 0; i < _markings.count(); i++)
-              if (_markings[i].mesh.address() == mesh.mesh.address()) {
-                _markings.remove(i);
-                break;
-              }
-          } else {
-            // Remove from the standard meshes
-            auto &meshes = _meshes[mesh.texture];
-            for (intptr_t i = 0; i < meshes.count(); i++)
-              if (meshes[i].mesh.address() == mesh.mesh.address()) {
-                meshes.remove(i);
-                break;
-              }
-          }
-        }
+        _removeMeshes(intersection);
         intersection->_meshes.removeAll();
       }
       
@@ -1242,15 +1349,11 @@ void RoadNetwork::update() {
             intersection->center
           };
           
-          if (!_meshes.has(arm.road->definition->decorationsTexture.address()))
-            _meshes.set(arm.road->definition->decorationsTexture.address(), { });
-          
           Resource<Mesh> mesh = new Mesh();
           intersection->_meshes.append({
-            arm.road->definition->decorationsTexture.address(), mesh
+            arm.road->definition->decorationsTexture.address(), mesh,
+            { 1, line.length() }
           });
-          _meshes[arm.road->definition->decorationsTexture.address()]
-            .append({ mesh, { 1, line.length() } });
           
           // Extrude
           mesh->extrude(arm.road->definition->decorations,
@@ -1264,76 +1367,355 @@ void RoadNetwork::update() {
         armIndex++;
       }
       
-      // Push all the created meshes to the GPU
+      // Hand all the created meshes to their chunks
       for (Intersection::_mesh &mesh : intersection->_meshes)
-        mesh.mesh->load();
+        if (mesh.texture == nullptr)
+          _markings.add(intersection, _markingTexture.address(), mesh.mesh, mesh.textureTiling);
+        else
+          _surfaces.add(intersection, mesh.texture, mesh.mesh, mesh.textureTiling);
       
       intersection->_dirty = false;
     }
+  
+  // Rebuild the chunks of anything that changed
+  auto chunks = std::chrono::steady_clock::now();
+  _surfaces.update();
+  _markings.update();
+  
+  if (meshed > 0)
+    // Count the chunks rebuilt as part of meshing the roads
+    CurveExtrusion::track(meshed,
+      std::chrono::duration<double, std::micro>(roadsMeshed - start).count() +
+      std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - chunks).count());
+  
+  // Update the router in the background, leaving the lane graph as it is
+  // until the router is done with the last change
+  if (_routing.done()) {
+    Jobs::wait(_routing);
+    if (_laneGraph.update())
+      Jobs::run("router", [this] { _router.update(_laneGraph); }, &_routing);
+  }
+  _parcels.update();
+}
+
+void RoadNetwork::draw(const Frustum &frustum, Real3 eye, Frustum::Stats &stats) {
+  // Find the visible chunks and their levels of detail, a batch to a job
+  // since each only writes its own visible list
+  auto start = std::chrono::steady_clock::now();
+  Frustum::Stats found[6];
+  Jobs::parallelFor("road culling", 6, 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      switch (i) {
+      case 0: _surfaces     .cull(frustum, eye, found[i]); break;
+      case 1: _markings     .cull(frustum, eye, found[i]); break;
+      case 2: _capSurfaces  .cull(frustum, eye, found[i]); break;
+      case 3: _capMarkings  .cull(frustum, eye, found[i]); break;
+      case 4: _stripSurfaces.cull(frustum, eye, found[i]); break;
+      case 5: _stripMarkings.cull(frustum, eye, found[i]); break;
+      }
+  });
+  for (const Frustum::Stats &batch : found) {
+    stats.visible += batch.visible;
+    stats.culled  += batch.culled;
+  }
+  stats.time += std::chrono::duration<double, std::micro>(
+    std::chrono::steady_clock::now() - start).count();
+  
+  // Draw the road surfaces and markings, a range of chunks per task
+  _drawCalls = 0;
+  for (size_t first = 0; first < _surfaces.visibleCount(); first += chunksPerTask) {
+    DrawList *list = taskList(_surfaceLists, first / chunksPerTask);
+    CommandRecorder::add("road surfaces", [this, first, list](bgfx::Encoder *encoder) {
+      _surfaces.draw(*list, chunkMaterial, BGFX_STATE_DEFAULT, first, chunksPerTask);
+      _drawCalls += list->submit(encoder);
+    });
+  }
+  for (size_t first = 0; first < _markings.visibleCount(); first += chunksPerTask) {
+    DrawList *list = taskList(_markingLists, first / chunksPerTask);
+    CommandRecorder::add("road markings", [this, first, list](bgfx::Encoder *encoder) {
+      _markings.draw(*list, chunkMaterial,
+        BGFX_STATE_DEFAULT | BGFX_STATE_BLEND_ALPHA, first, chunksPerTask);
+      _drawCalls += list->submit(encoder);
+    });
+  }
+  
+  // Draw the instanced end caps, one at a time on GPUs without instancing
+  CommandRecorder::add("road caps", [this](bgfx::Encoder *encoder) {
+    _drawCalls += _capSurfaces.draw(encoder, instancedMaterial, BGFX_STATE_DEFAULT,
+      chunkMaterial);
+    _drawCalls += _capMarkings.draw(encoder, instancedMaterial,
+      BGFX_STATE_DEFAULT | BGFX_STATE_BLEND_ALPHA, chunkMaterial);
+  });
+  
+  // Draw the roads extruded on the GPU
+  if (_extruded)
+    CommandRecorder::add("road strips", [this](bgfx::Encoder *encoder) {
+      _drawCalls += _stripSurfaces.draw(encoder, extrudedMaterial, BGFX_STATE_DEFAULT);
+      _drawCalls += _stripMarkings.draw(encoder, extrudedMaterial,
+        BGFX_STATE_DEFAULT | BGFX_STATE_BLEND_ALPHA);
+    });
+  
+  _triangles =
+    _surfaces.triangles() + _capSurfaces.triangles() + _stripSurfaces.triangles() +
+    _markings.triangles() + _capMarkings.triangles() + _stripMarkings.triangles();
 }
 
-void RoadNetwork::draw() {
-  int count = 0;
-  int meshes = 0;
-  for (auto &_lane : _meshes) {
-    for (auto &lane : _lane) {
-    // Setup the material
-    lane.key->load(Uniforms::s_albedo);
-    count++;
+void RoadNetwork::drawZones(const Frustum &frustum, Frustum::Stats &stats) {
+  // Find the visible zones
+  auto start = std::chrono::steady_clock::now();
+  _visibleZones.removeAll();
+  for (const Resource<ColorMesh> &mesh : _zoneMeshes)
+    if (frustum.intersects(mesh->boundingBox()))
+      _visibleZones.append(mesh.address());
+  stats.visible += (int)_visibleZones.count();
+  stats.culled  += (int)(_zoneMeshes.count() - _visibleZones.count());
+  stats.time += std::chrono::duration<double, std::micro>(
+    std::chrono::steady_clock::now() - start).count();
+  
+  // Draw the zones
+  if (_visibleZones.isEmpty())
+    return;
+  CommandRecorder::add("zones", [this](bgfx::Encoder *encoder) {
+    // Every zone shares a material, bound once by the list
+    DrawList::Material material;
+    material.program = &Program::zone;
+    material.sampler = { 0, Uniforms::s_albedo, _zoneTexture->handle() };
+    material.uniform = { Uniforms::u_textureTile, { 1, 1, 1, 1 } };
+    uint64_t state =
+      BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A |
+      BGFX_STATE_DEPTH_TEST_LESS | BGFX_STATE_MSAA |
+      BGFX_STATE_BLEND_ALPHA;
     
-    for (_mesh &mesh : lane.value) {
-      // Update tiling
-      bgfx::setUniform(Uniforms::u_textureTile, Real4(mesh.textureTiling));
-      
-      // Draw
-      mesh.mesh->draw(Program::pbr);
-      meshes++;
+    for (const ColorMesh *mesh : _visibleZones)
+      _zoneList.add(material, state, mesh);
+    _zoneList.submit(encoder);
+  });
+}
+
+
+
+void RoadNetwork::drawCongestion(const Frustum &frustum, Frustum::Stats &stats) {
+  // Find the visible congestion
+  auto start = std::chrono::steady_clock::now();
+  _visibleCongestion.removeAll();
+  for (const Resource<ColorMesh> &mesh : _congestionMeshes)
+    if (frustum.intersects(mesh->boundingBox()))
+      _visibleCongestion.append(mesh.address());
+  stats.visible += (int)_visibleCongestion.count();
+  stats.culled  += (int)(_congestionMeshes.count() - _visibleCongestion.count());
+  stats.time += std::chrono::duration<double, std::micro>(
+    std::chrono::steady_clock::now() - start).count();
+  
+  // Draw the congestion with the zone material
+  if (_visibleCongestion.isEmpty())
+    return;
+  CommandRecorder::add("congestion", [this](bgfx::Encoder *encoder) {
+    DrawList::Material material;
+    material.program = &Program::zone;
+    material.sampler = { 0, Uniforms::s_albedo, _zoneTexture->handle() };
+    material.uniform = { Uniforms::u_textureTile, { 1, 1, 1, 1 } };
+    uint64_t state =
+      BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A |
+      BGFX_STATE_DEPTH_TEST_LESS | BGFX_STATE_MSAA |
+      BGFX_STATE_BLEND_ALPHA;
+    
+    for (const ColorMesh *mesh : _visibleCongestion)
+      _congestionList.add(material, state, mesh);
+    _congestionList.submit(encoder);
+  });
+}
+
+
+
+void RoadNetwork::_removeMeshes(const void *owner) {
+  _surfaces.remove(owner);
+  _markings.remove(owner);
+  _capSurfaces.remove(owner);
+  _capMarkings.remove(owner);
+  _stripSurfaces.remove(owner);
+  _stripMarkings.remove(owner);
+}
+
+void RoadNetwork::_removeCongestion(Road *road) {
+  if (!road->_congestionMesh)
+    return;
+  for (intptr_t i = 0; i < _congestionMeshes.count(); i++)
+    if (_congestionMeshes[i].address() == road->_congestionMesh.address()) {
+      _congestionMeshes.remove(i);
+      break;
+    }
+  road->_congestionMesh = nullptr;
+  road->_congestion[0] = road->_congestion[1] = -1;
+}
+
+void RoadNetwork::_extrude(Road *road) {
+  // Extrude the meshes of every level of detail
+  for (int level = 0; level < StaticBatch::levels; level++) {
+    const RoadDetail &detail = roadDetails[level];
+    BSTree<LaneDef *, int> lanes;
+    
+    Real2 half = { -road->definition->dimensions.x * Real(0.5), 0 };
+    
+    // Add a decorator if one exists
+    if (!road->definition->decorations.triangles.isEmpty()) {
+      Resource<Mesh> mesh = new Mesh();
+      road->_meshes.append({
+        road->definition->decorationsTexture.address(), mesh,
+        { 1, road->path.length() }, level
+      });
+    
+      // Extrude
+      mesh->extrude(road->definition->decorations,
+        road->path.path(), half, scale, detail.pathStride);
+    }
+    
+    // Add the lanes
+    for (const RoadDef::Lane &lane : road->definition->lanes) {
+      // Drop the curbs from distant lanes, without copying the profile
+      // that every road of the lane shares
+      ProfileMesh collapsed;
+      const ProfileMesh *profile = &lane.definition->profile;
+      if (detail.collapseHeight > 0) {
+        collapsed = lane.definition->profile.collapsed(detail.collapseHeight);
+        profile = &collapsed;
+      }
+    
+      Resource<Mesh> mesh = _addMesh(road, lane.definition, lanes, level);
+      mesh->extrude(*profile,
+        road->path.path(), lane.position + half, scale, detail.pathStride);
     }
+    
+    // Add any markings
+    if (detail.dividers && !road->definition->dividers.isEmpty()) {
+      // Update where the markings are drawn
+      half.y += 0.01;
+      half.x -= 0.1;
+    
+      // Create the divider mesh
+      Resource<Mesh> dividers = new Mesh();
+      road->_meshes.append({
+        nullptr, dividers, { 1, road->path.length() }, level
+      });
+    
+      // Extrude the dividers
+      for (const RoadDef::Divider &divider : road->definition->dividers)
+        dividers->extrude(
+          *dividerMeshes[(int)divider.type],
+          road->path.path(), divider.position + half, scale,
+          detail.pathStride
+        );
     }
   }
+}
+
+const List<RoadNetwork::_sharedMesh> &RoadNetwork::_caps(RoadDef *road) {
+  if (_capMeshes.has(road))
+    return _capMeshes[road];
   
-  // Draw the markings
-  if (!_markings.isEmpty()) {
-    // Setup the material
-    _markingTexture->load(Uniforms::s_albedo);
+  // Revolve the road around the origin, starting along the x-axis, once for
+  // every level of detail
+  List<_sharedMesh> caps { };
+  auto mesh = [&](Texture *texture, int level) -> Resource<Mesh> {
+    for (_sharedMesh &cap : caps)
+      if (cap.texture == texture && cap.level == level)
+        return cap.mesh;
+    caps.append({ texture, new Mesh(), level });
+    return caps.last().mesh;
+  };
+  
+  for (int level = 0; level < StaticBatch::levels; level++) {
+    const RoadDetail &detail = roadDetails[level];
+    Real2 half = { -road->dimensions.x * Real(0.5), 0 };
     
-    for (_mesh &mesh : _markings) {
-      // Update tiling
-      bgfx::setUniform(Uniforms::u_textureTile, Real4(mesh.textureTiling));
-      
-      bgfx::setState(BGFX_STATE_DEFAULT | BGFX_STATE_BLEND_ALPHA);
-      
-      // Draw
-      mesh.mesh->draw(Program::pbr);
-      meshes++;
+    // Add the decorations
+    if (!road->decorations.triangles.isEmpty())
+      mesh(road->decorationsTexture.address(), level)->halfRevolve(
+        road->decorations, Real2(0), Angle(0.0f), Angle(Angle::pi), half, scale,
+        detail.capStep);
+    
+    // Add the lanes
+    for (const RoadDef::Lane &lane : road->lanes) {
+      ProfileMesh profile = detail.collapseHeight > 0 ?
+        lane.definition->profile.collapsed(detail.collapseHeight) :
+        lane.definition->profile;
+      mesh(lane.definition->mainTexture.address(), level)->halfRevolve(
+        profile, Real2(0), Angle(0.0f), Angle(Angle::pi), lane.position + half,
+        scale, detail.capStep);
+    }
+    
+    // Add the dividers
+    if (detail.dividers && !road->dividers.isEmpty()) {
+      half.y += 0.01;
+      half.x -= 0.1;
+      for (const RoadDef::Divider &divider : road->dividers)
+        mesh(nullptr, level)->halfRevolve(*dividerMeshes[(int)divider.type],
+          Real2(0), Angle(0.0f), Angle(Angle::pi), divider.position + half, scale,
+          detail.capStep);
     }
   }
+  
+  // Share the caps between every road of the definition
+  for (_sharedMesh &cap : caps)
+    cap.mesh->load();
+  _capMeshes.set(road, caps);
+  return _capMeshes[road];
 }
 
-void RoadNetwork::drawZones() {
-  // Draw the zones
-  if (!_zoneMeshes.isEmpty()) {
-    // Setup the material
-    _zoneTexture->load(Uniforms::s_albedo);
-    bgfx::setUniform(Uniforms::u_textureTile, Real4(1.0));
+const List<RoadNetwork::_sharedMesh> &RoadNetwork::_strips(RoadDef *road) {
+  if (_stripMeshes.has(road))
+    return _stripMeshes[road];
+  
+  // Lay out the cross-section of the road once for every level of detail,
+  // as the CPU extrusion would
+  List<_sharedMesh> strips { };
+  auto mesh = [&](Texture *texture, int level) -> Resource<Mesh> {
+    for (_sharedMesh &strip : strips)
+      if (strip.texture == texture && strip.level == level)
+        return strip.mesh;
+    strips.append({ texture, new Mesh(), level });
+    return strips.last().mesh;
+  };
+  
+  for (int level = 0; level < StaticBatch::levels; level++) {
+    const RoadDetail &detail = roadDetails[level];
+    Real2 half = { -road->dimensions.x * Real(0.5), 0 };
+    
+    // Add the decorations
+    if (!road->decorations.triangles.isEmpty())
+      CurveExtrusion::addStrip(*mesh(road->decorationsTexture.address(), level),
+        road->decorations, half, scale);
     
-    for (Resource<ColorMesh> &mesh : _zoneMeshes) {
-      bgfx::setState(BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A |
-        BGFX_STATE_DEPTH_TEST_LESS | BGFX_STATE_MSAA |
-        BGFX_STATE_BLEND_ALPHA);
-      mesh->draw(Program::zone);
+    // Add the lanes
+    for (const RoadDef::Lane &lane : road->lanes) {
+      ProfileMesh profile = detail.collapseHeight > 0 ?
+        lane.definition->profile.collapsed(detail.collapseHeight) :
+        lane.definition->profile;
+      CurveExtrusion::addStrip(*mesh(lane.definition->mainTexture.address(), level),
+        profile, lane.position + half, scale);
+    }
+    
+    // Add the dividers
+    if (detail.dividers && !road->dividers.isEmpty()) {
+      half.y += 0.01;
+      half.x -= 0.1;
+      for (const RoadDef::Divider &divider : road->dividers)
+        CurveExtrusion::addStrip(*mesh(nullptr, level),
+          *dividerMeshes[(int)divider.type], divider.position + half, scale);
     }
   }
+  
+  // Share the strips between every road of the definition
+  for (_sharedMesh &strip : strips)
+    strip.mesh->load();
+  _stripMeshes.set(road, strips);
+  return _stripMeshes[road];
 }
 
-
-
-Resource<Mesh> RoadNetwork::_addMesh(Road *road, LaneDef *lane, BSTree<LaneDef *, int> &lanes) {
+Resource<Mesh> RoadNetwork::_addMesh(Road *road, LaneDef *lane, BSTree<LaneDef *, int> &lanes, int level) {
   Optional<int> selected;
   Resource<Mesh> mesh;
-  if (!_meshes.has(lane->mainTexture.address())) {
-    _meshes.set(lane->mainTexture.address(), { });
-  } else if ((selected = lanes[lane])) {
+  if ((selected = lanes[lane])) {
     // Add to the lane
     mesh = road->_meshes[*selected].mesh;
     return mesh;
@@ -1342,18 +1724,16 @@ Resource<Mesh> RoadNetwork::_addMesh(Road *road, LaneDef *lane, BSTree<LaneDef *
   // Create a new mesh
   mesh = new Mesh();
   lanes.insert(lane, road->_meshes.count());
-  road->_meshes.append({ lane->mainTexture.address(), mesh });
-  _meshes[lane->mainTexture.address()]
-    .append({ mesh, { 1, road->path.length() } });
+  road->_meshes.append({
+    lane->mainTexture.address(), mesh, { 1, road->path.length() }, level
+  });
   return mesh;
 }
 
 Resource<Mesh> RoadNetwork::_addMesh(Intersection *road, LaneDef *lane, BSTree<LaneDef *, int> &lanes) {
   Optional<int> selected;
   Resource<Mesh> mesh;
-  if (!_meshes.has(lane->mainTexture.address())) {
-    _meshes.set(lane->mainTexture.address(), { });
-  } else if ((selected = lanes[lane])) {
+  if ((selected = lanes[lane])) {
     // Add to the lane
     mesh = road->_meshes[*selected].mesh;
     return mesh;
@@ -1362,7 +1742,6 @@ Resource<Mesh> RoadNetwork::_addMesh(Intersection *road, LaneDef *lane, BSTree<L
   // Create a new mesh
   mesh = new Mesh();
   lanes.insert(lane, road->_meshes.count());
-  road->_meshes.append({ lane->mainTexture.address(), mesh });
-  _meshes[lane->mainTexture.address()].append({ mesh, { 1, 1 } });
+  road->_meshes.append({ lane->mainTexture.address(), mesh, { 1, 1 } });
   return mesh;
 }
@@ -0,0 +1,883 @@
+/**
+ * @file Router.cpp
+ * @brief The implementation of routing with contraction hierarchies.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Roads/Router.h>
+#include <CityBuilder/Jobs.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The time taken to travel between segments that are not connected.
+  constexpr float unreachable = INFINITY;
+
+  /// The largest part of the network left to order without dissecting it.
+  constexpr size_t leafSize = 16;
+
+  /// The number of places to try cutting a part at, on either side of its
+  /// middle.
+  constexpr int cuts = 3;
+
+  /// How many times more arcs than when the order was found the hierarchy may
+  /// grow to before the order is found again.
+  constexpr size_t arcGrowth = 2;
+
+  /// How many segments may be added, as a fraction of those when the order
+  /// was found, before the order is found again.
+  constexpr double countGrowth = 0.25;
+
+  /// The most arcs one update may add, as a fraction of those already in the
+  /// hierarchy, before finding the order again is the cheaper way to go on.
+  constexpr double fillGrowth = 1.0 / 256;
+
+  /// The starting value of the digest of a segment.
+  constexpr uint64_t digestBasis = 0xCBF29CE484222325;
+
+  /// Add a value to a digest.
+  uint64_t mix(uint64_t digest, uint32_t value) {
+    return (digest ^ value) * 0x100000001B3;
+  }
+
+  /// Add a time to a digest.
+  uint64_t mix(uint64_t digest, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return mix(digest, bits);
+  }
+
+  /// The time in microseconds since a point in time.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  /// Orders the segments of a network by nested dissection of their
+  /// positions, ranking the separators of each part above the part itself.
+  struct Dissection {
+    /// The first neighbour of every segment, with one more entry at the end.
+    const std::vector<uint32_t> &first;
+
+    /// The neighbours of every segment, in either direction.
+    const std::vector<uint32_t> &neighbours;
+
+    /// The position of every segment.
+    const std::vector<std::pair<float, float>> &positions;
+
+    /// The segment of every rank, filled from the top.
+    std::vector<uint32_t> &order;
+
+    /// The next rank to fill, plus one.
+    size_t top;
+
+    /// Which half of the part being split each segment is in, if any.
+    std::vector<uint8_t> side;
+
+    /// Find the smaller border between the two halves of a part.
+    /// \param[in] nodes
+    ///   The segments of the part, sorted along the axis to cut across.
+    /// \param[in] cut
+    ///   The number of segments in the first half.
+    /// \returns
+    ///   The segments of the smaller half that connect to the other half.
+    std::vector<uint32_t> border(const std::vector<uint32_t> &nodes, size_t cut) {
+      for (size_t i = 0; i < nodes.size(); i++)
+        side[nodes[i]] = i < cut ? 1 : 2;
+
+      std::vector<uint32_t> borders[2];
+      for (uint32_t node : nodes)
+        for (uint32_t i = first[node]; i < first[node + 1]; i++) {
+          uint8_t other = side[neighbours[i]];
+          if (other != 0 && other != side[node]) {
+            borders[side[node] - 1].push_back(node);
+            break;
+          }
+        }
+
+      for (uint32_t node : nodes)
+        side[node] = 0;
+      return borders[0].size() <= borders[1].size() ? borders[0] : borders[1];
+    }
+
+    /// Order a part of the network.
+    /// \param[in] nodes
+    ///   The segments of the part.
+    void dissect(std::vector<uint32_t> &nodes) {
+      if (nodes.size() <= leafSize) {
+        for (uint32_t node : nodes)
+          order[--top] = node;
+        return;
+      }
+
+      // Split the part in two across its longest side
+      float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+      for (uint32_t node : nodes) {
+        minX = std::min(minX, positions[node].first);
+        maxX = std::max(maxX, positions[node].first);
+        minY = std::min(minY, positions[node].second);
+        maxY = std::max(maxY, positions[node].second);
+      }
+      bool alongX = maxX - minX >= maxY - minY;
+      std::sort(nodes.begin(), nodes.end(), [&](uint32_t a, uint32_t b) {
+        return alongX ?
+          positions[a].first  < positions[b].first :
+          positions[a].second < positions[b].second;
+      });
+
+      // Try cutting at a few places around the middle, keeping whichever
+      // crosses the fewest connections (between roads rather than through
+      // intersections, usually)
+      std::vector<uint32_t> separator;
+      size_t cut = nodes.size() / 2;
+      for (int step = -cuts; step <= cuts; step++) {
+        size_t at = nodes.size() / 2 + step * (int)nodes.size() / (cuts * 8);
+        std::vector<uint32_t> border = this->border(nodes, at);
+        if (step == -cuts || border.size() < separator.size()) {
+          separator.swap(border);
+          cut = at;
+        }
+      }
+
+      for (size_t i = 0; i < nodes.size(); i++)
+        side[nodes[i]] = i < cut ? 1 : 2;
+      for (uint32_t node : separator)
+        side[node] = 3;
+
+      std::vector<uint32_t> halves[2];
+      for (uint32_t node : nodes) {
+        if (side[node] != 3)
+          halves[side[node] - 1].push_back(node);
+        side[node] = 0;
+      }
+
+      if (halves[0].empty() || halves[1].empty()) {
+        // Nothing to separate, such as when every segment is in one place
+        for (uint32_t node : nodes)
+          order[--top] = node;
+        return;
+      }
+
+      for (uint32_t node : separator)
+        order[--top] = node;
+      nodes.clear();
+      nodes.shrink_to_fit();
+      dissect(halves[1]);
+      dissect(halves[0]);
+    }
+  };
+}
+
+
+
+bool Router::update(const LaneGraph &graph) {
+  if (graph.version() == _version)
+    return false;
+
+  if (_order.isEmpty()) {
+    rebuild(graph);
+    return true;
+  }
+
+  Clock::time_point start = Clock::now();
+  const List<LaneGraph::Segment> &segments = graph.segments();
+  const List<uint32_t> &offsets = graph.offsets();
+  const List<LaneGraph::Edge> &edges = graph.edges();
+
+  size_t total = segments.count();
+  if (total > _orderedCount + (size_t)(_orderedCount * countGrowth) + 64) {
+    rebuild(graph);
+    return true;
+  }
+
+  // Rank any new segments below the rest, so that contracting them only
+  // joins their own neighbours together rather than joining them to every
+  // ancestor of their neighbours
+  if (total > _order.count()) {
+    uint32_t shift = (uint32_t)(total - _order.count());
+    List<uint32_t> order { };
+    order.reserve(total);
+    for (size_t id = _rank.count(); id < total; id++)
+      order.append((uint32_t)id);
+    order.appendList(_order);
+    _order = order;
+    for (uint32_t &rank : _rank)
+      rank += shift;
+    for (uint32_t rank = 0; rank < shift; rank++)
+      _rank.append(rank);
+
+    // The new ranks have no arcs yet, so every arc keeps its index
+    auto below = [&](List<uint32_t> &first) {
+      List<uint32_t> shifted { };
+      shifted.reserve(total + 1);
+      for (uint32_t rank = 0; rank < shift; rank++)
+        shifted.append(0);
+      shifted.appendList(first);
+      first = shifted;
+    };
+    below(_first);
+    below(_lowerFirst);
+    List<uint32_t> parent { };
+    parent.reserve(total);
+    for (uint32_t rank = 0; rank < shift; rank++)
+      parent.append(none);
+    for (uint32_t x : _parent)
+      parent.append(x == none ? none : x + shift);
+    _parent = parent;
+    for (_arc &arc : _arcs) {
+      arc.head += shift;
+      if (arc.upVia != none)
+        arc.upVia += shift;
+      if (arc.downVia != none)
+        arc.downVia += shift;
+    }
+    for (_lowerArc &arc : _lower)
+      arc.tail += shift;
+  }
+
+  // Contract the new connections into the hierarchy: a connection between
+  // two ranks joins the higher one to every other higher neighbour of the
+  // lower one, as if it had been there when the lower one was contracted
+  std::vector<std::vector<uint32_t>> added(total);
+  std::unordered_set<uint64_t> joined;
+  size_t addedCount = 0, fill = (size_t)(_arcs.count() * fillGrowth) + 256;
+  auto exists = [&](uint32_t low, uint32_t high) {
+    return _find(low, high) != none || joined.count((uint64_t)low << 32 | high) > 0;
+  };
+
+  std::vector<std::pair<uint32_t, uint32_t>> pending;
+  for (size_t id = 0; id < segments.count(); id++) {
+    if (segments[id].road == nullptr || segments[id].category != _category)
+      continue;
+    for (uint32_t i = offsets[id]; i < offsets[id + 1]; i++) {
+      uint32_t a = _rank[id], b = _rank[edges[i].target];
+      if (a != b && !exists(std::min(a, b), std::max(a, b)))
+        pending.push_back({ std::min(a, b), std::max(a, b) });
+    }
+  }
+
+  while (!pending.empty()) {
+    auto [low, high] = pending.back();
+    pending.pop_back();
+    if (exists(low, high))
+      continue;
+
+    // Join the new neighbour to the rest
+    auto join = [&](uint32_t other) {
+      if (other != high && !exists(std::min(high, other), std::max(high, other)))
+        pending.push_back({ std::min(high, other), std::max(high, other) });
+    };
+    for (uint32_t i = _first[low]; i < _first[low + 1]; i++)
+      join(_arcs[i].head);
+    for (uint32_t other : added[low])
+      join(other);
+
+    added[low].push_back(high);
+    joined.insert((uint64_t)low << 32 | high);
+    if (++addedCount > fill) {
+      rebuild(graph);
+      return true;
+    }
+  }
+
+  if (_arcs.count() + addedCount > _orderedArcs * arcGrowth + 1024) {
+    rebuild(graph);
+    return true;
+  }
+
+  if (addedCount > 0) {
+    // Merge the new arcs with the existing ones, which keep their travel
+    // times
+    const List<_arc> previous = _arcs;
+    const List<uint32_t> previousFirst = _first;
+    List<uint32_t> first { };
+    List<uint32_t> heads { };
+    first.reserve(total + 1);
+    heads.reserve(_arcs.count() + addedCount);
+    for (size_t rank = 0; rank < total; rank++) {
+      first.append((uint32_t)heads.count());
+      std::vector<uint32_t> &extra = added[rank];
+      std::sort(extra.begin(), extra.end());
+      uint32_t i = _first[rank], end = _first[rank + 1];
+      size_t j = 0;
+      while (i < end || j < extra.size())
+        if (j == extra.size() || (i < end && _arcs[i].head < extra[j]))
+          heads.append(_arcs[i++].head);
+        else
+          heads.append(extra[j++]);
+    }
+    first.append((uint32_t)heads.count());
+    _setArcs(first, heads);
+
+    const _arc *old = previous.begin();
+    _arc *arcs = _arcs.begin();
+    for (size_t rank = 0; rank < total; rank++) {
+      uint32_t j = _first[rank];
+      for (uint32_t i = previousFirst[rank]; i < previousFirst[rank + 1]; i++) {
+        while (arcs[j].head < old[i].head)
+          j++;
+        arcs[j] = old[i];
+      }
+    }
+  }
+
+  _stats.increments++;
+  _stats.incrementTime += since(start);
+
+  // Customize what passes over the changed segments and new arcs again
+  List<uint32_t> changed { };
+  _weigh(graph, changed);
+  for (size_t rank = 0; rank < total; rank++)
+    if (!added[rank].empty())
+      changed.append((uint32_t)rank);
+  _customize(graph, changed);
+  _version = graph.version();
+  return true;
+}
+
+void Router::rebuild(const LaneGraph &graph) {
+  Clock::time_point start = Clock::now();
+  const List<LaneGraph::Segment> &segments = graph.segments();
+  const List<uint32_t> &offsets = graph.offsets();
+  const List<LaneGraph::Edge> &edges = graph.edges();
+  size_t count = segments.count();
+
+  auto routed = [&](size_t id) {
+    return segments[id].road != nullptr && segments[id].category == _category;
+  };
+
+  // Find the neighbours of every segment, in either direction
+  std::vector<uint32_t> first(count + 1, 0), neighbours;
+  for (size_t id = 0; id < count; id++)
+    if (routed(id))
+      for (uint32_t i = offsets[id]; i < offsets[id + 1]; i++)
+        if (edges[i].target != id) {
+          first[id + 1]++;
+          first[edges[i].target + 1]++;
+        }
+  for (size_t id = 0; id < count; id++)
+    first[id + 1] += first[id];
+  neighbours.resize(first[count]);
+  {
+    std::vector<uint32_t> next(first.begin(), first.end() - 1);
+    for (size_t id = 0; id < count; id++)
+      if (routed(id))
+        for (uint32_t i = offsets[id]; i < offsets[id + 1]; i++)
+          if (edges[i].target != id) {
+            neighbours[next[id]++] = edges[i].target;
+            neighbours[next[edges[i].target]++] = (uint32_t)id;
+          }
+  }
+
+  // Rank the unconnected segments lowest, then dissect the rest
+  std::vector<uint32_t> order(count);
+  std::vector<uint32_t> connected;
+  std::vector<std::pair<float, float>> positions(count);
+  size_t bottom = 0;
+  for (size_t id = 0; id < count; id++)
+    if (first[id] == first[id + 1])
+      order[bottom++] = (uint32_t)id;
+    else {
+      connected.push_back((uint32_t)id);
+      Real2 middle = (segments[id].start + segments[id].end) * Real2(0.5);
+      positions[id] = { middle.x, middle.y };
+    }
+  Dissection dissection { first, neighbours, positions, order, count, std::vector<uint8_t>(count, 0) };
+  dissection.dissect(connected);
+
+  _rank.removeAll();
+  _order.removeAll();
+  _rank.reserve(count);
+  _order.reserve(count);
+  for (size_t id = 0; id < count; id++)
+    _rank.append(0);
+  for (size_t rank = 0; rank < count; rank++) {
+    _order.append(order[rank]);
+    _rank[order[rank]] = (uint32_t)rank;
+  }
+
+  // Contract every rank in order, joining its higher neighbours together,
+  // which all become neighbours of the lowest of them
+  std::vector<std::vector<uint32_t>> upper(count);
+  for (size_t id = 0; id < count; id++)
+    for (uint32_t i = first[id]; i < first[id + 1]; i++)
+      if (_rank[neighbours[i]] > _rank[id])
+        upper[_rank[id]].push_back(_rank[neighbours[i]]);
+
+  List<uint32_t> arcFirst { };
+  List<uint32_t> heads { };
+  arcFirst.reserve(count + 1);
+  for (size_t rank = 0; rank < count; rank++) {
+    std::vector<uint32_t> &higher = upper[rank];
+    std::sort(higher.begin(), higher.end());
+    higher.erase(std::unique(higher.begin(), higher.end()), higher.end());
+
+    arcFirst.append((uint32_t)heads.count());
+    for (uint32_t head : higher)
+      heads.append(head);
+
+    if (!higher.empty()) {
+      std::vector<uint32_t> &parent = upper[higher[0]];
+      parent.insert(parent.end(), higher.begin() + 1, higher.end());
+    }
+    higher.clear();
+    higher.shrink_to_fit();
+  }
+  arcFirst.append((uint32_t)heads.count());
+  _setArcs(arcFirst, heads);
+
+  _orderedArcs = _arcs.count();
+  _orderedCount = count;
+  _stats.orders++;
+  _stats.orderTime += since(start);
+
+  _customize(graph);
+  _version = graph.version();
+}
+
+
+
+List<float> Router::costs(const List<uint32_t> &from, const List<uint32_t> &to, int threads) const {
+  size_t columns = to.count();
+  List<float> table { };
+  table.reserve(from.count() * columns);
+  for (size_t i = 0; i < from.count() * columns; i++)
+    table.append(unreachable);
+  if (table.isEmpty())
+    return table;
+
+  auto routed = [&](uint32_t segment) {
+    return segment < _rank.count() && _costs[_rank[segment]] != unreachable;
+  };
+
+  // Search up from every destination, leaving what was found in buckets
+  struct Entry {
+    uint32_t rank;
+    uint32_t column;
+    float cost;
+  };
+  std::vector<Entry> entries;
+  {
+    Query query(*this);
+    query._prepare();
+    for (size_t column = 0; column < columns; column++) {
+      if (!routed(to[column]))
+        continue;
+      uint32_t rank = _rank[to[column]];
+      query._search(rank, false);
+      for (uint32_t x = rank; x != none; x = _parent[x])
+        if (query._backward[x] != unreachable)
+          entries.push_back({ x, (uint32_t)column, query._backward[x] });
+      query._reset();
+    }
+  }
+  std::vector<uint32_t> buckets(count() + 1, 0);
+  for (const Entry &entry : entries)
+    buckets[entry.rank + 1]++;
+  for (size_t rank = 0; rank < count(); rank++)
+    buckets[rank + 1] += buckets[rank];
+  std::vector<Entry> sorted(entries.size());
+  {
+    std::vector<uint32_t> next(buckets.begin(), buckets.end() - 1);
+    for (const Entry &entry : entries)
+      sorted[next[entry.rank]++] = entry;
+  }
+
+  // Search up from every origin in parallel, scanning the buckets
+  float *out = table.begin();
+  std::atomic<size_t> nextRow { 0 };
+  auto work = [&] {
+    Query query(*this);
+    query._prepare();
+    for (size_t row = nextRow++; row < from.count(); row = nextRow++) {
+      if (!routed(from[row]))
+        continue;
+      uint32_t rank = _rank[from[row]];
+      float start = _costs[rank];
+      query._search(rank, true);
+      for (uint32_t x = rank; x != none; x = _parent[x]) {
+        float reached = query._forward[x];
+        if (reached == unreachable)
+          continue;
+        for (uint32_t i = buckets[x]; i < buckets[x + 1]; i++) {
+          float &cell = out[row * columns + sorted[i].column];
+          cell = std::min(cell, start + reached + sorted[i].cost);
+        }
+      }
+      query._reset();
+    }
+  };
+
+  if (threads < 0)
+    threads = Jobs::threads() + 1;
+  threads = std::max(std::min(threads, (int)from.count()), 1);
+  Jobs::Counter workers;
+  for (int i = 1; i < threads; i++)
+    Jobs::run("costs", work, &workers);
+  work();
+  Jobs::wait(workers);
+
+  return table;
+}
+
+
+
+uint32_t Router::_find(uint32_t low, uint32_t high) const {
+  const _arc *arcs = _arcs.begin();
+  const _arc *begin = arcs + _first[low], *end = arcs + _first[low + 1];
+  const _arc *arc = std::lower_bound(begin, end, high,
+    [](const _arc &arc, uint32_t head) { return arc.head < head; });
+  return arc != end && arc->head == high ? (uint32_t)(arc - arcs) : none;
+}
+
+void Router::_setArcs(const List<uint32_t> &first, const List<uint32_t> &heads) {
+  _first = first;
+  _arcs.removeAll();
+  _arcs.reserve(heads.count());
+  for (uint32_t head : heads)
+    _arcs.append({ head, unreachable, unreachable, none, none });
+
+  // The parent of a rank is its lowest higher neighbour
+  size_t count = first.count() - 1;
+  _parent.removeAll();
+  _parent.reserve(count);
+  for (size_t rank = 0; rank < count; rank++)
+    _parent.append(first[rank] < first[rank + 1] ? heads[first[rank]] : none);
+
+  // Index the arcs by their heads too, to customize a rank at a time
+  std::vector<uint32_t> into(count + 1, 0);
+  for (uint32_t head : heads)
+    into[head + 1]++;
+  for (size_t rank = 0; rank < count; rank++)
+    into[rank + 1] += into[rank];
+  _lowerFirst.removeAll();
+  _lowerFirst.reserve(count + 1);
+  for (uint32_t index : into)
+    _lowerFirst.append(index);
+  _lower.removeAll();
+  _lower.reserve(heads.count());
+  for (size_t i = 0; i < heads.count(); i++)
+    _lower.append({ none, none });
+  _lowerArc *lower = _lower.begin();
+  for (uint32_t rank = 0; rank < count; rank++)
+    for (uint32_t i = first[rank]; i < first[rank + 1]; i++)
+      lower[into[heads[i]]++] = { rank, i };
+}
+
+void Router::_weigh(const LaneGraph &graph, List<uint32_t> &changed) {
+  const List<LaneGraph::Segment> &segments = graph.segments();
+  const List<uint32_t> &offsets = graph.offsets();
+  const List<LaneGraph::Edge> &edges = graph.edges();
+  size_t count = _order.count();
+
+  auto routed = [&](uint32_t id) {
+    return id < segments.count() &&
+      segments[id].road != nullptr && segments[id].category == _category;
+  };
+
+  _costs.removeAll();
+  _costs.reserve(count);
+  for (size_t rank = 0; rank < count; rank++)
+    _costs.append(routed(_order[rank]) ? segments[_order[rank]].cost : unreachable);
+
+  // Compare the travel time and connections of every segment with the last
+  // update
+  for (uint32_t id = 0; id < segments.count(); id++) {
+    uint64_t digest = 0;
+    if (routed(id)) {
+      digest = mix(digestBasis, segments[id].cost);
+      for (uint32_t i = offsets[id]; i < offsets[id + 1]; i++)
+        digest = mix(mix(digest, edges[i].target), edges[i].cost);
+    }
+
+    if (id >= _digests.count())
+      _digests.append(digest);
+    else if (_digests[id] != digest)
+      _digests[id] = digest;
+    else
+      continue;
+    changed.append(_rank[id]);
+  }
+}
+
+void Router::_customize(const LaneGraph &graph) {
+  Clock::time_point start = Clock::now();
+  size_t count = _order.count();
+
+  // Every segment is new to the order
+  List<uint32_t> changed { };
+  _digests.removeAll();
+  _weigh(graph, changed);
+
+  std::vector<uint32_t> slot(count, none);
+  for (uint32_t rank = 0; rank < count; rank++)
+    _customize(graph, rank, slot.data());
+
+  _stats.customized += count;
+  _stats.customizeTime += since(start);
+}
+
+void Router::_customize(const LaneGraph &graph, const List<uint32_t> &changed) {
+  Clock::time_point start = Clock::now();
+  size_t count = _order.count();
+  const uint32_t *parent = _parent.begin();
+  const _lowerArc *lower = _lower.begin();
+
+  // Mark the changed ranks, their lower neighbours and all of their
+  // ancestors, stopping at any ancestor already marked along with its own
+  std::vector<uint8_t> marked(count, 0);
+  auto mark = [&](uint32_t rank) {
+    for (uint32_t x = rank; x != none && !marked[x]; x = parent[x])
+      marked[x] = 1;
+  };
+  for (uint32_t rank : changed) {
+    mark(rank);
+    for (uint32_t i = _lowerFirst[rank]; i < _lowerFirst[rank + 1]; i++)
+      mark(lower[i].tail);
+  }
+
+  // Customize them lowest first, as the arcs below them are final
+  std::vector<uint32_t> slot(count, none);
+  size_t customized = 0;
+  for (uint32_t rank = 0; rank < count; rank++)
+    if (marked[rank]) {
+      _customize(graph, rank, slot.data());
+      customized++;
+    }
+
+  _stats.customized += customized;
+  _stats.customizeTime += since(start);
+}
+
+void Router::_customize(const LaneGraph &graph, uint32_t rank, uint32_t *slot) {
+  const List<uint32_t> &offsets = graph.offsets();
+  const List<LaneGraph::Edge> &edges = graph.edges();
+  const uint32_t *first = _first.begin();
+  const _lowerArc *lower = _lower.begin();
+  const float *costs = _costs.begin();
+  _arc *arcs = _arcs.begin();
+
+  for (uint32_t i = first[rank]; i < first[rank + 1]; i++) {
+    arcs[i].up = arcs[i].down = unreachable;
+    arcs[i].upVia = arcs[i].downVia = none;
+    slot[arcs[i].head] = i;
+  }
+
+  // Start from the connections of the lane graph, entering each segment
+  // costing the time to travel it
+  if (costs[rank] != unreachable) {
+    uint32_t id = _order[rank];
+    for (uint32_t e = offsets[id]; e < offsets[id + 1]; e++) {
+      uint32_t head = _rank[edges[e].target];
+      if (head > rank && costs[head] != unreachable) {
+        _arc &arc = arcs[slot[head]];
+        arc.up = std::min(arc.up, edges[e].cost + costs[head]);
+      }
+    }
+    for (uint32_t i = first[rank]; i < first[rank + 1]; i++) {
+      uint32_t head = arcs[i].head;
+      if (costs[head] == unreachable)
+        continue;
+      uint32_t other = _order[head];
+      for (uint32_t e = offsets[other]; e < offsets[other + 1]; e++)
+        if (edges[e].target == id)
+          arcs[i].down = std::min(arcs[i].down, edges[e].cost + costs[rank]);
+    }
+  }
+
+  // Shorten every arc by the routes through each of the lower ranks joined
+  // to both of its ends
+  for (uint32_t k = _lowerFirst[rank]; k < _lowerFirst[rank + 1]; k++) {
+    uint32_t z = lower[k].tail, i = lower[k].arc;
+    for (uint32_t j = i + 1; j < first[z + 1]; j++) {
+      _arc &arc = arcs[slot[arcs[j].head]];
+
+      // From the rank down to z, then up to the head, and back
+      float up = arcs[i].down + arcs[j].up;
+      if (up < arc.up) {
+        arc.up = up;
+        arc.upVia = z;
+      }
+      float down = arcs[j].down + arcs[i].up;
+      if (down < arc.down) {
+        arc.down = down;
+        arc.downVia = z;
+      }
+    }
+  }
+
+  for (uint32_t i = first[rank]; i < first[rank + 1]; i++)
+    slot[arcs[i].head] = none;
+}
+
+void Router::_unpack(uint32_t from, uint32_t to, List<uint32_t> &path) const {
+  std::vector<std::pair<uint32_t, uint32_t>> stack { { from, to } };
+  while (!stack.empty()) {
+    auto [a, b] = stack.back();
+    stack.pop_back();
+
+    const _arc &arc = _arcs[_find(std::min(a, b), std::max(a, b))];
+    uint32_t via = a < b ? arc.upVia : arc.downVia;
+    if (via == none)
+      path.append(_order[b]);
+    else {
+      // Unpack the first half first
+      stack.push_back({ via, b });
+      stack.push_back({ a, via });
+    }
+  }
+}
+
+
+
+float Router::Query::cost(uint32_t from, uint32_t to) {
+  const Router &router = _router;
+  if (from >= router._rank.count() || to >= router._rank.count())
+    return unreachable;
+  uint32_t source = router._rank[from], target = router._rank[to];
+  if (router._costs[source] == unreachable || router._costs[target] == unreachable)
+    return unreachable;
+
+  _prepare();
+  uint32_t meeting;
+  float cost = _join(source, target, meeting);
+  _reset();
+  return cost + router._costs[source];
+}
+
+float Router::Query::route(uint32_t from, uint32_t to, List<uint32_t> &path) {
+  const Router &router = _router;
+  if (from >= router._rank.count() || to >= router._rank.count())
+    return unreachable;
+  uint32_t source = router._rank[from], target = router._rank[to];
+  if (router._costs[source] == unreachable || router._costs[target] == unreachable)
+    return unreachable;
+
+  _prepare();
+  uint32_t meeting;
+  float cost = _join(source, target, meeting);
+
+  if (cost != unreachable) {
+    // Gather the ranks up to the meeting point and down from it
+    List<uint32_t> ranks { };
+    for (uint32_t x = meeting; x != source; x = _forwardFrom[x])
+      ranks.append(x);
+    ranks.append(source);
+    std::reverse(ranks.begin(), ranks.end());
+    for (uint32_t x = meeting; x != target; ) {
+      x = _backwardFrom[x];
+      ranks.append(x);
+    }
+
+    path.append(from);
+    for (size_t i = 0; i + 1 < ranks.count(); i++)
+      router._unpack(ranks[i], ranks[i + 1], path);
+  }
+
+  _reset();
+  return cost + router._costs[source];
+}
+
+void Router::Query::_search(uint32_t rank, bool forward) {
+  const uint32_t *parent = _router._parent.begin();
+  (forward ? _forwardStart : _backwardStart) = rank;
+  (forward ? _forward : _backward).begin()[rank] = 0;
+  for (uint32_t x = rank; x != none; x = parent[x])
+    _relax(x, forward);
+}
+
+float Router::Query::_join(uint32_t source, uint32_t target, uint32_t &meeting) {
+  const uint32_t *parent = _router._parent.begin();
+  float *forward = _forward.begin(), *backward = _backward.begin();
+  _forwardStart = source;
+  _backwardStart = target;
+  forward[source] = 0;
+  backward[target] = 0;
+
+  // Search up from both ends until they reach a common ancestor
+  uint32_t x = source, y = target;
+  while (x != y) {
+    if (x < y) {
+      _relax(x, true);
+      x = parent[x];
+    } else {
+      _relax(y, false);
+      y = parent[y];
+    }
+  }
+
+  // Search on up together, skipping ranks reached too slowly to improve on
+  // the fastest route found so far
+  float best = unreachable;
+  meeting = none;
+  for (; x != none; x = parent[x]) {
+    if (forward[x] + backward[x] < best) {
+      best = forward[x] + backward[x];
+      meeting = x;
+    }
+    if (forward[x] < best)
+      _relax(x, true);
+    if (backward[x] < best)
+      _relax(x, false);
+  }
+  return best;
+}
+
+void Router::Query::_relax(uint32_t rank, bool forward) {
+  const Router &router = _router;
+  float *reached = forward ? _forward.begin() : _backward.begin();
+  uint32_t *from = forward ? _forwardFrom.begin() : _backwardFrom.begin();
+  const _arc *arcs = router._arcs.begin();
+  const uint32_t *first = router._first.begin();
+
+  // Every arc up from a rank leads to one of its ancestors
+  float cost = reached[rank];
+  if (cost == unreachable)
+    return;
+  for (uint32_t i = first[rank]; i < first[rank + 1]; i++) {
+    float next = cost + (forward ? arcs[i].up : arcs[i].down);
+    if (next < reached[arcs[i].head]) {
+      reached[arcs[i].head] = next;
+      from[arcs[i].head] = rank;
+    }
+  }
+}
+
+void Router::Query::_reset() {
+  const uint32_t *parent = _router._parent.begin();
+  float *forward = _forward.begin(), *backward = _backward.begin();
+  for (uint32_t x = _forwardStart; x != none; x = parent[x])
+    forward[x] = unreachable;
+  for (uint32_t x = _backwardStart; x != none; x = parent[x])
+    backward[x] = unreachable;
+  _forwardStart = _backwardStart = none;
+}
+
+void Router::Query::_prepare() {
+  size_t count = _router.count();
+  if (_forward.count() == count)
+    return;
+
+  _forward.removeAll();
+  _backward.removeAll();
+  _forwardFrom.removeAll();
+  _backwardFrom.removeAll();
+  _forward.reserve(count);
+  _backward.reserve(count);
+  _forwardFrom.reserve(count);
+  _backwardFrom.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    _forward.append(unreachable);
+    _backward.append(unreachable);
+    _forwardFrom.append(none);
+    _backwardFrom.append(none);
+  }
+}
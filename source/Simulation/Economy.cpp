@@ -0,0 +1,159 @@
+/**
+ * @file Economy.cpp
+ * @brief The implementation of the city's economy.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Simulation/Economy.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  /// How far a value settles towards a target over a time.
+  /// \param[in] dt
+  ///   The time elapsed.
+  /// \param[in] time
+  ///   The time constant of the settling.
+  float settle(Real dt, float time) {
+    return 1 - std::exp(-(float)dt / time);
+  }
+}
+
+
+
+void Economy::update(const Parcels &parcels) {
+  if (parcels.version() == _parcelsVersion)
+    return;
+  Clock::time_point start = Clock::now();
+  const List<Parcels::Lot> &lots = parcels.lots();
+  while (_lots.count() < lots.count())
+    _lots.append({ nullptr, 0 });
+
+  // Count only the lots that changed unless an update was missed
+  if (parcels.version() == _parcelsVersion + 1)
+    for (uint32_t lot : parcels.changed())
+      _count(parcels, lot);
+  else
+    for (uint32_t lot = 0; lot < lots.count(); lot++)
+      _count(parcels, lot);
+  _parcelsVersion = parcels.version();
+
+  _stats.time += since(start);
+}
+
+void Economy::step(const Buildings &buildings, Real dt) {
+  Clock::time_point start = Clock::now();
+
+  // Move residents into the homes built, and out of those demolished at once
+  float homes = buildings.capacity(ZoneDef::Use::residential);
+  _residents += (homes - _residents) * settle(dt, moveInTime);
+  _residents = std::min(_residents, homes);
+  float jobs[] = {
+    0,
+    buildings.capacity(ZoneDef::Use::commercial),
+    buildings.capacity(ZoneDef::Use::industrial)
+  };
+  _jobs = jobs[1] + jobs[2];
+  float vacancy = this->vacancy();
+
+  // Follow the capacity every zone wants
+  for (Zone &zone : _zones) {
+    zone.capacity = buildings.capacity(zone.zone);
+    if (zone.zone->demand.isEmpty()) {
+      zone.wanted = INFINITY;
+      zone.demand = 1;
+      continue;
+    }
+
+    zone.wanted = 0;
+    for (const ZoneDef::Demand &rule : zone.zone->demand) {
+      float source = 1;
+      switch (rule.source) {
+      case ZoneDef::Demand::Source::base:        source = 1;               break;
+      case ZoneDef::Demand::Source::residential: source = _residents;      break;
+      case ZoneDef::Demand::Source::commercial:  source = jobs[1];         break;
+      case ZoneDef::Demand::Source::industrial:  source = jobs[2];         break;
+      case ZoneDef::Demand::Source::frontage:    source = zone.frontage;   break;
+      }
+      zone.wanted += (float)rule.weight * source;
+    }
+
+    float target = (zone.wanted - zone.capacity) / std::max(zone.wanted, 1.0f);
+    if (zone.zone->use != ZoneDef::Use::residential)
+      target -= laborWeight * vacancy;
+    target = std::min(std::max(target, -1.0f), 1.0f);
+    zone.demand += (target - zone.demand) * settle(dt, responseTime);
+  }
+
+  _stats.steps++;
+  _stats.time += since(start);
+}
+
+
+
+float Economy::demand(const ZoneDef *zone) const {
+  for (const Zone &existing : _zones)
+    if (existing.zone == zone)
+      return existing.demand;
+  return zone->demand.isEmpty() ? 1 : 0;
+}
+
+float Economy::demand(ZoneDef::Use use) const {
+  float demand = 0, frontage = 0;
+  for (const Zone &zone : _zones)
+    if (zone.zone->use == use) {
+      demand += zone.demand * zone.frontage;
+      frontage += zone.frontage;
+    }
+  return frontage > 0 ? demand / frontage : 0;
+}
+
+float Economy::wanted(const ZoneDef *zone) const {
+  for (const Zone &existing : _zones)
+    if (existing.zone == zone)
+      return existing.wanted;
+  return zone->demand.isEmpty() ? INFINITY : 0;
+}
+
+float Economy::unemployment() const {
+  float workers = this->workers();
+  return workers > 0 ? std::max(workers - _jobs, 0.0f) / workers : 0;
+}
+
+float Economy::vacancy() const {
+  return _jobs > 0 ? std::max(_jobs - workers(), 0.0f) / _jobs : 0;
+}
+
+
+
+void Economy::_count(const Parcels &parcels, uint32_t id) {
+  _lot &counted = _lots[id];
+  if (counted.zone)
+    _zoneOf(counted.zone).frontage -= counted.frontage;
+  counted = { nullptr, 0 };
+
+  const Parcels::Lot &lot = parcels.lots()[id];
+  if (lot.road && lot.zone && lot.buildable()) {
+    counted = { lot.zone, lot.end - lot.start };
+    _zoneOf(lot.zone).frontage += counted.frontage;
+  }
+  _stats.counted++;
+}
+
+Economy::Zone &Economy::_zoneOf(ZoneDef *zone) {
+  for (Zone &existing : _zones)
+    if (existing.zone == zone)
+      return existing;
+  _zones.append({ zone });
+  return _zones[_zones.count() - 1];
+}
@@ -0,0 +1,601 @@
+/**
+ * @file PedestrianSimulation.cpp
+ * @brief The implementation of the continuum pedestrian simulation.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Simulation/PedestrianSimulation.h>
+#include <CityBuilder/Roads/Intersection.h>
+#include <CityBuilder/Roads/Road.h>
+#include <CityBuilder/Jobs.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <queue>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The cells of every job, and of every sum of the totals, so that the
+  /// totals are added up in the same order whatever the number of threads.
+  constexpr size_t block = 1024;
+
+  /// The scale of road cross sections, as they are meshed.
+  const Real scale = 0.333333333333;
+
+  /// The bit of an edge that marks it as crossing a road.
+  constexpr uint32_t crossingBit = 0x80000000u;
+
+  /// The most pedestrians that a meter of sidewalk carries each second,
+  /// halfway to a standstill.
+  constexpr float capacity = LaneGraph::walkingSpeed * PedestrianSimulation::jamDensity / 4;
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  /// Whether walking straight between two points at the end of a sidewalk
+  /// crosses a road, rather than rounding a corner of the intersection.
+  /// \param[in] road
+  ///   The road that the sidewalk belongs to.
+  /// \param[in] forward
+  ///   Whether the sidewalk runs along the road.
+  /// \param[in] from
+  ///   The end of the sidewalk.
+  /// \param[in] to
+  ///   The start of the next sidewalk.
+  bool crosses(Road *road, bool forward, Real2 from, Real2 to) {
+    const Connection &exit = forward ? road->end : road->start;
+    if (exit.type != Connection::intersection)
+      // Turning around at a dead end or the end of a road crosses it
+      return exit.type == Connection::none;
+
+    // Each arm runs from the center out past the end of its road, where the
+    // crosswalks are, so a walk across it crosses that road
+    const Intersection *intersection = exit.other.intersection;
+    Real2 center = intersection->center;
+    for (const Intersection::Arm &arm : intersection->arms) {
+      Real2 end = arm.start ? arm.road->path.start() : arm.road->path.end();
+      Real2 direction = (end - center) * Real(2), walk = to - from, offset = from - center;
+      Real denominator = direction.x * walk.y - direction.y * walk.x;
+      if (denominator == 0)
+        continue;
+      Real along  = (offset.x * walk.y - offset.y * walk.x) / denominator;
+      Real across = (offset.x * direction.y - offset.y * direction.x) / denominator;
+      if (along >= 0 && along <= 1 && across >= 0 && across <= 1)
+        return true;
+    }
+    return false;
+  }
+
+  /// Fill a list with a number of copies of a value.
+  template<typename T>
+  void fill(List<T> &list, size_t count, const T &value) {
+    list.removeAll();
+    list.reserve(count);
+    for (size_t i = 0; i < count; i++)
+      list.append(value);
+  }
+}
+
+
+
+void PedestrianSimulation::setThreads(int threads) {
+  _requestedThreads = threads;
+}
+
+int PedestrianSimulation::threads() const {
+  return _requestedThreads == 0 ? 0 : Jobs::threads();
+}
+
+
+
+void PedestrianSimulation::sync(const LaneGraph &graph, const Parcels &parcels) {
+  bool moved = !_synced || _graph != &graph || _version != graph.version();
+  if (!moved && _parcelsVersion == parcels.version())
+    return;
+  _synced = true;
+
+  if (moved) {
+    _graph = &graph;
+    _version = graph.version();
+    const LaneGraph::Segment *segments = graph.segments().begin();
+    size_t segmentCount = graph.segments().count();
+
+    // Every sidewalk segment is a cell
+    List<_cell> cells { };
+    List<uint32_t> cellOf { };
+    fill(cellOf, segmentCount, none);
+    for (size_t id = 0; id < segmentCount; id++) {
+      const LaneGraph::Segment &segment = segments[id];
+      if (segment.road == nullptr ||
+          segment.category != LaneDef::Traffic::Category::all_peds)
+        continue;
+      const RoadDef *definition = segment.road->definition;
+      const RoadDef::Lane &lane = definition->lanes[segment.lane];
+      const LaneDef::Traffic &traffic = lane.definition->traffic[segment.traffic];
+      Real across = lane.position.x + (traffic.start + traffic.end) * Real(0.5) -
+        definition->dimensions.x * Real(0.5);
+      cellOf.begin()[id] = (uint32_t)cells.count();
+      cells.append({
+        (uint32_t)id, segment.road, segment.lane, segment.forward, across > 0,
+        segment.length,
+        std::max((float)((traffic.end - traffic.start) * scale), minimumWidth),
+        (segment.start + segment.end) * Real2(0.5)
+      });
+    }
+
+    // Keep only the edges between sidewalks, marking those across a road
+    const uint32_t *offsets = graph.offsets().begin();
+    const LaneGraph::Edge *edges = graph.edges().begin();
+    _edges.removeAll();
+    _edgeLengths.removeAll();
+    _firstEdge.removeAll();
+    _firstEdge.reserve(cells.count() + 1);
+    for (const _cell &cell : cells) {
+      _firstEdge.append((uint32_t)_edges.count());
+      for (uint32_t e = offsets[cell.segment]; e < offsets[cell.segment + 1]; e++) {
+        uint32_t target = cellOf.begin()[edges[e].target];
+        if (target == none)
+          continue;
+        bool crossing = edges[e].turn && edges[e].length > LaneGraph::jointTolerance &&
+          crosses(cell.road, cell.forward,
+            graph.segments()[cell.segment].end, graph.segments()[edges[e].target].start);
+        _edges.append(target | (crossing ? crossingBit : 0));
+        _edgeLengths.append(edges[e].length);
+      }
+    }
+    _firstEdge.append((uint32_t)_edges.count());
+
+    // Carry the pedestrians over to the cells whose segment is unchanged
+    List<float> walkers[purposes], shoppers { };
+    for (int p = 0; p < purposes; p++)
+      fill(walkers[p], cells.count(), 0.0f);
+    fill(shoppers, cells.count(), 0.0f);
+    for (size_t c = 0; c < _cells.count(); c++) {
+      const _cell &old = _cells.begin()[c];
+      uint32_t cell = old.segment < segmentCount ? cellOf.begin()[old.segment] : none;
+      if (cell == none)
+        continue;
+      const _cell &now = cells.begin()[cell];
+      if (now.road != old.road || now.lane != old.lane || now.forward != old.forward)
+        continue;
+      for (int p = 0; p < purposes; p++)
+        walkers[p].begin()[cell] = _walkers[p].begin()[c];
+      shoppers.begin()[cell] = _shoppers.begin()[c];
+    }
+    for (int p = 0; p < purposes; p++) {
+      _walkers[p] = walkers[p];
+      fill(_sent[p], cells.count(), 0.0f);
+      fill(_incoming[p], cells.count(), 0.0f);
+    }
+    _shoppers = shoppers;
+    _cells = cells;
+    _cellOf = cellOf;
+    fill(_supply, _cells.count(), 0.0f);
+    fill(_received, _cells.count(), 1.0f);
+    fill(_speed, _cells.count(), LaneGraph::walkingSpeed);
+    fill(_blockSums, (_cells.count() + block - 1) / block, _sums { });
+
+    // Start sampling again from scratch
+    fill(_sampled, _cells.count(), none);
+    _agents.removeAll();
+    _inView.removeAll();
+    _snapshots.removeAll();
+  }
+
+  // Share the frontage of every lot between the sidewalks along its side of
+  // its road
+  _parcelsVersion = parcels.version();
+  for (int use = 0; use < 2; use++)
+    fill(_frontage[use], _cells.count(), 0.0f);
+  for (const Parcels::Lot &lot : parcels.lots()) {
+    if (!lot.buildable() || lot.zone == nullptr ||
+        lot.zone->use == ZoneDef::Use::industrial)
+      continue;
+    int use = lot.zone->use == ZoneDef::Use::residential ? 0 : 1;
+    uint32_t sides = 0;
+    for (uint32_t segment : graph.segments(lot.road)) {
+      uint32_t cell = segment < _cellOf.count() ? _cellOf.begin()[segment] : none;
+      sides += cell != none && _cells.begin()[cell].right == lot.right;
+    }
+    for (uint32_t segment : graph.segments(lot.road)) {
+      uint32_t cell = segment < _cellOf.count() ? _cellOf.begin()[segment] : none;
+      if (cell != none && _cells.begin()[cell].right == lot.right)
+        _frontage[use].begin()[cell] += (lot.end - lot.start) / sides;
+    }
+  }
+
+  // Route both purposes at once
+  Clock::time_point start = Clock::now();
+  Jobs::Counter routing;
+  Jobs::run("pedestrian routes", [this]() { _route((int)Purpose::home); }, &routing);
+  _route((int)Purpose::shopping);
+  Jobs::wait(routing);
+  _stats.routes++;
+  _stats.routeTime += since(start);
+
+  // Fewer pedestrians set out the further they are from the shops
+  const _routes &shopping = _routesFor[(int)Purpose::shopping];
+  fill(_departures, _cells.count(), 0.0f);
+  for (size_t c = 0; c < _cells.count(); c++) {
+    float distance = shopping.distance.begin()[c];
+    if (distance <= maxWalk)
+      _departures.begin()[c] = _frontage[0].begin()[c] * tripsPerMeter / 3600 *
+        std::exp(-distance * impedance);
+  }
+}
+
+void PedestrianSimulation::populate(double pedestrians) {
+  for (int p = 0; p < purposes; p++) {
+    const List<uint32_t> &next = _routesFor[p].next;
+    size_t routed = 0;
+    for (uint32_t cell : next)
+      routed += cell != none;
+    if (routed == 0)
+      continue;
+
+    float each = (float)(pedestrians / purposes / routed);
+    float *walkers = _walkers[p].begin();
+    for (size_t c = 0; c < _cells.count(); c++)
+      if (next.begin()[c] != none)
+        walkers[c] += each;
+    _walking += (double)each * routed;
+  }
+}
+
+void PedestrianSimulation::step() {
+  if (_cells.isEmpty())
+    return;
+  Clock::time_point start = Clock::now();
+
+  _parallel(_send);
+  _parallel(_share);
+  _parallel(_move);
+
+  // Add the sums of every block up in order, so that the totals are the same
+  // whatever the number of threads
+  _sums total { };
+  for (const _sums &sums : _blockSums) {
+    total.walking += sums.walking;
+    total.shopping += sums.shopping;
+    total.departures += sums.departures;
+    total.arrivals += sums.arrivals;
+    total.crossings += sums.crossings;
+  }
+  _walking = total.walking;
+  _shopping = total.shopping;
+
+  _stats.steps++;
+  _stats.departures += total.departures;
+  _stats.arrivals += total.arrivals;
+  _stats.crossings += total.crossings;
+  _stats.stepTime += since(start);
+}
+
+int PedestrianSimulation::advance(Real elapsed) {
+  _unsampled += (float)elapsed;
+  _carry += (float)elapsed;
+  int steps = 0;
+  while (_carry >= timestep) {
+    step();
+    _carry -= timestep;
+    steps++;
+  }
+  return steps;
+}
+
+void PedestrianSimulation::sample(Real2 center, Real radius) {
+  Clock::time_point start = Clock::now();
+  float dt = _unsampled;
+  _unsampled = 0;
+
+  // Find the cells in view, remembering which were already
+  List<uint32_t> inView { };
+  std::vector<uint8_t> wasInView;
+  if (radius > 0)
+    for (size_t c = 0; c < _cells.count(); c++) {
+      const _cell &cell = _cells.begin()[c];
+      if (cell.middle.distance(center) <= radius + cell.length * 0.5f) {
+        wasInView.push_back(_sampled.begin()[c] != none);
+        inView.append((uint32_t)c);
+      }
+    }
+  for (uint32_t c : _inView)
+    _sampled.begin()[c] = none;
+  for (size_t k = 0; k < inView.count(); k++)
+    _sampled.begin()[inView.begin()[k]] = (uint32_t)k;
+
+  // Walk the agents on along their routes, dropping those that arrive or
+  // leave the view
+  std::vector<uint32_t> counts(inView.count() * purposes + 1, 0);
+  List<_agent> walked { };
+  walked.reserve(_agents.count());
+  for (_agent agent : _agents) {
+    agent.position += _speed.begin()[agent.cell] * dt;
+    const _routes &routes = _routesFor[agent.purpose];
+    while (agent.cell != none && agent.position >= _cells.begin()[agent.cell].length) {
+      agent.position -= _cells.begin()[agent.cell].length;
+      agent.cell = routes.next.begin()[agent.cell];
+    }
+    if (agent.cell == none || _sampled.begin()[agent.cell] == none)
+      continue;
+    walked.append(agent);
+    counts[_sampled.begin()[agent.cell] * purposes + agent.purpose + 1]++;
+  }
+
+  // Order the agents by cell and purpose
+  for (size_t b = 1; b < counts.size(); b++)
+    counts[b] += counts[b - 1];
+  std::vector<_agent> ordered(walked.count());
+  std::vector<uint32_t> cursor(counts.begin(), counts.end() - 1);
+  for (const _agent &agent : walked)
+    ordered[cursor[_sampled.begin()[agent.cell] * purposes + agent.purpose]++] = agent;
+
+  // Sample as many agents as every cell holds pedestrians, or a share of
+  // them when there are too many in view
+  double inViewCount = 0;
+  for (uint32_t c : inView)
+    for (int p = 0; p < purposes; p++)
+      inViewCount += _walkers[p].begin()[c];
+  float share = inViewCount > maxAgents ? (float)(maxAgents / inViewCount) : 1;
+  std::uniform_real_distribution<float> unit(0, 1);
+
+  _agents.removeAll();
+  _snapshots.removeAll();
+  for (size_t k = 0; k < inView.count(); k++) {
+    uint32_t c = inView.begin()[k];
+    const _cell &cell = _cells.begin()[c];
+    for (int p = 0; p < purposes; p++) {
+      float wanted = _walkers[p].begin()[c] * share;
+      uint32_t target = (uint32_t)wanted + (unit(_random) < wanted - std::floor(wanted));
+      _agent *first = ordered.data() + counts[k * purposes + p];
+      _agent *last  = ordered.data() + counts[k * purposes + p + 1];
+
+      // Drop the agents nearest the start of the cell, or spawn more there,
+      // or anywhere along it if it has only just come into view
+      std::sort(first, last, [](const _agent &a, const _agent &b) {
+        return a.position > b.position;
+      });
+      uint32_t kept = std::min(target, (uint32_t)(last - first));
+      for (uint32_t i = 0; i < kept; i++)
+        _agents.append(first[i]);
+      for (uint32_t i = kept; i < target; i++) {
+        float position = wasInView[k] ?
+          unit(_random) * std::min(cell.length, _speed.begin()[c] * dt) :
+          unit(_random) * cell.length;
+        _agents.append({ c, position, (uint8_t)p });
+      }
+    }
+  }
+  for (const _agent &agent : _agents)
+    _snapshots.append({
+      (float)_cells.begin()[agent.cell].segment, agent.position, _speed.begin()[agent.cell], 0
+    });
+  _inView = inView;
+
+  _stats.samples++;
+  _stats.sampleTime += since(start);
+}
+
+
+
+float PedestrianSimulation::pedestrians(uint32_t segment) const {
+  if (segment >= _cellOf.count() || _cellOf.begin()[segment] == none)
+    return 0;
+  uint32_t cell = _cellOf.begin()[segment];
+  return _walkers[0].begin()[cell] + _walkers[1].begin()[cell];
+}
+
+
+
+void PedestrianSimulation::_parallel(void (*body)(PedestrianSimulation &, size_t, size_t)) {
+  size_t count = _cells.count();
+  if (count == 0)
+    return;
+
+  // Hand out whole blocks, so that every block is summed by one range
+  size_t blocks = (count + block - 1) / block;
+  if (_requestedThreads == 0 || blocks == 1)
+    body(*this, 0, count);
+  else
+    Jobs::parallelFor("pedestrians", blocks, 1, [this, body, count](size_t begin, size_t end) {
+      body(*this, begin * block, std::min(end * block, count));
+    });
+}
+
+void PedestrianSimulation::_route(int purpose) {
+  _routes &routes = _routesFor[purpose];
+  const List<float> &ends = _frontage[purpose == (int)Purpose::shopping ? 1 : 0];
+  size_t count = _cells.count();
+  const _cell *cells = _cells.begin();
+  const uint32_t *edges = _edges.begin();
+  const float *lengths = _edgeLengths.begin();
+  const uint32_t *firstEdge = _firstEdge.begin();
+
+  // The edges arriving at every cell
+  std::vector<uint32_t> firstInto(count + 1, 0), into(_edges.count()), sources(_edges.count());
+  for (size_t e = 0; e < _edges.count(); e++)
+    firstInto[(edges[e] & ~crossingBit) + 1]++;
+  for (size_t c = 0; c < count; c++)
+    firstInto[c + 1] += firstInto[c];
+  {
+    std::vector<uint32_t> cursor(firstInto.begin(), firstInto.end() - 1);
+    for (uint32_t c = 0; c < count; c++)
+      for (uint32_t e = firstEdge[c]; e < firstEdge[c + 1]; e++) {
+        uint32_t slot = cursor[edges[e] & ~crossingBit]++;
+        into[slot] = e;
+        sources[slot] = c;
+      }
+  }
+
+  // Search back from every cell where routes end, at once, so that every
+  // cell finds the nearest end and the cell it continues onto to reach it
+  fill(routes.next, count, none);
+  fill(routes.crossing, count, (uint8_t)0);
+  fill(routes.end, count, (uint8_t)0);
+  fill(routes.distance, count, (float)INFINITY);
+  uint32_t *next = routes.next.begin();
+  uint8_t *crossing = routes.crossing.begin();
+  float *distance = routes.distance.begin();
+  std::priority_queue<std::pair<float, uint32_t>, std::vector<std::pair<float, uint32_t>>,
+    std::greater<std::pair<float, uint32_t>>> queue;
+  for (uint32_t c = 0; c < count; c++)
+    if (ends.begin()[c] > 0) {
+      routes.end.begin()[c] = 1;
+      distance[c] = cells[c].length * 0.5f;
+      queue.push({ distance[c], c });
+    }
+  while (!queue.empty()) {
+    std::pair<float, uint32_t> top = queue.top();
+    queue.pop();
+    uint32_t target = top.second;
+    if (top.first > distance[target])
+      continue;
+    for (uint32_t i = firstInto[target]; i < firstInto[target + 1]; i++) {
+      uint32_t source = sources[i], e = into[i];
+      bool crosses = edges[e] & crossingBit;
+      float reached = top.first + cells[source].length + lengths[e] +
+        (crosses ? crossingPenalty : 0);
+      if (reached < distance[source]) {
+        distance[source] = reached;
+        next[source] = target;
+        crossing[source] = crosses;
+        queue.push({ reached, source });
+      }
+    }
+  }
+
+  // The cells that continue onto every cell
+  fill(routes.first, count + 1, 0u);
+  uint32_t *first = routes.first.begin();
+  for (size_t c = 0; c < count; c++)
+    if (next[c] != none)
+      first[next[c] + 1]++;
+  for (size_t c = 0; c < count; c++)
+    first[c + 1] += first[c];
+  fill(routes.from, first[count], 0u);
+  std::vector<uint32_t> cursor(first, first + count);
+  for (uint32_t c = 0; c < count; c++)
+    if (next[c] != none)
+      routes.from.begin()[cursor[next[c]]++] = c;
+}
+
+void PedestrianSimulation::_send(PedestrianSimulation &self, size_t begin, size_t end) {
+  const _cell *cells = self._cells.begin();
+  const float *shopping = self._walkers[(int)Purpose::shopping].begin();
+  const float *home = self._walkers[(int)Purpose::home].begin();
+  const uint8_t *shoppingCrossing = self._routesFor[(int)Purpose::shopping].crossing.begin();
+  const uint8_t *homeCrossing = self._routesFor[(int)Purpose::home].crossing.begin();
+  float *speeds = self._speed.begin(), *supplies = self._supply.begin();
+  float *shoppingSent = self._sent[(int)Purpose::shopping].begin();
+  float *homeSent = self._sent[(int)Purpose::home].begin();
+  float dt = timestep;
+  for (size_t c = begin; c < end; c++) {
+    float total = shopping[c] + home[c];
+    float width = cells[c].width;
+    float density = total / (cells[c].length * width);
+
+    // Pedestrians slow down as the sidewalk fills up, and a cell sends on at
+    // most its capacity and receives at most what fits before it jams
+    speeds[c] = LaneGraph::walkingSpeed * std::max(1 - density / jamDensity, 0.0f);
+    float most = capacity * width * dt;
+    float sent = std::min(std::min(LaneGraph::walkingSpeed * density * width * dt, most), total);
+    supplies[c] = std::max(std::min(capacity,
+      LaneGraph::walkingSpeed * (jamDensity - density)) * width * dt, 0.0f);
+
+    // Split what is sent between the purposes, each only crossing a road at
+    // its share of the crossing's capacity
+    float share = total > 0 ? shopping[c] / total : 0;
+    float toShops = sent * share, toHome = sent - toShops;
+    if (shoppingCrossing[c])
+      toShops = std::min(toShops, crossingShare * most * share);
+    if (homeCrossing[c])
+      toHome = std::min(toHome, crossingShare * most * (1 - share));
+    shoppingSent[c] = toShops;
+    homeSent[c] = toHome;
+  }
+}
+
+void PedestrianSimulation::_share(PedestrianSimulation &self, size_t begin, size_t end) {
+  const float *departures = self._departures.begin(), *supplies = self._supply.begin();
+  float *received = self._received.begin();
+  float dt = timestep;
+  for (size_t c = begin; c < end; c++)
+    received[c] = departures[c] * dt;
+  for (int p = 0; p < purposes; p++) {
+    const uint32_t *from = self._routesFor[p].from.begin();
+    const uint32_t *first = self._routesFor[p].first.begin();
+    const float *sent = self._sent[p].begin();
+    float *incoming = self._incoming[p].begin();
+    for (size_t c = begin; c < end; c++) {
+      float sum = 0;
+      for (uint32_t i = first[c]; i < first[c + 1]; i++)
+        sum += sent[from[i]];
+      incoming[c] = sum;
+      received[c] += sum;
+    }
+  }
+
+  // Every cell sending onto this one gets the same share of what it sends
+  for (size_t c = begin; c < end; c++) {
+    float demand = received[c];
+    received[c] = demand > supplies[c] ? supplies[c] / demand : 1;
+  }
+}
+
+void PedestrianSimulation::_move(PedestrianSimulation &self, size_t begin, size_t end) {
+  float dt = timestep;
+  float leaving = 1 - std::exp(-dt / dwellTime);
+  const float *received = self._received.begin();
+  const float *departures = self._departures.begin();
+  float *shoppers = self._shoppers.begin();
+  for (size_t first = begin; first < end; first += block) {
+    size_t last = std::min(first + block, end);
+    _sums sums { };
+    for (int p = 0; p < purposes; p++) {
+      const _routes &routes = self._routesFor[p];
+      const uint32_t *next = routes.next.begin();
+      const uint8_t *crossing = routes.crossing.begin();
+      const uint8_t *ends = routes.end.begin();
+      const float *sent = self._sent[p].begin();
+      const float *incoming = self._incoming[p].begin();
+      float *walkers = self._walkers[p].begin();
+      for (size_t c = first; c < last; c++) {
+        // What arrives is this cell's share of what was sent onto it
+        float out = sent[c];
+        if (next[c] != none) {
+          out *= received[next[c]];
+          if (crossing[c])
+            sums.crossings += out;
+        } else if (ends[c]) {
+          // Pedestrians that reach the shops stay for a while before heading
+          // home, and those without any route give up
+          if (p == (int)Purpose::shopping)
+            shoppers[c] += out;
+          else
+            sums.arrivals += out;
+        }
+        walkers[c] += incoming[c] * received[c] - out;
+      }
+    }
+
+    float *shopping = self._walkers[(int)Purpose::shopping].begin();
+    float *home = self._walkers[(int)Purpose::home].begin();
+    for (size_t c = first; c < last; c++) {
+      float departing = departures[c] * dt * received[c];
+      float done = shoppers[c] * leaving;
+      shopping[c] += departing;
+      shoppers[c] -= done;
+      home[c] += done;
+      sums.departures += departing;
+      sums.walking += shopping[c] + home[c];
+      sums.shopping += shoppers[c];
+    }
+    self._blockSums.begin()[first / block] = sums;
+  }
+}
@@ -0,0 +1,76 @@
+/**
+ * @file Scheduler.cpp
+ * @brief The implementation of the simulation clock.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Simulation/Scheduler.h>
+#include <algorithm>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+}
+
+
+
+int Scheduler::advance(Real elapsed, const Tick &step) {
+  Clock::time_point start = Clock::now();
+  if (_stats.frames++ == 0)
+    _start = start;
+  _stats.wall = std::chrono::duration<double>(start - _start).count();
+  if (_paused || _multiplier <= 0)
+    return 0;
+
+  // Owe the time elapsed, only catching up with so much of a long frame
+  bool unlimited = std::isinf(_multiplier);
+  if (!unlimited) {
+    float owed = (float)elapsed;
+    if (!_exact && owed > maxFrame) {
+      _stats.dropped += (owed - maxFrame) * _multiplier;
+      owed = maxFrame;
+    }
+    _carry += owed * _multiplier;
+  } else
+    _carry = 0;
+
+  // Run the ticks owed, as many as the budget allows unless exact
+  int ticks = 0;
+  while (unlimited || _carry >= tick) {
+    step(tick);
+    _time += tick;
+    ticks++;
+    if (!unlimited)
+      _carry -= tick;
+    if ((unlimited || !_exact) && since(start) >= budget)
+      break;
+  }
+
+  // Fall behind by at most a frame, slowing down rather than spiralling
+  if (!_exact && !unlimited && _carry > maxFrame * _multiplier) {
+    _stats.dropped += _carry - maxFrame * _multiplier;
+    _carry = maxFrame * _multiplier;
+  }
+
+  double time = since(start);
+  _stats.ticks += ticks;
+  _stats.simulated += ticks * tick;
+  _stats.time += time;
+  _stats.longest = std::max(_stats.longest, time);
+  _stats.wall = std::chrono::duration<double>(Clock::now() - _start).count();
+  return ticks;
+}
+
+void Scheduler::nextSpeed() {
+  int next = 0;
+  for (int i = 0; i < speedCount; i++)
+    if (speeds[i] == _multiplier)
+      next = (i + 1) % speedCount;
+  _multiplier = speeds[next];
+}
@@ -0,0 +1,660 @@
+/**
+ * @file TrafficAssignment.cpp
+ * @brief The implementation of macroscopic traffic assignment.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Simulation/TrafficAssignment.h>
+#include <CityBuilder/Roads/LaneGraph.h>
+#include <CityBuilder/Jobs.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The time taken to reach a node that cannot be reached.
+  constexpr float unreachable = INFINITY;
+
+  /// Meters per second in a mile per hour.
+  constexpr float milesPerHour = 0.44704f;
+
+  /// How much each attempt to split the city into few enough districts grows
+  /// them by.
+  constexpr float districtGrowth = 1.25f;
+
+  /// The number of times the step towards each all-or-nothing assignment is
+  /// halved in the search for the best one.
+  constexpr int lineSteps = 20;
+
+  /// The most that each target may keep of the last one, so that the
+  /// fastest routes are always taken into account.
+  constexpr double maximumConjugacy = 0.99;
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  /// The time taken to travel a link with a flow, by the Bureau of Public
+  /// Roads function.
+  inline float bpr(float time, float flow, float capacity) {
+    float ratio = flow / capacity, power = 1;
+    for (int i = 0; i < TrafficAssignment::bprBeta; i++)
+      power *= ratio;
+    return time * (1 + TrafficAssignment::bprAlpha * power);
+  }
+
+  /// The trips that a zone produces and attracts for every meter of frontage,
+  /// relative to a residential zone.
+  /// \param[in] zone
+  ///   The zone, or `nullptr` for none.
+  /// \param[out] produced
+  ///   How many trips the zone produces.
+  /// \param[out] attracted
+  ///   How strongly the zone attracts trips.
+  void zoneTrips(const ZoneDef *zone, float &produced, float &attracted) {
+    produced = attracted = 0;
+    if (zone == nullptr)
+      return;
+    if (zone->name == "Residential")
+      produced = 1;
+    else if (zone->name == "Commercial")
+      attracted = 1;
+    else if (zone->name == "Industrial")
+      attracted = 0.6f;
+  }
+
+  /// How quickly the time taken to travel a link grows with its flow.
+  inline float bprSlope(float time, float flow, float capacity) {
+    float ratio = flow / capacity, power = 1;
+    for (int i = 1; i < TrafficAssignment::bprBeta; i++)
+      power *= ratio;
+    return time * TrafficAssignment::bprAlpha * TrafficAssignment::bprBeta * power / capacity;
+  }
+
+  /// Count the vehicle lanes of a road definition in each direction.
+  /// \param[in] definition
+  ///   The road definition.
+  /// \param[out] forward
+  ///   The lanes from the start of the road to its end.
+  /// \param[out] backward
+  ///   The lanes from the end of the road to its start.
+  /// \param[out] speed
+  ///   The highest speed limit of the lanes, in meters per second.
+  void vehicleLanes(const RoadDef *definition, int &forward, int &backward, float &speed) {
+    forward = backward = 0;
+    speed = 0;
+    for (const RoadDef::Lane &lane : definition->lanes)
+      for (const LaneDef::Traffic &traffic : lane.definition->traffic) {
+        if (traffic.category != LaneDef::Traffic::Category::all_vehicles)
+          continue;
+        bool unordered =
+          lane.direction == RoadDef::Lane::Direction::unordered ||
+          traffic.type   == LaneDef::Traffic::Type::unordered;
+        if (unordered || lane.direction == RoadDef::Lane::Direction::right)
+          forward++;
+        if (unordered || lane.direction == RoadDef::Lane::Direction::left)
+          backward++;
+        speed = std::max(speed,
+          (lane.speedLimit > 0 ? lane.speedLimit : LaneGraph::defaultSpeedLimit) * milesPerHour);
+      }
+  }
+}
+
+
+
+/// The scratch space of one thread's all-or-nothing assignments.
+struct TrafficAssignment::_search {
+  /// The time taken to reach every node.
+  std::vector<float> time;
+
+  /// The link that every node was reached by, or `none`.
+  std::vector<uint32_t> via;
+
+  /// Whether every node has been settled.
+  std::vector<uint8_t> done;
+
+  /// The trips carried back through every node towards the origin.
+  std::vector<float> load;
+
+  /// The nodes settled, in order.
+  std::vector<uint32_t> settled;
+
+  /// The nodes reached but not settled, in a radix heap: each is kept with
+  /// the bits of the time taken to reach it, which order the same as the time
+  /// when positive, in the bucket of the highest bit that differs from the
+  /// last time settled.
+  /// \remarks
+  ///   As nodes are settled in order of time, no node is reached sooner than
+  ///   the last settled, and a node only moves to a lower bucket once its
+  ///   bucket is emptied, making each far cheaper than with a binary heap.
+  std::vector<std::pair<uint32_t, uint32_t>> buckets[33];
+
+  /// The bits of the last time settled.
+  uint32_t last = 0;
+
+  /// The number of nodes in the buckets.
+  size_t queued = 0;
+
+  _search(size_t nodes)
+    : time(nodes, unreachable), via(nodes, none), done(nodes, 0), load(nodes, 0) { }
+
+  /// Queue a node to settle.
+  /// \param[in] time
+  ///   The time taken to reach the node, no less than the last time settled.
+  /// \param[in] node
+  ///   The node to queue.
+  void push(float time, uint32_t node) {
+    uint32_t bits;
+    memcpy(&bits, &time, sizeof(bits));
+    buckets[bucket(bits)].push_back({ bits, node });
+    queued++;
+  }
+
+  /// Take the node reached soonest off the queue.
+  /// \returns
+  ///   The node.
+  uint32_t pop() {
+    if (buckets[0].empty()) {
+      // Spread the first bucket with anything in it out from its soonest time
+      int i = 1;
+      while (buckets[i].empty())
+        i++;
+      std::vector<std::pair<uint32_t, uint32_t>> &from = buckets[i];
+      last = from[0].first;
+      for (const std::pair<uint32_t, uint32_t> &entry : from)
+        last = std::min(last, entry.first);
+      for (const std::pair<uint32_t, uint32_t> &entry : from)
+        buckets[bucket(entry.first)].push_back(entry);
+      from.clear();
+    }
+    uint32_t node = buckets[0].back().second;
+    buckets[0].pop_back();
+    queued--;
+    return node;
+  }
+
+  /// The bucket of the bits of a time.
+  int bucket(uint32_t bits) const {
+    return bits == last ? 0 : 32 - __builtin_clz(bits ^ last);
+  }
+};
+
+
+
+void TrafficAssignment::build(const List<Road *> &roads) {
+  Clock::time_point start = Clock::now();
+  _roads = roads;
+  _index.clear();
+  _index.reserve(roads.count());
+  for (size_t r = 0; r < roads.count(); r++)
+    _index[roads[r]] = (uint32_t)r;
+
+  // Join the ends of roads that meet, directly or at an intersection
+  std::vector<uint32_t> parent(roads.count() * 2);
+  for (size_t i = 0; i < parent.size(); i++)
+    parent[i] = (uint32_t)i;
+  std::unordered_map<Intersection *, uint32_t> intersections;
+  auto find = [&](uint32_t x) {
+    while (parent[x] != x)
+      x = parent[x] = parent[parent[x]];
+    return x;
+  };
+  auto join = [&](uint32_t a, uint32_t b) {
+    a = find(a);
+    b = find(b);
+    if (a != b)
+      parent[std::max(a, b)] = std::min(a, b);
+  };
+  for (size_t r = 0; r < roads.count(); r++) {
+    Road *road = roads[r];
+    for (int end = 0; end < 2; end++) {
+      const Connection &connection = end ? road->end : road->start;
+      uint32_t self = (uint32_t)(r * 2 + end);
+      if (connection.type == Connection::intersection) {
+        auto found = intersections.find(connection.other.intersection);
+        if (found == intersections.end()) {
+          intersections[connection.other.intersection] = (uint32_t)parent.size();
+          parent.push_back((uint32_t)parent.size());
+          found = intersections.find(connection.other.intersection);
+        }
+        join(self, found->second);
+      } else if (connection.type == Connection::road) {
+        auto found = _index.find(connection.other.road);
+        if (found == _index.end())
+          continue;
+        // Join whichever end of the other road is nearer
+        Road *other = connection.other.road;
+        Real2 point = end ? road->path.end() : road->path.start();
+        bool otherEnd =
+          other->path.end().squareDistance(point) < other->path.start().squareDistance(point);
+        join(self, found->second * 2 + (otherEnd ? 1 : 0));
+      }
+    }
+  }
+
+  // Number the nodes
+  std::vector<uint32_t> nodeOf(parent.size(), none);
+  uint32_t nodes = 0;
+  for (size_t i = 0; i < parent.size(); i++) {
+    uint32_t root = find((uint32_t)i);
+    if (nodeOf[root] == none)
+      nodeOf[root] = nodes++;
+    nodeOf[i] = nodeOf[root];
+  }
+
+  // Add a link for each direction of every road with vehicle lanes, ordered
+  // by their tails
+  struct Pending {
+    _link link;
+    uint32_t road;
+    bool forward;
+  };
+  std::vector<Pending> pending;
+  pending.reserve(roads.count() * 2);
+  for (size_t r = 0; r < roads.count(); r++) {
+    Road *road = roads[r];
+    int forward, backward;
+    float speed;
+    vehicleLanes(road->definition, forward, backward, speed);
+    if (speed <= 0)
+      continue;
+    float time = (float)road->path.length() / speed;
+    uint32_t first = nodeOf[r * 2], last = nodeOf[r * 2 + 1];
+    if (forward > 0)
+      pending.push_back({ { first, last, time, forward * laneCapacity }, (uint32_t)r, true });
+    if (backward > 0)
+      pending.push_back({ { last, first, time, backward * laneCapacity }, (uint32_t)r, false });
+  }
+
+  _first.removeAll();
+  _first.reserve(nodes + 1);
+  for (uint32_t n = 0; n <= nodes; n++)
+    _first.append(0);
+  for (const Pending &p : pending)
+    _first.begin()[p.link.tail + 1]++;
+  for (uint32_t n = 0; n < nodes; n++)
+    _first.begin()[n + 1] += _first.begin()[n];
+
+  _links.removeAll();
+  _links.reserve(pending.size());
+  for (size_t i = 0; i < pending.size(); i++)
+    _links.append({ });
+  _roadLinks.removeAll();
+  _roadLinks.reserve(roads.count() * 2);
+  for (size_t i = 0; i < roads.count() * 2; i++)
+    _roadLinks.append(none);
+  {
+    std::vector<uint32_t> next(_first.begin(), _first.begin() + nodes);
+    for (const Pending &p : pending) {
+      uint32_t id = next[p.link.tail]++;
+      _links.begin()[id] = p.link;
+      _roadLinks.begin()[p.road * 2 + (p.forward ? 0 : 1)] = id;
+    }
+  }
+
+  // Find what every road produces and attracts, and where its middle is
+  std::vector<float> produced(roads.count()), attracted(roads.count());
+  std::vector<Real2> middle(roads.count());
+  Real2 low = Real2(INFINITY), high = Real2(-INFINITY);
+  for (size_t r = 0; r < roads.count(); r++) {
+    Road *road = roads[r];
+    float length = road->path.length();
+    float leftProduced, leftAttracted, rightProduced, rightAttracted;
+    zoneTrips(road->leftZone(), leftProduced, leftAttracted);
+    zoneTrips(road->rightZone(), rightProduced, rightAttracted);
+    produced[r] = (leftProduced + rightProduced) * length * tripsPerMeter;
+    attracted[r] = (leftAttracted + rightAttracted) * length;
+    middle[r] = road->path.point(0.5);
+    if (produced[r] > 0 || attracted[r] > 0) {
+      low = low.min(middle[r]);
+      high = high.max(middle[r]);
+    }
+  }
+
+  // Split the zoned roads into districts, growing them until there are few
+  // enough
+  std::vector<uint32_t> districtOf(roads.count(), none);
+  uint32_t districts = 0;
+  float width = high.x - low.x, height = high.y - low.y;
+  float size = std::max(minimumDistrictSize,
+    std::sqrt(std::max(width * height, 0.0f) / maxDistricts));
+  for (;;) {
+    std::unordered_map<uint64_t, uint32_t> cells;
+    districts = 0;
+    for (size_t r = 0; r < roads.count(); r++) {
+      if (produced[r] <= 0 && attracted[r] <= 0)
+        continue;
+      float across = middle[r].x - low.x, down = middle[r].y - low.y;
+      uint64_t x = (uint64_t)(across / size), y = (uint64_t)(down / size);
+      auto found = cells.find(x << 32 | y);
+      if (found == cells.end())
+        found = cells.insert({ x << 32 | y, districts++ }).first;
+      districtOf[r] = found->second;
+    }
+    if (districts <= maxDistricts)
+      break;
+    size *= districtGrowth;
+  }
+
+  // Gather the nodes that the trips of every district start and end at
+  _productions.removeAll();
+  _attractions.removeAll();
+  for (uint32_t d = 0; d < districts; d++) {
+    _productions.append(0);
+    _attractions.append(0);
+  }
+  std::vector<std::vector<uint32_t>> origins(districts);
+  std::vector<std::vector<_end>> destinations(districts);
+  for (size_t r = 0; r < roads.count(); r++) {
+    uint32_t d = districtOf[r];
+    if (d == none)
+      continue;
+    uint32_t first = nodeOf[r * 2], last = nodeOf[r * 2 + 1];
+    if (produced[r] > 0) {
+      _productions.begin()[d] += produced[r];
+      origins[d].push_back(first);
+      origins[d].push_back(last);
+    }
+    if (attracted[r] > 0) {
+      _attractions.begin()[d] += attracted[r];
+      destinations[d].push_back({ first, attracted[r] * 0.5f });
+      destinations[d].push_back({ last , attracted[r] * 0.5f });
+    }
+  }
+  _origins.removeAll();
+  _firstOrigin.removeAll();
+  _destinations.removeAll();
+  _firstDestination.removeAll();
+  _trips = 0;
+  for (uint32_t d = 0; d < districts; d++) {
+    _firstOrigin.append((uint32_t)_origins.count());
+    std::sort(origins[d].begin(), origins[d].end());
+    origins[d].erase(std::unique(origins[d].begin(), origins[d].end()), origins[d].end());
+    for (uint32_t node : origins[d])
+      _origins.append(node);
+    // Merge the ends of roads that meet at the same node
+    std::vector<_end> &ends = destinations[d];
+    std::sort(ends.begin(), ends.end(), [](const _end &a, const _end &b) {
+      return a.node < b.node;
+    });
+    _firstDestination.append((uint32_t)_destinations.count());
+    for (size_t i = 0; i < ends.size(); i++)
+      if (i > 0 && ends[i].node == ends[i - 1].node)
+        _destinations.begin()[_destinations.count() - 1].weight += ends[i].weight / _attractions[d];
+      else
+        _destinations.append({ ends[i].node, ends[i].weight / _attractions[d] });
+    _trips += _productions[d];
+  }
+  _firstOrigin.append((uint32_t)_origins.count());
+  _firstDestination.append((uint32_t)_destinations.count());
+
+  // Start from empty roads
+  _demand.removeAll();
+  _demand.reserve((size_t)districts * districts);
+  for (size_t i = 0; i < (size_t)districts * districts; i++)
+    _demand.append(0);
+  _flows.removeAll();
+  _flows.reserve(_links.count());
+  for (size_t i = 0; i < _links.count(); i++)
+    _flows.append(0);
+  _costs(_flows, _linkCosts);
+  _target.removeAll();
+  _gap = 1;
+  _converged = false;
+  _iterations = 0;
+
+  _stats.builds++;
+  _stats.buildTime += since(start);
+}
+
+bool TrafficAssignment::iterate(int threads) {
+  if (_converged)
+    return true;
+  if (_links.isEmpty() || districts() == 0) {
+    _gap = 0;
+    return _converged = true;
+  }
+
+  // Assign every trip to its fastest route, splitting the origins evenly
+  // between the threads so that the sums do not depend on timing
+  Clock::time_point start = Clock::now();
+  uint32_t origins = (uint32_t)districts();
+  if (threads < 0)
+    threads = Jobs::threads() + 1;
+  threads = std::max(std::min(threads, (int)origins), 1);
+
+  List<float> target { };
+  target.reserve(_links.count());
+  for (size_t i = 0; i < _links.count(); i++)
+    target.append(0);
+  std::vector<std::vector<float>> partial(threads - 1, std::vector<float>(_links.count(), 0));
+  auto work = [&](int thread) {
+    _search search(nodes());
+    float *flows = thread == 0 ? target.begin() : partial[thread - 1].data();
+    uint32_t first = (uint32_t)((uint64_t)origins * thread / threads);
+    uint32_t last  = (uint32_t)((uint64_t)origins * (thread + 1) / threads);
+    for (uint32_t origin = first; origin < last; origin++)
+      _assignOrigin(origin, search, flows);
+  };
+  Jobs::Counter workers;
+  for (int i = 1; i < threads; i++)
+    Jobs::run("assignment", [&work, i] { work(i); }, &workers);
+  work(0);
+  Jobs::wait(workers);
+  float *y = target.begin();
+  for (const std::vector<float> &flows : partial)
+    for (size_t i = 0; i < flows.size(); i++)
+      y[i] += flows[i];
+  _stats.searchTime += since(start);
+
+  start = Clock::now();
+  float *x = _flows.begin();
+  const _link *links = _links.begin();
+  size_t count = _links.count();
+  if (_iterations == 0)
+    // Nothing to move from on empty roads
+    for (size_t i = 0; i < count; i++)
+      x[i] = y[i];
+  else {
+    // Compare the time taken by the trips with the time they would take on
+    // their fastest routes
+    const float *cost = _linkCosts.begin();
+    double current = 0, fastest = 0;
+    for (size_t i = 0; i < count; i++) {
+      current += (double)cost[i] * x[i];
+      fastest += (double)cost[i] * y[i];
+    }
+    _gap = current > 0 ? (float)((current - fastest) / current) : 0;
+    _converged = _gap < targetGap;
+
+    if (!_converged) {
+      // Head for a mix of the fastest routes and the last target, chosen to
+      // be conjugate to the last direction moved in, so as not to undo it
+      float *s = _target.begin();
+      if (_target.count() == count) {
+        double above = 0, below = 0;
+        for (size_t i = 0; i < count; i++) {
+          double curve = bprSlope(links[i].time, x[i], links[i].capacity);
+          above += (s[i] - x[i]) * curve * (y[i] - x[i]);
+          below += (s[i] - x[i]) * curve * (y[i] - s[i]);
+        }
+        double mix = below != 0 ? above / below : 0;
+        mix = std::min(std::max(mix, 0.0), (double)maximumConjugacy);
+        for (size_t i = 0; i < count; i++)
+          s[i] = (float)(mix * s[i] + (1 - mix) * y[i]);
+      } else
+        _target = target;
+      s = _target.begin();
+
+      // Find how far to move towards the target by bisection, where moving
+      // any further would no longer make the trips faster in total
+      auto slope = [&](float step) {
+        double sum = 0;
+        for (size_t i = 0; i < count; i++) {
+          float d = s[i] - x[i];
+          if (d != 0)
+            sum += (double)d * bpr(links[i].time, x[i] + step * d, links[i].capacity);
+        }
+        return sum;
+      };
+      float step = 1;
+      if (slope(1) > 0) {
+        float below = 0, above = 1;
+        for (int i = 0; i < lineSteps; i++) {
+          step = (below + above) * 0.5f;
+          (slope(step) > 0 ? above : below) = step;
+        }
+        step = (below + above) * 0.5f;
+      }
+      for (size_t i = 0; i < count; i++)
+        x[i] += step * (s[i] - x[i]);
+    }
+  }
+  _costs(_flows, _linkCosts);
+  _iterations++;
+  _stats.iterations++;
+  _stats.lineTime += since(start);
+  return _converged;
+}
+
+int TrafficAssignment::solve(int iterations, int threads) {
+  int run = 0;
+  while (run < iterations && !_converged) {
+    iterate(threads);
+    run++;
+  }
+  return run;
+}
+
+
+
+float TrafficAssignment::congestion(const Road *road, bool forward) const {
+  auto found = _index.find(road);
+  if (found == _index.end() || _flows.isEmpty())
+    return 0;
+  uint32_t link = _roadLinks[found->second * 2 + (forward ? 0 : 1)];
+  if (link == none)
+    return 0;
+  return _flows[link] / _links[link].capacity;
+}
+
+int TrafficAssignment::level(float congestion) {
+  static const float limits[congestionLevels - 1] = { 0.5f, 0.75f, 0.9f, 1 };
+  int level = 0;
+  while (level < congestionLevels - 1 && congestion >= limits[level])
+    level++;
+  return level;
+}
+
+
+
+void TrafficAssignment::_assignOrigin(uint32_t origin, _search &search, float *flows) {
+  const _link *links = _links.begin();
+  const uint32_t *first = _first.begin();
+  const float *cost = _linkCosts.begin();
+
+  // Search from every node of the district at once
+  search.last = 0;
+  for (uint32_t i = _firstOrigin[origin]; i < _firstOrigin[origin + 1]; i++) {
+    uint32_t node = _origins.begin()[i];
+    if (search.time[node] > 0) {
+      search.time[node] = 0;
+      search.push(0, node);
+    }
+  }
+  while (search.queued > 0) {
+    uint32_t node = search.pop();
+    if (search.done[node])
+      continue;
+    search.done[node] = 1;
+    search.settled.push_back(node);
+    float time = search.time[node];
+    for (uint32_t l = first[node]; l < first[node + 1]; l++) {
+      uint32_t head = links[l].head;
+      float reached = time + cost[l];
+      if (reached < search.time[head]) {
+        search.time[head] = reached;
+        search.via[head] = l;
+        search.push(reached, head);
+      }
+    }
+  }
+
+  // Share the district's trips between the others by the free-flow times to
+  // them, the first time round
+  uint32_t districts = (uint32_t)this->districts();
+  float *row = _demand.begin() + (size_t)origin * districts;
+  const _end *destinations = _destinations.begin();
+  if (_iterations == 0) {
+    double total = 0;
+    for (uint32_t d = 0; d < districts; d++) {
+      row[d] = 0;
+      if (d == origin)
+        continue;
+      float nearest = unreachable;
+      for (uint32_t i = _firstDestination[d]; i < _firstDestination[d + 1]; i++)
+        nearest = std::min(nearest, search.time[destinations[i].node]);
+      if (nearest != unreachable)
+        total += row[d] = _attractions[d] * std::exp(-impedance * nearest);
+    }
+    float scale = total > 0 ? (float)(_productions[origin] / total) : 0;
+    for (uint32_t d = 0; d < districts; d++)
+      row[d] *= scale;
+  }
+
+  // Leave the trips at the nodes they end at, and carry them back along the
+  // fastest routes, furthest nodes first
+  for (uint32_t d = 0; d < districts; d++) {
+    if (row[d] <= 0)
+      continue;
+    float reachable = 0;
+    for (uint32_t i = _firstDestination[d]; i < _firstDestination[d + 1]; i++)
+      if (search.done[destinations[i].node])
+        reachable += destinations[i].weight;
+    if (reachable <= 0)
+      continue;
+    for (uint32_t i = _firstDestination[d]; i < _firstDestination[d + 1]; i++)
+      if (search.done[destinations[i].node])
+        search.load[destinations[i].node] += row[d] * destinations[i].weight / reachable;
+  }
+  for (size_t i = search.settled.size(); i-- > 0;) {
+    uint32_t node = search.settled[i];
+    float load = search.load[node];
+    if (load > 0 && search.via[node] != none) {
+      uint32_t link = search.via[node];
+      flows[link] += load;
+      search.load[links[link].tail] += load;
+    }
+  }
+
+  // Forget the search
+  for (uint32_t node : search.settled) {
+    search.time[node] = unreachable;
+    search.via[node] = none;
+    search.done[node] = 0;
+    search.load[node] = 0;
+  }
+  search.settled.clear();
+}
+
+void TrafficAssignment::_costs(const List<float> &flows, List<float> &costs) const {
+  if (costs.count() != _links.count()) {
+    costs.removeAll();
+    costs.reserve(_links.count());
+    for (size_t i = 0; i < _links.count(); i++)
+      costs.append(0);
+  }
+  const _link *links = _links.begin();
+  const float *flow = flows.begin();
+  float *cost = costs.begin();
+  for (size_t i = 0; i < _links.count(); i++)
+    cost[i] = bpr(links[i].time, flow[i], links[i].capacity);
+}
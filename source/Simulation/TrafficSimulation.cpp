@@ -0,0 +1,605 @@
+/**
+ * @file TrafficSimulation.cpp
+ * @brief The implementation of the microscopic traffic simulation.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Simulation/TrafficSimulation.h>
+#include <CityBuilder/Jobs.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The number of lanes or intersections in each range of work.
+  constexpr size_t grain = 64;
+
+  /// The length of lane taken by each vehicle when traffic is jammed, in
+  /// meters.
+  constexpr float jamSpacing = TrafficSimulation::vehicleLength + TrafficSimulation::minimumGap;
+
+  /// How far ahead a vehicle looks for the back of a queue past an
+  /// intersection before entering it, in seconds.
+  constexpr float clearingTime = 3.0f;
+
+  /// The closest that two vehicles are treated as being, in meters, to keep
+  /// the driver model finite.
+  constexpr float closest = 0.01f;
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  /// Find the acceleration of a vehicle by the intelligent driver model.
+  /// \param[in] speed
+  ///   The speed of the vehicle.
+  /// \param[in] limit
+  ///   The speed that the vehicle would like to travel at.
+  /// \param[in] gap
+  ///   The distance to the back of the vehicle ahead, or infinity.
+  /// \param[in] approach
+  ///   How much faster the vehicle is travelling than the vehicle ahead.
+  inline float drive(float speed, float limit, float gap, float approach) {
+    const float brake = 0.5f /
+      sqrtf(TrafficSimulation::acceleration * TrafficSimulation::deceleration);
+    float free = speed / limit;
+    free *= free;
+    free *= free;
+    float desired = TrafficSimulation::minimumGap +
+      std::max(0.0f, speed * TrafficSimulation::headway + speed * approach * brake);
+    float interaction = desired / std::max(gap, closest);
+    return std::max(
+      TrafficSimulation::acceleration * (1 - free - interaction * interaction),
+      -TrafficSimulation::emergencyDeceleration);
+  }
+
+  /// Step a random number generator.
+  inline uint32_t next(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+}
+
+
+
+void TrafficSimulation::setThreads(int threads) {
+  _requestedThreads = threads;
+}
+
+int TrafficSimulation::threads() const {
+  return _requestedThreads == 0 ? 0 : Jobs::threads();
+}
+
+
+
+void TrafficSimulation::sync(const LaneGraph &graph) {
+  if (_graph == &graph && _version == graph.version())
+    return;
+  _graph = &graph;
+  _version = graph.version();
+
+  const LaneGraph::Segment *segments = graph.segments().begin();
+  size_t segmentCount = graph.segments().count();
+
+  // Lay out the slots of every lane that carries vehicles
+  List<_lane> lanes { };
+  lanes.reserve(segmentCount);
+  uint32_t slots = 0;
+  for (size_t id = 0; id < segmentCount; id++) {
+    const LaneGraph::Segment &segment = segments[id];
+    _lane lane { nullptr, 0, false, false, slots, 0, 0, 0, 0, none, none };
+    if (segment.road != nullptr &&
+        segment.category == LaneDef::Traffic::Category::all_vehicles) {
+      lane.road = segment.road;
+      lane.index = segment.lane;
+      lane.forward = segment.forward;
+      lane.capacity = (uint32_t)(segment.length / jamSpacing) + 2;
+      lane.length = segment.length;
+      lane.speed = segment.speed;
+      slots += lane.capacity;
+    }
+    lanes.append(lane);
+  }
+
+  List<float> position { }, speed { }, acceleration { };
+  List<uint32_t> vehicle { };
+  position.reserve(slots);
+  speed.reserve(slots);
+  acceleration.reserve(slots);
+  vehicle.reserve(slots);
+  for (uint32_t i = 0; i < slots; i++) {
+    position.append(0);
+    speed.append(0);
+    acceleration.append(0);
+    vehicle.append(none);
+  }
+
+  // Carry the vehicles over to the lanes whose segment is unchanged
+  for (size_t id = 0; id < _lanes.count(); id++) {
+    const _lane &old = _lanes.begin()[id];
+    if (old.count == 0)
+      continue;
+
+    uint32_t kept = 0;
+    if (id < segmentCount) {
+      _lane &lane = lanes.begin()[id];
+      if (lane.road == old.road && lane.index == old.index && lane.forward == old.forward)
+        kept = std::min(old.count, lane.capacity);
+      for (uint32_t i = 0; i < kept; i++) {
+        position.begin()[lane.offset + i] = _position.begin()[old.offset + i];
+        speed.begin()[lane.offset + i] = _speed.begin()[old.offset + i];
+        vehicle.begin()[lane.offset + i] = _slots.begin()[old.offset + i];
+      }
+      lane.count = kept;
+    }
+
+    for (uint32_t i = kept; i < old.count; i++)
+      _release(_slots.begin()[old.offset + i]);
+  }
+
+  _lanes = std::move(lanes);
+  _position = std::move(position);
+  _speed = std::move(speed);
+  _acceleration = std::move(acceleration);
+  _slots = std::move(vehicle);
+
+  _active.removeAll();
+  for (uint32_t id = 0; id < segmentCount; id++)
+    if (_lanes.begin()[id].road != nullptr)
+      _active.append(id);
+
+  // Give way at every intersection where more than two arms meet
+  std::unordered_map<Intersection *, uint32_t> signals;
+  List<uint32_t> approaches { };
+  _signals.removeAll();
+  for (uint32_t id : _active) {
+    _lane &lane = _lanes.begin()[id];
+    const Connection &exit = lane.forward ? lane.road->end : lane.road->start;
+    if (exit.type != Connection::intersection)
+      continue;
+    Intersection *intersection = exit.other.intersection;
+    if (intersection->arms.count() <= 2)
+      continue;
+
+    // The arms are sorted by angle, so opposite arms are half way round
+    uint32_t arms = (uint32_t)intersection->arms.count();
+    uint32_t phases = arms % 2 == 0 ? arms / 2 : arms;
+    auto found = signals.find(intersection);
+    if (found == signals.end()) {
+      found = signals.emplace(intersection, (uint32_t)_signals.count()).first;
+      _signals.append({ 0, 0, phases, 0, false, 0 });
+    }
+    lane.signal = found->second;
+    for (uint32_t arm = 0; arm < arms; arm++) {
+      const Intersection::Arm &candidate = intersection->arms[arm];
+      if (candidate.road == lane.road && candidate.start != lane.forward)
+        lane.phase = arm % phases;
+    }
+    _signals.begin()[lane.signal].count++;
+    approaches.append(id);
+  }
+
+  uint32_t first = 0;
+  for (_signal &signal : _signals) {
+    signal.first = first;
+    first += signal.count;
+    signal.count = 0;
+  }
+  _approaches.removeAll();
+  _approaches.reserve(approaches.count());
+  for (size_t i = 0; i < approaches.count(); i++)
+    _approaches.append(none);
+  for (uint32_t id : approaches) {
+    _signal &signal = _signals.begin()[_lanes.begin()[id].signal];
+    _approaches.begin()[signal.first + signal.count++] = id;
+  }
+
+  // Choose again wherever a vehicle's next segment has changed
+  const uint32_t *offsets = graph.offsets().begin();
+  const LaneGraph::Edge *edges = graph.edges().begin();
+  for (uint32_t id : _active) {
+    const _lane &lane = _lanes.begin()[id];
+    for (uint32_t i = 0; i < lane.count; i++) {
+      uint32_t index = _slots.begin()[lane.offset + i];
+      _vehicle &vehicle = _vehicles.begin()[index];
+      vehicle.lane = id;
+
+      bool connected = false;
+      for (uint32_t e = offsets[id]; e < offsets[id + 1]; e++)
+        if (edges[e].target == vehicle.next) {
+          vehicle.nextGap = edges[e].length;
+          connected = true;
+        }
+      if (!connected && vehicle.next != none) {
+        if (!vehicle.route.isEmpty() && vehicle.step > 0)
+          vehicle.step--;
+        _choose(index);
+      }
+    }
+  }
+}
+
+uint32_t TrafficSimulation::spawn(uint32_t segment, float position, const List<uint32_t> &route) {
+  if (segment >= _lanes.count())
+    return none;
+  const _lane &lane = _lanes.begin()[segment];
+  if (lane.road == nullptr || lane.count >= lane.capacity)
+    return none;
+
+  uint32_t index;
+  if (!_free.isEmpty())
+    index = _free.remove(_free.count() - 1);
+  else {
+    index = (uint32_t)_vehicles.count();
+    _vehicles.append({ });
+  }
+
+  _vehicle &vehicle = _vehicles.begin()[index];
+  vehicle.lane = segment;
+  vehicle.next = none;
+  vehicle.nextGap = 0;
+  vehicle.step = 0;
+  vehicle.random = index * 2654435761u | 1;
+  vehicle.route = route;
+  _count++;
+
+  _insert(segment, index, std::min(position, lane.length), 0);
+  _choose(index);
+  return index;
+}
+
+size_t TrafficSimulation::populate(size_t vehicles) {
+  if (_active.isEmpty())
+    return 0;
+
+  // Fill the lanes a row at a time, evenly spaced along each
+  size_t added = 0;
+  size_t perLane = (vehicles + _active.count() - 1) / _active.count();
+  for (size_t row = 0; row < perLane && added < vehicles; row++)
+    for (uint32_t id : _active) {
+      if (added >= vehicles)
+        break;
+      const _lane &lane = _lanes.begin()[id];
+      if (spawn(id, lane.length * (row + 0.5f) / perLane) != none)
+        added++;
+    }
+  return added;
+}
+
+void TrafficSimulation::despawn(uint32_t index) {
+  if (index >= _vehicles.count() || _vehicles.begin()[index].lane == none)
+    return;
+  uint32_t id = _vehicles.begin()[index].lane;
+  const _lane &lane = _lanes.begin()[id];
+  for (uint32_t i = 0; i < lane.count; i++)
+    if (_slots.begin()[lane.offset + i] == index) {
+      _erase(id, i);
+      break;
+    }
+  _release(index);
+}
+
+
+
+void TrafficSimulation::step() {
+  Clock::time_point start = Clock::now();
+  _parallel(_signals.count(), _give);
+
+  Clock::time_point signalled = Clock::now();
+  _parallel(_active.count(), _accelerate);
+  _parallel(_active.count(), _move);
+
+  Clock::time_point moved = Clock::now();
+  _transfer();
+
+  _stats.signalTime += std::chrono::duration<double, std::micro>(signalled - start).count();
+  _stats.laneTime += std::chrono::duration<double, std::micro>(moved - signalled).count();
+  _stats.transferTime += since(moved);
+  _stats.updates += _count;
+  _stats.steps++;
+  _time += timestep;
+}
+
+int TrafficSimulation::advance(float elapsed) {
+  _carry += elapsed;
+  int steps = 0;
+  while (_carry >= timestep && steps < maxSteps) {
+    step();
+    _carry -= timestep;
+    steps++;
+  }
+  if (_carry >= timestep)
+    _carry = std::fmod(_carry, timestep);
+  return steps;
+}
+
+void TrafficSimulation::snapshot(Snapshot *snapshots) const {
+  const _lane *lanes = _lanes.begin();
+  const float *positions = _position.begin();
+  const float *speeds = _speed.begin();
+  const float *accelerations = _acceleration.begin();
+  for (uint32_t id : _active) {
+    const _lane &lane = lanes[id];
+    for (uint32_t i = lane.offset; i < lane.offset + lane.count; i++)
+      *snapshots++ = { (float)id, positions[i], speeds[i], accelerations[i] };
+  }
+}
+
+void TrafficSimulation::_parallel(size_t count, void (*body)(TrafficSimulation &, size_t, size_t)) {
+  if (count == 0)
+    return;
+
+  // Not worth waking the workers for a single range
+  if (_requestedThreads == 0 || count <= grain)
+    body(*this, 0, count);
+  else
+    Jobs::parallelFor("traffic", count, grain, [this, body](size_t begin, size_t end) {
+      body(*this, begin, end);
+    });
+}
+
+void TrafficSimulation::_give(TrafficSimulation &self, size_t begin, size_t end) {
+  const _lane *lanes = self._lanes.begin();
+  const uint32_t *approaches = self._approaches.begin();
+
+  for (size_t s = begin; s < end; s++) {
+    _signal &signal = self._signals.begin()[s];
+
+    // Find the phases with vehicles waiting
+    uint64_t demand = 0;
+    for (uint32_t i = signal.first; i < signal.first + signal.count; i++) {
+      const _lane &lane = lanes[approaches[i]];
+      if (lane.waiting)
+        demand |= 1ull << (lane.phase % 64);
+    }
+
+    signal.timer += timestep;
+    if (signal.clearing) {
+      if (signal.timer >= clearance) {
+        signal.clearing = false;
+        signal.timer = 0;
+      }
+      continue;
+    }
+
+    // Move on to the next phase that is waiting once this one has had its
+    // turn
+    bool waiting = demand & 1ull << (signal.green % 64);
+    if (signal.timer < maximumGreen && (signal.timer < minimumGreen || waiting))
+      continue;
+    for (uint32_t i = 1; i < signal.phases; i++) {
+      uint32_t phase = (signal.green + i) % signal.phases;
+      if (demand & 1ull << (phase % 64)) {
+        signal.green = phase;
+        signal.clearing = true;
+        signal.timer = 0;
+        break;
+      }
+    }
+  }
+}
+
+void TrafficSimulation::_accelerate(TrafficSimulation &self, size_t begin, size_t end) {
+  _lane *lanes = self._lanes.begin();
+  const _signal *signals = self._signals.begin();
+  const _vehicle *vehicles = self._vehicles.begin();
+  const uint32_t *active = self._active.begin();
+  const float *positions = self._position.begin();
+  const float *speeds = self._speed.begin();
+  float *accelerations = self._acceleration.begin();
+
+  for (size_t l = begin; l < end; l++) {
+    _lane &lane = lanes[active[l]];
+    uint32_t count = lane.count;
+    if (count == 0) {
+      lane.waiting = false;
+      continue;
+    }
+    const float *x = positions + lane.offset;
+    const float *v = speeds + lane.offset;
+    float *a = accelerations + lane.offset;
+    float limit = lane.speed;
+
+    // Every vehicle but the front one follows the one ahead of it
+    for (uint32_t i = 0; i + 1 < count; i++)
+      a[i] = drive(v[i], limit, x[i + 1] - vehicleLength - x[i], v[i] - v[i + 1]);
+
+    // The front vehicle stops at the line without right of way or without
+    // room to leave the intersection, unless it is too close to stop in time,
+    // and otherwise follows the back of the next lane
+    uint32_t front = count - 1;
+    float remaining = lane.length - x[front];
+    float gap = INFINITY, approach = 0;
+    const _vehicle &vehicle = vehicles[self._slots.begin()[lane.offset + front]];
+    bool held = false;
+    if (lane.signal != none) {
+      const _signal &signal = signals[lane.signal];
+      held = signal.clearing || signal.green != lane.phase;
+      if (!held && vehicle.next != none) {
+        const _lane &next = lanes[vehicle.next];
+        held = next.count + 1 >= next.capacity || (next.count > 0 &&
+          positions[next.offset] + speeds[next.offset] * clearingTime < jamSpacing);
+      }
+    }
+    if (held && remaining > v[front] * v[front] * (0.5f / deceleration)) {
+      gap = remaining + minimumGap;
+      approach = v[front];
+    } else if (vehicle.next != none) {
+      // Vehicles crossing the intersection on a longer movement merge in
+      // behind
+      const _lane &next = lanes[vehicle.next];
+      const float *ahead = positions + next.offset;
+      uint32_t i = 0;
+      while (i < next.count && ahead[i] < -vehicle.nextGap)
+        i++;
+      if (i < next.count) {
+        gap = remaining + vehicle.nextGap + ahead[i] - vehicleLength;
+        approach = v[front] - speeds[next.offset + i];
+      }
+    }
+    a[front] = drive(v[front], limit, gap, approach);
+    lane.waiting = lane.signal != none && remaining < waitingDistance;
+  }
+}
+
+void TrafficSimulation::_move(TrafficSimulation &self, size_t begin, size_t end) {
+  const _lane *lanes = self._lanes.begin();
+  const uint32_t *active = self._active.begin();
+  float *positions = self._position.begin();
+  float *speeds = self._speed.begin();
+  const float *accelerations = self._acceleration.begin();
+
+  for (size_t l = begin; l < end; l++) {
+    const _lane &lane = lanes[active[l]];
+    uint32_t count = lane.count;
+    float *x = positions + lane.offset;
+    float *v = speeds + lane.offset;
+    const float *a = accelerations + lane.offset;
+
+    for (uint32_t i = 0; i < count; i++) {
+      float speed = std::max(v[i] + a[i] * timestep, 0.0f);
+      x[i] += (v[i] + speed) * (0.5f * timestep);
+      v[i] = speed;
+    }
+
+    // Never let a vehicle pass through the one ahead of it
+    for (uint32_t i = count; i-- > 1; )
+      if (x[i - 1] > x[i]) {
+        x[i - 1] = x[i];
+        v[i - 1] = std::min(v[i - 1], v[i]);
+      }
+  }
+}
+
+void TrafficSimulation::_transfer() {
+  for (uint32_t id : _active) {
+    _lane &lane = _lanes.begin()[id];
+    while (lane.count > 0) {
+      uint32_t slot = lane.offset + lane.count - 1;
+      float position = _position.begin()[slot];
+      if (position < lane.length)
+        break;
+
+      uint32_t index = _slots.begin()[slot];
+      _vehicle &vehicle = _vehicles.begin()[index];
+      if (vehicle.next == none) {
+        // The route ends here
+        lane.count--;
+        _release(index);
+        _stats.arrivals++;
+        continue;
+      }
+
+      _lane &next = _lanes.begin()[vehicle.next];
+      if (next.count >= next.capacity) {
+        // Wait at the end of the lane for the next to clear
+        _position.begin()[slot] = lane.length;
+        _speed.begin()[slot] = 0;
+        break;
+      }
+
+      float speed = _speed.begin()[slot];
+      lane.count--;
+      _insert(vehicle.next, index, position - lane.length - vehicle.nextGap, speed);
+      vehicle.lane = vehicle.next;
+      _choose(index);
+      _stats.transfers++;
+    }
+  }
+}
+
+void TrafficSimulation::_choose(uint32_t index) {
+  _vehicle &vehicle = _vehicles.begin()[index];
+  const uint32_t *offsets = _graph->offsets().begin();
+  const LaneGraph::Edge *edges = _graph->edges().begin();
+  uint32_t first = offsets[vehicle.lane], last = offsets[vehicle.lane + 1];
+  vehicle.next = none;
+  vehicle.nextGap = 0;
+
+  if (!vehicle.route.isEmpty()) {
+    // Follow the route for as long as it stays connected
+    if (vehicle.step >= vehicle.route.count())
+      return;
+    uint32_t target = vehicle.route.begin()[vehicle.step];
+    for (uint32_t e = first; e < last; e++)
+      if (edges[e].target == target) {
+        vehicle.next = target;
+        vehicle.nextGap = edges[e].length;
+        vehicle.step++;
+        return;
+      }
+    vehicle.step = (uint32_t)vehicle.route.count();
+    return;
+  }
+
+  // Wander onto any lane that carries vehicles
+  uint32_t options = 0;
+  for (uint32_t e = first; e < last; e++)
+    if (_lanes.begin()[edges[e].target].road != nullptr)
+      options++;
+  if (options == 0)
+    return;
+  uint32_t choice = next(vehicle.random) % options;
+  for (uint32_t e = first; e < last; e++)
+    if (_lanes.begin()[edges[e].target].road != nullptr && choice-- == 0) {
+      vehicle.next = edges[e].target;
+      vehicle.nextGap = edges[e].length;
+      return;
+    }
+}
+
+void TrafficSimulation::_insert(uint32_t id, uint32_t index, float position, float speed) {
+  _lane &lane = _lanes.begin()[id];
+  float *x = _position.begin() + lane.offset;
+  float *v = _speed.begin() + lane.offset;
+  float *a = _acceleration.begin() + lane.offset;
+  uint32_t *vehicles = _slots.begin() + lane.offset;
+
+  // Vehicles almost always join at the back
+  uint32_t slot = 0;
+  while (slot < lane.count && x[slot] < position)
+    slot++;
+  for (uint32_t i = lane.count; i > slot; i--) {
+    x[i] = x[i - 1];
+    v[i] = v[i - 1];
+    a[i] = a[i - 1];
+    vehicles[i] = vehicles[i - 1];
+  }
+  x[slot] = position;
+  v[slot] = speed;
+  a[slot] = 0;
+  vehicles[slot] = index;
+  lane.count++;
+}
+
+void TrafficSimulation::_erase(uint32_t id, uint32_t slot) {
+  _lane &lane = _lanes.begin()[id];
+  float *x = _position.begin() + lane.offset;
+  float *v = _speed.begin() + lane.offset;
+  float *a = _acceleration.begin() + lane.offset;
+  uint32_t *vehicles = _slots.begin() + lane.offset;
+  for (uint32_t i = slot; i + 1 < lane.count; i++) {
+    x[i] = x[i + 1];
+    v[i] = v[i + 1];
+    a[i] = a[i + 1];
+    vehicles[i] = vehicles[i + 1];
+  }
+  lane.count--;
+}
+
+void TrafficSimulation::_release(uint32_t index) {
+  _vehicle &vehicle = _vehicles.begin()[index];
+  vehicle.lane = none;
+  vehicle.next = none;
+  vehicle.route.removeAll();
+  _free.append(index);
+  _count--;
+}
@@ -0,0 +1,265 @@
+/**
+ * @file Archive.cpp
+ * @brief The asset archive reader.
+ * @date May 6, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Tools/Archive.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ARCHIVE_MMAP 1
+#endif
+USING_NS_CITY_BUILDER
+
+static_assert(sizeof(Archive::Header) == 16, "Archive header layout");
+static_assert(sizeof(Archive::Entry ) == 40, "Archive entry layout");
+
+namespace {
+  /// The open archive, if any.
+  const char *archive = nullptr;
+
+  /// The length of the open archive.
+  size_t archiveLength = 0;
+
+  /// Whether the open archive is memory mapped (otherwise it is `malloc`ed).
+  bool mapped = false;
+
+  /// Read a little-endian 32-bit value from a file.
+  uint32_t read32(const char *file, size_t offset) {
+    uint32_t value;
+    memcpy(&value, file + offset, sizeof(uint32_t));
+    return value;
+  }
+
+  /// Whether every entry of an archive table lies within the archive.
+  /// \param[in] contents
+  ///   The contents of the archive, whose header and table have been checked
+  ///   to fit.
+  /// \param[in] length
+  ///   The length of the archive.
+  bool entriesFit(const char *contents, size_t length) {
+    const Archive::Header *header = (const Archive::Header *)contents;
+    const Archive::Entry *table = (const Archive::Entry *)(contents + sizeof(Archive::Header));
+    for (uint32_t bucket = 0; bucket < header->buckets; bucket++) {
+      const Archive::Entry &entry = table[bucket];
+      if (entry.hash == 0)
+        continue;
+
+      // The name must end before the archive does
+      if (entry.name >= length ||
+          memchr(contents + entry.name, 0, length - entry.name) == nullptr)
+        return false;
+
+      // And so must the payload, with its null-terminator
+      if (entry.offset >= length || entry.length >= length - entry.offset)
+        return false;
+    }
+    return true;
+  }
+
+  /// Make a DDS four character code.
+  constexpr uint32_t fourCC(char a, char b, char c, char d) {
+    return (uint32_t)(uint8_t)a | (uint32_t)(uint8_t)b << 8 |
+           (uint32_t)(uint8_t)c << 16 | (uint32_t)(uint8_t)d << 24;
+  }
+}
+
+
+
+bool Archive::open(const char *path) {
+  close();
+
+  const char *contents = nullptr;
+  size_t length = 0;
+
+#if ARCHIVE_MMAP
+  int file = ::open(path, O_RDONLY);
+  if (file < 0)
+    return false;
+  struct stat status;
+  if (fstat(file, &status) == 0 && status.st_size > 0) {
+    void *memory = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (memory != MAP_FAILED) {
+      contents = (const char *)memory;
+      length = status.st_size;
+      mapped = true;
+    }
+  }
+  ::close(file);
+#else
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return false;
+  fseek(file, 0, SEEK_END);
+  length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char *memory = (char *)malloc(length);
+  if (fread(memory, 1, length, file) == length)
+    contents = memory;
+  else
+    free(memory);
+  fclose(file);
+  mapped = false;
+#endif
+
+  if (contents == nullptr)
+    return false;
+
+  // Validate the header and table, and that every entry lies within the
+  // archive so that lookups never need to check
+  const Header *header = (const Header *)contents;
+  if (length < sizeof(Header) ||
+      memcmp(header->magic, "CBPK", 4) != 0 ||
+      header->version != Archive::version ||
+      header->buckets == 0 ||
+      (header->buckets & (header->buckets - 1)) != 0 ||
+      length < sizeof(Header) + sizeof(Entry) * (size_t)header->buckets ||
+      !entriesFit(contents, length)) {
+    std::cout << "Invalid asset archive '" << path << "'." << std::endl;
+    archive = contents;
+    archiveLength = length;
+    close();
+    return false;
+  }
+
+  archive = contents;
+  archiveLength = length;
+  return true;
+}
+
+void Archive::close() {
+  if (archive == nullptr)
+    return;
+
+#if ARCHIVE_MMAP
+  if (mapped)
+    munmap((void *)archive, archiveLength);
+  else
+#endif
+    free((void *)archive);
+
+  archive = nullptr;
+  archiveLength = 0;
+  mapped = false;
+}
+
+bool Archive::isOpen() {
+  return archive != nullptr;
+}
+
+const Archive::Entry *Archive::find(const char *name, const char *extension) {
+  if (archive == nullptr)
+    return nullptr;
+
+  const Header *header = (const Header *)archive;
+  const Entry *table = (const Entry *)(archive + sizeof(Header));
+
+  // Every entry is in its home bucket, so there is only one place to look
+  uint64_t key = hash(name, extension);
+  const Entry *entry = table + (key & (header->buckets - 1));
+  if (entry->hash != key)
+    return nullptr;
+
+  // Confirm the name in case of a hash collision
+  const char *stored = archive + entry->name;
+  size_t nameLength = strlen(name);
+  if (strncmp(stored, name, nameLength) != 0 || stored[nameLength] != '.' ||
+      strcmp(stored + nameLength + 1, extension) != 0)
+    return nullptr;
+
+  return entry;
+}
+
+const char *Archive::data(const Entry *entry) {
+  return archive + entry->offset;
+}
+
+uint64_t Archive::hash(const char *name, const char *extension) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  auto add = [&](const char *string) {
+    for (; *string; string++) {
+      hash ^= (uint8_t)*string;
+      hash *= 0x100000001b3ull;
+    }
+  };
+  add(name);
+  add(".");
+  add(extension);
+  return hash == 0 ? 1 : hash;
+}
+
+bool Archive::parseTexture(
+  const char *file, size_t length, Entry &entry, size_t &header
+) {
+  if (length < 128 || memcmp(file, "DDS ", 4) != 0 || read32(file, 4) != 124)
+    return false;
+
+  const uint32_t flags       = read32(file,   8);
+  const uint32_t height      = read32(file,  12);
+  const uint32_t width       = read32(file,  16);
+  const uint32_t mipCount    = read32(file,  28);
+  const uint32_t pixelFlags  = read32(file,  80);
+  const uint32_t code        = read32(file,  84);
+  const uint32_t bitCount    = read32(file,  88);
+  const uint32_t redMask     = read32(file,  92);
+
+  const uint32_t hasMipCount = 0x20000; // DDSD_MIPMAPCOUNT
+  const uint32_t hasCode     = 0x4;     // DDPF_FOURCC
+  const uint32_t isRGB       = 0x40;    // DDPF_RGB
+
+  bgfx::TextureFormat::Enum format = bgfx::TextureFormat::Unknown;
+  uint32_t layers = 1;
+  header = 128;
+
+  if (pixelFlags & hasCode) {
+    switch (code) {
+    case fourCC('D', 'X', 'T', '1'): format = bgfx::TextureFormat::BC1; break;
+    case fourCC('D', 'X', 'T', '3'): format = bgfx::TextureFormat::BC2; break;
+    case fourCC('D', 'X', 'T', '5'): format = bgfx::TextureFormat::BC3; break;
+    case fourCC('A', 'T', 'I', '2'): format = bgfx::TextureFormat::BC5; break;
+
+    case fourCC('D', 'X', '1', '0'): {
+      // Extended header
+      if (length < 148)
+        return false;
+      header = 148;
+      layers = read32(file, 140) > 0 ? read32(file, 140) : 1;
+
+      switch (read32(file, 128)) { // DXGI format
+      case  28: case  29: format = bgfx::TextureFormat::RGBA8; break;
+      case  87: case  91: format = bgfx::TextureFormat::BGRA8; break;
+      case  71: case  72: format = bgfx::TextureFormat::BC1; break;
+      case  74: case  75: format = bgfx::TextureFormat::BC2; break;
+      case  77: case  78: format = bgfx::TextureFormat::BC3; break;
+      case  83:           format = bgfx::TextureFormat::BC5; break;
+      case  98: case  99: format = bgfx::TextureFormat::BC7; break;
+      case 134: case 135: format = bgfx::TextureFormat::ASTC4x4; break;
+      case 150: case 151: format = bgfx::TextureFormat::ASTC6x6; break;
+      case 162: case 163: format = bgfx::TextureFormat::ASTC8x8; break;
+      }
+    } break;
+    }
+  } else if ((pixelFlags & isRGB) && bitCount == 32) {
+    format = redMask == 0x000000ff ?
+      bgfx::TextureFormat::RGBA8 : bgfx::TextureFormat::BGRA8;
+  }
+
+  if (format == bgfx::TextureFormat::Unknown || width == 0 || height == 0)
+    return false;
+
+  entry.type   = Type::texture;
+  entry.format = (uint16_t)format;
+  entry.width  = (uint16_t)width;
+  entry.height = (uint16_t)height;
+  entry.layers = (uint16_t)layers;
+  entry.mips   = (uint8_t)((flags & hasMipCount) && mipCount > 0 ? mipCount : 1);
+  return true;
+}
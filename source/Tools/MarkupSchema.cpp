@@ -0,0 +1,481 @@
+/**
+ * @file MarkupSchema.cpp
+ * @brief The tokenizer and error reporting for markup schemas.
+ * @date May 8, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Tools/MarkupSchema.h>
+#include <CityBuilder/../../driver/Driver.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+typedef Internal::Schema::Token Token;
+
+namespace {
+  /// A receiver for the tokens of a markup file.
+  struct Sink {
+    virtual ~Sink() { }
+
+    /// Called for each token, in order.
+    virtual void token(const Token &token) = 0;
+  };
+
+  /// Tokenize a markup file.
+  /// \param[in] path
+  ///   The path to the markup file, for errors.
+  /// \param[in] contents
+  ///   The contents of the file.
+  /// \param[in] length
+  ///   The length of the contents of the file.
+  /// \param[in] sink
+  ///   The receiver for the tokens.
+  /// \returns
+  ///   Whether or not the file was tokenized successfully.
+  /// \remarks
+  ///   Tokens point into the file rather than being copied.
+  bool tokenize(const char *path, const char *contents, size_t length, Sink &sink) {
+    // Determine what token we're currently in
+    enum class In {
+      none,
+      string,
+      number,
+      section,
+      comment,
+    };
+    In in = In::none;
+
+    // Status
+    bool success = true;
+    bool empty = true;
+    Token::Type last = Token::Type::lineBreak;
+
+    // Where we are in the file
+    int line = 1, column = 1, startColumn = 1;
+
+    // The start of the current token, if any
+    const char *buffer = nullptr;
+    auto emit = [&](const Token &token) {
+      sink.token(token);
+      empty = false;
+      last = token.type;
+    };
+    auto flush = [&](const char *at) {
+      if (buffer != nullptr && at > buffer)
+        emit({ buffer, (uint32_t)(at - buffer), Token::Type::identifier, line, startColumn });
+      buffer = nullptr;
+      startColumn = column;
+    };
+    auto append = [&](const char *at, Token::Type type) {
+      emit({ buffer, (uint32_t)(at - buffer), type, line, startColumn });
+      buffer = nullptr;
+    };
+    auto lineBreak = [&](const char *at) {
+      if (!empty && last != Token::Type::lineBreak)
+        emit({ at, 1, Token::Type::lineBreak, line, column });
+    };
+
+    // Standard error output
+    auto error = [&](const char *message, int line, int column) {
+      std::cout <<
+        "Error in '" << path << "' at line " << line <<
+        " col " << column << ": " << message << std::endl;
+      success = false;
+    };
+
+    // Iterate through the file
+    const char *end = contents + length;
+    for (const char *at = contents; at < end; at++) {
+      char c = *at;
+      if ((c & 0xC0) == 0x80)
+        // Continuation of a multi-byte character, which counts as one column
+        continue;
+
+      switch (in) {
+      case In::none:
+      none:
+        if (c == '[') {
+          // Start of a section
+          flush(at);
+          in = In::section;
+          buffer = at + 1;
+          column++, startColumn++;
+        } else if (c == '"') {
+          // Start of a string
+          flush(at);
+          in = In::string;
+          buffer = at + 1;
+          column++, startColumn++;
+        } else if ('0' <= c && c <= '9') {
+          // Start of a number
+          flush(at);
+          in = In::number;
+          buffer = at;
+          column++;
+        } else if (c == ' ' || c == '\t') {
+          // Whitespace
+          flush(at);
+          column++, startColumn++;
+        } else if (c == '\n' || c == '\r') {
+          // Line break
+          flush(at);
+          lineBreak(at);
+          line++;
+          column = 1;
+          startColumn = 1;
+        } else if (c == ',') {
+          // Comma
+          flush(at);
+          emit({ at, 1, Token::Type::comma, line, column });
+          column++, startColumn++;
+        } else if (c == '#') {
+          // Comment
+          flush(at);
+          in = In::comment;
+          column++;
+        } else {
+          // Identifier
+          if (buffer == nullptr)
+            buffer = at;
+          column++;
+        }
+        break;
+
+      case In::string:
+        // Handle strings
+        if (c == '"') {
+          append(at, Token::Type::string);
+          in = In::none;
+          column++;
+          startColumn = column;
+        } else if (c == '\n' || c == '\r') {
+          line++;
+          column = 1;
+        } else {
+          column++;
+        }
+        break;
+
+      case In::number:
+        // Handle numbers
+        if (('0' <= c && c <= '9') || (c == '.' && memchr(buffer, '.', at - buffer) == nullptr)) {
+          // Part of the number
+        } else {
+          // Start of another token: flush and handle
+          append(at, Token::Type::number);
+          in = In::none;
+          column++;
+          startColumn = column;
+          goto none;
+        }
+        break;
+
+      case In::section:
+        // Handle sections
+        if (c == ']') {
+          append(at, Token::Type::section);
+          in = In::none;
+          column++;
+          startColumn = column;
+        } else {
+          if (c == '\n' || c == '\r')
+            error("Unexpected end-of-line in section name.", line, column);
+          column++;
+        }
+        break;
+
+      case In::comment:
+        // Handle comments
+        if (c == '\n' || c == '\r') {
+          // End of line: done
+          in = In::none;
+          lineBreak(at);
+          line++;
+          column = 1;
+          startColumn = 1;
+        } else {
+          column++;
+        }
+        break;
+      }
+    }
+    // Check that we finished up our tokens
+    switch (in) {
+    case In::string:
+      error("Unexpected end-of-file in string.", line, column);
+      return false;
+
+    case In::section:
+      error("Unexpected end-of-file in section name.", line, column);
+      return false;
+
+    case In::number:
+      // Finish the number
+      append(end, Token::Type::number);
+      break;
+
+    case In::none:
+      flush(end);
+    case In::comment:
+      break;
+    }
+    // Final line break, as needed
+    if (empty) {
+      std::cout << "No content found in the file '" << path << "'." << std::endl;
+      return false;
+    } else if (last != Token::Type::lineBreak)
+      emit({ end, 0, Token::Type::lineBreak, line, column });
+
+    return success;
+  }
+
+
+
+  /// Checks that every line within a section starts with an identifier.
+  struct Structure : Sink {
+    /// The path to the markup file, for errors.
+    const char *path;
+
+    /// Whether to print errors, or only count them.
+    bool report;
+
+    /// The number of errors found.
+    int errors = 0;
+
+    /// Whether a section header has been seen.
+    bool inSection = false;
+
+    /// Whether the rest of the line belongs to an entry.
+    bool inEntry = false;
+
+    Structure(const char *path, bool report) : path(path), report(report) { }
+
+    void error(const char *message, const Token &token) {
+      if (report)
+        std::cout <<
+          "Error in '" << path << "' at line " << token.line <<
+          " col " << token.column << ": " << message << std::endl;
+      errors++;
+    }
+
+    void token(const Token &token) override {
+      if (inEntry) {
+        // Skip the rest of the line
+        if (token.type == Token::Type::lineBreak)
+          inEntry = false;
+      } else if (token.type == Token::Type::section) {
+        inSection = true;
+      } else if (!inSection) {
+        error("Invalid data without a section.", token);
+      } else if (token.type == Token::Type::lineBreak) {
+        // Ignore
+      } else {
+        // Check for a leading identifier
+        if (token.type != Token::Type::identifier)
+          error("Invalid data without an identifier.", token);
+        inEntry = true;
+      }
+    }
+  };
+
+
+
+  /// Groups tokens into entries for a visitor.
+  struct Entries : Sink {
+    /// The path to the markup file.
+    const char *path;
+
+    /// The receiver for the sections and entries.
+    Internal::Schema::Visitor &visitor;
+
+    /// The leading identifier of the current entry.
+    Token name;
+
+    /// The value tokens of the current entry.
+    std::vector<Token> values;
+
+    /// Whether the rest of the line belongs to an entry.
+    bool inEntry = false;
+
+    Entries(const char *path, Internal::Schema::Visitor &visitor)
+      : path(path), visitor(visitor) { }
+
+    void token(const Token &token) override {
+      if (inEntry) {
+        if (token.type == Token::Type::lineBreak) {
+          // End of the entry
+          inEntry = false;
+          visitor.entry({ path, &name, values.data(), values.data() + values.size() });
+        } else
+          values.push_back(token);
+      } else if (token.type == Token::Type::section) {
+        visitor.section(token);
+      } else if (token.type == Token::Type::lineBreak) {
+        // Ignore
+      } else {
+        // Start of an entry
+        name = token;
+        values.clear();
+        inEntry = true;
+      }
+    }
+  };
+
+
+
+  /// Check that a file is well-formed, without keeping its tokens.
+  /// \param[in] path
+  ///   The path to the markup file, for errors.
+  /// \param[in] contents
+  ///   The contents of the file.
+  /// \param[in] length
+  ///   The length of the contents of the file.
+  /// \returns
+  ///   Whether or not the file is well-formed.
+  bool check(const char *path, const char *contents, size_t length) {
+    Structure structure(path, false);
+    if (!tokenize(path, contents, length, structure))
+      return false;
+
+    if (structure.errors > 0) {
+      // Go through again to print the errors, now that the tokens are known
+      // to be fine, so that they follow any errors of the tokens themselves
+      Structure report(path, true);
+      tokenize(path, contents, length, report);
+      return false;
+    }
+
+    return true;
+  }
+}
+
+
+
+Internal::Schema::File::~File() {
+  free(contents);
+}
+
+bool Internal::Schema::File::load() {
+  // First, read the file
+  {
+    const char *dot = nullptr;
+    for (const char *c = path; *c; c++)
+      if (*c == '.')
+        dot = c;
+    String name = dot ? String(path, dot - path) : String(path);
+    const char *extension = dot ? dot + 1 : "";
+    if (!Driver::loadResource((const char *)name, extension, &contents, &length)) {
+      std::cout << "Failed to load file '" << path << "'." << std::endl;
+      contents = nullptr;
+      length = 0;
+      return false;
+    }
+  }
+
+  return check(path, contents, length);
+}
+
+bool Internal::Schema::File::load(const char *contents, size_t length) {
+  free(this->contents);
+  this->contents = (char *)malloc(length + 1);
+  memcpy(this->contents, contents, length);
+  this->contents[length] = 0;
+  this->length = length;
+  return check(path, this->contents, length);
+}
+
+void Internal::Schema::File::visit(Visitor &visitor) const {
+  Entries entries(path, visitor);
+  tokenize(path, contents, length, entries);
+}
+
+
+
+void Internal::Schema::error(
+  const char *path, int line, const char *message,
+  const Token *value, const char *suffix
+) {
+  std::cout << "Error in '" << path << "' at line " << line << ": " << message;
+  if (value != nullptr) {
+    std::cout.write(value->text, value->length);
+    std::cout << suffix;
+  }
+  std::cout << std::endl;
+}
+
+void Internal::Schema::error(
+  const Cursor &cursor, const Token &token, const char *message,
+  const char *value, size_t length, const char *suffix
+) {
+  std::cout <<
+    "Error in '" << cursor.path << "' at line " << cursor.line <<
+    " col " << token.column << ": " << message;
+  if (value != nullptr) {
+    std::cout.write(value, length);
+    std::cout << suffix;
+  }
+  std::cout << std::endl;
+}
+
+void Internal::Schema::unexpected(const Cursor &cursor, const char *expected, const char *identifier) {
+  std::cout <<
+    "Error in '" << cursor.path << "' at line " << cursor.line <<
+    ": Unexpected end-of-line, expected" << expected;
+  if (identifier != nullptr)
+    std::cout << identifier << "'";
+  std::cout << ".\n";
+}
+
+void Internal::Schema::unused(const Cursor &cursor) {
+  std::cout <<
+    "Error in '" << cursor.path << "' at line " << cursor.line <<
+    " col " << cursor.token->column << ": Unused value.\n";
+}
+
+
+
+bool Internal::Schema::parseInteger(const Token &token, int &integer) {
+  // Check that it is within range
+  if (token.length > 10)
+    return false;
+
+  // Convert to int
+  int64_t value = 0;
+  for (uint32_t i = 0; i < token.length; i++) {
+    if (token.text[i] < '0' || token.text[i] > '9')
+      return false;
+    value = value * 10 + (token.text[i] - '0');
+  }
+  if (value > INT32_MAX)
+    return false;
+
+  integer = (int)value;
+  return true;
+}
+
+bool Internal::Schema::parseReal(const Token &token, float &real) {
+  // The same conversion as `String::tryParseReal`, for identical results
+  bool decimal = false;
+  float fraction = 0.1;
+  real = 0;
+  for (uint32_t i = 0; i < token.length; i++) {
+    char c = token.text[i];
+    if (c == '.') {
+      if (decimal)
+        return false;
+      decimal = true;
+    } else if (c < '0' || c > '9') {
+      return false;
+    } else if (decimal) {
+      real += fraction * (c - '0');
+      fraction /= 10;
+    } else {
+      real *= 10;
+      real += c - '0';
+    }
+  }
+  return true;
+}
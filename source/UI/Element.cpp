@@ -145,7 +145,7 @@ Real2 Element::getBounds() {
   return _bounds;
 }
 
-void Element::draw(Real2 offset) {
+void Element::draw(bgfx::Encoder *encoder, Real2 offset) {
   if (_isDirty) {
     _bounds = { 0, 0 };
 
@@ -179,12 +179,12 @@ void Element::draw(Real2 offset) {
     _getActiveNode()->setDimensions(_bounds);
   }
 
-  System::loadTexture(_getActiveNode()->getTexture());
+  System::loadTexture(encoder, _getActiveNode()->getTexture());
 
   // Draw this node relative to parent
-  _getActiveNode()->drawMesh(offset);
+  _getActiveNode()->drawMesh(encoder, offset);
   for (auto &child : _children) {
-    child->draw(offset + getPosition());
+    child->draw(encoder, offset + getPosition());
   }
 
 }
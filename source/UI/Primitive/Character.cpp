@@ -6,6 +6,7 @@
  */
 
 #include <CityBuilder/UI/Primitive/Character.h>
+#include <CityBuilder/UI/System.h>
 
 USING_NS_CITY_BUILDER
 using namespace UI;
@@ -62,5 +63,6 @@ void Character::setMesh(Real2 offset) {
   }, {
     0, 1, 2, 2, 3, 1, // Box
   });
+  _mesh->mapTextureCoordinates(System::getTextureRegion(_textureKey));
   _mesh->load();
 }
@@ -54,7 +54,7 @@ String& Node::getTexture() {
   return _textureKey;
 }
 
-void Node::drawMesh(Real2 offset) {
+void Node::drawMesh(bgfx::Encoder *encoder, Real2 offset) {
   // Don't draw empty elements
   if (_size.x < 1 || _size.y < 1) return;
 
@@ -64,15 +64,13 @@ void Node::drawMesh(Real2 offset) {
     _isDirty = false;
   }
 
-  // Draw the mesh
-  _mesh->draw(Program::ui);
-
-  // State is being reset...
-  bgfx::setState(
+  // Draw the mesh (state is reset after every draw)
+  encoder->setState(
     BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A |
     BGFX_STATE_MSAA |
     BGFX_STATE_DEPTH_TEST_ALWAYS |
     BGFX_STATE_BLEND_FUNC(
       BGFX_STATE_BLEND_SRC_ALPHA, BGFX_STATE_BLEND_INV_SRC_ALPHA)
   );
+  _mesh->draw(encoder, Program::ui);
 }
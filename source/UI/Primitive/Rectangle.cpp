@@ -6,6 +6,7 @@
  */
 
 #include <CityBuilder/UI/Primitive/Rectangle.h>
+#include <CityBuilder/UI/System.h>
 
 USING_NS_CITY_BUILDER
 using namespace UI;
@@ -38,5 +39,6 @@ void Rectangle::setMesh(Real2 offset) {
   }, {
     0, 1, 2, 2, 3, 1, // Box
   });
+  _mesh->mapTextureCoordinates(System::getTextureRegion(_textureKey));
   _mesh->load();
 }
@@ -6,6 +6,7 @@
  */
 
 #include <CityBuilder/UI/Primitive/Rounded.h>
+#include <CityBuilder/UI/System.h>
 
 USING_NS_CITY_BUILDER
 using namespace UI;
@@ -59,6 +60,7 @@ void Rounded::setMesh(Real2 offset) {
     6, 7, 12, 12, 13, 7,    // Right Inside Face	
     1, 4, 11, 11, 14, 4,    // Middle Face	
   });
+  _mesh->mapTextureCoordinates(System::getTextureRegion(_textureKey));
   _mesh->load();
 }
 
@@ -11,12 +11,41 @@
 #include <CityBuilder/UI/Primitive/Rounded.h>
 #include <CityBuilder/UI/Primitive/Character.h>
 #include <CityBuilder/UI/Element.h>
+#include <CityBuilder/Rendering/TextureLoader.h>
 
 USING_NS_CITY_BUILDER
 using namespace UI;
 
 namespace {
-  Map<String, Resource<Texture>&> _textures = Map<String, Resource<Texture>&>::buckets<128>();
+  /// A texture that has been added to the UI.
+  struct UITexture {
+    /// The texture containing the image.
+    /// \remarks
+    ///   Shared by every image that is packed into the atlas.
+    Resource<Texture> texture;
+    
+    /// The region of the texture containing the image as
+    /// (left, top, width, height) in texture coordinates.
+    Real4 region;
+    
+    /// The resource path of the image.
+    String path;
+    
+    /// The width/height of the image, in pixels.
+    int size;
+  };
+  
+  Map<String, UITexture> _textures = Map<String, UITexture>::buckets<128>();
+  
+  /// The keys of the textures waiting to be packed into the atlas.
+  List<String> _pending { };
+  
+  /// Whether the texture atlas has been packed.
+  bool _packed = false;
+  
+  /// The space left between images in the atlas, in pixels.
+  const int atlasPadding = 2;
+  
   Ref<Rounded &> hotbar_bg;
   Ref<Rectangle &> zone_ico;
   Ref<Rectangle &> road_ico;
@@ -25,18 +54,104 @@ namespace {
   Ref<Element &> zone;
   Ref<Element &> road;
   Ref<Element &> dozer;
+  
+  /// Pack all of the pending textures into a single atlas texture.
+  void packAtlas() {
+    _packed = true;
+    if (_pending.isEmpty())
+      return;
+    
+    // Place the largest images first
+    _pending.sort([](const String &a, const String &b) {
+      return _textures[a].size > _textures[b].size;
+    });
+    
+    // Shelf pack into the narrowest power-of-two texture that is not taller
+    // than it is wide
+    TextureLoader::Request request;
+    request.kind = TextureLoader::Kind::atlas;
+    request.flags = BGFX_SAMPLER_U_CLAMP | BGFX_SAMPLER_V_CLAMP;
+    for (int width = 64;; width *= 2) {
+      request.layers.removeAll();
+      int x = 0, y = 0, shelf = 0;
+      for (const String &key : _pending) {
+        UITexture &texture = _textures[key];
+        if (x + texture.size > width) {
+          // Start the next shelf
+          x = 0;
+          y += shelf;
+          shelf = 0;
+        }
+        request.layers.append({ texture.path, x, y, texture.size });
+        x += texture.size + atlasPadding;
+        if (texture.size + atlasPadding > shelf)
+          shelf = texture.size + atlasPadding;
+      }
+      
+      int height = 1;
+      while (height < y + shelf - atlasPadding)
+        height *= 2;
+      if (height <= width) {
+        request.width  = width;
+        request.height = height;
+        break;
+      }
+    }
+    
+    // Load the atlas
+    Resource<Texture> atlas = new Texture(request);
+    
+    // Point every image at its region of the atlas, inset by half a texel so
+    // that filtering never samples a neighbouring image
+    Real2 texel = { Real(1) / Real(request.width), Real(1) / Real(request.height) };
+    for (size_t i = 0; i < _pending.count(); i++) {
+      UITexture &texture = _textures[_pending[i]];
+      const TextureLoader::Layer &layer = request.layers[i];
+      texture.texture = atlas;
+      texture.region = {
+        (Real(layer.x) + Real(0.5)) * texel.x,
+        (Real(layer.y) + Real(0.5)) * texel.y,
+        Real(layer.size - 1) * texel.x,
+        Real(layer.size - 1) * texel.y,
+      };
+    }
+    
+    _pending.removeAll();
+  }
 }
 
-void System::addTexture(const String& name, const String& path, int size, bool mipMaps) {
-  _textures.set(name, *(new Resource(new Texture(path, size, mipMaps))));
+void System::addTexture(const String& name, const String& path) {
+  TextureLoader::Info info;
+  bool packable = TextureLoader::describe(path, info) &&
+    info.format == bgfx::TextureFormat::RGBA8 && info.mips == 1 &&
+    info.layers == 1 && info.width == info.height;
+  int size = packable ? info.width : 0;
+  
+  if (_packed || !packable) {
+    // Too late for (or not suitable for) the atlas, load the texture on its own
+    _textures.set(name, {
+      new Texture(path), { 0, 0, 1, 1 }, path, size
+    });
+    return;
+  }
+  
+  // Pack the texture into the atlas once the UI starts
+  _textures.set(name, { nullptr, { 0, 0, 1, 1 }, path, size });
+  _pending.append(name);
 }
 
 Resource<Texture>& System::getTexture(const String& name) {
-  return _textures[name];
+  return _textures[name].texture;
+}
+
+Real4 System::getTextureRegion(const String& name) {
+  if (!_textures.has(name))
+    return { 0, 0, 1, 1 };
+  return _textures[name].region;
 }
 
-void System::loadTexture(const String& name) {
-  _textures[name]->load(1, Uniforms::s_ui);
+void System::loadTexture(bgfx::Encoder *encoder, const String& name) {
+  _textures[name].texture->load(encoder, 1, Uniforms::s_ui);
 }
 
 void System::start() {
@@ -44,12 +159,15 @@ void System::start() {
   Program::ui = new Program("ui.vertex", "ui.fragment");
 
   // Declare our textures
-  System::addTexture("Round",     "ui/round",          128);
-  System::addTexture("Square",    "ui/square",         128);
-  System::addTexture("Bulldozer", "ui/bulldozer-icon", 24);
-  System::addTexture("Road",      "ui/road-icon",      24);
-  System::addTexture("Zone",      "ui/zone-icon",      24);
-  System::addTexture("Font",      "ui/font",           384);
+  System::addTexture("Round",     "ui/round");
+  System::addTexture("Square",    "ui/square");
+  System::addTexture("Bulldozer", "ui/bulldozer-icon");
+  System::addTexture("Road",      "ui/road-icon");
+  System::addTexture("Zone",      "ui/zone-icon");
+  System::addTexture("Font",      "ui/font");
+  
+  // Pack the textures into a single atlas so the UI is drawn with one texture
+  packAtlas();
 
   // Make some elements
   hotbar_bg = new Rounded();
@@ -116,7 +234,7 @@ void System::drawNode(Ref<Node &> root, Real2 offset) {
   // }
 }
 
-void System::draw(const Real2& screen) {
+void System::setView(const Real2& screen) {
   // Setup the UI projection
   Real4x4 projectionMatrix;
   bx::mtxOrtho(
@@ -130,26 +248,21 @@ void System::draw(const Real2& screen) {
   
   // Setup the UI view
   bgfx::touch(1);
-  bgfx::setState(
-    BGFX_STATE_WRITE_RGB | BGFX_STATE_WRITE_A |
-    BGFX_STATE_MSAA |
-    BGFX_STATE_DEPTH_TEST_ALWAYS |
-    BGFX_STATE_BLEND_FUNC(
-      BGFX_STATE_BLEND_SRC_ALPHA, BGFX_STATE_BLEND_INV_SRC_ALPHA)
-  );
-  
+}
+
+void System::draw(bgfx::Encoder *encoder) {
   // Draw the UI
-  System::loadTexture("Round");
-  hotbar_bg->drawMesh({ 0, 0 });
+  System::loadTexture(encoder, "Round");
+  hotbar_bg->drawMesh(encoder, { 0, 0 });
 
-  System::loadTexture("Zone");
-  zone_ico->drawMesh({ 0, 0 });
+  System::loadTexture(encoder, "Zone");
+  zone_ico->drawMesh(encoder, { 0, 0 });
 
-  System::loadTexture("Road");
-  road_ico->drawMesh({ 0, 0 });
+  System::loadTexture(encoder, "Road");
+  road_ico->drawMesh(encoder, { 0, 0 });
 
-  System::loadTexture("Bulldozer");
-  dozer_ico->drawMesh({ 0, 0 });
+  System::loadTexture(encoder, "Bulldozer");
+  dozer_ico->drawMesh(encoder, { 0, 0 });
 
   // hotbar->draw();
 }
@@ -0,0 +1,348 @@
+/**
+ * @file Buildings.cpp
+ * @brief The implementation of building growth.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Zones/Buildings.h>
+#include <CityBuilder/Simulation/Economy.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The number of lots handled between checks of the time budget.
+  constexpr int budgetInterval = 16;
+
+  /// How far a building may move or grow within its lot before a change to
+  /// the lot demolishes it, in meters.
+  constexpr float tolerance = 0.05f;
+
+  /// The floor area taken by each resident or job of every use, in square
+  /// meters.
+  constexpr float areaPerCapacity[] = { 40, 25, 60 };
+
+  /// The share of the rectangle of each archetype that it covers.
+  constexpr float coverage[Buildings::archetypes] = { 1, 0.75f, 1, 0.6f, 1, 0.8f };
+
+  /// The wall colors of the buildings of every use.
+  constexpr uint32_t palettes[3][4] = {
+    { 0xe8dcc4, 0xd9c3a0, 0xf0ece0, 0xc9a98a },
+    { 0x9fb4c8, 0xc8ccd0, 0x8aa0a8, 0xd8d0c0 },
+    { 0xa89880, 0x8c8c88, 0xb07c5c, 0x9ca4a0 },
+  };
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+}
+
+
+
+bool Buildings::grow(const Parcels &parcels, const Economy &economy, Real elapsed, double budget) {
+  Clock::time_point start = Clock::now();
+  const List<Parcels::Lot> &lots = parcels.lots();
+  if (_buildings.count() < lots.count()) {
+    _buildings.reserve(lots.count());
+    _queued.reserve(lots.count());
+  }
+  while (_buildings.count() < lots.count()) {
+    _buildings.append({ nullptr, Archetype::house, 0, 0, { } });
+    _queued.append(0);
+  }
+
+  // Catch up with the lots, checking only those that changed unless an
+  // update was missed, as many as the budget allows
+  if (parcels.version() != _parcelsVersion) {
+    if (parcels.version() == _parcelsVersion + 1)
+      for (uint32_t lot : parcels.changed())
+        _unchecked.append(lot);
+    else {
+      _unchecked.removeAll();
+      _nextUnchecked = 0;
+      for (uint32_t lot = 0; lot < lots.count(); lot++)
+        _unchecked.append(lot);
+    }
+    _parcelsVersion = parcels.version();
+  }
+  while (_nextUnchecked < _unchecked.count()) {
+    size_t last = std::min(_nextUnchecked + 256, (size_t)_unchecked.count());
+    for (; _nextUnchecked < last; _nextUnchecked++)
+      _check(parcels, _unchecked[_nextUnchecked]);
+    if (since(start) > budget)
+      break;
+  }
+  if (_nextUnchecked == _unchecked.count()) {
+    _unchecked.removeAll();
+    _nextUnchecked = 0;
+  }
+
+  // Let every zone grow as much as its demand allows, taking turns so that a
+  // tight budget is shared between them, and stopping once it has what it
+  // wants
+  for (Zone &zone : _zones) {
+    float demand = economy.demand(zone.zone);
+    if (demand > 0 && !zone.vacant.isEmpty())
+      zone.allowance += demand * growthRate * (float)elapsed;
+    else
+      zone.allowance = 0;
+  }
+  int handled = 0;
+  bool growing = true;
+  while (growing) {
+    growing = false;
+    for (Zone &zone : _zones) {
+      if (zone.allowance < 1 || zone.vacant.isEmpty())
+        continue;
+      if (zone.capacity >= economy.wanted(zone.zone)) {
+        zone.allowance = 0;
+        continue;
+      }
+      growing = true;
+
+      // Take a vacant lot at random, skipping those that have changed since
+      // they were queued
+      size_t index = std::min((size_t)(_random() * zone.vacant.count()), zone.vacant.count() - 1);
+      uint32_t id = zone.vacant[index];
+      zone.vacant[index] = zone.vacant[zone.vacant.count() - 1];
+      zone.vacant.remove(zone.vacant.count() - 1);
+      _queued[id] = 0;
+
+      const Parcels::Lot &lot = lots[id];
+      _footprint footprint;
+      if (lot.road && lot.zone == zone.zone && lot.buildable() &&
+          !_buildings[id].zone && _fit(lot, footprint)) {
+        _build(id, zone, footprint, economy.demand(zone.zone));
+        zone.allowance--;
+      }
+
+      if (++handled % budgetInterval == 0 && since(start) > budget) {
+        growing = false;
+        break;
+      }
+    }
+  }
+
+  double time = since(start);
+  _stats.ticks++;
+  _stats.time += time;
+  _stats.longest = std::max(_stats.longest, time);
+
+  if (_changing.isEmpty())
+    return false;
+  std::sort(_changing.begin(), _changing.begin() + _changing.count());
+  size_t unique = std::unique(_changing.begin(), _changing.begin() + _changing.count()) - _changing.begin();
+  while (_changing.count() > unique)
+    _changing.remove(_changing.count() - 1);
+  _changed = _changing;
+  _changing.removeAll();
+  _version++;
+  return true;
+}
+
+float Buildings::capacity(const ZoneDef *zone) const {
+  for (const Zone &built : _zones)
+    if (built.zone == zone)
+      return built.capacity;
+  return 0;
+}
+
+
+
+bool Buildings::_fit(const Parcels::Lot &lot, _footprint &footprint) {
+  // Work along the front of the lot, with the lot to its left
+  Real2 f0 = lot.corners[0], b0 = lot.corners[1], b1 = lot.corners[2], f1 = lot.corners[3];
+  Real2 front = f1 - f0;
+  float width = (float)front.magnitude();
+  if (width < minimumSize)
+    return false;
+  Real2 u = front / Real2(width);
+  Real2 v(-u.y, u.x);
+  if ((float)v.dot((b0 - f0) + (b1 - f1)) < 0) {
+    std::swap(f0, f1);
+    std::swap(b0, b1);
+    u = Real2(-u.x, -u.y);
+    v = Real2(-v.x, -v.y);
+  }
+  auto across = [&](Real2 point) { return (float)(point - f0).dot(u); };
+  auto back    = [&](Real2 point) { return (float)(point - f0).dot(v); };
+
+  // Keep clear of the road's edge, which bulges past the front of the lot on
+  // the outside of a curve
+  Path2 &path = lot.road->path.path();
+  Real2 middle = (f0 + f1) * Real2(0.5);
+  Real t = path.inverse(middle);
+  Real2 edge = path.point(t) +
+    path.normal(t) * Real2(lot.right ? 1 : -1) * Real2(lot.road->path.radius());
+  float near = std::max(back(edge), 0.0f) + frontSetback;
+
+  // Keep clear of the sides of the lot, which may close in or open out
+  // towards its back
+  auto side = [&](Real2 frontCorner, Real2 backCorner, float distance) {
+    float a = back(frontCorner), b = back(backCorner);
+    float fraction = std::abs(b - a) > 1e-4f ? (distance - a) / (b - a) : 0;
+    return across(frontCorner) + (across(backCorner) - across(frontCorner)) * fraction;
+  };
+  float left  = side(f0, b0, near) + sideSetback;
+  float right = side(f1, b1, near) - sideSetback;
+
+  // Where the back of the lot slopes, as on corner lots clipped against the
+  // crossing road, give up the shallow end for the largest rectangle under it
+  float a0 = across(b0), a1 = across(b1), d0 = back(b0), d1 = back(b1);
+  float slope = std::abs(a1 - a0) > 1e-4f ? (d1 - d0) / (a1 - a0) : 0;
+  auto backAt = [&](float x) { return d0 + slope * (x - a0) - rearSetback - near; };
+  if (slope > 0.05f)
+    left = std::min(std::max((slope * right - backAt(0)) / (2 * slope), left), right - minimumSize);
+  else if (slope < -0.05f)
+    right = std::max(std::min((slope * left - backAt(0)) / (2 * slope), right), left + minimumSize);
+  float far = near + std::min(backAt(left), backAt(right));
+  if (far - near < minimumSize)
+    return false;
+  left  = std::max(left , side(f0, b0, far) + sideSetback);
+  right = std::min(right, side(f1, b1, far) - sideSetback);
+  if (right - left < minimumSize)
+    return false;
+
+  footprint.axis   = u;
+  footprint.width  = right - left;
+  footprint.depth  = far - near;
+  footprint.center = f0 +
+    u * Real2((left + right) * 0.5f) + v * Real2((near + far) * 0.5f);
+  return true;
+}
+
+void Buildings::_check(const Parcels &parcels, uint32_t id) {
+  _stats.checked++;
+  const Parcels::Lot &lot = parcels.lots()[id];
+  Building &building = _buildings[id];
+
+  // Keep the building while it still fits in the space left on its lot
+  if (building.zone) {
+    _footprint footprint;
+    bool fits = lot.road && lot.zone == building.zone && _fit(lot, footprint);
+    if (fits) {
+      const Instance &instance = building.instance;
+      Real2 u = footprint.axis, v(-u.y, u.x);
+      Real2 offset = Real2(instance.x, instance.z) - footprint.center;
+      float across = (float)offset.dot(u), back = (float)offset.dot(v);
+      fits =
+        (float)u.dot(Real2(instance.cos, instance.sin)) > 1 - 1e-4f &&
+        std::abs(across) + instance.width * 0.5f <= footprint.width * 0.5f + tolerance &&
+        std::abs(back)   + instance.depth * 0.5f <= footprint.depth * 0.5f + tolerance;
+    }
+    if (!fits)
+      _demolish(id);
+  }
+
+  if (!building.zone && !_queued[id] && lot.road && lot.buildable()) {
+    _zoneOf(lot.zone).vacant.append(id);
+    _queued[id] = 1;
+  }
+}
+
+void Buildings::_build(uint32_t id, Zone &zone, const _footprint &footprint, float demand) {
+  ZoneDef *def = zone.zone;
+  int use = (int)def->use;
+  bool large = footprint.width >= 10 && footprint.depth >= 14;
+
+  // Choose the shape and size of the building, taller and denser while the
+  // zone wants much more than it has
+  Archetype archetype;
+  float width = footprint.width, depth, floorHeight = 3.5f;
+  int floors;
+  switch (def->use) {
+  case ZoneDef::Use::residential:
+    if (large && _random() < 0.25f + 0.5f * demand) {
+      archetype = Archetype::apartments;
+      depth  = std::min(footprint.depth, 18.0f);
+      floors = 3 + (int)(_random() * 4);
+    } else {
+      archetype = Archetype::house;
+      width  = std::min(footprint.width, 11.0f);
+      depth  = std::min(footprint.depth, 10.0f);
+      floors = 1 + (int)(_random() * 2);
+      floorHeight = 3;
+    }
+    break;
+
+  case ZoneDef::Use::commercial:
+    if (large && _random() < 0.2f + 0.4f * demand) {
+      archetype = Archetype::tower;
+      depth  = std::min(footprint.depth, 20.0f);
+      floors = 6 + (int)(_random() * 15);
+    } else {
+      archetype = Archetype::shop;
+      depth  = std::min(footprint.depth, 14.0f);
+      floors = 1 + (int)(_random() * 3);
+      floorHeight = 4;
+    }
+    break;
+
+  default:
+    if (footprint.width >= 10 && footprint.depth >= 12 && _random() < 0.35f) {
+      archetype = Archetype::factory;
+      depth  = std::min(footprint.depth, 24.0f);
+      floors = 2 + (int)(_random() * 2);
+    } else {
+      archetype = Archetype::shed;
+      depth  = std::min(footprint.depth, 20.0f);
+      floors = 1;
+    }
+    floorHeight = 6;
+    break;
+  }
+
+  // Put the building at the front of its space, facing the road
+  Real2 u = footprint.axis, v(-u.y, u.x);
+  Real2 center = footprint.center + v * Real2((depth - footprint.depth) * 0.5f);
+  float height = floors * floorHeight + (archetype == Archetype::house ? 3 : 0);
+  uint32_t color = palettes[use][std::min((int)(_random() * 4), 3)];
+
+  Building &building = _buildings[id];
+  building.zone = def;
+  building.archetype = archetype;
+  building.floors = (uint8_t)floors;
+  building.capacity =
+    width * depth * coverage[(int)archetype] * floors / areaPerCapacity[use];
+  building.instance = {
+    (float)center.x, (float)center.y, (float)u.x, (float)u.y,
+    width, depth, height, (float)color
+  };
+
+  zone.capacity += building.capacity;
+  _useCapacity[use] += building.capacity;
+  _count++;
+  _changing.append(id);
+  _stats.built++;
+}
+
+void Buildings::_demolish(uint32_t id) {
+  Building &building = _buildings[id];
+  _zoneOf(building.zone).capacity -= building.capacity;
+  _useCapacity[(int)building.zone->use] -= building.capacity;
+  building.zone = nullptr;
+  _count--;
+  _changing.append(id);
+  _stats.demolished++;
+}
+
+Buildings::Zone &Buildings::_zoneOf(ZoneDef *zone) {
+  for (Zone &existing : _zones)
+    if (existing.zone == zone)
+      return existing;
+  _zones.append({ zone });
+  return _zones[_zones.count() - 1];
+}
+
+float Buildings::_random() {
+  // xorshift32
+  _seed ^= _seed << 13;
+  _seed ^= _seed >> 17;
+  _seed ^= _seed << 5;
+  return (_seed >> 8) * (1.0f / 16777216.0f);
+}
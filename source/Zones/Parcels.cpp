@@ -0,0 +1,394 @@
+/**
+ * @file Parcels.cpp
+ * @brief The implementation of building lot subdivision.
+ * @date May 14, 2023
+ * @copyright Copyright (c) 2023
+ */
+
+#include <CityBuilder/Zones/Parcels.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+USING_NS_CITY_BUILDER
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  /// The number of pieces that a curved road is measured in to find the
+  /// parameter at a distance along it.
+  constexpr int measureSteps = 32;
+
+  /// The number of times that the reach of a lot is halved to find where it
+  /// must be clipped.
+  constexpr int clipSteps = 8;
+
+  /// The time elapsed since a point in time, in microseconds.
+  double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  /// Find the parameter of a path at a distance along it.
+  /// \param[in] path
+  ///   The path to measure.
+  /// \param[in] length
+  ///   The length of the path.
+  /// \param[in] distance
+  ///   The distance along the path.
+  float parameter(Path2 &path, float length, float distance) {
+    if (length <= 0)
+      return 0;
+    float target = std::min(std::max(distance / length, 0.0f), 1.0f);
+    if (path.type() == Path2::Type::line)
+      return target;
+
+    // Measure the curve piece by piece until the distance is passed
+    target *= length;
+    float measured = 0;
+    Real2 previous = path.start;
+    for (int i = 1; i <= measureSteps; i++) {
+      Real2 point = path.point(Real(i) / Real(measureSteps));
+      float piece = (float)point.distance(previous);
+      if (measured + piece >= target)
+        return (i - 1 + (piece > 0 ? (target - measured) / piece : 0)) / measureSteps;
+      measured += piece;
+      previous = point;
+    }
+    return 1;
+  }
+
+  /// Add the intersections at either end of a road.
+  void addIntersections(Road *road, List<Intersection *> &intersections) {
+    for (const Connection *connection : { &road->start, &road->end })
+      if (connection->type == Connection::intersection)
+        intersections.append(connection->other.intersection);
+  }
+
+  /// Sort a list of lots and remove any repeats.
+  void unique(List<uint32_t> &lots) {
+    if (lots.count() < 2)
+      return;
+    uint32_t *begin = lots.begin(), *end = begin + lots.count();
+    std::sort(begin, end);
+    size_t count = std::unique(begin, end) - begin;
+    while (lots.count() > count)
+      lots.remove(lots.count() - 1);
+  }
+}
+
+
+
+void Parcels::invalidate(Road *road) {
+  if (road->_lotsQueued)
+    return;
+  road->_lotsQueued = true;
+  _queued.append(road);
+}
+
+void Parcels::split(Road *road, const List<Road *> &pieces) {
+  List<uint32_t> kept { };
+  float offset = 0;
+  List<float> starts { };
+  for (Road *piece : pieces) {
+    starts.append(offset);
+    offset += (float)piece->path.length();
+  }
+
+  for (uint32_t id : road->_lots) {
+    Lot &lot = _lots[id];
+    intptr_t piece = pieces.count() - 1;
+    while (piece > 0 && starts[piece] > lot.start)
+      piece--;
+    Road *to = pieces[piece];
+    float start = lot.start - starts[piece], end = lot.end - starts[piece];
+    if (start < 0 || end > (float)to->path.length()) {
+      kept.append(id);
+      continue;
+    }
+
+    // Hand the lot over without moving it
+    lot.road  = to;
+    lot.start = start;
+    lot.end   = end;
+    to->_lots.append(id);
+    _unclipped.append(id);
+  }
+  road->_lots = kept;
+
+  // The new roads have been subdivided as far as their lots go
+  for (Road *piece : pieces) {
+    piece->_lotStart  = piece->path.start();
+    piece->_lotEnd    = piece->path.end();
+    piece->_lotLength = (float)piece->path.length();
+  }
+}
+
+void Parcels::remove(Road *road) {
+  for (uint32_t id : road->_lots)
+    _release(id);
+  road->_lots.removeAll();
+
+  if (road->_lotsPlaced) {
+    _roadGrid.remove(road, road->_lotBounds);
+    _regions.append(road->_lotBounds.inflated(lotDepth));
+    road->_lotsPlaced = false;
+  }
+
+  if (road->_lotsQueued) {
+    for (intptr_t i = 0; i < _queued.count(); i++)
+      if (_queued[i] == road) {
+        _queued.remove(i);
+        break;
+      }
+    road->_lotsQueued = false;
+  }
+}
+
+bool Parcels::update() {
+  if (_queued.isEmpty() && _regions.isEmpty() && _unclipped.isEmpty())
+    return false;
+  Clock::time_point start = Clock::now();
+
+  // Subdivide the roads first, so that every road is in the grid before any
+  // lot is clipped against it
+  for (Road *road : _queued)
+    _subdivide(road);
+  _queued.removeAll();
+
+  // Clip the new lots and every lot near a road that changed
+  for (const Bounds2 &region : _regions)
+    _lotGrid.query(region, _unclipped);
+  _regions.removeAll();
+  unique(_unclipped);
+  for (uint32_t id : _unclipped)
+    if (_lots[id].road) {
+      _clip(id);
+      _changing.append(id);
+    }
+  _unclipped.removeAll();
+  unique(_changing);
+  _changed = _changing;
+  _changing.removeAll();
+
+  _version++;
+  _stats.updates++;
+  _stats.time += since(start);
+  return true;
+}
+
+
+
+void Parcels::_subdivide(Road *road) {
+  road->_lotsQueued = false;
+  Path2 &path = road->path.path();
+  float length = (float)path.length();
+
+  // Keep the grid of roads up to date, and clip the lots around the road
+  // again wherever it has moved
+  bool moved =
+    road->_lotLength == 0 ||
+    road->_lotStart.squareDistance(path.start) > Real(1e-4) ||
+    road->_lotEnd  .squareDistance(path.end  ) > Real(1e-4);
+  if (moved || !road->_lotsPlaced) {
+    if (road->_lotsPlaced) {
+      _roadGrid.remove(road, road->_lotBounds);
+      _regions.append(road->_lotBounds.inflated(lotDepth));
+    }
+    road->_lotBounds = road->path.bounds();
+    road->_lotsPlaced = true;
+    _roadGrid.insert(road, road->_lotBounds);
+    _regions.append(road->_lotBounds.inflated(lotDepth));
+  }
+
+  // Follow the start of the road if only it moved, as when pushed back by an
+  // intersection, and start over if the whole road did
+  if (moved && road->_lotLength > 0) {
+    bool startMoved = road->_lotStart.squareDistance(path.start) > Real(1e-4);
+    bool endMoved   = road->_lotEnd  .squareDistance(path.end  ) > Real(1e-4);
+    float shift = startMoved ? length - road->_lotLength : 0;
+    List<uint32_t> kept { };
+    for (uint32_t id : road->_lots) {
+      Lot &lot = _lots[id];
+      lot.start += shift;
+      lot.end   += shift;
+      if ((startMoved && endMoved) || lot.start < 0 || lot.end > length)
+        _release(id);
+      else {
+        _lotGrid.remove(id, lot.extent);
+        _place(id);
+        kept.append(id);
+      }
+    }
+    road->_lots = kept;
+  }
+  road->_lotStart  = path.start;
+  road->_lotEnd    = path.end;
+  road->_lotLength = length;
+
+  // Rezone the lots of each side, and subdivide the spans without any
+  for (bool right : { false, true }) {
+    ZoneDef *zone = right ? road->_rightZone : road->_leftZone;
+    List<uint32_t> side { }, kept { };
+    for (uint32_t id : road->_lots)
+      if (_lots[id].right != right)
+        kept.append(id);
+      else if (!zone)
+        _release(id);
+      else {
+        if (_lots[id].zone != zone) {
+          _lots[id].zone = zone;
+          _changing.append(id);
+        }
+        side.append(id);
+        kept.append(id);
+      }
+    road->_lots = kept;
+    if (!zone)
+      continue;
+
+    std::sort(side.begin(), side.begin() + side.count(), [this](uint32_t a, uint32_t b) {
+      return _lots[a].start < _lots[b].start;
+    });
+    float cursor = 0;
+    for (uint32_t id : side) {
+      _fill(road, right, cursor, _lots[id].start);
+      cursor = std::max(cursor, _lots[id].end);
+    }
+    _fill(road, right, cursor, length);
+  }
+}
+
+void Parcels::_fill(Road *road, bool right, float start, float end) {
+  float span = end - start;
+  if (span < minimumFrontage)
+    return;
+  int count = std::max((int)std::lround(span / targetFrontage), 1);
+  float frontage = span / count;
+  for (int i = 0; i < count; i++) {
+    uint32_t id;
+    if (!_free.isEmpty()) {
+      id = _free[_free.count() - 1];
+      _free.remove(_free.count() - 1);
+    } else {
+      id = (uint32_t)_lots.count();
+      _lots.append({ });
+    }
+
+    Lot &lot = _lots[id];
+    lot = { };
+    lot.road  = road;
+    lot.zone  = right ? road->_rightZone : road->_leftZone;
+    lot.right = right;
+    lot.start = start + frontage * i;
+    lot.end   = i + 1 == count ? end : start + frontage * (i + 1);
+    road->_lots.append(id);
+    _place(id);
+    _stats.placed++;
+  }
+}
+
+void Parcels::_clip(uint32_t id) {
+  Lot &lot = _lots[id];
+  Road *road = lot.road;
+  Path2 &path = road->path.path();
+  float length = (float)path.length();
+  Real side = lot.right ? 1 : -1;
+  Real radius = road->path.radius();
+  _stats.clipped++;
+
+  // The front corners of the lot, at the edge of the road
+  float t0 = parameter(path, length, lot.start), t1 = parameter(path, length, lot.end);
+  Real2 n0 = path.normal(t0) * Real2(side), n1 = path.normal(t1) * Real2(side);
+  Real2 f0 = path.point(t0) + n0 * Real2(radius), f1 = path.point(t1) + n1 * Real2(radius);
+
+  // Keep the back of the lot at least half as wide as its front, as its sides
+  // close in on the inside of a curve
+  float reach = lotDepth;
+  Real2 front = f1 - f0;
+  float width = (float)front.magnitude();
+  if (width > 0) {
+    float closing = -(float)(n1 - n0).dot(front) / width;
+    if (closing > 0)
+      reach = std::min(reach, 0.5f * width / closing);
+  }
+
+  // Every point of the lot should be further from any other road or
+  // intersection than from its own, so only the roads within its depth of it
+  // matter
+  List<Road *> nearby { };
+  _roadGrid.query(lot.extent.inflated(lotDepth), nearby);
+  List<Intersection *> intersections { };
+  addIntersections(road, intersections);
+  for (Road *other : nearby)
+    addIntersections(other, intersections);
+  auto clear = [&](Real2 point, float depth) {
+    for (Road *other : nearby)
+      if (other != road) {
+        Real2 closest = other->path.point(other->path.inverse(point));
+        if ((float)(closest.distance(point) - other->path.radius()) <= depth)
+          return false;
+      }
+    for (Intersection *intersection : intersections)
+      if ((float)(intersection->center.distance(point) - intersection->radius) <= depth)
+        return false;
+    return true;
+  };
+  auto clip = [&](Real2 point, Real2 normal) {
+    if (clear(point + normal * Real2(reach), reach))
+      return reach;
+    float low = 0, high = reach;
+    for (int i = 0; i < clipSteps; i++) {
+      float middle = (low + high) * 0.5f;
+      if (clear(point + normal * Real2(middle), middle))
+        low = middle;
+      else
+        high = middle;
+    }
+    return low;
+  };
+  lot.depth[0] = clip(f0, n0);
+  lot.depth[1] = clip(f1, n1);
+
+  // Pull the back of the lot in while the middle of it is not clear, as
+  // where a road passes between its sides
+  for (int i = 0; i < clipSteps / 2; i++) {
+    Real2 back = (f0 + n0 * Real2(lot.depth[0]) + f1 + n1 * Real2(lot.depth[1])) * Real2(0.5);
+    if (clear(back, (lot.depth[0] + lot.depth[1]) * 0.5f))
+      break;
+    lot.depth[0] *= 0.75f;
+    lot.depth[1] *= 0.75f;
+  }
+
+  lot.corners[0] = f0;
+  lot.corners[1] = f0 + n0 * Real2(lot.depth[0]);
+  lot.corners[2] = f1 + n1 * Real2(lot.depth[1]);
+  lot.corners[3] = f1;
+}
+
+void Parcels::_release(uint32_t id) {
+  Lot &lot = _lots[id];
+  _lotGrid.remove(id, lot.extent);
+  lot.road = nullptr;
+  _free.append(id);
+  _changing.append(id);
+  _stats.freed++;
+}
+
+void Parcels::_place(uint32_t id) {
+  Lot &lot = _lots[id];
+  Path2 &path = lot.road->path.path();
+  float length = (float)path.length();
+  Real side = lot.right ? 1 : -1;
+  Real radius = lot.road->path.radius();
+
+  // Bound the lot as far back as it could reach, at its ends and middle
+  lot.extent = Bounds2(path.point(parameter(path, length, lot.start)));
+  for (float distance : { lot.start, (lot.start + lot.end) * 0.5f, lot.end }) {
+    float t = parameter(path, length, distance);
+    Real2 point = path.point(t), normal = path.normal(t) * Real2(side);
+    lot.extent.fit(point + normal * Real2(radius));
+    lot.extent.fit(point + normal * Real2(radius + lotDepth));
+  }
+  lot.extent.inflate(1);
+  _lotGrid.insert(id, lot.extent);
+  _unclipped.append(id);
+}
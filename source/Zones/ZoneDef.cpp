@@ -6,45 +6,128 @@
  */
 
 #include <CityBuilder/Zones/ZoneDef.h>
-#include <CityBuilder/Tools/Markup.h>
+#include <CityBuilder/Tools/MarkupSchema.h>
+#include <CityBuilder/Jobs.h>
 #include <iostream>
+#include <memory>
+#include <vector>
 USING_NS_CITY_BUILDER
 
 Map<String, ZoneDef> ZoneDef::zones { };
 
+namespace {
+  /// The contents of a zone definition file.
+  struct ZoneFile : ZoneDef {
+    /// The colors that a zone can be drawn in.
+    enum class Color {
+      none,
+      green,
+      blue,
+      orange,
+    };
+    
+    /// The name of the color of the zone, if it has one.
+    Color colorName = Color::none;
+  };
+  
+  // Aliases
+  typedef ZoneDef::Demand Demand;
+  
+  /// The layout of a zone definition file.
+  constexpr auto zoneSchema = Schema::document(
+    Schema::section("zone",
+      Schema::field("name", &ZoneFile::name),
+      Schema::field("color", &ZoneFile::colorName, {
+        { "green" , ZoneFile::Color::green  },
+        { "blue"  , ZoneFile::Color::blue   },
+        { "orange", ZoneFile::Color::orange },
+      }),
+      Schema::field("use", &ZoneFile::use, {
+        { "residential", ZoneDef::Use::residential },
+        { "commercial" , ZoneDef::Use::commercial  },
+        { "industrial" , ZoneDef::Use::industrial  },
+      })),
+    Schema::section("demand",
+      Schema::records(&ZoneFile::demand,
+        { "base", "residential", "commercial", "industrial", "frontage" },
+        Schema::set(&Demand::source, {
+          Demand::Source::base,
+          Demand::Source::residential,
+          Demand::Source::commercial,
+          Demand::Source::industrial,
+          Demand::Source::frontage
+        }),
+        Schema::real(&Demand::weight)))
+  );
+  
+  /// Parse a zone definition file.
+  /// \param[in] path
+  ///   The path to the zone file.
+  /// \param[out] zone
+  ///   The zone to parse into.
+  /// \remarks
+  ///   Only touches the zone, so may run on many files at once.
+  bool parse(const String &path, ZoneDef &zone) {
+    ZoneFile file { };
+    if (!Schema::parse(path, file, zoneSchema))
+      return false;
+    
+    // Look up the color
+    zone = file;
+    switch (file.colorName) {
+    case ZoneFile::Color::none  :                                    break;
+    case ZoneFile::Color::green : zone.color = Color3(125, 255,  65); break;
+    case ZoneFile::Color::blue  : zone.color = Color3( 65, 125, 255); break;
+    case ZoneFile::Color::orange: zone.color = Color3(255, 125,  65); break;
+    }
+    
+    return true;
+  }
+  
+  /// Save a parsed zone.
+  /// \param[in] zone
+  ///   The parsed zone.
+  void save(ZoneDef &zone) {
+    ZoneDef::zones.set(zone.name, zone);
+  }
+}
+
 bool ZoneDef::load(const String &path) {
   ZoneDef zone { };
-  
-  bool success = parseMarkup(path, zone)
-    .section("zone")
-      .field("name", zone.name)
-      .field("color", zone.color, {
-        { "green" , Color3(125, 255,  65) },
-        { "blue"  , Color3( 65, 125, 255) },
-        { "orange", Color3(255, 125, 65) },
-      })
-  ;
-  if (!success)
+  if (!parse(path, zone))
     return false;
-  
-  // Save
-  ZoneDef::zones.set(zone.name, zone);
+  save(zone);
   
   return true;
 }
 
 bool ZoneDef::loadBatch(const char *directory, ...) {
-  bool success = true;
-  
   String dir = directory;
   
+  List<String> paths { };
   const char *path;
   va_list args;
   va_start(args, directory);
   while ((path = va_arg(args, const char *))) {
-    success &= ZoneDef::load(dir + path + ".zone");
+    paths.append(dir + path + ".zone");
   }
   va_end(args);
   
+  // Parse the files on every thread, then save them here in order
+  std::vector<ZoneDef> zones(paths.count());
+  std::unique_ptr<bool[]> parsed(new bool[paths.count()]);
+  const String *names = paths.begin();
+  Jobs::parallelFor("zone definitions", paths.count(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      parsed[i] = parse(names[i], zones[i]);
+  });
+  
+  bool success = true;
+  for (size_t i = 0; i < zones.size(); i++)
+    if (parsed[i])
+      save(zones[i]);
+    else
+      success = false;
+  
   return success;
 }
@@ -0,0 +1,13 @@
+#include <CityBuilder/../../driver/Driver.h>
+USING_NS_CITY_BUILDER
+
+// The tests run without a program driver, and so without resource files:
+// anything they parse is given to them in memory.
+bool Driver::loadResource(
+  const char  *name     ,
+  const char  *extension,
+        char **contents ,
+  size_t      *length
+) {
+  return false;
+}
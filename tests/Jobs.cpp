@@ -0,0 +1,166 @@
+#include <Expect>
+#include <CityBuilder/Jobs.h>
+#include <CityBuilder/Simulation/TrafficSimulation.h>
+#include <atomic>
+#include <cstring>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// Runs the shared pool with some worker threads for as long as it lives.
+  struct Pool {
+    Pool(int threads) {
+      Jobs::setThreads(threads);
+      Jobs::start();
+    }
+
+    ~Pool() {
+      Jobs::stop();
+    }
+  };
+
+  /// The thread counts to run every check with, none running every job on
+  /// the thread that adds it.
+  const int threadCounts[] = { 0, 1, 3 };
+
+  /// The positions of every vehicle of a traffic simulation on a grid after
+  /// some steps.
+  std::vector<TrafficSimulation::Snapshot> simulate(int threads) {
+    LaneDef roadway;
+    roadway.traffic.append({ 0, 7, 0,
+      LaneDef::Traffic::Type::directional,
+      LaneDef::Traffic::Category::all_vehicles,
+      LaneDef::Traffic::Connection::sameDirection });
+    RoadDef definition;
+    definition.lanes.append({ &roadway, { 0, 0 }, RoadDef::Lane::Direction::left, 25 });
+    definition.lanes.append({ &roadway, { 7, 0 }, RoadDef::Lane::Direction::right, 25 });
+    definition.dimensions = { 14, 1 };
+
+    List<Road *> roads { };
+    List<Intersection *> intersections { };
+    LaneGraph::buildGrid(&definition, 2000, roads, intersections);
+    LaneGraph graph;
+    for (Road *road : roads)
+      graph.invalidate(road);
+    graph.update();
+
+    std::vector<TrafficSimulation::Snapshot> snapshots;
+    {
+      Pool pool(threads);
+      TrafficSimulation simulation;
+      simulation.setThreads(threads == 0 ? 0 : -1);
+      simulation.sync(graph);
+      simulation.populate(3000);
+      for (int step = 0; step < 200; step++)
+        simulation.step();
+      snapshots.resize(simulation.count());
+      if (!snapshots.empty())
+        simulation.snapshot(snapshots.data());
+    }
+
+    for (Road *road : roads)
+      delete road;
+    for (Intersection *intersection : intersections)
+      delete intersection;
+    return snapshots;
+  }
+}
+
+SUITE(Jobs) {
+  TEST(counter, "Check that waiting on a counter runs every job counted.") {
+    for (int threads : threadCounts) {
+      Pool pool(threads);
+      EXPECT Jobs::threads() == threads;
+      std::atomic<int> ran { 0 };
+      Jobs::Counter counter;
+      for (int i = 0; i < 1000; i++)
+        Jobs::run("count", [&ran] { ran++; }, &counter);
+      Jobs::wait(counter);
+      EXPECT counter.done();
+      EXPECT ran.load() == 1000;
+    }
+  };
+
+  TEST(parallel-for, "Check that a parallel loop visits every index exactly once.") {
+    for (int threads : threadCounts)
+      for (size_t grain : { 1, 7, 64, 5000 }) {
+        Pool pool(threads);
+        std::vector<std::atomic<int>> visits(4099);
+        Jobs::parallelFor("visit", visits.size(), grain, [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++)
+            visits[i]++;
+        });
+        bool once = true;
+        for (const std::atomic<int> &count : visits)
+          once &= count.load() == 1;
+        EXPECT once;
+      }
+  };
+
+  TEST(after, "Check that a job held back by a counter sees everything written before it.") {
+    for (int threads : threadCounts) {
+      Pool pool(threads);
+
+      // Plain writes, only ordered by the counters, as a race detector would
+      // flag if the dependency did not hold
+      std::vector<int> values(64, 0);
+      int sum = -1;
+      Jobs::Counter written, summed;
+      for (size_t i = 0; i < values.size(); i++)
+        Jobs::run("write", [&values, i] { values[i] = (int)i + 1; }, &written);
+      Jobs::after(written, "sum", [&] {
+        sum = 0;
+        for (int value : values)
+          sum += value;
+      }, &summed);
+      Jobs::wait(summed);
+      Jobs::wait(written);
+      EXPECT sum == 64 * 65 / 2;
+    }
+  };
+
+  TEST(main-thread, "Check that jobs for the main thread only run on it.") {
+    for (int threads : threadCounts) {
+      Pool pool(threads);
+      std::atomic<int> onMain { 0 }, elsewhere { 0 };
+      Jobs::Counter counter;
+      for (int i = 0; i < 16; i++)
+        Jobs::run("hand over", [&] {
+          Jobs::runOnMain("bgfx", [&] {
+            (Jobs::isMainThread() ? onMain : elsewhere)++;
+          }, &counter);
+        }, &counter);
+      Jobs::wait(counter);
+      EXPECT onMain.load() == 16;
+      EXPECT elsewhere.load() == 0;
+    }
+  };
+
+  TEST(nested, "Check that jobs may wait on jobs of their own.") {
+    for (int threads : threadCounts) {
+      Pool pool(threads);
+      std::atomic<int> leaves { 0 };
+      Jobs::Counter outer;
+      for (int i = 0; i < 8; i++)
+        Jobs::run("branch", [&leaves] {
+          Jobs::Counter inner;
+          for (int j = 0; j < 8; j++)
+            Jobs::run("leaf", [&leaves] { leaves++; }, &inner);
+          Jobs::wait(inner);
+        }, &outer);
+      Jobs::wait(outer);
+      EXPECT leaves.load() == 64;
+    }
+  };
+
+  TEST(deterministic, "Check that simulating on the workers matches simulating on one thread.") {
+    std::vector<TrafficSimulation::Snapshot> serial = simulate(0);
+    EXPECT !serial.empty();
+    for (int threads : { 1, 3 }) {
+      std::vector<TrafficSimulation::Snapshot> parallel = simulate(threads);
+      EXPECT parallel.size() == serial.size();
+      EXPECT parallel.size() == serial.size() && memcmp(parallel.data(), serial.data(),
+        serial.size() * sizeof(TrafficSimulation::Snapshot)) == 0;
+    }
+  };
+}
@@ -0,0 +1,159 @@
+#include <Expect>
+#include <CityBuilder/Rendering/Mesh.h>
+#include <CityBuilder/Rendering/IndexList.h>
+#include <algorithm>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// A flat two-point cross-section, like a road divider.
+  ProfileMesh flatProfile() {
+    return {{
+      ProfilePoint { { 0, 0 }, { 0, 1 }, { }, 0, ProfilePoint::Type::move },
+      ProfilePoint { { 4, 0 }, { 0, 1 }, { }, 1, ProfilePoint::Type::move },
+    }};
+  }
+
+  /// Check that every index of a mesh references one of its vertices.
+  bool indicesInRange(const Mesh &mesh) {
+    for (size_t i = 0; i < mesh.indices().count(); i++)
+      if (mesh.indices()[i] >= mesh.vertexCount())
+        return false;
+    return true;
+  }
+}
+
+SUITE(IndexList) {
+  TEST(narrow, "Check that small indices are kept in 16 bits.") {
+    IndexList indices;
+
+    indices.append(0);
+    indices.append(IndexList::max16);
+
+    EXPECT !indices.isWide();
+    EXPECT indices.flags() == BGFX_BUFFER_NONE;
+    EXPECT indices.count() == 2;
+    EXPECT indices[1] == IndexList::max16;
+  };
+
+  TEST(widen, "Check that a large index widens the whole list to 32 bits.") {
+    IndexList indices;
+
+    indices.append(7);
+    indices.append(70000);
+
+    EXPECT indices.isWide();
+    EXPECT indices.flags() == BGFX_BUFFER_INDEX32;
+    EXPECT indices.count() == 2;
+    EXPECT indices[0] == 7;
+    EXPECT indices[1] == 70000;
+  };
+
+  TEST(reset, "Check that clearing a list returns it to 16 bits.") {
+    IndexList indices;
+
+    indices.append(70000);
+    indices.removeAll();
+
+    EXPECT indices.isEmpty();
+    EXPECT !indices.isWide();
+  };
+}
+
+SUITE(Mesh) {
+  TEST(long-highway, "Extrude a highway long enough to need 32-bit indices.") {
+    ProfileMesh profile = flatProfile();
+    Mesh mesh;
+
+    // 200 km of highway in 10 m segments
+    const int segments = 20000;
+    for (int i = 0; i < segments; i++) {
+      Line2 segment({ Real(i * 10), 0 }, { Real(i * 10 + 10), 0 });
+      mesh.extrude(profile, segment);
+    }
+
+    EXPECT mesh.vertexCount() == segments * 2 * profile.vertices.count();
+    EXPECT mesh.vertexCount() > 65536;
+    EXPECT mesh.indices().isWide();
+    EXPECT indicesInRange(mesh);
+
+    // The last triangle must reference the last segment, not wrap around
+    uint32_t last = 0;
+    for (size_t i = mesh.indices().count() - 6; i < mesh.indices().count(); i++)
+      last = std::max(last, mesh.indices()[i]);
+    EXPECT last == mesh.vertexCount() - 1;
+  };
+
+  TEST(short-road, "Check that a short road keeps 16-bit indices.") {
+    ProfileMesh profile = flatProfile();
+    Mesh mesh;
+
+    Line2 segment({ 0, 0 }, { 100, 0 });
+    mesh.extrude(profile, segment);
+
+    EXPECT !mesh.indices().isWide();
+    EXPECT indicesInRange(mesh);
+  };
+
+  TEST(coarse-extrusion, "Check that a strided extrusion keeps both ends of the path.") {
+    ProfileMesh profile = flatProfile();
+    Bezier2 curve({ 0, 0 }, { 100, 0 }, { 100, 100 });
+    size_t points = curve.pointNormals().count();
+
+    Mesh full, coarse;
+    full.extrude(profile, curve);
+    coarse.extrude(profile, curve, { 0, 0 }, 1, 4);
+
+    EXPECT full.vertexCount() == points * profile.vertices.count();
+    EXPECT coarse.vertexCount() < full.vertexCount();
+    EXPECT coarse.vertexCount() == ((points - 2) / 4 + 2) * profile.vertices.count();
+    EXPECT indicesInRange(coarse);
+  };
+
+  TEST(collapsed-profile, "Check that curbs are dropped from a collapsed profile.") {
+    ProfileMesh sidewalk {{
+      ProfilePoint { { 0, 0 }, { -1, 0 }, { }, 0, ProfilePoint::Type::move },
+      ProfilePoint { { 0, 0.33 }, { -1, 0 }, { 0, 1 }, 0.125, ProfilePoint::Type::disjoint },
+      ProfilePoint { { 3, 0.33 }, { 0, 1 }, { 1, 0 }, 0.875, ProfilePoint::Type::disjoint },
+      ProfilePoint { { 3, 0 }, { 1, 0 }, { }, 1, ProfilePoint::Type::move },
+    }};
+    ProfileMesh top = sidewalk.collapsed(0.5);
+
+    EXPECT sidewalk.triangles.count() == 6;
+    EXPECT top.triangles.count() == 2;
+    EXPECT top.vertices.count() == 2;
+    EXPECT top.vertices[0].position.y == sidewalk.dimensions.y;
+    EXPECT top.vertices[1].position.x == sidewalk.dimensions.x;
+    EXPECT sidewalk.collapsed(0.1).triangles.count() == 6;
+  };
+
+  TEST(merged-chunk, "Merge many meshes into one past the 16-bit limit.") {
+    ProfileMesh profile = flatProfile();
+
+    // Build one road piece
+    Mesh piece;
+    for (int i = 0; i < 100; i++) {
+      Line2 segment({ Real(i * 10), 0 }, { Real(i * 10 + 10), 0 });
+      piece.extrude(profile, segment);
+    }
+    EXPECT !piece.indices().isWide();
+
+    // Merge enough copies of it to overflow 16-bit indices
+    Mesh chunk;
+    const int copies = 200;
+    for (int i = 0; i < copies; i++)
+      chunk.add(piece, { 1, 2 });
+
+    EXPECT chunk.vertexCount() == piece.vertexCount() * copies;
+    EXPECT chunk.indices().count() == piece.indices().count() * copies;
+    EXPECT chunk.indices().isWide();
+    EXPECT indicesInRange(chunk);
+
+    // Every copy must be offset past the previous copies
+    size_t stride = piece.indices().count();
+    bool offset = true;
+    for (int i = 0; i < copies; i++)
+      if (chunk.indices()[i * stride] != piece.indices()[0] + i * piece.vertexCount())
+        offset = false;
+    EXPECT offset;
+  };
+}
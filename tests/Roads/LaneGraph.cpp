@@ -0,0 +1,112 @@
+#include <Expect>
+#include <CityBuilder/Roads/LaneGraph.h>
+#include <cmath>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// A two-lane road, 14 units across before scaling, with a single traffic
+  /// pattern down the middle of each lane.
+  struct TwoLaneRoad {
+    LaneDef roadway;
+    RoadDef definition;
+    
+    TwoLaneRoad() {
+      roadway.traffic.append({ 0, 7, 0,
+        LaneDef::Traffic::Type::directional,
+        LaneDef::Traffic::Category::all_vehicles,
+        LaneDef::Traffic::Connection::sameDirection });
+      definition.lanes.append({ &roadway, { 0, 0 }, RoadDef::Lane::Direction::left, 25 });
+      definition.lanes.append({ &roadway, { 7, 0 }, RoadDef::Lane::Direction::right, 25 });
+      definition.dimensions = { 14, 1 };
+    }
+  };
+  
+  /// Whether two points are the same, allowing for rounding.
+  bool near(Real2 a, Real2 b) {
+    return a.distance(b) < Real(0.001);
+  }
+  
+  /// The segment that a segment of a graph leads onto, if it has exactly one
+  /// edge.
+  uint32_t onlyTarget(const LaneGraph &graph, uint32_t segment) {
+    if (graph.offsets()[segment + 1] != graph.offsets()[segment] + 1)
+      return UINT32_MAX;
+    return graph.edges()[graph.offsets()[segment]].target;
+  }
+}
+
+SUITE(LaneGraph) {
+  TEST(dead-end, "Check the segments of a single road and the turns at its ends.") {
+    TwoLaneRoad two;
+    Road road(&two.definition, new Line2({ 0, 0 }, { 30, 0 }));
+    
+    LaneGraph graph;
+    graph.invalidate(&road);
+    EXPECT graph.update();
+    
+    EXPECT graph.count() == 2;
+    const List<uint32_t> &ids = graph.segments(&road);
+    EXPECT ids.count() == 2;
+    const LaneGraph::Segment &left  = graph.segments()[ids[0]];
+    const LaneGraph::Segment &right = graph.segments()[ids[1]];
+    
+    // The lanes sit a third of their cross-section offset from the middle,
+    // the scale that roads are meshed at
+    Real offset = Real(3.5) / Real(3);
+    Real2 normal = road.path.normal(0);
+    EXPECT !left.forward;
+    EXPECT right.forward;
+    EXPECT near(right.start, normal * Real2( offset));
+    EXPECT near(right.end,   Real2(30, 0) + normal * Real2( offset));
+    EXPECT near(left.start,  Real2(30, 0) + normal * Real2(-offset));
+    EXPECT near(left.end,    normal * Real2(-offset));
+    EXPECT right.length == 30;
+    EXPECT right.cost == right.length / right.speed;
+    
+    // Each lane turns around onto the other at the end it leaves from
+    EXPECT graph.offsets().count() == 3;
+    EXPECT graph.offsets()[0] == 0;
+    EXPECT graph.edges().count() == 2;
+    EXPECT onlyTarget(graph, ids[0]) == ids[1];
+    EXPECT onlyTarget(graph, ids[1]) == ids[0];
+    EXPECT graph.edges()[graph.offsets()[ids[1]]].turn;
+    EXPECT std::fabs(graph.edges()[graph.offsets()[ids[1]]].length - 7 / 3.0f) < 0.001f;
+  };
+  
+  TEST(intersection, "Check the edges through an intersection between two roads.") {
+    TwoLaneRoad two;
+    Road a(&two.definition, new Line2({  0, 0 }, { 30, 0 }));
+    Road b(&two.definition, new Line2({ 30, 0 }, { 60, 0 }));
+    Intersection intersection({ 30, 0 });
+    intersection.addRoad(&a);
+    intersection.addRoad(&b);
+    
+    LaneGraph graph;
+    graph.invalidate(&intersection);
+    EXPECT graph.update();
+    EXPECT graph.count() == 4;
+    
+    uint32_t aLeft = graph.segments(&a)[0], aRight = graph.segments(&a)[1];
+    uint32_t bLeft = graph.segments(&b)[0], bRight = graph.segments(&b)[1];
+    
+    // The offsets bound the edges of every segment, in segment order
+    EXPECT graph.offsets().count() == graph.segments().count() + 1;
+    for (size_t i = 0; i + 1 < graph.offsets().count(); i++)
+      EXPECT graph.offsets()[i] <= graph.offsets()[i + 1];
+    EXPECT graph.offsets().last() == graph.edges().count();
+    
+    // Traffic carries on through the intersection in its own direction and
+    // turns around at the far dead ends
+    EXPECT onlyTarget(graph, aRight) == bRight;
+    EXPECT onlyTarget(graph, bLeft) == aLeft;
+    EXPECT onlyTarget(graph, aLeft) == aRight;
+    EXPECT onlyTarget(graph, bRight) == bLeft;
+    
+    // The roads stop short of the intersection, which the turn crosses
+    const LaneGraph::Segment &in = graph.segments()[aRight], &out = graph.segments()[bRight];
+    const LaneGraph::Edge &through = graph.edges()[graph.offsets()[aRight]];
+    EXPECT through.turn;
+    EXPECT in.end.x < 30 && out.start.x > 30;
+    EXPECT std::fabs(through.length - (float)in.end.distance(out.start)) < 0.001f;
+  };
+}
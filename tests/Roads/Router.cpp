@@ -0,0 +1,158 @@
+#include <Expect>
+#include <CityBuilder/Roads/Router.h>
+#include <cmath>
+#include <queue>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// A two-lane road between sidewalks, 20 units across before scaling.
+  struct Street {
+    LaneDef sidewalk;
+    LaneDef roadway;
+    RoadDef definition;
+
+    Street() {
+      sidewalk.traffic.append({ 0, 3, 0,
+        LaneDef::Traffic::Type::unordered,
+        LaneDef::Traffic::Category::all_peds,
+        LaneDef::Traffic::Connection::nearest });
+      roadway.traffic.append({ 0, 7, 0,
+        LaneDef::Traffic::Type::directional,
+        LaneDef::Traffic::Category::all_vehicles,
+        LaneDef::Traffic::Connection::sameDirection });
+      definition.lanes.append({ &sidewalk, {  0, 0 }, RoadDef::Lane::Direction::unordered, 0 });
+      definition.lanes.append({ &roadway,  {  3, 0 }, RoadDef::Lane::Direction::left, 25 });
+      definition.lanes.append({ &roadway,  { 10, 0 }, RoadDef::Lane::Direction::right, 25 });
+      definition.lanes.append({ &sidewalk, { 17, 0 }, RoadDef::Lane::Direction::unordered, 0 });
+      definition.dimensions = { 20, 1 };
+    }
+  };
+
+  /// A grid of streets compiled into a lane graph.
+  struct Grid {
+    Street street;
+    List<Road *> roads { };
+    List<Intersection *> intersections { };
+    LaneGraph graph;
+
+    Grid(size_t segments) {
+      LaneGraph::buildGrid(&street.definition, segments, roads, intersections);
+      for (Road *road : roads)
+        graph.invalidate(road);
+      graph.update();
+    }
+
+    ~Grid() {
+      for (Road *road : roads)
+        delete road;
+      for (Intersection *intersection : intersections)
+        delete intersection;
+    }
+  };
+
+  /// The time taken to travel from one segment to another found by Dijkstra's
+  /// algorithm over the lane graph itself.
+  float dijkstra(const LaneGraph &graph, uint32_t from, uint32_t to) {
+    const List<LaneGraph::Segment> &nodes = graph.segments();
+    std::vector<float> reached(nodes.count(), INFINITY);
+    using Item = std::pair<float, uint32_t>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<Item>> open;
+    reached[from] = nodes[from].cost;
+    open.push({ reached[from], from });
+    while (!open.empty()) {
+      auto [cost, id] = open.top();
+      open.pop();
+      if (id == to)
+        return cost;
+      if (cost > reached[id])
+        continue;
+      for (uint32_t i = graph.offsets()[id]; i < graph.offsets()[id + 1]; i++) {
+        const LaneGraph::Edge &edge = graph.edges()[i];
+        float next = cost + edge.cost + nodes[edge.target].cost;
+        if (next < reached[edge.target]) {
+          reached[edge.target] = next;
+          open.push({ next, edge.target });
+        }
+      }
+    }
+    return INFINITY;
+  }
+
+  /// The number of routes between a spread of vehicle segments whose time
+  /// differs from Dijkstra's algorithm, or that are not connected end to end.
+  size_t mismatches(const LaneGraph &graph, Router &router) {
+    List<uint32_t> routed { };
+    for (uint32_t id = 0; id < graph.segments().count(); id++)
+      if (graph.segments()[id].road != nullptr &&
+          graph.segments()[id].category == LaneDef::Traffic::Category::all_vehicles)
+        routed.append(id);
+
+    size_t count = 0;
+    List<uint32_t> path { };
+    for (size_t i = 0; i < routed.count(); i += 7)
+      for (size_t j = 3; j < routed.count(); j += 29) {
+        uint32_t from = routed[i], to = routed[j];
+        float expected = dijkstra(graph, from, to);
+        path.removeAll();
+        float cost = router.route(from, to, path);
+        bool same = std::isinf(expected) ?
+          std::isinf(cost) && path.isEmpty() :
+          std::fabs(cost - expected) <= 1e-3f * expected &&
+            std::fabs(router.cost(from, to) - cost) <= 1e-3f * expected &&
+            !path.isEmpty() && path[0] == from && path[path.count() - 1] == to;
+        for (size_t k = 1; same && k < path.count(); k++) {
+          same = false;
+          for (uint32_t e = graph.offsets()[path[k - 1]]; e < graph.offsets()[path[k - 1] + 1]; e++)
+            same |= graph.edges()[e].target == path[k];
+        }
+        count += !same;
+      }
+    return count;
+  }
+}
+
+SUITE(Router) {
+  TEST(dijkstra, "Check the routes through a grid against Dijkstra's algorithm.") {
+    Grid grid(2000);
+    Router router;
+    EXPECT router.update(grid.graph);
+    EXPECT router.count() > 0;
+    EXPECT mismatches(grid.graph, router) == 0;
+    EXPECT !router.update(grid.graph);
+  };
+
+  TEST(remove, "Check the routes after removing a road without ordering again.") {
+    Grid grid(2000);
+    Router router;
+    router.update(grid.graph);
+
+    grid.graph.remove(grid.roads[grid.roads.count() / 2]);
+    EXPECT grid.graph.update();
+    EXPECT router.update(grid.graph);
+    EXPECT router.stats().orders == 1;
+    EXPECT router.stats().increments == 1;
+    EXPECT mismatches(grid.graph, router) == 0;
+  };
+
+  TEST(add, "Check the routes after adding a road without ordering again.") {
+    Grid grid(2000);
+    Router router;
+    router.update(grid.graph);
+    size_t count = router.count();
+
+    Intersection *corner = grid.intersections[0];
+    Road *spur = new Road(&grid.street.definition,
+      new Line2(corner->center, corner->center - Real2(60, 0)));
+    corner->addRoad(spur);
+    grid.roads.append(spur);
+    grid.graph.invalidate(spur);
+    grid.graph.invalidate(corner);
+    EXPECT grid.graph.update();
+    EXPECT router.update(grid.graph);
+    EXPECT router.stats().orders == 1;
+    EXPECT router.stats().increments == 1;
+    EXPECT router.count() > count;
+    EXPECT mismatches(grid.graph, router) == 0;
+  };
+}
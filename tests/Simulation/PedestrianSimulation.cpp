@@ -0,0 +1,143 @@
+#include <Expect>
+#include <CityBuilder/Simulation/PedestrianSimulation.h>
+#include <cmath>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// A grid of two-lane roads between sidewalks, zoned for homes and shops
+  /// in turn, compiled into a lane graph and lots.
+  struct Town {
+    LaneDef sidewalk;
+    LaneDef roadway;
+    RoadDef definition;
+    ZoneDef residential;
+    ZoneDef commercial;
+    List<Road *> roads { };
+    List<Intersection *> intersections { };
+    LaneGraph graph;
+    Parcels parcels;
+
+    Town() {
+      sidewalk.traffic.append({ 0, 3, 0,
+        LaneDef::Traffic::Type::unordered,
+        LaneDef::Traffic::Category::all_peds,
+        LaneDef::Traffic::Connection::nearest });
+      roadway.traffic.append({ 0, 7, 0,
+        LaneDef::Traffic::Type::directional,
+        LaneDef::Traffic::Category::all_vehicles,
+        LaneDef::Traffic::Connection::sameDirection });
+      definition.lanes.append({ &sidewalk, {  0, 0 }, RoadDef::Lane::Direction::unordered, 0 });
+      definition.lanes.append({ &roadway,  {  3, 0 }, RoadDef::Lane::Direction::left, 25 });
+      definition.lanes.append({ &roadway,  { 10, 0 }, RoadDef::Lane::Direction::right, 25 });
+      definition.lanes.append({ &sidewalk, { 17, 0 }, RoadDef::Lane::Direction::unordered, 0 });
+      definition.dimensions = { 20, 1 };
+      residential.name = "Residential";
+      residential.use  = ZoneDef::Use::residential;
+      commercial .name = "Commercial";
+      commercial .use  = ZoneDef::Use::commercial;
+
+      LaneGraph::buildGrid(&definition, 1500, roads, intersections);
+      for (size_t i = 0; i < roads.count(); i++) {
+        roads[i]->setLeftZone (i % 3 == 0 ? &commercial : &residential);
+        roads[i]->setRightZone(i % 2 == 0 ? &residential : nullptr);
+        graph.invalidate(roads[i]);
+        parcels.invalidate(roads[i]);
+      }
+      graph.update();
+      parcels.update();
+    }
+
+    ~Town() {
+      for (Road *road : roads)
+        delete road;
+      for (Intersection *intersection : intersections)
+        delete intersection;
+    }
+
+    /// The segments of the graph holding fewer than no pedestrians, or not a
+    /// number of them.
+    size_t negative(const PedestrianSimulation &simulation) const {
+      size_t count = 0;
+      for (uint32_t id = 0; id < graph.segments().count(); id++) {
+        float pedestrians = simulation.pedestrians(id);
+        count += !(pedestrians >= 0) || std::isinf(pedestrians);
+      }
+      return count;
+    }
+  };
+}
+
+SUITE(PedestrianSimulation) {
+  TEST(conservation, "Check that pedestrians are only added by departures and removed by arrivals.") {
+    Town town;
+    PedestrianSimulation simulation;
+    simulation.sync(town.graph, town.parcels);
+    EXPECT simulation.cells() > 0;
+    EXPECT simulation.count() == 0;
+
+    // Run long enough for pedestrians to reach the shops and walk home again
+    size_t steps = (size_t)(PedestrianSimulation::dwellTime * 3 / PedestrianSimulation::timestep);
+    bool conserved = true, sound = true;
+    for (size_t step = 0; step < steps; step++) {
+      double before = simulation.count() + simulation.shopping();
+      PedestrianSimulation::Stats stats = simulation.stats();
+      simulation.step();
+      double after = simulation.count() + simulation.shopping();
+      double added = (simulation.stats().departures - stats.departures) -
+        (simulation.stats().arrivals - stats.arrivals);
+      conserved &= std::fabs(after - (before + added)) <= 1e-6 * std::max(after, 1.0);
+      if (step % 100 == 0)
+        sound &= town.negative(simulation) == 0;
+    }
+    EXPECT conserved;
+    EXPECT sound;
+    EXPECT simulation.stats().departures > 0;
+    EXPECT simulation.stats().arrivals > 0;
+    EXPECT simulation.stats().crossings > 0;
+    EXPECT simulation.shopping() > 0;
+  };
+
+  TEST(densities, "Check that densities stay non-negative through edits and sampling.") {
+    Town town;
+    PedestrianSimulation simulation;
+    simulation.sync(town.graph, town.parcels);
+    for (int step = 0; step < 600; step++)
+      simulation.step();
+    EXPECT simulation.count() > 0;
+    EXPECT town.negative(simulation) == 0;
+
+    // Pedestrians on the sidewalks of a removed road go with it, and the
+    // rest carry on
+    Road *removed = town.roads[town.roads.count() / 2];
+    List<uint32_t> gone = town.graph.segments(removed);
+    EXPECT !gone.isEmpty();
+    town.graph.remove(removed);
+    town.parcels.remove(removed);
+    town.graph.update();
+    town.parcels.update();
+    simulation.sync(town.graph, town.parcels);
+    bool cleared = true;
+    for (uint32_t id : gone)
+      cleared &= simulation.pedestrians(id) == 0;
+    EXPECT cleared;
+    for (int step = 0; step < 600; step++)
+      simulation.step();
+    EXPECT town.negative(simulation) == 0;
+    EXPECT simulation.count() >= 0;
+    EXPECT simulation.shopping() >= 0;
+
+    // Agents only stand on sidewalks
+    Real2 center = town.intersections[town.intersections.count() / 2]->center;
+    simulation.sample(center, 200);
+    simulation.sample(center, 200);
+    EXPECT !simulation.agents().isEmpty();
+    EXPECT simulation.agents().count() <= PedestrianSimulation::maxAgents;
+    bool sidewalks = true;
+    for (const TrafficSimulation::Snapshot &agent : simulation.agents()) {
+      const LaneGraph::Segment &segment = town.graph.segments()[(uint32_t)agent.segment];
+      sidewalks &= segment.road != nullptr &&
+        segment.category == LaneDef::Traffic::Category::all_peds;
+    }
+    EXPECT sidewalks;
+  };
+}
@@ -0,0 +1,90 @@
+#include <Expect>
+#include <CityBuilder/Simulation/Scheduler.h>
+#include <cmath>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// A tick that takes a while, as a large city's would.
+  void slowTick(Real) {
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(2)) { }
+  }
+
+  /// Whether two times are the same, allowing for rounding.
+  bool near(double a, double b) {
+    return std::fabs(a - b) < 1e-3;
+  }
+}
+
+SUITE(Scheduler) {
+  TEST(fixed, "Check that frames of any length run whole ticks and carry the rest.") {
+    Scheduler scheduler;
+    int ticks = 0;
+    double elapsed = 0;
+    for (float frame : { 0.016f, 0.033f, 0.05f, 0.2f, 0.007f, 0.1f, 0.25f, 0.016f }) {
+      ticks += scheduler.advance(frame, [](Real) { });
+      elapsed += frame;
+    }
+    EXPECT ticks == (int)scheduler.stats().ticks;
+    EXPECT near(scheduler.time(), ticks * Scheduler::tick);
+    EXPECT near(scheduler.time() + scheduler.lag(), elapsed);
+    EXPECT scheduler.lag() < Scheduler::tick;
+    EXPECT scheduler.stats().dropped == 0;
+  };
+
+  TEST(dropped, "Check that a long frame only catches up with a whole frame.") {
+    Scheduler scheduler;
+    scheduler.setMultiplier(4);
+    EXPECT scheduler.advance(1.0f, [](Real) { }) > 0;
+    EXPECT near(scheduler.stats().dropped, (1.0 - Scheduler::maxFrame) * 4);
+    EXPECT near(scheduler.time() + scheduler.lag(), Scheduler::maxFrame * 4);
+  };
+
+  TEST(catch-up, "Check that falling behind is caught up a budget at a time.") {
+    Scheduler scheduler;
+    scheduler.setMultiplier(16);
+
+    // Owe 40 ticks of 2 ms each, four times the budget
+    int first = scheduler.advance(Scheduler::maxFrame, slowTick);
+    EXPECT first > 0;
+    EXPECT first < 40;
+    EXPECT scheduler.stats().longest < Scheduler::budget + 20000;
+
+    // Catch up over the next frames without owing any more
+    for (int frame = 0; frame < 40; frame++)
+      scheduler.advance(0, slowTick);
+    EXPECT near(scheduler.time() + scheduler.lag(), Scheduler::maxFrame * 16);
+    EXPECT scheduler.lag() < Scheduler::tick;
+    EXPECT scheduler.stats().dropped == 0;
+    EXPECT scheduler.stats().longest < Scheduler::budget + 20000;
+
+    // Keep owing more than can be run, and the rest is dropped rather than
+    // piling up
+    for (int frame = 0; frame < 8; frame++)
+      scheduler.advance(Scheduler::maxFrame, slowTick);
+    EXPECT scheduler.stats().dropped > 0;
+    EXPECT scheduler.stats().longest < Scheduler::budget + 20000;
+    double owed = 9 * Scheduler::maxFrame * 16;
+    EXPECT scheduler.time() + scheduler.stats().dropped <= owed + 1e-3;
+    EXPECT scheduler.time() + scheduler.stats().dropped + Scheduler::maxFrame * 16 >= owed - 1e-3;
+  };
+
+  TEST(exact, "Check that exact scheduling runs every tick owed and drops none.") {
+    Scheduler scheduler;
+    scheduler.setExact(true);
+    scheduler.setMultiplier(16);
+    EXPECT scheduler.advance(1.0f, [](Real) { }) >= 159;
+    EXPECT near(scheduler.time() + scheduler.lag(), 16.0);
+    EXPECT scheduler.lag() < Scheduler::tick;
+    EXPECT scheduler.stats().dropped == 0;
+  };
+
+  TEST(paused, "Check that a paused simulation runs no ticks and owes no time.") {
+    Scheduler scheduler;
+    scheduler.setPaused(true);
+    EXPECT scheduler.advance(1.0f, [](Real) { }) == 0;
+    scheduler.setPaused(false);
+    EXPECT scheduler.advance(0.1f, [](Real) { }) == 1;
+    EXPECT near(scheduler.time(), Scheduler::tick);
+  };
+}
@@ -51,4 +51,41 @@ SUITE(List) {
     EXPECT list[2] == 4;
     EXPECT list[3] == 5;
   };
+  
+  TEST(reserve, "Test appending to a list after reserving room.") {
+    List<int> list { 3, 4 };
+    
+    list.reserve(100);
+    for (int i = 0; i < 98; i++)
+      list.append(i);
+    
+    EXPECT list.count() == 100;
+    EXPECT list[0] == 3;
+    EXPECT list[1] == 4;
+    EXPECT list[99] == 97;
+  };
+  
+  TEST(clear, "Test refilling a list after clearing it.") {
+    List<int> list { 3, 4, 5 };
+    
+    list.clear();
+    const int *storage = list.begin();
+    for (int i = 0; i < 3; i++)
+      list.append(i);
+    
+    EXPECT list.count() == 3;
+    EXPECT list.begin() == storage;
+    EXPECT list[2] == 2;
+  };
+  
+  TEST(clear-shared, "Test clearing a list that shares its storage.") {
+    List<int> list { 3, 4, 5 };
+    List<int> copy = list;
+    
+    list.clear();
+    
+    EXPECT list.isEmpty();
+    EXPECT copy.count() == 3;
+    EXPECT copy[0] == 3;
+  };
 }
@@ -0,0 +1,92 @@
+#include <Expect>
+#include <CityBuilder/Tools/Archive.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// The file that the test archives are written to.
+  const char *path = "archive-test.pack";
+
+  /// Build an archive of a single resource, "road.markup".
+  std::string pack(const char *payload) {
+    std::string names = "road.markup";
+    names.push_back(0);
+    size_t nameOffset = sizeof(Archive::Header) + sizeof(Archive::Entry);
+    size_t offset = nameOffset + names.size();
+
+    Archive::Header header = { { 'C', 'B', 'P', 'K' }, Archive::version, 1, 1 };
+    Archive::Entry entry = { };
+    entry.hash   = Archive::hash("road", "markup");
+    entry.offset = offset;
+    entry.length = strlen(payload);
+    entry.name   = (uint32_t)nameOffset;
+
+    std::string file((const char *)&header, sizeof(header));
+    file.append((const char *)&entry, sizeof(entry));
+    file += names;
+    file += payload;
+    file.push_back(0);
+    return file;
+  }
+
+  /// Write an archive to the test file and open it.
+  bool open(const std::string &file) {
+    FILE *out = fopen(path, "wb");
+    fwrite(file.data(), 1, file.size(), out);
+    fclose(out);
+    bool opened = Archive::open(path);
+    remove(path);
+    return opened;
+  }
+
+  /// Change the entry of an archive built by `pack`.
+  std::string patch(std::string file, void (*change)(Archive::Entry &)) {
+    Archive::Entry entry;
+    memcpy(&entry, &file[sizeof(Archive::Header)], sizeof(entry));
+    change(entry);
+    memcpy(&file[sizeof(Archive::Header)], &entry, sizeof(entry));
+    return file;
+  }
+}
+
+SUITE(Archive) {
+  TEST(find, "Find a resource in an archive and read its payload.") {
+    EXPECT open(pack("lanes"));
+
+    const Archive::Entry *entry = Archive::find("road", "markup");
+    EXPECT entry != nullptr;
+    EXPECT entry->length == 5;
+    EXPECT strcmp(Archive::data(entry), "lanes") == 0;
+    EXPECT Archive::find("road", "zone") == nullptr;
+    Archive::close();
+  };
+
+  TEST(truncated, "Reject an archive cut off before the end of a payload.") {
+    std::string file = pack("lanes");
+
+    EXPECT !open(file.substr(0, file.size() - 3));
+    EXPECT !Archive::isOpen();
+  };
+
+  TEST(corrupt-entry, "Reject an archive whose table points outside of it.") {
+    std::string file = pack("lanes");
+
+    EXPECT !open(patch(file, [](Archive::Entry &entry) { entry.name = 1 << 30; }));
+    EXPECT !open(patch(file, [](Archive::Entry &entry) { entry.offset = ~0ull; }));
+    EXPECT !open(patch(file, [](Archive::Entry &entry) { entry.length = ~0ull - 8; }));
+    EXPECT !Archive::isOpen();
+  };
+
+  TEST(unterminated-name, "Reject an archive whose last name runs off its end.") {
+    std::string file = pack("");
+    file.resize(file.size() - 1);
+    file = patch(file, [](Archive::Entry &entry) {
+      entry.offset = entry.name;
+      entry.name = entry.name + 5;
+    });
+
+    EXPECT !open(file.substr(0, file.size() - 1));
+  };
+}
@@ -0,0 +1,139 @@
+#include <Expect>
+#include <CityBuilder/Tools/MarkupSchema.h>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// A record of a test file.
+  struct Record {
+    enum class Kind { a, b } kind;
+    Real start, end;
+    int count;
+    enum class Mode { none, fast, slow } mode = Mode::none;
+  };
+
+  /// The contents of a test file.
+  struct Item {
+    String name;
+    List<Record> records { };
+  };
+
+  /// The layout of a test file, with a value of every kind that lanes use.
+  constexpr auto itemSchema = Schema::document(
+    Schema::section("item",
+      Schema::field("name", &Item::name)),
+    Schema::section("records",
+      Schema::records(&Item::records, { "A", "B" },
+        Schema::set(&Record::kind, { Record::Kind::a, Record::Kind::b }),
+        Schema::real(&Record::start),
+        Schema::identifier("-"),
+        Schema::real(&Record::end),
+        Schema::comma(),
+        Schema::integer(&Record::count),
+        Schema::option("mode",
+          Schema::match(&Record::mode, {
+            { "fast", Record::Mode::fast },
+            { "slow", Record::Mode::slow },
+          }))))
+  );
+
+  /// Parse a test file, returning the errors printed.
+  std::string errors(const char *contents, Item &item) {
+    std::stringstream out;
+    std::streambuf *previous = std::cout.rdbuf(out.rdbuf());
+    Schema::parse("test.item", contents, strlen(contents), item, itemSchema);
+    std::cout.rdbuf(previous);
+    return out.str();
+  }
+
+  /// Parse a test file, returning the errors printed.
+  std::string errors(const char *contents) {
+    Item item { };
+    return errors(contents, item);
+  }
+}
+
+SUITE(MarkupSchema) {
+  TEST(parse, "Parse sections, fields, records and options.") {
+    Item item { };
+
+    EXPECT errors(
+      "# A test item\n"
+      "[item]\n"
+      "name \"Test\"\n"
+      "[records]\n"
+      "A 1 - 2.5, 3\n"
+      "B 4 - 5, 6 mode slow\n", item) == "";
+    EXPECT item.name == "Test";
+    EXPECT item.records.count() == 2;
+    EXPECT item.records[0].kind == Record::Kind::a;
+    EXPECT item.records[0].start == 1;
+    EXPECT item.records[0].end == 2.5;
+    EXPECT item.records[0].count == 3;
+    EXPECT item.records[0].mode == Record::Mode::none;
+    EXPECT item.records[1].kind == Record::Kind::b;
+    EXPECT item.records[1].mode == Record::Mode::slow;
+  };
+
+  // The messages below are those printed by the builder-chain parser that
+  // the schemas replaced, word for word, down to columns that count one too
+  // far for every number earlier on the line.
+
+  TEST(structure-errors, "Report data outside of sections and entries.") {
+    EXPECT errors("name \"x\"\n") ==
+      "Error in 'test.item' at line 1 col 1: Invalid data without a section.\n"
+      "Error in 'test.item' at line 1 col 7: Invalid data without a section.\n"
+      "Error in 'test.item' at line 1 col 9: Invalid data without a section.\n";
+    EXPECT errors("[item]\n\"x\" name\n") ==
+      "Error in 'test.item' at line 2 col 2: Invalid data without an identifier.\n";
+  };
+
+  TEST(token-errors, "Report unterminated strings and section names.") {
+    EXPECT errors("[item]\nname \"unterminated\n") ==
+      "Error in 'test.item' at line 3 col 1: Unexpected end-of-file in string.\n";
+    EXPECT errors("[item\n") ==
+      "Error in 'test.item' at line 1 col 6: Unexpected end-of-line in section name.\n"
+      "Error in 'test.item' at line 1 col 7: Unexpected end-of-file in section name.\n";
+  };
+
+  TEST(empty, "Report files without any content.") {
+    EXPECT errors("") == "No content found in the file 'test.item'.\n";
+    EXPECT errors("# only a comment\n") == "No content found in the file 'test.item'.\n";
+  };
+
+  TEST(unknown-names, "Report unknown sections, fields and records.") {
+    EXPECT errors("[shapes]\nA 1\n") ==
+      "Error in 'test.item' at line 1: Unknown section 'shapes'.\n";
+    EXPECT errors("[item]\ncolor \"red\"\n") ==
+      "Error in 'test.item' at line 2: Unknown field 'color'.\n";
+    EXPECT errors("[records]\nC 1 - 2, 3\n") ==
+      "Error in 'test.item' at line 2: Unknown field 'C'.\n";
+    EXPECT errors("[records]\nA 1 - 2, 3 mode medium\n") ==
+      "Error in 'test.item' at line 2 col 20: Unknown value 'medium'.\n";
+  };
+
+  TEST(value-errors, "Report values of the wrong kind.") {
+    EXPECT errors("[records]\nA 1 2, 3\n") ==
+      "Error in 'test.item' at line 2 col 6: Expected '-'.\n";
+    EXPECT errors("[records]\nA 1 - 2 3\n") ==
+      "Error in 'test.item' at line 2 col 11: Expected ','.\n";
+    EXPECT errors("[records]\nA x - 2, 3\n") ==
+      "Error in 'test.item' at line 2 col 3: Expected a real number.\n";
+    EXPECT errors("[records]\nA 1 - 2, 3.5\n") ==
+      "Error in 'test.item' at line 2 col 12: Expected an integer.\n";
+    EXPECT errors("[records]\nA 1 - 2, 99999999999\n") ==
+      "Error in 'test.item' at line 2 col 12: Unable to parse an integer.\n";
+  };
+
+  TEST(record-length, "Report records that end too early or run on.") {
+    EXPECT errors("[records]\nA 1 - 2,\n") ==
+      "Error in 'test.item' at line 2: Unexpected end-of-line, expectedan integer.\n";
+    EXPECT errors("[records]\nA 1 - 2, 3 mode\n") ==
+      "Error in 'test.item' at line 2: Unexpected end-of-line, expectedan identifier.\n";
+    EXPECT errors("[records]\nA 1 - 2, 3 4\n") ==
+      "Error in 'test.item' at line 2 col 15: Unused value.\n";
+  };
+}
@@ -0,0 +1,174 @@
+#include <Expect>
+#include <CityBuilder/Zones/Parcels.h>
+#include <cmath>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// A two-lane road between sidewalks, 20 units across before scaling.
+  struct Street {
+    LaneDef sidewalk;
+    LaneDef roadway;
+    RoadDef definition;
+    ZoneDef residential;
+
+    Street() {
+      sidewalk.traffic.append({ 0, 3, 0,
+        LaneDef::Traffic::Type::unordered,
+        LaneDef::Traffic::Category::all_peds,
+        LaneDef::Traffic::Connection::nearest });
+      roadway.traffic.append({ 0, 7, 0,
+        LaneDef::Traffic::Type::directional,
+        LaneDef::Traffic::Category::all_vehicles,
+        LaneDef::Traffic::Connection::sameDirection });
+      definition.lanes.append({ &sidewalk, {  0, 0 }, RoadDef::Lane::Direction::unordered, 0 });
+      definition.lanes.append({ &roadway,  {  3, 0 }, RoadDef::Lane::Direction::left, 25 });
+      definition.lanes.append({ &roadway,  { 10, 0 }, RoadDef::Lane::Direction::right, 25 });
+      definition.lanes.append({ &sidewalk, { 17, 0 }, RoadDef::Lane::Direction::unordered, 0 });
+      definition.dimensions = { 20, 1 };
+      residential.name = "Residential";
+    }
+
+    /// A road zoned on both sides.
+    Road *road(Real2 start, Real2 end) {
+      Road *road = new Road(&definition, new Line2(start, end));
+      road->setLeftZone(&residential);
+      road->setRightZone(&residential);
+      return road;
+    }
+  };
+
+  /// A copy of every lot slot, since the list of lots is shared until written.
+  std::vector<Parcels::Lot> snapshot(const Parcels &parcels) {
+    return std::vector<Parcels::Lot>(parcels.lots().begin(), parcels.lots().end());
+  }
+
+  /// Whether a lot is where it was.
+  bool same(const Parcels::Lot &a, const Parcels::Lot &b) {
+    for (int i = 0; i < 4; i++)
+      if (a.corners[i].distance(b.corners[i]) > Real(0.001))
+        return false;
+    return a.right == b.right && a.zone == b.zone;
+  }
+}
+
+SUITE(Parcels) {
+  TEST(split, "Check that the lots clear of a split keep their slots and corners.") {
+    Street street;
+    Road *road = street.road({ 0, 0 }, { 240, 0 });
+    Parcels parcels;
+    parcels.invalidate(road);
+    EXPECT parcels.update();
+    EXPECT parcels.count() > 0;
+    std::vector<Parcels::Lot> before = snapshot(parcels);
+
+    Road *first  = new Road(&street.definition, road->path.path().split(0, 0.5));
+    Road *second = new Road(&street.definition, road->path.path().split(0.5, 1));
+    for (Road *piece : { first, second }) {
+      piece->setLeftZone (&street.residential);
+      piece->setRightZone(&street.residential);
+    }
+    parcels.split(road, { first, second });
+    parcels.remove(road);
+    parcels.invalidate(first);
+    parcels.invalidate(second);
+    parcels.update();
+
+    // Every lot on one side of the split keeps its slot, and only those
+    // straddling it are subdivided again. Those next to it are clipped
+    // against the other piece, as they would be against the intersection
+    // built there, but the rest stay where they were
+    size_t kept = 0;
+    for (uint32_t id = 0; id < before.size(); id++) {
+      const Parcels::Lot &lot = before[id];
+      if (lot.road == nullptr || (lot.start < 120 && lot.end > 120))
+        continue;
+      const Parcels::Lot &now = parcels.lots()[id];
+      EXPECT now.road == (lot.end <= 120 ? first : second);
+      if (lot.end < 120 - Parcels::lotDepth || lot.start > 120 + Parcels::lotDepth) {
+        EXPECT same(lot, now);
+      }
+      kept++;
+    }
+    EXPECT kept > 0;
+    for (const Parcels::Lot &lot : parcels.lots()) {
+      EXPECT lot.road != road;
+    }
+
+    delete road;
+    delete first;
+    delete second;
+  };
+
+  TEST(push-back, "Check that pushing a road back only frees the lots pushed off it.") {
+    Street street;
+    Road *road = street.road({ 0, 0 }, { 240, 0 });
+    Parcels parcels;
+    parcels.invalidate(road);
+    parcels.update();
+    std::vector<Parcels::Lot> before = snapshot(parcels);
+
+    // Move the start of the road on, as an intersection built there would
+    road->path.pushBack(true, 30);
+    parcels.invalidate(road);
+    parcels.update();
+
+    size_t kept = 0;
+    for (uint32_t id = 0; id < before.size(); id++) {
+      const Parcels::Lot &lot = before[id];
+      if (lot.road == nullptr)
+        continue;
+      const Parcels::Lot &now = parcels.lots()[id];
+      if (now.road == nullptr || std::fabs(now.start - (lot.start - 30)) > 0.01f) {
+        // Only a lot reaching onto the part pushed off may be freed or reused
+        EXPECT lot.start < 30;
+      } else {
+        EXPECT std::fabs(now.end - (lot.end - 30)) < 0.01f;
+        kept++;
+      }
+    }
+    EXPECT kept > 0;
+
+    delete road;
+  };
+
+  TEST(remove, "Check that removing a road frees its slots for reuse and leaves the rest.") {
+    Street street;
+    Road *a = street.road({ 0,   0 }, { 240,   0 });
+    Road *b = street.road({ 0, 200 }, { 240, 200 });
+    Parcels parcels;
+    parcels.invalidate(a);
+    parcels.invalidate(b);
+    parcels.update();
+    std::vector<Parcels::Lot> before = snapshot(parcels);
+    size_t count = parcels.count();
+
+    parcels.remove(a);
+    EXPECT parcels.update();
+    size_t freed = 0;
+    for (uint32_t id = 0; id < before.size(); id++) {
+      const Parcels::Lot &lot = before[id];
+      const Parcels::Lot &now = parcels.lots()[id];
+      if (lot.road == a) {
+        EXPECT now.road == nullptr;
+        freed++;
+      } else if (lot.road == b) {
+        EXPECT now.road == b;
+        EXPECT same(lot, now);
+      }
+    }
+    EXPECT freed > 0;
+    EXPECT parcels.count() == count - freed;
+
+    // A new road takes the freed slots before adding any
+    Road *c = street.road({ 0, 0 }, { 240, 0 });
+    parcels.invalidate(c);
+    parcels.update();
+    EXPECT parcels.lots().count() == before.size();
+    EXPECT parcels.count() == count;
+
+    delete a;
+    delete b;
+    delete c;
+  };
+}
@@ -0,0 +1,182 @@
+/**
+ * @file main.cpp
+ * @brief The offline asset packer.
+ * @date May 6, 2023
+ * @copyright Copyright (c) 2023
+ *
+ * Packs a set of asset files into a single indexed archive (see
+ * `CityBuilder/Tools/Archive.h`).
+ *
+ * Usage:
+ *   CityBuilderAssetPack <output> <name.extension>=<file> ...
+ *
+ * Files ending in `.texture` are read as DDS files and stored without their
+ * header, alongside their format, size, layer and mip metadata.
+ * Files ending in `.shader` are stored as compiled shaders.
+ * Anything else is stored as-is.
+ */
+
+#include <CityBuilder/Tools/Archive.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+USING_NS_CITY_BUILDER
+
+namespace {
+  /// A resource to be packed.
+  struct Asset {
+    /// The resource name, without its extension.
+    std::string name;
+
+    /// The resource extension.
+    std::string extension;
+
+    /// The contents of the source file.
+    std::vector<char> contents;
+
+    /// The length of the source file's header, which is not packed.
+    size_t header = 0;
+
+    /// The table entry of the resource.
+    Archive::Entry entry = { };
+  };
+
+  bool readFile(const char *path, std::vector<char> &contents) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+      return false;
+    fseek(file, 0, SEEK_END);
+    contents.resize(ftell(file));
+    fseek(file, 0, SEEK_SET);
+    bool success = fread(contents.data(), 1, contents.size(), file) == contents.size();
+    fclose(file);
+    return success;
+  }
+
+  /// Round a value up to a multiple of the archive alignment.
+  uint64_t align(uint64_t value) {
+    return (value + Archive::alignment - 1) / Archive::alignment * Archive::alignment;
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cout << "Usage: " << argv[0] << " <output> <name.extension>=<file> ..." << std::endl;
+    return 1;
+  }
+
+  // Load the assets
+  std::vector<Asset> assets;
+  for (int i = 2; i < argc; i++) {
+    const char *argument = argv[i];
+    const char *separator = strchr(argument, '=');
+    // The extension starts at the last dot before the separator
+    const char *dot = nullptr;
+    for (const char *c = argument; separator && c < separator; c++)
+      if (*c == '.')
+        dot = c;
+    if (separator == nullptr || dot == nullptr) {
+      std::cout << "Invalid asset '" << argument << "', expected <name.extension>=<file>." << std::endl;
+      return 1;
+    }
+
+    Asset asset;
+    asset.name = std::string(argument, dot - argument);
+    asset.extension = std::string(dot + 1, separator - dot - 1);
+    if (!readFile(separator + 1, asset.contents)) {
+      std::cout << "Failed to read '" << separator + 1 << "'." << std::endl;
+      return 1;
+    }
+
+    asset.entry.hash = Archive::hash(asset.name.c_str(), asset.extension.c_str());
+    asset.entry.layers = 1;
+    asset.entry.mips = 1;
+
+    if (asset.extension == "texture") {
+      if (!Archive::parseTexture(asset.contents.data(), asset.contents.size(), asset.entry, asset.header)) {
+        std::cout << "Unsupported texture '" << separator + 1 << "'." << std::endl;
+        return 1;
+      }
+    } else if (asset.extension == "shader")
+      asset.entry.type = Archive::Type::shader;
+    else
+      asset.entry.type = Archive::Type::raw;
+
+    // Reject duplicates
+    for (const Asset &other : assets)
+      if (other.entry.hash == asset.entry.hash) {
+        std::cout << "Duplicate asset '" << asset.name << "." << asset.extension << "'." << std::endl;
+        return 1;
+      }
+
+    asset.entry.length = asset.contents.size() - asset.header;
+    assets.push_back(std::move(asset));
+  }
+
+  // Find a table size where every asset has its own bucket
+  uint32_t buckets = 1;
+  while (buckets < assets.size() * 2)
+    buckets *= 2;
+  for (;; buckets *= 2) {
+    if (buckets > (1u << 24)) {
+      std::cout << "Failed to build the asset table." << std::endl;
+      return 1;
+    }
+    std::vector<bool> used(buckets, false);
+    bool collision = false;
+    for (const Asset &asset : assets) {
+      uint32_t bucket = asset.entry.hash & (buckets - 1);
+      if (used[bucket]) {
+        collision = true;
+        break;
+      }
+      used[bucket] = true;
+    }
+    if (!collision)
+      break;
+  }
+
+  // Lay out the names and payloads
+  uint64_t offset = sizeof(Archive::Header) + sizeof(Archive::Entry) * (uint64_t)buckets;
+  for (Asset &asset : assets) {
+    asset.entry.name = (uint32_t)offset;
+    offset += asset.name.size() + 1 + asset.extension.size() + 1;
+  }
+  for (Asset &asset : assets) {
+    offset = align(offset);
+    asset.entry.offset = offset;
+    offset += asset.entry.length + 1;
+  }
+
+  // Write the archive
+  std::vector<char> archive(offset, 0);
+
+  Archive::Header header = { { 'C', 'B', 'P', 'K' }, Archive::version, (uint32_t)assets.size(), buckets };
+  memcpy(archive.data(), &header, sizeof(header));
+
+  Archive::Entry *table = (Archive::Entry *)(archive.data() + sizeof(header));
+  for (Asset &asset : assets) {
+    table[asset.entry.hash & (buckets - 1)] = asset.entry;
+
+    std::string name = asset.name + "." + asset.extension;
+    memcpy(archive.data() + asset.entry.name, name.c_str(), name.size() + 1);
+
+    memcpy(archive.data() + asset.entry.offset,
+      asset.contents.data() + asset.header, asset.entry.length);
+  }
+
+  FILE *file = fopen(argv[1], "wb");
+  if (file == NULL || fwrite(archive.data(), 1, archive.size(), file) != archive.size()) {
+    std::cout << "Failed to write '" << argv[1] << "'." << std::endl;
+    if (file)
+      fclose(file);
+    return 1;
+  }
+  fclose(file);
+
+  std::cout << "Packed " << assets.size() << " assets into '" << argv[1]
+    << "' (" << archive.size() << " bytes, " << buckets << " buckets)." << std::endl;
+  return 0;
+}